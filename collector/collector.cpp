@@ -0,0 +1,250 @@
+// =============================================================
+// === Colector de lecturas de las estaciones ===
+// =============================================================
+// Se suscribe al broker (Mosquitto local por defecto), interpreta los
+// payloads json-general, las variantes por sensor y los lotes, y los guarda
+// en el almacén columnar (ColumnStore.hpp). Cada 10 s escribe una línea de
+// estadísticas; con SIGINT/SIGTERM sella lo pendiente y termina.
+//
+//   ./build/collector --data datos --topic 'sensors/#'
+//   ./build/collector --data datos --replay mqtt.log     (registro de station_sim)
+//
+// Opciones:
+//   --host H / --port N   broker (127.0.0.1:1883)
+//   --topic FILTRO        filtro de suscripción (sensors/#); para repartir
+//                         entre procesos: '$share/colectores/sensors/#'
+//   --client-id ID        client id (collector-<pid>)
+//   --qos 0|1             QoS de la suscripción (1)
+//   --data DIR            directorio del almacén (datos)
+//   --segment-rows N      filas por segmento (4096)
+//   --seal-age S          segundos máximos de un segmento abierto (3600)
+//   --replay FICHERO      ingiere un --mqtt-log de station_sim en vez de conectar
+//   --no-predict          desactiva la predicción de claves (comparación)
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+
+#include "ColumnStore.hpp"
+#include "Ingestor.hpp"
+#include "MqttSubscriber.hpp"
+#include "ReconnectPolicy.hpp"
+
+namespace {
+
+volatile sig_atomic_t stopRequested = 0;
+
+void onSignal(int) { stopRequested = 1; }
+
+struct Options {
+  MqttSubscriberConfig mqtt;
+  std::string dataDir = "datos";
+  columnstore::Options store;
+  const char* replay = nullptr;
+  bool predict = true;
+};
+
+void usage(const char* argv0) {
+  fprintf(stderr,
+          "uso: %s [--host H] [--port N] [--topic FILTRO] [--client-id ID] [--qos 0|1] [--data DIR]\n"
+          "          [--segment-rows N] [--seal-age S] [--replay FICHERO] [--no-predict]\n",
+          argv0);
+}
+
+bool parseOptions(int argc, char** argv, Options& o) {
+  o.mqtt.clientId = "collector-" + std::to_string(getpid());
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    auto next = [&]() -> const char* {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "falta el valor de %s\n", arg);
+        exit(2);
+      }
+      return argv[++i];
+    };
+    if (!strcmp(arg, "--host")) o.mqtt.host = next();
+    else if (!strcmp(arg, "--port")) o.mqtt.port = (uint16_t)atoi(next());
+    else if (!strcmp(arg, "--topic")) o.mqtt.topic = next();
+    else if (!strcmp(arg, "--client-id")) o.mqtt.clientId = next();
+    else if (!strcmp(arg, "--qos")) o.mqtt.qos = (uint8_t)(atoi(next()) ? 1 : 0);
+    else if (!strcmp(arg, "--data")) o.dataDir = next();
+    else if (!strcmp(arg, "--segment-rows")) o.store.segmentRows = (uint32_t)strtoul(next(), nullptr, 10);
+    else if (!strcmp(arg, "--seal-age")) o.store.sealAgeMs = (uint32_t)(strtoul(next(), nullptr, 10) * 1000);
+    else if (!strcmp(arg, "--replay")) o.replay = next();
+    else if (!strcmp(arg, "--no-predict")) o.predict = false;
+    else {
+      usage(argv[0]);
+      return false;
+    }
+  }
+  if (o.store.segmentRows == 0) o.store.segmentRows = 1;
+  return true;
+}
+
+uint64_t monotonicMs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+void printStats(const char* tag, const Ingestor& ingestor, const columnstore::ColumnStore& store, double seconds) {
+  const IngestMetrics& m = ingestor.metrics();
+  const columnstore::Stats& s = store.stats();
+  const PayloadParser::Metrics& p = ingestor.parser().metrics();
+  const uint64_t rejected = m.rejected[1] + m.rejected[2] + m.rejected[3] + m.rejected[4];
+  fprintf(stderr,
+          "[%s] mensajes=%llu (%.0f/s) filas=%llu ignorados=%llu rechazados=%llu (not_json=%llu malformed=%llu)"
+          " abiertas=%zu segmentos=%llu disco=%llu B (%.1fx) claves predichas=%.1f%%\n",
+          tag, (unsigned long long)m.messages, seconds > 0 ? m.messages / seconds : 0.0, (unsigned long long)m.rows,
+          (unsigned long long)m.ignored, (unsigned long long)rejected, (unsigned long long)m.rejected[1],
+          (unsigned long long)m.rejected[2], store.openRows(), (unsigned long long)s.segmentsSealed,
+          (unsigned long long)s.storedBytes, s.storedBytes ? (double)s.rawBytes / s.storedBytes : 0.0,
+          p.predicted + p.looked ? 100.0 * p.predicted / (p.predicted + p.looked) : 0.0);
+}
+
+// =============================================================
+// === Reproducción de un registro de station_sim ===
+// =============================================================
+// Línea: "<t_s> <origen> <topic>[ (r)] <len> <payload con \xHH>". El reloj
+// para sellar por antigüedad es el de la simulación.
+int replay(const Options& o, Ingestor& ingestor, columnstore::ColumnStore& store) {
+  FILE* in = fopen(o.replay, "r");
+  if (!in) {
+    perror(o.replay);
+    return 1;
+  }
+  char* line = nullptr;
+  size_t capacity = 0;
+  std::string payload;
+  uint64_t lastSealMs = 0;
+  uint64_t lines = 0, skipped = 0;
+  ssize_t n;
+  while ((n = getline(&line, &capacity, in)) > 0 && !stopRequested) {
+    if (line[n - 1] == '\n') line[--n] = '\0';
+    lines++;
+    char* cursor = line;
+    char* fields[4];
+    for (int f = 0; f < 4; f++) {
+      fields[f] = cursor;
+      char* space = strchr(cursor, ' ');
+      if (!space) {
+        cursor = nullptr;
+        break;
+      }
+      *space = '\0';
+      cursor = space + 1;
+      // "(r)" es una marca, no un campo
+      if (f == 2 && strncmp(cursor, "(r) ", 4) == 0) cursor += 4;
+    }
+    if (!cursor) {
+      skipped++;
+      continue;
+    }
+    const uint64_t simMs = (uint64_t)(atof(fields[0]) * 1000.0);
+    const size_t expected = strtoul(fields[3], nullptr, 10);
+    payload.clear();
+    for (const char* p = cursor; *p; p++) {
+      if (p[0] == '\\' && p[1] == 'x' && p[2] && p[3]) {
+        const char hex[3] = {p[2], p[3], '\0'};
+        payload += (char)strtoul(hex, nullptr, 16);
+        p += 3;
+      } else {
+        payload += *p;
+      }
+    }
+    if (payload.size() != expected) {
+      skipped++;
+      continue;
+    }
+    ingestor.onMessage(fields[2], payload, simMs);
+    if (simMs - lastSealMs >= 1000) {
+      store.sealIdle(simMs);
+      lastSealMs = simMs;
+    }
+  }
+  free(line);
+  fclose(in);
+  store.flush();
+  fprintf(stderr, "[replay] %llu líneas, %llu descartadas\n", (unsigned long long)lines, (unsigned long long)skipped);
+  printStats("replay", ingestor, store, 0);
+  return 0;
+}
+
+// =============================================================
+// === Suscripción al broker ===
+// =============================================================
+int subscribe(const Options& o, Ingestor& ingestor, columnstore::ColumnStore& store) {
+  MqttSubscriber mqtt(o.mqtt);
+  ReconnectBackoff backoff;
+  backoff.configure(BackoffConfig{500, 30000});
+  backoff.seed(ReconnectBackoff::hashSeed((const uint8_t*)o.mqtt.clientId.data(), o.mqtt.clientId.size()));
+
+  const uint64_t startMs = monotonicMs();
+  uint64_t retryAtMs = startMs;
+  uint64_t lastSealMs = startMs;
+  uint64_t lastStatsMs = startMs;
+  uint64_t nowMs = startMs;
+  while (!stopRequested) {
+    nowMs = monotonicMs();
+    if (!mqtt.connected() && nowMs >= retryAtMs) {
+      if (mqtt.connect()) {
+        fprintf(stderr, "[mqtt] conectado a %s:%u, suscrito a %s\n", o.mqtt.host.c_str(), o.mqtt.port,
+                o.mqtt.topic.c_str());
+        backoff.reset();
+      } else {
+        const uint32_t delayMs = backoff.nextDelayMs();
+        fprintf(stderr, "[mqtt] %s; reintento en %u ms\n", mqtt.lastError().c_str(), delayMs);
+        retryAtMs = nowMs + delayMs;
+      }
+    }
+    if (mqtt.connected()) {
+      const int delivered = mqtt.poll(200, [&](std::string_view topic, std::string_view payload) {
+        ingestor.onMessage(topic, payload, nowMs);
+      });
+      if (delivered < 0) {
+        fprintf(stderr, "[mqtt] %s\n", mqtt.lastError().c_str());
+        retryAtMs = monotonicMs() + backoff.nextDelayMs();
+      }
+    } else {
+      struct timespec wait = {0, 100 * 1000 * 1000};
+      nanosleep(&wait, nullptr);
+    }
+    nowMs = monotonicMs();
+    if (nowMs - lastSealMs >= 1000) {
+      store.sealIdle(nowMs);
+      lastSealMs = nowMs;
+    }
+    if (nowMs - lastStatsMs >= 10000) {
+      printStats("colector", ingestor, store, (nowMs - startMs) / 1000.0);
+      lastStatsMs = nowMs;
+    }
+  }
+  mqtt.close();
+  store.flush();
+  printStats("colector", ingestor, store, (monotonicMs() - startMs) / 1000.0);
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options o;
+  if (!parseOptions(argc, argv, o)) return 2;
+
+  struct sigaction action = {};
+  action.sa_handler = onSignal;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+
+  columnstore::ColumnStore store(o.store);
+  if (!store.open(o.dataDir)) {
+    fprintf(stderr, "%s\n", store.lastError().c_str());
+    return 1;
+  }
+  Ingestor ingestor(store, o.predict);
+  return o.replay ? replay(o, ingestor, store) : subscribe(o, ingestor, store);
+}
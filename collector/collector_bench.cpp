@@ -0,0 +1,354 @@
+// =============================================================
+// === Rendimiento del colector ===
+// =============================================================
+// Mensajes generados con el mismo código que publica la estación
+// (PayloadWriter.hpp y BatchPayload.hpp): `estaciones` sensor_id distintos,
+// una lectura por minuto cada una y un lote de 16 filas cada 20 mensajes.
+//
+//   1. parser solo, con y sin predicción de claves (mensajes/s, MB/s)
+//   2. parser + almacén (sellado, codificación y zlib incluidos) y
+//      compresión obtenida
+//   3. extremo a extremo por TCP local: un hilo hace de broker y envía
+//      PUBLISH QoS 0; se mide la CPU del hilo del colector, así que el
+//      resultado es por núcleo aunque ambos hilos compartan CPU
+//   4. consultas: filas tal cual de una estación y media horaria de todas
+//
+//   ./build/collector_bench [mensajes] [estaciones]
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BatchPayload.hpp"
+#include "ColumnStore.hpp"
+#include "Ingestor.hpp"
+#include "IsoTimestamp.hpp"
+#include "MqttCodec.hpp"
+#include "MqttSubscriber.hpp"
+#include "PayloadParser.hpp"
+#include "PayloadWriter.hpp"
+
+namespace {
+
+constexpr int64_t START_MS = 1735689600000LL;  // 2025-01-01T00:00:00Z
+constexpr int64_t PERIOD_MS = 60000;
+constexpr size_t BATCH_EVERY = 20;
+constexpr size_t BATCH_ROWS = 16;
+
+struct Message {
+  std::string topic;
+  std::string payload;
+};
+
+struct Corpus {
+  std::vector<Message> messages;
+  size_t bytes = 0;
+  size_t rows = 0;
+};
+
+double seconds(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+}
+
+double threadCpuSeconds() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Series suaves con algo de ruido, como las del registro de ejemplo
+SensorData sample(uint32_t station, int64_t tMs, uint32_t& rng) {
+  auto noise = [&rng]() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return (float)(rng % 1000) / 1000.0f - 0.5f;
+  };
+  const float hour = (float)((tMs / 1000) % 86400) / 3600.0f;
+  const float daily = sinf((hour - 9.0f) * 3.14159265f / 12.0f);
+  SensorData d;
+  d.timestampMs = tMs;
+  d.temperatureC = 14.0f + (float)(station % 7) + 6.0f * daily + 0.2f * noise();
+  d.humidityPercent = roundf(55.0f - 15.0f * daily + noise());
+  d.pressureHpa = 1013.0f + (float)(station % 5) + 0.3f * noise();
+  d.altitudeMeters = 650.0f + (float)(station % 40);
+  d.lightLux = daily > 0 ? 800.0f * daily + 20.0f * noise() : 0.0f;
+  d.windSpeedKmh = fmaxf(0.0f, 6.0f + 4.0f * noise());
+  d.gasRaw = 1400 + (int)(station % 50) + (int)(40 * noise());
+  return d;
+}
+
+Corpus buildCorpus(size_t count, uint32_t stations) {
+  Corpus corpus;
+  corpus.messages.reserve(count);
+  IsoTimestampFormatter iso(true);
+  uint32_t rng = 0x12345678u;
+  char buffer[batchPayloadMaxLen(BATCH_ROWS)];
+  char timestamp[IsoTimestampFormatter::MAX_LEN + 1];
+  std::vector<int64_t> nextMs(stations, START_MS);
+  for (size_t i = 0; i < count; i++) {
+    const uint32_t s = (uint32_t)(i % stations);
+    Message m;
+    StationInfo info;
+    snprintf(info.sensorId, sizeof(info.sensorId), "WS_%04u", s);
+    m.topic = "sensors/street_" + std::to_string(1000 + s) + "/" + info.sensorId;
+    size_t len;
+    if (i % BATCH_EVERY == BATCH_EVERY - 1) {
+      // El lote lleva la identidad de config.h; se cambia al vuelo el id
+      StoredReading rows[BATCH_ROWS];
+      for (size_t r = 0; r < BATCH_ROWS; r++) {
+        rows[r] = StoredReading::from(sample(s, nextMs[s], rng));
+        nextMs[s] += PERIOD_MS;
+      }
+      len = writeBatchPayload(rows, BATCH_ROWS, buffer, sizeof(buffer));
+      m.payload.assign(buffer, len);
+      const std::string from = "\"" STATION_SENSOR_ID "\"";
+      m.payload.replace(m.payload.find(from), from.size(), std::string("\"") + info.sensorId + "\"");
+      m.topic += "/batch";
+      corpus.rows += BATCH_ROWS;
+    } else {
+      const SensorData d = sample(s, nextMs[s], rng);
+      nextMs[s] += PERIOD_MS;
+      iso.format(d.timestampMs, timestamp, sizeof(timestamp));
+      len = writeSensorPayload(info, d, timestamp, buffer, sizeof(buffer));
+      m.payload.assign(buffer, len);
+      corpus.rows++;
+    }
+    corpus.bytes += m.payload.size();
+    corpus.messages.push_back(std::move(m));
+  }
+  return corpus;
+}
+
+// === 1. Parser ===
+void benchParser(const Corpus& corpus, bool predict, int rounds) {
+  PayloadParser parser(predict);
+  uint64_t checksum = 0;
+  size_t rows = 0, errors = 0;
+  const auto started = std::chrono::steady_clock::now();
+  for (int round = 0; round < rounds; round++) {
+    for (const Message& m : corpus.messages) {
+      const bool batch = m.topic.size() > 6 && m.topic.compare(m.topic.size() - 6, 6, "/batch") == 0;
+      const ParseStatus status =
+          parser.parse(m.payload.data(), m.payload.size(), batch, [&](std::string_view id, const Reading& r) {
+            checksum += (uint64_t)r.timestampMs + id.size() + (uint64_t)(r.values[CH_TEMPERATURE] * 100.0f);
+            rows++;
+          });
+      if (status != ParseStatus::OK) errors++;
+    }
+  }
+  const double elapsed = seconds(started);
+  const double messages = (double)corpus.messages.size() * rounds;
+  const PayloadParser::Metrics& pm = parser.metrics();
+  printf("  %-14s %9.0f mensajes/s  %7.1f MB/s  %6.0f ns/mensaje  filas=%zu errores=%zu predichas=%.1f%% suma=%llx\n",
+         predict ? "con predicción" : "sin predicción", messages / elapsed, corpus.bytes * (double)rounds / elapsed / 1e6,
+         elapsed * 1e9 / messages, rows, errors,
+         pm.predicted + pm.looked ? 100.0 * pm.predicted / (pm.predicted + pm.looked) : 0.0,
+         (unsigned long long)checksum);
+}
+
+std::string makeTempDir() {
+  char pattern[] = "/tmp/collector_bench.XXXXXX";
+  const char* dir = mkdtemp(pattern);
+  return dir ? dir : "";
+}
+
+void removeTree(const std::string& dir) {
+  const std::string cmd = "rm -rf '" + dir + "'";
+  if (system(cmd.c_str()) != 0) fprintf(stderr, "no se pudo borrar %s\n", dir.c_str());
+}
+
+// === 2. Ingesta en el almacén ===
+void benchIngest(const Corpus& corpus, const std::string& dir, uint32_t stations) {
+  columnstore::Options options;
+  options.segmentRows = 4096;
+  columnstore::ColumnStore store(options);
+  if (!store.open(dir)) {
+    fprintf(stderr, "%s\n", store.lastError().c_str());
+    return;
+  }
+  Ingestor ingestor(store);
+  const auto started = std::chrono::steady_clock::now();
+  for (const Message& m : corpus.messages) ingestor.onMessage(m.topic, m.payload, 0);
+  store.flush();
+  const double elapsed = seconds(started);
+  const columnstore::Stats& s = store.stats();
+  printf("  %9.0f mensajes/s  %9.0f filas/s  segmentos=%llu (%u estaciones)\n",
+         corpus.messages.size() / elapsed, s.rowsAppended / elapsed, (unsigned long long)s.segmentsSealed, stations);
+  printf("  JSON %.1f B/fila -> columnas %.1f B/fila -> disco %.2f B/fila (%.1fx sobre columnas, %.0fx sobre JSON)\n",
+         (double)corpus.bytes / corpus.rows, (double)s.rawBytes / s.rowsSealed, (double)s.storedBytes / s.rowsSealed,
+         (double)s.rawBytes / s.storedBytes, (double)corpus.bytes / s.storedBytes);
+}
+
+// === 3. Extremo a extremo por TCP local ===
+// Broker de juguete: acepta una conexión, responde CONNACK y SUBACK y
+// envía `rounds` veces el corpus ya codificado
+void fakeBroker(int listener, const std::string* frames, int rounds) {
+  const int fd = accept(listener, nullptr, nullptr);
+  if (fd < 0) return;
+  uint8_t in[4096];
+  auto readPacket = [&]() { return recv(fd, in, sizeof(in), 0) > 0; };
+  static const uint8_t CONNACK[] = {mqttcodec::CONNACK, 0x02, 0x00, 0x00};
+  static const uint8_t SUBACK[] = {mqttcodec::SUBACK, 0x03, 0x00, 0x01, 0x00};
+  if (readPacket()) send(fd, CONNACK, sizeof(CONNACK), MSG_NOSIGNAL);
+  if (readPacket()) send(fd, SUBACK, sizeof(SUBACK), MSG_NOSIGNAL);
+  for (int r = 0; r < rounds; r++) {
+    const char* p = frames->data();
+    size_t left = frames->size();
+    while (left > 0) {
+      const ssize_t n = send(fd, p, left, MSG_NOSIGNAL);
+      if (n <= 0) break;
+      p += n;
+      left -= (size_t)n;
+    }
+  }
+  shutdown(fd, SHUT_WR);
+  while (recv(fd, in, sizeof(in), 0) > 0) {
+  }
+  close(fd);
+}
+
+void benchEndToEnd(const Corpus& corpus, const std::string& dir, int rounds) {
+  std::string frames;
+  for (const Message& m : corpus.messages) mqttcodec::appendPublish(frames, m.topic, m.payload, 0, 0);
+
+  const int listener = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addrLen = sizeof(addr);
+  if (listener < 0 || bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 1) != 0 ||
+      getsockname(listener, (sockaddr*)&addr, &addrLen) != 0) {
+    perror("socket de prueba");
+    return;
+  }
+  std::thread broker(fakeBroker, listener, &frames, rounds);
+
+  columnstore::ColumnStore store;
+  store.open(dir);
+  Ingestor ingestor(store);
+  MqttSubscriberConfig config;
+  config.port = ntohs(addr.sin_port);
+  config.qos = 0;
+  config.keepAliveS = 0;
+  MqttSubscriber mqtt(config);
+  if (!mqtt.connect()) {
+    fprintf(stderr, "  conexión de prueba: %s\n", mqtt.lastError().c_str());
+    broker.join();
+    close(listener);
+    return;
+  }
+  const size_t expected = corpus.messages.size() * (size_t)rounds;
+  size_t received = 0;
+  const double cpuStart = threadCpuSeconds();
+  const auto started = std::chrono::steady_clock::now();
+  while (received < expected) {
+    const int n = mqtt.poll(1000, [&](std::string_view topic, std::string_view payload) {
+      ingestor.onMessage(topic, payload, 0);
+    });
+    if (n < 0) break;
+    received += (size_t)n;
+  }
+  store.flush();
+  const double cpu = threadCpuSeconds() - cpuStart;
+  const double wall = seconds(started);
+  mqtt.close();
+  broker.join();
+  close(listener);
+  const MqttSubscriberMetrics& mm = mqtt.metrics();
+  printf("  %zu/%zu mensajes en %.2f s de pared, %.2f s de CPU del colector\n", received, expected, wall, cpu);
+  printf("  %9.0f mensajes/s por núcleo (%.1f MB/s), %.1f mensajes por lectura del socket\n", received / cpu,
+         mm.bytes / cpu / 1e6, mm.reads ? (double)mm.publishes / mm.reads : 0.0);
+}
+
+// === 4. Consultas ===
+void benchQuery(const std::string& dir, uint32_t stations, size_t expectedRows) {
+  columnstore::ColumnStore store;
+  store.open(dir);
+  std::vector<Reading> rows;
+  columnstore::QueryStats qs;
+  const uint32_t all = (1u << CHANNEL_COUNT) - 1;
+
+  size_t total = 0;
+  auto started = std::chrono::steady_clock::now();
+  for (uint32_t s = 0; s < stations; s++) {
+    char id[16];
+    snprintf(id, sizeof(id), "WS_%04u", s);
+    store.query(id, INT64_MIN, INT64_MAX, all, 0, columnstore::Aggregate::MEAN, rows, &qs);
+    total += rows.size();
+  }
+  double elapsed = seconds(started);
+  printf("  filas tal cual, 7 canales:      %8.0f consultas/s  %10.0f filas/s  (%zu de %zu filas)\n",
+         stations / elapsed, total / elapsed, total, expectedRows);
+
+  total = 0;
+  uint64_t fromSummary = 0, scanned = 0;
+  started = std::chrono::steady_clock::now();
+  for (uint32_t s = 0; s < stations; s++) {
+    char id[16];
+    snprintf(id, sizeof(id), "WS_%04u", s);
+    store.query(id, INT64_MIN, INT64_MAX, 1u << CH_TEMPERATURE, 3600000, columnstore::Aggregate::MEAN, rows, &qs);
+    total += rows.size();
+    fromSummary += qs.segmentsFromSummary;
+    scanned += qs.segmentsScanned;
+  }
+  elapsed = seconds(started);
+  printf("  media horaria de temperatura:   %8.0f consultas/s  %10zu intervalos  (%llu/%llu segmentos por resumen)\n",
+         stations / elapsed, total, (unsigned long long)fromSummary, (unsigned long long)scanned);
+
+  total = 0;
+  fromSummary = 0;
+  started = std::chrono::steady_clock::now();
+  for (uint32_t s = 0; s < stations; s++) {
+    char id[16];
+    snprintf(id, sizeof(id), "WS_%04u", s);
+    store.query(id, INT64_MIN, INT64_MAX, all, 30LL * 86400000, columnstore::Aggregate::MAX, rows, &qs);
+    total += rows.size();
+    fromSummary += qs.segmentsFromSummary;
+  }
+  elapsed = seconds(started);
+  printf("  máximo mensual, 7 canales:      %8.0f consultas/s  %10zu intervalos  (%llu segmentos por resumen)\n",
+         stations / elapsed, total, (unsigned long long)fromSummary);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+  const uint32_t stations = argc > 2 ? (uint32_t)strtoul(argv[2], nullptr, 10) : 50;
+  if (count == 0 || stations == 0) {
+    fprintf(stderr, "uso: %s [mensajes] [estaciones]\n", argv[0]);
+    return 2;
+  }
+  const Corpus corpus = buildCorpus(count, stations);
+  printf("corpus: %zu mensajes, %zu filas, %.1f MB, %u estaciones (%.0f B/mensaje)\n", corpus.messages.size(),
+         corpus.rows, corpus.bytes / 1e6, stations, (double)corpus.bytes / corpus.messages.size());
+
+  printf("1. parser\n");
+  benchParser(corpus, false, 5);
+  benchParser(corpus, true, 5);
+
+  const std::string dir = makeTempDir();
+  if (dir.empty()) {
+    perror("mkdtemp");
+    return 1;
+  }
+  printf("2. parser + almacén\n");
+  benchIngest(corpus, dir + "/ingesta", stations);
+  printf("3. extremo a extremo (TCP local, QoS 0)\n");
+  benchEndToEnd(corpus, dir + "/tcp", 1);
+  printf("4. consultas sobre el almacén de (2)\n");
+  benchQuery(dir + "/ingesta", stations, corpus.rows);
+  removeTree(dir);
+  return 0;
+}
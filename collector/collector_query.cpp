@@ -0,0 +1,137 @@
+// =============================================================
+// === Consulta del almacén del colector ===
+// =============================================================
+// Escribe CSV por stdout: timestamp ISO-8601 en UTC y una columna por canal.
+//
+//   ./build/collector_query --data datos                         (lista estaciones)
+//   ./build/collector_query --data datos --station WS_001
+//       --from 2025-01-01T00:00:00Z --to 2025-01-02T00:00:00Z --step 3600 --agg mean
+//       --columns temperature_celsius,humidity_percentage       (una sola línea)
+//
+// Opciones:
+//   --station ID      sensor_id
+//   --from / --to     ISO-8601 o epoch ms; [from, to). Sin ellos, todo
+//   --step S          segundos por intervalo; 0 = filas tal cual (0)
+//   --agg A           mean | min | max | last | count (mean)
+//   --columns LISTA   canales separados por comas (todos)
+#include <inttypes.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "ColumnStore.hpp"
+#include "IsoTimestamp.hpp"
+
+namespace {
+
+bool parseInstant(const char* text, int64_t& epochMs) {
+  if (parseIsoTimestamp(text, strlen(text), epochMs)) return true;
+  char* end = nullptr;
+  epochMs = strtoll(text, &end, 10);
+  return end && *end == '\0' && end != text;
+}
+
+bool parseColumns(const char* list, uint32_t& mask) {
+  mask = 0;
+  std::string names(list);
+  size_t start = 0;
+  while (start <= names.size()) {
+    const size_t comma = names.find(',', start);
+    const std::string name = names.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+    bool found = false;
+    for (size_t c = 0; c < CHANNEL_COUNT; c++) {
+      if (name == channelName((Channel)c)) {
+        mask |= 1u << c;
+        found = true;
+      }
+    }
+    if (!found) {
+      fprintf(stderr, "canal desconocido: %s\n", name.c_str());
+      return false;
+    }
+    if (comma == std::string::npos) break;
+    start = comma + 1;
+  }
+  return mask != 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* dataDir = "datos";
+  const char* station = nullptr;
+  int64_t fromMs = INT64_MIN;
+  int64_t toMs = INT64_MAX;
+  int64_t stepMs = 0;
+  columnstore::Aggregate aggregate = columnstore::Aggregate::MEAN;
+  uint32_t mask = (1u << CHANNEL_COUNT) - 1;
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    bool ok = value != nullptr;
+    if (!strcmp(arg, "--data") && ok) dataDir = value;
+    else if (!strcmp(arg, "--station") && ok) station = value;
+    else if (!strcmp(arg, "--from") && ok) ok = parseInstant(value, fromMs);
+    else if (!strcmp(arg, "--to") && ok) ok = parseInstant(value, toMs);
+    else if (!strcmp(arg, "--step") && ok) stepMs = (int64_t)(atof(value) * 1000.0);
+    else if (!strcmp(arg, "--agg") && ok) ok = columnstore::parseAggregate(value, aggregate);
+    else if (!strcmp(arg, "--columns") && ok) ok = parseColumns(value, mask);
+    else ok = false;
+    if (!ok) {
+      fprintf(stderr,
+              "uso: %s --data DIR [--station ID [--from T] [--to T] [--step S] [--agg mean|min|max|last|count]\n"
+              "          [--columns canal,...]]\n",
+              argv[0]);
+      return 2;
+    }
+    i++;
+  }
+
+  columnstore::ColumnStore store;
+  if (!store.open(dataDir)) {
+    fprintf(stderr, "%s\n", store.lastError().c_str());
+    return 1;
+  }
+  if (!station) {
+    for (const std::string& name : store.stations()) printf("%s\n", name.c_str());
+    return 0;
+  }
+
+  std::vector<Reading> rows;
+  columnstore::QueryStats qs;
+  const auto started = std::chrono::steady_clock::now();
+  if (!store.query(station, fromMs, toMs, mask, stepMs, aggregate, rows, &qs)) {
+    fprintf(stderr, "consulta fallida: %s\n", store.lastError().c_str());
+    return 1;
+  }
+  const double elapsedMs =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+  printf("timestamp");
+  for (size_t c = 0; c < CHANNEL_COUNT; c++) {
+    if (mask & (1u << c)) printf(",%s", channelName((Channel)c));
+  }
+  printf("\n");
+  IsoTimestampFormatter formatter(true);
+  char iso[IsoTimestampFormatter::MAX_LEN + 1];
+  for (const Reading& r : rows) {
+    formatter.format(r.timestampMs, iso, sizeof(iso), r.timestampMs % 1000 != 0);
+    printf("%s", iso);
+    for (size_t c = 0; c < CHANNEL_COUNT; c++) {
+      if (!(mask & (1u << c))) continue;
+      if (isnan(r.values[c])) printf(",");
+      else printf(",%.6g", r.values[c]);
+    }
+    printf("\n");
+  }
+  fprintf(stderr, "[consulta] %zu filas en %.2f ms; %u segmentos (%u por resumen), %" PRIu64 " filas leídas, %" PRIu64
+                  " B descodificados\n",
+          rows.size(), elapsedMs, qs.segmentsScanned, qs.segmentsFromSummary, qs.rowsScanned, qs.bytesDecoded);
+  return 0;
+}
@@ -0,0 +1,939 @@
+// =============================================================
+// === Generador de carga: flota de estaciones contra un broker ===
+// =============================================================
+// Emula N estaciones, cada una con su propia conexión MQTT, que publican el
+// payload real (writeSensorPayload() de PayloadWriter.hpp, lo mismo que
+// buildSensorPayload() en el firmware) en sensors/street_<calle>/WT_<n>:
+//
+//   - ciclo de --period-s con jitter uniforme de ±--jitter por ciclo y fase
+//     inicial aleatoria, como relojes de estaciones que no arrancan juntas;
+//   - QoS 1 con seguimiento de cada PUBACK (o QoS 0);
+//   - tormentas de reconexión: a los --storm-at s (y cada --storm-every s)
+//     una fracción de estaciones pierde la red durante --storm-down s; al
+//     volver reconectan con la política del firmware (ReconnectBackoff:
+//     jitter de subida de enlace y espera exponencial).
+//
+// Las estaciones se reparten entre --threads hilos, cada uno con su epoll y
+// sockets no bloqueantes. Todo lo que decide la carga (fases, jitter,
+// valores, víctimas de cada tormenta, semillas de reconexión) sale de --seed:
+// dos ejecuciones con la misma semilla ofrecen la misma carga; lo que mide
+// (latencias) depende del broker y de la máquina.
+//
+// Informe: latencia de publicación (del instante programado al último byte
+// aceptado por el socket), latencia del ack (de ahí al PUBACK), tiempo de
+// conexión y tasa de pérdida (publicaciones sin PUBACK: en vuelo al caer la
+// conexión o vencidas tras --ack-timeout-s). Las lecturas que tocan sin
+// conexión se cuentan aparte: la estación real las guardaría en su cola.
+//
+//   ./build/fleet_load --stations 2000 --duration-s 120                 (broker en 127.0.0.1:1883)
+//   ./build/fleet_load --self-broker --stations 5000 --period-s 5 --storm-at 30 --storm-fraction 0.5
+//
+// --self-broker levanta en el propio proceso un broker mínimo que solo
+// responde CONNACK/PUBACK/PINGRESP: mide el coste del lado de las estaciones
+// y permite probar sin Mosquitto (--broker-ack-loss F deja sin PUBACK esa
+// fracción de mensajes).
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "IsoTimestamp.hpp"
+#include "MqttCodec.hpp"
+#include "PayloadWriter.hpp"
+#include "ReconnectPolicy.hpp"
+
+namespace {
+
+struct Options {
+  std::string host = "127.0.0.1";
+  uint16_t port = 1883;
+  bool selfBroker = false;
+  uint32_t stations = 1000;
+  uint32_t threads = 0;  // 0 = núcleos disponibles
+  uint32_t perStreet = 20;
+  double periodS = 30.0;
+  double jitter = 0.05;
+  double durationS = 120.0;
+  double rampS = 2.0;  // reparto de la primera conexión (linkUpJitterMs del firmware)
+  uint8_t qos = 1;
+  uint32_t seed = 1;
+  double ackTimeoutS = 10.0;
+  double stormAtS = 0.0;  // 0 = sin tormentas
+  double stormEveryS = 0.0;
+  double stormFraction = 0.3;
+  double stormDownS = 10.0;
+  double brokerAckLoss = 0.0;  // solo con --self-broker
+};
+
+uint64_t nowUs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+int64_t wallMs() {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// splitmix64: semillas independientes por estación y por tormenta
+uint64_t mix(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+double unitFromHash(uint64_t h) { return (double)(h >> 11) / 9007199254740992.0; }
+
+// =============================================================
+// === Histograma de latencias ===
+// =============================================================
+// 16 sub-intervalos por potencia de 2 (error relativo < 6,25 %), en µs.
+class LatencyRecorder {
+ public:
+  static constexpr size_t BUCKETS = 16 + 44 * 16;
+
+  void record(uint64_t us) {
+    counts_[bucketOf(us)]++;
+    total_++;
+    if (us > max_) max_ = us;
+  }
+
+  void merge(const LatencyRecorder& other) {
+    for (size_t i = 0; i < BUCKETS; i++) counts_[i] += other.counts_[i];
+    total_ += other.total_;
+    if (other.max_ > max_) max_ = other.max_;
+  }
+
+  uint64_t count() const { return total_; }
+  uint64_t max() const { return max_; }
+
+  uint64_t percentile(double p) const {
+    if (total_ == 0) return 0;
+    const uint64_t rank = (uint64_t)(p / 100.0 * (double)(total_ - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+      seen += counts_[i];
+      if (seen >= rank) return std::min(upperBound(i), max_);
+    }
+    return max_;
+  }
+
+ private:
+  static size_t bucketOf(uint64_t v) {
+    if (v < 16) return (size_t)v;
+    const int msb = 63 - __builtin_clzll(v);
+    const size_t i = 16 + (size_t)(msb - 4) * 16 + (size_t)((v >> (msb - 4)) & 15);
+    return std::min(i, BUCKETS - 1);
+  }
+
+  static uint64_t upperBound(size_t i) {
+    if (i < 16) return i;
+    const size_t msb = (i - 16) / 16 + 4;
+    const uint64_t sub = (i - 16) % 16;
+    return ((16 + sub + 1) << (msb - 4)) - 1;
+  }
+
+  uint64_t counts_[BUCKETS] = {};
+  uint64_t total_ = 0;
+  uint64_t max_ = 0;
+};
+
+struct Metrics {
+  uint64_t scheduled = 0;  // ciclos vencidos
+  uint64_t offline = 0;    // ciclos sin conexión (la estación los encolaría)
+  uint64_t published = 0;  // escritos completos en el socket
+  uint64_t acked = 0;
+  uint64_t lostOnDisconnect = 0;
+  uint64_t ackTimeouts = 0;
+  uint64_t bytes = 0;
+  uint64_t connectAttempts = 0;
+  uint64_t connectFailures = 0;
+  uint64_t stormVictims = 0;
+  LatencyRecorder publishUs;
+  LatencyRecorder ackUs;
+  LatencyRecorder connectUs;
+  LatencyRecorder recoveryUs;  // de la vuelta del enlace al CONNACK
+
+  void merge(const Metrics& o) {
+    scheduled += o.scheduled;
+    offline += o.offline;
+    published += o.published;
+    acked += o.acked;
+    lostOnDisconnect += o.lostOnDisconnect;
+    ackTimeouts += o.ackTimeouts;
+    bytes += o.bytes;
+    connectAttempts += o.connectAttempts;
+    connectFailures += o.connectFailures;
+    stormVictims += o.stormVictims;
+    publishUs.merge(o.publishUs);
+    ackUs.merge(o.ackUs);
+    connectUs.merge(o.connectUs);
+    recoveryUs.merge(o.recoveryUs);
+  }
+};
+
+// =============================================================
+// === Estación emulada ===
+// =============================================================
+enum class LinkState : uint8_t { OFFLINE, TCP_CONNECTING, HANDSHAKE, ONLINE };
+
+struct Pending {
+  uint64_t scheduledUs;
+  size_t endOffset;  // fin del PUBLISH dentro de `out`
+  uint16_t packetId;
+};
+
+struct Inflight {
+  uint16_t packetId;
+  uint64_t writtenUs;
+};
+
+struct Station {
+  uint32_t index = 0;
+  StationInfo info;
+  std::string topic;
+  std::string clientId;
+  uint64_t rng = 0;
+  ReconnectBackoff backoff;
+  int fd = -1;
+  LinkState state = LinkState::OFFLINE;
+  bool linkUp = true;
+  uint64_t cycleUs = 0;    // próximo ciclo de medida
+  uint64_t connectUs = 0;  // próximo intento, o límite del intento en curso (0 = nada)
+  uint64_t attemptStartedUs = 0;
+  uint64_t linkUpAtUs = 0;  // != 0 hasta reconectar tras una tormenta
+  uint16_t nextPacketId = 1;
+  bool wantWrite = false;
+  std::string out;
+  size_t outSent = 0;
+  std::vector<Pending> pending;
+  std::deque<Inflight> inflight;
+  std::string in;
+
+  uint32_t random32() {
+    rng = mix(rng);
+    return (uint32_t)rng;
+  }
+  double uniform() { return unitFromHash(rng = mix(rng)); }
+};
+
+// Serie suave por estación: ciclo diario más ruido
+SensorData sampleFor(Station& s, int64_t epochMs) {
+  const double hour = (double)((epochMs / 1000) % 86400) / 3600.0;
+  const double daily = sin((hour - 9.0) * 3.14159265 / 12.0);
+  const float offset = (float)(s.index % 7);
+  SensorData d;
+  d.timestampMs = epochMs;
+  d.temperatureC = 14.0f + offset + 6.0f * (float)daily + 0.4f * (float)(s.uniform() - 0.5);
+  d.humidityPercent = roundf(55.0f - 15.0f * (float)daily + 2.0f * (float)(s.uniform() - 0.5));
+  d.pressureHpa = 1013.0f + (float)(s.index % 5) + 0.6f * (float)(s.uniform() - 0.5);
+  d.altitudeMeters = 650.0f + (float)(s.index % 40);
+  d.lightLux = daily > 0 ? 800.0f * (float)daily + 40.0f * (float)(s.uniform() - 0.5) : 0.0f;
+  d.windSpeedKmh = 6.0f + 8.0f * (float)s.uniform();
+  d.gasRaw = 1400 + (int)(s.index % 50) + (int)(80 * (s.uniform() - 0.5));
+  return d;
+}
+
+// =============================================================
+// === Hilo de trabajo: un epoll para sus estaciones ===
+// =============================================================
+class Worker {
+ public:
+  Worker(const Options& o, const sockaddr_storage& broker, socklen_t brokerLen, uint32_t first, uint32_t count,
+         uint64_t startUs)
+      : o_(o), broker_(broker), brokerLen_(brokerLen), startUs_(startUs) {
+    periodUs_ = (uint64_t)(o.periodS * 1e6);
+    // Keepalive de tres ciclos (mínimo 60 s): cada ciclo publica, así que
+    // no hace falta PINGREQ
+    keepAliveS_ = (uint16_t)std::min(65535.0, std::max(60.0, 3 * o.periodS));
+    stations_.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+      Station& s = stations_[i];
+      s.index = first + i;
+      s.rng = mix((uint64_t)o.seed << 32 | s.index);
+      snprintf(s.info.sensorId, sizeof(s.info.sensorId), "WT_%05u", s.index);
+      snprintf(s.info.streetId, sizeof(s.info.streetId), "ST_%04u", 1000 + s.index / o.perStreet);
+      s.topic = "sensors/street_" + std::to_string(1000 + s.index / o.perStreet) + "/" + s.info.sensorId;
+      s.clientId = std::string("fleet-") + s.info.sensorId;
+      s.backoff.configure(BackoffConfig());
+      s.backoff.seed(ReconnectBackoff::hashSeed((const uint8_t*)s.clientId.data(), s.clientId.size()) ^ o.seed);
+      s.in.reserve(64);
+      // Fase inicial en [0, periodo) y primera conexión repartida en la rampa
+      s.cycleUs = startUs + (uint64_t)(s.uniform() * (double)periodUs_);
+      s.connectUs = startUs + (uint64_t)(s.uniform() * o.rampS * 1e6);
+      schedule(s.cycleUs, i);
+      schedule(s.connectUs, i, TimerKind::CONNECT);
+    }
+  }
+
+  void run() {
+    epoll_ = epoll_create1(EPOLL_CLOEXEC);
+    const uint64_t endUs = startUs_ + (uint64_t)(o_.durationS * 1e6);
+    const uint64_t ackTimeoutUs = (uint64_t)(o_.ackTimeoutS * 1e6);
+    uint32_t stormIndex = 0;
+    uint64_t nextStormUs = o_.stormAtS > 0 ? startUs_ + (uint64_t)(o_.stormAtS * 1e6) : UINT64_MAX;
+    std::vector<epoll_event> events(256);
+    bool draining = false;
+    uint64_t drainEndUs = 0;
+
+    for (;;) {
+      uint64_t now = nowUs();
+      if (!draining && now >= endUs) {
+        // Fin de la medida: sin ciclos nuevos, espera a los acks pendientes
+        draining = true;
+        drainEndUs = now + ackTimeoutUs;
+      }
+      if (draining && (now >= drainEndUs || inflightTotal() == 0)) break;
+      if (!draining && now >= nextStormUs) {
+        storm(stormIndex++, now);
+        nextStormUs = o_.stormEveryS > 0 ? nextStormUs + (uint64_t)(o_.stormEveryS * 1e6) : UINT64_MAX;
+      }
+      while (!timers_.empty() && timers_.top().dueUs <= now) {
+        const Timer t = timers_.top();
+        timers_.pop();
+        fire(t, now, draining);
+      }
+      uint64_t waitUs = 50000;
+      if (!timers_.empty()) waitUs = std::min<uint64_t>(waitUs, timers_.top().dueUs > now ? timers_.top().dueUs - now : 0);
+      const int n = epoll_wait(epoll_, events.data(), (int)events.size(), (int)((waitUs + 999) / 1000));
+      now = nowUs();
+      for (int i = 0; i < n; i++) {
+        Station& s = stations_[events[i].data.u32];
+        if (s.fd < 0) continue;
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+          if (s.state == LinkState::TCP_CONNECTING) metrics_.connectFailures++;
+          fail(s, now);
+          continue;
+        }
+        if (events[i].events & EPOLLOUT) onWritable(s, now);
+        if (s.fd >= 0 && (events[i].events & EPOLLIN)) onReadable(s, now);
+      }
+      // Acks vencidos (los pendientes van en orden de escritura)
+      for (Station& s : stations_) {
+        while (!s.inflight.empty() && now - s.inflight.front().writtenUs > ackTimeoutUs) {
+          s.inflight.pop_front();
+          metrics_.ackTimeouts++;
+        }
+      }
+    }
+    for (Station& s : stations_) {
+      metrics_.ackTimeouts += s.inflight.size();
+      s.inflight.clear();
+      if (s.fd >= 0) {
+        static const uint8_t DISCONNECT[] = {mqttcodec::DISCONNECT, 0x00};
+        (void)::send(s.fd, DISCONNECT, sizeof(DISCONNECT), MSG_NOSIGNAL);
+        ::close(s.fd);
+        s.fd = -1;
+      }
+    }
+    ::close(epoll_);
+  }
+
+  const Metrics& metrics() const { return metrics_; }
+
+ private:
+  enum class TimerKind : uint8_t { CYCLE, CONNECT };
+  struct Timer {
+    uint64_t dueUs;
+    uint32_t station;
+    TimerKind kind;
+    bool operator>(const Timer& o) const { return dueUs > o.dueUs; }
+  };
+
+  void schedule(uint64_t dueUs, uint32_t station, TimerKind kind = TimerKind::CYCLE) {
+    timers_.push(Timer{dueUs, station, kind});
+  }
+  void scheduleConnect(Station& s, uint64_t dueUs) {
+    s.connectUs = dueUs;
+    timers_.push(Timer{dueUs, (uint32_t)(&s - stations_.data()), TimerKind::CONNECT});
+  }
+
+  size_t inflightTotal() const {
+    size_t n = 0;
+    for (const Station& s : stations_) n += s.inflight.size() + s.pending.size();
+    return n;
+  }
+
+  // Los temporizadores se invalidan de forma perezosa: solo vale el que
+  // coincide con el instante guardado en la estación
+  void fire(const Timer& t, uint64_t now, bool draining) {
+    Station& s = stations_[t.station];
+    if (t.kind == TimerKind::CYCLE) {
+      if (t.dueUs != s.cycleUs || draining) return;
+      cycle(s, now);
+      const double factor = 1.0 + o_.jitter * (2.0 * s.uniform() - 1.0);
+      s.cycleUs += (uint64_t)((double)periodUs_ * factor);
+      schedule(s.cycleUs, t.station);
+      return;
+    }
+    if (t.dueUs != s.connectUs) return;
+    s.connectUs = 0;
+    if (s.state == LinkState::OFFLINE) {
+      if (!draining && s.linkUp) startConnect(s, now);
+    } else if (s.state != LinkState::ONLINE) {
+      // connectTimeoutMs del controlador del firmware
+      metrics_.connectFailures++;
+      fail(s, now);
+    }
+  }
+
+  void cycle(Station& s, uint64_t now) {
+    metrics_.scheduled++;
+    if (s.state != LinkState::ONLINE) {
+      metrics_.offline++;
+      return;
+    }
+    const int64_t epochMs = wallMs();
+    const SensorData data = sampleFor(s, epochMs);
+    char timestamp[IsoTimestampFormatter::MAX_LEN + 1];
+    iso_.format(epochMs, timestamp, sizeof(timestamp), true);
+    char payload[SENSOR_PAYLOAD_BUFFER_LEN + 256];
+    const size_t len = writeSensorPayload(s.info, data, timestamp, payload, sizeof(payload));
+    const uint16_t packetId = o_.qos ? nextId(s) : 0;
+    mqttcodec::appendPublish(s.out, s.topic, std::string_view(payload, len), o_.qos, packetId);
+    s.pending.push_back(Pending{s.cycleUs, s.out.size(), packetId});
+    flush(s, now);
+  }
+
+  static uint16_t nextId(Station& s) {
+    const uint16_t id = s.nextPacketId++;
+    if (s.nextPacketId == 0) s.nextPacketId = 1;
+    return id;
+  }
+
+  void startConnect(Station& s, uint64_t now) {
+    metrics_.connectAttempts++;
+    s.attemptStartedUs = now;
+    s.fd = ::socket(broker_.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (s.fd < 0) {
+      metrics_.connectFailures++;
+      retryLater(s, now);
+      return;
+    }
+    const int one = 1;
+    setsockopt(s.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    const int rc = ::connect(s.fd, (const sockaddr*)&broker_, brokerLen_);
+    if (rc != 0 && errno != EINPROGRESS) {
+      metrics_.connectFailures++;
+      fail(s, now);
+      return;
+    }
+    s.state = LinkState::TCP_CONNECTING;
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.u32 = (uint32_t)(&s - stations_.data());
+    epoll_ctl(epoll_, EPOLL_CTL_ADD, s.fd, &ev);
+    s.wantWrite = true;
+    scheduleConnect(s, now + 15000000);
+  }
+
+  void onWritable(Station& s, uint64_t now) {
+    if (s.state == LinkState::TCP_CONNECTING) {
+      int error = 0;
+      socklen_t len = sizeof(error);
+      if (getsockopt(s.fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0 || error != 0) {
+        metrics_.connectFailures++;
+        fail(s, now);
+        return;
+      }
+      s.state = LinkState::HANDSHAKE;
+      mqttcodec::appendConnect(s.out, s.clientId, keepAliveS_);
+    }
+    flush(s, now);
+  }
+
+  void flush(Station& s, uint64_t now) {
+    while (s.outSent < s.out.size()) {
+      const ssize_t n = ::send(s.fd, s.out.data() + s.outSent, s.out.size() - s.outSent, MSG_NOSIGNAL);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN) break;
+        fail(s, now);
+        return;
+      }
+      s.outSent += (size_t)n;
+      metrics_.bytes += (size_t)n;
+    }
+    // PUBLISH escritos por completo: latencia de publicación y a esperar el ack
+    size_t done = 0;
+    while (done < s.pending.size() && s.pending[done].endOffset <= s.outSent) {
+      const Pending& p = s.pending[done++];
+      metrics_.published++;
+      metrics_.publishUs.record(now - p.scheduledUs);
+      if (o_.qos) s.inflight.push_back(Inflight{p.packetId, now});
+    }
+    s.pending.erase(s.pending.begin(), s.pending.begin() + (ptrdiff_t)done);
+    if (s.outSent == s.out.size()) {
+      s.out.clear();
+      s.outSent = 0;
+    }
+    const bool wantWrite = !s.out.empty();
+    if (wantWrite != s.wantWrite && s.state != LinkState::TCP_CONNECTING) {
+      epoll_event ev = {};
+      ev.events = EPOLLIN | (wantWrite ? (uint32_t)EPOLLOUT : 0u);
+      ev.data.u32 = (uint32_t)(&s - stations_.data());
+      epoll_ctl(epoll_, EPOLL_CTL_MOD, s.fd, &ev);
+      s.wantWrite = wantWrite;
+    }
+  }
+
+  void onReadable(Station& s, uint64_t now) {
+    char buffer[4096];
+    for (;;) {
+      const ssize_t n = ::recv(s.fd, buffer, sizeof(buffer), 0);
+      if (n == 0) {
+        fail(s, now);
+        return;
+      }
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN) fail(s, now);
+        break;
+      }
+      s.in.append(buffer, (size_t)n);
+      if ((size_t)n < sizeof(buffer)) break;
+    }
+    size_t at = 0;
+    for (;;) {
+      uint8_t type;
+      size_t headerLen, bodyLen;
+      const int state = mqttcodec::frame((const uint8_t*)s.in.data() + at, s.in.size() - at, 4096, type, headerLen,
+                                         bodyLen);
+      if (state < 0) {
+        fail(s, now);
+        return;
+      }
+      if (state == 0) break;
+      const uint8_t* body = (const uint8_t*)s.in.data() + at + headerLen;
+      at += headerLen + bodyLen;
+      switch (type & 0xF0) {
+        case mqttcodec::CONNACK:
+          if (bodyLen < 2 || body[1] != 0) {
+            metrics_.connectFailures++;
+            fail(s, now);
+            return;
+          }
+          onConnected(s, now);
+          break;
+        case mqttcodec::PUBACK:
+          if (bodyLen >= 2) onAck(s, mqttcodec::readPacketId(body), now);
+          break;
+        default:
+          break;
+      }
+    }
+    s.in.erase(0, at);
+  }
+
+  void onConnected(Station& s, uint64_t now) {
+    s.state = LinkState::ONLINE;
+    s.connectUs = 0;
+    s.backoff.reset();
+    metrics_.connectUs.record(now - s.attemptStartedUs);
+    if (s.linkUpAtUs) {
+      metrics_.recoveryUs.record(now - s.linkUpAtUs);
+      s.linkUpAtUs = 0;
+    }
+  }
+
+  void onAck(Station& s, uint16_t packetId, uint64_t now) {
+    for (auto it = s.inflight.begin(); it != s.inflight.end(); ++it) {
+      if (it->packetId == packetId) {
+        metrics_.acked++;
+        metrics_.ackUs.record(now - it->writtenUs);
+        s.inflight.erase(it);
+        return;
+      }
+    }
+  }
+
+  // Caída de la conexión o intento fallido: lo que estaba en vuelo se pierde
+  void fail(Station& s, uint64_t now) {
+    if (s.fd >= 0) {
+      ::close(s.fd);  // close() también lo saca del epoll
+      s.fd = -1;
+    }
+    metrics_.lostOnDisconnect += s.inflight.size() + s.pending.size();
+    s.inflight.clear();
+    s.pending.clear();
+    s.out.clear();
+    s.outSent = 0;
+    s.in.clear();
+    s.wantWrite = false;
+    s.state = LinkState::OFFLINE;
+    if (s.linkUp) retryLater(s, now);
+  }
+
+  void retryLater(Station& s, uint64_t now) {
+    scheduleConnect(s, now + (uint64_t)s.backoff.nextDelayMs() * 1000);
+  }
+
+  // Corte de red en una fracción de estaciones: cierre sin DISCONNECT (el
+  // broker solo lo ve por el keepalive o por el RST) y, al volver el
+  // enlace, el jitter de subida del firmware antes del primer intento
+  void storm(uint32_t index, uint64_t now) {
+    const uint64_t upAtUs = now + (uint64_t)(o_.stormDownS * 1e6);
+    for (Station& s : stations_) {
+      const uint64_t h = mix(mix((uint64_t)o_.seed << 32 | s.index) ^ ((uint64_t)index + 1) << 48);
+      if (unitFromHash(h) >= o_.stormFraction) continue;
+      metrics_.stormVictims++;
+      s.linkUp = false;
+      fail(s, now);
+      s.linkUp = true;
+      s.linkUpAtUs = upAtUs;
+      s.backoff.reset();
+      scheduleConnect(s, upAtUs + s.backoff.jitterMs(2000) * 1000ull);
+    }
+  }
+
+  const Options& o_;
+  sockaddr_storage broker_;
+  socklen_t brokerLen_;
+  uint64_t startUs_;
+  uint64_t periodUs_;
+  uint16_t keepAliveS_;
+  int epoll_ = -1;
+  std::vector<Station> stations_;
+  std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+  IsoTimestampFormatter iso_{true};
+  Metrics metrics_;
+};
+
+// =============================================================
+// === Broker mínimo en proceso (--self-broker) ===
+// =============================================================
+// Acepta todas las conexiones, responde CONNACK, PUBACK y PINGRESP y cuenta
+// los PUBLISH. No reenvía nada a nadie. Con --broker-ack-loss se calla una
+// fracción de los PUBACK para comprobar la contabilidad de pérdidas.
+class SelfBroker {
+ public:
+  bool start(sockaddr_storage& address, socklen_t& len, double ackLoss, uint32_t seed) {
+    ackLoss_ = ackLoss;
+    rng_ = mix(seed);
+    listener_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    const int one = 1;
+    setsockopt(listener_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    if (listener_ < 0 || bind(listener_, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener_, 4096) != 0 ||
+        getsockname(listener_, (sockaddr*)&addr, &addrLen) != 0) {
+      return false;
+    }
+    memset(&address, 0, sizeof(address));
+    memcpy(&address, &addr, sizeof(addr));
+    len = sizeof(addr);
+    thread_ = std::thread([this] { loop(); });
+    return true;
+  }
+
+  void stop() {
+    stop_ = true;
+    if (thread_.joinable()) thread_.join();
+    ::close(listener_);
+  }
+
+  uint64_t publishes() const { return publishes_.load(); }
+
+ private:
+  struct Connection {
+    int fd;
+    std::string in;
+    std::string out;
+  };
+
+  void loop() {
+    const int ep = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr;
+    epoll_ctl(ep, EPOLL_CTL_ADD, listener_, &ev);
+    std::vector<epoll_event> events(512);
+    while (!stop_) {
+      const int n = epoll_wait(ep, events.data(), (int)events.size(), 50);
+      for (int i = 0; i < n; i++) {
+        Connection* c = (Connection*)events[i].data.ptr;
+        if (!c) {
+          acceptAll(ep);
+          continue;
+        }
+        if ((events[i].events & (EPOLLERR | EPOLLHUP)) || !serve(*c)) {
+          ::close(c->fd);
+          delete c;
+          continue;
+        }
+        const bool wantWrite = !c->out.empty();
+        epoll_event mod = {};
+        mod.events = EPOLLIN | (wantWrite ? (uint32_t)EPOLLOUT : 0u);
+        mod.data.ptr = c;
+        epoll_ctl(ep, EPOLL_CTL_MOD, c->fd, &mod);
+      }
+    }
+    ::close(ep);  // las conexiones que queden las cierra la salida del proceso
+  }
+
+  void acceptAll(int ep) {
+    for (;;) {
+      const int fd = accept4(listener_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd < 0) return;
+      const int one = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      Connection* c = new Connection{fd, std::string(), std::string()};
+      epoll_event ev = {};
+      ev.events = EPOLLIN;
+      ev.data.ptr = c;
+      epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+    }
+  }
+
+  // false si hay que cerrar la conexión
+  bool serve(Connection& c) {
+    char buffer[16384];
+    for (;;) {
+      const ssize_t n = ::recv(c.fd, buffer, sizeof(buffer), 0);
+      if (n == 0) return false;
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN) return false;
+        break;
+      }
+      c.in.append(buffer, (size_t)n);
+    }
+    size_t at = 0;
+    for (;;) {
+      uint8_t type;
+      size_t headerLen, bodyLen;
+      const int state =
+          mqttcodec::frame((const uint8_t*)c.in.data() + at, c.in.size() - at, 1 << 20, type, headerLen, bodyLen);
+      if (state < 0) return false;
+      if (state == 0) break;
+      const uint8_t* body = (const uint8_t*)c.in.data() + at + headerLen;
+      at += headerLen + bodyLen;
+      switch (type & 0xF0) {
+        case mqttcodec::CONNECT:
+          mqttcodec::appendAck(c.out, mqttcodec::CONNACK, 0);
+          break;
+        case mqttcodec::PUBLISH: {
+          publishes_.fetch_add(1, std::memory_order_relaxed);
+          const uint8_t qos = (type >> 1) & 3;
+          if (qos > 0 && bodyLen >= 2) {
+            const size_t topicLen = (size_t)body[0] << 8 | body[1];
+            if (2 + topicLen + 2 <= bodyLen && unitFromHash(rng_ = mix(rng_)) >= ackLoss_) {
+              mqttcodec::appendAck(c.out, mqttcodec::PUBACK, mqttcodec::readPacketId(body + 2 + topicLen));
+            }
+          }
+          break;
+        }
+        case mqttcodec::PINGREQ:
+          mqttcodec::appendByte(c.out, mqttcodec::PINGRESP);
+          mqttcodec::appendByte(c.out, 0);
+          break;
+        case mqttcodec::DISCONNECT:
+          return false;
+        default:
+          break;
+      }
+    }
+    c.in.erase(0, at);
+    while (!c.out.empty()) {
+      const ssize_t n = ::send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+      if (n < 0) return errno == EAGAIN || errno == EINTR;
+      c.out.erase(0, (size_t)n);
+    }
+    return true;
+  }
+
+  int listener_ = -1;
+  std::thread thread_;
+  std::atomic<bool> stop_{false};
+  std::atomic<uint64_t> publishes_{0};
+  double ackLoss_ = 0.0;
+  uint64_t rng_ = 0;
+};
+
+// =============================================================
+// === Opciones e informe ===
+// =============================================================
+void usage(const char* argv0) {
+  fprintf(stderr,
+          "uso: %s [--host H] [--port N | --self-broker] [--stations N] [--threads T] [--per-street N]\n"
+          "          [--period-s S] [--jitter F] [--duration-s S] [--ramp-s S] [--qos 0|1] [--seed N]\n"
+          "          [--ack-timeout-s S] [--storm-at S] [--storm-every S] [--storm-fraction F] [--storm-down S]\n"
+          "          [--broker-ack-loss F]\n",
+          argv0);
+}
+
+bool parseOptions(int argc, char** argv, Options& o) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (!strcmp(arg, "--self-broker")) {
+      o.selfBroker = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return false;
+    }
+    const char* v = argv[++i];
+    if (!strcmp(arg, "--host")) o.host = v;
+    else if (!strcmp(arg, "--port")) o.port = (uint16_t)atoi(v);
+    else if (!strcmp(arg, "--stations")) o.stations = (uint32_t)strtoul(v, nullptr, 10);
+    else if (!strcmp(arg, "--threads")) o.threads = (uint32_t)strtoul(v, nullptr, 10);
+    else if (!strcmp(arg, "--per-street")) o.perStreet = std::max(1u, (uint32_t)strtoul(v, nullptr, 10));
+    else if (!strcmp(arg, "--period-s")) o.periodS = atof(v);
+    else if (!strcmp(arg, "--jitter")) o.jitter = atof(v);
+    else if (!strcmp(arg, "--duration-s")) o.durationS = atof(v);
+    else if (!strcmp(arg, "--ramp-s")) o.rampS = atof(v);
+    else if (!strcmp(arg, "--qos")) o.qos = atoi(v) ? 1 : 0;
+    else if (!strcmp(arg, "--seed")) o.seed = (uint32_t)strtoul(v, nullptr, 10);
+    else if (!strcmp(arg, "--ack-timeout-s")) o.ackTimeoutS = atof(v);
+    else if (!strcmp(arg, "--storm-at")) o.stormAtS = atof(v);
+    else if (!strcmp(arg, "--storm-every")) o.stormEveryS = atof(v);
+    else if (!strcmp(arg, "--storm-fraction")) o.stormFraction = atof(v);
+    else if (!strcmp(arg, "--storm-down")) o.stormDownS = atof(v);
+    else if (!strcmp(arg, "--broker-ack-loss")) o.brokerAckLoss = atof(v);
+    else {
+      usage(argv[0]);
+      return false;
+    }
+  }
+  if (o.stations == 0 || o.periodS <= 0 || o.durationS <= 0 || o.jitter < 0 || o.jitter >= 1) {
+    usage(argv[0]);
+    return false;
+  }
+  return true;
+}
+
+bool resolve(const Options& o, sockaddr_storage& address, socklen_t& len) {
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* result = nullptr;
+  const std::string port = std::to_string(o.port);
+  const int rc = getaddrinfo(o.host.c_str(), port.c_str(), &hints, &result);
+  if (rc != 0 || !result) {
+    fprintf(stderr, "%s: %s\n", o.host.c_str(), gai_strerror(rc));
+    return false;
+  }
+  memcpy(&address, result->ai_addr, result->ai_addrlen);
+  len = result->ai_addrlen;
+  freeaddrinfo(result);
+  return true;
+}
+
+// Cada estación usa un descriptor (dos con --self-broker)
+void raiseFileLimit(const Options& o) {
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return;
+  limit.rlim_cur = limit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &limit);
+  const rlim_t needed = (rlim_t)o.stations * (o.selfBroker ? 2 : 1) + 64;
+  if (limit.rlim_cur < needed) {
+    fprintf(stderr, "aviso: límite de descriptores %llu < %llu necesarios\n", (unsigned long long)limit.rlim_cur,
+            (unsigned long long)needed);
+  }
+}
+
+void printLatency(const char* name, const LatencyRecorder& r) {
+  printf("  %-22s n=%-9llu p50 %8.2f  p90 %8.2f  p99 %8.2f  p99.9 %8.2f  máx %8.2f ms\n", name,
+         (unsigned long long)r.count(), r.percentile(50) / 1e3, r.percentile(90) / 1e3, r.percentile(99) / 1e3,
+         r.percentile(99.9) / 1e3, r.max() / 1e3);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options o;
+  if (!parseOptions(argc, argv, o)) return 2;
+  if (o.threads == 0) o.threads = std::max(1u, std::thread::hardware_concurrency());
+  o.threads = std::min(o.threads, o.stations);
+  raiseFileLimit(o);
+
+  sockaddr_storage broker;
+  socklen_t brokerLen = 0;
+  SelfBroker selfBroker;
+  if (o.selfBroker) {
+    if (!selfBroker.start(broker, brokerLen, o.brokerAckLoss, o.seed)) {
+      perror("broker en proceso");
+      return 1;
+    }
+  } else if (!resolve(o, broker, brokerLen)) {
+    return 1;
+  }
+
+  printf("flota: %u estaciones en %u hilos, ciclo %.1f s ±%.0f %%, %.0f s, QoS %u, semilla %u, broker %s\n",
+         o.stations, o.threads, o.periodS, o.jitter * 100, o.durationS, o.qos, o.seed,
+         o.selfBroker ? "en proceso" : (o.host + ":" + std::to_string(o.port)).c_str());
+  if (o.stormAtS > 0) {
+    printf("tormentas: a los %.0f s%s, %.0f %% de las estaciones sin red durante %.0f s\n", o.stormAtS,
+           o.stormEveryS > 0 ? (" y cada " + std::to_string((int)o.stormEveryS) + " s").c_str() : "",
+           o.stormFraction * 100, o.stormDownS);
+  }
+
+  const uint64_t startUs = nowUs() + 100000;
+  std::vector<Worker*> workers;
+  for (uint32_t t = 0; t < o.threads; t++) {
+    const uint32_t first = (uint32_t)((uint64_t)o.stations * t / o.threads);
+    const uint32_t last = (uint32_t)((uint64_t)o.stations * (t + 1) / o.threads);
+    workers.push_back(new Worker(o, broker, brokerLen, first, last - first, startUs));
+  }
+  std::vector<std::thread> threads;
+  for (Worker* w : workers) threads.emplace_back([w] { w->run(); });
+  for (std::thread& t : threads) t.join();
+  const double elapsedS = (nowUs() - startUs) / 1e6;
+
+  Metrics total;
+  for (Worker* w : workers) {
+    total.merge(w->metrics());
+    delete w;
+  }
+  if (o.selfBroker) selfBroker.stop();
+
+  const uint64_t lost = total.lostOnDisconnect + total.ackTimeouts;
+  printf("conexiones: %llu intentos, %llu fallidos\n", (unsigned long long)total.connectAttempts,
+         (unsigned long long)total.connectFailures);
+  printf("ciclos: %llu programados, %llu sin conexión (%.2f %%)\n", (unsigned long long)total.scheduled,
+         (unsigned long long)total.offline, total.scheduled ? 100.0 * total.offline / total.scheduled : 0.0);
+  printf("publicaciones: %llu (%.1f/s, %.2f MB/s)", (unsigned long long)total.published,
+         total.published / o.durationS, total.bytes / elapsedS / 1e6);
+  if (o.qos) {
+    printf(", %llu con PUBACK, %llu perdidas al caer la conexión, %llu sin ack en %.0f s -> pérdida %.3f %%",
+           (unsigned long long)total.acked, (unsigned long long)total.lostOnDisconnect,
+           (unsigned long long)total.ackTimeouts, o.ackTimeoutS,
+           total.published + total.lostOnDisconnect ? 100.0 * lost / (total.published + total.lostOnDisconnect) : 0.0);
+  }
+  printf("\n");
+  if (o.selfBroker) printf("broker en proceso: %llu PUBLISH recibidos\n", (unsigned long long)selfBroker.publishes());
+  printf("latencias:\n");
+  printLatency("publicación", total.publishUs);
+  if (o.qos) printLatency("ack (PUBACK)", total.ackUs);
+  printLatency("conexión", total.connectUs);
+  if (total.stormVictims) {
+    printf("tormentas: %llu cortes\n", (unsigned long long)total.stormVictims);
+    printLatency("vuelta del enlace->MQTT", total.recoveryUs);
+  }
+  return 0;
+}
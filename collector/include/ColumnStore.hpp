@@ -0,0 +1,709 @@
+#pragma once
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "PayloadParser.hpp"
+
+// =============================================================
+// === Almacén columnar por estación ===
+// =============================================================
+// Cada estación acumula sus lecturas en un segmento abierto en memoria. Al
+// llegar a `segmentRows` filas, al cumplir `sealAgeMs` o en flush() se
+// sella: se ordena por timestamp, se fusionan los duplicados y cada columna
+// se codifica y comprime por separado en un fichero
+// <dir>/<estación>/<tMin>-<tMax>-<pid>-<n>.wseg. Los segmentos sellados se
+// leen con mmap; una consulta solo descomprime las columnas que pide.
+//
+//   WSEG v1 (little-endian, el del host):
+//     SegmentHeader
+//     ColumnEntry[columnCount]   resumen min/max/suma/cuenta de cada columna
+//     bloques de columna         en los offsets de cada ColumnEntry
+//
+// Codificación de columnas, antes de zlib (Z_BEST_SPEED):
+//   timestamp  deltas en varint zigzag (15 min -> 3 bytes, 1 s -> 2)
+//   canales    XOR con el valor anterior y los 4 bytes de cada float en
+//              planos separados: las series lentas dejan planos casi a cero
+// Si zlib no reduce el bloque se guarda sin comprimir (codec RAW).
+//
+// No es seguro entre hilos: el colector lo usa desde un único hilo. Varios
+// colectores pueden compartir directorio (los nombres llevan el pid) y la
+// consulta de otro proceso ve los segmentos ya sellados.
+namespace columnstore {
+
+constexpr char SEGMENT_MAGIC[4] = {'W', 'S', 'E', 'G'};
+constexpr uint16_t SEGMENT_VERSION = 1;
+constexpr size_t STATION_NAME_LEN = 32;
+constexpr uint8_t COLUMN_TIMESTAMP = 0xFF;
+
+enum Codec : uint8_t { CODEC_RAW = 0, CODEC_ZLIB = 1 };
+
+struct SegmentHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t columnCount;
+  uint32_t rows;
+  uint32_t reserved;
+  int64_t tMin;
+  int64_t tMax;
+  char station[STATION_NAME_LEN];
+};
+
+struct ColumnEntry {
+  uint8_t id;  // Channel o COLUMN_TIMESTAMP
+  uint8_t codec;
+  uint16_t reserved;
+  uint32_t rawSize;     // bytes tras la codificación, antes de zlib
+  uint32_t storedSize;  // bytes en el fichero
+  uint32_t count;       // valores no nulos
+  uint64_t offset;
+  double sum;
+  float min;
+  float max;
+};
+
+static_assert(sizeof(SegmentHeader) == 64, "cabecera WSEG");
+static_assert(sizeof(ColumnEntry) == 40, "entrada de columna WSEG");
+
+enum class Aggregate : uint8_t { MEAN, MIN, MAX, LAST, COUNT };
+
+inline bool parseAggregate(const char* name, Aggregate& out) {
+  static const struct {
+    const char* name;
+    Aggregate value;
+  } NAMES[] = {{"mean", Aggregate::MEAN}, {"min", Aggregate::MIN}, {"max", Aggregate::MAX},
+               {"last", Aggregate::LAST}, {"count", Aggregate::COUNT}};
+  for (const auto& n : NAMES) {
+    if (strcmp(name, n.name) == 0) {
+      out = n.value;
+      return true;
+    }
+  }
+  return false;
+}
+
+struct Options {
+  uint32_t segmentRows = 4096;
+  uint32_t sealAgeMs = 60 * 60 * 1000;
+};
+
+struct Stats {
+  uint64_t rowsAppended = 0;
+  uint64_t rowsSealed = 0;  // tras fusionar duplicados
+  uint64_t segmentsSealed = 0;
+  uint64_t rawBytes = 0;  // 8 + 4 * CHANNEL_COUNT por fila sellada
+  uint64_t storedBytes = 0;
+  uint64_t writeErrors = 0;
+};
+
+struct QueryStats {
+  uint32_t segmentsScanned = 0;
+  uint32_t segmentsFromSummary = 0;  // resueltos sin descomprimir
+  uint64_t bytesDecoded = 0;
+  uint64_t rowsScanned = 0;
+};
+
+// =============================================================
+// === Codificación de columnas ===
+// =============================================================
+inline uint32_t floatBits(float v) {
+  if (isnan(v)) return 0x7FC00000u;  // un único NaN: los nulos comprimen igual
+  uint32_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  return bits;
+}
+
+inline float bitsFloat(uint32_t bits) {
+  float v;
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+inline void encodeTimestamps(const std::vector<Reading>& rows, std::vector<uint8_t>& out) {
+  out.clear();
+  int64_t previous = 0;
+  for (const Reading& r : rows) {
+    const int64_t delta = r.timestampMs - previous;
+    previous = r.timestampMs;
+    uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+    while (zigzag >= 0x80) {
+      out.push_back((uint8_t)(zigzag | 0x80));
+      zigzag >>= 7;
+    }
+    out.push_back((uint8_t)zigzag);
+  }
+}
+
+inline bool decodeTimestamps(const uint8_t* in, size_t len, uint32_t rows, int64_t* out) {
+  const uint8_t* end = in + len;
+  int64_t previous = 0;
+  for (uint32_t i = 0; i < rows; i++) {
+    uint64_t zigzag = 0;
+    for (unsigned shift = 0;; shift += 7) {
+      if (in >= end || shift > 63) return false;
+      const uint8_t b = *in++;
+      zigzag |= (uint64_t)(b & 0x7F) << shift;
+      if (!(b & 0x80)) break;
+    }
+    previous += (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+    out[i] = previous;
+  }
+  return in == end;
+}
+
+inline void encodeChannel(const std::vector<Reading>& rows, size_t channel, std::vector<uint8_t>& out) {
+  const size_t n = rows.size();
+  out.assign(n * 4, 0);
+  uint32_t previous = 0;
+  for (size_t i = 0; i < n; i++) {
+    const uint32_t bits = floatBits(rows[i].values[channel]);
+    const uint32_t x = bits ^ previous;
+    previous = bits;
+    out[i] = (uint8_t)x;
+    out[n + i] = (uint8_t)(x >> 8);
+    out[2 * n + i] = (uint8_t)(x >> 16);
+    out[3 * n + i] = (uint8_t)(x >> 24);
+  }
+}
+
+inline void decodeChannel(const uint8_t* in, uint32_t rows, float* out) {
+  uint32_t previous = 0;
+  for (uint32_t i = 0; i < rows; i++) {
+    const uint32_t x = (uint32_t)in[i] | (uint32_t)in[rows + i] << 8 | (uint32_t)in[2 * rows + i] << 16 |
+                       (uint32_t)in[3 * rows + i] << 24;
+    previous ^= x;
+    out[i] = bitsFloat(previous);
+  }
+}
+
+// Ordena por timestamp y fusiona las lecturas con el mismo instante: la
+// posterior manda, pero sus nulos no borran canales (las variantes por
+// sensor llegan como mensajes separados con el mismo timestamp).
+inline void sortAndMerge(std::vector<Reading>& rows) {
+  std::stable_sort(rows.begin(), rows.end(),
+                   [](const Reading& a, const Reading& b) { return a.timestampMs < b.timestampMs; });
+  size_t out = 0;
+  for (size_t i = 0; i < rows.size(); i++) {
+    if (out > 0 && rows[out - 1].timestampMs == rows[i].timestampMs) {
+      for (size_t c = 0; c < CHANNEL_COUNT; c++) {
+        if (!isnan(rows[i].values[c])) rows[out - 1].values[c] = rows[i].values[c];
+      }
+    } else {
+      rows[out++] = rows[i];
+    }
+  }
+  rows.resize(out);
+}
+
+// =============================================================
+// === Segmento sellado (mmap) ===
+// =============================================================
+class MappedSegment {
+ public:
+  static std::unique_ptr<MappedSegment> open(const std::string& path, std::string& error) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      error = path + ": " + strerror(errno);
+      return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SegmentHeader)) {
+      ::close(fd);
+      error = path + ": segmento truncado";
+      return nullptr;
+    }
+    void* base = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+      error = path + ": mmap: " + strerror(errno);
+      return nullptr;
+    }
+    std::unique_ptr<MappedSegment> segment(new MappedSegment((const uint8_t*)base, (size_t)st.st_size));
+    if (!segment->validate()) {
+      error = path + ": no es un segmento WSEG v1 válido";
+      return nullptr;
+    }
+    return segment;
+  }
+
+  ~MappedSegment() { munmap((void*)base_, size_); }
+  MappedSegment(const MappedSegment&) = delete;
+  MappedSegment& operator=(const MappedSegment&) = delete;
+
+  const SegmentHeader& header() const { return *(const SegmentHeader*)base_; }
+  std::string station() const { return std::string(header().station, strnlen(header().station, STATION_NAME_LEN)); }
+
+  const ColumnEntry* column(uint8_t id) const {
+    const ColumnEntry* entries = (const ColumnEntry*)(base_ + sizeof(SegmentHeader));
+    for (uint16_t i = 0; i < header().columnCount; i++) {
+      if (entries[i].id == id) return &entries[i];
+    }
+    return nullptr;
+  }
+
+  // Descodifica una columna completa en `scratch` (reutilizable)
+  bool readColumn(const ColumnEntry& entry, std::vector<uint8_t>& scratch) const {
+    const uint8_t* stored = base_ + entry.offset;
+    scratch.resize(entry.rawSize);
+    if (entry.codec == CODEC_RAW) {
+      if (entry.storedSize != entry.rawSize) return false;
+      memcpy(scratch.data(), stored, entry.rawSize);
+      return true;
+    }
+    uLongf rawLen = entry.rawSize;
+    return uncompress(scratch.data(), &rawLen, stored, entry.storedSize) == Z_OK && rawLen == entry.rawSize;
+  }
+
+ private:
+  MappedSegment(const uint8_t* base, size_t size) : base_(base), size_(size) {}
+
+  bool validate() const {
+    const SegmentHeader& h = header();
+    if (memcmp(h.magic, SEGMENT_MAGIC, 4) != 0 || h.version != SEGMENT_VERSION || h.rows == 0) return false;
+    const size_t tableEnd = sizeof(SegmentHeader) + (size_t)h.columnCount * sizeof(ColumnEntry);
+    if (tableEnd > size_) return false;
+    const ColumnEntry* entries = (const ColumnEntry*)(base_ + sizeof(SegmentHeader));
+    bool haveTimestamps = false;
+    for (uint16_t i = 0; i < h.columnCount; i++) {
+      if (entries[i].offset < tableEnd || entries[i].offset + entries[i].storedSize > size_) return false;
+      haveTimestamps |= entries[i].id == COLUMN_TIMESTAMP;
+    }
+    return haveTimestamps;
+  }
+
+  const uint8_t* base_;
+  size_t size_;
+};
+
+// =============================================================
+// === Almacén ===
+// =============================================================
+class ColumnStore {
+ public:
+  explicit ColumnStore(const Options& options = Options()) : options_(options) {}
+
+  // Abre (o crea) el directorio y mapea los segmentos que ya tenga
+  bool open(const std::string& dir) {
+    dir_ = dir;
+    if (mkdir(dir_.c_str(), 0755) != 0 && errno != EEXIST) {
+      error_ = dir_ + ": " + strerror(errno);
+      return false;
+    }
+    DIR* root = opendir(dir_.c_str());
+    if (!root) {
+      error_ = dir_ + ": " + strerror(errno);
+      return false;
+    }
+    while (dirent* entry = readdir(root)) {
+      if (entry->d_name[0] == '.') continue;
+      const std::string stationDir = dir_ + "/" + entry->d_name;
+      DIR* files = opendir(stationDir.c_str());
+      if (!files) continue;
+      while (dirent* file = readdir(files)) {
+        const size_t len = strlen(file->d_name);
+        if (len < 5 || strcmp(file->d_name + len - 5, ".wseg") != 0) continue;
+        std::string error;
+        std::unique_ptr<MappedSegment> segment = MappedSegment::open(stationDir + "/" + file->d_name, error);
+        if (segment) {
+          addSegment(std::move(segment));
+        } else {
+          fprintf(stderr, "[store] %s\n", error.c_str());
+        }
+      }
+      closedir(files);
+    }
+    closedir(root);
+    return true;
+  }
+
+  void append(std::string_view station, const Reading& reading, uint64_t nowMs) {
+    // Clave reutilizada: sin reservar memoria por mensaje una vez vista la estación
+    key_.assign(station.data(), std::min(station.size(), STATION_NAME_LEN - 1));
+    auto it = open_.find(key_);
+    if (it == open_.end()) {
+      it = open_.emplace(key_, OpenSegment()).first;
+      it->second.rows.reserve(options_.segmentRows);
+    }
+    OpenSegment& segment = it->second;
+    if (segment.rows.empty()) {
+      segment.openedAtMs = nowMs;
+      segment.tMin = segment.tMax = reading.timestampMs;
+    }
+    segment.tMin = std::min(segment.tMin, reading.timestampMs);
+    segment.tMax = std::max(segment.tMax, reading.timestampMs);
+    segment.rows.push_back(reading);
+    stats_.rowsAppended++;
+    if (segment.rows.size() >= options_.segmentRows) seal(it->first, segment);
+  }
+
+  // Sella los segmentos abiertos que han superado sealAgeMs
+  void sealIdle(uint64_t nowMs) {
+    for (auto& entry : open_) {
+      OpenSegment& segment = entry.second;
+      if (!segment.rows.empty() && nowMs - segment.openedAtMs >= options_.sealAgeMs) seal(entry.first, segment);
+    }
+  }
+
+  void flush() {
+    for (auto& entry : open_) {
+      if (!entry.second.rows.empty()) seal(entry.first, entry.second);
+    }
+  }
+
+  std::vector<std::string> stations() const {
+    std::vector<std::string> names;
+    for (const auto& entry : sealed_) names.push_back(entry.first);
+    for (const auto& entry : open_) {
+      if (!sealed_.count(entry.first) && !entry.second.rows.empty()) names.push_back(entry.first);
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+  }
+
+  // Lecturas de `station` en [fromMs, toMs). Con stepMs = 0 devuelve las
+  // filas tal cual; si no, un valor por intervalo de stepMs (alineado a
+  // epoch) con la agregación pedida, y solo los intervalos con datos. Los
+  // canales fuera de channelMask (bit = Channel) salen como NaN. Incluye el
+  // segmento abierto. Con COUNT cada canal trae el número de valores.
+  bool query(const std::string& station, int64_t fromMs, int64_t toMs, uint32_t channelMask, int64_t stepMs,
+             Aggregate aggregate, std::vector<Reading>& out, QueryStats* queryStats = nullptr) {
+    out.clear();
+    QueryStats local;
+    QueryStats& qs = queryStats ? *queryStats : local;
+    qs = QueryStats();
+    if (fromMs >= toMs || stepMs < 0) return false;
+
+    std::vector<Reading> rows;
+    std::map<int64_t, Bucket> buckets;
+    auto openIt = open_.find(station);
+    const OpenSegment* openSegment = openIt != open_.end() && !openIt->second.rows.empty() ? &openIt->second : nullptr;
+    auto sealedIt = sealed_.find(station);
+    if (sealedIt != sealed_.end()) {
+      const auto& list = sealedIt->second;
+      for (size_t i = 0; i < list.size(); i++) {
+        const MappedSegment* segment = list[i].get();
+        const SegmentHeader& h = segment->header();
+        if (h.tMax < fromMs || h.tMin >= toMs) continue;
+        qs.segmentsScanned++;
+        if (stepMs > 0 && summaryAnswers(list, i, openSegment, fromMs, toMs, stepMs, aggregate)) {
+          addSummary(*segment, channelMask, buckets[floorDiv(h.tMin, stepMs)]);
+          qs.segmentsFromSummary++;
+          continue;
+        }
+        if (!decodeRows(*segment, fromMs, toMs, channelMask, rows, qs)) {
+          error_ = "segmento de " + station + " ilegible";
+          return false;
+        }
+      }
+    }
+    if (openSegment) {
+      for (const Reading& r : openSegment->rows) {
+        if (r.timestampMs < fromMs || r.timestampMs >= toMs) continue;
+        rows.push_back(r);
+        Reading& copy = rows.back();
+        for (size_t c = 0; c < CHANNEL_COUNT; c++) {
+          if (!(channelMask & (1u << c))) copy.values[c] = NAN;
+        }
+        qs.rowsScanned++;
+      }
+    }
+    sortAndMerge(rows);
+
+    if (stepMs == 0) {
+      out.swap(rows);
+      return true;
+    }
+    for (const Reading& r : rows) {
+      Bucket& bucket = buckets[floorDiv(r.timestampMs, stepMs)];
+      for (size_t c = 0; c < CHANNEL_COUNT; c++) bucket.add(c, r.timestampMs, r.values[c]);
+    }
+    out.reserve(buckets.size());
+    for (const auto& entry : buckets) {
+      Reading r;
+      r.timestampMs = entry.first * stepMs;
+      for (size_t c = 0; c < CHANNEL_COUNT; c++) r.values[c] = entry.second.result(c, aggregate);
+      out.push_back(r);
+    }
+    return true;
+  }
+
+  const Stats& stats() const { return stats_; }
+  const std::string& lastError() const { return error_; }
+  size_t openRows() const {
+    size_t n = 0;
+    for (const auto& entry : open_) n += entry.second.rows.size();
+    return n;
+  }
+
+ private:
+  struct OpenSegment {
+    std::vector<Reading> rows;
+    uint64_t openedAtMs = 0;
+    int64_t tMin = 0;
+    int64_t tMax = 0;
+  };
+
+  struct Bucket {
+    double sum[CHANNEL_COUNT] = {};
+    uint32_t count[CHANNEL_COUNT] = {};
+    float min[CHANNEL_COUNT] = {NAN, NAN, NAN, NAN, NAN, NAN, NAN};
+    float max[CHANNEL_COUNT] = {NAN, NAN, NAN, NAN, NAN, NAN, NAN};
+    float last[CHANNEL_COUNT] = {NAN, NAN, NAN, NAN, NAN, NAN, NAN};
+    int64_t lastTs[CHANNEL_COUNT] = {INT64_MIN, INT64_MIN, INT64_MIN, INT64_MIN, INT64_MIN, INT64_MIN, INT64_MIN};
+
+    void add(size_t c, int64_t ts, float v) {
+      if (isnan(v)) return;
+      sum[c] += v;
+      count[c]++;
+      if (!(v >= min[c])) min[c] = v;
+      if (!(v <= max[c])) max[c] = v;
+      if (ts >= lastTs[c]) {
+        lastTs[c] = ts;
+        last[c] = v;
+      }
+    }
+
+    float result(size_t c, Aggregate aggregate) const {
+      switch (aggregate) {
+        case Aggregate::MEAN: return count[c] ? (float)(sum[c] / count[c]) : NAN;
+        case Aggregate::MIN: return min[c];
+        case Aggregate::MAX: return max[c];
+        case Aggregate::LAST: return last[c];
+        case Aggregate::COUNT: return (float)count[c];
+      }
+      return NAN;
+    }
+  };
+
+  static int64_t floorDiv(int64_t a, int64_t b) { return a / b - (a % b != 0 && (a < 0) != (b < 0)); }
+
+  // El resumen de la columna basta si el segmento entero cae en un único
+  // intervalo dentro del rango y ningún otro segmento (ni el abierto) se
+  // solapa con él: entonces no hay instantes repetidos que fusionar. LAST
+  // necesita las filas.
+  using SegmentList = std::vector<std::unique_ptr<MappedSegment>>;
+  static bool summaryAnswers(const SegmentList& list, size_t index, const OpenSegment* openSegment, int64_t fromMs,
+                             int64_t toMs, int64_t stepMs, Aggregate aggregate) {
+    const SegmentHeader& h = list[index]->header();
+    if (aggregate == Aggregate::LAST || h.tMin < fromMs || h.tMax >= toMs ||
+        floorDiv(h.tMin, stepMs) != floorDiv(h.tMax, stepMs)) {
+      return false;
+    }
+    if (openSegment && openSegment->tMin <= h.tMax && openSegment->tMax >= h.tMin) return false;
+    // Lista ordenada por tMin: basta mirar hacia atrás hasta el primero que
+    // empieza antes (su tMax puede llegar lejos) y hacia delante el siguiente
+    for (size_t j = 0; j < index; j++) {
+      if (list[j]->header().tMax >= h.tMin) return false;
+    }
+    return index + 1 >= list.size() || list[index + 1]->header().tMin > h.tMax;
+  }
+
+  static void addSummary(const MappedSegment& segment, uint32_t channelMask, Bucket& bucket) {
+    for (size_t c = 0; c < CHANNEL_COUNT; c++) {
+      const ColumnEntry* entry = (channelMask & (1u << c)) ? segment.column((uint8_t)c) : nullptr;
+      if (!entry || entry->count == 0) continue;
+      bucket.sum[c] += entry->sum;
+      bucket.count[c] += entry->count;
+      if (!(entry->min >= bucket.min[c])) bucket.min[c] = entry->min;
+      if (!(entry->max <= bucket.max[c])) bucket.max[c] = entry->max;
+    }
+  }
+
+  bool decodeRows(const MappedSegment& segment, int64_t fromMs, int64_t toMs, uint32_t channelMask,
+                  std::vector<Reading>& rows, QueryStats& qs) {
+    const uint32_t n = segment.header().rows;
+    const ColumnEntry* tsEntry = segment.column(COLUMN_TIMESTAMP);
+    timestamps_.resize(n);
+    if (!tsEntry || !segment.readColumn(*tsEntry, scratch_) ||
+        !decodeTimestamps(scratch_.data(), scratch_.size(), n, timestamps_.data())) {
+      return false;
+    }
+    qs.bytesDecoded += tsEntry->rawSize;
+    // Filas ordenadas: el rango es un intervalo contiguo
+    const uint32_t first = (uint32_t)(std::lower_bound(timestamps_.begin(), timestamps_.end(), fromMs) - timestamps_.begin());
+    const uint32_t last = (uint32_t)(std::lower_bound(timestamps_.begin(), timestamps_.end(), toMs) - timestamps_.begin());
+    if (first >= last) return true;
+    const size_t base = rows.size();
+    rows.resize(base + (last - first));
+    for (uint32_t i = first; i < last; i++) rows[base + i - first].timestampMs = timestamps_[i];
+    values_.resize(n);
+    for (size_t c = 0; c < CHANNEL_COUNT; c++) {
+      if (!(channelMask & (1u << c))) continue;
+      const ColumnEntry* entry = segment.column((uint8_t)c);
+      if (!entry) continue;
+      if (entry->rawSize != (size_t)n * 4 || !segment.readColumn(*entry, scratch_)) return false;
+      decodeChannel(scratch_.data(), n, values_.data());
+      qs.bytesDecoded += entry->rawSize;
+      for (uint32_t i = first; i < last; i++) rows[base + i - first].values[c] = values_[i];
+    }
+    qs.rowsScanned += last - first;
+    return true;
+  }
+
+  void seal(const std::string& station, OpenSegment& segment) {
+    std::vector<Reading>& rows = segment.rows;
+    sortAndMerge(rows);
+    const uint32_t n = (uint32_t)rows.size();
+
+    SegmentHeader header = {};
+    memcpy(header.magic, SEGMENT_MAGIC, 4);
+    header.version = SEGMENT_VERSION;
+    header.columnCount = (uint16_t)(CHANNEL_COUNT + 1);
+    header.rows = n;
+    header.tMin = rows.front().timestampMs;
+    header.tMax = rows.back().timestampMs;
+    strlcpyStation(header.station, station);
+
+    ColumnEntry entries[CHANNEL_COUNT + 1] = {};
+    std::vector<uint8_t> file(sizeof(header) + sizeof(entries));
+    for (size_t col = 0; col <= CHANNEL_COUNT; col++) {
+      ColumnEntry& entry = entries[col];
+      if (col == CHANNEL_COUNT) {
+        entry.id = COLUMN_TIMESTAMP;
+        encodeTimestamps(rows, encoded_);
+        entry.count = n;
+      } else {
+        entry.id = (uint8_t)col;
+        encodeChannel(rows, col, encoded_);
+        summarize(rows, col, entry);
+      }
+      entry.rawSize = (uint32_t)encoded_.size();
+      entry.offset = file.size();
+      uLongf bound = compressBound(encoded_.size());
+      file.resize(entry.offset + bound);
+      if (compress2(file.data() + entry.offset, &bound, encoded_.data(), encoded_.size(), Z_BEST_SPEED) == Z_OK &&
+          bound < encoded_.size()) {
+        entry.codec = CODEC_ZLIB;
+        entry.storedSize = (uint32_t)bound;
+      } else {
+        entry.codec = CODEC_RAW;
+        entry.storedSize = entry.rawSize;
+        memcpy(file.data() + entry.offset, encoded_.data(), encoded_.size());
+      }
+      file.resize(entry.offset + entry.storedSize);
+    }
+    memcpy(file.data(), &header, sizeof(header));
+    memcpy(file.data() + sizeof(header), entries, sizeof(entries));
+
+    const std::string path = writeSegment(station, header, file);
+    stats_.rowsSealed += n;
+    stats_.rawBytes += (uint64_t)n * (8 + 4 * CHANNEL_COUNT);
+    rows.clear();
+    if (path.empty()) {
+      stats_.writeErrors++;
+      fprintf(stderr, "[store] %s\n", error_.c_str());
+      return;
+    }
+    stats_.segmentsSealed++;
+    stats_.storedBytes += file.size();
+    std::unique_ptr<MappedSegment> mapped = MappedSegment::open(path, error_);
+    if (mapped) addSegment(std::move(mapped));
+  }
+
+  static void summarize(const std::vector<Reading>& rows, size_t channel, ColumnEntry& entry) {
+    entry.min = NAN;
+    entry.max = NAN;
+    for (const Reading& r : rows) {
+      const float v = r.values[channel];
+      if (isnan(v)) continue;
+      entry.sum += v;
+      entry.count++;
+      if (!(v >= entry.min)) entry.min = v;
+      if (!(v <= entry.max)) entry.max = v;
+    }
+  }
+
+  static void strlcpyStation(char* dst, const std::string& station) {
+    const size_t n = std::min(station.size(), STATION_NAME_LEN - 1);
+    memcpy(dst, station.data(), n);
+    dst[n] = '\0';
+  }
+
+  // Nombre de directorio sin '/', '.' iniciales ni caracteres de control
+  static std::string directoryName(const std::string& station) {
+    std::string name;
+    for (char c : station) {
+      const bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' ||
+                        c == '-' || (c == '.' && !name.empty());
+      name += safe ? c : '_';
+    }
+    return name.empty() ? std::string("_") : name;
+  }
+
+  // Escribe a .tmp, fsync y rename: un segmento a medias nunca tiene el
+  // nombre final y open() no lo verá tras una caída
+  std::string writeSegment(const std::string& station, const SegmentHeader& header, const std::vector<uint8_t>& file) {
+    const std::string stationDir = dir_ + "/" + directoryName(station);
+    if (mkdir(stationDir.c_str(), 0755) != 0 && errno != EEXIST) {
+      error_ = stationDir + ": " + strerror(errno);
+      return std::string();
+    }
+    char name[96];
+    snprintf(name, sizeof(name), "/%lld-%lld-%d-%u.wseg", (long long)header.tMin, (long long)header.tMax,
+             (int)getpid(), ++sequence_);
+    const std::string path = stationDir + name;
+    const std::string tmp = path + ".tmp";
+    const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+      error_ = tmp + ": " + strerror(errno);
+      return std::string();
+    }
+    size_t written = 0;
+    while (written < file.size()) {
+      const ssize_t n = ::write(fd, file.data() + written, file.size() - written);
+      if (n <= 0) {
+        if (n < 0 && errno == EINTR) continue;
+        break;
+      }
+      written += (size_t)n;
+    }
+    const bool ok = written == file.size() && ::fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+      error_ = path + ": " + strerror(errno);
+      unlink(tmp.c_str());
+      return std::string();
+    }
+    return path;
+  }
+
+  void addSegment(std::unique_ptr<MappedSegment> segment) {
+    auto& list = sealed_[segment->station()];
+    list.push_back(std::move(segment));
+    std::sort(list.begin(), list.end(), [](const std::unique_ptr<MappedSegment>& a, const std::unique_ptr<MappedSegment>& b) {
+      return a->header().tMin < b->header().tMin;
+    });
+  }
+
+  Options options_;
+  std::string dir_;
+  std::string error_;
+  std::unordered_map<std::string, OpenSegment> open_;
+  std::map<std::string, std::vector<std::unique_ptr<MappedSegment>>> sealed_;
+  Stats stats_;
+  uint32_t sequence_ = 0;
+  std::string key_;
+  // Búferes reutilizados entre sellados y consultas
+  std::vector<uint8_t> encoded_;
+  std::vector<uint8_t> scratch_;
+  std::vector<int64_t> timestamps_;
+  std::vector<float> values_;
+};
+
+}  // namespace columnstore
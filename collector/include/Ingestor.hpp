@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+
+#include <string_view>
+
+#include "ColumnStore.hpp"
+#include "PayloadParser.hpp"
+
+// =============================================================
+// === Ingesta: topic -> parser -> almacén ===
+// =============================================================
+// Decide por el sufijo del topic qué hacer con cada mensaje:
+//   .../batch                      lote (BatchPayload.hpp)
+//   .../diag /boot /cbor           ignorados (no son lecturas)
+//   .../comandos /respuestas
+//   resto                          json-general o una variante por sensor
+// El texto de conexión ("Estación MQTT conectada...") cuenta como not_json.
+struct IngestMetrics {
+  uint64_t messages = 0;
+  uint64_t rows = 0;
+  uint64_t ignored = 0;
+  uint64_t rejected[5] = {};  // por ParseStatus
+};
+
+class Ingestor {
+ public:
+  Ingestor(columnstore::ColumnStore& store, bool predictKeys = true) : store_(store), parser_(predictKeys) {}
+
+  void onMessage(std::string_view topic, std::string_view payload, uint64_t nowMs) {
+    metrics_.messages++;
+    bool batch = false;
+    if (endsWith(topic, "/batch")) {
+      batch = true;
+    } else if (endsWith(topic, "/diag") || endsWith(topic, "/boot") || endsWith(topic, "/cbor") ||
+               endsWith(topic, "/comandos") || endsWith(topic, "/respuestas")) {
+      metrics_.ignored++;
+      return;
+    }
+    const ParseStatus status =
+        parser_.parse(payload.data(), payload.size(), batch, [&](std::string_view station, const Reading& reading) {
+          store_.append(station, reading, nowMs);
+          metrics_.rows++;
+        });
+    if (status != ParseStatus::OK) metrics_.rejected[(int)status]++;
+  }
+
+  const IngestMetrics& metrics() const { return metrics_; }
+  const PayloadParser& parser() const { return parser_; }
+
+ private:
+  static bool endsWith(std::string_view s, std::string_view suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+  }
+
+  columnstore::ColumnStore& store_;
+  PayloadParser parser_;
+  IngestMetrics metrics_;
+};
@@ -0,0 +1,122 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string_view>
+
+// =============================================================
+// === Codificación de paquetes MQTT 3.1.1 ===
+// =============================================================
+// Lo común al suscriptor del colector y al generador de carga. Los búferes
+// pueden ser std::string o std::vector<uint8_t>; solo se añade al final.
+namespace mqttcodec {
+
+enum PacketType : uint8_t {
+  CONNECT = 0x10,
+  CONNACK = 0x20,
+  PUBLISH = 0x30,
+  PUBACK = 0x40,
+  SUBSCRIBE = 0x82,  // con los flags obligatorios
+  SUBACK = 0x90,
+  PINGREQ = 0xC0,
+  PINGRESP = 0xD0,
+  DISCONNECT = 0xE0,
+};
+
+template <typename Buffer>
+void appendByte(Buffer& out, uint8_t b) {
+  out.push_back((typename Buffer::value_type)b);
+}
+
+template <typename Buffer>
+void appendBytes(Buffer& out, const void* data, size_t len) {
+  const auto* p = (const typename Buffer::value_type*)data;
+  out.insert(out.end(), p, p + len);
+}
+
+template <typename Buffer>
+void appendRemainingLength(Buffer& out, size_t length) {
+  do {
+    uint8_t b = length & 0x7F;
+    length >>= 7;
+    if (length) b |= 0x80;
+    appendByte(out, b);
+  } while (length);
+}
+
+template <typename Buffer>
+void appendString(Buffer& out, std::string_view s) {
+  appendByte(out, (uint8_t)(s.size() >> 8));
+  appendByte(out, (uint8_t)s.size());
+  appendBytes(out, s.data(), s.size());
+}
+
+// CONNECT con clean session, sin will ni credenciales
+template <typename Buffer>
+void appendConnect(Buffer& out, std::string_view clientId, uint16_t keepAliveS) {
+  static const uint8_t VARIABLE_HEADER[] = {0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0x02};
+  appendByte(out, CONNECT);
+  appendRemainingLength(out, sizeof(VARIABLE_HEADER) + 2 + 2 + clientId.size());
+  appendBytes(out, VARIABLE_HEADER, sizeof(VARIABLE_HEADER));
+  appendByte(out, (uint8_t)(keepAliveS >> 8));
+  appendByte(out, (uint8_t)keepAliveS);
+  appendString(out, clientId);
+}
+
+// SUBSCRIBE de un solo filtro
+template <typename Buffer>
+void appendSubscribe(Buffer& out, uint16_t packetId, std::string_view filter, uint8_t qos) {
+  appendByte(out, SUBSCRIBE);
+  appendRemainingLength(out, 2 + 2 + filter.size() + 1);
+  appendByte(out, (uint8_t)(packetId >> 8));
+  appendByte(out, (uint8_t)packetId);
+  appendString(out, filter);
+  appendByte(out, qos);
+}
+
+// packetId se ignora con QoS 0
+template <typename Buffer>
+void appendPublish(Buffer& out, std::string_view topic, std::string_view payload, uint8_t qos, uint16_t packetId,
+                   bool retain = false) {
+  appendByte(out, (uint8_t)(PUBLISH | (qos << 1) | (retain ? 1 : 0)));
+  appendRemainingLength(out, 2 + topic.size() + (qos ? 2 : 0) + payload.size());
+  appendString(out, topic);
+  if (qos) {
+    appendByte(out, (uint8_t)(packetId >> 8));
+    appendByte(out, (uint8_t)packetId);
+  }
+  appendBytes(out, payload.data(), payload.size());
+}
+
+// PUBACK, CONNACK, SUBACK... de dos bytes de cuerpo con un id
+template <typename Buffer>
+void appendAck(Buffer& out, uint8_t type, uint16_t packetId) {
+  const uint8_t ack[4] = {type, 0x02, (uint8_t)(packetId >> 8), (uint8_t)packetId};
+  appendBytes(out, ack, sizeof(ack));
+}
+
+// Cabecera fija del paquete al principio de `data`:
+//   1 = completo (type, headerLen y bodyLen válidos), 0 = faltan bytes,
+//  -1 = longitud inválida o mayor que maxPacket
+inline int frame(const uint8_t* data, size_t available, size_t maxPacket, uint8_t& type, size_t& headerLen,
+                 size_t& bodyLen) {
+  if (available < 2) return 0;
+  type = data[0];
+  size_t length = 0;
+  for (size_t i = 0; i < 4; i++) {
+    if (1 + i >= available) return 0;
+    const uint8_t b = data[1 + i];
+    length |= (size_t)(b & 0x7F) << (7 * i);
+    if (!(b & 0x80)) {
+      headerLen = 2 + i;
+      bodyLen = length;
+      if (length > maxPacket) return -1;
+      return available >= headerLen + bodyLen ? 1 : 0;
+    }
+  }
+  return -1;
+}
+
+inline uint16_t readPacketId(const uint8_t* p) { return (uint16_t)(p[0] << 8 | p[1]); }
+
+}  // namespace mqttcodec
@@ -0,0 +1,281 @@
+#pragma once
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MqttCodec.hpp"
+
+// =============================================================
+// === Suscriptor MQTT 3.1.1 mínimo ===
+// =============================================================
+// Solo lo que necesita el colector: CONNECT, SUBSCRIBE a un filtro, recibir
+// PUBLISH (QoS 0/1) y PINGREQ. Sin hilos ni colas propias: poll() lee lo que
+// haya en el socket (hasta 64 KB por lectura), entrega cada PUBLISH con
+// vistas sobre el propio búfer de recepción (sin copiar topic ni payload) y
+// al final responde todos los PUBACK pendientes en una sola escritura.
+//
+// Un proceso atiende un núcleo. Para repartir la carga entre varios, cada
+// colector se suscribe a una suscripción compartida de Mosquitto 2.x
+// ("$share/colectores/sensors/#") con un client id distinto y el broker
+// reparte los mensajes entre ellos.
+struct MqttSubscriberConfig {
+  std::string host = "127.0.0.1";
+  uint16_t port = 1883;
+  std::string clientId = "collector";
+  std::string topic = "sensors/#";
+  uint8_t qos = 1;
+  uint16_t keepAliveS = 30;
+  uint32_t connectTimeoutMs = 5000;
+};
+
+struct MqttSubscriberMetrics {
+  uint64_t publishes = 0;
+  uint64_t bytes = 0;
+  uint64_t reads = 0;
+  uint64_t acks = 0;  // PUBACK enviados
+};
+
+class MqttSubscriber {
+ public:
+  static constexpr size_t READ_CHUNK = 64 * 1024;
+  static constexpr size_t MAX_PACKET = 1024 * 1024;
+
+  explicit MqttSubscriber(const MqttSubscriberConfig& config) : config_(config) {}
+  ~MqttSubscriber() { close(); }
+  MqttSubscriber(const MqttSubscriber&) = delete;
+  MqttSubscriber& operator=(const MqttSubscriber&) = delete;
+
+  // Conecta, espera CONNACK, se suscribe y espera SUBACK. Bloqueante hasta
+  // connectTimeoutMs.
+  bool connect() {
+    close();
+    if (!openSocket()) return false;
+
+    std::vector<uint8_t> packet;
+    mqttcodec::appendConnect(packet, config_.clientId, config_.keepAliveS);
+    if (!sendAll(packet.data(), packet.size())) return false;
+    if (!awaitPacket(mqttcodec::CONNACK)) return fail("sin CONNACK");
+    if (rxLen_ < 4 || rx_[3] != 0) return fail("CONNACK rechazado");
+    consume(4);
+
+    packet.clear();
+    mqttcodec::appendSubscribe(packet, 1, config_.topic, config_.qos);
+    if (!sendAll(packet.data(), packet.size())) return false;
+    if (!awaitPacket(mqttcodec::SUBACK)) return fail("sin SUBACK");
+    if (rxLen_ < 5 || rx_[4] == 0x80) return fail("suscripción rechazada");
+    consume(5);
+    return true;
+  }
+
+  bool connected() const { return fd_ >= 0; }
+
+  void close() {
+    if (fd_ >= 0) {
+      static const uint8_t DISCONNECT[] = {mqttcodec::DISCONNECT, 0x00};
+      (void)::send(fd_, DISCONNECT, sizeof(DISCONNECT), MSG_NOSIGNAL);
+      ::close(fd_);
+      fd_ = -1;
+    }
+    rxLen_ = 0;
+  }
+
+  // Espera hasta timeoutMs a que haya datos y entrega los PUBLISH completos
+  // con onPublish(topic, payload). Devuelve cuántos entregó, o -1 si la
+  // conexión se cerró (el llamante reconecta).
+  template <typename Callback>
+  int poll(int timeoutMs, Callback onPublish) {
+    if (fd_ < 0) return -1;
+    keepAlive();
+    pollfd pfd = {fd_, POLLIN, 0};
+    const int ready = ::poll(&pfd, 1, timeoutMs);
+    if (ready < 0) {
+      if (errno == EINTR) return 0;
+      fail(strerror(errno));
+      return -1;
+    }
+    if (ready == 0) return 0;
+
+    // El búfer solo crece: sin reservar ni rellenar memoria en cada lectura
+    if (rx_.size() < rxLen_ + READ_CHUNK) rx_.resize(rxLen_ + READ_CHUNK);
+    const ssize_t n = ::recv(fd_, rx_.data() + rxLen_, READ_CHUNK, 0);
+    if (n <= 0) {
+      if (n < 0 && (errno == EINTR || errno == EAGAIN)) return 0;
+      fail(n == 0 ? "conexión cerrada por el broker" : strerror(errno));
+      return -1;
+    }
+    rxLen_ += (size_t)n;
+    metrics_.reads++;
+    metrics_.bytes += (size_t)n;
+
+    int delivered = 0;
+    size_t at = 0;
+    acks_.clear();
+    for (;;) {
+      uint8_t type;
+      size_t headerLen, bodyLen;
+      const int state = frame(at, type, headerLen, bodyLen);
+      if (state < 0) {
+        fail("paquete MQTT mal formado");
+        return -1;
+      }
+      if (state == 0) break;
+      const uint8_t* body = rx_.data() + at + headerLen;
+      if ((type & 0xF0) == mqttcodec::PUBLISH) {
+        if (!dispatch(type, body, bodyLen, onPublish)) {
+          fail("PUBLISH mal formado");
+          return -1;
+        }
+        delivered++;
+      }
+      at += headerLen + bodyLen;
+    }
+    consume(at);
+    if (!acks_.empty()) {
+      metrics_.acks += acks_.size() / 4;
+      if (!sendAll(acks_.data(), acks_.size())) return -1;
+    }
+    return delivered;
+  }
+
+  const std::string& lastError() const { return error_; }
+  const MqttSubscriberMetrics& metrics() const { return metrics_; }
+
+ private:
+  static uint64_t nowMs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+  }
+
+  bool fail(const char* reason) {
+    error_ = reason;
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+    rxLen_ = 0;
+    return false;
+  }
+
+  bool openSocket() {
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    const std::string port = std::to_string(config_.port);
+    const int rc = getaddrinfo(config_.host.c_str(), port.c_str(), &hints, &result);
+    if (rc != 0) {
+      error_ = gai_strerror(rc);
+      return false;
+    }
+    for (addrinfo* ai = result; ai; ai = ai->ai_next) {
+      fd_ = ::socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+      if (fd_ < 0) continue;
+      if (::connect(fd_, ai->ai_addr, ai->ai_addrlen) == 0) break;
+      ::close(fd_);
+      fd_ = -1;
+    }
+    freeaddrinfo(result);
+    if (fd_ < 0) {
+      error_ = std::string("no se pudo conectar a ") + config_.host + ":" + port + ": " + strerror(errno);
+      return false;
+    }
+    const int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    const int rcvbuf = 1 << 20;
+    setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    lastSendMs_ = nowMs();
+    return true;
+  }
+
+  int frame(size_t at, uint8_t& type, size_t& headerLen, size_t& bodyLen) const {
+    return mqttcodec::frame(rx_.data() + at, rxLen_ - at, MAX_PACKET, type, headerLen, bodyLen);
+  }
+
+  template <typename Callback>
+  bool dispatch(uint8_t type, const uint8_t* body, size_t len, Callback& onPublish) {
+    if (len < 2) return false;
+    const size_t topicLen = (size_t)body[0] << 8 | body[1];
+    size_t at = 2 + topicLen;
+    const uint8_t qos = (type >> 1) & 0x03;
+    if (at + (qos ? 2 : 0) > len) return false;
+    if (qos > 0) {
+      // PUBACK (también para QoS 2 se confirma como QoS 1: el colector no
+      // pide QoS 2 y Mosquitto rebaja al máximo suscrito)
+      mqttcodec::appendAck(acks_, mqttcodec::PUBACK, mqttcodec::readPacketId(body + at));
+      at += 2;
+    }
+    metrics_.publishes++;
+    onPublish(std::string_view((const char*)body + 2, topicLen), std::string_view((const char*)body + at, len - at));
+    return true;
+  }
+
+  // Solo durante connect(): lee hasta tener un paquete del tipo pedido
+  bool awaitPacket(uint8_t type) {
+    const uint64_t deadline = nowMs() + config_.connectTimeoutMs;
+    for (;;) {
+      uint8_t got;
+      size_t headerLen, bodyLen;
+      if (frame(0, got, headerLen, bodyLen) > 0) return (got & 0xF0) == type;
+      const uint64_t now = nowMs();
+      if (now >= deadline) return false;
+      pollfd pfd = {fd_, POLLIN, 0};
+      if (::poll(&pfd, 1, (int)(deadline - now)) <= 0) return false;
+      uint8_t chunk[512];
+      const ssize_t n = ::recv(fd_, chunk, sizeof(chunk), 0);
+      if (n <= 0) return false;
+      if (rx_.size() < rxLen_ + (size_t)n) rx_.resize(rxLen_ + (size_t)n);
+      memcpy(rx_.data() + rxLen_, chunk, (size_t)n);
+      rxLen_ += (size_t)n;
+    }
+  }
+
+  void keepAlive() {
+    if (config_.keepAliveS == 0) return;
+    const uint64_t now = nowMs();
+    if (now - lastSendMs_ < (uint64_t)config_.keepAliveS * 500) return;
+    static const uint8_t PINGREQ[] = {mqttcodec::PINGREQ, 0x00};
+    sendAll(PINGREQ, sizeof(PINGREQ));
+  }
+
+  bool sendAll(const uint8_t* data, size_t len) {
+    while (len > 0) {
+      const ssize_t n = ::send(fd_, data, len, MSG_NOSIGNAL);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        return fail(strerror(errno));
+      }
+      data += n;
+      len -= (size_t)n;
+    }
+    lastSendMs_ = nowMs();
+    return true;
+  }
+
+  // Lo que quede es un paquete a medias: se mueve al principio
+  void consume(size_t n) {
+    memmove(rx_.data(), rx_.data() + n, rxLen_ - n);
+    rxLen_ -= n;
+  }
+
+  MqttSubscriberConfig config_;
+  int fd_ = -1;
+  std::vector<uint8_t> rx_;
+  size_t rxLen_ = 0;
+  std::vector<uint8_t> acks_;
+  uint64_t lastSendMs_ = 0;
+  std::string error_;
+  MqttSubscriberMetrics metrics_;
+};
@@ -0,0 +1,602 @@
+#pragma once
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// =============================================================
+// === Lectura decodificada ===
+// =============================================================
+// Canales de json/json-general; las variantes por sensor (json-aire,
+// json-viento...) traen solo uno y el resto queda en NaN, igual que un null.
+enum Channel : uint8_t {
+  CH_TEMPERATURE = 0,  // temperature_celsius
+  CH_HUMIDITY,         // humidity_percentage
+  CH_PRESSURE,         // atmospheric_pressure_hpa
+  CH_ALTITUDE,         // location.altitude_meters
+  CH_LIGHT,            // luz
+  CH_WIND,             // wind_speed
+  CH_AIR_QUALITY,      // air_quality_index
+};
+constexpr size_t CHANNEL_COUNT = 7;
+
+inline const char* channelName(Channel c) {
+  static const char* const NAMES[CHANNEL_COUNT] = {"temperature_celsius", "humidity_percentage",
+                                                   "atmospheric_pressure_hpa", "altitude_meters",
+                                                   "luz", "wind_speed", "air_quality_index"};
+  return c < CHANNEL_COUNT ? NAMES[c] : "";
+}
+
+struct Reading {
+  int64_t timestampMs = 0;
+  float values[CHANNEL_COUNT] = {NAN, NAN, NAN, NAN, NAN, NAN, NAN};
+};
+
+enum class ParseStatus : uint8_t {
+  OK = 0,
+  NOT_JSON,      // texto libre u otro formato (p. ej. "Estación MQTT conectada")
+  MALFORMED,
+  NO_STATION,    // sin sensor_id
+  NO_TIMESTAMP,  // sin timestamp o con un formato que no es ISO-8601 ni epoch ms
+};
+
+inline const char* parseStatusName(ParseStatus s) {
+  switch (s) {
+    case ParseStatus::OK: return "ok";
+    case ParseStatus::NOT_JSON: return "not_json";
+    case ParseStatus::MALFORMED: return "malformed";
+    case ParseStatus::NO_STATION: return "no_station";
+    case ParseStatus::NO_TIMESTAMP: return "no_timestamp";
+  }
+  return "";
+}
+
+// =============================================================
+// === ISO-8601 -> epoch ms ===
+// =============================================================
+// Posiciones fijas: "2025-01-01T01:00:05[.123](Z|+01:00)". Sin sscanf ni
+// timegm; los días salen de days_from_civil (H. Hinnant).
+inline int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  const int64_t era = (y >= 0 ? y : y - 399) / 400;
+  const unsigned yoe = (unsigned)(y - era * 400);
+  const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int64_t)doe - 719468;
+}
+
+inline bool parseIsoTimestamp(const char* s, size_t len, int64_t& epochMs) {
+  auto digits = [s](size_t at, size_t n, unsigned& out) {
+    unsigned v = 0;
+    for (size_t i = 0; i < n; i++) {
+      const unsigned d = (unsigned)(s[at + i] - '0');
+      if (d > 9) return false;
+      v = v * 10 + d;
+    }
+    out = v;
+    return true;
+  };
+  if (len < 20 || s[4] != '-' || s[7] != '-' || (s[10] != 'T' && s[10] != ' ') || s[13] != ':' || s[16] != ':') {
+    return false;
+  }
+  unsigned year, month, day, hour, minute, second, millis = 0;
+  if (!digits(0, 4, year) || !digits(5, 2, month) || !digits(8, 2, day) || !digits(11, 2, hour) ||
+      !digits(14, 2, minute) || !digits(17, 2, second)) {
+    return false;
+  }
+  if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) return false;
+  size_t at = 19;
+  if (s[at] == '.') {
+    at++;
+    unsigned scale = 100;
+    while (at < len && s[at] >= '0' && s[at] <= '9') {
+      millis += (unsigned)(s[at] - '0') * scale;
+      scale /= 10;
+      at++;
+    }
+  }
+  int offsetMin = 0;
+  if (at < len && s[at] == 'Z') {
+    at++;
+  } else if (at + 6 <= len && (s[at] == '+' || s[at] == '-') && s[at + 3] == ':') {
+    unsigned oh, om;
+    if (!digits(at + 1, 2, oh) || !digits(at + 4, 2, om)) return false;
+    offsetMin = (int)(oh * 60 + om) * (s[at] == '-' ? -1 : 1);
+    at += 6;
+  } else {
+    return false;
+  }
+  if (at != len) return false;
+  const int64_t days = daysFromCivil(year, month, day);
+  const int64_t seconds = days * 86400 + hour * 3600 + minute * 60 + second - (int64_t)offsetMin * 60;
+  epochMs = seconds * 1000 + millis;
+  return true;
+}
+
+// =============================================================
+// === Parser a demanda de los payloads de la estación ===
+// =============================================================
+// No construye ningún árbol: recorre el mensaje una vez, lee solo las claves
+// que interesan y salta el resto (location.district, "stats"...) sin
+// decodificarlo. Las cadenas se buscan de 16 en 16 bytes con SSE2 (8 en 8 con
+// SWAR si no hay SSE2).
+//
+// Las estaciones escriben siempre las claves en el mismo orden
+// (PayloadWriter.hpp), así que en cada posición se predice la siguiente:
+// basta un memcmp de `"clave":` para aceptarla, sin leer la clave ni
+// buscarla en la tabla. Si la predicción falla (otro orden, una variante por
+// sensor, espacios) se cae a la búsqueda normal y el resultado es el mismo.
+//
+// También entiende los lotes (topic .../batch, ver BatchPayload.hpp): una
+// lectura por fila de "readings", con las columnas según "fields".
+class PayloadParser {
+ public:
+  struct Metrics {
+    uint64_t predicted = 0;  // claves aceptadas con la predicción
+    uint64_t looked = 0;     // claves buscadas en la tabla
+  };
+
+  explicit PayloadParser(bool predict = true) : predict_(predict) { rows_.reserve(64); }
+
+  // Llama a onReading(sensorId, reading) por cada lectura del mensaje (una
+  // salvo en los lotes). sensorId apunta dentro de `json`.
+  template <typename Callback>
+  ParseStatus parse(const char* json, size_t len, bool batch, Callback onReading) {
+    p_ = json;
+    end_ = json + len;
+    sensorId_ = std::string_view();
+    rows_.clear();
+    current_ = Reading();
+    haveTimestamp_ = false;
+    columnCount_ = 0;
+
+    skipSpace();
+    if (p_ >= end_ || *p_ != '{') return ParseStatus::NOT_JSON;
+    ParseStatus status = batch ? parseBatch() : parseReading();
+    if (status != ParseStatus::OK) return status;
+    if (sensorId_.empty()) return ParseStatus::NO_STATION;
+    if (batch) {
+      for (const Reading& r : rows_) onReading(sensorId_, r);
+      return ParseStatus::OK;
+    }
+    if (!haveTimestamp_) return ParseStatus::NO_TIMESTAMP;
+    onReading(sensorId_, current_);
+    return ParseStatus::OK;
+  }
+
+  const Metrics& metrics() const { return metrics_; }
+
+ private:
+  enum Key : uint8_t {
+    K_SENSOR_ID = 0,
+    K_SENSOR_TYPE,
+    K_STREET_ID,
+    K_TIMESTAMP,
+    K_LOCATION,
+    K_DATA,
+    K_STATS,
+    K_FIELDS,
+    K_READINGS,
+    K_LATITUDE,
+    K_LONGITUDE,
+    K_ALTITUDE,
+    K_DISTRICT,
+    K_NEIGHBORHOOD,
+    K_TEMPERATURE,
+    K_HUMIDITY,
+    K_WIND,
+    K_LIGHT,
+    K_PRESSURE,
+    K_AIR_QUALITY,
+    K_TIMESTAMP_MS,
+    K_UNKNOWN,
+  };
+
+  struct KeyName {
+    const char* quoted;  // "\"clave\":" tal como lo escribe la estación
+    uint8_t len;
+  };
+
+  static const KeyName& keyName(Key k) {
+#define PP_KEY(name) {"\"" name "\":", (uint8_t)(sizeof("\"" name "\":") - 1)}
+    static const KeyName NAMES[K_UNKNOWN] = {
+        PP_KEY("sensor_id"),       PP_KEY("sensor_type"),          PP_KEY("street_id"),
+        PP_KEY("timestamp"),       PP_KEY("location"),             PP_KEY("data"),
+        PP_KEY("stats"),           PP_KEY("fields"),               PP_KEY("readings"),
+        PP_KEY("latitude"),        PP_KEY("longitude"),            PP_KEY("altitude_meters"),
+        PP_KEY("district"),        PP_KEY("neighborhood"),         PP_KEY("temperature_celsius"),
+        PP_KEY("humidity_percentage"), PP_KEY("wind_speed"),       PP_KEY("luz"),
+        PP_KEY("atmospheric_pressure_hpa"), PP_KEY("air_quality_index"), PP_KEY("timestamp_ms"),
+    };
+#undef PP_KEY
+    return NAMES[k];
+  }
+
+  // Canal de cada clave de "data" / "fields" (CHANNEL_COUNT = no es un canal)
+  static size_t channelOf(Key k) {
+    switch (k) {
+      case K_TEMPERATURE: return CH_TEMPERATURE;
+      case K_HUMIDITY: return CH_HUMIDITY;
+      case K_PRESSURE: return CH_PRESSURE;
+      case K_ALTITUDE: return CH_ALTITUDE;
+      case K_LIGHT: return CH_LIGHT;
+      case K_WIND: return CH_WIND;
+      case K_AIR_QUALITY: return CH_AIR_QUALITY;
+      default: return CHANNEL_COUNT;
+    }
+  }
+
+  // Orden en que escribe cada objeto la estación; K_UNKNOWN = sin predicción
+  static constexpr Key TOP_ORDER[] = {K_SENSOR_ID, K_SENSOR_TYPE, K_STREET_ID, K_TIMESTAMP,
+                                      K_LOCATION,  K_DATA,        K_STATS,     K_UNKNOWN};
+  static constexpr Key BATCH_ORDER[] = {K_SENSOR_ID, K_SENSOR_TYPE, K_STREET_ID, K_LOCATION,
+                                        K_FIELDS,    K_READINGS,    K_UNKNOWN};
+  static constexpr Key LOCATION_ORDER[] = {K_LATITUDE, K_LONGITUDE, K_ALTITUDE, K_DISTRICT, K_NEIGHBORHOOD,
+                                           K_UNKNOWN};
+  static constexpr Key DATA_ORDER[] = {K_TEMPERATURE, K_HUMIDITY, K_WIND, K_LIGHT, K_PRESSURE, K_AIR_QUALITY,
+                                       K_UNKNOWN};
+
+  // --- Recorrido de objetos ---
+  // Lee la clave siguiente (con los ':' consumidos). `order`/`next` llevan
+  // la predicción; al acertar o al encontrarla en la tabla avanza `next`.
+  bool readKey(const Key* order, size_t& next, Key& key) {
+    skipSpace();
+    if (predict_ && order[next] != K_UNKNOWN) {
+      const KeyName& expected = keyName(order[next]);
+      if ((size_t)(end_ - p_) >= expected.len && memcmp(p_, expected.quoted, expected.len) == 0) {
+        p_ += expected.len;
+        key = order[next++];
+        metrics_.predicted++;
+        return true;
+      }
+    }
+    std::string_view name;
+    if (!readString(name)) return false;
+    skipSpace();
+    if (p_ >= end_ || *p_ != ':') return false;
+    p_++;
+    metrics_.looked++;
+    key = lookup(name);
+    for (size_t i = 0; order[i] != K_UNKNOWN; i++) {
+      if (order[i] == key) {
+        next = i + 1;
+        break;
+      }
+    }
+    return true;
+  }
+
+  static Key lookup(std::string_view name) {
+    for (uint8_t k = 0; k < K_UNKNOWN; k++) {
+      const KeyName& n = keyName((Key)k);
+      if ((size_t)n.len == name.size() + 3 && memcmp(n.quoted + 1, name.data(), name.size()) == 0) return (Key)k;
+    }
+    return K_UNKNOWN;
+  }
+
+  // Tras un valor: ',' (sigue) o el cierre (termina). false si no es ninguno.
+  bool nextMember(char close, bool& more) {
+    skipSpace();
+    if (p_ >= end_) return false;
+    if (*p_ == ',') {
+      p_++;
+      more = true;
+      return true;
+    }
+    if (*p_ == close) {
+      p_++;
+      more = false;
+      return true;
+    }
+    return false;
+  }
+
+  // Abre un objeto; `empty` si es {}
+  bool openObject(bool& empty) {
+    skipSpace();
+    if (p_ >= end_ || *p_ != '{') return false;
+    p_++;
+    skipSpace();
+    empty = p_ < end_ && *p_ == '}';
+    if (empty) p_++;
+    return true;
+  }
+
+  ParseStatus parseReading() {
+    bool empty;
+    if (!openObject(empty)) return ParseStatus::MALFORMED;
+    size_t next = 0;
+    for (bool more = !empty; more;) {
+      Key key;
+      if (!readKey(TOP_ORDER, next, key)) return ParseStatus::MALFORMED;
+      bool ok;
+      switch (key) {
+        case K_SENSOR_ID: ok = readString(sensorId_); break;
+        case K_TIMESTAMP: ok = readTimestamp(); break;
+        case K_LOCATION: ok = readChannels(LOCATION_ORDER); break;
+        case K_DATA: ok = readChannels(DATA_ORDER); break;
+        default: ok = skipValue(); break;
+      }
+      if (!ok || !nextMember('}', more)) return ParseStatus::MALFORMED;
+    }
+    return ParseStatus::OK;
+  }
+
+  // Objeto plano de canales numéricos (data, location)
+  bool readChannels(const Key* order) {
+    bool empty;
+    if (!openObject(empty)) return false;
+    size_t next = 0;
+    for (bool more = !empty; more;) {
+      Key key;
+      if (!readKey(order, next, key)) return false;
+      const size_t channel = channelOf(key);
+      if (channel < CHANNEL_COUNT) {
+        if (!readNumber(current_.values[channel])) return false;
+      } else if (!skipValue()) {
+        return false;
+      }
+      if (!nextMember('}', more)) return false;
+    }
+    return true;
+  }
+
+  // "2025-01-01T01:00:05+01:00" o epoch ms como número
+  bool readTimestamp() {
+    skipSpace();
+    if (p_ < end_ && *p_ == '"') {
+      std::string_view text;
+      if (!readString(text)) return false;
+      haveTimestamp_ = parseIsoTimestamp(text.data(), text.size(), current_.timestampMs);
+      return true;
+    }
+    double value;
+    bool isNull;
+    if (!readDouble(value, isNull)) return false;
+    haveTimestamp_ = !isNull && value > 0;
+    current_.timestampMs = (int64_t)value;
+    return true;
+  }
+
+  ParseStatus parseBatch() {
+    bool empty;
+    if (!openObject(empty)) return ParseStatus::MALFORMED;
+    size_t next = 0;
+    for (bool more = !empty; more;) {
+      Key key;
+      if (!readKey(BATCH_ORDER, next, key)) return ParseStatus::MALFORMED;
+      bool ok;
+      switch (key) {
+        case K_SENSOR_ID: ok = readString(sensorId_); break;
+        case K_FIELDS: ok = readFields(); break;
+        case K_READINGS: ok = readRows(); break;
+        default: ok = skipValue(); break;
+      }
+      if (!ok || !nextMember('}', more)) return ParseStatus::MALFORMED;
+    }
+    return ParseStatus::OK;
+  }
+
+  bool readFields() {
+    if (!openArray()) return false;
+    if (closeIfEmpty(']')) return true;
+    for (bool more = true; more;) {
+      std::string_view name;
+      skipSpace();
+      if (!readString(name) || columnCount_ >= MAX_COLUMNS) return false;
+      const Key key = lookup(name);
+      columns_[columnCount_++] = key == K_TIMESTAMP_MS ? TIMESTAMP_COLUMN : (uint8_t)channelOf(key);
+      if (!nextMember(']', more)) return false;
+    }
+    return true;
+  }
+
+  // Las filas se guardan y se entregan al final: "fields" podría ir después
+  bool readRows() {
+    if (columnCount_ == 0) return false;
+    if (!openArray()) return false;
+    if (closeIfEmpty(']')) return true;
+    for (bool more = true; more;) {
+      if (!openArray()) return false;
+      Reading row;
+      bool haveTs = false;
+      size_t column = 0;
+      for (bool cell = !closeIfEmpty(']'); cell; column++) {
+        double value;
+        bool isNull;
+        if (!readDouble(value, isNull)) return false;
+        const uint8_t target = column < columnCount_ ? columns_[column] : (uint8_t)CHANNEL_COUNT;
+        if (target == TIMESTAMP_COLUMN) {
+          haveTs = !isNull && value > 0;
+          row.timestampMs = (int64_t)value;
+        } else if (target < CHANNEL_COUNT) {
+          row.values[target] = isNull ? NAN : (float)value;
+        }
+        if (!nextMember(']', cell)) return false;
+      }
+      if (haveTs) rows_.push_back(row);
+      if (!nextMember(']', more)) return false;
+    }
+    return true;
+  }
+
+  bool openArray() {
+    skipSpace();
+    if (p_ >= end_ || *p_ != '[') return false;
+    p_++;
+    return true;
+  }
+
+  bool closeIfEmpty(char close) {
+    skipSpace();
+    if (p_ < end_ && *p_ == close) {
+      p_++;
+      return true;
+    }
+    return false;
+  }
+
+  // --- Valores ---
+  bool readNumber(float& out) {
+    double value;
+    bool isNull;
+    if (!readDouble(value, isNull)) return false;
+    out = isNull ? NAN : (float)value;
+    return true;
+  }
+
+  // Número JSON o null. Camino rápido: hasta 18 cifras sin exponente,
+  // acumuladas como entero y divididas por una potencia de 10 exacta.
+  bool readDouble(double& out, bool& isNull) {
+    skipSpace();
+    isNull = false;
+    if ((size_t)(end_ - p_) >= 4 && memcmp(p_, "null", 4) == 0) {
+      p_ += 4;
+      isNull = true;
+      out = NAN;
+      return true;
+    }
+    static const double POW10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                   1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+    const char* start = p_;
+    const bool negative = p_ < end_ && *p_ == '-';
+    if (negative) p_++;
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int fraction = 0;
+    while (p_ < end_ && (unsigned)(*p_ - '0') < 10) {
+      mantissa = mantissa * 10 + (unsigned)(*p_++ - '0');
+      digits++;
+    }
+    if (p_ < end_ && *p_ == '.') {
+      p_++;
+      while (p_ < end_ && (unsigned)(*p_ - '0') < 10) {
+        mantissa = mantissa * 10 + (unsigned)(*p_++ - '0');
+        digits++;
+        fraction++;
+      }
+    }
+    if (digits == 0) return false;
+    if (digits <= 18 && (p_ >= end_ || (*p_ != 'e' && *p_ != 'E'))) {
+      const double v = (double)mantissa / POW10[fraction];
+      out = negative ? -v : v;
+      return true;
+    }
+    // Exponente o demasiadas cifras: strtod sobre una copia terminada en '\0'
+    while (p_ < end_ && (strchr("0123456789+-eE.", *p_) != nullptr)) p_++;
+    char copy[64];
+    const size_t n = (size_t)(p_ - start);
+    if (n >= sizeof(copy)) return false;
+    memcpy(copy, start, n);
+    copy[n] = '\0';
+    char* parsed = nullptr;
+    out = strtod(copy, &parsed);
+    return parsed == copy + n;
+  }
+
+  // Cadena sin desescapar (claves e identificadores no llevan escapes)
+  bool readString(std::string_view& out) {
+    skipSpace();
+    if (p_ >= end_ || *p_ != '"') return false;
+    const char* start = ++p_;
+    for (;;) {
+      p_ = findQuoteOrBackslash(p_, end_);
+      if (p_ >= end_) return false;
+      if (*p_ == '"') break;
+      p_ += 2;  // \x: el carácter escapado no cierra la cadena
+      if (p_ > end_) return false;
+    }
+    out = std::string_view(start, (size_t)(p_ - start));
+    p_++;
+    return true;
+  }
+
+  // Salta un valor cualquiera sin interpretarlo
+  bool skipValue() {
+    skipSpace();
+    if (p_ >= end_) return false;
+    const char c = *p_;
+    if (c == '"') {
+      std::string_view ignored;
+      return readString(ignored);
+    }
+    if (c == '{' || c == '[') {
+      int depth = 0;
+      while (p_ < end_) {
+        const char ch = *p_;
+        if (ch == '"') {
+          std::string_view ignored;
+          if (!readString(ignored)) return false;
+          continue;
+        }
+        if (ch == '{' || ch == '[') depth++;
+        if (ch == '}' || ch == ']') {
+          if (--depth == 0) {
+            p_++;
+            return true;
+          }
+        }
+        p_++;
+      }
+      return false;
+    }
+    // número, true, false o null
+    const char* start = p_;
+    while (p_ < end_ && *p_ != ',' && *p_ != '}' && *p_ != ']' && (unsigned char)*p_ > ' ') p_++;
+    return p_ > start;
+  }
+
+  void skipSpace() {
+    while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) p_++;
+  }
+
+  static const char* findQuoteOrBackslash(const char* p, const char* end) {
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i slash = _mm_set1_epi8('\\');
+    while (end - p >= 16) {
+      const __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+      const int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, slash)));
+      if (mask) return p + __builtin_ctz((unsigned)mask);
+      p += 16;
+    }
+#else
+    // SWAR: un byte es cero en (x ^ patrón) si coincide
+    const uint64_t ones = 0x0101010101010101ull;
+    const uint64_t highs = 0x8080808080808080ull;
+    while (end - p >= 8) {
+      uint64_t x;
+      memcpy(&x, p, 8);
+      const uint64_t q = x ^ (ones * '"');
+      const uint64_t s = x ^ (ones * '\\');
+      const uint64_t hit = ((q - ones) & ~q & highs) | ((s - ones) & ~s & highs);
+      if (hit) break;  // el byte exacto lo busca el bucle de abajo
+      p += 8;
+    }
+#endif
+    while (p < end && *p != '"' && *p != '\\') p++;
+    return p;
+  }
+
+  static constexpr size_t MAX_COLUMNS = 16;
+  static constexpr uint8_t TIMESTAMP_COLUMN = 0xFF;
+
+  bool predict_;
+  const char* p_ = nullptr;
+  const char* end_ = nullptr;
+  std::string_view sensorId_;
+  Reading current_;
+  bool haveTimestamp_ = false;
+  uint8_t columns_[MAX_COLUMNS] = {};
+  size_t columnCount_ = 0;
+  std::vector<Reading> rows_;
+  Metrics metrics_;
+};
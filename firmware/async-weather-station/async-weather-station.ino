@@ -8,21 +8,45 @@
 #include <WiFi.h>
 #include <Wire.h>
 #include <AsyncMqttClient.h>
-#include <Adafruit_BMP085.h>
 #include <BH1750.h>
-#include <DHT.h>
 #include <Adafruit_SSD1306.h>
-#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include <Preferences.h>
+#include <atomic>
+#include <driver/gpio.h>
+#include <driver/rmt_rx.h>
+#include <esp_heap_caps.h>
 
 #include "config/config.h"
+#include "include/Log.hpp"
 #include "include/ESP32_Utils.hpp"
 #include "include/ESP32_Utils_MQTT_Async.hpp"
 #include "include/MQTT.hpp"
 #include "include/TimeUtils.hpp"
+#include "include/Anemometer.hpp"
+#include "include/GasSensor.hpp"
+#include "include/SensorData.hpp"
+#include "include/PayloadWriter.hpp"
+#include "include/PayloadSchema.hpp"
+#include "include/ReadingQueue.hpp"
+#include "include/BatchPayload.hpp"
+#include "include/BinaryPayload.hpp"
+#include "include/TaskScheduler.hpp"
+#include "include/Bmp085Async.hpp"
+#include "include/Dht11Async.hpp"
+#include "include/SpscQueue.hpp"
+#include "include/RunningStats.hpp"
+#include "include/ReportFilter.hpp"
+#include "include/DisplayPages.hpp"
+#include "include/BootSequence.hpp"
+#include "include/WiFiPolicy.hpp"
+#include "include/CommandChannel.hpp"
+#include "include/Diagnostics.hpp"
+#include "include/AllocationCounter.hpp"
+#include "include/FixedString.hpp"
 
 // === Definición de pines ===
 #define DHTPIN 14
-#define DHTTYPE DHT11
 #define MQ2_AO 35
 #define BUZZER_PIN 15
 #define LED_R 12
@@ -33,144 +57,646 @@
 #define ANEMO_PIN 17
 
 // === Configuración del anemómetro ===
-constexpr int RecordTime = 3;
-volatile int InterruptCounter = 0;
-volatile unsigned long lastPulse = 0;
+// La ISR queda enganchada siempre; la media, la racha y la velocidad por
+// intervalo se calculan sin bloquear a partir de los pulsos acumulados.
+constexpr float ANEMO_FACTOR = 2.4f;                 // km/h por Hz
+constexpr unsigned long ANEMO_DEBOUNCE_US = 5000;
+constexpr unsigned long ANEMO_WINDOW_MS = 30000;     // ventana de la velocidad media
+constexpr unsigned long ANEMO_GUST_WINDOW_MS = 3000; // ventana de la racha
+AnemometerEngine anemometer;
 float WindSpeed = 0.0f;
-constexpr float ANEMO_FACTOR = 2.4f;
 
 // === Sensores ===
-Adafruit_BMP085 bmp;
+// BMP085/BMP180 con conversiones asíncronas: oversampling y promediado
+// configurables y altitud calculada a partir de la misma presión.
+constexpr uint8_t BMP_OVERSAMPLING = 3;        // 0..3 (3 = ultra alta resolución)
+constexpr uint8_t BMP_AVERAGING = 4;           // conversiones de presión promediadas
+constexpr float BMP_SEA_LEVEL_HPA = 1013.25f;  // referencia para la altitud
+
+// El bus I2C lo comparten los sensores (núcleo 1) y la pantalla (núcleo 0):
+// cada transacción completa se hace con el mutex tomado.
+SemaphoreHandle_t i2cMutex = nullptr;
+
+class I2cLock {
+ public:
+  I2cLock() {
+    if (i2cMutex) xSemaphoreTake(i2cMutex, portMAX_DELAY);
+  }
+  ~I2cLock() {
+    if (i2cMutex) xSemaphoreGive(i2cMutex);
+  }
+};
+
+// Adaptador de Wire para los drivers que usan I2cBus
+class WireI2cBus : public I2cBus {
+ public:
+  bool writeRegister(uint8_t address, uint8_t reg, uint8_t value) override {
+    I2cLock lock;
+    Wire.beginTransmission(address);
+    Wire.write(reg);
+    Wire.write(value);
+    return Wire.endTransmission() == 0;
+  }
+
+  bool readRegisters(uint8_t address, uint8_t reg, uint8_t* out, size_t len) override {
+    I2cLock lock;
+    Wire.beginTransmission(address);
+    Wire.write(reg);
+    if (Wire.endTransmission(false) != 0) return false;
+    if (Wire.requestFrom(address, (uint8_t)len) != len) return false;
+    for (size_t i = 0; i < len; i++) out[i] = Wire.read();
+    return true;
+  }
+};
+
+WireI2cBus i2cBus;
+Bmp085Async bmp;
 BH1750 lightMeter;
-DHT dht(DHTPIN, DHTTYPE);
+
+// DHT11 capturado por el RMT: el canal RX mide cada nivel de la línea con
+// resolución de 1 µs y avisa al terminar la trama, sin desactivar
+// interrupciones, así que la ISR del anemómetro no pierde pulsos mientras
+// llega. El pin va en drenador abierto con pull-up para dar la señal de
+// inicio y escuchar sin reconfigurarlo. La decodificación (Dht11Async) se
+// hace después, en la tarea de sensores.
+constexpr uint32_t DHT_RMT_RESOLUTION_HZ = 1000000;
+constexpr size_t DHT_RMT_SYMBOLS = 64;         // una trama son 43 símbolos
+constexpr uint32_t DHT_RMT_GLITCH_NS = 1000;   // el filtro del RMT no pasa de ~3 µs
+constexpr uint32_t DHT_RMT_IDLE_NS = 200000;   // 200 µs sin flancos = fin de trama
+
+class RmtDhtLine : public DhtLine {
+ public:
+  bool begin(gpio_num_t pin) {
+    pin_ = pin;
+    rmt_rx_channel_config_t config = {};
+    config.gpio_num = pin;
+    config.clk_src = RMT_CLK_SRC_DEFAULT;
+    config.resolution_hz = DHT_RMT_RESOLUTION_HZ;
+    config.mem_block_symbols = DHT_RMT_SYMBOLS;
+    if (rmt_new_rx_channel(&config, &channel_) != ESP_OK) {
+      channel_ = nullptr;
+      return false;
+    }
+    rmt_rx_event_callbacks_t callbacks = {};
+    callbacks.on_recv_done = onReceived;
+    if (rmt_rx_register_event_callbacks(channel_, &callbacks, this) != ESP_OK || rmt_enable(channel_) != ESP_OK) {
+      rmt_del_channel(channel_);
+      channel_ = nullptr;
+      return false;
+    }
+    // Después del RMT, que deja el pin solo como entrada
+    gpio_set_direction(pin, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_pull_mode(pin, GPIO_PULLUP_ONLY);
+    gpio_set_level(pin, 1);
+    return true;
+  }
+
+  void driveLow() override { gpio_set_level(pin_, 0); }
+
+  // Se arma antes de soltar la línea para no perder la respuesta (20-40 µs después)
+  bool releaseAndCapture() override {
+    done_.store(false, std::memory_order_relaxed);
+    bool armed = false;
+    if (channel_) {
+      rmt_receive_config_t receive = {};
+      receive.signal_range_min_ns = DHT_RMT_GLITCH_NS;
+      receive.signal_range_max_ns = DHT_RMT_IDLE_NS;
+      armed = rmt_receive(channel_, symbols_, sizeof(symbols_), &receive) == ESP_OK;
+    }
+    gpio_set_level(pin_, 1);
+    return armed;
+  }
+
+  bool captured(const DhtRun*& runs, size_t& count) override {
+    if (!done_.load(std::memory_order_acquire)) return false;
+    const size_t received = received_.load(std::memory_order_relaxed);
+    size_t n = 0;
+    for (size_t i = 0; i < received && i < DHT_RMT_SYMBOLS; i++) {
+      const rmt_symbol_word_t& s = symbols_[i];
+      if (s.duration0 == 0) break;
+      runs_[n++] = {(uint8_t)s.level0, (uint16_t)s.duration0};
+      if (s.duration1 == 0) break;  // nivel de reposo: fin de captura
+      runs_[n++] = {(uint8_t)s.level1, (uint16_t)s.duration1};
+    }
+    runs = runs_;
+    count = n;
+    return true;
+  }
+
+  // Deshabilitar el canal cancela la recepción pendiente
+  void abortCapture() override {
+    if (!channel_) return;
+    rmt_disable(channel_);
+    rmt_enable(channel_);
+  }
+
+ private:
+  static bool IRAM_ATTR onReceived(rmt_channel_handle_t channel, const rmt_rx_done_event_data_t* data, void* context) {
+    (void)channel;
+    RmtDhtLine* self = static_cast<RmtDhtLine*>(context);
+    self->received_.store(data->num_symbols, std::memory_order_relaxed);
+    self->done_.store(true, std::memory_order_release);
+    return false;
+  }
+
+  gpio_num_t pin_ = GPIO_NUM_NC;
+  rmt_channel_handle_t channel_ = nullptr;
+  rmt_symbol_word_t symbols_[DHT_RMT_SYMBOLS];
+  DhtRun runs_[2 * DHT_RMT_SYMBOLS];
+  std::atomic<size_t> received_{0};
+  std::atomic<bool> done_{false};
+};
+
+RmtDhtLine dhtLine;
+Dht11Async dht(&dhtLine);
 
 // === Pantalla OLED ===
 constexpr uint8_t SCREEN_WIDTH = 128;
 constexpr uint8_t SCREEN_HEIGHT = 64;
+constexpr uint8_t OLED_ADDRESS = 0x3C;
+constexpr uint32_t I2C_CLOCK_HZ = 400000;          // BH1750, BMP180 y SSD1306 admiten fast mode
+constexpr unsigned long DISPLAY_REFRESH_MS = 1000;  // reloj y estado de red
+constexpr uint32_t BUTTON_DEBOUNCE_MS = 30;
 Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, -1);
 
-// === MQ2 ===
-constexpr int MQ2_umbral_base = 1400;
-constexpr int MQ2_umbral_malo = 1700;
-constexpr int MQ2_umbral_horrible = 1800;
+// Dibuja con Adafruit_GFX en el framebuffer y vuelca solo la región sucia
+// (COLUMNADDR/PAGEADDR + datos) en lugar del 1 KB completo de display()
+class Ssd1306Device : public DisplayDevice {
+ public:
+#if defined(I2C_BUFFER_LENGTH)
+  static constexpr size_t CHUNK = I2C_BUFFER_LENGTH - 1;  // 1 byte de control por transacción
+#else
+  static constexpr size_t CHUNK = 31;
+#endif
+
+  void clearRect(int16_t x, int16_t y, int16_t w, int16_t h) override {
+    display.fillRect(x, y, w, h, SSD1306_BLACK);
+  }
+
+  void drawText(int16_t x, int16_t y, uint8_t size, const char* text) override {
+    display.setTextSize(size);
+    display.setTextColor(SSD1306_WHITE);
+    display.setCursor(x, y);
+    display.print(text);
+  }
+
+  size_t flush(const DirtyRegion& region) override {
+    if (region.empty()) return 0;
+    I2cLock lock;
+    const uint8_t* buffer = display.getBuffer();
+    size_t bytes = 0;
+    for (uint8_t page = 0; page < DirtyRegion::PAGES; page++) {
+      if (!region.pageDirty(page)) continue;
+      const uint8_t window[] = {SSD1306_COLUMNADDR, region.col0[page], region.col1[page],
+                                SSD1306_PAGEADDR, page, page};
+      Wire.beginTransmission(OLED_ADDRESS);
+      Wire.write((uint8_t)0x00);  // Co = 0, D/C = 0: comandos
+      Wire.write(window, sizeof(window));
+      Wire.endTransmission();
+      bytes += 1 + sizeof(window);
+
+      const uint8_t* row = buffer + (size_t)page * SCREEN_WIDTH;
+      for (size_t col = region.col0[page]; col <= region.col1[page];) {
+        size_t n = region.col1[page] + 1 - col;
+        if (n > CHUNK) n = CHUNK;
+        Wire.beginTransmission(OLED_ADDRESS);
+        Wire.write((uint8_t)0x40);  // D/C = 1: datos
+        Wire.write(row + col, n);
+        Wire.endTransmission();
+        bytes += 1 + n;
+        col += n;
+      }
+    }
+    return bytes;
+  }
+};
+
+// Páginas: resumen, detalle por sensor, red/MQTT y último mensaje recibido.
+// Fila 0: título y hora; filas 1..7: campos "etiqueta valor".
+enum DisplayPageId { PAGE_SUMMARY, PAGE_ENVIRONMENT, PAGE_WIND_LIGHT, PAGE_AIR, PAGE_NETWORK, PAGE_MESSAGE, PAGE_COUNT };
+constexpr size_t DISPLAY_WIDGETS_PER_PAGE = 16;
+constexpr size_t MESSAGE_LINES = 6;
+Ssd1306Device oledDevice;
+PagedDisplay<PAGE_COUNT, DISPLAY_WIDGETS_PER_PAGE> pages([]() -> uint32_t { return micros(); });
+DebouncedButton buttonBack(BUTTON_DEBOUNCE_MS);
+DebouncedButton buttonNext(BUTTON_DEBOUNCE_MS);
+unsigned long lastDisplayRefreshMillis = 0;
+
+// Ids de los widgets de valor
+struct DisplayFields {
+  int clock[PAGE_COUNT];
+  int temperature, humidity, pressure, wind, gas, status;
+  int envTemperature, envRange, envHumidity, envPressure, envAltitude;
+  int windMean, windGust, windMs, windRange, light;
+  int gasRaw, gasQuality, gasRange, gasPpm;
+  int wifi, rssi, ip, mqtt, queue, boot, display;
+  int message[MESSAGE_LINES];
+};
+DisplayFields fields;
+
+// === MQ2 (GasSensor.hpp, circuito y umbrales en config.h) ===
+// GPIO35 es del ADC1, el único que convierte con la WiFi activa. El DMA
+// llena tramas de MQ2_ADC_CONVERSIONS conversiones y la tarea de sensores
+// recoge sus medias; la CPU no toca cada muestra. R0 se guarda en NVS y solo
+// vale mientras no cambie el circuito.
+constexpr uint32_t MQ2_FRAME_MS = (uint32_t)(1000ULL * MQ2_ADC_CONVERSIONS / MQ2_ADC_FREQ_HZ);
+const char* MQ2_NVS_NAMESPACE = "mq2";
+const char* MQ2_NVS_KEY = "r0";
+constexpr uint8_t MQ2_NVS_VERSION = 1;
+struct Mq2Calibration {
+  uint8_t version;
+  float r0Kohm;
+  float supplyMv;
+  float loadKohm;
+  float pinScale;
+};
+Mq2Sensor gasSensor;
+uint32_t gasFrameMs = 0;                     // instante estimado de la última trama
+std::atomic<bool> gasCalibrationRequested{false};
 
 // === MQTT ===
 AsyncMqttClient mqttClient;
-constexpr unsigned long PUBLISH_INTERVAL_MS = 30UL * 1000UL;
+constexpr unsigned long PUBLISH_INTERVAL_MS = 30UL * 1000UL;  // separación mínima entre envíos por cambio
 
-// === Estado del sistema ===
-struct SensorData {
-  float temperatureC = NAN;
-  float humidityPercent = NAN;
-  float pressureHpa = NAN;
-  float altitudeMeters = NAN;
-  float lightLux = NAN;
-  float windSpeedKmh = 0.0f;
-  float windSpeedMs = 0.0f;
-  int gasRaw = 0;
-  String gasQuality;
+// === Publicación por cambio (deadband + latido) ===
+// La lectura se evalúa cada REPORT_CHECK_MS y solo sale si algún canal se
+// ha movido más que su deadband, si gas o racha cruzan un umbral o si lleva
+// REPORT_HEARTBEAT_MS sin publicarse nada.
+constexpr uint32_t REPORT_CHECK_MS = 1000;
+constexpr uint32_t REPORT_HEARTBEAT_MS = 10UL * 60UL * 1000UL;
+constexpr float WIND_umbral_fuerte = 39.0f;     // km/h, Beaufort 6
+constexpr float WIND_umbral_temporal = 62.0f;   // km/h, Beaufort 8
+constexpr float WIND_umbral_borrasca = 89.0f;   // km/h, Beaufort 10
+ReportFilter reportFilter;
+
+// === Planificador de muestreo ===
+// Cada sensor se muestrea a su ritmo; la publicación toma el último valor
+// de cada canal. Periodos en ms.
+constexpr uint32_t SAMPLE_WIND_MS = 250;
+constexpr uint32_t SAMPLE_MQ2_MS = 100;        // recoge las tramas del ADC continuo (2 por vez)
+constexpr uint32_t SAMPLE_LIGHT_MS = 1000;
+constexpr uint32_t SAMPLE_DHT_MS = 2000;       // el DHT11 no admite más de 1 lectura/s
+constexpr uint32_t SAMPLE_BMP_MS = 10000;      // la presión apenas cambia
+constexpr uint8_t DHT_MAX_FAILURES = 3;        // lecturas fallidas seguidas antes de invalidar
+constexpr uint8_t DHT_MAX_RETRIES = 1;         // reintentos de una lectura fallida (a 1 s)
+constexpr uint32_t SCHEDULER_LOG_MS = 5UL * 60UL * 1000UL;  // resumen de tiempos del planificador
+TaskScheduler<8> scheduler([]() -> uint32_t { return millis(); }, []() -> uint32_t { return micros(); });
+SensorData currentReadings;                    // último valor de cada canal
+// Agregados de cada canal entre publicaciones (bloque "stats" del payload)
+constexpr float STATS_EWMA_ALPHA = 0.1f;
+StatsWindow statsWindow;
+
+// === Tareas FreeRTOS ===
+// Los sensores van fijados al núcleo de aplicación (APP_CPU) y la red, la
+// serialización y la pantalla al de protocolo (PRO_CPU), junto a WiFi y
+// async_tcp. Una lectura completa pasa de una tarea a otra por sensorQueue.
+constexpr BaseType_t SENSOR_TASK_CORE = 1;
+constexpr BaseType_t NETWORK_TASK_CORE = 0;
+constexpr uint32_t SENSOR_TASK_STACK = 4096;
+constexpr uint32_t NETWORK_TASK_STACK = 8192;
+constexpr UBaseType_t SENSOR_TASK_PRIORITY = 2;   // el muestreo no espera a la red
+constexpr UBaseType_t NETWORK_TASK_PRIORITY = 1;
+constexpr uint32_t SENSOR_TASK_MAX_SLEEP_MS = 50;
+constexpr uint32_t NETWORK_TASK_POLL_MS = 20;     // ACKs, reintentos y pantalla
+constexpr size_t SENSOR_QUEUE_DEPTH = 8;
+SpscQueue<SensorData, SENSOR_QUEUE_DEPTH> sensorQueue;
+TaskHandle_t sensorTaskHandle = nullptr;
+TaskHandle_t networkTaskHandle = nullptr;
+
+// === Cola persistente de lecturas (store-and-forward) ===
+// Las lecturas tomadas sin conexión se guardan en LittleFS y se reenvían en
+// orden al reconectar; cada entrada se borra solo al recibir su ACK QoS1.
+constexpr uint32_t READING_QUEUE_CAPACITY = 1440;        // 12 h a 30 s por lectura
+constexpr unsigned long QUEUE_DRAIN_INTERVAL_MS = 200;   // ritmo máximo de reenvío
+constexpr unsigned long QUEUE_ACK_TIMEOUT_MS = 10000;    // sin ACK => se reintenta
+const char* READING_QUEUE_PATH = "/littlefs/readings.bin";
+FileRecordStorage readingStorage;
+ReadingQueue<READING_QUEUE_CAPACITY> readingQueue;
+std::atomic<bool> queueDrainEnabled{false};
+// Los ACK de todas las publicaciones QoS1: el de una lectura puede llegar
+// junto a otros y no debe perderse
+PacketAckRing<16> publishAcks;
+unsigned long lastQueueDrainMillis = 0;
+
+// Única publicación en vuelo esperando ACK (QoS1 y orden estricto)
+struct InflightReading {
+  bool active = false;
+  bool queued = false;  // true si la lectura ya está en la cola persistente
+  uint16_t packetId = 0;
+  uint32_t seq = 0;
+  uint32_t count = 1;   // lecturas que confirma el ACK (más de una en modo lote)
+  unsigned long sentMillis = 0;
+  StoredReading reading;
 };
+InflightReading inflightReading;
+
+// === Modo lote (MQTT_BATCH_SIZE en config.h) ===
+#if MQTT_BATCH_SIZE > 1
+constexpr bool BATCH_MODE = true;
+constexpr size_t BATCH_ROWS = MQTT_BATCH_SIZE;
+#else
+constexpr bool BATCH_MODE = false;
+constexpr size_t BATCH_ROWS = 1;
+#endif
+const char* mqttBatchTopic = MQTT_BATCH_TOPIC;
+BatchPolicy batchPolicy;
+unsigned long batchOpenedMillis = 0;
+char batchBuffer[batchPayloadMaxLen(BATCH_ROWS) + 1];
+
+// === Formato binario (PAYLOAD_FORMAT en config.h) ===
+#ifndef PAYLOAD_FORMAT
+#define PAYLOAD_FORMAT PAYLOAD_FORMAT_JSON
+#endif
+#ifndef CBOR_KEYFRAME_INTERVAL
+#define CBOR_KEYFRAME_INTERVAL 20
+#endif
+const char* mqttCborTopic = MQTT_CBOR_TOPIC;
+BinaryEncoder binaryEncoder(CBOR_KEYFRAME_INTERVAL);
+uint8_t binaryBuffer[BINARY_PAYLOAD_MAX_LEN];
 
+// === Un tema por métrica (PAYLOAD_SPLIT_TOPICS en config.h) ===
+#ifndef PAYLOAD_SPLIT_TOPICS
+#define PAYLOAD_SPLIT_TOPICS 0
+#endif
+const StationInfo stationInfo;
+char splitBuffer[PAYLOAD_SPLIT_TOPICS ? SPLIT_PAYLOAD_BUFFER_LEN : 1];
+
+// === Estado del sistema ===
+// latestSensorData, hasSensorData y payloadBuffer son de la tarea de red (la
+// única que publica y dibuja). Los indicadores que se cambian desde otras
+// tareas, incluidos los callbacks de AsyncMqttClient, son atómicos.
 SensorData latestSensorData;
+char payloadBuffer[SENSOR_PAYLOAD_BUFFER_LEN];
 bool hasSensorData = false;
-String lastReceivedMessage = "Sin mensajes";
-volatile bool displayNeedsUpdate = false;
-unsigned long lastPublishMillis = 0;
-bool mqttConnected = false;
+// Último texto libre recibido en /comandos (lo escribe y lo dibuja la tarea de red)
+constexpr size_t LAST_MESSAGE_LEN = MESSAGE_LINES * DISPLAY_TEXT_COLUMNS + 1;
+char lastReceivedMessage[LAST_MESSAGE_LEN] = "Sin mensajes";
+std::atomic<bool> displayNeedsUpdate{false};
+std::atomic<bool> mqttConnected{false};
 
-// === Códigos de color ANSI para logs ===
-#define ANSI_RESET   "\033[0m"
-#define ANSI_RED     "\033[31m"
-#define ANSI_GREEN   "\033[32m"
-#define ANSI_YELLOW  "\033[33m"
-#define ANSI_BLUE    "\033[34m"
-#define ANSI_CYAN    "\033[36m"
-#define ANSI_BOLD    "\033[1m"
+// === Canal de comandos (CommandChannel.hpp) ===
+// OnMqttReceived() reensambla cada mensaje de /comandos en un hueco del
+// buzón; la tarea de red lo interpreta en sitio, ejecuta el comando de la
+// tabla y responde en /respuestas. Lo que afecta al muestreo se deja
+// pendiente y lo recoge la tarea de sensores en su siguiente paso.
+constexpr size_t COMMAND_MAX_LEN = 512;
+constexpr size_t COMMAND_INBOX_SLOTS = 2;
+constexpr size_t COMMAND_MAX_TOKENS = 48;
+constexpr size_t COMMAND_REPLY_LEN = 640;
+const char* mqttResponseTopic = MQTT_RESPONSE_TOPIC;
+CommandInbox<COMMAND_INBOX_SLOTS, COMMAND_MAX_LEN + 1> commandInbox;
+char commandReply[COMMAND_REPLY_LEN];
+std::atomic<bool> sampleRequested{false};
+bool publishRequested = false;          // de la tarea de sensores
+int publishTaskId = -1;
+// Política que modifican los comandos (tarea de red) y copia que espera a
+// que la aplique la tarea de sensores
+ReportPolicyConfig commandPolicy;
+ReportPolicyConfig pendingPolicy;
+portMUX_TYPE pendingPolicyMux = portMUX_INITIALIZER_UNLOCKED;
+std::atomic<bool> policyPending{false};
 
-// =============================================================
-// === Función para obtener hora local (TimeUtils) ===
-// =============================================================
-String getLocalTimeString() {
-  struct tm timeinfo;
-  if (!getLocalTime(&timeinfo)) {
-    return String("00:00:00");
+// === Conexión WiFi (WiFiPolicy.hpp) ===
+// La política decide cada intento: primero directo al último BSSID/canal
+// bueno (guardados en NVS) y, si falla, escaneo normal. Los eventos de la
+// tarea WiFi llegan a la de red por wifiEvents.
+#ifndef WIFI_FAST_RECONNECT
+#define WIFI_FAST_RECONNECT 1
+#endif
+#ifndef WIFI_REUSE_LEASE
+#define WIFI_REUSE_LEASE 0
+#endif
+#ifndef WIFI_STATIC_IP
+#define WIFI_STATIC_IP 0
+#endif
+const char* WIFI_NVS_NAMESPACE = "wifi";
+const char* WIFI_NVS_KEY = "link";
+
+class EspWiFiRadio : public WiFiRadio {
+ public:
+  void connect(const WiFiAttemptPlan& plan) override {
+    switch (plan.addressing) {
+      case WiFiAddressing::STATIC_CONFIG:
+        WiFi.config(ip, gateway, subnet, gateway);
+        break;
+      case WiFiAddressing::CACHED_LEASE:
+        WiFi.config(IPAddress(plan.lease.ip), IPAddress(plan.lease.gateway), IPAddress(plan.lease.subnet),
+                    IPAddress(plan.lease.dns));
+        break;
+      default:
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+        break;
+    }
+    if (plan.kind == WiFiAttemptKind::DIRECT) {
+      WiFi.begin(ssid, password, plan.channel, plan.bssid);
+    } else {
+      WiFi.begin(ssid, password);
+    }
   }
-  char buffer[16];
-  strftime(buffer, sizeof(buffer), "%H:%M:%S", &timeinfo);
-  return String(buffer);
+
+  void disconnect() override { WiFi.disconnect(false, false); }
+};
+
+struct WiFiLinkEvent {
+  enum Type : uint8_t { ASSOCIATED, GOT_IP, DISCONNECTED } type;
+  uint8_t reason;
+  uint8_t channel;
+  uint8_t bssid[6];
+  uint32_t atMs;
+};
+
+EspWiFiRadio wifiRadio;
+WiFiPolicy wifiPolicy(&wifiRadio);
+SpscQueue<WiFiLinkEvent, 8> wifiEvents;
+
+// === Arranque (BootSequence.hpp) ===
+// setup() no espera a la red ni se queda colgado si falta un sensor: los
+// dispositivos degradados se reintentan cada DEVICE_RETRY_MS y las lecturas
+// previas al NTP se fechan al sincronizar. Si el NTP no llega en
+// TIME_SYNC_GRACE_MS se publica igualmente con la marca de época 0.
+constexpr uint32_t DEVICE_RETRY_MS = 30000;
+constexpr uint32_t TIME_SYNC_GRACE_MS = 120000;
+BootSequence boot;
+uint32_t bootId = 0;  // distingue las lecturas de este arranque en la cola persistente
+const char* mqttBootTopic = MQTT_BOOT_TOPIC;
+
+// === Log asíncrono (Log.hpp) ===
+// Las llamadas LOG_* solo formatean en un anillo en RAM; esta tarea, de baja
+// prioridad, es la única que escribe en la UART.
+constexpr uint32_t LOG_TASK_STACK = 3072;
+constexpr UBaseType_t LOG_TASK_PRIORITY = 1;
+constexpr BaseType_t LOG_TASK_CORE = 1;
+constexpr uint32_t LOG_DRAIN_MS = 20;
+TaskHandle_t logTaskHandle = nullptr;
+
+// === Reservas del heap (AllocationCounter.hpp) ===
+// Las tareas del firmware no reservan memoria una vez arrancadas: todo va en
+// buffers fijos. Los ganchos del heap de ESP-IDF solo existen con
+// CONFIG_HEAP_USE_HOOKS (sdkconfig propio); sin ellos no se cuenta y el
+// informe lo omite. La simulación los tiene siempre (station_sim --alloc-check).
+AllocationCounter heapAllocations;
+#if CONFIG_HEAP_USE_HOOKS
+constexpr bool HEAP_ALLOCATIONS_COUNTED = true;
+extern "C" void IRAM_ATTR esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps) {
+  (void)ptr;
+  (void)caps;
+  heapAllocations.onAlloc(xTaskGetCurrentTaskHandle(), size);
+}
+extern "C" void IRAM_ATTR esp_heap_trace_free_hook(void* ptr) {
+  if (ptr) heapAllocations.onFree(xTaskGetCurrentTaskHandle());
 }
+#else
+constexpr bool HEAP_ALLOCATIONS_COUNTED = false;
+#endif
+
+// === Diagnóstico (Diagnostics.hpp, DIAG_ENABLED en config.h) ===
+// Las etapas se miden donde se ejecutan; la tarea de red muestrea la
+// memoria y publica el informe en /diag. Sin conexión la ventana sigue
+// abierta y el siguiente informe cubre todo el hueco. El comando diag
+// adelanta el informe (se publica en la siguiente vuelta de la tarea de red).
+#ifndef DIAG_PUBLISH_MS
+#define DIAG_PUBLISH_MS 900000UL
+#endif
+constexpr uint32_t DIAG_HEAP_SAMPLE_MS = 1000;
+const char* mqttDiagTopic = MQTT_DIAG_TOPIC;
+bool diagReportRequested = false;  // solo desde la tarea de red
 
 // =============================================================
-// === Intro visual para logs ===
+// === Función para obtener hora local (TimeUtils) ===
 // =============================================================
-void introLog(const char* titulo, const char* color = ANSI_CYAN) {
-  String hora = getLocalTimeString();
-  Serial.println();
-  Serial.println(String(color) + "======================================================" + ANSI_RESET);
-  Serial.printf("[%s] %s%s%s\n", hora.c_str(), color, titulo, ANSI_RESET);
-  Serial.println(String(color) + "======================================================" + ANSI_RESET);
+// Sin espera: getLocalTime() reintenta hasta 5 s por defecto mientras no hay
+// hora NTP, y esto se llama en setup() y en cada refresco de la pantalla
+typedef FixedString<8> ClockText;  // HH:MM:SS
+
+ClockText getLocalTimeString() {
+  struct tm timeinfo;
+  if (!getLocalTime(&timeinfo, 0)) {
+    return ClockText("00:00:00");
+  }
+  ClockText text;
+  text.appendf("%02d:%02d:%02d", timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+  return text;
 }
 
 // === Prototipos ===
-String getCalidadAire(int gasADC);
-float measureWind();
+void initWind();
+WindReading measureWind();
+void initGas();
+void initDht();
+void saveGasCalibration(float r0Kohm);
 void IRAM_ATTR countup();
 SensorData readSensors();
 void logSensorData(const SensorData& data);
-String buildSensorPayload(const SensorData& data);
-void publishCurrentData();
-void updateDisplayIfNeeded();
+size_t buildSensorPayload(const SensorData& data, char* out, size_t capacity);
+void publishCurrentData(const SensorData& data);
+void initReadingQueue();
+uint16_t publishStoredReading(const StoredReading& reading, bool retain);
+uint16_t publishJsonReading(const SensorData& data, bool retain);
+uint16_t publishSplitReading(const SensorData& data, bool retain);
+uint16_t publishBatch(uint32_t& firstSeq, uint32_t& count);
+void enqueueReading(const StoredReading& reading);
+void serviceReadingQueue();
+void initDisplayPages();
+void serviceDisplay();
+void updateDisplayFields();
+int addDisplayField(int page, uint8_t row, const char* label);
+void initScheduler();
+bool initBmp();
+bool initLight();
+bool retryDevices();
+void serviceBoot();
+void initWiFi();
+void serviceWiFi();
+void onWiFiLinkEvent(WiFiEvent_t event, arduino_event_info_t info);
+bool clockReady();
+void resolveTimestamp(SensorData& data);
+void resolveTimestamp(StoredReading& reading);
+bool sampleWind();
+bool sampleGas();
+bool sampleLight();
+bool sampleDht();
+uint32_t collectDht();
+bool sampleBmp();
+uint32_t collectBmp();
+bool runPublishTask();
+bool logSchedulerMetrics();
+void sensorTask(void* parameter);
+void networkTask(void* parameter);
+void logTask(void* parameter);
+void writeSerial(const char* text, size_t len);
+void serviceCommands();
+void initDiagnostics();
+void serviceDiagnostics();
 
 // =============================================================
 // === Interrupción: contar pulsos del anemómetro ===
 // =============================================================
 void IRAM_ATTR countup() {
-  unsigned long now = micros();
-  if (now - lastPulse > 5000) {
-    InterruptCounter++;
-    lastPulse = now;
-  }
+  anemometer.onPulse(micros());
 }
 
 // =============================================================
 // === Medición del viento ===
 // =============================================================
-float measureWind() {
-  InterruptCounter = 0;
+void initWind() {
+  AnemometerConfig config;
+  config.kmhPerHz = ANEMO_FACTOR;
+  config.debounceUs = ANEMO_DEBOUNCE_US;
+  config.windowMs = ANEMO_WINDOW_MS;
+  config.gustWindowMs = ANEMO_GUST_WINDOW_MS;
+  anemometer.configure(config);
+  anemometer.reset(micros());
   attachInterrupt(digitalPinToInterrupt(ANEMO_PIN), countup, FALLING);
-  delay(RecordTime * 1000);
-  detachInterrupt(digitalPinToInterrupt(ANEMO_PIN));
-  WindSpeed = (float)InterruptCounter / (float)RecordTime * ANEMO_FACTOR;
-  return WindSpeed;
+}
+
+// No bloquea: consume los pulsos pendientes y devuelve la ventana actual
+WindReading measureWind() {
+  anemometer.update(micros());
+  WindReading reading = anemometer.read();
+  WindSpeed = reading.meanKmh;
+  return reading;
 }
 
 // =============================================================
 // === SETUP ===
 // =============================================================
 void setup() {
+  boot.begin(millis());
+  bootId = esp_random();
   Serial.begin(115200);
-  delay(1000);
-  introLog("🌦 Iniciando Estación Meteorológica Local con MQTT...", ANSI_CYAN);
+  logger.begin(writeSerial, []() -> uint32_t { return millis(); });
+  initDiagnostics();
+  xTaskCreatePinnedToCore(logTask, "log", LOG_TASK_STACK, nullptr, LOG_TASK_PRIORITY, &logTaskHandle, LOG_TASK_CORE);
+  heapAllocations.track(logTaskHandle, "log");
+  LOG_INFO("🌦 Iniciando Estación Meteorológica Local con MQTT...");
 
+  // --- Sensores: ninguno detiene el arranque ---
   Wire.begin(21, 22);
-  dht.begin();
-  lightMeter.begin();
-
-  if (!bmp.begin()) {
-    introLog("❌ Error: No se detecta BMP180/BMP085.", ANSI_RED);
-    while (true) delay(1000);
+  i2cMutex = xSemaphoreCreateMutex();
+  initDht();
+  initGas();
+  if (!initLight()) {
+    boot.setDegraded(DEVICE_LIGHT, true);
+    LOG_ERROR("❌ BH1750 no responde: luz sin datos, se reintentará.");
   }
-
-  if (!display.begin(SSD1306_SWITCHCAPVCC, 0x3C)) {
-    introLog("❌ Error: No se pudo inicializar OLED.", ANSI_RED);
-    while (true) delay(1000);
+  if (!initBmp()) {
+    boot.setDegraded(DEVICE_BMP, true);
+    LOG_ERROR("❌ Error: No se detecta BMP180/BMP085. Presión sin datos, se reintentará.");
   }
 
-  display.clearDisplay();
-  display.setTextColor(SSD1306_WHITE);
-  display.setTextSize(1);
-  display.println("Estación iniciada.");
-  display.display();
+  if (display.begin(SSD1306_SWITCHCAPVCC, OLED_ADDRESS)) {
+    display.clearDisplay();
+    display.setTextColor(SSD1306_WHITE);
+    display.setTextSize(1);
+    display.println("Estación iniciada.");
+    display.display();
+  } else {
+    boot.setDegraded(DEVICE_DISPLAY, true);
+    LOG_ERROR("❌ Error: No se pudo inicializar OLED. Se sigue sin pantalla.");
+  }
+  // display() deja el bus a 100 kHz al terminar; los volcados parciales no lo tocan
+  Wire.setClock(I2C_CLOCK_HZ);
+  initDisplayPages();
 
   pinMode(BUTTON_BACK, INPUT_PULLDOWN);
   pinMode(BUTTON_NEXT, INPUT_PULLDOWN);
@@ -179,60 +705,481 @@ void setup() {
   pinMode(LED_B, OUTPUT);
   pinMode(ANEMO_PIN, INPUT_PULLUP);
   pinMode(BUZZER_PIN, OUTPUT);
+  // La ISR se registra en el núcleo que llama a attachInterrupt(): el de la tarea de sensores
+  initWind();
+  initReadingQueue();
+
+  initScheduler();
+  initWiFi();
+  displayNeedsUpdate = true;
 
+  xTaskCreatePinnedToCore(networkTask, "network", NETWORK_TASK_STACK, nullptr, NETWORK_TASK_PRIORITY,
+                          &networkTaskHandle, NETWORK_TASK_CORE);
+  xTaskCreatePinnedToCore(sensorTask, "sensors", SENSOR_TASK_STACK, nullptr, SENSOR_TASK_PRIORITY,
+                          &sensorTaskHandle, SENSOR_TASK_CORE);
+  heapAllocations.track(networkTaskHandle, "network");
+  heapAllocations.track(sensorTaskHandle, "sensors");
+
+  // --- Red: WiFi, MQTT y NTP siguen en segundo plano (serviceBoot) ---
   WiFi.onEvent(WiFiEvent);
-  ConnectWiFi_STA();
+  WiFi.onEvent(onWiFiLinkEvent);
   InitMqtt();
-  initTime();
+  startTimeSync();
+  boot.advance(BootStage::NETWORK);
+
+  LOG_INFO("✅ Sensores listos en %lu ms; red en segundo plano.", (unsigned long)millis());
+}
 
-  lastPublishMillis = millis() - PUBLISH_INTERVAL_MS;
+// Carga R0 de NVS (si se midió con el mismo circuito) y arranca el ADC
+// continuo. Sin R0 guardado, calibra al acabar el calentamiento.
+void initGas() {
+  Mq2Config config;
+  config.supplyMv = MQ2_SUPPLY_MV;
+  config.loadKohm = MQ2_LOAD_KOHM;
+  config.pinScale = MQ2_PIN_SCALE;
+  config.warmupMs = MQ2_WARMUP_MS;
+  config.calibrationMs = MQ2_CALIBRATION_MS;
+  config.qualityPpm[0] = MQ2_PPM_NORMAL;
+  config.qualityPpm[1] = MQ2_PPM_MALA;
+  config.qualityPpm[2] = MQ2_PPM_PELIGROSA;
+  gasSensor.configure(config);
+
+  float r0Kohm = NAN;
+  Mq2Calibration stored;
+  Preferences prefs;
+  if (prefs.begin(MQ2_NVS_NAMESPACE, true)) {
+    if (prefs.getBytes(MQ2_NVS_KEY, &stored, sizeof(stored)) == sizeof(stored) && stored.version == MQ2_NVS_VERSION &&
+        stored.supplyMv == config.supplyMv && stored.loadKohm == config.loadKohm && stored.pinScale == config.pinScale) {
+      r0Kohm = stored.r0Kohm;
+    }
+    prefs.end();
+  }
+  gasSensor.begin(millis(), r0Kohm);
+  gasFrameMs = millis();
+
+  const uint8_t pins[] = {MQ2_AO};
+  analogContinuousSetWidth(12);
+  analogContinuousSetAtten(ADC_11db);
+  if (!analogContinuous(pins, 1, MQ2_ADC_CONVERSIONS, MQ2_ADC_FREQ_HZ, nullptr) || !analogContinuousStart()) {
+    LOG_ERROR("❌ MQ2: no se pudo arrancar el ADC continuo, gas sin datos.");
+    return;
+  }
+  if (isnan(r0Kohm)) {
+    LOG_INFO("🧪 MQ2: sin R0 guardado, calibra tras %lu s de calentamiento", (unsigned long)(MQ2_WARMUP_MS / 1000));
+  } else {
+    LOG_INFO("🧪 MQ2: R0 %.2f kΩ de NVS", r0Kohm);
+  }
+}
+
+// Solo tras calibrar o si R0 deriva más de saveDrift: unas pocas escrituras al día
+void saveGasCalibration(float r0Kohm) {
+  const Mq2Config& config = gasSensor.config();
+  Mq2Calibration stored = {MQ2_NVS_VERSION, r0Kohm, config.supplyMv, config.loadKohm, config.pinScale};
+  Preferences prefs;
+  if (prefs.begin(MQ2_NVS_NAMESPACE, false)) {
+    prefs.putBytes(MQ2_NVS_KEY, &stored, sizeof(stored));
+    prefs.end();
+  }
+  LOG_INFO("🧪 MQ2: R0 %.2f kΩ guardado", r0Kohm);
+}
+
+// Sin canal RMT las lecturas fallan sin respuesta y los valores quedan en NAN
+void initDht() {
+  Dht11Config config;
+  config.maxRetries = DHT_MAX_RETRIES;
+  config.maxFailures = DHT_MAX_FAILURES;
+  dht.configure(config);
+  if (!dhtLine.begin((gpio_num_t)DHTPIN)) LOG_ERROR("❌ DHT11: sin canal RMT, temperatura y humedad sin datos.");
+}
+
+bool initBmp() {
+  if (!bmp.begin(&i2cBus)) return false;
+  bmp.setOversampling(BMP_OVERSAMPLING);
+  bmp.setAveraging(BMP_AVERAGING);
+  bmp.setSeaLevelPressure(BMP_SEA_LEVEL_HPA);
+  return true;
+}
+
+bool initLight() {
+  I2cLock lock;
+  return lightMeter.begin();
+}
+
+// =============================================================
+// === Seguimiento del arranque ===
+// =============================================================
+// Llamada desde la tarea de red: anota los hitos según llegan y, al
+// completarse, publica las métricas de arranque una sola vez.
+void serviceBoot() {
+  if (boot.stage() != BootStage::NETWORK) return;
+  const uint32_t now = millis();
+  if (wifiConnected && boot.mark(BOOT_WIFI, now)) {
+    LOG_INFO("🚀 WiFi a los %lu ms", (unsigned long)boot.elapsedMs(BOOT_WIFI));
+  }
+  if (mqttConnected && boot.mark(BOOT_MQTT, now)) {
+    LOG_INFO("🚀 MQTT a los %lu ms", (unsigned long)boot.elapsedMs(BOOT_MQTT));
+  }
+  if (timeSynced() && boot.mark(BOOT_TIME_SYNC, now)) {
+    LOG_INFO("🚀 Hora NTP a los %lu ms", (unsigned long)boot.elapsedMs(BOOT_TIME_SYNC));
+  }
+  if (!boot.complete() || !mqttClient.connected()) return;
+
+  char report[BOOT_REPORT_MAX_LEN];
+  const size_t len = boot.writeReport(report, sizeof(report));
+  if (len == 0 || PublishMqttTo(mqttBootTopic, report, len, false) == 0) return;
+  LOG_INFO("🚀 Arranque completo: primera muestra %lu ms, primera publicación %lu ms",
+           (unsigned long)boot.elapsedMs(BOOT_FIRST_SAMPLE), (unsigned long)boot.elapsedMs(BOOT_FIRST_PUBLISH));
+  boot.advance(BootStage::READY);
+  // Desde aquí ninguna tarea del firmware debería reservar memoria
+  heapAllocations.markSteady();
   displayNeedsUpdate = true;
+}
+
+// =============================================================
+// === WiFi: reconexión rápida ===
+// =============================================================
+// Solo configura; el primer intento lo lanza serviceWiFi() desde la tarea
+// de red, que es la única que toca la política.
+void initWiFi() {
+  WiFi.persistent(false);       // el SDK no reescribe su configuración en flash en cada begin()
+  WiFi.setAutoReconnect(false);  // los reintentos los decide wifiPolicy
+  WiFi.mode(WIFI_STA);
+  WiFi.setHostname(hostname);
+
+  WiFiPolicyConfig config;
+  config.fastReconnect = WIFI_FAST_RECONNECT;
+  config.reuseLease = WIFI_REUSE_LEASE;
+  config.staticConfig = WIFI_STATIC_IP;
+  wifiPolicy.configure(config);
 
-  introLog("✅ Sistema iniciado correctamente.", ANSI_GREEN);
+  WiFiLinkCache cache;
+  Preferences prefs;
+  if (prefs.begin(WIFI_NVS_NAMESPACE, true)) {
+    if (prefs.getBytes(WIFI_NVS_KEY, &cache, sizeof(cache)) == sizeof(cache)) wifiPolicy.loadCache(cache);
+    prefs.end();
+  }
+  LOG_INFO("📶 WiFi: %s", wifiPolicy.cache().valid() ? "enlace guardado, conexión directa" : "sin enlace guardado, escaneo");
+}
+
+// Tarea de eventos WiFi: solo copia el evento para la tarea de red
+void onWiFiLinkEvent(WiFiEvent_t event, arduino_event_info_t info) {
+  WiFiLinkEvent e{};
+  e.atMs = millis();
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_CONNECTED:
+      e.type = WiFiLinkEvent::ASSOCIATED;
+      memcpy(e.bssid, info.wifi_sta_connected.bssid, sizeof(e.bssid));
+      e.channel = info.wifi_sta_connected.channel;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      e.type = WiFiLinkEvent::GOT_IP;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      e.type = WiFiLinkEvent::DISCONNECTED;
+      e.reason = info.wifi_sta_disconnected.reason;
+      break;
+    default:
+      return;
+  }
+  wifiEvents.push(e);
+}
+
+void serviceWiFi() {
+  if (wifiPolicy.state() == WiFiPolicyState::IDLE) wifiPolicy.start(millis());
+
+  WiFiLinkEvent e;
+  while (wifiEvents.pop(e)) {
+    if (e.type == WiFiLinkEvent::ASSOCIATED) {
+      wifiPolicy.onAssociated(e.bssid, e.channel);
+    } else if (e.type == WiFiLinkEvent::DISCONNECTED) {
+      wifiPolicy.onDisconnected(e.reason, e.atMs);
+    } else {
+      WiFiLease lease;
+      lease.ip = WiFi.localIP();
+      lease.gateway = WiFi.gatewayIP();
+      lease.subnet = WiFi.subnetMask();
+      lease.dns = WiFi.dnsIP();
+      wifiPolicy.onGotIp(lease, e.atMs);
+      const WiFiConnectMetrics& m = wifiPolicy.metrics();
+      LOG_INFO("📶 WiFi en %lu ms (%s, %s) | media %lu ms, %lu fallos", (unsigned long)m.lastLatencyMs,
+               WiFiPolicy::kindName(m.lastKind), WiFiPolicy::addressingName(m.lastAddressing),
+               (unsigned long)m.meanLatencyMs(), (unsigned long)m.failures);
+    }
+  }
+  wifiPolicy.poll(millis());
+
+  WiFiLinkCache cache;
+  if (wifiPolicy.takeCacheUpdate(cache)) {
+    Preferences prefs;
+    if (prefs.begin(WIFI_NVS_NAMESPACE, false)) {
+      prefs.putBytes(WIFI_NVS_KEY, &cache, sizeof(cache));
+      prefs.end();
+    }
+  }
+}
+
+// Sin NTP las lecturas esperan en la cola para salir ya fechadas; pasado
+// TIME_SYNC_GRACE_MS se publican igualmente
+bool clockReady() {
+  return boot.reached(BOOT_TIME_SYNC) || timeSynced() || millis() >= TIME_SYNC_GRACE_MS;
+}
+
+void resolveTimestamp(SensorData& data) {
+  if (data.timestampMs == 0) data.timestampMs = epochFromUptime(data.uptimeMs);
+}
+
+// Solo las de este arranque: tras un reinicio, uptimeMs ya no significa nada
+void resolveTimestamp(StoredReading& reading) {
+  if (reading.timestampMs == 0 && reading.bootId == bootId) reading.timestampMs = epochFromUptime(reading.uptimeMs);
 }
 
 // =============================================================
 // === LOOP ===
 // =============================================================
+// Todo el trabajo lo hacen sensorTask() y networkTask()
 void loop() {
-  HandleMqttTasks();
-  mqttConnected = mqttClient.connected();
+  vTaskDelete(nullptr);
+}
 
-  unsigned long now = millis();
-  if (now - lastPublishMillis >= PUBLISH_INTERVAL_MS) {
-    introLog("📡 Publicando nuevos datos...");
-    publishCurrentData();
-    lastPublishMillis = now;
+// =============================================================
+// === Tarea de sensores (APP_CPU) ===
+// =============================================================
+// Ejecuta el planificador y duerme hasta el siguiente plazo. Nunca toca la
+// red: una DNS lenta o un volcado de depuración no retrasan el muestreo.
+void sensorTask(void* parameter) {
+  for (;;) {
+    DIAG_LOOP(DIAG_LOOP_SENSORS);
+    if (sampleRequested.exchange(false)) {
+      publishRequested = true;
+      scheduler.runNow(publishTaskId);
+    }
+    scheduler.runDue();
+    uint32_t sleepMs = scheduler.msUntilNextDue();
+    if (sleepMs > SENSOR_TASK_MAX_SLEEP_MS) sleepMs = SENSOR_TASK_MAX_SLEEP_MS;
+    TickType_t ticks = pdMS_TO_TICKS(sleepMs);
+    vTaskDelay(ticks > 0 ? ticks : 1);
   }
+}
 
-  updateDisplayIfNeeded();
-  delay(10);
+// =============================================================
+// === Tarea de red, serialización y pantalla (PRO_CPU) ===
+// =============================================================
+// Despierta cuando la tarea de sensores deja una lectura, o cada
+// NETWORK_TASK_POLL_MS para atender ACKs, reconexiones y la pantalla.
+void networkTask(void* parameter) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(NETWORK_TASK_POLL_MS));
+    DIAG_LOOP(DIAG_LOOP_NETWORK);
+    serviceWiFi();
+    HandleMqttTasks();
+    mqttConnected = mqttClient.connected();
+    serviceBoot();
+    serviceReadingQueue();
+
+    SensorData data;
+    while (sensorQueue.pop(data)) publishCurrentData(data);
+    serviceCommands();
+
+    serviceDisplay();
+    serviceDiagnostics();
+  }
 }
 
 // =============================================================
-// === Lectura de sensores ===
+// === Tarea de log ===
 // =============================================================
-SensorData readSensors() {
-  introLog("🔍 Lectura de sensores en curso...", ANSI_BLUE);
+void logTask(void* parameter) {
+  for (;;) {
+    logger.drain();
+    vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_MS));
+  }
+}
+
+void writeSerial(const char* text, size_t len) {
+  Serial.write((const uint8_t*)text, len);
+}
 
-  SensorData data;
-  data.temperatureC = dht.readTemperature();
-  data.humidityPercent = dht.readHumidity();
+// =============================================================
+// === Tareas de muestreo ===
+// =============================================================
+void initScheduler() {
+  statsWindow.setEwmaAlpha(STATS_EWMA_ALPHA);
+  statsWindow.open(millis());
+
+  ReportPolicyConfig policy;
+  policy.minIntervalMs = PUBLISH_INTERVAL_MS;
+  policy.heartbeatMs = REPORT_HEARTBEAT_MS;
+  policy.gasLevelCount = 0;  // el nivel es la calidad del MQ-2, con su histéresis
+  policy.windGustLevels[0] = WIND_umbral_fuerte;
+  policy.windGustLevels[1] = WIND_umbral_temporal;
+  policy.windGustLevels[2] = WIND_umbral_borrasca;
+  policy.windGustLevelCount = 3;
+  reportFilter.configure(policy);
+  commandPolicy = policy;
+  scheduler.add("wind", SAMPLE_WIND_MS, 0, sampleWind);
+  scheduler.add("mq2", SAMPLE_MQ2_MS, 0, sampleGas, nullptr, 50);
+  scheduler.add("light", SAMPLE_LIGHT_MS, 0, sampleLight, nullptr, 100);
+  scheduler.add("dht", SAMPLE_DHT_MS, dht.config().startLowMs, sampleDht, collectDht, 150);
+  scheduler.add("bmp", SAMPLE_BMP_MS, Bmp085Async::TEMPERATURE_CONVERSION_MS, sampleBmp, collectBmp, 200);
+  // Primera publicación en cuanto todos los canales tienen al menos un valor
+  publishTaskId = scheduler.add("publish", REPORT_CHECK_MS, 0, runPublishTask, nullptr, 500);
+  scheduler.add("devices", DEVICE_RETRY_MS, 0, retryDevices, nullptr, DEVICE_RETRY_MS);
+  scheduler.add("metrics", SCHEDULER_LOG_MS, 0, logSchedulerMetrics, nullptr, SCHEDULER_LOG_MS);
+}
 
-  if (isnan(data.temperatureC) || isnan(data.humidityPercent)) {
-    delay(200);
-    data.temperatureC = dht.readTemperature();
-    data.humidityPercent = dht.readHumidity();
+// Reintenta los sensores que no respondieron al arrancar (o que se perdieron)
+bool retryDevices() {
+  if (boot.degraded(DEVICE_LIGHT) && initLight()) {
+    boot.setDegraded(DEVICE_LIGHT, false);
+    LOG_INFO("✅ BH1750 recuperado.");
   }
+  if (boot.degraded(DEVICE_BMP) && initBmp()) {
+    boot.setDegraded(DEVICE_BMP, false);
+    LOG_INFO("✅ BMP180/BMP085 recuperado.");
+  }
+  return false;
+}
+
+bool sampleWind() {
+  WindReading wind = measureWind();
+  currentReadings.windSpeedKmh = wind.meanKmh;
+  currentReadings.windSpeedMs = wind.meanKmh / 3.6f;
+  currentReadings.windGustKmh = wind.gustKmh;
+  statsWindow.windSpeedKmh.add(wind.intervalKmh);
+  return false;
+}
+
+// Consume las tramas completas desde la última vez. Llegan a ritmo fijo,
+// así que su instante se estima sumando MQ2_FRAME_MS; si se ha perdido
+// alguna (pool lleno) se vuelve a alinear con millis().
+bool sampleGas() {
+  if (gasCalibrationRequested.exchange(false)) {
+    gasSensor.recalibrate();
+    LOG_INFO("🧪 MQ2: recalibrando R0, mantener en aire limpio %lu s", (unsigned long)(MQ2_CALIBRATION_MS / 1000));
+  }
+  adc_continuous_data_t* frame = nullptr;
+  bool fresh = false;
+  while (analogContinuousRead(&frame, 0)) {
+    const uint32_t now = millis();
+    gasFrameMs += MQ2_FRAME_MS;
+    if ((int32_t)(now - gasFrameMs) > (int32_t)(2 * MQ2_FRAME_MS) || (int32_t)(gasFrameMs - now) > 0) gasFrameMs = now;
+    gasSensor.addFrame(gasFrameMs, (float)frame[0].avg_read_mvolts, (float)frame[0].avg_read_raw);
+    fresh = true;
+  }
+  if (!fresh) return false;
+  currentReadings.gasRaw = gasSensor.filteredRaw();
+  currentReadings.gasPpm = gasSensor.ppm();
+  currentReadings.gasQuality = gasSensor.quality();
+  statsWindow.gasRaw.add(currentReadings.gasRaw);
 
-  data.pressureHpa = bmp.readPressure() / 100.0f;
-  data.altitudeMeters = bmp.readAltitude();
-  data.lightLux = lightMeter.readLightLevel();
-  data.gasRaw = analogRead(MQ2_AO);
-  data.windSpeedKmh = measureWind();
-  data.windSpeedMs = data.windSpeedKmh / 3.6f;
-  data.gasQuality = getCalidadAire(data.gasRaw);
+  float r0Kohm;
+  if (gasSensor.takeR0ToSave(r0Kohm)) saveGasCalibration(r0Kohm);
+  return false;
+}
+
+bool sampleLight() {
+  if (boot.degraded(DEVICE_LIGHT)) return false;
+  DIAG_SCOPE(DIAG_LIGHT);
+  I2cLock lock;
+  currentReadings.lightLux = lightMeter.readLightLevel();
+  statsWindow.lightLux.add(currentReadings.lightLux);
+  return false;
+}
 
+// Señal de inicio; la captura, la decodificación y el reintento (sin
+// bloquear, como el BMP) los avanza collectDht()
+bool sampleDht() {
+  DIAG_SCOPE(DIAG_DHT);
+  return dht.start(millis()) > 0;
+}
+
+uint32_t collectDht() {
+  DIAG_SCOPE(DIAG_DHT);
+  const uint32_t wait = dht.poll(millis());
+  if (wait > 0 || !dht.takeUpdate()) return wait;
+  // Una lectura fallida deja el último valor hasta DHT_MAX_FAILURES seguidas
+  currentReadings.temperatureC = dht.temperatureC();
+  currentReadings.humidityPercent = dht.humidityPercent();
+  if (dht.lastError() != DhtError::NONE) {
+    LOG_DEBUG("DHT11: lectura fallida (%s), %u seguidas", dhtErrorName(dht.lastError()),
+              (unsigned)dht.consecutiveFailures());
+    return 0;
+  }
+  statsWindow.temperatureC.add(currentReadings.temperatureC);
+  statsWindow.humidityPercent.add(currentReadings.humidityPercent);
+  return 0;
+}
+
+// Lanza la conversión de temperatura; el resto lo avanza collectBmp()
+bool sampleBmp() {
+  if (boot.degraded(DEVICE_BMP)) return false;
+  DIAG_SCOPE(DIAG_BMP);
+  return bmp.start() > 0;
+}
+
+uint32_t collectBmp() {
+  DIAG_SCOPE(DIAG_BMP);
+  uint32_t wait = bmp.poll();
+  if (wait > 0) return wait;
+  if (bmp.failed()) {
+    currentReadings.pressureHpa = NAN;
+    currentReadings.altitudeMeters = NAN;
+    return 0;
+  }
+  currentReadings.pressureHpa = bmp.pressureHpa();
+  currentReadings.altitudeMeters = bmp.altitudeMeters();
+  statsWindow.pressureHpa.add(currentReadings.pressureHpa);
+  return 0;
+}
+
+// Toma la instantánea de todos los canales y, si el filtro de publicación
+// la deja pasar, cierra la ventana de estadísticas y la entrega a la tarea
+// de red. Una lectura suprimida no se encola: la ventana sigue abierta.
+bool runPublishTask() {
+  DIAG_SCOPE(DIAG_SNAPSHOT);
+  if (policyPending.exchange(false)) {
+    portENTER_CRITICAL(&pendingPolicyMux);
+    reportFilter.configure(pendingPolicy);
+    portEXIT_CRITICAL(&pendingPolicyMux);
+  }
+  SensorData data = readSensors();
+  ReportReason reason = reportFilter.check(data, millis(), publishRequested);
+  publishRequested = false;
+  if (reason == ReportReason::SUPPRESSED) return false;
+
+  data.stats = statsWindow.close(millis());
+  boot.mark(BOOT_FIRST_SAMPLE, millis());
+  if (!sensorQueue.push(data)) {
+    LOG_ERROR("❌ Cola de lecturas entre núcleos llena (%u descartadas)", (unsigned)sensorQueue.dropped());
+  }
+  if (networkTaskHandle) xTaskNotifyGive(networkTaskHandle);
+  LOG_INFO("📨 Envío por %s | enviados %lu, suprimidos %lu", ReportFilter::reasonName(reason),
+           (unsigned long)reportFilter.sent(), (unsigned long)reportFilter.suppressed());
+  return false;
+}
+
+// Tarea propia del planificador: un resumen cada SCHEDULER_LOG_MS con los
+// máximos de esa ventana
+bool logSchedulerMetrics() {
+  const SchedulerMetrics& m = scheduler.metrics();
+  LOG_INFO("⏱ Loop: media %lu us, máx %lu us | bloqueo máx %lu us (%s) | retraso máx %lu ms",
+           (unsigned long)m.meanLoopGapUs, (unsigned long)m.maxLoopGapUs, (unsigned long)m.maxStepUs,
+           m.maxStepTask, (unsigned long)m.maxLatenessMs);
+  scheduler.resetMetrics();
+  return false;
+}
+
+// =============================================================
+// === Lectura de sensores ===
+// =============================================================
+// Ya no lee los sensores: devuelve el último valor de cada canal, que las
+// tareas del planificador mantienen actualizado a su propio ritmo. Solo se
+// llama desde la tarea de sensores; la marca de tiempo es la del muestreo
+// (si aún no hay NTP, la tarea de red la completa luego desde uptimeMs).
+SensorData readSensors() {
+  SensorData data = currentReadings;
+  data.timestampMs = currentEpochMs();
+  data.uptimeMs = millis();
   return data;
 }
 
@@ -240,136 +1187,680 @@ SensorData readSensors() {
 // === Logs de datos de sensores ===
 // =============================================================
 void logSensorData(const SensorData& data) {
-  introLog("📊 Lecturas obtenidas:", ANSI_CYAN);
-  Serial.printf(ANSI_GREEN "🌡 Temp: %.1f °C\n" ANSI_RESET, data.temperatureC);
-  Serial.printf(ANSI_GREEN "💧 Humedad: %.1f %%\n" ANSI_RESET, data.humidityPercent);
-  Serial.printf(ANSI_GREEN "🧭 Presión: %.1f hPa\n" ANSI_RESET, data.pressureHpa);
-  Serial.printf(ANSI_GREEN "⛰ Altitud: %.1f m\n" ANSI_RESET, data.altitudeMeters);
-  Serial.printf(ANSI_GREEN "☀️ Luz: %.1f lx\n" ANSI_RESET, data.lightLux);
-  Serial.printf(ANSI_GREEN "🌬 Viento: %.1f km/h (%.2f m/s)\n" ANSI_RESET, data.windSpeedKmh, data.windSpeedMs);
-  Serial.printf(ANSI_GREEN "🧪 MQ2: %d (%s)\n" ANSI_RESET, data.gasRaw, data.gasQuality.c_str());
-  Serial.println(ANSI_CYAN "===================================================\n" ANSI_RESET);
+  DIAG_SCOPE(DIAG_LOG);
+  LOG_INFO("📊 T %.1f °C | H %.1f %% | P %.1f hPa | Alt %.1f m", data.temperatureC, data.humidityPercent,
+           data.pressureHpa, data.altitudeMeters);
+  LOG_INFO("📊 Luz %.1f lx | Viento %.1f km/h (%.2f m/s), racha %.1f km/h | MQ2 %d, %.0f ppm (%s)", data.lightLux,
+           data.windSpeedKmh, data.windSpeedMs, data.windGustKmh, data.gasRaw, data.gasPpm,
+           airQualityLabel(data.gasQuality));
 }
 
 // =============================================================
 // === Construcción de JSON ===
 // =============================================================
-String buildSensorPayload(const SensorData& data) {
-  introLog("🧱 Construyendo JSON de datos...", ANSI_YELLOW);
-
-  StaticJsonDocument<512> doc;
-  doc["sensor_id"] = "WS_001";
-  doc["sensor_type"] = "weather";
-  doc["street_id"] = "ST_1253";
-  doc["timestamp"] = getTimestampISO8601();
+// Escribe el esquema json/json-general directamente en `out`, sin String ni
+// ArduinoJson. Devuelve la longitud del payload, o 0 si no cabe.
+size_t buildSensorPayload(const SensorData& data, char* out, size_t capacity) {
+  DIAG_SCOPE(DIAG_SERIALIZE);
+  LOG_DEBUG("🧱 Construyendo JSON de datos...");
 
-  JsonObject location = doc.createNestedObject("location");
-  location["latitude"] = 40.4094736;
-  location["longitude"] = -3.6920903;
-  location["altitude_meters"] = data.altitudeMeters;
-  location["district"] = "Centro";
-  location["neighborhood"] = "Universidad";
-
-  JsonObject readings = doc.createNestedObject("data");
-  readings["temperature_celsius"] = data.temperatureC;
-  readings["humidity_percentage"] = data.humidityPercent;
-  readings["wind_speed"] = data.windSpeedKmh;
-  readings["luz"] = data.lightLux;
-  readings["atmospheric_pressure_hpa"] = data.pressureHpa;
-  readings["air_quality_index"] = data.gasRaw;
-
-  String json;
-  serializeJson(doc, json);
-  return json;
+  char timestamp[TIMESTAMP_MAX_LEN];
+  formatTimestampISO8601(data.timestampMs, timestamp, sizeof(timestamp), TIMESTAMP_UTC, TIMESTAMP_MILLIS);
+  return writeSensorPayload(data, timestamp, out, capacity);
 }
 
 // =============================================================
 // === Publicación de datos MQTT ===
 // =============================================================
-void publishCurrentData() {
-  SensorData data = readSensors();
+void publishCurrentData(const SensorData& sample) {
+  DIAG_SCOPE(DIAG_CYCLE);
+  LOG_INFO("📡 Publicando nuevos datos...");
+  SensorData data = sample;
+  resolveTimestamp(data);
   latestSensorData = data;
   hasSensorData = true;
   displayNeedsUpdate = true;
 
   logSensorData(data);
+  const DisplayMetrics& oled = pages.metrics();
+  LOG_DEBUG("🖥 OLED: %lu refrescos, último %lu B en %lu us, máx %lu B / %lu us", (unsigned long)oled.refreshes,
+            (unsigned long)oled.lastBytes, (unsigned long)oled.lastUs, (unsigned long)oled.maxBytes,
+            (unsigned long)oled.maxUs);
 
-  String payload = buildSensorPayload(data);
-  if (!PublishMqtt(payload)) {
-    introLog("❌ Error publicando datos MQTT.", ANSI_RED);
+  StoredReading record = StoredReading::from(data, bootId);
+  if (BATCH_MODE) {
+    enqueueReading(record);
+    LOG_INFO("📦 Lectura añadida al lote.");
+    return;
+  }
+  if (!queueDrainEnabled || !mqttClient.connected() || !readingQueue.empty() || inflightReading.active ||
+      !clockReady()) {
+    enqueueReading(record);
+    LOG_WARN("📦 Lectura guardada en la cola persistente.");
+    return;
+  }
+
+  // En directo sale con el bloque stats; si hay que reenviarla desde la cola, sin él
+  uint16_t packetId = PAYLOAD_FORMAT == PAYLOAD_FORMAT_CBOR ? publishStoredReading(record, mqttRetainReadings)
+                                                            : publishJsonReading(data, mqttRetainReadings);
+  if (packetId == 0) {
+    enqueueReading(record);
+    LOG_ERROR("❌ Error publicando datos MQTT.");
   } else {
-    introLog("✅ Datos MQTT publicados correctamente.", ANSI_GREEN);
+    inflightReading.active = true;
+    inflightReading.queued = false;
+    inflightReading.packetId = packetId;
+    inflightReading.count = 1;
+    inflightReading.sentMillis = millis();
+    inflightReading.reading = record;
+    LOG_INFO("✅ Datos MQTT publicados correctamente.");
   }
 }
 
 // =============================================================
-// === Actualización OLED ===
+// === Cola persistente de lecturas ===
 // =============================================================
-void updateDisplayIfNeeded() {
-  if (!displayNeedsUpdate) return;
-  displayNeedsUpdate = false;
+void initReadingQueue() {
+  if (!LittleFS.begin(true) || !readingStorage.open(READING_QUEUE_PATH)) {
+    LOG_WARN("⚠️ LittleFS no disponible: la cola de lecturas no es persistente.");
+  }
+  readingQueue.begin(&readingStorage);
+  if (readingQueue.migrated() > 0) {
+    LOG_INFO("📦 %u lecturas convertidas del formato WSQ2 (sin gas_ppm)", (unsigned)readingQueue.migrated());
+  }
 
-  display.clearDisplay();
-  display.setTextSize(1);
-  display.setCursor(0, 0);
+  batchPolicy.maxReadings = BATCH_ROWS;
+  batchPolicy.maxAgeMs = MQTT_BATCH_MAX_AGE_MS;
+  batchPolicy.maxBytes = MQTT_BATCH_MAX_BYTES < sizeof(batchBuffer) ? MQTT_BATCH_MAX_BYTES : sizeof(batchBuffer);
+  batchOpenedMillis = millis();
 
-  String hora = getLocalTimeString();
-  display.printf("== Estacion Local ==\n%s\n", hora.c_str());
+  LOG_INFO("📦 Lecturas pendientes en cola: %u", (unsigned)readingQueue.size());
+}
 
-  if (!mqttConnected) {
-    display.setTextSize(1);
-    display.setCursor(0, 24);
-    display.println("⚠️ MQTT sin conexión");
-    display.display();
-    return;
+uint16_t publishStoredReading(const StoredReading& stored, bool retain) {
+  StoredReading reading = stored;
+  resolveTimestamp(reading);
+  if (PAYLOAD_FORMAT == PAYLOAD_FORMAT_CBOR) {
+    size_t binaryLen = 0;
+    {
+      DIAG_SCOPE(DIAG_SERIALIZE);
+      binaryLen = binaryEncoder.encode(reading, STATION_SENSOR_ID, binaryBuffer, sizeof(binaryBuffer));
+    }
+    if (binaryLen == 0) return 0;
+    DIAG_SCOPE(DIAG_PUBLISH);
+    const uint16_t packetId = PublishMqttTo(mqttCborTopic, (const char*)binaryBuffer, binaryLen, retain);
+    // encode() ya tomó esta lectura como base de los deltas; si no ha salido,
+    // el siguiente mensaje no puede apoyarse en ella
+    if (packetId == 0) binaryEncoder.forceKeyframe();
+    return packetId;
   }
 
-  if (!hasSensorData) {
-    display.println("Sin lecturas");
-    display.display();
+  // gas_ppm sale con el valor del muestreo (null si el MQ-2 aún calibraba)
+  SensorData data = reading.toSensorData();
+  return publishJsonReading(data, retain);
+}
+
+uint16_t publishJsonReading(const SensorData& data, bool retain) {
+  if (PAYLOAD_SPLIT_TOPICS) return publishSplitReading(data, retain);
+  size_t payloadLen = buildSensorPayload(data, payloadBuffer, sizeof(payloadBuffer));
+  if (payloadLen == 0) return 0;
+  DIAG_SCOPE(DIAG_PUBLISH);
+  return PublishMqtt(payloadBuffer, payloadLen, retain);
+}
+
+// Una publicación por métrica en MQTT_TOPIC "/<subtema>" con la cabecera
+// escrita una sola vez. Devuelve el id de la última: el broker confirma los
+// QoS1 en orden, así que su PUBACK cubre a las anteriores. Si alguna falla
+// devuelve 0 y la lectura vuelve entera a la cola (el colector fusiona los
+// duplicados por instante).
+uint16_t publishSplitReading(const SensorData& data, bool retain) {
+  SplitPayloadWriter writer(splitBuffer, sizeof(splitBuffer));
+  {
+    DIAG_SCOPE(DIAG_SERIALIZE);
+    char timestamp[TIMESTAMP_MAX_LEN];
+    formatTimestampISO8601(data.timestampMs, timestamp, sizeof(timestamp), TIMESTAMP_UTC, TIMESTAMP_MILLIS);
+    if (!writer.begin(stationInfo, data, timestamp)) return 0;
+  }
+  char topic[sizeof(MQTT_TOPIC) + 16];
+  uint16_t packetId = 0;
+  for (const PayloadSchema* schema : SPLIT_SCHEMAS) {
+    size_t payloadLen = 0;
+    {
+      DIAG_SCOPE(DIAG_SERIALIZE);
+      payloadLen = writer.write(*schema, data);
+    }
+    if (payloadLen == 0) return 0;
+    snprintf(topic, sizeof(topic), "%s/%s", mqttPublishTopic, schema->subtopic);
+    DIAG_SCOPE(DIAG_PUBLISH);
+    packetId = PublishMqttTo(topic, writer.buffer(), payloadLen, retain);
+    if (packetId == 0) return 0;
+  }
+  return packetId;
+}
+
+// Arma un lote con las lecturas más antiguas de la cola y lo publica
+uint16_t publishBatch(uint32_t& firstSeq, uint32_t& count) {
+  StoredReading rows[BATCH_ROWS];
+  const size_t limit = batchPolicy.rowLimit();
+  count = 0;
+  if (limit == 0 || !readingQueue.peek(rows[0], firstSeq)) return 0;
+  uint32_t seq;
+  for (count = 1; count < limit; count++) {
+    if (!readingQueue.peekAt(count, rows[count], seq)) break;
+  }
+  for (uint32_t i = 0; i < count; i++) resolveTimestamp(rows[i]);
+  size_t payloadLen = 0;
+  {
+    DIAG_SCOPE(DIAG_SERIALIZE);
+    payloadLen = writeBatchPayload(rows, count, batchBuffer, sizeof(batchBuffer));
+  }
+  if (payloadLen == 0) return 0;
+  DIAG_SCOPE(DIAG_PUBLISH);
+  return PublishMqttTo(mqttBatchTopic, batchBuffer, payloadLen, false);
+}
+
+void enqueueReading(const StoredReading& reading) {
+  DIAG_SCOPE(DIAG_STORE);
+  if (readingQueue.empty() && !inflightReading.active) batchOpenedMillis = millis();
+  // Mantiene el orden: si la lectura en vuelo aún no tiene ACK, entra antes
+  if (inflightReading.active && !inflightReading.queued) {
+    inflightReading.seq = readingQueue.push(inflightReading.reading);
+    inflightReading.queued = true;
+  }
+  readingQueue.push(reading);
+}
+
+// Callbacks invocados desde la tarea de AsyncMqttClient
+void ResumeReadingQueue() { queueDrainEnabled = true; }
+void PauseReadingQueue() { queueDrainEnabled = false; }
+void OnReadingAcknowledged(uint16_t packetId) { publishAcks.record(packetId); }
+
+// Llamada desde loop(): confirma ACKs y reenvía la cola a ritmo limitado
+void serviceReadingQueue() {
+  unsigned long now = millis();
+
+  if (inflightReading.active) {
+    if (publishAcks.take(inflightReading.packetId)) {
+      if (inflightReading.queued) {
+        DIAG_SCOPE(DIAG_STORE);
+        for (uint32_t i = 0; i < inflightReading.count; i++) readingQueue.pop(inflightReading.seq + i);
+      }
+      inflightReading.active = false;
+      batchOpenedMillis = now;
+      boot.mark(BOOT_FIRST_PUBLISH, now);
+    } else if (!queueDrainEnabled || now - inflightReading.sentMillis > QUEUE_ACK_TIMEOUT_MS) {
+      // Sin ACK: la lectura queda en la cola para reenviarse tras reconectar
+      if (!inflightReading.queued) {
+        DIAG_SCOPE(DIAG_STORE);
+        readingQueue.push(inflightReading.reading);
+      }
+      inflightReading.active = false;
+      // El receptor puede no haber visto el mensaje: el siguiente no lleva deltas
+      binaryEncoder.forceKeyframe();
+    } else {
+      return;
+    }
+  }
+
+  if (!queueDrainEnabled || !mqttClient.connected() || readingQueue.empty() || !clockReady()) return;
+  if (now - lastQueueDrainMillis < QUEUE_DRAIN_INTERVAL_MS) return;
+
+  if (BATCH_MODE) {
+    if (!batchPolicy.shouldFlush(readingQueue.size(), now - batchOpenedMillis)) return;
+    lastQueueDrainMillis = now;
+    uint32_t firstSeq = 0;
+    uint32_t count = 0;
+    uint16_t packetId = publishBatch(firstSeq, count);
+    if (packetId == 0) return;
+    inflightReading.active = true;
+    inflightReading.queued = true;
+    inflightReading.packetId = packetId;
+    inflightReading.seq = firstSeq;
+    inflightReading.count = count;
+    inflightReading.sentMillis = now;
     return;
   }
+  lastQueueDrainMillis = now;
 
-  display.printf("T: %.1fC H: %.1f%%\n", latestSensorData.temperatureC, latestSensorData.humidityPercent);
-  display.printf("Pres: %.1f hPa\n", latestSensorData.pressureHpa);
-  display.printf("Alt: %.1f m\n", latestSensorData.altitudeMeters);
-  display.printf("Luz: %.1f lx\n", latestSensorData.lightLux);
-  display.printf("Viento: %.1f km/h\n", latestSensorData.windSpeedKmh);
-  display.printf("Gas: %d (%s)\n", latestSensorData.gasRaw, latestSensorData.gasQuality.c_str());
-  display.display();
+  StoredReading reading;
+  uint32_t seq;
+  if (!readingQueue.peek(reading, seq)) return;
+
+  // Las lecturas atrasadas no se retienen: el mensaje retenido debe ser el último
+  uint16_t packetId = publishStoredReading(reading, false);
+  if (packetId == 0) return;
+  inflightReading.active = true;
+  inflightReading.queued = true;
+  inflightReading.packetId = packetId;
+  inflightReading.seq = seq;
+  inflightReading.count = 1;
+  inflightReading.sentMillis = now;
+  inflightReading.reading = reading;
 }
 
 // =============================================================
-// === Calidad del aire ===
+// === Pantalla OLED por páginas ===
 // =============================================================
-String getCalidadAire(int gasADC) {
-  if (gasADC > MQ2_umbral_horrible) return "PELIGROSA";
-  if (gasADC > MQ2_umbral_malo) return "MALA";
-  if (gasADC > MQ2_umbral_base) return "NORMAL";
-  return "BUENA";
+// Etiqueta fija + widget de valor que ocupa el resto de la fila
+int addDisplayField(int page, uint8_t row, const char* label) {
+  const uint8_t labelLen = (uint8_t)strlen(label);
+  if (labelLen > 0) pages.setText(page, pages.addText(page, 0, row, labelLen), label);
+  return pages.addText(page, labelLen, row, DISPLAY_TEXT_COLUMNS - labelLen);
+}
+
+void initDisplayPages() {
+  static const char* const TITLES[PAGE_COUNT] = {"Resumen", "Ambiente", "Viento/Luz", "Aire", "Red", "Mensaje"};
+  for (int p = 0; p < PAGE_COUNT; p++) {
+    pages.addPage(TITLES[p]);
+    pages.printf(p, pages.addText(p, 0, 0, 13), "%s %d/%d", TITLES[p], p + 1, (int)PAGE_COUNT);
+    fields.clock[p] = pages.addText(p, 13, 0, 8);
+  }
+
+  fields.temperature = addDisplayField(PAGE_SUMMARY, 2, "T: ");
+  fields.humidity = addDisplayField(PAGE_SUMMARY, 3, "H: ");
+  fields.pressure = addDisplayField(PAGE_SUMMARY, 4, "Pres: ");
+  fields.wind = addDisplayField(PAGE_SUMMARY, 5, "Viento: ");
+  fields.gas = addDisplayField(PAGE_SUMMARY, 6, "Gas: ");
+  fields.status = addDisplayField(PAGE_SUMMARY, 7, "");
+
+  fields.envTemperature = addDisplayField(PAGE_ENVIRONMENT, 2, "Temp: ");
+  fields.envRange = addDisplayField(PAGE_ENVIRONMENT, 3, "  min/max: ");
+  fields.envHumidity = addDisplayField(PAGE_ENVIRONMENT, 4, "Hum: ");
+  fields.envPressure = addDisplayField(PAGE_ENVIRONMENT, 5, "Pres: ");
+  fields.envAltitude = addDisplayField(PAGE_ENVIRONMENT, 6, "Alt: ");
+
+  fields.windMean = addDisplayField(PAGE_WIND_LIGHT, 2, "Media: ");
+  fields.windMs = addDisplayField(PAGE_WIND_LIGHT, 3, "       ");
+  fields.windGust = addDisplayField(PAGE_WIND_LIGHT, 4, "Racha: ");
+  fields.windRange = addDisplayField(PAGE_WIND_LIGHT, 5, "  max: ");
+  fields.light = addDisplayField(PAGE_WIND_LIGHT, 6, "Luz: ");
+
+  fields.gasRaw = addDisplayField(PAGE_AIR, 2, "MQ2: ");
+  fields.gasQuality = addDisplayField(PAGE_AIR, 3, "Calidad: ");
+  fields.gasRange = addDisplayField(PAGE_AIR, 4, "  max: ");
+  fields.gasPpm = addDisplayField(PAGE_AIR, 5, "Conc: ");
+
+  fields.wifi = addDisplayField(PAGE_NETWORK, 1, "WiFi: ");
+  fields.rssi = addDisplayField(PAGE_NETWORK, 2, "RSSI: ");
+  fields.ip = addDisplayField(PAGE_NETWORK, 3, "IP: ");
+  fields.mqtt = addDisplayField(PAGE_NETWORK, 4, "MQTT: ");
+  fields.queue = addDisplayField(PAGE_NETWORK, 5, "Cola: ");
+  fields.boot = addDisplayField(PAGE_NETWORK, 6, "Boot: ");
+  fields.display = addDisplayField(PAGE_NETWORK, 7, "OLED: ");
+
+  for (size_t i = 0; i < MESSAGE_LINES; i++) fields.message[i] = addDisplayField(PAGE_MESSAGE, 2 + i, "");
+
+  updateDisplayFields();
+}
+
+// Llamada desde la tarea de red: botones, contenido y volcado de lo que cambia
+void serviceDisplay() {
+  unsigned long now = millis();
+  if (buttonNext.update(digitalRead(BUTTON_NEXT) == HIGH, now)) pages.next();
+  if (buttonBack.update(digitalRead(BUTTON_BACK) == HIGH, now)) pages.prev();
+  if (boot.degraded(DEVICE_DISPLAY)) return;
+  DIAG_SCOPE(DIAG_DISPLAY);
+
+  if (displayNeedsUpdate.exchange(false) || now - lastDisplayRefreshMillis >= DISPLAY_REFRESH_MS) {
+    lastDisplayRefreshMillis = now;
+    updateDisplayFields();
+  }
+  pages.render(oledDevice);
+}
+
+// Solo cambia los textos; PagedDisplay marca sucios los que difieren
+void updateDisplayFields() {
+  const ClockText hora = getLocalTimeString();
+  for (int p = 0; p < PAGE_COUNT; p++) pages.setText(p, fields.clock[p], hora.c_str());
+
+  const SensorData& d = latestSensorData;
+  if (hasSensorData) {
+    pages.printf(PAGE_SUMMARY, fields.temperature, "%.1f C", d.temperatureC);
+    pages.printf(PAGE_SUMMARY, fields.humidity, "%.1f %%", d.humidityPercent);
+    pages.printf(PAGE_SUMMARY, fields.pressure, "%.1f hPa", d.pressureHpa);
+    pages.printf(PAGE_SUMMARY, fields.wind, "%.1f km/h", d.windSpeedKmh);
+    if (isnan(d.gasPpm)) {
+      pages.printf(PAGE_SUMMARY, fields.gas, "%d (%s)", d.gasRaw, airQualityLabel(d.gasQuality));
+    } else {
+      pages.printf(PAGE_SUMMARY, fields.gas, "%.0f ppm %s", d.gasPpm, airQualityLabel(d.gasQuality));
+    }
+
+    pages.printf(PAGE_ENVIRONMENT, fields.envTemperature, "%.1f C", d.temperatureC);
+    pages.printf(PAGE_ENVIRONMENT, fields.envRange, "%.0f/%.0f", d.stats.temperatureC.min, d.stats.temperatureC.max);
+    pages.printf(PAGE_ENVIRONMENT, fields.envHumidity, "%.1f %%", d.humidityPercent);
+    pages.printf(PAGE_ENVIRONMENT, fields.envPressure, "%.2f hPa", d.pressureHpa);
+    pages.printf(PAGE_ENVIRONMENT, fields.envAltitude, "%.1f m", d.altitudeMeters);
+
+    pages.printf(PAGE_WIND_LIGHT, fields.windMean, "%.1f km/h", d.windSpeedKmh);
+    pages.printf(PAGE_WIND_LIGHT, fields.windMs, "%.2f m/s", d.windSpeedMs);
+    pages.printf(PAGE_WIND_LIGHT, fields.windGust, "%.1f km/h", d.windGustKmh);
+    pages.printf(PAGE_WIND_LIGHT, fields.windRange, "%.1f km/h", d.stats.windSpeedKmh.max);
+    pages.printf(PAGE_WIND_LIGHT, fields.light, "%.1f lx", d.lightLux);
+
+    pages.printf(PAGE_AIR, fields.gasRaw, "%d", d.gasRaw);
+    pages.setText(PAGE_AIR, fields.gasQuality, airQualityLabel(d.gasQuality));
+    pages.printf(PAGE_AIR, fields.gasRange, "%.0f", d.stats.gasRaw.max);
+    if (isnan(d.gasPpm)) {
+      pages.setText(PAGE_AIR, fields.gasPpm, "calibrando");
+    } else {
+      pages.printf(PAGE_AIR, fields.gasPpm, "%.0f ppm", d.gasPpm);
+    }
+  }
+  pages.setText(PAGE_SUMMARY, fields.status, !mqttConnected ? "MQTT sin conexion" : hasSensorData ? "" : "Sin lecturas");
+
+  if (wifiPolicy.state() == WiFiPolicyState::CONNECTED) {
+    pages.printf(PAGE_NETWORK, fields.wifi, "ok %lu ms %s", (unsigned long)wifiPolicy.metrics().lastLatencyMs,
+                 WiFiPolicy::kindName(wifiPolicy.metrics().lastKind));
+  } else {
+    pages.setText(PAGE_NETWORK, fields.wifi, "sin conexion");
+  }
+  pages.printf(PAGE_NETWORK, fields.rssi, "%d dBm", (int)WiFi.RSSI());
+  pages.setText(PAGE_NETWORK, fields.ip, ipText(WiFi.localIP()).c_str());
+  pages.setText(PAGE_NETWORK, fields.mqtt, mqttConnected ? "conectado" : "sin conexion");
+  pages.printf(PAGE_NETWORK, fields.queue, "%u pendientes", (unsigned)readingQueue.size());
+  if (boot.degradedMask() != 0) {
+    char missing[DISPLAY_TEXT_COLUMNS + 1] = "falta";
+    for (size_t i = 0; i < BOOT_DEVICE_COUNT; i++) {
+      if (!boot.degraded((BootDevice)i)) continue;
+      strlcat(missing, " ", sizeof(missing));
+      strlcat(missing, BootSequence::deviceName((BootDevice)i), sizeof(missing));
+    }
+    pages.setText(PAGE_NETWORK, fields.boot, missing);
+  } else if (boot.stage() == BootStage::READY) {
+    pages.printf(PAGE_NETWORK, fields.boot, "listo en %lu ms", (unsigned long)boot.elapsedMs(BOOT_FIRST_PUBLISH));
+  } else {
+    pages.setText(PAGE_NETWORK, fields.boot, "en curso");
+  }
+  const DisplayMetrics& m = pages.metrics();
+  pages.printf(PAGE_NETWORK, fields.display, "%lu B %lu us", (unsigned long)m.lastBytes, (unsigned long)m.lastUs);
+
+  const size_t len = strlen(lastReceivedMessage);
+  for (size_t i = 0; i < MESSAGE_LINES; i++) {
+    const size_t offset = i * DISPLAY_TEXT_COLUMNS;
+    pages.setText(PAGE_MESSAGE, fields.message[i], offset < len ? lastReceivedMessage + offset : "");
+  }
+}
+
+// =============================================================
+// === Comandos remotos ===
+// =============================================================
+// {"cmd":"sample"}                              publica ya, sin pasar el filtro
+// {"cmd":"interval","min_ms":60000,"heartbeat_ms":600000}
+// {"cmd":"deadband","temperature":{"abs":0.5},"light":{"rel":0.2}}
+// {"cmd":"diag"}                                memoria, colas y contadores; adelanta /diag
+// {"cmd":"gas"}                                 estado del MQ-2, R0 y ppm
+// {"cmd":"gas","calibrate":true}                vuelve a medir R0 (en aire limpio)
+// {"cmd":"help"}
+// Sin argumentos, interval y deadband devuelven los valores actuales.
+CommandStatus commandSample(CommandRequest& request, CommandResult& result);
+CommandStatus commandInterval(CommandRequest& request, CommandResult& result);
+CommandStatus commandDeadband(CommandRequest& request, CommandResult& result);
+CommandStatus commandDiag(CommandRequest& request, CommandResult& result);
+CommandStatus commandGas(CommandRequest& request, CommandResult& result);
+CommandStatus commandHelp(CommandRequest& request, CommandResult& result);
+
+const CommandEntry COMMAND_TABLE[] = {
+  {"sample", commandSample},
+  {"interval", commandInterval},
+  {"deadband", commandDeadband},
+  {"diag", commandDiag},
+  {"gas", commandGas},
+  {"help", commandHelp},
+};
+CommandDispatcher<COMMAND_MAX_TOKENS> commands(COMMAND_TABLE, sizeof(COMMAND_TABLE) / sizeof(COMMAND_TABLE[0]));
+
+constexpr int32_t COMMAND_MIN_INTERVAL_MS = 1000;
+constexpr int32_t COMMAND_MAX_INTERVAL_MS = 3600000;      // 1 h
+constexpr int32_t COMMAND_MAX_HEARTBEAT_MS = 86400000;    // 24 h
+
+struct DeadbandField {
+  const char* name;
+  Deadband ReportPolicyConfig::*band;
+};
+const DeadbandField DEADBAND_FIELDS[] = {
+  {"temperature", &ReportPolicyConfig::temperatureC},
+  {"humidity", &ReportPolicyConfig::humidityPercent},
+  {"pressure", &ReportPolicyConfig::pressureHpa},
+  {"light", &ReportPolicyConfig::lightLux},
+  {"wind", &ReportPolicyConfig::windSpeedKmh},
+  {"gas", &ReportPolicyConfig::gasRaw},
+};
+
+// La tarea de sensores la aplica antes de su siguiente evaluación
+void queuePolicy() {
+  portENTER_CRITICAL(&pendingPolicyMux);
+  pendingPolicy = commandPolicy;
+  portEXIT_CRITICAL(&pendingPolicyMux);
+  policyPending = true;
+}
+
+CommandStatus commandSample(CommandRequest& request, CommandResult& result) {
+  sampleRequested = true;  // la tarea de sensores lo ve en menos de SENSOR_TASK_MAX_SLEEP_MS
+  result.flag("queued", true);
+  return CommandStatus::OK;
+}
+
+CommandStatus commandInterval(CommandRequest& request, CommandResult& result) {
+  int32_t minMs = (int32_t)commandPolicy.minIntervalMs;
+  int32_t heartbeatMs = (int32_t)commandPolicy.heartbeatMs;
+  const bool hasMin = request.has("/min_ms");
+  const bool hasHeartbeat = request.has("/heartbeat_ms");
+  if ((hasMin && !request.integer("/min_ms", minMs)) || (hasHeartbeat && !request.integer("/heartbeat_ms", heartbeatMs))) {
+    request.setError("min_ms y heartbeat_ms son enteros (ms)");
+    return CommandStatus::BAD_ARGS;
+  }
+  if (minMs < COMMAND_MIN_INTERVAL_MS || minMs > COMMAND_MAX_INTERVAL_MS || heartbeatMs < minMs ||
+      heartbeatMs > COMMAND_MAX_HEARTBEAT_MS) {
+    request.setError("se requiere 1 s <= min_ms <= 1 h y min_ms <= heartbeat_ms <= 24 h");
+    return CommandStatus::BAD_ARGS;
+  }
+  if (hasMin || hasHeartbeat) {
+    commandPolicy.minIntervalMs = (uint32_t)minMs;
+    commandPolicy.heartbeatMs = (uint32_t)heartbeatMs;
+    queuePolicy();
+    LOG_INFO("⚙️ Intervalo de publicación: mínimo %ld ms, latido %ld ms", (long)minMs, (long)heartbeatMs);
+  }
+  result.integer("min_ms", minMs).integer("heartbeat_ms", heartbeatMs);
+  return CommandStatus::OK;
+}
+
+// Se valida todo antes de aplicar nada: o cambian todos los canales pedidos o ninguno
+CommandStatus commandDeadband(CommandRequest& request, CommandResult& result) {
+  ReportPolicyConfig policy = commandPolicy;
+  bool changed = false;
+  char pointer[24];
+  for (const DeadbandField& field : DEADBAND_FIELDS) {
+    Deadband& band = policy.*field.band;
+    double value;
+    snprintf(pointer, sizeof(pointer), "/%s/abs", field.name);
+    if (request.has(pointer)) {
+      if (!request.number(pointer, value) || value < 0.0) {
+        request.setError("abs debe ser un número >= 0");
+        return CommandStatus::BAD_ARGS;
+      }
+      band.absolute = (float)value;
+      changed = true;
+    }
+    snprintf(pointer, sizeof(pointer), "/%s/rel", field.name);
+    if (request.has(pointer)) {
+      if (!request.number(pointer, value) || value < 0.0 || value > 1.0) {
+        request.setError("rel debe ser una fracción entre 0 y 1");
+        return CommandStatus::BAD_ARGS;
+      }
+      band.relative = (float)value;
+      changed = true;
+    }
+  }
+  if (changed) {
+    commandPolicy = policy;
+    queuePolicy();
+    LOG_INFO("⚙️ Deadbands actualizados por comando");
+  }
+
+  char key[24];
+  for (const DeadbandField& field : DEADBAND_FIELDS) {
+    const Deadband& band = commandPolicy.*field.band;
+    snprintf(key, sizeof(key), "%s_abs", field.name);
+    result.number(key, band.absolute, 3);
+    snprintf(key, sizeof(key), "%s_rel", field.name);
+    result.number(key, band.relative, 3);
+  }
+  return CommandStatus::OK;
+}
+
+// Contadores de otras tareas leídos sin bloqueo: valores aproximados
+CommandStatus commandDiag(CommandRequest& request, CommandResult& result) {
+  const ReconnectMetrics& mqtt = mqttReconnect.metrics();
+  const CommandInboxMetrics& inbox = commandInbox.metrics();
+  result.integer("uptime_ms", millis())
+      .integer("heap_free", ESP.getFreeHeap())
+      .integer("heap_min", ESP.getMinFreeHeap())
+      .integer("heap_max_block", ESP.getMaxAllocHeap())
+      .integer("reports_sent", reportFilter.sent())
+      .integer("reports_suppressed", reportFilter.suppressed())
+      .integer("sensor_queue_dropped", sensorQueue.dropped())
+      .integer("reading_queue", readingQueue.size())
+      .integer("mqtt_attempts", mqtt.attempts)
+      .integer("mqtt_failures", mqtt.failures)
+      .integer("mqtt_inflight", mqttInflight.load())
+      .integer("wifi_rssi", WiFi.RSSI())
+      .integer("log_dropped", logger.dropped())
+      .integer("degraded", boot.degradedMask())
+      .integer("commands_rejected", inbox.tooLarge + inbox.busy + inbox.broken)
+      .integer("dht_attempts", dht.attempts())
+      .integer("dht_errors", dht.attempts() - dht.errors(DhtError::NONE));
+  if (HEAP_ALLOCATIONS_COUNTED) result.integer("heap_allocs", heapAllocations.steadyFirmwareAllocations());
+  diagReportRequested = DIAG_ENABLED;
+  return CommandStatus::OK;
+}
+
+// Estado del MQ-2 leído sin bloqueo desde la tarea de red (aproximado,
+// como diag); la recalibración la hace la tarea de sensores
+CommandStatus commandGas(CommandRequest& request, CommandResult& result) {
+  bool calibrate = false;
+  if (request.has("/calibrate") && !request.boolean("/calibrate", calibrate)) {
+    request.setError("calibrate es booleano");
+    return CommandStatus::BAD_ARGS;
+  }
+  if (calibrate) gasCalibrationRequested = true;
+  const uint32_t now = millis();
+  result.text("state", Mq2Sensor::stateName(gasSensor.state()))
+      .integer("remaining_s", gasSensor.remainingMs(now) / 1000)
+      .number("r0_kohm", gasSensor.r0Kohm(), 2)
+      .number("rs_kohm", gasSensor.rsKohm(), 2)
+      .number("ppm", gasSensor.ppm(), 0)
+      .text("quality", airQualityLabel(gasSensor.quality()))
+      .integer("raw", gasSensor.filteredRaw())
+      .flag("calibrate", calibrate);
+  return CommandStatus::OK;
+}
+
+CommandStatus commandHelp(CommandRequest& request, CommandResult& result) {
+  char names[64] = "";
+  for (size_t i = 0; i < commands.size(); i++) {
+    if (i > 0) strlcat(names, ",", sizeof(names));
+    strlcat(names, commands.name(i), sizeof(names));
+  }
+  result.text("commands", names);
+  return CommandStatus::OK;
+}
+
+// Desde la tarea de red: cada mensaje se interpreta en su propio hueco del
+// buzón. El texto que no es un comando JSON va a la pantalla, como antes.
+void serviceCommands() {
+  size_t len = 0;
+  while (char* text = commandInbox.front(len)) {
+    DIAG_SCOPE(DIAG_COMMAND);
+    size_t replyLen = 0;
+    const CommandStatus status = commands.handle(text, len, commandReply, sizeof(commandReply), replyLen);
+    if (status == CommandStatus::NOT_COMMAND) {
+      LOG_INFO("📥 Mensaje MQTT: %s", text);
+      strlcpy(lastReceivedMessage, text, sizeof(lastReceivedMessage));
+      displayNeedsUpdate = true;
+    } else {
+      LOG_INFO("📥 Comando MQTT: %s", CommandDispatcher<COMMAND_MAX_TOKENS>::statusName(status));
+      LOG_DEBUG("📤 %s", commandReply);
+      if (replyLen == 0 || PublishMqttTo(mqttResponseTopic, commandReply, replyLen) == 0) {
+        LOG_WARN("⚠️ No se pudo enviar la respuesta al comando");
+      }
+    }
+    commandInbox.pop();
+  }
 }
 
 // =============================================================
 // === CALLBACK MQTT: Mensajes recibidos ===
 // =============================================================
+// Tarea async_tcp: solo copia el trozo al buzón y avisa a la tarea de red
 void OnMqttReceived(char* topic,
                     char* payload,
                     AsyncMqttClientMessageProperties properties,
                     size_t len,
                     size_t index,
                     size_t total) {
-  static String accumulatedPayload;
+  switch (commandInbox.add(payload, len, index, total)) {
+    case AssembleResult::COMPLETE:
+      if (networkTaskHandle) xTaskNotifyGive(networkTaskHandle);
+      break;
+    case AssembleResult::TOO_LARGE:
+      LOG_WARN("⚠️ Mensaje de %u B en %s descartado (máximo %u B)", (unsigned)total, topic, (unsigned)COMMAND_MAX_LEN);
+      break;
+    case AssembleResult::BUSY:
+      LOG_WARN("⚠️ Buzón de comandos lleno: mensaje en %s descartado", topic);
+      break;
+    case AssembleResult::BROKEN:
+      LOG_WARN("⚠️ Fragmento fuera de orden en %s: mensaje descartado", topic);
+      break;
+    default:
+      break;
+  }
+}
 
-  if (index == 0) accumulatedPayload = "";
-  accumulatedPayload += String(payload).substring(0, len);
+// =============================================================
+// === Diagnóstico: histogramas por etapa en /diag ===
+// =============================================================
+#if DIAG_ENABLED
+unsigned long lastDiagPublishMillis = 0;
+unsigned long lastHeapSampleMillis = 0;
+char diagBuffer[DIAG_REPORT_MAX_LEN];
 
-  if (index + len < total) return;
+void initDiagnostics() {
+  diagnostics.begin([]() -> uint32_t { return ESP.getCycleCount(); }, ESP.getCpuFreqMHz());
+  lastDiagPublishMillis = millis();
+}
 
-  Serial.println(ANSI_CYAN "========== [MQTT MENSAJE RECIBIDO] ==========" ANSI_RESET);
-  Serial.printf(ANSI_BOLD "Topic: %s\n" ANSI_RESET, topic);
-  Serial.printf(ANSI_BOLD "Payload: %s\n" ANSI_RESET, accumulatedPayload.c_str());
-  Serial.println(ANSI_CYAN "=============================================" ANSI_RESET);
+void sampleHeap() {
+  HeapSample heap;
+  heap.freeBytes = ESP.getFreeHeap();
+  heap.minFreeBytes = ESP.getMinFreeHeap();
+  heap.maxBlockBytes = ESP.getMaxAllocHeap();
+  if (HEAP_ALLOCATIONS_COUNTED) heap.steadyAllocations = (int32_t)heapAllocations.steadyFirmwareAllocations();
+  diagnostics.sampleHeap(heap);
+}
 
-  lastReceivedMessage = accumulatedPayload;
-  displayNeedsUpdate = true;
+// Desde la tarea de red. Si no se puede publicar, la ventana sigue abierta.
+void serviceDiagnostics() {
+  const unsigned long now = millis();
+  if (now - lastHeapSampleMillis >= DIAG_HEAP_SAMPLE_MS) {
+    lastHeapSampleMillis = now;
+    sampleHeap();
+  }
+  if ((!diagReportRequested && now - lastDiagPublishMillis < DIAG_PUBLISH_MS) || !mqttClient.connected()) return;
+
+  const size_t len = diagnostics.writeReport(diagBuffer, sizeof(diagBuffer), now - lastDiagPublishMillis,
+                                             mqttInflight.load());
+  if (len == 0) {
+    // Se descarta la ventana para no repetir el mismo informe que no cabe
+    LOG_WARN("⚠️ Informe de diagnóstico mayor que %u B", (unsigned)sizeof(diagBuffer));
+  } else if (PublishMqttTo(mqttDiagTopic, diagBuffer, len, false) == 0) {
+    return;
+  }
+  diagnostics.commit();
+  lastDiagPublishMillis = now;
+  diagReportRequested = false;
+  LOG_DEBUG("🩺 Diagnóstico publicado (%u B)", (unsigned)len);
 }
+#else
+void initDiagnostics() {}
+void serviceDiagnostics() {}
+#endif
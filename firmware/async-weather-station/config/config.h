@@ -8,7 +8,16 @@ const char* ssid     = "DIGI-R5mE";
 const char* password = "hEypg6XW";
 const char* hostname = "";
 
-// Nota: los parámetros IP permanecen solo como referencia; no se utilizan porque la conexión es por DHCP.
+// Reconexión rápida: se intenta primero el último BSSID/canal bueno (guardados
+// en NVS); si falla, escaneo normal con DHCP.
+#define WIFI_FAST_RECONNECT 1
+// 1 = el intento rápido reutiliza la última concesión DHCP en vez de pedirla
+// (unos 900 ms menos). No se sabe cuándo caduca: actívalo solo si el router
+// reserva esa IP para la estación, o podría entregarla a otro equipo.
+#define WIFI_REUSE_LEASE    0
+// IP fija (1 = usar ip/gateway/subnet de abajo en todos los intentos, sin DHCP).
+// El gateway hace también de DNS.
+#define WIFI_STATIC_IP      0
 IPAddress ip(192, 168, 1, 200);
 IPAddress gateway(192, 168, 1, 1);
 IPAddress subnet(255, 255, 255, 0);
@@ -24,5 +33,99 @@ IPAddress subnet(255, 255, 255, 0);
 #define MQTT_BASE_TOPIC "sensors/street_1253/WT_001"
 #define MQTT_TOPIC      "sensors/street_1253/WT_001"
 #define MQTT_QOS        1
+// Reconexión: espera exponencial desde MQTT_BACKOFF_INITIAL_MS hasta
+// MQTT_BACKOFF_MAX_MS con jitter propio de cada estación; la IP del broker
+// se guarda MQTT_DNS_TTL_MS (o hasta que falle una conexión).
+#define MQTT_BACKOFF_INITIAL_MS 1000
+#define MQTT_BACKOFF_MAX_MS     120000
+#define MQTT_DNS_TTL_MS         3600000UL
+// Retener la última lectura en directo para los nuevos suscriptores. Con la
+// publicación por cambio el broker solo la reescribe cuando algo cambia.
+#define MQTT_RETAIN_READINGS 1
+// Modo lote: 0 = un mensaje json/json-general por lectura; N > 1 = hasta N
+// lecturas por mensaje con la cabecera una sola vez (ver BatchPayload.hpp).
+// El lote sale al llegar a N lecturas, a la edad máxima o al tamaño máximo.
+#define MQTT_BATCH_SIZE         0
+#define MQTT_BATCH_TOPIC        MQTT_TOPIC "/batch"
+#define MQTT_BATCH_MAX_AGE_MS   300000UL
+#define MQTT_BATCH_MAX_BYTES    1536
+// Formato de cada lectura: JSON (json/json-general) o CBOR compacto con
+// deltas (ver BinaryPayload.hpp), que se publica en MQTT_CBOR_TOPIC.
+#define PAYLOAD_FORMAT_JSON     0
+#define PAYLOAD_FORMAT_CBOR     1
+#define PAYLOAD_FORMAT          PAYLOAD_FORMAT_JSON
+#define MQTT_CBOR_TOPIC         MQTT_TOPIC "/cbor"
+#define CBOR_KEYFRAME_INTERVAL  20
+// Modo dividido (solo con JSON): en lugar de json/json-general, un mensaje por
+// métrica con el esquema de json/json-temperatura, json-humedad, ... en
+// MQTT_TOPIC "/temperatura", "/humedad", "/viento", "/luz", "/presion" y "/aire"
+// (ver PayloadSchema.hpp). La cabecera común se escribe una vez por lectura.
+#define PAYLOAD_SPLIT_TOPICS    0
+// Métricas de arranque (ms hasta la primera muestra, WiFi, MQTT, NTP y la
+// primera publicación confirmada), una vez por arranque.
+#define MQTT_BOOT_TOPIC         MQTT_TOPIC "/boot"
+// Canal de comandos: peticiones JSON {"cmd":...} y sus respuestas
+// (sample, interval, deadband, diag, gas, help). El texto libre va a la pantalla.
+#define MQTT_COMMAND_TOPIC      MQTT_BASE_TOPIC "/comandos"
+#define MQTT_RESPONSE_TOPIC     MQTT_BASE_TOPIC "/respuestas"
+// Diagnóstico del camino crítico (ver Diagnostics.hpp): histogramas de
+// latencia por etapa medidos con el contador de ciclos, separación entre
+// vueltas de las tareas, marcas de memoria y publicaciones QoS1 en vuelo,
+// cada DIAG_PUBLISH_MS en MQTT_DIAG_TOPIC y al recibir {"cmd":"diag"}.
+// Cada 15 min: el informe (~1 KB) no compite con las lecturas. Con 0 no se
+// compila nada.
+#define DIAG_ENABLED            1
+#define DIAG_PUBLISH_MS         900000UL
+#define MQTT_DIAG_TOPIC         MQTT_BASE_TOPIC "/diag"
+// Bloque "stats" junto a "data": n, min, max, media, desviación típica y
+// media exponencial de cada canal entre dos publicaciones (1 = activado).
+// Solo en las lecturas publicadas en directo, no en las reenviadas desde la cola.
+// Más que duplica el mensaje (~395 B -> ~890 B): apagado salvo que se use.
+// La pantalla muestra los mínimos y máximos igualmente.
+#define PAYLOAD_STATS           0
+// "timestamp" del payload: hora de Madrid con desfase (0) o UTC con 'Z' (1),
+// y con milisegundos (1) o sin ellos (0). El instante es siempre el de muestreo.
+#define TIMESTAMP_UTC           0
+#define TIMESTAMP_MILLIS        0
+// "gas_ppm" en "data" (y en el subtema aire): concentración equivalente de
+// propano del MQ-2 según la curva de la ficha; null mientras calibra.
+// Apagado: el MQ-2 no está calibrado contra una referencia y los
+// consumidores de json/ no esperan el campo. "gas" (lectura cruda) sigue.
+#define PAYLOAD_GAS_PPM         0
+
+// --- MQ-2 (ver GasSensor.hpp) ---
+// El ADC convierte en modo continuo por DMA y entrega tramas ya promediadas:
+// MQ2_ADC_CONVERSIONS lecturas a MQ2_ADC_FREQ_HZ (50 ms por trama).
+#define MQ2_ADC_CONVERSIONS     1000
+#define MQ2_ADC_FREQ_HZ         20000
+// Circuito del módulo: alimentación, resistencia de carga y divisor entre
+// AO y el GPIO (1.0 = sin divisor; 1.5 con 10k/20k, por ejemplo).
+#define MQ2_SUPPLY_MV           5000
+#define MQ2_LOAD_KOHM           1.0f
+#define MQ2_PIN_SCALE           1.0f
+// Calentamiento antes de medir y ventana en aire limpio para fijar R0. El R0
+// se guarda en NVS y no se vuelve a calibrar al reiniciar (comando "gas").
+#define MQ2_WARMUP_MS           180000UL
+#define MQ2_CALIBRATION_MS      600000UL
+// ppm a partir de los que la calidad pasa a NORMAL, MALA y PELIGROSA
+#define MQ2_PPM_NORMAL          150.0f
+#define MQ2_PPM_MALA            300.0f
+#define MQ2_PPM_PELIGROSA       1000.0f
+
+// --- Log por Serial ---
+// LOG_LEVEL_ERROR, _WARN, _INFO o _DEBUG; los niveles superiores no se compilan.
+// LOG_ANSI 0 quita los colores (monitores que no los interpretan).
+#define LOG_LEVEL               LOG_LEVEL_INFO
+#define LOG_ANSI                1
+
+// --- Identidad de la estación (payload json/json-general) ---
+// Latitud y longitud van como texto para emitirse tal cual en el JSON.
+#define STATION_SENSOR_ID     "WS_001"
+#define STATION_SENSOR_TYPE   "weather"
+#define STATION_STREET_ID     "ST_1253"
+#define STATION_LATITUDE      "40.4094736"
+#define STATION_LONGITUDE     "-3.6920903"
+#define STATION_DISTRICT      "Centro"
+#define STATION_NEIGHBORHOOD  "Universidad"
 
 #endif  // WEATHER_STATION_CONFIG_H
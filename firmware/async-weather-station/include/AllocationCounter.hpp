@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// =============================================================
+// === Reservas del heap por tarea ===
+// =============================================================
+// En funcionamiento estable las tareas del firmware no deben reservar
+// memoria: con meses encendida, cada String o vector temporal fragmenta el
+// heap hasta que falla una reserva grande (TLS, MQTT). Los ganchos de
+// reserva y liberación (esp_heap_trace_alloc_hook con CONFIG_HEAP_USE_HOOKS
+// en el ESP32; operator new en la simulación) llaman a onAlloc()/onFree()
+// con la tarea en curso y aquí se cuenta por tarea. Lo reservado desde
+// otras tareas (WiFi, lwIP, async_tcp) va a "otras": no es del firmware.
+//
+// markSteady() fija el final del arranque; steadyAllocations() es lo que
+// cada tarea ha reservado desde entonces y debe quedarse en 0.
+class AllocationCounter {
+ public:
+  static constexpr size_t SLOTS = 4;
+
+  // Antes de que la tarea reserve nada; el gancho solo lee la tabla
+  bool track(const void* task, const char* name) {
+    for (size_t i = 0; i < SLOTS; i++) {
+      if (tasks_[i].load(std::memory_order_relaxed)) continue;
+      names_[i] = name;
+      tasks_[i].store(task, std::memory_order_release);
+      return true;
+    }
+    return false;
+  }
+
+  // Desde el gancho: cualquier tarea o ISR, sin bloqueos ni reservas
+  void onAlloc(const void* currentTask, size_t bytes) {
+    const size_t slot = slotOf(currentTask);
+    allocations_[slot].fetch_add(1, std::memory_order_relaxed);
+    bytes_[slot].fetch_add((uint32_t)bytes, std::memory_order_relaxed);
+  }
+
+  void onFree(const void* currentTask) { frees_[slotOf(currentTask)].fetch_add(1, std::memory_order_relaxed); }
+
+  // markSteady() y las lecturas de steady*() desde una misma tarea (la de red)
+  void markSteady() {
+    for (size_t i = 0; i <= SLOTS; i++) steadyBase_[i] = allocations_[i].load(std::memory_order_relaxed);
+    steady_.store(true, std::memory_order_relaxed);
+  }
+  bool steady() const { return steady_.load(std::memory_order_relaxed); }
+
+  // slot == SLOTS: reservas de tareas que no son del firmware
+  size_t slots() const { return SLOTS + 1; }
+  const char* name(size_t slot) const { return slot < SLOTS ? names_[slot] : "otras"; }
+  bool used(size_t slot) const { return slot >= SLOTS || tasks_[slot].load(std::memory_order_relaxed) != nullptr; }
+  uint32_t allocations(size_t slot) const { return allocations_[slot].load(std::memory_order_relaxed); }
+  uint32_t frees(size_t slot) const { return frees_[slot].load(std::memory_order_relaxed); }
+  uint32_t bytes(size_t slot) const { return bytes_[slot].load(std::memory_order_relaxed); }
+  uint32_t steadyAllocations(size_t slot) const { return steady() ? allocations(slot) - steadyBase_[slot] : 0; }
+
+  // Suma de las tareas del firmware desde markSteady()
+  uint32_t steadyFirmwareAllocations() const {
+    uint32_t total = 0;
+    for (size_t i = 0; i < SLOTS; i++) total += steadyAllocations(i);
+    return total;
+  }
+
+ private:
+  size_t slotOf(const void* task) const {
+    for (size_t i = 0; i < SLOTS; i++) {
+      if (task && tasks_[i].load(std::memory_order_acquire) == task) return i;
+    }
+    return SLOTS;
+  }
+
+  std::atomic<const void*> tasks_[SLOTS] = {};
+  const char* names_[SLOTS] = {};
+  std::atomic<uint32_t> allocations_[SLOTS + 1] = {};
+  std::atomic<uint32_t> frees_[SLOTS + 1] = {};
+  std::atomic<uint32_t> bytes_[SLOTS + 1] = {};
+  uint32_t steadyBase_[SLOTS + 1] = {};
+  std::atomic<bool> steady_{false};
+};
@@ -0,0 +1,221 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Atributo para código que se ejecuta dentro de una ISR (en el host no aplica)
+#if defined(ARDUINO_ARCH_ESP32) && defined(IRAM_ATTR)
+#define WS_ISR_ATTR IRAM_ATTR
+#else
+#define WS_ISR_ATTR
+#endif
+
+// =============================================================
+// === Cola lock-free de marcas de tiempo (1 productor / 1 consumidor) ===
+// =============================================================
+// El productor es la ISR del anemómetro y el consumidor es loop(). Solo se
+// usan cargas/almacenamientos atómicos, nunca se deshabilitan interrupciones.
+template <size_t N>
+class PulseRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N debe ser potencia de 2");
+
+ public:
+  bool WS_ISR_ATTR push(uint32_t value) {
+    const uint32_t head = head_.load(std::memory_order_relaxed);
+    const uint32_t tail = tail_.load(std::memory_order_acquire);
+    if (head - tail >= N) {
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    buffer_[head & (N - 1)] = value;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(uint32_t& value) {
+    const uint32_t tail = tail_.load(std::memory_order_relaxed);
+    const uint32_t head = head_.load(std::memory_order_acquire);
+    if (head == tail) return false;
+    value = buffer_[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  uint32_t buffer_[N] = {};
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> tail_{0};
+  std::atomic<uint32_t> dropped_{0};
+};
+
+// =============================================================
+// === Resultado de la medición de viento ===
+// =============================================================
+struct WindReading {
+  float meanKmh = 0.0f;      // media sobre la ventana completa
+  float gustKmh = 0.0f;      // máximo de la ventana corta deslizante (racha)
+  float intervalKmh = 0.0f;  // velocidad instantánea según el último intervalo entre pulsos
+  uint32_t pulses = 0;       // pulsos dentro de la ventana media
+};
+
+struct AnemometerConfig {
+  float kmhPerHz = 2.4f;           // km/h por pulso/segundo
+  uint32_t debounceUs = 5000;      // rebote mínimo entre pulsos válidos
+  uint32_t bucketMs = 250;         // resolución temporal de los contadores
+  uint32_t windowMs = 30000;       // ventana de la velocidad media
+  uint32_t gustWindowMs = 3000;    // ventana de la racha (WMO: 3 s)
+  uint32_t staleTimeoutMs = 5000;  // sin pulsos durante este tiempo => velocidad instantánea 0
+};
+
+// =============================================================
+// === Motor del anemómetro (no bloqueante) ===
+// =============================================================
+// La ISR solo aplica el antirrebote y guarda el instante del pulso en la cola.
+// update() vacía la cola en contadores por intervalos (buckets) de un buffer
+// circular, así que la memoria es fija e independiente de la velocidad.
+class AnemometerEngine {
+ public:
+  static constexpr size_t MAX_BUCKETS = 256;
+
+  explicit AnemometerEngine(const AnemometerConfig& config = AnemometerConfig()) { configure(config); }
+
+  void configure(const AnemometerConfig& config) {
+    config_ = config;
+    if (config_.bucketMs == 0) config_.bucketMs = 1;
+    bucketUs_ = config_.bucketMs * 1000UL;
+    windowBuckets_ = clampBuckets(config_.windowMs / config_.bucketMs);
+    gustBuckets_ = clampBuckets(config_.gustWindowMs / config_.bucketMs);
+    if (gustBuckets_ > windowBuckets_) gustBuckets_ = windowBuckets_;
+    reset(0);
+  }
+
+  void reset(uint32_t nowUs) {
+    for (size_t i = 0; i < MAX_BUCKETS; i++) buckets_[i] = 0;
+    current_ = 0;
+    bucketStartUs_ = nowUs;
+    filledBuckets_ = 1;
+    havePulse_ = false;
+    haveInterval_ = false;
+    uint32_t discard;
+    while (ring_.pop(discard)) {}
+  }
+
+  // --- Productor: llamar desde la ISR con micros() ---
+  void WS_ISR_ATTR onPulse(uint32_t nowUs) {
+    if (isrHasPulse_ && nowUs - isrLastPulseUs_ < config_.debounceUs) return;
+    isrHasPulse_ = true;
+    isrLastPulseUs_ = nowUs;
+    ring_.push(nowUs);
+  }
+
+  // --- Consumidor: llamar periódicamente desde loop() ---
+  void update(uint32_t nowUs) {
+    uint32_t pulseUs;
+    while (ring_.pop(pulseUs)) {
+      advanceTo(pulseUs);
+      if (buckets_[current_] < UINT16_MAX) buckets_[current_]++;
+      if (havePulse_) {
+        lastIntervalUs_ = pulseUs - lastPulseUs_;
+        haveInterval_ = true;
+      }
+      lastPulseUs_ = pulseUs;
+      havePulse_ = true;
+    }
+    advanceTo(nowUs);
+    nowUs_ = nowUs;
+  }
+
+  WindReading read() const {
+    WindReading reading;
+    // Solo intervalos completos: el actual (i = 0) aún está acumulando pulsos
+    const size_t completed = filledBuckets_ - 1;
+    const size_t meanCount = completed < windowBuckets_ ? completed : windowBuckets_;
+    uint32_t total = 0;
+    for (size_t i = 1; i <= meanCount; i++) total += bucketAt(i);
+    reading.pulses = total;
+    reading.meanKmh = pulsesToKmh(total, meanCount * config_.bucketMs);
+
+    // Racha: suma deslizante de gustBuckets_ intervalos dentro de la ventana
+    if (meanCount >= gustBuckets_) {
+      uint32_t running = 0;
+      uint32_t best = 0;
+      for (size_t i = 1; i <= meanCount; i++) {
+        running += bucketAt(i);
+        if (i > gustBuckets_) running -= bucketAt(i - gustBuckets_);
+        if (i >= gustBuckets_ && running > best) best = running;
+      }
+      reading.gustKmh = pulsesToKmh(best, gustBuckets_ * config_.bucketMs);
+    } else {
+      reading.gustKmh = reading.meanKmh;
+    }
+
+    // Velocidad por intervalo: si el último pulso es más antiguo que el último
+    // intervalo medido, la velocidad real ya es menor que ese intervalo indica.
+    if (haveInterval_) {
+      const uint32_t sinceLastUs = nowUs_ - lastPulseUs_;
+      if (sinceLastUs <= config_.staleTimeoutMs * 1000UL) {
+        const uint32_t periodUs = sinceLastUs > lastIntervalUs_ ? sinceLastUs : lastIntervalUs_;
+        if (periodUs > 0) reading.intervalKmh = config_.kmhPerHz * 1000000.0f / (float)periodUs;
+      }
+    }
+    return reading;
+  }
+
+  uint32_t droppedPulses() const { return ring_.dropped(); }
+  const AnemometerConfig& config() const { return config_; }
+
+ private:
+  size_t clampBuckets(uint32_t count) const {
+    if (count == 0) return 1;
+    return count > MAX_BUCKETS ? MAX_BUCKETS : count;
+  }
+
+  // i = 0 es el intervalo actual, i = 1 el anterior, etc.
+  uint16_t bucketAt(size_t i) const { return buckets_[(current_ + MAX_BUCKETS - i) % MAX_BUCKETS]; }
+
+  float pulsesToKmh(uint32_t pulses, uint32_t spanMs) const {
+    if (spanMs == 0) return 0.0f;
+    return (float)pulses * 1000.0f / (float)spanMs * config_.kmhPerHz;
+  }
+
+  // Avanza el buffer circular hasta el intervalo que contiene t (aritmética
+  // con signo para tolerar el desbordamiento de micros()).
+  void advanceTo(uint32_t tUs) {
+    int32_t ahead = (int32_t)(tUs - bucketStartUs_);
+    if (ahead < (int32_t)bucketUs_) return;
+    uint32_t steps = (uint32_t)ahead / bucketUs_;
+    if (steps > MAX_BUCKETS) {
+      for (size_t i = 0; i < MAX_BUCKETS; i++) buckets_[i] = 0;
+      bucketStartUs_ += steps * bucketUs_;
+      filledBuckets_ = MAX_BUCKETS;
+      return;
+    }
+    for (uint32_t s = 0; s < steps; s++) {
+      current_ = (current_ + 1) % MAX_BUCKETS;
+      buckets_[current_] = 0;
+      if (filledBuckets_ < MAX_BUCKETS) filledBuckets_++;
+    }
+    bucketStartUs_ += steps * bucketUs_;
+  }
+
+  AnemometerConfig config_;
+  uint32_t bucketUs_ = 250000;
+  size_t windowBuckets_ = 1;
+  size_t gustBuckets_ = 1;
+
+  PulseRing<64> ring_;
+  volatile bool isrHasPulse_ = false;
+  volatile uint32_t isrLastPulseUs_ = 0;
+
+  uint16_t buckets_[MAX_BUCKETS] = {};
+  size_t current_ = 0;
+  size_t filledBuckets_ = 1;
+  uint32_t bucketStartUs_ = 0;
+  uint32_t nowUs_ = 0;
+  uint32_t lastPulseUs_ = 0;
+  uint32_t lastIntervalUs_ = 0;
+  bool havePulse_ = false;
+  bool haveInterval_ = false;
+};
@@ -0,0 +1,347 @@
+#pragma once
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "IsoTimestamp.hpp"
+#include "PayloadWriter.hpp"
+#include "ReadingQueue.hpp"
+
+// =============================================================
+// === Mensajes por lotes (varias lecturas por publicación) ===
+// =============================================================
+// La cabecera (identidad y ubicación) va una sola vez y cada lectura es una
+// fila compacta con su instante de muestreo en epoch ms:
+//
+// {"sensor_id":"WS_001","sensor_type":"weather","street_id":"ST_1253",
+//  "location":{"latitude":40.4094736,"longitude":-3.6920903,
+//              "district":"Centro","neighborhood":"Universidad"},
+//  "fields":["timestamp_ms","altitude_meters","temperature_celsius",...],
+//  "readings":[[1735689600000,650.2,21.5,40,3.2,812.5,1013.25,1450],...]}
+//
+// Con PAYLOAD_GAS_PPM, como en el mensaje suelto, cada fila lleva además
+// gas_ppm al final (null si el MQ-2 aún no estaba calibrado al muestrear).
+
+#if PAYLOAD_GAS_PPM
+#define BATCH_PAYLOAD_GAS_FIELD ",\"gas_ppm\""
+#else
+#define BATCH_PAYLOAD_GAS_FIELD ""
+#endif
+
+#define BATCH_PAYLOAD_HEADER                                   \
+  "{\"sensor_id\":\"" STATION_SENSOR_ID "\","                  \
+  "\"sensor_type\":\"" STATION_SENSOR_TYPE "\","               \
+  "\"street_id\":\"" STATION_STREET_ID "\","                   \
+  "\"location\":{\"latitude\":" STATION_LATITUDE ","           \
+  "\"longitude\":" STATION_LONGITUDE ","                       \
+  "\"district\":\"" STATION_DISTRICT "\","                     \
+  "\"neighborhood\":\"" STATION_NEIGHBORHOOD "\"},"            \
+  "\"fields\":[\"timestamp_ms\",\"altitude_meters\","          \
+  "\"temperature_celsius\",\"humidity_percentage\","           \
+  "\"wind_speed\",\"luz\",\"atmospheric_pressure_hpa\","       \
+  "\"air_quality_index\"" BATCH_PAYLOAD_GAS_FIELD "],\"readings\":["
+
+constexpr size_t BATCH_FIELD_COUNT = PAYLOAD_GAS_PPM ? 9 : 8;
+
+// Fila: "[" ts "," 6 números "," entero ["," ppm] "]" y la coma separadora
+constexpr size_t BATCH_ROW_MAX_LEN = 1 + JsonWriter::MAX_INT64_LEN + 6 * (1 + JsonWriter::MAX_NUMBER_LEN) + 1 +
+                                     JsonWriter::MAX_INT_LEN + (PAYLOAD_GAS_PPM ? 1 + JsonWriter::MAX_NUMBER_LEN : 0) +
+                                     1 + 1;
+
+constexpr size_t batchPayloadMaxLen(size_t rows) {
+  return sizeof(BATCH_PAYLOAD_HEADER) - 1 + rows * BATCH_ROW_MAX_LEN + sizeof("]}") - 1;
+}
+
+// Cuántas filas caben con seguridad en `maxBytes`
+constexpr size_t batchRowsForBytes(size_t maxBytes) {
+  return maxBytes <= batchPayloadMaxLen(0) ? 0 : (maxBytes - batchPayloadMaxLen(0)) / BATCH_ROW_MAX_LEN;
+}
+
+/**
+ * @brief Serializa `count` lecturas en un único mensaje de lote.
+ * @return longitud escrita, o 0 si el buffer no alcanza.
+ */
+size_t writeBatchPayload(const StoredReading* rows, size_t count, char* out, size_t capacity) {
+  JsonWriter json(out, capacity);
+  json.literal(BATCH_PAYLOAD_HEADER);
+  for (size_t i = 0; i < count; i++) {
+    const StoredReading& r = rows[i];
+    if (i > 0) json.literal(",");
+    json.literal("[").integer(r.timestampMs);
+    json.literal(",").number(r.altitudeMeters, PAYLOAD_DECIMALS_ALTITUDE);
+    json.literal(",").number(r.temperatureC, PAYLOAD_DECIMALS_TEMPERATURE);
+    json.literal(",").number(r.humidityPercent, PAYLOAD_DECIMALS_HUMIDITY);
+    json.literal(",").number(r.windSpeedKmh, PAYLOAD_DECIMALS_WIND);
+    json.literal(",").number(r.lightLux, PAYLOAD_DECIMALS_LIGHT);
+    json.literal(",").number(r.pressureHpa, PAYLOAD_DECIMALS_PRESSURE);
+    json.literal(",").integer(r.gasRaw);
+    if (PAYLOAD_GAS_PPM) json.literal(",").number(r.gasPpm, PAYLOAD_FIELDS[FIELD_GAS_PPM].decimals);
+    json.literal("]");
+  }
+  json.literal("]}");
+  return json.overflow() ? 0 : json.length();
+}
+
+// =============================================================
+// === Política de envío del lote ===
+// =============================================================
+// Se envía cuando hay `maxReadings` lecturas, cuando la más antigua supera
+// `maxAgeMs`, o cuando una fila más ya no cabría en `maxBytes`.
+struct BatchPolicy {
+  size_t maxReadings = 10;
+  uint32_t maxAgeMs = 300000;
+  size_t maxBytes = 1536;
+
+  size_t rowLimit() const {
+    const size_t byBytes = batchRowsForBytes(maxBytes);
+    return maxReadings < byBytes ? maxReadings : byBytes;
+  }
+
+  bool shouldFlush(size_t pending, uint32_t oldestAgeMs) const {
+    if (pending == 0) return false;
+    return pending >= rowLimit() || oldestAgeMs >= maxAgeMs;
+  }
+};
+
+// =============================================================
+// === Decodificador de lotes (lado de ingesta) ===
+// =============================================================
+// Cursor mínimo sobre JSON en memoria; no reserva memoria ni modifica la entrada.
+class JsonCursor {
+ public:
+  JsonCursor(const char* text, size_t len) : p_(text), end_(text + len) {}
+
+  void skipSpace() {
+    while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) p_++;
+  }
+
+  bool consume(char c) {
+    skipSpace();
+    if (p_ < end_ && *p_ == c) {
+      p_++;
+      return true;
+    }
+    return false;
+  }
+
+  bool peek(char c) {
+    skipSpace();
+    return p_ < end_ && *p_ == c;
+  }
+
+  // Copia una cadena en `out` deshaciendo los escapes de JsonWriter::string()
+  // (\uXXXX del plano básico, sin pares sustitutos); lo que no cabe se corta
+  bool string(char* out, size_t capacity) {
+    if (!consume('"')) return false;
+    size_t n = 0;
+    while (p_ < end_ && *p_ != '"') {
+      char c = *p_++;
+      if (c == '\\') {
+        if (p_ >= end_) return false;
+        c = *p_++;
+        switch (c) {
+          case 'b': c = '\b'; break;
+          case 'f': c = '\f'; break;
+          case 'n': c = '\n'; break;
+          case 'r': c = '\r'; break;
+          case 't': c = '\t'; break;
+          case 'u': {
+            uint32_t code = 0;
+            for (int i = 0; i < 4; i++) {
+              if (p_ >= end_ || !isxdigit((unsigned char)*p_)) return false;
+              const char h = *p_++;
+              code = code << 4 | (uint32_t)(h <= '9' ? h - '0' : (h | 0x20) - 'a' + 10);
+            }
+            if (code >= 0xD800 && code <= 0xDFFF) return false;
+            char utf8[3];
+            size_t len = 1;
+            if (code < 0x80) {
+              utf8[0] = (char)code;
+            } else if (code < 0x800) {
+              utf8[0] = (char)(0xC0 | code >> 6);
+              utf8[1] = (char)(0x80 | (code & 0x3F));
+              len = 2;
+            } else {
+              utf8[0] = (char)(0xE0 | code >> 12);
+              utf8[1] = (char)(0x80 | (code >> 6 & 0x3F));
+              utf8[2] = (char)(0x80 | (code & 0x3F));
+              len = 3;
+            }
+            for (size_t i = 0; i < len; i++) {
+              if (n + 1 < capacity) out[n++] = utf8[i];
+            }
+            continue;
+          }
+          default: break;  // \" \\ \/
+        }
+      }
+      if (n + 1 < capacity) out[n++] = c;
+    }
+    if (capacity > 0) out[n] = '\0';
+    return consume('"');
+  }
+
+  // Copia el texto de un número (o null) tal cual
+  bool rawNumber(char* out, size_t capacity) {
+    skipSpace();
+    const char* start = p_;
+    while (p_ < end_ && (strchr("+-.eE", *p_) || (*p_ >= '0' && *p_ <= '9') || (*p_ >= 'a' && *p_ <= 'z'))) p_++;
+    const size_t len = (size_t)(p_ - start);
+    if (len == 0 || len + 1 > capacity) return false;
+    memcpy(out, start, len);
+    out[len] = '\0';
+    return true;
+  }
+
+  bool number(double& value) {
+    char text[32];
+    if (!rawNumber(text, sizeof(text))) return false;
+    value = strcmp(text, "null") == 0 ? NAN : strtod(text, nullptr);
+    return true;
+  }
+
+  // Salta un valor JSON completo (cadena, número, objeto o array)
+  bool skipValue() {
+    skipSpace();
+    if (p_ >= end_) return false;
+    if (*p_ == '"') {
+      char scratch[1];
+      return string(scratch, sizeof(scratch));
+    }
+    if (*p_ == '{' || *p_ == '[') {
+      int depth = 0;
+      bool inString = false;
+      for (; p_ < end_; p_++) {
+        if (inString) {
+          if (*p_ == '\\') p_++;
+          else if (*p_ == '"') inString = false;
+        } else if (*p_ == '"') {
+          inString = true;
+        } else if (*p_ == '{' || *p_ == '[') {
+          depth++;
+        } else if ((*p_ == '}' || *p_ == ']') && --depth == 0) {
+          p_++;
+          return true;
+        }
+      }
+      return false;
+    }
+    char scratch[32];
+    return rawNumber(scratch, sizeof(scratch));
+  }
+
+ private:
+  const char* p_;
+  const char* end_;
+};
+
+/**
+ * @brief Expande un mensaje de lote en registros json/json-general.
+ *
+ * Por cada fila se escribe un documento en `scratch` y se invoca
+ * `onRecord(json, len)`. Las columnas se localizan por nombre en "fields",
+ * así que el orden puede cambiar sin romper el decodificador. Los
+ * timestamps se emiten en UTC con milisegundos.
+ * @return número de registros emitidos, o -1 si el mensaje no es válido.
+ */
+template <typename Callback>
+int expandBatchPayload(const char* json, size_t len, char* scratch, size_t scratchCapacity, Callback onRecord) {
+  // gas_ppm se reconoce siempre, lo envíe o no esta compilación
+  enum Column { TS, ALT, TEMP, HUM, WIND, LUX, PRES, AQI, GAS_PPM, UNKNOWN };
+  static const char* const NAMES[] = {"timestamp_ms", "altitude_meters", "temperature_celsius",
+                                      "humidity_percentage", "wind_speed", "luz",
+                                      "atmospheric_pressure_hpa", "air_quality_index", "gas_ppm"};
+
+  StationInfo station;
+  Column columns[16];
+  size_t columnCount = 0;
+  int emitted = 0;
+  char key[32];
+  IsoTimestampFormatter utc(true);  // las filas de un lote comparten día
+
+  JsonCursor in(json, len);
+  if (!in.consume('{')) return -1;
+  while (!in.peek('}')) {
+    if (!in.string(key, sizeof(key)) || !in.consume(':')) return -1;
+
+    if (strcmp(key, "sensor_id") == 0) {
+      if (!in.string(station.sensorId, sizeof(station.sensorId))) return -1;
+    } else if (strcmp(key, "sensor_type") == 0) {
+      if (!in.string(station.sensorType, sizeof(station.sensorType))) return -1;
+    } else if (strcmp(key, "street_id") == 0) {
+      if (!in.string(station.streetId, sizeof(station.streetId))) return -1;
+    } else if (strcmp(key, "location") == 0) {
+      if (!in.consume('{')) return -1;
+      while (!in.peek('}')) {
+        if (!in.string(key, sizeof(key)) || !in.consume(':')) return -1;
+        bool ok;
+        if (strcmp(key, "latitude") == 0) ok = in.rawNumber(station.latitude, sizeof(station.latitude));
+        else if (strcmp(key, "longitude") == 0) ok = in.rawNumber(station.longitude, sizeof(station.longitude));
+        else if (strcmp(key, "district") == 0) ok = in.string(station.district, sizeof(station.district));
+        else if (strcmp(key, "neighborhood") == 0) ok = in.string(station.neighborhood, sizeof(station.neighborhood));
+        else ok = in.skipValue();
+        if (!ok) return -1;
+        in.consume(',');
+      }
+      in.consume('}');
+    } else if (strcmp(key, "fields") == 0) {
+      if (!in.consume('[')) return -1;
+      while (!in.peek(']')) {
+        if (!in.string(key, sizeof(key)) || columnCount >= 16) return -1;
+        Column column = UNKNOWN;
+        for (size_t i = 0; i < UNKNOWN; i++) {
+          if (strcmp(key, NAMES[i]) == 0) column = (Column)i;
+        }
+        columns[columnCount++] = column;
+        in.consume(',');
+      }
+      in.consume(']');
+    } else if (strcmp(key, "readings") == 0) {
+      // "fields" y la cabecera preceden siempre a "readings"
+      if (columnCount == 0 || !in.consume('[')) return -1;
+      while (!in.peek(']')) {
+        if (!in.consume('[')) return -1;
+        SensorData data;
+        double values[16];
+        for (size_t c = 0; c < columnCount; c++) {
+          if (!in.number(values[c])) return -1;
+          if (c + 1 < columnCount && !in.consume(',')) return -1;
+        }
+        if (!in.consume(']')) return -1;
+
+        int64_t timestampMs = 0;
+        for (size_t c = 0; c < columnCount; c++) {
+          const double v = values[c];
+          switch (columns[c]) {
+            case TS: timestampMs = isnan(v) ? 0 : (int64_t)v; break;
+            case ALT: data.altitudeMeters = (float)v; break;
+            case TEMP: data.temperatureC = (float)v; break;
+            case HUM: data.humidityPercent = (float)v; break;
+            case WIND: data.windSpeedKmh = (float)v; break;
+            case LUX: data.lightLux = (float)v; break;
+            case PRES: data.pressureHpa = (float)v; break;
+            case AQI: data.gasRaw = isnan(v) ? 0 : (int)v; break;
+            case GAS_PPM: data.gasPpm = (float)v; break;
+            default: break;
+          }
+        }
+        data.timestampMs = timestampMs;
+
+        char timestamp[TIMESTAMP_MAX_LEN];
+        utc.format(timestampMs, timestamp, sizeof(timestamp), true);
+        const size_t recordLen = writeSensorPayload(station, data, timestamp, scratch, scratchCapacity);
+        if (recordLen == 0) return -1;
+        onRecord(scratch, recordLen);
+        emitted++;
+        in.consume(',');
+      }
+      in.consume(']');
+    } else if (!in.skipValue()) {
+      return -1;
+    }
+    in.consume(',');
+  }
+  return emitted;
+}
@@ -0,0 +1,361 @@
+#pragma once
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ReadingQueue.hpp"
+
+// =============================================================
+// === Formato binario compacto (CBOR) ===
+// =============================================================
+// Alternativa al JSON de json/json-general: un mapa CBOR (RFC 8949) con
+// claves enteras en lugar de nombres y valores en coma fija. Cualquier
+// decodificador CBOR estándar puede leerlo.
+//
+//   0  versión del esquema         4  timestamp (epoch ms o delta)
+//   1  número de secuencia         5  sensor_id (solo en tramas clave)
+//   2  flags (bit 0: trama delta)
+//   10..17  canal en valor absoluto cuantizado
+//   20..27  canal como diferencia con el mensaje anterior
+//
+// Un canal sin dato (NaN) va como null. El canal 17/27 (gas_ppm) se añadió
+// después; un decodificador que no lo conozca lo ignora como clave desconocida. Cada `keyframeInterval` mensajes,
+// o tras un hueco en la secuencia, se envía una trama clave sin deltas.
+
+constexpr uint8_t BINARY_SCHEMA_VERSION = 1;
+constexpr uint8_t BINARY_FLAG_DELTA = 0x01;
+
+enum BinaryKey : uint8_t {
+  BKEY_VERSION = 0,
+  BKEY_SEQ = 1,
+  BKEY_FLAGS = 2,
+  BKEY_TIMESTAMP = 4,
+  BKEY_SENSOR_ID = 5,
+  BKEY_ABSOLUTE = 10,
+  BKEY_DELTA = 20,
+};
+
+// Canales en el orden de las claves 10..17 / 20..27
+enum BinaryChannel : uint8_t {
+  CH_ALTITUDE,
+  CH_TEMPERATURE,
+  CH_HUMIDITY,
+  CH_WIND,
+  CH_LIGHT,
+  CH_PRESSURE,
+  CH_GAS,
+  CH_GAS_PPM,
+  CH_COUNT
+};
+
+// Escala de cuantización de cada canal (misma resolución que el JSON)
+constexpr int32_t BINARY_SCALE[CH_COUNT] = {10, 10, 10, 100, 10, 100, 1, 1};
+
+constexpr size_t BINARY_SENSOR_ID_MAX = 23;
+// Mapa + 4 campos de cabecera + sensor_id + 8 canales de hasta 1+1+9 bytes
+constexpr size_t BINARY_PAYLOAD_MAX_LEN = 1 + (1 + 1) + (1 + 5) + (1 + 2) + (1 + 9) + (1 + 1 + BINARY_SENSOR_ID_MAX) +
+                                          CH_COUNT * (1 + 9);
+
+// Estado cuantizado compartido por codificador y decodificador
+struct BinaryFrameState {
+  int64_t timestampMs = 0;
+  int64_t values[CH_COUNT] = {};
+  bool valid[CH_COUNT] = {};
+  bool hasPrevious = false;
+};
+
+inline bool quantize(float value, int32_t scale, int64_t& out) {
+  if (isnan(value) || isinf(value)) return false;
+  out = (int64_t)llround((double)value * scale);
+  return true;
+}
+
+inline void readingToChannels(const StoredReading& r, float (&channels)[CH_COUNT]) {
+  channels[CH_ALTITUDE] = r.altitudeMeters;
+  channels[CH_TEMPERATURE] = r.temperatureC;
+  channels[CH_HUMIDITY] = r.humidityPercent;
+  channels[CH_WIND] = r.windSpeedKmh;
+  channels[CH_LIGHT] = r.lightLux;
+  channels[CH_PRESSURE] = r.pressureHpa;
+  channels[CH_GAS] = (float)r.gasRaw;
+  channels[CH_GAS_PPM] = r.gasPpm;
+}
+
+// =============================================================
+// === Escritura CBOR sobre buffer fijo ===
+// =============================================================
+class CborWriter {
+ public:
+  CborWriter(uint8_t* buffer, size_t capacity) : buffer_(buffer), capacity_(capacity) {}
+
+  void head(uint8_t major, uint64_t value) {
+    const uint8_t type = (uint8_t)(major << 5);
+    if (value < 24) {
+      put(type | (uint8_t)value);
+    } else if (value <= 0xFF) {
+      put(type | 24);
+      put((uint8_t)value);
+    } else if (value <= 0xFFFF) {
+      put(type | 25);
+      putBigEndian(value, 2);
+    } else if (value <= 0xFFFFFFFFull) {
+      put(type | 26);
+      putBigEndian(value, 4);
+    } else {
+      put(type | 27);
+      putBigEndian(value, 8);
+    }
+  }
+
+  void integer(int64_t value) {
+    if (value >= 0) head(0, (uint64_t)value);
+    else head(1, (uint64_t)(-1 - value));
+  }
+
+  void text(const char* value, size_t len) {
+    head(3, len);
+    for (size_t i = 0; i < len; i++) put((uint8_t)value[i]);
+  }
+
+  void null() { put(0xF6); }
+
+  size_t length() const { return len_; }
+  bool overflow() const { return overflow_; }
+
+ private:
+  void put(uint8_t byte) {
+    if (len_ >= capacity_) {
+      overflow_ = true;
+      return;
+    }
+    buffer_[len_++] = byte;
+  }
+
+  void putBigEndian(uint64_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; i--) put((uint8_t)(value >> (8 * i)));
+  }
+
+  uint8_t* buffer_;
+  size_t capacity_;
+  size_t len_ = 0;
+  bool overflow_ = false;
+};
+
+// =============================================================
+// === Codificador ===
+// =============================================================
+class BinaryEncoder {
+ public:
+  explicit BinaryEncoder(uint16_t keyframeInterval = 20) : keyframeInterval_(keyframeInterval) {}
+
+  // Obliga a que el siguiente mensaje sea una trama clave: tras un reenvío o si
+  // el mensaje codificado no llegó a publicarse
+  void forceKeyframe() { state_.hasPrevious = false; }
+
+  size_t encode(const StoredReading& reading, const char* sensorId, uint8_t* out, size_t capacity) {
+    const bool keyframe = !state_.hasPrevious || keyframeInterval_ == 0 || sinceKeyframe_ >= keyframeInterval_;
+    const size_t idLen = strnlen(sensorId, BINARY_SENSOR_ID_MAX);
+
+    float channels[CH_COUNT];
+    readingToChannels(reading, channels);
+
+    CborWriter cbor(out, capacity);
+    cbor.head(5, 4 + (keyframe ? 1 : 0) + CH_COUNT);
+    cbor.integer(BKEY_VERSION);
+    cbor.integer(BINARY_SCHEMA_VERSION);
+    cbor.integer(BKEY_SEQ);
+    cbor.integer(seq_);
+    cbor.integer(BKEY_FLAGS);
+    cbor.integer(keyframe ? 0 : BINARY_FLAG_DELTA);
+    cbor.integer(BKEY_TIMESTAMP);
+    cbor.integer(keyframe ? reading.timestampMs : reading.timestampMs - state_.timestampMs);
+    if (keyframe) {
+      cbor.integer(BKEY_SENSOR_ID);
+      cbor.text(sensorId, idLen);
+    }
+
+    BinaryFrameState next;
+    next.timestampMs = reading.timestampMs;
+    next.hasPrevious = true;
+    for (uint8_t ch = 0; ch < CH_COUNT; ch++) {
+      int64_t q = 0;
+      next.valid[ch] = quantize(channels[ch], BINARY_SCALE[ch], q);
+      next.values[ch] = q;
+      if (!next.valid[ch]) {
+        cbor.integer(BKEY_ABSOLUTE + ch);
+        cbor.null();
+      } else if (!keyframe && state_.valid[ch]) {
+        cbor.integer(BKEY_DELTA + ch);
+        cbor.integer(q - state_.values[ch]);
+      } else {
+        cbor.integer(BKEY_ABSOLUTE + ch);
+        cbor.integer(q);
+      }
+    }
+    if (cbor.overflow()) return 0;
+
+    state_ = next;
+    seq_++;
+    sinceKeyframe_ = keyframe ? 1 : sinceKeyframe_ + 1;
+    return cbor.length();
+  }
+
+ private:
+  BinaryFrameState state_;
+  uint16_t keyframeInterval_;
+  uint16_t sinceKeyframe_ = 0;
+  uint32_t seq_ = 0;
+};
+
+// =============================================================
+// === Decodificador ===
+// =============================================================
+enum class BinaryDecodeStatus { OK, NEED_KEYFRAME, MALFORMED, UNSUPPORTED_VERSION };
+
+struct BinaryReading {
+  StoredReading reading;
+  uint32_t seq = 0;
+  bool keyframe = false;
+  char sensorId[BINARY_SENSOR_ID_MAX + 1] = "";
+};
+
+class BinaryDecoder {
+ public:
+  // Decodifica un mensaje aplicando los deltas sobre el anterior de la
+  // misma estación. Si falta un mensaje, descarta deltas hasta la próxima trama clave.
+  BinaryDecodeStatus decode(const uint8_t* data, size_t len, BinaryReading& result) {
+    p_ = data;
+    end_ = data + len;
+
+    uint8_t major;
+    uint64_t entries;
+    if (!readHead(major, entries) || major != 5) return BinaryDecodeStatus::MALFORMED;
+
+    uint64_t version = 0, seq = 0, flags = 0;
+    int64_t timestamp = 0;
+    bool haveValue[CH_COUNT] = {};
+    bool isDelta[CH_COUNT] = {};
+    bool isNull[CH_COUNT] = {};
+    int64_t values[CH_COUNT] = {};
+    result = BinaryReading();
+
+    for (uint64_t e = 0; e < entries; e++) {
+      int64_t key;
+      if (!readInteger(key)) return BinaryDecodeStatus::MALFORMED;
+      if (key == BKEY_SENSOR_ID) {
+        uint8_t textMajor;
+        uint64_t textLen;
+        if (!readHead(textMajor, textLen) || textMajor != 3 || (uint64_t)(end_ - p_) < textLen) {
+          return BinaryDecodeStatus::MALFORMED;
+        }
+        const size_t n = textLen < BINARY_SENSOR_ID_MAX ? (size_t)textLen : BINARY_SENSOR_ID_MAX;
+        memcpy(result.sensorId, p_, n);
+        result.sensorId[n] = '\0';
+        p_ += textLen;
+        continue;
+      }
+      int64_t value = 0;
+      bool null = false;
+      if (p_ < end_ && *p_ == 0xF6) {
+        null = true;
+        p_++;
+      } else if (!readInteger(value)) {
+        return BinaryDecodeStatus::MALFORMED;
+      }
+
+      if (key == BKEY_VERSION) version = (uint64_t)value;
+      else if (key == BKEY_SEQ) seq = (uint64_t)value;
+      else if (key == BKEY_FLAGS) flags = (uint64_t)value;
+      else if (key == BKEY_TIMESTAMP) timestamp = value;
+      else if (key >= BKEY_ABSOLUTE && key < BKEY_ABSOLUTE + CH_COUNT) {
+        const int ch = (int)(key - BKEY_ABSOLUTE);
+        haveValue[ch] = true;
+        isNull[ch] = null;
+        values[ch] = value;
+      } else if (key >= BKEY_DELTA && key < BKEY_DELTA + CH_COUNT) {
+        const int ch = (int)(key - BKEY_DELTA);
+        haveValue[ch] = true;
+        isDelta[ch] = true;
+        isNull[ch] = null;
+        values[ch] = value;
+      }
+      // Claves desconocidas se ignoran (compatibilidad hacia delante)
+    }
+    if (version != BINARY_SCHEMA_VERSION) return BinaryDecodeStatus::UNSUPPORTED_VERSION;
+
+    const bool delta = (flags & BINARY_FLAG_DELTA) != 0;
+    const bool inSequence = state_.hasPrevious && (uint32_t)seq == lastSeq_ + 1;
+    if (delta && !inSequence) {
+      state_.hasPrevious = false;
+      return BinaryDecodeStatus::NEED_KEYFRAME;
+    }
+
+    BinaryFrameState next;
+    next.hasPrevious = true;
+    next.timestampMs = delta ? state_.timestampMs + timestamp : timestamp;
+    for (uint8_t ch = 0; ch < CH_COUNT; ch++) {
+      if (!haveValue[ch] || isNull[ch]) continue;
+      if (isDelta[ch]) {
+        if (!state_.valid[ch]) return BinaryDecodeStatus::MALFORMED;
+        next.values[ch] = state_.values[ch] + values[ch];
+      } else {
+        next.values[ch] = values[ch];
+      }
+      next.valid[ch] = true;
+    }
+
+    state_ = next;
+    lastSeq_ = (uint32_t)seq;
+
+    float channels[CH_COUNT];
+    for (uint8_t ch = 0; ch < CH_COUNT; ch++) {
+      channels[ch] = next.valid[ch] ? (float)((double)next.values[ch] / BINARY_SCALE[ch]) : NAN;
+    }
+    StoredReading& r = result.reading;
+    r.timestampMs = next.timestampMs;
+    r.altitudeMeters = channels[CH_ALTITUDE];
+    r.temperatureC = channels[CH_TEMPERATURE];
+    r.humidityPercent = channels[CH_HUMIDITY];
+    r.windSpeedKmh = next.valid[CH_WIND] ? channels[CH_WIND] : 0.0f;
+    r.lightLux = channels[CH_LIGHT];
+    r.pressureHpa = channels[CH_PRESSURE];
+    r.gasRaw = next.valid[CH_GAS] ? (int32_t)next.values[CH_GAS] : 0;
+    r.gasPpm = channels[CH_GAS_PPM];
+    result.seq = lastSeq_;
+    result.keyframe = !delta;
+    return BinaryDecodeStatus::OK;
+  }
+
+ private:
+  bool readHead(uint8_t& major, uint64_t& value) {
+    if (p_ >= end_) return false;
+    const uint8_t initial = *p_++;
+    major = initial >> 5;
+    const uint8_t info = initial & 0x1F;
+    if (info < 24) {
+      value = info;
+      return true;
+    }
+    int bytes = info == 24 ? 1 : info == 25 ? 2 : info == 26 ? 4 : info == 27 ? 8 : 0;
+    if (bytes == 0 || end_ - p_ < bytes) return false;
+    value = 0;
+    for (int i = 0; i < bytes; i++) value = (value << 8) | *p_++;
+    return true;
+  }
+
+  bool readInteger(int64_t& value) {
+    uint8_t major;
+    uint64_t raw;
+    if (!readHead(major, raw)) return false;
+    if (major == 0) value = (int64_t)raw;
+    else if (major == 1) value = -1 - (int64_t)raw;
+    else return false;
+    return true;
+  }
+
+  const uint8_t* p_ = nullptr;
+  const uint8_t* end_ = nullptr;
+  BinaryFrameState state_;
+  uint32_t lastSeq_ = 0;
+};
@@ -0,0 +1,181 @@
+#pragma once
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// =============================================================
+// === Bus I2C abstracto ===
+// =============================================================
+// En el ESP32 lo implementa Wire; en el host, un mapa de registros simulado.
+class I2cBus {
+ public:
+  virtual ~I2cBus() {}
+  virtual bool writeRegister(uint8_t address, uint8_t reg, uint8_t value) = 0;
+  virtual bool readRegisters(uint8_t address, uint8_t reg, uint8_t* out, size_t len) = 0;
+};
+
+// =============================================================
+// === BMP085/BMP180 no bloqueante ===
+// =============================================================
+// Máquina de estados: conversión de temperatura -> N conversiones de
+// presión -> compensación (algoritmo de la hoja de datos de Bosch). Ningún
+// paso espera: start() y poll() devuelven cuántos ms faltan para el siguiente.
+// La altitud se deriva de la presión ya medida, sin otra conversión.
+class Bmp085Async {
+ public:
+  static constexpr uint8_t ADDRESS = 0x77;
+  static constexpr uint8_t REG_CALIBRATION = 0xAA;
+  static constexpr uint8_t REG_CHIP_ID = 0xD0;
+  static constexpr uint8_t REG_CONTROL = 0xF4;
+  static constexpr uint8_t REG_RESULT = 0xF6;
+  static constexpr uint8_t CHIP_ID = 0x55;
+  static constexpr uint8_t CMD_TEMPERATURE = 0x2E;
+  static constexpr uint8_t CMD_PRESSURE = 0x34;
+
+  // Tiempo máximo de conversión (ms) según la hoja de datos, redondeado hacia arriba
+  static constexpr uint8_t TEMPERATURE_CONVERSION_MS = 5;
+  static uint8_t pressureConversionMs(uint8_t oss) {
+    static const uint8_t TABLE[4] = {5, 8, 14, 26};
+    return TABLE[oss & 3];
+  }
+
+  struct Calibration {
+    int16_t ac1, ac2, ac3;
+    uint16_t ac4, ac5, ac6;
+    int16_t b1, b2, mb, mc, md;
+  };
+
+  enum class State { IDLE, TEMPERATURE, PRESSURE, FAILED };
+
+  bool begin(I2cBus* bus) {
+    bus_ = bus;
+    state_ = State::IDLE;
+    uint8_t id = 0;
+    if (!bus_ || !bus_->readRegisters(ADDRESS, REG_CHIP_ID, &id, 1) || id != CHIP_ID) return false;
+    uint8_t raw[22];
+    if (!bus_->readRegisters(ADDRESS, REG_CALIBRATION, raw, sizeof(raw))) return false;
+    int16_t* words[] = {&cal_.ac1, &cal_.ac2, &cal_.ac3, (int16_t*)&cal_.ac4, (int16_t*)&cal_.ac5,
+                        (int16_t*)&cal_.ac6, &cal_.b1, &cal_.b2, &cal_.mb, &cal_.mc, &cal_.md};
+    for (size_t i = 0; i < 11; i++) *words[i] = (int16_t)((raw[2 * i] << 8) | raw[2 * i + 1]);
+    ready_ = true;
+    return true;
+  }
+
+  void setCalibration(const Calibration& cal) {
+    cal_ = cal;
+    ready_ = true;
+  }
+
+  // 0 = ultra low power (4,5 ms) ... 3 = ultra high resolution (25,5 ms)
+  void setOversampling(uint8_t oss) { oss_ = oss > 3 ? 3 : oss; }
+  // Número de conversiones de presión que se promedian en cada medida
+  void setAveraging(uint8_t samples) { averaging_ = samples == 0 ? 1 : samples; }
+  void setSeaLevelPressure(float hPa) { seaLevelPa_ = hPa * 100.0f; }
+
+  // Lanza una medida completa; devuelve ms hasta el siguiente poll() (0 si falla)
+  uint32_t start() {
+    if (!ready_ || state_ == State::TEMPERATURE || state_ == State::PRESSURE) return 0;
+    pressureSum_ = 0;
+    pressureCount_ = 0;
+    if (!command(CMD_TEMPERATURE)) return 0;
+    state_ = State::TEMPERATURE;
+    return TEMPERATURE_CONVERSION_MS;
+  }
+
+  // Avanza la máquina de estados. Devuelve ms hasta el siguiente paso, o 0
+  // cuando ha terminado (consultar hasResult()/failed()).
+  uint32_t poll() {
+    if (state_ == State::TEMPERATURE) {
+      uint8_t raw[2];
+      if (!bus_->readRegisters(ADDRESS, REG_RESULT, raw, 2)) return fail();
+      ut_ = (int32_t)((raw[0] << 8) | raw[1]);
+      return startPressure();
+    }
+    if (state_ == State::PRESSURE) {
+      uint8_t raw[3];
+      if (!bus_->readRegisters(ADDRESS, REG_RESULT, raw, 3)) return fail();
+      const int32_t up = (int32_t)(((uint32_t)raw[0] << 16 | (uint32_t)raw[1] << 8 | raw[2]) >> (8 - oss_));
+      int32_t temperatureDeci;
+      pressureSum_ += compensate(ut_, up, temperatureDeci);
+      pressureCount_++;
+      temperatureC_ = temperatureDeci / 10.0f;
+      if (pressureCount_ < averaging_) return startPressure();
+
+      pressurePa_ = (float)pressureSum_ / (float)pressureCount_;
+      hasResult_ = true;
+      state_ = State::IDLE;
+      return 0;
+    }
+    return 0;
+  }
+
+  // Compensación entera de la hoja de datos. Devuelve Pa y temperatura en 0,1 °C
+  int32_t compensate(int32_t ut, int32_t up, int32_t& temperatureDeci) const {
+    int32_t x1 = ((ut - (int32_t)cal_.ac6) * (int32_t)cal_.ac5) >> 15;
+    int32_t x2 = ((int32_t)cal_.mc << 11) / (x1 + cal_.md);
+    const int32_t b5 = x1 + x2;
+    temperatureDeci = (b5 + 8) >> 4;
+
+    const int32_t b6 = b5 - 4000;
+    x1 = ((int32_t)cal_.b2 * ((b6 * b6) >> 12)) >> 11;
+    x2 = ((int32_t)cal_.ac2 * b6) >> 11;
+    int32_t x3 = x1 + x2;
+    const int32_t b3 = ((((int32_t)cal_.ac1 * 4 + x3) << oss_) + 2) / 4;
+    x1 = ((int32_t)cal_.ac3 * b6) >> 13;
+    x2 = ((int32_t)cal_.b1 * ((b6 * b6) >> 12)) >> 16;
+    x3 = ((x1 + x2) + 2) >> 2;
+    const uint32_t b4 = ((uint32_t)cal_.ac4 * (uint32_t)(x3 + 32768)) >> 15;
+    const uint32_t b7 = ((uint32_t)up - b3) * (uint32_t)(50000 >> oss_);
+    int32_t p = b7 < 0x80000000u ? (int32_t)((b7 * 2) / b4) : (int32_t)((b7 / b4) * 2);
+    x1 = (p >> 8) * (p >> 8);
+    x1 = (x1 * 3038) >> 16;
+    x2 = (-7357 * p) >> 16;
+    return p + ((x1 + x2 + 3791) >> 4);
+  }
+
+  // Fórmula barométrica internacional respecto a la presión de referencia
+  float altitudeFor(float pressurePa) const {
+    if (!(pressurePa > 0.0f) || !(seaLevelPa_ > 0.0f)) return NAN;
+    return 44330.0f * (1.0f - powf(pressurePa / seaLevelPa_, 1.0f / 5.255f));
+  }
+
+  bool hasResult() const { return hasResult_; }
+  bool failed() const { return state_ == State::FAILED; }
+  bool busy() const { return state_ == State::TEMPERATURE || state_ == State::PRESSURE; }
+  State state() const { return state_; }
+  float pressurePa() const { return pressurePa_; }
+  float pressureHpa() const { return pressurePa_ / 100.0f; }
+  float temperatureC() const { return temperatureC_; }
+  float altitudeMeters() const { return altitudeFor(pressurePa_); }
+  // Tiempo total de una medida con la configuración actual
+  uint32_t measurementMs() const { return TEMPERATURE_CONVERSION_MS + averaging_ * pressureConversionMs(oss_); }
+
+ private:
+  bool command(uint8_t cmd) { return bus_ && bus_->writeRegister(ADDRESS, REG_CONTROL, cmd); }
+
+  uint32_t startPressure() {
+    if (!command((uint8_t)(CMD_PRESSURE + (oss_ << 6)))) return fail();
+    state_ = State::PRESSURE;
+    return pressureConversionMs(oss_);
+  }
+
+  uint32_t fail() {
+    state_ = State::FAILED;
+    return 0;
+  }
+
+  I2cBus* bus_ = nullptr;
+  Calibration cal_ = {};
+  bool ready_ = false;
+  State state_ = State::IDLE;
+  uint8_t oss_ = 3;
+  uint8_t averaging_ = 1;
+  float seaLevelPa_ = 101325.0f;
+
+  int32_t ut_ = 0;
+  int64_t pressureSum_ = 0;
+  uint8_t pressureCount_ = 0;
+  bool hasResult_ = false;
+  float pressurePa_ = NAN;
+  float temperatureC_ = NAN;
+};
@@ -0,0 +1,138 @@
+#pragma once
+#include <atomic>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// =============================================================
+// === Arranque no bloqueante ===
+// =============================================================
+// setup() solo inicializa buses y sensores; WiFi, MQTT y NTP llegan después,
+// en segundo plano, mientras la estación ya muestrea. Un sensor que no
+// responde queda marcado como degradado en lugar de detener el equipo.
+enum class BootStage : uint8_t {
+  SENSORS = 0,  // setup(): buses, sensores y pantalla
+  NETWORK,      // WiFi, MQTT y NTP en curso; se muestrea y se encola
+  READY,        // todos los hitos alcanzados y métricas publicadas
+};
+
+// Hitos medidos en ms desde el inicio de setup()
+enum BootMilestone : uint8_t {
+  BOOT_FIRST_SAMPLE = 0,  // primera lectura completa
+  BOOT_WIFI,
+  BOOT_MQTT,
+  BOOT_TIME_SYNC,
+  BOOT_FIRST_PUBLISH,     // primera lectura confirmada por el broker
+};
+constexpr size_t BOOT_MILESTONE_COUNT = 5;
+
+// Dispositivos que pueden faltar sin detener la estación
+enum BootDevice : uint8_t {
+  DEVICE_BMP = 0,
+  DEVICE_LIGHT,
+  DEVICE_DISPLAY,
+};
+constexpr size_t BOOT_DEVICE_COUNT = 3;
+
+// Tamaño máximo del informe de writeReport()
+constexpr size_t BOOT_REPORT_MAX_LEN = 192;
+
+class BootSequence {
+ public:
+  void begin(uint32_t nowMs) {
+    startMs_ = nowMs;
+    stage_ = BootStage::SENSORS;
+    for (size_t i = 0; i < BOOT_MILESTONE_COUNT; i++) reachedAt_[i].store(0, std::memory_order_relaxed);
+    degraded_.store(0, std::memory_order_relaxed);
+  }
+
+  // Solo desde la tarea que lleva el arranque
+  BootStage stage() const { return stage_; }
+  void advance(BootStage stage) { stage_ = stage; }
+
+  // Registra el hito la primera vez que se alcanza; desde cualquier tarea.
+  // Devuelve true solo en esa primera vez.
+  bool mark(BootMilestone milestone, uint32_t nowMs) {
+    uint32_t expected = 0;
+    const uint32_t value = nowMs - startMs_ + 1;  // 0 = no alcanzado
+    return reachedAt_[milestone].compare_exchange_strong(expected, value, std::memory_order_relaxed);
+  }
+
+  bool reached(BootMilestone milestone) const { return reachedAt_[milestone].load(std::memory_order_relaxed) != 0; }
+  uint32_t elapsedMs(BootMilestone milestone) const {
+    const uint32_t value = reachedAt_[milestone].load(std::memory_order_relaxed);
+    return value ? value - 1 : 0;
+  }
+  bool complete() const {
+    for (size_t i = 0; i < BOOT_MILESTONE_COUNT; i++) {
+      if (!reached((BootMilestone)i)) return false;
+    }
+    return true;
+  }
+
+  void setDegraded(BootDevice device, bool degraded) {
+    const uint8_t bit = (uint8_t)(1u << device);
+    if (degraded) {
+      degraded_.fetch_or(bit, std::memory_order_relaxed);
+    } else {
+      degraded_.fetch_and((uint8_t)~bit, std::memory_order_relaxed);
+    }
+  }
+  bool degraded(BootDevice device) const { return (degradedMask() >> device) & 1u; }
+  uint8_t degradedMask() const { return degraded_.load(std::memory_order_relaxed); }
+
+  static const char* milestoneName(BootMilestone milestone) {
+    static const char* const NAMES[BOOT_MILESTONE_COUNT] = {"first_sample", "wifi", "mqtt", "time_sync",
+                                                            "first_publish"};
+    return milestone < BOOT_MILESTONE_COUNT ? NAMES[milestone] : "";
+  }
+  static const char* deviceName(BootDevice device) {
+    static const char* const NAMES[BOOT_DEVICE_COUNT] = {"bmp", "light", "display"};
+    return device < BOOT_DEVICE_COUNT ? NAMES[device] : "";
+  }
+
+  // {"boot_ms":{"first_sample":812,...},"degraded":["bmp"]}; null si el
+  // hito no se ha alcanzado. Devuelve la longitud, o 0 si no cabe.
+  size_t writeReport(char* out, size_t capacity) const {
+    size_t len = 0;
+    if (!append(out, capacity, len, "{\"boot_ms\":{")) return 0;
+    for (size_t i = 0; i < BOOT_MILESTONE_COUNT; i++) {
+      const BootMilestone m = (BootMilestone)i;
+      char value[12];
+      if (reached(m)) {
+        snprintf(value, sizeof(value), "%lu", (unsigned long)elapsedMs(m));
+      } else {
+        snprintf(value, sizeof(value), "null");
+      }
+      if (!append(out, capacity, len, "%s\"%s\":%s", i ? "," : "", milestoneName(m), value)) return 0;
+    }
+    if (!append(out, capacity, len, "},\"degraded\":[")) return 0;
+    bool first = true;
+    for (size_t i = 0; i < BOOT_DEVICE_COUNT; i++) {
+      if (!degraded((BootDevice)i)) continue;
+      if (!append(out, capacity, len, "%s\"%s\"", first ? "" : ",", deviceName((BootDevice)i))) return 0;
+      first = false;
+    }
+    if (!append(out, capacity, len, "]}")) return 0;
+    return len;
+  }
+
+ private:
+  static bool append(char* out, size_t capacity, size_t& len, const char* format, ...)
+      __attribute__((format(printf, 4, 5))) {
+    if (len >= capacity) return false;
+    va_list args;
+    va_start(args, format);
+    const int n = vsnprintf(out + len, capacity - len, format, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= capacity - len) return false;
+    len += (size_t)n;
+    return true;
+  }
+
+  uint32_t startMs_ = 0;
+  BootStage stage_ = BootStage::SENSORS;
+  std::atomic<uint32_t> reachedAt_[BOOT_MILESTONE_COUNT] = {};
+  std::atomic<uint8_t> degraded_{0};
+};
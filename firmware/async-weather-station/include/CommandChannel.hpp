@@ -0,0 +1,281 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "JsonPointer.hpp"
+#include "PayloadWriter.hpp"
+
+// =============================================================
+// === Buzón de comandos con reensamblado de fragmentos ===
+// =============================================================
+// AsyncMqttClient entrega un mensaje grande en varios trozos (index, total)
+// que no terminan en '\0'. Cada trozo se copia una sola vez, directamente al
+// hueco libre del buzón; el mensaje completo pasa a la tarea de red, que lo
+// procesa en ese mismo buffer y lo libera. Un mensaje que no cabe, que llega
+// desordenado o que encuentra el buzón lleno se descarta entero.
+//
+// Un productor (callback MQTT) y un consumidor (tarea de red).
+enum class AssembleResult : uint8_t {
+  PARTIAL = 0,  // faltan trozos
+  COMPLETE,     // mensaje listo en front()
+  TOO_LARGE,    // total >= Capacity
+  BUSY,         // todos los huecos ocupados
+  BROKEN,       // trozo fuera de orden o fuera de rango
+};
+
+struct CommandInboxMetrics {
+  uint32_t received = 0;
+  uint32_t tooLarge = 0;
+  uint32_t busy = 0;
+  uint32_t broken = 0;
+};
+
+template <size_t Slots, size_t Capacity>
+class CommandInbox {
+  static_assert(Slots >= 2 && (Slots & (Slots - 1)) == 0, "Slots debe ser potencia de 2");
+
+ public:
+  static constexpr size_t MAX_MESSAGE_LEN = Capacity - 1;
+
+  // Solo desde el productor
+  AssembleResult add(const char* data, size_t len, size_t index, size_t total) {
+    if (index == 0) {
+      filled_ = 0;
+      total_ = total;
+      discarding_ = false;
+      if (total > MAX_MESSAGE_LEN) return reject(AssembleResult::TOO_LARGE, metrics_.tooLarge, index + len, total);
+      const uint32_t head = head_.load(std::memory_order_relaxed);
+      if (head - tail_.load(std::memory_order_acquire) >= Slots) {
+        return reject(AssembleResult::BUSY, metrics_.busy, index + len, total);
+      }
+    } else if (discarding_) {
+      if (index + len >= total) discarding_ = false;
+      return AssembleResult::PARTIAL;
+    }
+    if (index != filled_ || total != total_ || len > total - index) return reject(AssembleResult::BROKEN, metrics_.broken, index + len, total);
+
+    Slot& slot = slots_[head_.load(std::memory_order_relaxed) & (Slots - 1)];
+    memcpy(slot.text + filled_, data, len);
+    filled_ += len;
+    if (filled_ < total) return AssembleResult::PARTIAL;
+
+    slot.text[filled_] = '\0';
+    slot.len = filled_;
+    filled_ = 0;
+    total_ = SIZE_MAX;
+    metrics_.received++;
+    head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    return AssembleResult::COMPLETE;
+  }
+
+  // Solo desde el consumidor: mensaje más antiguo (modificable) o nullptr
+  char* front(size_t& len) {
+    const uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) return nullptr;
+    Slot& slot = slots_[tail & (Slots - 1)];
+    len = slot.len;
+    return slot.text;
+  }
+
+  void pop() { tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  // Aproximadas si se leen desde el consumidor
+  const CommandInboxMetrics& metrics() const { return metrics_; }
+
+ private:
+  struct Slot {
+    char text[Capacity];
+    size_t len;
+  };
+
+  // `received`: bytes del mensaje entregados hasta este trozo incluido
+  AssembleResult reject(AssembleResult result, uint32_t& counter, size_t received, size_t total) {
+    counter++;
+    discarding_ = received < total;  // hasta el último trozo de este mensaje
+    filled_ = 0;
+    total_ = SIZE_MAX;  // ningún trozo posterior continúa este mensaje
+    return result;
+  }
+
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> tail_{0};
+  size_t filled_ = 0;
+  size_t total_ = SIZE_MAX;
+  bool discarding_ = false;
+  CommandInboxMetrics metrics_;
+  Slot slots_[Slots];
+};
+
+// =============================================================
+// === Tabla de comandos ===
+// =============================================================
+// Un comando es un objeto JSON con "cmd" y, opcionalmente, "id" (se repite
+// en la respuesta) y argumentos propios:
+//
+//   {"cmd":"interval","id":"7","min_ms":60000}
+//   -> {"id":"7","cmd":"interval","status":"ok","result":{...}}
+//
+// Los manejadores leen argumentos con JSON Pointer sobre el propio mensaje
+// y escriben su resultado con CommandResult; nada pasa por el heap.
+enum class CommandStatus : uint8_t {
+  OK = 0,
+  NOT_COMMAND,  // no es un objeto JSON: texto libre para la pantalla
+  MALFORMED,    // JSON inválido o sin "cmd"
+  UNKNOWN,      // "cmd" no está en la tabla
+  BAD_ARGS,
+  FAILED,
+};
+constexpr size_t COMMAND_STATUS_COUNT = 6;
+
+// Campos "clave":valor dentro de "result", con las comas ya resueltas
+class CommandResult {
+ public:
+  explicit CommandResult(JsonWriter& json) : json_(json) {}
+
+  CommandResult& integer(const char* name, int64_t value) {
+    key(name).integer(value);
+    return *this;
+  }
+  CommandResult& number(const char* name, double value, uint8_t decimals) {
+    key(name).number(value, decimals);
+    return *this;
+  }
+  CommandResult& text(const char* name, const char* value) {
+    key(name).string(value);
+    return *this;
+  }
+  CommandResult& flag(const char* name, bool value) {
+    key(name).raw(value ? "true" : "false");
+    return *this;
+  }
+
+ private:
+  JsonWriter& key(const char* name) {
+    if (fields_++ > 0) json_.literal(",");
+    return json_.string(name).literal(":");
+  }
+
+  JsonWriter& json_;
+  size_t fields_ = 0;
+};
+
+// Argumentos de un comando ya tokenizado
+class CommandRequest {
+ public:
+  explicit CommandRequest(const JsonTokenizer& json) : json_(json) {}
+
+  const char* name() const { return json_.string(json_.find("/cmd")); }
+  bool has(const char* pointer) const { return json_.find(pointer) >= 0; }
+  bool number(const char* pointer, double& value) const { return json_.number(json_.find(pointer), value); }
+  bool integer(const char* pointer, int32_t& value) const { return json_.integer(json_.find(pointer), value); }
+  bool boolean(const char* pointer, bool& value) const { return json_.boolean(json_.find(pointer), value); }
+  const char* string(const char* pointer) const { return json_.string(json_.find(pointer)); }
+
+  // Motivo que acompaña a BAD_ARGS o FAILED en la respuesta
+  void setError(const char* error) { error_ = error; }
+  const char* error() const { return error_; }
+
+ private:
+  const JsonTokenizer& json_;
+  const char* error_ = nullptr;
+};
+
+typedef CommandStatus (*CommandHandler)(CommandRequest& request, CommandResult& result);
+
+struct CommandEntry {
+  const char* name;
+  CommandHandler handler;
+};
+
+template <size_t MaxTokens>
+class CommandDispatcher {
+ public:
+  CommandDispatcher(const CommandEntry* table, size_t count) : table_(table), count_(count) {}
+
+  // Procesa un mensaje completo (el texto se modifica) y escribe la
+  // respuesta en `reply`. replyLen queda a 0 si no hay nada que responder
+  // (NOT_COMMAND) o si ni la respuesta mínima cabe.
+  CommandStatus handle(char* text, size_t len, char* reply, size_t capacity, size_t& replyLen) {
+    replyLen = 0;
+    size_t first = 0;
+    while (first < len && (text[first] == ' ' || text[first] == '\n' || text[first] == '\r' || text[first] == '\t')) {
+      first++;
+    }
+    if (first == len || text[first] != '{') return tally(CommandStatus::NOT_COMMAND);
+
+    JsonTokenizer json(tokens_, MaxTokens);
+    CommandRequest request(json);
+    const char* id = nullptr;
+    const char* name = nullptr;
+    if (json.parse(text, len)) {
+      id = json.string(json.find("/id"));
+      name = request.name();
+    }
+    const CommandEntry* entry = name ? lookup(name) : nullptr;
+    CommandStatus status = name ? CommandStatus::UNKNOWN : CommandStatus::MALFORMED;
+
+    JsonWriter out(reply, capacity);
+    writeHead(out, id, name);
+    if (entry) {
+      out.literal("\"result\":{");
+      CommandResult result(out);
+      status = entry->handler(request, result);
+      out.literal("},");
+      if (out.overflow()) {
+        // Se responde igualmente, sin "result"
+        out = JsonWriter(reply, capacity);
+        writeHead(out, id, name);
+        if (!request.error()) request.setError("resultado demasiado largo");
+      }
+    }
+    out.literal("\"status\":\"").raw(statusName(status)).literal("\"");
+    const char* error = request.error();
+    if (!error && status == CommandStatus::MALFORMED) error = "se espera un objeto JSON con \"cmd\"";
+    if (error) out.literal(",\"error\":").string(error);
+    out.literal("}");
+    if (!out.overflow()) replyLen = out.length();
+    return tally(status);
+  }
+
+  size_t size() const { return count_; }
+  const char* name(size_t i) const { return i < count_ ? table_[i].name : ""; }
+
+  uint32_t count(CommandStatus status) const { return counts_[(size_t)status]; }
+
+  static const char* statusName(CommandStatus status) {
+    switch (status) {
+      case CommandStatus::OK: return "ok";
+      case CommandStatus::NOT_COMMAND: return "not_command";
+      case CommandStatus::MALFORMED: return "malformed";
+      case CommandStatus::UNKNOWN: return "unknown";
+      case CommandStatus::BAD_ARGS: return "bad_args";
+      default: return "failed";
+    }
+  }
+
+ private:
+  CommandStatus tally(CommandStatus status) {
+    counts_[(size_t)status]++;
+    return status;
+  }
+
+  static void writeHead(JsonWriter& out, const char* id, const char* name) {
+    out.literal("{");
+    if (id) out.literal("\"id\":").string(id).literal(",");
+    if (name) out.literal("\"cmd\":").string(name).literal(",");
+  }
+
+  const CommandEntry* lookup(const char* name) const {
+    for (size_t i = 0; i < count_; i++) {
+      if (strcmp(table_[i].name, name) == 0) return &table_[i];
+    }
+    return nullptr;
+  }
+
+  const CommandEntry* table_;
+  size_t count_;
+  JsonToken tokens_[MaxTokens];
+  uint32_t counts_[COMMAND_STATUS_COUNT] = {};
+};
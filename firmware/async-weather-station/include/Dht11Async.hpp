@@ -0,0 +1,262 @@
+#pragma once
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// =============================================================
+// === Línea de datos del DHT abstracta ===
+// =============================================================
+// En el ESP32 la implementa un canal RX del RMT sobre el pin en drenador
+// abierto: el periférico mide cada nivel con resolución de 1 µs y avisa al
+// acabar la trama, sin desactivar interrupciones (la ISR del anemómetro
+// sigue contando). En el host, un modelo que genera las duraciones.
+struct DhtRun {
+  uint8_t level;  // 0 = línea a nivel bajo
+  uint16_t us;
+};
+
+class DhtLine {
+ public:
+  virtual ~DhtLine() {}
+  // Señal de inicio: línea a nivel bajo (al menos 18 ms para el DHT11)
+  virtual void driveLow() = 0;
+  // Suelta la línea y empieza a capturar niveles; false si no se pudo armar
+  virtual bool releaseAndCapture() = 0;
+  // true cuando la trama ha terminado; runs sigue válido hasta la siguiente captura
+  virtual bool captured(const DhtRun*& runs, size_t& count) = 0;
+  virtual void abortCapture() = 0;
+};
+
+// =============================================================
+// === Decodificación de la trama del DHT11 ===
+// =============================================================
+// Tras soltar la línea: respuesta del sensor (80 µs bajo, 80 µs alto) y 40
+// bits, cada uno 50 µs bajo + 26-28 µs alto (0) o 70 µs alto (1). Bytes:
+// humedad entera y decimal, temperatura entera y decimal (bit 7 = signo en
+// los DHT11 que miden bajo cero) y suma de comprobación. Las tolerancias
+// son amplias (cable largo, sensor frío); entre 0 y 1 queda un hueco que se
+// rechaza en lugar de adivinar.
+enum class DhtError : uint8_t {
+  NONE = 0,
+  NO_RESPONSE,   // sin pulso de respuesta (sensor ausente o línea en corto)
+  TRUNCATED,     // la trama acaba antes del bit 40
+  BAD_TIMING,    // un nivel fuera de tolerancia
+  CHECKSUM,
+  OUT_OF_RANGE,  // suma correcta pero valores imposibles (p. ej. todo ceros)
+};
+constexpr size_t DHT_ERROR_COUNT = 6;
+
+constexpr uint16_t DHT_GLITCH_US = 5;          // más corto se une al nivel anterior
+constexpr uint16_t DHT_RESPONSE_MIN_US = 50;
+constexpr uint16_t DHT_RESPONSE_MAX_US = 120;
+constexpr uint16_t DHT_BIT_LOW_MIN_US = 30;
+constexpr uint16_t DHT_BIT_LOW_MAX_US = 90;
+constexpr uint16_t DHT_ZERO_MAX_US = 45;
+constexpr uint16_t DHT_ONE_MIN_US = 55;
+constexpr uint16_t DHT_ONE_MAX_US = 100;
+constexpr size_t DHT_RESPONSE_SEARCH = 6;      // la respuesta va en los primeros niveles
+constexpr size_t DHT_MAX_RUNS = 128;
+
+struct DhtFrame {
+  uint8_t bytes[5] = {};
+  float humidityPercent = NAN;
+  float temperatureC = NAN;
+};
+
+inline const char* dhtErrorName(DhtError e) {
+  static const char* const NAMES[DHT_ERROR_COUNT] = {"ok", "no_response", "truncated", "bad_timing", "checksum",
+                                                     "out_of_range"};
+  return (size_t)e < DHT_ERROR_COUNT ? NAMES[(size_t)e] : "?";
+}
+
+inline bool dhtInRange(uint16_t us, uint16_t lo, uint16_t hi) { return us >= lo && us <= hi; }
+
+inline DhtError decodeDht11(const DhtRun* input, size_t count, DhtFrame& frame) {
+  // Niveles seguidos iguales y pulsos espurios se funden con el anterior
+  DhtRun runs[DHT_MAX_RUNS];
+  size_t n = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (input[i].us == 0) break;  // fin de captura (duración 0 del RMT)
+    if (n > 0 && (input[i].level == runs[n - 1].level || input[i].us < DHT_GLITCH_US)) {
+      const uint32_t us = (uint32_t)runs[n - 1].us + input[i].us;
+      runs[n - 1].us = us > 0xFFFF ? 0xFFFF : (uint16_t)us;
+      continue;
+    }
+    if (n == DHT_MAX_RUNS) break;
+    runs[n++] = input[i];
+  }
+
+  size_t j = 0;
+  for (; j + 1 < n && j < DHT_RESPONSE_SEARCH; j++) {
+    if (runs[j].level == 0 && dhtInRange(runs[j].us, DHT_RESPONSE_MIN_US, DHT_RESPONSE_MAX_US) &&
+        dhtInRange(runs[j + 1].us, DHT_RESPONSE_MIN_US, DHT_RESPONSE_MAX_US)) {
+      break;
+    }
+  }
+  if (j + 1 >= n || j >= DHT_RESPONSE_SEARCH) return DhtError::NO_RESPONSE;
+  j += 2;
+
+  uint8_t bytes[5] = {};
+  for (size_t bit = 0; bit < 40; bit++, j += 2) {
+    if (j + 1 >= n) return DhtError::TRUNCATED;
+    if (!dhtInRange(runs[j].us, DHT_BIT_LOW_MIN_US, DHT_BIT_LOW_MAX_US)) return DhtError::BAD_TIMING;
+    const uint16_t high = runs[j + 1].us;
+    bytes[bit / 8] <<= 1;
+    if (dhtInRange(high, DHT_ONE_MIN_US, DHT_ONE_MAX_US)) {
+      bytes[bit / 8] |= 1;
+    } else if (high > DHT_ZERO_MAX_US) {
+      return DhtError::BAD_TIMING;
+    }
+  }
+  for (size_t i = 0; i < 5; i++) frame.bytes[i] = bytes[i];
+  if ((uint8_t)(bytes[0] + bytes[1] + bytes[2] + bytes[3]) != bytes[4]) return DhtError::CHECKSUM;
+
+  const float humidity = bytes[0] + bytes[1] * 0.1f;
+  float temperature = bytes[2] + (bytes[3] & 0x7F) * 0.1f;
+  if (bytes[3] & 0x80) temperature = -temperature;
+  if ((bytes[0] == 0 && bytes[2] == 0) || humidity > 100.0f || bytes[1] > 9 || (bytes[3] & 0x7F) > 9 ||
+      temperature < -40.0f || temperature > 80.0f) {
+    return DhtError::OUT_OF_RANGE;
+  }
+  frame.humidityPercent = humidity;
+  frame.temperatureC = temperature;
+  return DhtError::NONE;
+}
+
+// =============================================================
+// === DHT11 no bloqueante ===
+// =============================================================
+// Máquina de estados como Bmp085Async: start() lanza la señal de inicio y
+// poll() avanza (soltar y capturar -> decodificar -> reintento), y los dos
+// devuelven los ms que faltan para el siguiente paso (0 = terminado).
+// Nunca se lee antes de minIntervalMs desde el inicio anterior: mientras
+// tanto vale la última lectura. Una lectura fallida se reintenta hasta
+// maxRetries veces; tras maxFailures lecturas fallidas seguidas los valores
+// pasan a NAN.
+struct Dht11Config {
+  uint32_t minIntervalMs = 1000;   // hoja de datos: como mucho una lectura por segundo
+  uint32_t startLowMs = 20;        // >= 18 ms
+  uint32_t capturePollMs = 5;      // la trama dura unos 4,5 ms
+  uint32_t captureTimeoutMs = 20;
+  uint8_t maxRetries = 1;
+  uint8_t maxFailures = 3;
+};
+
+class Dht11Async {
+ public:
+  enum class Phase : uint8_t { IDLE, START_LOW, CAPTURING, RETRY_WAIT };
+
+  explicit Dht11Async(DhtLine* line) : line_(line) {}
+
+  void configure(const Dht11Config& config) { config_ = config; }
+  const Dht11Config& config() const { return config_; }
+
+  // 0 si no hay nada que hacer (lectura en curso o reciente)
+  uint32_t start(uint32_t nowMs) {
+    if (phase_ != Phase::IDLE) return 0;
+    if (started_ && nowMs - lastStartMs_ < config_.minIntervalMs) {
+      cacheHits_++;
+      return 0;
+    }
+    attempt_ = 0;
+    return beginAttempt(nowMs);
+  }
+
+  uint32_t poll(uint32_t nowMs) {
+    switch (phase_) {
+      case Phase::START_LOW:
+        if (!line_->releaseAndCapture()) return finish(nowMs, DhtError::NO_RESPONSE, nullptr);
+        captureStartMs_ = nowMs;
+        phase_ = Phase::CAPTURING;
+        return config_.capturePollMs;
+      case Phase::CAPTURING: {
+        const DhtRun* runs = nullptr;
+        size_t count = 0;
+        if (line_->captured(runs, count)) {
+          DhtFrame frame;
+          const DhtError error = decodeDht11(runs, count, frame);
+          return finish(nowMs, error, &frame);
+        }
+        if (nowMs - captureStartMs_ >= config_.captureTimeoutMs) {
+          line_->abortCapture();
+          return finish(nowMs, DhtError::NO_RESPONSE, nullptr);
+        }
+        return 1;
+      }
+      case Phase::RETRY_WAIT:
+        return beginAttempt(nowMs);
+      default:
+        return 0;
+    }
+  }
+
+  // true una sola vez por lectura terminada (correcta o no)
+  bool takeUpdate() {
+    const bool updated = updated_;
+    updated_ = false;
+    return updated;
+  }
+
+  Phase phase() const { return phase_; }
+  bool valid() const { return !isnan(temperature_); }
+  float temperatureC() const { return temperature_; }
+  float humidityPercent() const { return humidity_; }
+  DhtError lastError() const { return lastError_; }
+  uint8_t consecutiveFailures() const { return failures_; }
+  uint32_t errors(DhtError e) const { return errors_[(size_t)e]; }
+  uint32_t attempts() const { return attempts_; }
+  uint32_t cacheHits() const { return cacheHits_; }
+
+ private:
+  uint32_t beginAttempt(uint32_t nowMs) {
+    line_->driveLow();
+    started_ = true;
+    lastStartMs_ = nowMs;
+    attempts_++;
+    phase_ = Phase::START_LOW;
+    return config_.startLowMs;
+  }
+
+  uint32_t finish(uint32_t nowMs, DhtError error, const DhtFrame* frame) {
+    lastError_ = error;
+    errors_[(size_t)error]++;
+    if (error == DhtError::NONE) {
+      temperature_ = frame->temperatureC;
+      humidity_ = frame->humidityPercent;
+      failures_ = 0;
+      updated_ = true;
+      phase_ = Phase::IDLE;
+      return 0;
+    }
+    if (attempt_ < config_.maxRetries) {
+      attempt_++;
+      phase_ = Phase::RETRY_WAIT;
+      const uint32_t elapsed = nowMs - lastStartMs_;
+      return elapsed >= config_.minIntervalMs ? 1 : config_.minIntervalMs - elapsed;
+    }
+    if (failures_ < 0xFF) failures_++;
+    if (failures_ >= config_.maxFailures) {
+      temperature_ = NAN;
+      humidity_ = NAN;
+    }
+    updated_ = true;
+    phase_ = Phase::IDLE;
+    return 0;
+  }
+
+  DhtLine* line_;
+  Dht11Config config_;
+  Phase phase_ = Phase::IDLE;
+  bool started_ = false;
+  uint32_t lastStartMs_ = 0;
+  uint32_t captureStartMs_ = 0;
+  uint8_t attempt_ = 0;
+  uint8_t failures_ = 0;
+  bool updated_ = false;
+  float temperature_ = NAN;
+  float humidity_ = NAN;
+  DhtError lastError_ = DhtError::NONE;
+  uint32_t errors_[DHT_ERROR_COUNT] = {};
+  uint32_t attempts_ = 0;
+  uint32_t cacheHits_ = 0;
+};
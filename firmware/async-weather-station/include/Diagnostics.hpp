@@ -0,0 +1,277 @@
+#pragma once
+#include <atomic>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// =============================================================
+// === Diagnóstico del camino crítico (filtrado en compilación) ===
+// =============================================================
+// DIAG_SCOPE(etapa) mide con el contador de ciclos de la CPU lo que tarda el
+// resto del bloque y lo acumula en el histograma de esa etapa; DIAG_LOOP()
+// hace lo mismo con la separación entre dos vueltas de una tarea. Con
+// DIAG_ENABLED 0 las macros no generan código y el objeto `diagnostics` no
+// existe, así que no cuesta ni un ciclo ni un byte de RAM.
+#ifndef DIAG_ENABLED
+#define DIAG_ENABLED 0
+#endif
+
+// Etapas medidas. Cada una la escribe siempre la misma tarea.
+enum DiagStage : uint8_t {
+  DIAG_DHT = 0,     // sensores: señal de inicio y decodificación del DHT
+  DIAG_BMP,         // sensores: arranque y recogida de conversiones I2C
+  DIAG_LIGHT,       // sensores: BH1750
+  DIAG_SNAPSHOT,    // sensores: instantánea, filtro de publicación y cola entre núcleos
+  DIAG_CYCLE,       // red: publishCurrentData() completo
+  DIAG_LOG,         // red: logSensorData()
+  DIAG_SERIALIZE,   // red: JSON, CBOR o lote
+  DIAG_PUBLISH,     // red: mqttClient.publish()
+  DIAG_STORE,       // red: escritura y borrado en la cola de LittleFS
+  DIAG_DISPLAY,     // red: campos y volcado parcial de la OLED
+  DIAG_COMMAND,     // red: interpretar y responder un comando
+};
+constexpr size_t DIAG_STAGE_COUNT = 11;
+
+// Tareas cuya separación entre vueltas se mide
+enum DiagLoop : uint8_t {
+  DIAG_LOOP_SENSORS = 0,
+  DIAG_LOOP_NETWORK,
+};
+constexpr size_t DIAG_LOOP_COUNT = 2;
+
+// Tamaño máximo del informe de writeReport()
+constexpr size_t DIAG_REPORT_MAX_LEN = 2048;
+
+// =============================================================
+// === Histograma logarítmico de latencias ===
+// =============================================================
+// Cubo 0: 0 us; cubo i: [2^(i-1), 2^i) us; el último recoge todo lo que
+// pase de 2^(BUCKETS-2) us (~4 s). Registrar cuesta un clz y un incremento.
+// Un solo escritor; los contadores son atómicos relajados para que otra
+// tarea los lea sin carreras, y solo crecen: el informe publica la
+// diferencia con la copia anterior.
+class LatencyHistogram {
+ public:
+  static constexpr size_t BUCKETS = 24;
+
+  void add(uint32_t us) {
+    const size_t b = bucketFor(us);
+    bump(counts_[b]);
+    bump(total_);
+    if (us > max_.load(std::memory_order_relaxed)) max_.store(us, std::memory_order_relaxed);
+  }
+
+  uint32_t count(size_t bucket) const { return counts_[bucket].load(std::memory_order_relaxed); }
+  uint32_t total() const { return total_.load(std::memory_order_relaxed); }
+  uint32_t max() const { return max_.load(std::memory_order_relaxed); }
+
+  static size_t bucketFor(uint32_t us) {
+    if (us == 0) return 0;
+    const size_t b = 32 - (size_t)__builtin_clz(us);
+    return b < BUCKETS ? b : BUCKETS - 1;
+  }
+  // Cota superior del cubo en us (la del último es abierta)
+  static uint32_t bucketLimit(size_t bucket) { return bucket == 0 ? 0 : (uint32_t)1 << bucket; }
+
+ private:
+  static void bump(std::atomic<uint32_t>& c) {
+    c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  std::atomic<uint32_t> counts_[BUCKETS] = {};
+  std::atomic<uint32_t> total_{0};
+  std::atomic<uint32_t> max_{0};
+};
+
+// Memoria libre en el momento de la muestra (la lee el sketch)
+struct HeapSample {
+  uint32_t freeBytes = 0;
+  uint32_t minFreeBytes = 0;   // marca mínima del propio heap desde el arranque
+  uint32_t maxBlockBytes = 0;  // mayor bloque reservable
+  int32_t steadyAllocations = -1;  // reservas de las tareas del firmware tras el arranque (-1 = no se cuentan)
+};
+
+// =============================================================
+// === Diagnóstico ===
+// =============================================================
+class Diagnostics {
+ public:
+  typedef uint32_t (*CycleFn)();
+
+  // cycles: contador de ciclos de la CPU (ESP.getCycleCount()); cada tarea
+  // está fijada a un núcleo, así que inicio y fin usan el mismo contador
+  void begin(CycleFn cycles, uint32_t cyclesPerUs) {
+    cycles_ = cycles;
+    cyclesPerUs_ = cyclesPerUs ? cyclesPerUs : 1;
+  }
+
+  uint32_t now() const { return cycles_ ? cycles_() : 0; }
+  uint32_t toUs(uint32_t cycles) const { return cycles / cyclesPerUs_; }
+
+  void record(DiagStage stage, uint32_t startCycles) { stages_[stage].add(toUs(now() - startCycles)); }
+
+  void loopTick(DiagLoop loop) {
+    const uint32_t t = now();
+    if (loopStarted_[loop]) loops_[loop].add(toUs(t - lastLoop_[loop]));
+    lastLoop_[loop] = t;
+    loopStarted_[loop] = true;
+  }
+
+  // Solo desde la tarea que publica
+  void sampleHeap(const HeapSample& sample) {
+    heap_ = sample;
+    if (!haveHeap_ || sample.freeBytes < lowFree_) lowFree_ = sample.freeBytes;
+    if (!haveHeap_ || sample.maxBlockBytes < lowMaxBlock_) lowMaxBlock_ = sample.maxBlockBytes;
+    haveHeap_ = true;
+  }
+
+  const LatencyHistogram& stage(DiagStage stage) const { return stages_[stage]; }
+  const LatencyHistogram& loop(DiagLoop loop) const { return loops_[loop]; }
+
+  static const char* stageName(DiagStage stage) {
+    static const char* const NAMES[DIAG_STAGE_COUNT] = {"dht",       "bmp", "light",   "snapshot", "cycle",  "log",
+                                                        "serialize", "publish", "store", "display", "command"};
+    return stage < DIAG_STAGE_COUNT ? NAMES[stage] : "";
+  }
+  static const char* loopName(DiagLoop loop) {
+    static const char* const NAMES[DIAG_LOOP_COUNT] = {"sensors", "network"};
+    return loop < DIAG_LOOP_COUNT ? NAMES[loop] : "";
+  }
+
+  // {"window_ms":60000,"stages":{"dht":{"n":30,"p50":4096,"p99":8192,"max":5210,"b":[0,...]},...},
+  //  "loops":{...},"heap":{...,"allocs":0},"mqtt_inflight":1}
+  // Por etapa, lo ocurrido desde el informe anterior: n, percentiles (cota
+  // superior del cubo, en us) y los cubos hasta el último no vacío; "max" es
+  // desde el arranque. Las etapas sin muestras en la ventana se omiten.
+  // Devuelve la longitud, o 0 si no cabe. La ventana no avanza hasta commit(),
+  // que se llama cuando el informe ha salido.
+  size_t writeReport(char* out, size_t capacity, uint32_t windowMs, uint32_t mqttInflight) {
+    size_t len = 0;
+    if (!append(out, capacity, len, "{\"window_ms\":%lu,\"stages\":{", (unsigned long)windowMs)) return 0;
+    bool first = true;
+    for (size_t i = 0; i < DIAG_STAGE_COUNT; i++) {
+      if (!writeHistogram(out, capacity, len, first, stageName((DiagStage)i), stages_[i], stagePublished_[i], stagePending_[i])) return 0;
+    }
+    if (!append(out, capacity, len, "},\"loops\":{")) return 0;
+    first = true;
+    for (size_t i = 0; i < DIAG_LOOP_COUNT; i++) {
+      if (!writeHistogram(out, capacity, len, first, loopName((DiagLoop)i), loops_[i], loopPublished_[i], loopPending_[i])) return 0;
+    }
+    if (!append(out, capacity, len,
+                "},\"heap\":{\"free\":%lu,\"min_free\":%lu,\"low_free\":%lu,\"max_block\":%lu,\"low_max_block\":%lu",
+                (unsigned long)heap_.freeBytes, (unsigned long)heap_.minFreeBytes, (unsigned long)lowFree_,
+                (unsigned long)heap_.maxBlockBytes, (unsigned long)lowMaxBlock_)) {
+      return 0;
+    }
+    if (heap_.steadyAllocations >= 0 && !append(out, capacity, len, ",\"allocs\":%ld", (long)heap_.steadyAllocations)) {
+      return 0;
+    }
+    if (!append(out, capacity, len, "},\"mqtt_inflight\":%lu}", (unsigned long)mqttInflight)) return 0;
+    return len;
+  }
+
+  // La ventana siguiente empieza justo en lo que se leyó para el último
+  // informe: lo que el escritor sumase mientras tanto entra en el siguiente
+  void commit() {
+    for (size_t i = 0; i < DIAG_STAGE_COUNT; i++) stagePublished_[i] = stagePending_[i];
+    for (size_t i = 0; i < DIAG_LOOP_COUNT; i++) loopPublished_[i] = loopPending_[i];
+  }
+
+ private:
+  struct Snapshot {
+    uint32_t counts[LatencyHistogram::BUCKETS] = {};
+  };
+
+  bool writeHistogram(char* out, size_t capacity, size_t& len, bool& first, const char* name,
+                      const LatencyHistogram& h, const Snapshot& published, Snapshot& pending) {
+    uint32_t delta[LatencyHistogram::BUCKETS];
+    uint32_t n = 0;
+    size_t last = 0;
+    for (size_t b = 0; b < LatencyHistogram::BUCKETS; b++) {
+      pending.counts[b] = h.count(b);
+      delta[b] = pending.counts[b] - published.counts[b];
+      n += delta[b];
+      if (delta[b]) last = b;
+    }
+    if (n == 0) return true;
+    if (!append(out, capacity, len, "%s\"%s\":{\"n\":%lu,\"p50\":%lu,\"p99\":%lu,\"max\":%lu,\"b\":[", first ? "" : ",",
+                name, (unsigned long)n, (unsigned long)percentile(delta, n, 50, h.max()),
+                (unsigned long)percentile(delta, n, 99, h.max()), (unsigned long)h.max())) {
+      return false;
+    }
+    first = false;
+    for (size_t b = 0; b <= last; b++) {
+      if (!append(out, capacity, len, "%s%lu", b ? "," : "", (unsigned long)delta[b])) return false;
+    }
+    return append(out, capacity, len, "]}");
+  }
+
+  // Cota superior del cubo donde cae el percentil `pct`, sin pasar del máximo
+  static uint32_t percentile(const uint32_t* counts, uint32_t n, uint32_t pct, uint32_t max) {
+    const uint32_t rank = (uint32_t)(((uint64_t)n * pct + 99) / 100);
+    uint32_t acc = 0;
+    size_t b = 0;
+    for (; b < LatencyHistogram::BUCKETS - 1; b++) {
+      acc += counts[b];
+      if (acc >= rank) break;
+    }
+    const uint32_t limit = LatencyHistogram::bucketLimit(b);
+    return limit < max ? limit : max;
+  }
+
+  static bool append(char* out, size_t capacity, size_t& len, const char* format, ...)
+      __attribute__((format(printf, 4, 5))) {
+    if (len >= capacity) return false;
+    va_list args;
+    va_start(args, format);
+    const int n = vsnprintf(out + len, capacity - len, format, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= capacity - len) return false;
+    len += (size_t)n;
+    return true;
+  }
+
+  CycleFn cycles_ = nullptr;
+  uint32_t cyclesPerUs_ = 1;
+  LatencyHistogram stages_[DIAG_STAGE_COUNT];
+  LatencyHistogram loops_[DIAG_LOOP_COUNT];
+  uint32_t lastLoop_[DIAG_LOOP_COUNT] = {};
+  bool loopStarted_[DIAG_LOOP_COUNT] = {};
+  // Contadores ya publicados y los leídos para el informe en curso (solo
+  // los toca la tarea que publica)
+  Snapshot stagePublished_[DIAG_STAGE_COUNT];
+  Snapshot loopPublished_[DIAG_LOOP_COUNT];
+  Snapshot stagePending_[DIAG_STAGE_COUNT];
+  Snapshot loopPending_[DIAG_LOOP_COUNT];
+  HeapSample heap_;
+  uint32_t lowFree_ = 0;
+  uint32_t lowMaxBlock_ = 0;
+  bool haveHeap_ = false;
+};
+
+// Mide desde la construcción hasta el final del bloque
+class DiagScope {
+ public:
+  DiagScope(Diagnostics& diag, DiagStage stage) : diag_(diag), stage_(stage), start_(diag.now()) {}
+  ~DiagScope() { diag_.record(stage_, start_); }
+  DiagScope(const DiagScope&) = delete;
+  DiagScope& operator=(const DiagScope&) = delete;
+
+ private:
+  Diagnostics& diag_;
+  DiagStage stage_;
+  uint32_t start_;
+};
+
+#define DIAG_CONCAT_(a, b) a##b
+#define DIAG_CONCAT(a, b) DIAG_CONCAT_(a, b)
+
+#if DIAG_ENABLED
+Diagnostics diagnostics;
+#define DIAG_SCOPE(stage) DiagScope DIAG_CONCAT(diagScope_, __LINE__)(diagnostics, stage)
+#define DIAG_LOOP(loop) diagnostics.loopTick(loop)
+#else
+#define DIAG_SCOPE(stage) do { } while (0)
+#define DIAG_LOOP(loop) do { } while (0)
+#endif
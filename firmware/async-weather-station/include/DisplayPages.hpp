@@ -0,0 +1,262 @@
+#pragma once
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Columnas de texto con la fuente de 6x8 px en 128 px de ancho
+constexpr size_t DISPLAY_TEXT_COLUMNS = 21;
+
+// =============================================================
+// === Región sucia del SSD1306 ===
+// =============================================================
+// Un tramo de columnas (en píxeles, 0..127) por cada página de 8 filas
+// (0..7): lo que se puede enviar con COLUMNADDR/PAGEADDR. Dos widgets en
+// esquinas opuestas no arrastran todo lo que queda entre ellos.
+struct DirtyRegion {
+  static constexpr int16_t WIDTH = 128;
+  static constexpr int16_t PAGES = 8;
+
+  uint8_t col0[PAGES];
+  uint8_t col1[PAGES];
+
+  DirtyRegion() { clear(); }
+
+  void clear() {
+    for (int16_t p = 0; p < PAGES; p++) {
+      col0[p] = 0xFF;
+      col1[p] = 0;
+    }
+  }
+
+  bool pageDirty(int16_t page) const { return col0[page] <= col1[page]; }
+  bool empty() const {
+    for (int16_t p = 0; p < PAGES; p++) {
+      if (pageDirty(p)) return false;
+    }
+    return true;
+  }
+
+  void add(int16_t x, int16_t y, int16_t w, int16_t h) {
+    if (w <= 0 || h <= 0) return;
+    const int16_t x0 = x < 0 ? 0 : x;
+    const int16_t x1 = x + w - 1 >= WIDTH ? WIDTH - 1 : x + w - 1;
+    const int16_t p0 = (y < 0 ? 0 : y) / 8;
+    const int16_t p1 = (y + h - 1) / 8 >= PAGES ? PAGES - 1 : (y + h - 1) / 8;
+    if (x0 > x1) return;
+    for (int16_t p = p0; p <= p1; p++) {
+      if (x0 < col0[p]) col0[p] = (uint8_t)x0;
+      if (x1 > col1[p]) col1[p] = (uint8_t)x1;
+    }
+  }
+
+  // Bytes de imagen que cubre la región (sin contar comandos ni cabeceras I2C)
+  size_t bytes() const {
+    size_t total = 0;
+    for (int16_t p = 0; p < PAGES; p++) {
+      if (pageDirty(p)) total += col1[p] - col0[p] + 1;
+    }
+    return total;
+  }
+};
+
+// =============================================================
+// === Dispositivo de salida ===
+// =============================================================
+// En el ESP32 dibuja en el framebuffer de Adafruit_SSD1306 y vuelca por I2C;
+// en el host, un framebuffer en memoria.
+class DisplayDevice {
+ public:
+  virtual ~DisplayDevice() {}
+  virtual void clearRect(int16_t x, int16_t y, int16_t w, int16_t h) = 0;
+  virtual void drawText(int16_t x, int16_t y, uint8_t size, const char* text) = 0;
+  // Envía al panel solo `region`; devuelve los bytes escritos en el bus
+  virtual size_t flush(const DirtyRegion& region) = 0;
+};
+
+struct DisplayMetrics {
+  uint32_t refreshes = 0;
+  uint32_t lastBytes = 0;   // bytes I2C del último refresco
+  uint32_t maxBytes = 0;
+  uint32_t lastUs = 0;      // duración del último refresco (dibujo + volcado)
+  uint32_t maxUs = 0;
+  uint64_t totalBytes = 0;
+};
+
+// =============================================================
+// === Pantalla por páginas con widgets de texto ===
+// =============================================================
+// Cada campo es un widget con su caja. setText() solo lo marca sucio si el
+// texto cambia, y render() redibuja y vuelca únicamente esas cajas. Las
+// coordenadas de los widgets van en celdas de texto de 6x8 px, así que
+// cada fila coincide con una página del SSD1306.
+template <size_t MaxPages, size_t MaxWidgets>
+class PagedDisplay {
+ public:
+  static constexpr int16_t CHAR_W = 6;
+  static constexpr int16_t CHAR_H = 8;
+  static constexpr size_t TEXT_LEN = DISPLAY_TEXT_COLUMNS;
+
+  explicit PagedDisplay(uint32_t (*clockUs)()) : clockUs_(clockUs) {}
+
+  int addPage(const char* title) {
+    if (pageCount_ >= MaxPages) return -1;
+    pages_[pageCount_].title = title;
+    return (int)pageCount_++;
+  }
+
+  // col/row en celdas; chars es el ancho reservado (el texto se recorta)
+  int addText(int page, uint8_t col, uint8_t row, uint8_t chars, uint8_t size = 1) {
+    if (!validPage(page) || pages_[page].count >= MaxWidgets) return -1;
+    Page& p = pages_[page];
+    Widget& w = p.widgets[p.count];
+    w.x = col * CHAR_W;
+    w.y = row * CHAR_H;
+    w.chars = chars > TEXT_LEN ? TEXT_LEN : chars;
+    w.size = size == 0 ? 1 : size;
+    w.text[0] = '\0';
+    w.dirty = true;
+    return (int)p.count++;
+  }
+
+  void setText(int page, int widget, const char* text) {
+    if (!validWidget(page, widget)) return;
+    Widget& w = pages_[page].widgets[widget];
+    char clipped[TEXT_LEN + 1];
+    strncpy(clipped, text, w.chars);
+    clipped[w.chars] = '\0';
+    if (strcmp(clipped, w.text) == 0) return;
+    memcpy(w.text, clipped, sizeof(clipped));
+    w.dirty = true;
+  }
+
+  void printf(int page, int widget, const char* format, ...) __attribute__((format(printf, 4, 5))) {
+    char text[TEXT_LEN + 1];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    setText(page, widget, text);
+  }
+
+  void show(int page) {
+    if (!validPage(page) || page == current_) return;
+    current_ = page;
+    invalidate();
+  }
+  void next() { show(pageCount_ == 0 ? 0 : (current_ + 1) % (int)pageCount_); }
+  void prev() { show(pageCount_ == 0 ? 0 : (current_ + (int)pageCount_ - 1) % (int)pageCount_); }
+
+  // Borra el panel y redibuja la página completa en el siguiente render()
+  void invalidate() {
+    clearAll_ = true;
+    if (!validPage(current_)) return;
+    Page& p = pages_[current_];
+    for (size_t i = 0; i < p.count; i++) p.widgets[i].dirty = true;
+  }
+
+  // Redibuja lo que ha cambiado en la página actual. false si no había nada.
+  bool render(DisplayDevice& device) {
+    if (!validPage(current_)) return false;
+    Page& p = pages_[current_];
+    bool pending = clearAll_;
+    for (size_t i = 0; i < p.count && !pending; i++) pending = p.widgets[i].dirty;
+    if (!pending) return false;
+
+    const uint32_t beginUs = clockUs_ ? clockUs_() : 0;
+    DirtyRegion region;
+    if (clearAll_) {
+      device.clearRect(0, 0, DirtyRegion::WIDTH, DirtyRegion::PAGES * 8);
+      region.add(0, 0, DirtyRegion::WIDTH, DirtyRegion::PAGES * 8);
+      clearAll_ = false;
+    }
+    for (size_t i = 0; i < p.count; i++) {
+      Widget& w = p.widgets[i];
+      if (!w.dirty) continue;
+      const int16_t width = w.chars * CHAR_W * w.size;
+      const int16_t height = CHAR_H * w.size;
+      device.clearRect(w.x, w.y, width, height);
+      device.drawText(w.x, w.y, w.size, w.text);
+      region.add(w.x, w.y, width, height);
+      w.dirty = false;
+    }
+    const size_t bytes = device.flush(region);
+    const uint32_t elapsed = clockUs_ ? clockUs_() - beginUs : 0;
+
+    metrics_.refreshes++;
+    metrics_.lastBytes = (uint32_t)bytes;
+    metrics_.totalBytes += bytes;
+    if (bytes > metrics_.maxBytes) metrics_.maxBytes = (uint32_t)bytes;
+    metrics_.lastUs = elapsed;
+    if (elapsed > metrics_.maxUs) metrics_.maxUs = elapsed;
+    return true;
+  }
+
+  int current() const { return current_; }
+  size_t pageCount() const { return pageCount_; }
+  const char* title(int page) const { return validPage(page) ? pages_[page].title : ""; }
+  const char* text(int page, int widget) const {
+    return validWidget(page, widget) ? pages_[page].widgets[widget].text : "";
+  }
+  const DisplayMetrics& metrics() const { return metrics_; }
+  void resetMetrics() { metrics_ = DisplayMetrics(); }
+
+ private:
+  struct Widget {
+    int16_t x = 0;
+    int16_t y = 0;
+    uint8_t chars = 0;
+    uint8_t size = 1;
+    char text[TEXT_LEN + 1] = {};
+    bool dirty = false;
+  };
+
+  struct Page {
+    const char* title = "";
+    Widget widgets[MaxWidgets];
+    size_t count = 0;
+  };
+
+  bool validPage(int page) const { return page >= 0 && (size_t)page < pageCount_; }
+  bool validWidget(int page, int widget) const {
+    return validPage(page) && widget >= 0 && (size_t)widget < pages_[page].count;
+  }
+
+  uint32_t (*clockUs_)();
+  Page pages_[MaxPages];
+  size_t pageCount_ = 0;
+  int current_ = 0;
+  bool clearAll_ = true;
+  DisplayMetrics metrics_;
+};
+
+// =============================================================
+// === Pulsador con antirrebote ===
+// =============================================================
+// update() se llama periódicamente con el nivel leído; devuelve true una
+// sola vez por pulsación, cuando el nivel "pulsado" lleva debounceMs estable.
+class DebouncedButton {
+ public:
+  explicit DebouncedButton(uint32_t debounceMs = 30) : debounceMs_(debounceMs) {}
+
+  bool update(bool pressed, uint32_t nowMs) {
+    if (pressed != raw_) {
+      raw_ = pressed;
+      changedMs_ = nowMs;
+    }
+    if (raw_ != stable_ && nowMs - changedMs_ >= debounceMs_) {
+      stable_ = raw_;
+      return stable_;
+    }
+    return false;
+  }
+
+  bool pressed() const { return stable_; }
+
+ private:
+  uint32_t debounceMs_;
+  uint32_t changedMs_ = 0;
+  bool raw_ = false;
+  bool stable_ = false;
+};
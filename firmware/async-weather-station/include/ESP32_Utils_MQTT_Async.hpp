@@ -1,6 +1,10 @@
 #pragma once
 
 #include <WiFi.h>
+#include <atomic>
+#include <lwip/dns.h>
+#include "Log.hpp"
+#include "ReconnectPolicy.hpp"
 #include "ESP32_Utils.hpp"
 #include "MQTT.hpp"
 
@@ -11,47 +15,78 @@ extern void OnMqttReceived(char* topic,
                            size_t len,
                            size_t index,
                            size_t total);
-
-unsigned long lastMqttRetry = 0;
-bool needMqttReconnect = false;
-bool wifiConnected = false;
-bool mqttConnecting = false;
+// Cola persistente de lecturas (definida en el sketch principal)
+extern void ResumeReadingQueue();
+extern void PauseReadingQueue();
+extern void OnReadingAcknowledged(uint16_t packetId);
+
+#ifndef MQTT_BACKOFF_INITIAL_MS
+#define MQTT_BACKOFF_INITIAL_MS 1000
+#endif
+#ifndef MQTT_BACKOFF_MAX_MS
+#define MQTT_BACKOFF_MAX_MS 120000
+#endif
+#ifndef MQTT_DNS_TTL_MS
+#define MQTT_DNS_TTL_MS 3600000UL
+#endif
+
+// Los escriben los eventos WiFi, los callbacks de AsyncMqttClient y el de
+// lwIP (otras tareas) y los consume HandleMqttTasks() desde la tarea de red,
+// la única que toca mqttReconnect y brokerDns
+std::atomic<bool> wifiConnected{false};
+std::atomic<bool> mqttConnectEvent{false};
+std::atomic<bool> mqttDisconnectEvent{false};
+
+enum BrokerDnsResult : uint8_t { DNS_IDLE = 0, DNS_OK, DNS_FAILED };
+std::atomic<uint8_t> brokerDnsResult{DNS_IDLE};
+std::atomic<uint32_t> brokerDnsAddress{0};
+
+ReconnectController mqttReconnect;
+DnsCache brokerDns(MQTT_DNS_TTL_MS);
 
 void DebugPrintNetwork() {
-    Serial.println("=== WiFi DEBUG ===");
-    Serial.printf("WiFi.status(): %d\n", WiFi.status());
-    Serial.printf("SSID: %s\n", WiFi.SSID().c_str());
-    Serial.printf("RSSI: %d dBm\n", WiFi.RSSI());
-    Serial.printf("Local IP: %s\n", WiFi.localIP().toString().c_str());
-    Serial.printf("Gateway: %s\n", WiFi.gatewayIP().toString().c_str());
-    Serial.printf("DNS: %s\n", WiFi.dnsIP().toString().c_str());
-    Serial.println("==================");
+    LOG_DEBUG("WiFi status %d | SSID %s | RSSI %d dBm", WiFi.status(), WiFi.SSID().c_str(), WiFi.RSSI());
+    LOG_DEBUG("IP %s | gateway %s | DNS %s", ipText(WiFi.localIP()).c_str(), ipText(WiFi.gatewayIP()).c_str(),
+              ipText(WiFi.dnsIP()).c_str());
 }
 
 // =====================
 // === MQTT connect ====
 // =====================
-void ConnectToMqtt() {
-    if (!WiFi.isConnected()) {
-        Serial.println("⚠️ MQTT skipped: no WiFi");
-        return;
+// Callback de lwIP (tarea tcpip): solo deja el resultado
+void OnBrokerResolved(const char* name, const ip_addr_t* address, void* arg) {
+    if (address) {
+        brokerDnsAddress = ip4_addr_get_u32(ip_2_ip4(address));
+        brokerDnsResult = DNS_OK;
+    } else {
+        brokerDnsResult = DNS_FAILED;
     }
+}
 
-    Serial.printf("🔌 Resolviendo broker: %s\n", mqttBroker);
-    IPAddress resolvedIP;
-    if (resolvedIP.fromString(mqttBroker)) {
-        Serial.printf("Broker es IP directa: %s\n", resolvedIP.toString().c_str());
-    } else {
-        if (WiFi.hostByName(mqttBroker, resolvedIP)) {
-            Serial.printf("DNS ok: %s -> %s\n", mqttBroker, resolvedIP.toString().c_str());
-        } else {
-            Serial.printf("❌ Error resolviendo %s\n", mqttBroker);
-            return;
-        }
+// Resolución asíncrona: nunca espera a la respuesta del DNS
+void StartBrokerResolve() {
+    IPAddress direct;
+    if (direct.fromString(mqttBroker)) {
+        brokerDnsAddress = (uint32_t)direct;
+        brokerDnsResult = DNS_OK;
+        return;
+    }
+    LOG_INFO("🔌 Resolviendo broker: %s", mqttBroker);
+    ip_addr_t address;
+    err_t err = dns_gethostbyname(mqttBroker, &address, OnBrokerResolved, nullptr);
+    if (err == ERR_OK) {
+        OnBrokerResolved(mqttBroker, &address, nullptr);
+    } else if (err != ERR_INPROGRESS) {
+        brokerDnsResult = DNS_FAILED;
     }
+}
 
-    Serial.printf("🚀 Intentando conectar a MQTT %s:%u\n", resolvedIP.toString().c_str(), mqttPort);
-    mqttConnecting = true;
+// connect() de AsyncMqttClient tampoco bloquea: el resultado llega por
+// OnMqttConnect / OnMqttDisconnect
+void ConnectToMqtt(const IPAddress& address) {
+    DebugPrintNetwork();
+    LOG_INFO("🚀 Intentando conectar a MQTT %s:%u", ipText(address).c_str(), mqttPort);
+    mqttClient.setServer(address, mqttPort);
     mqttClient.connect();
 }
 
@@ -59,18 +94,15 @@ void ConnectToMqtt() {
 // === WiFi events =====
 // =====================
 void WiFiEvent(WiFiEvent_t event) {
-    Serial.printf("[WiFi-event] event: %d\n", event);
+    LOG_DEBUG("[WiFi-event] event: %d", event);
     switch (event) {
         case ARDUINO_EVENT_WIFI_STA_GOT_IP:
-            Serial.println("✅ WiFi connected");
-            Serial.print("IP address: ");
-            Serial.println(WiFi.localIP());
-            wifiConnected = true;
-            needMqttReconnect = true;  // programa conexión
+            LOG_INFO("✅ WiFi connected, IP address: %s", ipText(WiFi.localIP()).c_str());
+            wifiConnected = true;  // HandleMqttTasks() programa la conexión
             break;
 
         case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
-            Serial.println("⚠️ WiFi lost connection");
+            LOG_WARN("⚠️ WiFi lost connection");
             wifiConnected = false;
             mqttClient.disconnect();
             break;
@@ -84,52 +116,51 @@ void WiFiEvent(WiFiEvent_t event) {
 // === MQTT callbacks ===
 // =====================
 void OnMqttConnect(bool sessionPresent) {
-    mqttConnecting = false;
-    Serial.println("✅ Conectado al broker MQTT");
-    Serial.print("Session present: ");
-    Serial.println(sessionPresent);
+    mqttConnectEvent = true;
+    LOG_INFO("✅ Conectado al broker MQTT (session present: %d)", sessionPresent);
 
     SuscribeMqtt();
+    ResumeReadingQueue();
 
     const char* payload = "Estación MQTT conectada correctamente";
-    bool success = mqttClient.publish(MQTT_TOPIC, 1, false, payload);
-    if (success)
-        Serial.println("📡 Payload publicado correctamente");
-    else
-        Serial.println("[WARN] No se pudo publicar el payload MQTT.");
+    const uint16_t packetId = mqttClient.publish(MQTT_TOPIC, 1, false, payload);
+    if (packetId != 0) {
+        mqttInflight.fetch_add(1, std::memory_order_relaxed);  // QoS1 fijo, no mqttQos
+        LOG_INFO("📡 Payload publicado correctamente");
+    } else {
+        LOG_WARN("No se pudo publicar el payload MQTT.");
+    }
 }
 
 void OnMqttDisconnect(AsyncMqttClientDisconnectReason reason) {
-    mqttConnecting = false;
-    Serial.printf("❌ Disconnected from MQTT. Reason: %d\n", (int)reason);
-
+    mqttDisconnectEvent = true;
+    mqttInflight = 0;
+    PauseReadingQueue();
+    const char* reasonName = "";
     switch (reason) {
-        case AsyncMqttClientDisconnectReason::TCP_DISCONNECTED: Serial.println("TCP_DISCONNECTED"); break;
-        case AsyncMqttClientDisconnectReason::MQTT_UNACCEPTABLE_PROTOCOL_VERSION: Serial.println("MQTT_UNACCEPTABLE_PROTOCOL_VERSION"); break;
-        case AsyncMqttClientDisconnectReason::MQTT_IDENTIFIER_REJECTED: Serial.println("MQTT_IDENTIFIER_REJECTED"); break;
-        case AsyncMqttClientDisconnectReason::MQTT_SERVER_UNAVAILABLE: Serial.println("MQTT_SERVER_UNAVAILABLE"); break;
-        case AsyncMqttClientDisconnectReason::MQTT_MALFORMED_CREDENTIALS: Serial.println("MQTT_MALFORMED_CREDENTIALS"); break;
-        case AsyncMqttClientDisconnectReason::MQTT_NOT_AUTHORIZED: Serial.println("MQTT_NOT_AUTHORIZED"); break;
+        case AsyncMqttClientDisconnectReason::TCP_DISCONNECTED: reasonName = "TCP_DISCONNECTED"; break;
+        case AsyncMqttClientDisconnectReason::MQTT_UNACCEPTABLE_PROTOCOL_VERSION: reasonName = "MQTT_UNACCEPTABLE_PROTOCOL_VERSION"; break;
+        case AsyncMqttClientDisconnectReason::MQTT_IDENTIFIER_REJECTED: reasonName = "MQTT_IDENTIFIER_REJECTED"; break;
+        case AsyncMqttClientDisconnectReason::MQTT_SERVER_UNAVAILABLE: reasonName = "MQTT_SERVER_UNAVAILABLE"; break;
+        case AsyncMqttClientDisconnectReason::MQTT_MALFORMED_CREDENTIALS: reasonName = "MQTT_MALFORMED_CREDENTIALS"; break;
+        case AsyncMqttClientDisconnectReason::MQTT_NOT_AUTHORIZED: reasonName = "MQTT_NOT_AUTHORIZED"; break;
         default: break;
     }
-
-    if (wifiConnected) {
-        Serial.println("Reintentando conexión MQTT en 3 segundos...");
-        needMqttReconnect = true;
-        lastMqttRetry = millis();
-    }
+    LOG_WARN("❌ Disconnected from MQTT. Reason: %d %s", (int)reason, reasonName);
 }
 
 void OnMqttSubscribe(uint16_t packetId, uint8_t qos) {
-    Serial.printf("Subscribe acknowledged. packetId: %d, qos: %d\n", packetId, qos);
+    LOG_DEBUG("Subscribe acknowledged. packetId: %d, qos: %d", packetId, qos);
 }
 
 void OnMqttUnsubscribe(uint16_t packetId) {
-    Serial.printf("Unsubscribe acknowledged. packetId: %d\n", packetId);
+    LOG_DEBUG("Unsubscribe acknowledged. packetId: %d", packetId);
 }
 
 void OnMqttPublish(uint16_t packetId) {
-    Serial.printf("Publish acknowledged. packetId: %d\n", packetId);
+    LOG_DEBUG("Publish acknowledged. packetId: %d", packetId);
+    CountMqttAck();
+    OnReadingAcknowledged(packetId);
 }
 
 // =====================
@@ -147,22 +178,67 @@ void InitMqtt() {
     mqttClient.setClientId(mqttClientId);
     mqttClient.setCredentials(mqttUser, mqttPassword);
 
-    Serial.println("MQTT client initialized.");
+    // Semilla del jitter: el client id si lo hay, si no la MAC. Cada estación
+    // reparte sus reintentos de forma distinta pero reproducible.
+    ReconnectConfig config;
+    config.backoff.initialMs = MQTT_BACKOFF_INITIAL_MS;
+    config.backoff.maxMs = MQTT_BACKOFF_MAX_MS;
+    mqttReconnect.configure(config);
+    String identity = strlen(mqttClientId) > 0 ? String(mqttClientId) : WiFi.macAddress();
+    mqttReconnect.seed(ReconnectBackoff::hashSeed((const uint8_t*)identity.c_str(), identity.length()));
+
+    LOG_INFO("MQTT client initialized.");
 }
 
 // ============================
-// === Handler desde loop() ===
+// === Handler desde la tarea de red ===
 // ============================
+// Traslada los eventos al controlador y ejecuta lo que pida; ninguna de las
+// acciones espera a la red.
 void HandleMqttTasks() {
-    if (!wifiConnected) return;
-
-    // cada 5 segundos, intenta conectar si hace falta
-    if (needMqttReconnect && !mqttClient.connected() && !mqttConnecting) {
-        if (millis() - lastMqttRetry > 5000) {
-            lastMqttRetry = millis();
-            Serial.println("🔁 Reintentando conexión MQTT...");
-            DebugPrintNetwork();
-            ConnectToMqtt();
+    const uint32_t now = millis();
+    if (wifiConnected) {
+        mqttReconnect.onLinkUp(now);
+    } else {
+        mqttReconnect.onLinkDown();
+    }
+
+    if (mqttConnectEvent.exchange(false)) mqttReconnect.onConnected(now);
+    if (mqttDisconnectEvent.exchange(false)) {
+        // Si falla el intento, la dirección puede haber cambiado
+        if (mqttReconnect.state() == ReconnectController::State::CONNECTING) brokerDns.invalidate();
+        const bool wasActive = mqttReconnect.state() != ReconnectController::State::WAITING &&
+                               mqttReconnect.state() != ReconnectController::State::OFFLINE;
+        mqttReconnect.onDisconnected(now);
+        if (wasActive) {
+            LOG_INFO("🔁 Reintento MQTT en %lu ms", (unsigned long)mqttReconnect.metrics().lastDelayMs);
         }
     }
-}
\ No newline at end of file
+
+    const uint8_t dnsResult = brokerDnsResult.exchange(DNS_IDLE);
+    if (dnsResult == DNS_OK) {
+        brokerDns.store(brokerDnsAddress, now);
+        mqttReconnect.onResolved(true, now);
+    } else if (dnsResult == DNS_FAILED) {
+        LOG_ERROR("❌ Error resolviendo %s", mqttBroker);
+        mqttReconnect.onResolved(false, now);
+    }
+
+    uint32_t address = 0;
+    const bool haveAddress = brokerDns.lookup(now, address);
+    switch (mqttReconnect.poll(now, haveAddress)) {
+        case ReconnectController::Action::RESOLVE:
+            StartBrokerResolve();
+            break;
+        case ReconnectController::Action::CONNECT:
+            ConnectToMqtt(IPAddress(address));
+            break;
+        case ReconnectController::Action::ABORT:
+            LOG_WARN("⚠️ MQTT sin respuesta, se aborta el intento");
+            brokerDns.invalidate();
+            mqttClient.disconnect(true);
+            break;
+        default:
+            break;
+    }
+}
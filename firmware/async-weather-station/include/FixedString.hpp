@@ -0,0 +1,81 @@
+#pragma once
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+// =============================================================
+// === Cadena de capacidad fija ===
+// =============================================================
+// Sustituye a String en los caminos que se repiten durante meses (reloj de
+// la pantalla, IP, timestamps, mensajes recibidos): vive en la pila o en un
+// global, nunca en el heap. Lo que no cabe se corta y queda marcado en
+// truncated(); la cadena sigue terminada en '\0'.
+template <size_t N>
+class FixedString {
+ public:
+  FixedString() { data_[0] = '\0'; }
+  FixedString(const char* s) {
+    data_[0] = '\0';
+    append(s);
+  }
+
+  static constexpr size_t capacity() { return N; }
+  const char* c_str() const { return data_; }
+  size_t length() const { return length_; }
+  bool empty() const { return length_ == 0; }
+  bool truncated() const { return truncated_; }
+
+  void clear() {
+    length_ = 0;
+    truncated_ = false;
+    data_[0] = '\0';
+  }
+
+  FixedString& assign(const char* s) {
+    clear();
+    return append(s);
+  }
+
+  FixedString& append(const char* s, size_t len) {
+    if (!s) return *this;
+    const size_t room = N - length_;
+    if (len > room) {
+      len = room;
+      truncated_ = true;
+    }
+    memcpy(data_ + length_, s, len);
+    length_ += len;
+    data_[length_] = '\0';
+    return *this;
+  }
+
+  FixedString& append(const char* s) { return s ? append(s, strlen(s)) : *this; }
+
+  FixedString& append(char c) { return append(&c, 1); }
+
+  FixedString& appendf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    va_list args;
+    va_start(args, format);
+    const int n = vsnprintf(data_ + length_, N - length_ + 1, format, args);
+    va_end(args);
+    if (n < 0) {
+      data_[length_] = '\0';
+      return *this;
+    }
+    if ((size_t)n > N - length_) {
+      length_ = N;
+      truncated_ = true;
+    } else {
+      length_ += (size_t)n;
+    }
+    return *this;
+  }
+
+  bool operator==(const char* s) const { return s && strcmp(data_, s) == 0; }
+
+ private:
+  char data_[N + 1];
+  size_t length_ = 0;
+  bool truncated_ = false;
+};
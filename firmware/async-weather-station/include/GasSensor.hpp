@@ -0,0 +1,252 @@
+#pragma once
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SensorData.hpp"
+
+// =============================================================
+// === MQ-2: filtrado, calibración de R0 y ppm ===
+// =============================================================
+// Código puro (sin Arduino) para poder probarlo en el host contra trazas
+// grabadas (sim/gas_replay). La adquisición es del ADC en modo continuo:
+// cada trama llega ya promediada por el driver (sobremuestreo por DMA, sin
+// lecturas sueltas desde la CPU). Aquí se pasa por una mediana de N tramas,
+// que quita los picos aislados (la radio WiFi se cuela en el ADC), y por un
+// IIR de primer orden con constante de tiempo en ms, independiente de
+// cuántas tramas se pierdan entre dos lecturas.
+//
+// Circuito (Fichas técnicas/MQ-2.PDF, Fig2): Rs en serie con RL sobre Vc, y
+// el pin mide VRL (a través del divisor del módulo, si lo hay):
+//   Rs = RL · (Vc − VRL) / VRL
+// Fig3 da Rs/R0 frente a la concentración en log-log, con R0 = Rs en aire
+// limpio (la línea "Air" está en 1). Ajuste por mínimos cuadrados de la
+// curva de C3H8, el gas de referencia de la ficha (200..10000 ppm):
+//   ppm = 17.71 · (Rs/R0)^−1.629
+// Otras curvas de la misma figura: CH4 20.03/−2.023, humo 23.44/−1.687,
+// alcohol 35.92/−2.068.
+
+// Mediana de las últimas N muestras seguida de un IIR de primer orden
+template <size_t N>
+class MedianIirFilter {
+  static_assert(N % 2 == 1 && N <= 15, "La mediana necesita una ventana impar y corta");
+
+ public:
+  void setTimeConstant(uint32_t tauMs) { tauMs_ = tauMs; }
+
+  void reset() {
+    count_ = 0;
+    head_ = 0;
+    value_ = NAN;
+  }
+
+  // dtMs = tiempo desde la muestra anterior. NaN no entra en la ventana.
+  float add(float sample, uint32_t dtMs) {
+    if (isnan(sample)) return value_;
+    window_[head_] = sample;
+    head_ = (head_ + 1) % N;
+    if (count_ < N) count_++;
+
+    float sorted[N];
+    for (size_t i = 0; i < count_; i++) {
+      const float v = window_[i];
+      size_t j = i;
+      for (; j > 0 && sorted[j - 1] > v; j--) sorted[j] = sorted[j - 1];
+      sorted[j] = v;
+    }
+    const float median = sorted[count_ / 2];
+
+    if (isnan(value_) || tauMs_ == 0) {
+      value_ = median;
+    } else {
+      value_ += (median - value_) * (float)dtMs / (float)(tauMs_ + dtMs);
+    }
+    return value_;
+  }
+
+  float value() const { return value_; }
+
+ private:
+  float window_[N] = {};
+  size_t count_ = 0;
+  size_t head_ = 0;
+  uint32_t tauMs_ = 0;
+  float value_ = NAN;
+};
+
+struct Mq2Config {
+  float supplyMv = 5000.0f;            // Vc del módulo
+  float loadKohm = 1.0f;               // RL del módulo
+  float pinScale = 1.0f;               // VRL / tensión en el pin (divisor AO -> GPIO)
+  uint32_t warmupMs = 180000;          // calentamiento del filamento tras el arranque
+  uint32_t calibrationMs = 600000;     // media de Rs en aire limpio para fijar R0
+  uint32_t filterTauMs = 2000;
+  uint32_t baselineTauMs = 6UL * 3600000UL;  // R0 sigue despacio la deriva hacia arriba
+  float curveA = 17.71f;               // ppm = curveA · (Rs/R0)^curveB
+  float curveB = -1.629f;
+  float maxPpm = 10000.0f;             // fondo de escala de la ficha
+  // ppm a partir de los que se pasa a NORMAL, MALA y PELIGROSA; para bajar
+  // hay que quedar por debajo del umbral en la fracción `hysteresis`
+  float qualityPpm[3] = {150.0f, 300.0f, 1000.0f};
+  float hysteresis = 0.10f;
+  float saveDrift = 0.02f;             // cambio relativo de R0 que merece ir a NVS
+};
+
+class Mq2Sensor {
+ public:
+  static constexpr size_t MEDIAN_FRAMES = 5;
+
+  enum class State : uint8_t { WARMUP, CALIBRATING, READY };
+
+  void configure(const Mq2Config& config) {
+    config_ = config;
+    mv_.setTimeConstant(config.filterTauMs);
+    raw_.setTimeConstant(config.filterTauMs);
+  }
+  const Mq2Config& config() const { return config_; }
+
+  // storedR0Kohm: R0 guardado de un arranque anterior (NAN o <= 0 = sin calibrar)
+  void begin(uint32_t nowMs, float storedR0Kohm) {
+    mv_.reset();
+    raw_.reset();
+    startMs_ = nowMs;
+    hasFrame_ = false;
+    state_ = State::WARMUP;
+    r0_ = storedR0Kohm > 0.0f ? storedR0Kohm : NAN;
+    savedR0_ = r0_;
+    pendingSave_ = false;
+    rs_ = ppm_ = NAN;
+    quality_ = AirQuality::UNKNOWN;
+  }
+
+  // Vuelve a medir R0: el sensor debe estar en aire limpio durante
+  // calibrationMs. Cuenta desde la última trama, con el reloj de addFrame().
+  void recalibrate() {
+    r0_ = NAN;
+    ppm_ = NAN;
+    quality_ = AirQuality::UNKNOWN;
+    if (state_ != State::WARMUP) startCalibration(lastMs_);
+  }
+
+  // Una trama del ADC: media en mV en el pin y en cuentas
+  void addFrame(uint32_t nowMs, float pinMv, float raw) {
+    const uint32_t dt = hasFrame_ ? nowMs - lastMs_ : 0;
+    hasFrame_ = true;
+    lastMs_ = nowMs;
+    frames_++;
+    const float mv = mv_.add(pinMv, dt);
+    raw_.add(raw, dt);
+    rs_ = rsFromMv(mv);
+
+    if (state_ == State::WARMUP && nowMs - startMs_ >= config_.warmupMs) {
+      if (isnan(r0_)) {
+        startCalibration(nowMs);
+      } else {
+        state_ = State::READY;
+      }
+    }
+    if (state_ == State::CALIBRATING) {
+      if (!isnan(rs_) && !isinf(rs_)) {
+        calibrationSum_ += rs_;
+        calibrationCount_++;
+      }
+      if (nowMs - calibrationStartMs_ >= config_.calibrationMs && calibrationCount_ > 0) {
+        r0_ = (float)(calibrationSum_ / calibrationCount_);
+        state_ = State::READY;
+        pendingSave_ = true;
+      }
+    }
+    if (state_ != State::READY) return;
+
+    // El gas solo baja Rs: un Rs por encima de R0 es deriva del aire limpio
+    if (rs_ > r0_ && !isinf(rs_)) {
+      r0_ += (rs_ - r0_) * (float)dt / (float)(config_.baselineTauMs + dt);
+      if (!(fabsf(r0_ - savedR0_) <= config_.saveDrift * savedR0_)) pendingSave_ = true;
+    }
+    ppm_ = ppmFromRatio(rs_ / r0_);
+    quality_ = classify(ppm_, quality_);
+  }
+
+  // R0 nuevo que conviene guardar (tras calibrar o si ha derivado)
+  bool takeR0ToSave(float& r0Kohm) {
+    if (!pendingSave_) return false;
+    pendingSave_ = false;
+    savedR0_ = r0_;
+    r0Kohm = r0_;
+    return true;
+  }
+
+  float rsFromMv(float pinMv) const {
+    if (isnan(pinMv)) return NAN;
+    const float vrl = pinMv * config_.pinScale;
+    if (vrl <= 0.0f) return INFINITY;  // sin señal: resistencia "infinita", 0 ppm
+    if (vrl >= config_.supplyMv) return 0.0f;
+    return config_.loadKohm * (config_.supplyMv - vrl) / vrl;
+  }
+
+  float ppmFromRatio(float ratio) const {
+    if (isnan(ratio)) return NAN;
+    if (isinf(ratio)) return 0.0f;
+    if (ratio <= 0.0f) return config_.maxPpm;
+    const float ppm = config_.curveA * powf(ratio, config_.curveB);
+    return ppm > config_.maxPpm ? config_.maxPpm : ppm;
+  }
+
+  // Sube de nivel al alcanzar el umbral; baja solo por debajo de umbral·(1 − h)
+  AirQuality classify(float ppm, AirQuality current) const {
+    if (isnan(ppm)) return AirQuality::UNKNOWN;
+    uint8_t level = 0;
+    while (level < 3 && ppm >= config_.qualityPpm[level]) level++;
+    if (current == AirQuality::UNKNOWN || level >= (uint8_t)current) return (AirQuality)level;
+    uint8_t kept = (uint8_t)current;
+    while (kept > level && ppm < config_.qualityPpm[kept - 1] * (1.0f - config_.hysteresis)) kept--;
+    return (AirQuality)kept;
+  }
+
+  State state() const { return state_; }
+  static const char* stateName(State s) {
+    return s == State::WARMUP ? "warmup" : s == State::CALIBRATING ? "calibrating" : "ready";
+  }
+  // Tiempo que le queda a la fase actual (0 en READY)
+  uint32_t remainingMs(uint32_t nowMs) const {
+    if (state_ == State::WARMUP) return elapsedLeft(nowMs - startMs_, config_.warmupMs);
+    if (state_ == State::CALIBRATING) return elapsedLeft(nowMs - calibrationStartMs_, config_.calibrationMs);
+    return 0;
+  }
+
+  float filteredMv() const { return mv_.value(); }
+  int filteredRaw() const { return isnan(raw_.value()) ? 0 : (int)lroundf(raw_.value()); }
+  float rsKohm() const { return rs_; }
+  float r0Kohm() const { return r0_; }
+  float ppm() const { return ppm_; }
+  AirQuality quality() const { return quality_; }
+  uint32_t frames() const { return frames_; }
+
+ private:
+  void startCalibration(uint32_t nowMs) {
+    state_ = State::CALIBRATING;
+    calibrationStartMs_ = nowMs;
+    calibrationSum_ = 0.0;
+    calibrationCount_ = 0;
+  }
+
+  static uint32_t elapsedLeft(uint32_t elapsed, uint32_t total) { return elapsed >= total ? 0 : total - elapsed; }
+
+  Mq2Config config_;
+  MedianIirFilter<MEDIAN_FRAMES> mv_;
+  MedianIirFilter<MEDIAN_FRAMES> raw_;
+  State state_ = State::WARMUP;
+  uint32_t startMs_ = 0;
+  uint32_t lastMs_ = 0;
+  bool hasFrame_ = false;
+  uint32_t frames_ = 0;
+  uint32_t calibrationStartMs_ = 0;
+  double calibrationSum_ = 0.0;
+  uint32_t calibrationCount_ = 0;
+  float rs_ = NAN;
+  float r0_ = NAN;
+  float savedR0_ = NAN;
+  bool pendingSave_ = false;
+  float ppm_ = NAN;
+  AirQuality quality_ = AirQuality::UNKNOWN;
+};
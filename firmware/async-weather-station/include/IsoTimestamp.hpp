@@ -0,0 +1,169 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+// =============================================================
+// === Formateo ISO-8601 con prefijo cacheado ===
+// =============================================================
+// La fecha ("2025-01-01T") y el desfase ("+01:00" o "Z") solo cambian a
+// medianoche o en un cambio de horario. El formateador guarda el intervalo
+// [start, end) en el que ambos son constantes y, dentro de él, la hora se
+// obtiene con aritmética entera: sin localtime_r, strftime ni memoria
+// dinámica. Fuera del intervalo se recalcula con localtime_r (zona de TZ)
+// o en UTC.
+//
+// Salidas: 2025-01-01T00:00:00+01:00, 2025-01-01T00:00:00.123+01:00,
+// 2025-01-01T00:00:00Z, 2025-01-01T00:00:00.123Z
+class IsoTimestampFormatter {
+ public:
+  static constexpr size_t MAX_LEN = 29;  // con milisegundos y desfase, sin '\0'
+
+  explicit IsoTimestampFormatter(bool utc = false) : utc_(utc) {}
+
+  // Obligatorio tras cambiar TZ
+  void invalidate() { valid_ = false; }
+
+  // Devuelve la longitud escrita, o 0 si no cabe. epochMs <= 0 (hora no
+  // sincronizada) se escribe como el instante 0 en UTC.
+  size_t format(int64_t epochMs, char* out, size_t capacity, bool withMillis = false) {
+    if (epochMs <= 0) {
+      const char* epoch = withMillis ? "1970-01-01T00:00:00.000Z" : "1970-01-01T00:00:00Z";
+      const size_t len = strlen(epoch);
+      if (capacity < len + 1) return 0;
+      memcpy(out, epoch, len + 1);
+      return len;
+    }
+
+    const int64_t seconds = epochMs / 1000;
+    if (!valid_ || seconds < startS_ || seconds >= endS_) refresh(seconds);
+
+    const size_t len = PREFIX_LEN + 8 + (withMillis ? 4 : 0) + offsetLen_;
+    if (capacity < len + 1) return 0;
+
+    memcpy(out, prefix_, PREFIX_LEN);
+    char* p = out + PREFIX_LEN;
+    const uint32_t secOfDay = startSecOfDay_ + (uint32_t)(seconds - startS_);
+    p = two(p, secOfDay / 3600);
+    *p++ = ':';
+    p = two(p, secOfDay / 60 % 60);
+    *p++ = ':';
+    p = two(p, secOfDay % 60);
+    if (withMillis) {
+      const uint32_t ms = (uint32_t)(epochMs % 1000);
+      *p++ = '.';
+      *p++ = (char)('0' + ms / 100);
+      p = two(p, ms % 100);
+    }
+    memcpy(p, offset_, offsetLen_ + 1);
+    return len;
+  }
+
+  uint32_t refreshes() const { return refreshes_; }
+
+  // Días desde 1970-01-01 de una fecha civil (algoritmo de H. Hinnant)
+  static int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+  }
+
+ private:
+  static constexpr size_t PREFIX_LEN = 11;  // "YYYY-MM-DDT"
+
+  static char* two(char* p, uint32_t value) {
+    *p++ = (char)('0' + value / 10);
+    *p++ = (char)('0' + value % 10);
+    return p;
+  }
+
+  // Desfase respecto a UTC en `seconds`, y su hora civil en `tm`
+  int32_t civil(int64_t seconds, struct tm& tm) const {
+    const time_t t = (time_t)seconds;
+    if (utc_) {
+      gmtime_r(&t, &tm);
+      return 0;
+    }
+    localtime_r(&t, &tm);
+    // tm_gmtoff no existe en newlib: el desfase sale de la propia hora civil
+    const int64_t asUtc = daysFromCivil(tm.tm_year + 1900, (unsigned)tm.tm_mon + 1, (unsigned)tm.tm_mday) * 86400 +
+                          tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+    return (int32_t)(asUtc - seconds);
+  }
+
+  int32_t offsetAt(int64_t seconds) const {
+    struct tm tm;
+    return civil(seconds, tm);
+  }
+
+  // Primer segundo de (lo, hi] con un desfase distinto al de lo
+  int64_t findTransition(int64_t lo, int64_t hi, int32_t offsetLo) const {
+    while (hi - lo > 1) {
+      const int64_t mid = lo + (hi - lo) / 2;
+      if (offsetAt(mid) == offsetLo) {
+        lo = mid;
+      } else {
+        hi = mid;
+      }
+    }
+    return hi;
+  }
+
+  void refresh(int64_t seconds) {
+    refreshes_++;
+    struct tm tm;
+    const int32_t offset = civil(seconds, tm);
+    const uint32_t secOfDay = (uint32_t)(tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec);
+
+    // Medianoches locales calculadas con el desfase actual; si el desfase
+    // cambia antes de llegar a ellas, el límite es el propio cambio
+    int64_t start = seconds - secOfDay;
+    int64_t end = start + 86400;
+    if (!utc_) {
+      if (offsetAt(start) != offset) start = findTransition(start, seconds, offsetAt(start));
+      if (offsetAt(end - 1) != offset) end = findTransition(seconds, end - 1, offset);
+    }
+    startS_ = start;
+    endS_ = end;
+    startSecOfDay_ = secOfDay - (uint32_t)(seconds - start);
+
+    const int year = tm.tm_year + 1900;
+    prefix_[0] = (char)('0' + year / 1000 % 10);
+    prefix_[1] = (char)('0' + year / 100 % 10);
+    prefix_[2] = (char)('0' + year / 10 % 10);
+    prefix_[3] = (char)('0' + year % 10);
+    prefix_[4] = '-';
+    two(prefix_ + 5, (uint32_t)tm.tm_mon + 1);
+    prefix_[7] = '-';
+    two(prefix_ + 8, (uint32_t)tm.tm_mday);
+    prefix_[10] = 'T';
+
+    if (utc_) {
+      memcpy(offset_, "Z", 2);
+      offsetLen_ = 1;
+    } else {
+      const uint32_t absolute = (uint32_t)(offset < 0 ? -offset : offset) / 60;
+      offset_[0] = offset < 0 ? '-' : '+';
+      two(offset_ + 1, absolute / 60);
+      offset_[3] = ':';
+      two(offset_ + 4, absolute % 60);
+      offset_[6] = '\0';
+      offsetLen_ = 6;
+    }
+    valid_ = true;
+  }
+
+  bool utc_;
+  bool valid_ = false;
+  int64_t startS_ = 0;
+  int64_t endS_ = 0;
+  uint32_t startSecOfDay_ = 0;
+  char prefix_[PREFIX_LEN] = {};
+  char offset_[7] = {};
+  size_t offsetLen_ = 0;
+  uint32_t refreshes_ = 0;
+};
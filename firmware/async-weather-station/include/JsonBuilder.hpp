@@ -1,44 +1,49 @@
 #pragma once
-#include <ArduinoJson.h>
 #include <WiFi.h>
-#include <time.h>
+#include <stdio.h>
+#include <string.h>
+#include "PayloadSchema.hpp"
+#include "TimeUtils.hpp"
 
-// === CONFIGURACIÓN NTP PARA ZONA HORARIA DE MADRID ===
-#define NTP_SERVER "pool.ntp.org"
-#define TZ_INFO "CET-1CEST,M3.5.0/2,M10.5.0/3" // España/Madrid
+// =============================================================
+// === Constructores JSON con String (compatibilidad) ===
+// =============================================================
+// Se mantienen para otros proyectos que los llaman con la identidad como
+// argumentos. El sketch escribe con PayloadWriter/PayloadSchema sobre buffers
+// fijos; aquí se usa la misma tabla de campos y solo se copia a un String.
 
-// === Inicializa la sincronización NTP ===
-void initTime() {
-  configTime(0, 0, NTP_SERVER);
-  setenv("TZ", TZ_INFO, 1);
-  tzset();
-
-  Serial.println("⏰ Sincronizando hora NTP...");
-  struct tm timeinfo;
-  while (!getLocalTime(&timeinfo)) {
-    Serial.print(".");
-    delay(500);
-  }
-  Serial.println("\n✅ Hora sincronizada correctamente (zona Madrid).");
+// Copia truncando a la capacidad de StationInfo
+template <size_t N>
+void copyStationField(char (&dest)[N], const char* value) {
+  strncpy(dest, value ? value : "", N - 1);
+  dest[N - 1] = '\0';
 }
 
-// === Devuelve timestamp en formato ISO8601 ===
-String getTimestampISO8601() {
-  struct tm timeinfo;
-  if (!getLocalTime(&timeinfo)) {
-    return "1970-01-01T00:00:00Z";
-  }
+// Coordenada con 7 decimales (~1 cm) y sin ceros finales
+template <size_t N>
+void formatCoordinate(char (&dest)[N], double value) {
+  size_t len = (size_t)snprintf(dest, N, "%.7f", value);
+  if (len >= N) len = N - 1;
+  while (len > 0 && dest[len - 1] == '0') dest[--len] = '\0';
+  if (len > 0 && dest[len - 1] == '.') dest[--len] = '\0';
+}
 
-  char buffer[30];
-  strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S%z", &timeinfo);
-  String ts(buffer);
-  if (ts.length() > 22) ts = ts.substring(0, 22) + ":" + ts.substring(22);
-  return ts;
+StationInfo stationInfoFor(const char* sensor_id, const char* sensor_type, const char* street_id, double latitude,
+                           double longitude, const char* district, const char* neighborhood) {
+  StationInfo station;
+  copyStationField(station.sensorId, sensor_id);
+  copyStationField(station.sensorType, sensor_type);
+  copyStationField(station.streetId, street_id);
+  formatCoordinate(station.latitude, latitude);
+  formatCoordinate(station.longitude, longitude);
+  copyStationField(station.district, district);
+  copyStationField(station.neighborhood, neighborhood);
+  return station;
 }
 
 /**
  * @brief Construye un JSON con toda la información de la estación
- * en un único mensaje con la estructura solicitada.
+ * en un único mensaje con la estructura de json/json-general.
  */
 String buildWeatherStationJson(
   const char* sensor_id,
@@ -55,33 +60,20 @@ String buildWeatherStationJson(
   double atmospheric_pressure_hpa,
   double air_quality_index
 ) {
-  StaticJsonDocument<768> doc;
-
-  doc["sensor_id"] = sensor_id;
-  doc["sensor_type"] = "weather";
-  doc["street_id"] = street_id;
-  doc["timestamp"] = getTimestampISO8601();
+  const StationInfo station =
+      stationInfoFor(sensor_id, "weather", street_id, latitude, longitude, district, neighborhood);
+  SensorData data;
+  data.altitudeMeters = (float)altitude;
+  data.temperatureC = (float)temperature_celsius;
+  data.humidityPercent = (float)humidity_percentage;
+  data.windSpeedKmh = (float)wind_speed_kmh;
+  data.lightLux = (float)light_lux;
+  data.pressureHpa = (float)atmospheric_pressure_hpa;
+  data.gasRaw = (int)lround(air_quality_index);
 
-  JsonObject loc = doc.createNestedObject("location");
-  loc["latitude"] = latitude;
-  loc["longitude"] = longitude;
-  loc["altitude_meters"] = altitude;
-  loc["district"] = district;
-  loc["neighborhood"] = neighborhood;
-
-  JsonObject data = doc.createNestedObject("data");
-  data["temperature_celsius"] = temperature_celsius;
-  data["humidity_percentage"] = humidity_percentage;
-  data["wind_speed"] = wind_speed_kmh;
-  data["luz"] = light_lux;
-  data["atmospheric_pressure_hpa"] = atmospheric_pressure_hpa;
-  data["air_quality_index"] = air_quality_index;
-
-  String json;
-  serializeJson(doc, json);
-  Serial.println(F("[DEBUG] JSON generado:"));
-  Serial.println(json);
-  return json;
+  char payload[SchemaPayload<SCHEMA_GENERAL>::BUFFER_LEN];
+  const size_t len = SchemaPayload<SCHEMA_GENERAL>::write(station, data, getTimestampISO8601().c_str(), payload);
+  return String(len > 0 ? payload : "");
 }
 
 // Función legacy mantenida por compatibilidad con otros proyectos.
@@ -97,26 +89,18 @@ String buildSensorJsonFor(
   const char* district = "Centro",
   const char* neighborhood = "Universidad"
 ) {
-  StaticJsonDocument<512> doc;
-
-  doc["sensor_id"] = sensor_id;
-  doc["sensor_type"] = sensor_type;
-  doc["street_id"] = street_id;
-  doc["timestamp"] = getTimestampISO8601();
+  const StationInfo station =
+      stationInfoFor(sensor_id, sensor_type, street_id, latitude, longitude, district, neighborhood);
 
-  JsonObject loc = doc.createNestedObject("location");
-  loc["latitude"] = latitude;
-  loc["longitude"] = longitude;
-  loc["altitude_meters"] = altitude;
-  loc["district"] = district;
-  loc["neighborhood"] = neighborhood;
-
-  JsonObject data = doc.createNestedObject("data");
-  data[data_key] = data_value;
+  // Decimales de la tabla si la clave es una de las conocidas
+  uint8_t decimals = 2;
+  for (uint8_t i = 0; i < PAYLOAD_FIELD_COUNT; i++) {
+    if (strcmp(PAYLOAD_FIELDS[i].key, data_key) == 0) decimals = PAYLOAD_FIELDS[i].decimals;
+  }
 
-  String json;
-  serializeJson(doc, json);
-  Serial.println(F("[DEBUG] JSON generado:"));
-  Serial.println(json);
-  return json;
+  char payload[PAYLOAD_HEADER_MAX_LEN + 64 + JsonWriter::MAX_NUMBER_LEN];
+  JsonWriter json(payload, sizeof(payload));
+  writePayloadHeader(json, station, station.sensorType, (float)altitude, getTimestampISO8601().c_str());
+  json.string(data_key).literal(":").number(data_value, decimals).literal("}}");
+  return String(json.overflow() ? "" : payload);
 }
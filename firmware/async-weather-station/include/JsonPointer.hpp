@@ -0,0 +1,354 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// =============================================================
+// === Tokenizador JSON en sitio con búsqueda por JSON Pointer ===
+// =============================================================
+// Recorre el texto una sola vez y deja un array fijo de tokens con
+// posiciones dentro del propio buffer: no copia ni reserva memoria. Las
+// cadenas se des-escapan en sitio y quedan terminadas en '\0' (el texto
+// siempre encoge), así que string() devuelve un puntero al buffer original.
+// find("/args/temperature/abs") localiza un valor según RFC 6901.
+//
+// Estricto: una entrada mal formada, demasiado anidada o con más tokens de
+// los previstos se rechaza entera, nunca se lee fuera de [text, text + len).
+enum class JsonTokenType : uint8_t { OBJECT = 0, ARRAY, STRING, NUMBER, LITERAL };
+
+struct JsonToken {
+  JsonTokenType type;
+  uint16_t start;   // primer byte del valor (para STRING, ya des-escapado)
+  uint16_t end;     // uno más allá del último byte
+  uint16_t size;    // OBJECT: claves; ARRAY: elementos
+  uint16_t next;    // índice del token que sigue a todo este subárbol
+};
+
+class JsonTokenizer {
+ public:
+  static constexpr size_t MAX_TEXT_LEN = UINT16_MAX;
+  static constexpr uint8_t MAX_DEPTH = 8;
+
+  JsonTokenizer(JsonToken* tokens, size_t capacity) : tokens_(tokens), capacity_(capacity) {}
+
+  // Tokeniza `text` (que se modifica). Devuelve false si no es un único
+  // valor JSON válido; errorOffset() indica dónde se detuvo.
+  bool parse(char* text, size_t len) {
+    text_ = text;
+    len_ = len;
+    pos_ = 0;
+    count_ = 0;
+    if (len > MAX_TEXT_LEN) return fail();
+    if (!value(0)) return false;
+    skipSpace();
+    return pos_ == len_ ? true : fail();
+  }
+
+  size_t count() const { return count_; }
+  size_t errorOffset() const { return pos_; }
+  const JsonToken& token(size_t i) const { return tokens_[i]; }
+
+  // Índice del valor al que apunta `pointer` desde el token `from`, o -1
+  int find(const char* pointer, int from = 0) const {
+    if (from < 0 || (size_t)from >= count_) return -1;
+    int current = from;
+    const char* p = pointer;
+    while (*p == '/') {
+      const char* segment = ++p;
+      while (*p && *p != '/') p++;
+      current = child(current, segment, (size_t)(p - segment));
+      if (current < 0) return -1;
+    }
+    return *p == '\0' ? current : -1;
+  }
+
+  // Cadena terminada en '\0' dentro del buffer, o nullptr si no es STRING
+  const char* string(int i) const {
+    if (!is(i, JsonTokenType::STRING)) return nullptr;
+    return text_ + tokens_[i].start;
+  }
+
+  bool number(int i, double& value) const {
+    if (!is(i, JsonTokenType::NUMBER)) return false;
+    char scratch[32];
+    if (!copy(i, scratch, sizeof(scratch))) return false;
+    value = strtod(scratch, nullptr);
+    return true;
+  }
+
+  // Solo enteros exactos dentro de int32_t (sin parte decimal ni exponente)
+  bool integer(int i, int32_t& value) const {
+    if (!is(i, JsonTokenType::NUMBER)) return false;
+    char scratch[16];
+    if (!copy(i, scratch, sizeof(scratch))) return false;
+    char* end = nullptr;
+    const long long parsed = strtoll(scratch, &end, 10);
+    if (*end != '\0' || parsed < INT32_MIN || parsed > INT32_MAX) return false;
+    value = (int32_t)parsed;
+    return true;
+  }
+
+  bool boolean(int i, bool& value) const {
+    if (!is(i, JsonTokenType::LITERAL) || text_[tokens_[i].start] == 'n') return false;
+    value = text_[tokens_[i].start] == 't';
+    return true;
+  }
+
+  bool isNull(int i) const { return is(i, JsonTokenType::LITERAL) && text_[tokens_[i].start] == 'n'; }
+
+  bool is(int i, JsonTokenType type) const { return i >= 0 && (size_t)i < count_ && tokens_[i].type == type; }
+
+ private:
+  bool fail() {
+    count_ = 0;
+    return false;
+  }
+
+  void skipSpace() {
+    while (pos_ < len_ && (text_[pos_] == ' ' || text_[pos_] == '\n' || text_[pos_] == '\r' || text_[pos_] == '\t')) {
+      pos_++;
+    }
+  }
+
+  int add(JsonTokenType type, size_t start) {
+    if (count_ >= capacity_) return -1;
+    JsonToken& t = tokens_[count_];
+    t.type = type;
+    t.start = (uint16_t)start;
+    t.end = (uint16_t)start;
+    t.size = 0;
+    t.next = 0;
+    return (int)count_++;
+  }
+
+  bool value(uint8_t depth) {
+    skipSpace();
+    if (pos_ >= len_) return fail();
+    const char c = text_[pos_];
+    if (c == '{' || c == '[') return container(depth, c == '{');
+    if (c == '"') return stringValue();
+    if (c == 't') return literal("true");
+    if (c == 'f') return literal("false");
+    if (c == 'n') return literal("null");
+    if (c == '-' || (c >= '0' && c <= '9')) return numberValue();
+    return fail();
+  }
+
+  bool container(uint8_t depth, bool object) {
+    if (depth >= MAX_DEPTH) return fail();
+    const int self = add(object ? JsonTokenType::OBJECT : JsonTokenType::ARRAY, pos_);
+    if (self < 0) return fail();
+    const char close = object ? '}' : ']';
+    pos_++;
+    skipSpace();
+    if (pos_ < len_ && text_[pos_] == close) {
+      pos_++;
+      return finish(self);
+    }
+    for (;;) {
+      if (object) {
+        skipSpace();
+        if (pos_ >= len_ || text_[pos_] != '"' || !stringValue()) return fail();
+        skipSpace();
+        if (pos_ >= len_ || text_[pos_] != ':') return fail();
+        pos_++;
+      }
+      if (!value(depth + 1)) return false;
+      if (tokens_[self].size == UINT16_MAX) return fail();
+      tokens_[self].size++;
+      skipSpace();
+      if (pos_ >= len_) return fail();
+      if (text_[pos_] == close) {
+        pos_++;
+        return finish(self);
+      }
+      if (text_[pos_] != ',') return fail();
+      pos_++;
+    }
+  }
+
+  bool finish(int self) {
+    tokens_[self].end = (uint16_t)pos_;
+    tokens_[self].next = (uint16_t)count_;
+    return true;
+  }
+
+  // Des-escapa en sitio: la salida nunca adelanta a la lectura
+  bool stringValue() {
+    const int self = add(JsonTokenType::STRING, pos_ + 1);
+    if (self < 0) return fail();
+    size_t out = ++pos_;
+    while (pos_ < len_) {
+      char c = text_[pos_++];
+      if (c == '"') {
+        text_[out] = '\0';  // como mucho, sobre la comilla de cierre
+        tokens_[self].end = (uint16_t)out;
+        tokens_[self].next = (uint16_t)count_;
+        return true;
+      }
+      if ((unsigned char)c < 0x20) return fail();
+      if (c != '\\') {
+        text_[out++] = c;
+        continue;
+      }
+      if (pos_ >= len_) return fail();
+      c = text_[pos_++];
+      switch (c) {
+        case '"': case '\\': case '/': text_[out++] = c; break;
+        case 'b': text_[out++] = '\b'; break;
+        case 'f': text_[out++] = '\f'; break;
+        case 'n': text_[out++] = '\n'; break;
+        case 'r': text_[out++] = '\r'; break;
+        case 't': text_[out++] = '\t'; break;
+        case 'u': {
+          uint32_t code;
+          if (!hex4(code)) return fail();
+          if (code >= 0xD800 && code <= 0xDBFF) {
+            uint32_t low;
+            if (pos_ + 2 > len_ || text_[pos_] != '\\' || text_[pos_ + 1] != 'u') return fail();
+            pos_ += 2;
+            if (!hex4(low) || low < 0xDC00 || low > 0xDFFF) return fail();
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+          } else if (code >= 0xDC00 && code <= 0xDFFF) {
+            return fail();
+          }
+          out += utf8(code, text_ + out);
+          break;
+        }
+        default:
+          return fail();
+      }
+    }
+    return fail();
+  }
+
+  bool hex4(uint32_t& code) {
+    if (pos_ + 4 > len_) return false;
+    code = 0;
+    for (int i = 0; i < 4; i++) {
+      const char h = text_[pos_++];
+      uint32_t digit;
+      if (h >= '0' && h <= '9') digit = (uint32_t)(h - '0');
+      else if (h >= 'a' && h <= 'f') digit = (uint32_t)(h - 'a' + 10);
+      else if (h >= 'A' && h <= 'F') digit = (uint32_t)(h - 'A' + 10);
+      else return false;
+      code = code << 4 | digit;
+    }
+    return true;
+  }
+
+  // \uXXXX ocupa 6 bytes y produce como mucho 3; un par sustituto, 12 y 4
+  static size_t utf8(uint32_t code, char* out) {
+    if (code < 0x80) {
+      out[0] = (char)code;
+      return 1;
+    }
+    if (code < 0x800) {
+      out[0] = (char)(0xC0 | code >> 6);
+      out[1] = (char)(0x80 | (code & 0x3F));
+      return 2;
+    }
+    if (code < 0x10000) {
+      out[0] = (char)(0xE0 | code >> 12);
+      out[1] = (char)(0x80 | (code >> 6 & 0x3F));
+      out[2] = (char)(0x80 | (code & 0x3F));
+      return 3;
+    }
+    out[0] = (char)(0xF0 | code >> 18);
+    out[1] = (char)(0x80 | (code >> 12 & 0x3F));
+    out[2] = (char)(0x80 | (code >> 6 & 0x3F));
+    out[3] = (char)(0x80 | (code & 0x3F));
+    return 4;
+  }
+
+  bool literal(const char* word) {
+    const size_t n = strlen(word);
+    if (pos_ + n > len_ || memcmp(text_ + pos_, word, n) != 0) return fail();
+    const int self = add(JsonTokenType::LITERAL, pos_);
+    if (self < 0) return fail();
+    pos_ += n;
+    return finish(self);
+  }
+
+  // Gramática de RFC 8259: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+  bool numberValue() {
+    const int self = add(JsonTokenType::NUMBER, pos_);
+    if (self < 0) return fail();
+    if (text_[pos_] == '-') pos_++;
+    if (pos_ >= len_ || !digit(text_[pos_])) return fail();
+    if (text_[pos_] == '0') {
+      pos_++;
+    } else {
+      while (pos_ < len_ && digit(text_[pos_])) pos_++;
+    }
+    if (pos_ < len_ && text_[pos_] == '.') {
+      pos_++;
+      if (pos_ >= len_ || !digit(text_[pos_])) return fail();
+      while (pos_ < len_ && digit(text_[pos_])) pos_++;
+    }
+    if (pos_ < len_ && (text_[pos_] == 'e' || text_[pos_] == 'E')) {
+      pos_++;
+      if (pos_ < len_ && (text_[pos_] == '+' || text_[pos_] == '-')) pos_++;
+      if (pos_ >= len_ || !digit(text_[pos_])) return fail();
+      while (pos_ < len_ && digit(text_[pos_])) pos_++;
+    }
+    return finish(self);
+  }
+
+  static bool digit(char c) { return c >= '0' && c <= '9'; }
+
+  bool copy(int i, char* out, size_t capacity) const {
+    const size_t n = (size_t)(tokens_[i].end - tokens_[i].start);
+    if (n + 1 > capacity) return false;
+    memcpy(out, text_ + tokens_[i].start, n);
+    out[n] = '\0';
+    return true;
+  }
+
+  // Hijo de `parent` nombrado por un segmento de puntero (con ~0 y ~1)
+  int child(int parent, const char* segment, size_t len) const {
+    const JsonToken& p = tokens_[parent];
+    if (p.type == JsonTokenType::ARRAY) {
+      if (len == 0 || len > 5 || (len > 1 && segment[0] == '0')) return -1;
+      uint32_t index = 0;
+      for (size_t k = 0; k < len; k++) {
+        if (!digit(segment[k])) return -1;
+        index = index * 10 + (uint32_t)(segment[k] - '0');
+      }
+      if (index >= p.size) return -1;
+      int i = parent + 1;
+      while (index-- > 0) i = tokens_[i].next;
+      return i;
+    }
+    if (p.type != JsonTokenType::OBJECT) return -1;
+    int key = parent + 1;
+    for (uint16_t k = 0; k < p.size; k++) {
+      const int val = key + 1;
+      if (keyEquals(key, segment, len)) return val;
+      key = tokens_[val].next;
+    }
+    return -1;
+  }
+
+  bool keyEquals(int key, const char* segment, size_t len) const {
+    const char* k = text_ + tokens_[key].start;
+    const char* kEnd = text_ + tokens_[key].end;
+    for (size_t s = 0; s < len; s++) {
+      char c = segment[s];
+      if (c == '~') {
+        if (s + 1 >= len || (segment[s + 1] != '0' && segment[s + 1] != '1')) return false;
+        c = segment[++s] == '0' ? '~' : '/';
+      }
+      if (k >= kEnd || *k++ != c) return false;
+    }
+    return k == kEnd;
+  }
+
+  JsonToken* tokens_;
+  size_t capacity_;
+  size_t count_ = 0;
+  char* text_ = nullptr;
+  size_t len_ = 0;
+  size_t pos_ = 0;
+};
@@ -0,0 +1,204 @@
+#pragma once
+#include <atomic>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// =============================================================
+// === Niveles de log (filtrado en compilación) ===
+// =============================================================
+// Los niveles por encima de LOG_LEVEL se compilan como `if (0)`: el compilador
+// comprueba el formato y elimina la llamada, así que ni se formatean ni se
+// evalúan sus argumentos.
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+#ifndef LOG_ANSI
+#define LOG_ANSI 1
+#endif
+#ifndef LOG_RING_SLOTS
+#define LOG_RING_SLOTS 32
+#endif
+#ifndef LOG_LINE_LEN
+#define LOG_LINE_LEN 120
+#endif
+
+// === Códigos de color ANSI para logs ===
+#define ANSI_RESET   "\033[0m"
+#define ANSI_RED     "\033[31m"
+#define ANSI_GREEN   "\033[32m"
+#define ANSI_YELLOW  "\033[33m"
+#define ANSI_BLUE    "\033[34m"
+#define ANSI_CYAN    "\033[36m"
+#define ANSI_BOLD    "\033[1m"
+
+// =============================================================
+// === Anillo de líneas de log (N productores / 1 consumidor) ===
+// =============================================================
+// Cola acotada de Vyukov: cada hueco lleva un número de secuencia que dice
+// si está libre para el productor de esa vuelta o listo para el consumidor.
+// El productor reserva un hueco con un CAS y formatea directamente en él,
+// así que escribir un log no toma locks, no reserva memoria ni espera a la
+// UART. Si el anillo está lleno la línea se descarta y se cuenta.
+template <size_t Slots, size_t LineLen>
+class LogRing {
+  static_assert(Slots >= 2 && (Slots & (Slots - 1)) == 0, "Slots debe ser potencia de 2");
+
+ public:
+  LogRing() {
+    for (size_t i = 0; i < Slots; i++) slots_[i].seq.store((uint32_t)i, std::memory_order_relaxed);
+  }
+
+  bool vwrite(uint8_t level, uint32_t ms, const char* format, va_list args) {
+    uint32_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+      slot = &slots_[pos & (Slots - 1)];
+      const uint32_t seq = slot->seq.load(std::memory_order_acquire);
+      const int32_t diff = (int32_t)(seq - pos);
+      if (diff == 0) {
+        if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      } else {
+        pos = enqueuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    slot->level = level;
+    slot->ms = ms;
+    vsnprintf(slot->text, LineLen, format, args);
+    slot->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Solo desde el consumidor: entrega hasta `max` líneas a sink(level, ms, text)
+  template <typename Sink>
+  size_t drain(Sink sink, size_t max = Slots) {
+    size_t n = 0;
+    while (n < max) {
+      Slot& slot = slots_[dequeuePos_ & (Slots - 1)];
+      if (slot.seq.load(std::memory_order_acquire) != dequeuePos_ + 1) break;
+      sink(slot.level, slot.ms, (const char*)slot.text);
+      slot.seq.store(dequeuePos_ + Slots, std::memory_order_release);
+      dequeuePos_++;
+      n++;
+    }
+    return n;
+  }
+
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Slot {
+    std::atomic<uint32_t> seq{0};
+    uint8_t level = 0;
+    uint32_t ms = 0;
+    char text[LineLen];
+  };
+
+  Slot slots_[Slots];
+  std::atomic<uint32_t> enqueuePos_{0};
+  std::atomic<uint32_t> dropped_{0};
+  uint32_t dequeuePos_ = 0;
+};
+
+// =============================================================
+// === Logger ===
+// =============================================================
+// write() solo formatea en el anillo. La salida real (Serial en el ESP32,
+// stdout en el host) la hace drain() desde una tarea de baja prioridad.
+class Logger {
+ public:
+  typedef void (*OutputFn)(const char* text, size_t len);
+  typedef uint32_t (*ClockFn)();
+
+  void begin(OutputFn output, ClockFn clockMs) {
+    output_ = output;
+    clockMs_ = clockMs;
+  }
+
+  void write(uint8_t level, const char* format, ...) __attribute__((format(printf, 3, 4))) {
+    va_list args;
+    va_start(args, format);
+    ring_.vwrite(level, clockMs_ ? clockMs_() : 0, format, args);
+    va_end(args);
+  }
+
+  // Vuelca las líneas pendientes; devuelve cuántas ha escrito
+  size_t drain(size_t max = LOG_RING_SLOTS) {
+    if (!output_) return 0;
+    const uint32_t dropped = ring_.dropped();
+    if (dropped != reportedDrops_) {
+      char line[64];
+      int len = snprintf(line, sizeof(line), "[log] %lu mensajes descartados\n",
+                         (unsigned long)(dropped - reportedDrops_));
+      output_(line, (size_t)len);
+      reportedDrops_ = dropped;
+    }
+    OutputFn output = output_;
+    return ring_.drain(
+        [output](uint8_t level, uint32_t ms, const char* text) {
+          char line[LOG_LINE_LEN + 40];
+          int len = snprintf(line, sizeof(line), "%s[%6lu.%03lu] %c %s%s\n", levelColor(level),
+                             (unsigned long)(ms / 1000), (unsigned long)(ms % 1000), levelTag(level), text,
+                             LOG_ANSI ? ANSI_RESET : "");
+          if (len > (int)sizeof(line) - 1) len = (int)sizeof(line) - 1;
+          if (len > 0) output(line, (size_t)len);
+        },
+        max);
+  }
+
+  uint32_t dropped() const { return ring_.dropped(); }
+
+  static char levelTag(uint8_t level) {
+    static const char TAGS[] = {'-', 'E', 'W', 'I', 'D'};
+    return level <= LOG_LEVEL_DEBUG ? TAGS[level] : '?';
+  }
+
+  static const char* levelColor(uint8_t level) {
+    if (!LOG_ANSI) return "";
+    switch (level) {
+      case LOG_LEVEL_ERROR: return ANSI_RED;
+      case LOG_LEVEL_WARN: return ANSI_YELLOW;
+      case LOG_LEVEL_INFO: return ANSI_GREEN;
+      default: return ANSI_CYAN;
+    }
+  }
+
+ private:
+  LogRing<LOG_RING_SLOTS, LOG_LINE_LEN> ring_;
+  OutputFn output_ = nullptr;
+  ClockFn clockMs_ = nullptr;
+  uint32_t reportedDrops_ = 0;
+};
+
+Logger logger;
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logger.write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do { if (0) logger.write(LOG_LEVEL_ERROR, __VA_ARGS__); } while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) logger.write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do { if (0) logger.write(LOG_LEVEL_WARN, __VA_ARGS__); } while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) logger.write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do { if (0) logger.write(LOG_LEVEL_INFO, __VA_ARGS__); } while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logger.write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do { if (0) logger.write(LOG_LEVEL_DEBUG, __VA_ARGS__); } while (0)
+#endif
@@ -2,6 +2,9 @@
 
 #include <AsyncMqttClient.h>
 #include <WiFi.h>
+#include <atomic>
+#include "FixedString.hpp"
+#include "Log.hpp"
 
 extern AsyncMqttClient mqttClient;
 
@@ -15,26 +18,81 @@ const char*   mqttClientId  = MQTT_CLIENT_ID;
 #ifndef MQTT_BASE_TOPIC
 #define MQTT_BASE_TOPIC MQTT_TOPIC
 #endif
+#ifndef MQTT_BATCH_TOPIC
+#define MQTT_BATCH_TOPIC MQTT_TOPIC "/batch"
+#endif
+#ifndef MQTT_CBOR_TOPIC
+#define MQTT_CBOR_TOPIC MQTT_TOPIC "/cbor"
+#endif
+#ifndef MQTT_BOOT_TOPIC
+#define MQTT_BOOT_TOPIC MQTT_TOPIC "/boot"
+#endif
+#ifndef MQTT_COMMAND_TOPIC
+#define MQTT_COMMAND_TOPIC MQTT_BASE_TOPIC "/comandos"
+#endif
+#ifndef MQTT_RESPONSE_TOPIC
+#define MQTT_RESPONSE_TOPIC MQTT_BASE_TOPIC "/respuestas"
+#endif
+#ifndef MQTT_DIAG_TOPIC
+#define MQTT_DIAG_TOPIC MQTT_BASE_TOPIC "/diag"
+#endif
 const char*   mqttBaseTopic    = MQTT_BASE_TOPIC;
 const char*   mqttPublishTopic = MQTT_TOPIC;
+const char*   mqttCommandTopic = MQTT_COMMAND_TOPIC;
 const uint8_t mqttQos          = MQTT_QOS;
+#ifndef MQTT_RETAIN_READINGS
+#define MQTT_RETAIN_READINGS 1
+#endif
+// Solo la lectura en directo se retiene; el resto de publicaciones no, salvo que se pida
+const bool    mqttRetainReadings = MQTT_RETAIN_READINGS;
+
+// Publicaciones QoS1 sin PUBACK todavía: sube al publicar (tarea de red) y
+// baja en OnMqttPublish (async_tcp); al desconectar se pierden todas
+std::atomic<uint16_t> mqttInflight{0};
+
+void CountMqttPublish(uint16_t packetId)
+{
+    if (packetId != 0 && mqttQos > 0) mqttInflight.fetch_add(1, std::memory_order_relaxed);
+}
 
-String GetPayloadContent(char* data, size_t len)
+void CountMqttAck()
 {
-    String content; content.reserve(len);
-    for (size_t i = 0; i < len; i++) content.concat(data[i]);
-    return content;
+    uint16_t n = mqttInflight.load(std::memory_order_relaxed);
+    while (n > 0 && !mqttInflight.compare_exchange_weak(n, n - 1, std::memory_order_relaxed)) {
+    }
+}
+
+// Copia el payload (sin '\0') a una cadena fija; false si se ha cortado
+template <size_t N>
+bool GetPayloadContent(const char* data, size_t len, FixedString<N>& content)
+{
+    content.clear();
+    content.append(data, len);
+    return !content.truncated();
 }
 
 void SuscribeMqtt()
 {
-    String commandTopic = String(mqttBaseTopic) + "/comandos";
-    uint16_t packetIdSub = mqttClient.subscribe(commandTopic.c_str(), mqttQos);
-    Serial.printf("Subscribing at QoS %d, packetId: %d\n", mqttQos, packetIdSub);
+    uint16_t packetIdSub = mqttClient.subscribe(mqttCommandTopic, mqttQos);
+    LOG_DEBUG("Subscribing at QoS %d, packetId: %d", mqttQos, packetIdSub);
+}
+
+// Publica un buffer ya serializado sin copiarlo a un String intermedio.
+// Devuelve el packetId asignado (0 si no se pudo publicar).
+uint16_t PublishMqttTo(const char* topic, const char* payload, size_t length, bool retain = false)
+{
+    if (!mqttClient.connected()) return 0;
+    const uint16_t packetId = mqttClient.publish(topic, mqttQos, retain, payload, length);
+    CountMqttPublish(packetId);
+    return packetId;
+}
+
+uint16_t PublishMqtt(const char* payload, size_t length, bool retain = false)
+{
+    return PublishMqttTo(mqttPublishTopic, payload, length, retain);
 }
 
-bool PublishMqtt(const String& payload, bool retain = true)
+bool PublishMqtt(const String& payload, bool retain = false)
 {
-    if (!mqttClient.connected()) return false;
-    return mqttClient.publish(mqttPublishTopic, mqttQos, retain, payload.c_str());
+    return PublishMqtt(payload.c_str(), payload.length(), retain) != 0;
 }
\ No newline at end of file
@@ -0,0 +1,155 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "PayloadWriter.hpp"
+
+// =============================================================
+// === Esquemas de payload por sensor (json/) ===
+// =============================================================
+// Cada ejemplo de json/ es la misma cabecera (identidad, instante y
+// ubicación) con un subconjunto de PAYLOAD_FIELDS en "data": todos en
+// json-general y uno solo en json-temperatura, json-humedad, etc. Un esquema
+// solo dice qué campos lleva, si cambia el sensor_type de la estación y en
+// qué subtema se publica en el modo dividido (PAYLOAD_SPLIT_TOPICS).
+struct PayloadSchema {
+  const char* subtopic;    // MQTT_TOPIC "/" subtopic en el modo dividido
+  const char* sensorType;  // nullptr = el de la estación
+  uint8_t fields;          // bits de PAYLOAD_FIELDS (payloadFieldBit)
+};
+
+constexpr PayloadSchema SCHEMA_GENERAL = {"", nullptr, PAYLOAD_FIELDS_SENSOR};
+constexpr PayloadSchema SCHEMA_TEMPERATURA = {"temperatura", nullptr, payloadFieldBit(FIELD_TEMPERATURE)};
+constexpr PayloadSchema SCHEMA_HUMEDAD = {"humedad", "humidity", payloadFieldBit(FIELD_HUMIDITY)};
+constexpr PayloadSchema SCHEMA_VIENTO = {"viento", nullptr, payloadFieldBit(FIELD_WIND)};
+constexpr PayloadSchema SCHEMA_LUZ = {"luz", nullptr, payloadFieldBit(FIELD_LIGHT)};
+// json/json-altitud: la altitud ya va en "location"; en "data" va la presión
+constexpr PayloadSchema SCHEMA_PRESION = {"presion", nullptr, payloadFieldBit(FIELD_PRESSURE)};
+constexpr PayloadSchema SCHEMA_AIRE = {"aire", nullptr, (uint8_t)(payloadFieldBit(FIELD_AIR_QUALITY) | PAYLOAD_FIELDS_GAS)};
+
+// Un mensaje por métrica, en el orden de la tabla
+constexpr const PayloadSchema* SPLIT_SCHEMAS[] = {
+    &SCHEMA_TEMPERATURA, &SCHEMA_HUMEDAD, &SCHEMA_VIENTO, &SCHEMA_LUZ, &SCHEMA_PRESION, &SCHEMA_AIRE,
+};
+constexpr size_t SPLIT_SCHEMA_COUNT = sizeof(SPLIT_SCHEMAS) / sizeof(SPLIT_SCHEMAS[0]);
+
+constexpr size_t cstrLen(const char* s) { return *s ? 1 + cstrLen(s + 1) : 0; }
+
+// Lo que sigue a la cabecera: campos, "}", stats opcional y "}"
+constexpr size_t schemaTailMaxLen(const PayloadSchema& schema, bool stats) {
+  return payloadDataMaxLen(schema.fields) + (stats ? payloadStatsMaxLen(schema.fields) : 0) + sizeof("}}") - 1;
+}
+
+constexpr size_t schemaPayloadMaxLen(const PayloadSchema& schema, bool stats) {
+  return PAYLOAD_HEADER_MAX_LEN + schemaTailMaxLen(schema, stats);
+}
+
+constexpr bool schemaTypeFits(const PayloadSchema& schema) {
+  return !schema.sensorType || cstrLen(schema.sensorType) < sizeof(StationInfo::sensorType);
+}
+
+// Escribe la cola de un esquema sobre una cabecera ya escrita
+void writeSchemaTail(JsonWriter& json, const PayloadSchema& schema, const SensorData& data, bool stats) {
+  writeDataFields(json, data, schema.fields);
+  json.literal("}");
+  if (stats && data.stats.windowMs > 0) writeStatsBlock(json, data.stats, schema.fields);
+  json.literal("}");
+}
+
+// =============================================================
+// === Serializador de un esquema concreto ===
+// =============================================================
+// SchemaPayload<SCHEMA_X> fija los campos en compilación (el bucle sobre la
+// tabla se desenrolla con la máscara constante) y da el tamaño exacto del
+// buffer: write() con un array más pequeño no compila.
+template <const PayloadSchema& Schema>
+struct SchemaPayload {
+  static_assert(schemaTypeFits(Schema), "sensor_type del esquema demasiado largo");
+  static constexpr size_t MAX_LEN = schemaPayloadMaxLen(Schema, PAYLOAD_STATS);
+  static constexpr size_t BUFFER_LEN = MAX_LEN + 1;
+
+  static size_t write(const StationInfo& station, const SensorData& data, const char* timestamp, char* out,
+                      size_t capacity) {
+    JsonWriter json(out, capacity);
+    writePayloadHeader(json, station, Schema.sensorType ? Schema.sensorType : station.sensorType,
+                       data.altitudeMeters, timestamp);
+    writeSchemaTail(json, Schema, data, PAYLOAD_STATS);
+    return json.overflow() ? 0 : json.length();
+  }
+
+  template <size_t N>
+  static size_t write(const StationInfo& station, const SensorData& data, const char* timestamp, char (&out)[N]) {
+    static_assert(N >= BUFFER_LEN, "Buffer menor que el payload máximo del esquema");
+    return write(station, data, timestamp, out, N);
+  }
+};
+
+// =============================================================
+// === Modo dividido: un mensaje por métrica en una sola pasada ===
+// =============================================================
+// La cabecera se serializa una vez por lectura (instante, ubicación y
+// altitud incluidos) y cada métrica solo reescribe lo que va detrás de
+// "data":{. Si el esquema cambia el sensor_type, el resto de la cabecera se
+// desplaza con memmove, sin volver a formatear nada.
+constexpr size_t splitTailMaxLen(size_t i = 0) {
+  return i >= SPLIT_SCHEMA_COUNT ? 0
+         : schemaTailMaxLen(*SPLIT_SCHEMAS[i], PAYLOAD_STATS) > splitTailMaxLen(i + 1)
+             ? schemaTailMaxLen(*SPLIT_SCHEMAS[i], PAYLOAD_STATS)
+             : splitTailMaxLen(i + 1);
+}
+
+constexpr size_t SPLIT_PAYLOAD_MAX_LEN = PAYLOAD_HEADER_MAX_LEN + splitTailMaxLen();
+constexpr size_t SPLIT_PAYLOAD_BUFFER_LEN = SPLIT_PAYLOAD_MAX_LEN + 1;
+
+class SplitPayloadWriter {
+ public:
+  SplitPayloadWriter(char* buffer, size_t capacity) : buffer_(buffer), capacity_(capacity) {}
+
+  // Cabecera común de la lectura; false si no cabe
+  bool begin(const StationInfo& station, const SensorData& data, const char* timestamp) {
+    JsonWriter json(buffer_, capacity_);
+    stationType_ = station.sensorType;
+    currentType_ = stationType_;
+    writePayloadHeader(json, station, currentType_, data.altitudeMeters, timestamp, &typeStart_, &typeEnd_);
+    headerLen_ = json.overflow() ? 0 : json.length();
+    return headerLen_ > 0;
+  }
+
+  // Payload completo del esquema en buffer(); 0 si no cabe o no hay cabecera
+  size_t write(const PayloadSchema& schema, const SensorData& data, bool stats = PAYLOAD_STATS) {
+    if (headerLen_ == 0 || !retype(schema.sensorType ? schema.sensorType : stationType_)) return 0;
+    JsonWriter json(buffer_ + headerLen_, capacity_ - headerLen_);
+    writeSchemaTail(json, schema, data, stats);
+    return json.overflow() ? 0 : headerLen_ + json.length();
+  }
+
+  const char* buffer() const { return buffer_; }
+  size_t headerLength() const { return headerLen_; }
+
+ private:
+  bool retype(const char* type) {
+    if (type == currentType_ || strcmp(type, currentType_) == 0) return true;
+    char quoted[quotedMaxLen(sizeof(StationInfo::sensorType)) + 1];
+    JsonWriter json(quoted, sizeof(quoted));
+    json.string(type);
+    if (json.overflow()) return false;
+    const size_t oldLen = typeEnd_ - typeStart_;
+    const size_t newLen = json.length();
+    if (headerLen_ - oldLen + newLen >= capacity_) return false;
+    memmove(buffer_ + typeStart_ + newLen, buffer_ + typeEnd_, headerLen_ - typeEnd_);
+    memcpy(buffer_ + typeStart_, quoted, newLen);
+    headerLen_ = headerLen_ - oldLen + newLen;
+    typeEnd_ = typeStart_ + newLen;
+    currentType_ = type;
+    return true;
+  }
+
+  char* buffer_;
+  size_t capacity_;
+  size_t headerLen_ = 0;
+  size_t typeStart_ = 0;
+  size_t typeEnd_ = 0;
+  const char* stationType_ = "";
+  const char* currentType_ = "";
+};
@@ -0,0 +1,413 @@
+#pragma once
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "SensorData.hpp"
+
+// Valores por defecto si config.h no define la identidad de la estación
+#ifndef STATION_SENSOR_ID
+#define STATION_SENSOR_ID     "WS_001"
+#define STATION_SENSOR_TYPE   "weather"
+#define STATION_STREET_ID     "ST_1253"
+#define STATION_LATITUDE      "40.4094736"
+#define STATION_LONGITUDE     "-3.6920903"
+#define STATION_DISTRICT      "Centro"
+#define STATION_NEIGHBORHOOD  "Universidad"
+#endif
+
+// =============================================================
+// === Escritor JSON sobre un buffer fijo ===
+// =============================================================
+// Escribe directamente en memoria del llamante: sin String, sin heap.
+// Si el buffer no alcanza, marca overflow y deja de escribir.
+class JsonWriter {
+ public:
+  // Ancho máximo de un número escrito con number(): signo, 10 dígitos
+  // enteros, punto y hasta 6 decimales ("null" cabe de sobra).
+  static constexpr size_t MAX_NUMBER_LEN = 1 + 10 + 1 + 6;
+  static constexpr size_t MAX_INT_LEN = 11;    // int32_t con signo
+  static constexpr size_t MAX_INT64_LEN = 20;  // int64_t con signo
+
+  JsonWriter(char* buffer, size_t capacity) : buffer_(buffer), capacity_(capacity) {
+    if (capacity_ > 0) buffer_[0] = '\0';
+  }
+
+  JsonWriter& raw(const char* text, size_t len) {
+    if (overflow_ || len_ + len + 1 > capacity_) {
+      overflow_ = true;
+      return *this;
+    }
+    memcpy(buffer_ + len_, text, len);
+    len_ += len;
+    buffer_[len_] = '\0';
+    return *this;
+  }
+
+  template <size_t N>
+  JsonWriter& literal(const char (&text)[N]) { return raw(text, N - 1); }
+
+  JsonWriter& raw(const char* text) { return raw(text, strlen(text)); }
+
+  // Lo que más ocupa un carácter escapado: \u00XX
+  static constexpr size_t MAX_ESCAPED_CHAR_LEN = 6;
+
+  JsonWriter& string(const char* text) {
+    raw("\"", 1);
+    for (const char* p = text; *p; p++) {
+      const char c = *p;
+      if (c == '"' || c == '\\') {
+        const char escaped[2] = {'\\', c};
+        raw(escaped, 2);
+      } else if ((unsigned char)c < 0x20) {
+        control(c);
+      } else {
+        raw(&c, 1);
+      }
+    }
+    return raw("\"", 1);
+  }
+
+  JsonWriter& integer(int64_t value) {
+    char digits[MAX_INT64_LEN + 1];
+    size_t n = 0;
+    uint64_t magnitude = value < 0 ? 0ULL - (uint64_t)value : (uint64_t)value;
+    do {
+      digits[n++] = (char)('0' + magnitude % 10);
+      magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) digits[n++] = '-';
+    char out[MAX_INT64_LEN + 1];
+    for (size_t i = 0; i < n; i++) out[i] = digits[n - 1 - i];
+    return raw(out, n);
+  }
+
+  // Número en coma fija con `decimals` decimales, sin ceros finales.
+  // NaN, infinito o valores fuera de rango se escriben como null.
+  JsonWriter& number(double value, uint8_t decimals) {
+    if (decimals > 6) decimals = 6;
+    if (isnan(value) || isinf(value) || fabs(value) >= 1e9) return literal("null");
+
+    uint32_t scale = 1;
+    for (uint8_t i = 0; i < decimals; i++) scale *= 10;
+    const bool negative = value < 0;
+    const uint64_t scaled = (uint64_t)(fabs(value) * scale + 0.5);
+    uint64_t whole = scaled / scale;
+    uint32_t frac = (uint32_t)(scaled % scale);
+
+    char out[MAX_NUMBER_LEN + 1];
+    size_t n = 0;
+    if (negative && scaled != 0) out[n++] = '-';
+
+    char digits[11];
+    size_t d = 0;
+    do {
+      digits[d++] = (char)('0' + whole % 10);
+      whole /= 10;
+    } while (whole > 0);
+    while (d > 0) out[n++] = digits[--d];
+
+    if (frac != 0) {
+      uint8_t places = decimals;
+      while (frac % 10 == 0) {
+        frac /= 10;
+        places--;
+      }
+      out[n++] = '.';
+      for (uint8_t i = places; i > 0; i--) {
+        uint32_t divisor = 1;
+        for (uint8_t k = 1; k < i; k++) divisor *= 10;
+        out[n++] = (char)('0' + (frac / divisor) % 10);
+      }
+    }
+    return raw(out, n);
+  }
+
+  size_t length() const { return len_; }
+  bool overflow() const { return overflow_; }
+
+ private:
+  // Caracteres de control: escape corto si JSON lo tiene, si no \u00XX
+  void control(char c) {
+    static const char HEX[] = "0123456789abcdef";
+    char escaped[MAX_ESCAPED_CHAR_LEN] = {'\\', 'u', '0', '0', HEX[(c >> 4) & 0xF], HEX[c & 0xF]};
+    size_t n = 2;
+    switch (c) {
+      case '\b': escaped[1] = 'b'; break;
+      case '\f': escaped[1] = 'f'; break;
+      case '\n': escaped[1] = 'n'; break;
+      case '\r': escaped[1] = 'r'; break;
+      case '\t': escaped[1] = 't'; break;
+      default: n = MAX_ESCAPED_CHAR_LEN; break;
+    }
+    raw(escaped, n);
+  }
+
+  char* buffer_;
+  size_t capacity_;
+  size_t len_ = 0;
+  bool overflow_ = false;
+};
+
+// =============================================================
+// === Tabla de campos de "data" ===
+// =============================================================
+// Una entrada por métrica en el orden de json/json-general, con la clave,
+// los decimales publicados (resolución real de cada sensor; 0 = entero) y de
+// dónde sale el valor y su resumen. El payload completo, el bloque "stats" y
+// los esquemas por sensor de PayloadSchema.hpp se generan desde aquí.
+enum PayloadFieldId : uint8_t {
+  FIELD_TEMPERATURE,
+  FIELD_HUMIDITY,
+  FIELD_WIND,
+  FIELD_LIGHT,
+  FIELD_PRESSURE,
+  FIELD_AIR_QUALITY,
+  FIELD_GAS_PPM,
+  PAYLOAD_FIELD_COUNT
+};
+
+struct PayloadField {
+  const char* key;
+  size_t keyLen;
+  uint8_t decimals;
+  float (*value)(const SensorData&);
+  const ChannelSummary& (*summary)(const SensorStats&);  // nullptr = sin bloque stats
+};
+
+inline float fieldTemperature(const SensorData& d) { return d.temperatureC; }
+inline float fieldHumidity(const SensorData& d) { return d.humidityPercent; }
+inline float fieldWind(const SensorData& d) { return d.windSpeedKmh; }
+inline float fieldLight(const SensorData& d) { return d.lightLux; }
+inline float fieldPressure(const SensorData& d) { return d.pressureHpa; }
+inline float fieldAirQuality(const SensorData& d) { return (float)d.gasRaw; }
+inline float fieldGasPpm(const SensorData& d) { return d.gasPpm; }
+
+inline const ChannelSummary& summaryTemperature(const SensorStats& s) { return s.temperatureC; }
+inline const ChannelSummary& summaryHumidity(const SensorStats& s) { return s.humidityPercent; }
+inline const ChannelSummary& summaryWind(const SensorStats& s) { return s.windSpeedKmh; }
+inline const ChannelSummary& summaryLight(const SensorStats& s) { return s.lightLux; }
+inline const ChannelSummary& summaryPressure(const SensorStats& s) { return s.pressureHpa; }
+inline const ChannelSummary& summaryAirQuality(const SensorStats& s) { return s.gasRaw; }
+
+#define PAYLOAD_FIELD(key, decimals, value, summary) {key, sizeof(key) - 1, decimals, value, summary}
+
+constexpr PayloadField PAYLOAD_FIELDS[PAYLOAD_FIELD_COUNT] = {
+    PAYLOAD_FIELD("temperature_celsius", 1, fieldTemperature, summaryTemperature),
+    PAYLOAD_FIELD("humidity_percentage", 1, fieldHumidity, summaryHumidity),
+    PAYLOAD_FIELD("wind_speed", 2, fieldWind, summaryWind),
+    PAYLOAD_FIELD("luz", 1, fieldLight, summaryLight),
+    PAYLOAD_FIELD("atmospheric_pressure_hpa", 2, fieldPressure, summaryPressure),
+    PAYLOAD_FIELD("air_quality_index", 0, fieldAirQuality, summaryAirQuality),
+    PAYLOAD_FIELD("gas_ppm", 0, fieldGasPpm, nullptr),  // null hasta calibrar el MQ-2
+};
+
+// Conjunto de campos de un payload: bit i = PAYLOAD_FIELDS[i]
+constexpr uint8_t payloadFieldBit(PayloadFieldId id) { return (uint8_t)(1u << id); }
+constexpr uint8_t PAYLOAD_FIELDS_ALL = (uint8_t)((1u << PAYLOAD_FIELD_COUNT) - 1);
+// Los seis canales de json/json-general; gas_ppm va aparte (PAYLOAD_GAS_PPM)
+constexpr uint8_t PAYLOAD_FIELDS_GENERAL = (uint8_t)(PAYLOAD_FIELDS_ALL & ~payloadFieldBit(FIELD_GAS_PPM));
+
+// === Concentración del MQ-2 en ppm (PAYLOAD_GAS_PPM en config.h) ===
+// air_quality_index sigue siendo la lectura filtrada del ADC, como en los
+// ejemplos de json/; con PAYLOAD_GAS_PPM se añade gas_ppm detrás.
+#ifndef PAYLOAD_GAS_PPM
+#define PAYLOAD_GAS_PPM 0
+#endif
+constexpr uint8_t PAYLOAD_FIELDS_GAS = PAYLOAD_GAS_PPM ? payloadFieldBit(FIELD_GAS_PPM) : 0;
+constexpr uint8_t PAYLOAD_FIELDS_SENSOR = PAYLOAD_FIELDS_GENERAL | PAYLOAD_FIELDS_GAS;
+
+// Decimales publicados por canal (también para el lote de BatchPayload.hpp)
+constexpr uint8_t PAYLOAD_DECIMALS_TEMPERATURE = PAYLOAD_FIELDS[FIELD_TEMPERATURE].decimals;
+constexpr uint8_t PAYLOAD_DECIMALS_HUMIDITY = PAYLOAD_FIELDS[FIELD_HUMIDITY].decimals;
+constexpr uint8_t PAYLOAD_DECIMALS_WIND = PAYLOAD_FIELDS[FIELD_WIND].decimals;
+constexpr uint8_t PAYLOAD_DECIMALS_LIGHT = PAYLOAD_FIELDS[FIELD_LIGHT].decimals;
+constexpr uint8_t PAYLOAD_DECIMALS_PRESSURE = PAYLOAD_FIELDS[FIELD_PRESSURE].decimals;
+constexpr uint8_t PAYLOAD_DECIMALS_ALTITUDE = 1;
+
+// "2025-01-01T00:00:00.000+01:00" más margen
+constexpr size_t TIMESTAMP_MAX_LEN = 32;
+
+// Cota de los campos de `mask` dentro de "data", desde el campo i en adelante
+// (cada uno con su coma; el primero no la lleva, ver payloadDataMaxLen)
+constexpr size_t payloadFieldsMaxLen(uint8_t mask, size_t i) {
+  return i >= PAYLOAD_FIELD_COUNT ? 0
+                                  : (((mask >> i) & 1) ? sizeof(",\"\":") - 1 + PAYLOAD_FIELDS[i].keyLen +
+                                                             JsonWriter::MAX_NUMBER_LEN
+                                                       : 0) +
+                                        payloadFieldsMaxLen(mask, i + 1);
+}
+
+constexpr size_t payloadDataMaxLen(uint8_t mask) {
+  return mask ? payloadFieldsMaxLen(mask, 0) - 1 : 0;
+}
+
+// Escribe los campos de `mask` en el orden de la tabla, sin las llaves
+void writeDataFields(JsonWriter& json, const SensorData& data, uint8_t mask) {
+  bool first = true;
+  for (uint8_t i = 0; i < PAYLOAD_FIELD_COUNT; i++) {
+    if (!((mask >> i) & 1)) continue;
+    const PayloadField& field = PAYLOAD_FIELDS[i];
+    json.raw(first ? "\"" : ",\"", first ? 1 : 2).raw(field.key, field.keyLen).raw("\":", 2);
+    json.number(field.value(data), field.decimals);
+    first = false;
+  }
+}
+
+// =============================================================
+// === Payload json/json-general ===
+// =============================================================
+#define SENSOR_PAYLOAD_HEADER                                  \
+  "{\"sensor_id\":\"" STATION_SENSOR_ID "\","                  \
+  "\"sensor_type\":\"" STATION_SENSOR_TYPE "\","               \
+  "\"street_id\":\"" STATION_STREET_ID "\","                   \
+  "\"timestamp\":\""
+#define SENSOR_PAYLOAD_LOCATION                                \
+  "\",\"location\":{\"latitude\":" STATION_LATITUDE ","        \
+  "\"longitude\":" STATION_LONGITUDE ",\"altitude_meters\":"
+#define SENSOR_PAYLOAD_PLACE                                   \
+  ",\"district\":\"" STATION_DISTRICT "\","                    \
+  "\"neighborhood\":\"" STATION_NEIGHBORHOOD "\"},"            \
+  "\"data\":{"
+
+// Cota superior del payload, calculada en compilación
+constexpr size_t SENSOR_PAYLOAD_MAX_LEN =
+    sizeof(SENSOR_PAYLOAD_HEADER) - 1 + TIMESTAMP_MAX_LEN +
+    sizeof(SENSOR_PAYLOAD_LOCATION) - 1 + JsonWriter::MAX_NUMBER_LEN +
+    sizeof(SENSOR_PAYLOAD_PLACE) - 1 + payloadDataMaxLen(PAYLOAD_FIELDS_SENSOR) +
+    sizeof("}}") - 1;
+
+// La forma de json/json-general sigue cabiendo en el antiguo documento de
+// 512 B; gas_ppm (PAYLOAD_GAS_PPM) es un añadido y no cuenta
+static_assert(SENSOR_PAYLOAD_MAX_LEN - payloadDataMaxLen(PAYLOAD_FIELDS_SENSOR) +
+                      payloadDataMaxLen(PAYLOAD_FIELDS_GENERAL) < 512,
+              "El payload debe caber en el antiguo StaticJsonDocument<512>");
+
+// =============================================================
+// === Bloque opcional "stats" (PAYLOAD_STATS en config.h) ===
+// =============================================================
+// Junto a "data" y con las mismas claves: n, min, max, mean, sd y ewma de
+// cada canal en la ventana de publicación. Los canales sin muestras no salen.
+#ifndef PAYLOAD_STATS
+#define PAYLOAD_STATS 0
+#endif
+
+// Cota de un canal cuya clave mide keyLen caracteres
+constexpr size_t statsChannelMaxLen(size_t keyLen) {
+  return sizeof(",\"\":{\"n\":") - 1 + keyLen + JsonWriter::MAX_INT_LEN +
+         5 * (sizeof(",\"ewma\":") - 1 + JsonWriter::MAX_NUMBER_LEN) + sizeof("}") - 1;
+}
+
+constexpr size_t statsChannelsMaxLen(uint8_t mask, size_t i) {
+  return i >= PAYLOAD_FIELD_COUNT
+             ? 0
+             : (((mask >> i) & 1) && PAYLOAD_FIELDS[i].summary ? statsChannelMaxLen(PAYLOAD_FIELDS[i].keyLen) : 0) +
+                   statsChannelsMaxLen(mask, i + 1);
+}
+
+constexpr size_t payloadStatsMaxLen(uint8_t mask) {
+  return sizeof(",\"stats\":{\"window_s\":") - 1 + JsonWriter::MAX_INT_LEN + statsChannelsMaxLen(mask, 0) +
+         sizeof("}") - 1;
+}
+
+constexpr size_t SENSOR_STATS_MAX_LEN = payloadStatsMaxLen(PAYLOAD_FIELDS_SENSOR);
+
+// Tamaño del buffer de publicación con la configuración actual
+constexpr size_t SENSOR_PAYLOAD_BUFFER_LEN = SENSOR_PAYLOAD_MAX_LEN + (PAYLOAD_STATS ? SENSOR_STATS_MAX_LEN : 0) + 1;
+
+void writeStatsChannel(JsonWriter& json, const PayloadField& field, const ChannelSummary& c) {
+  if (c.count == 0) return;
+  json.literal(",\"").raw(field.key, field.keyLen).literal("\":{\"n\":").integer(c.count);
+  json.literal(",\"min\":").number(c.min, field.decimals);
+  json.literal(",\"max\":").number(c.max, field.decimals);
+  json.literal(",\"mean\":").number(c.mean, field.decimals);
+  json.literal(",\"sd\":").number(c.stddev, field.decimals + 1);
+  json.literal(",\"ewma\":").number(c.ewma, field.decimals);
+  json.literal("}");
+}
+
+void writeStatsBlock(JsonWriter& json, const SensorStats& stats, uint8_t mask = PAYLOAD_FIELDS_SENSOR) {
+  json.literal(",\"stats\":{\"window_s\":").integer((stats.windowMs + 500) / 1000);
+  for (uint8_t i = 0; i < PAYLOAD_FIELD_COUNT; i++) {
+    if (((mask >> i) & 1) && PAYLOAD_FIELDS[i].summary) writeStatsChannel(json, PAYLOAD_FIELDS[i], PAYLOAD_FIELDS[i].summary(stats));
+  }
+  json.literal("}");
+}
+
+/**
+ * @brief Serializa una lectura con el esquema de json/json-general en `out`.
+ * @return longitud escrita (sin el '\0'), o 0 si el buffer no alcanza.
+ */
+size_t writeSensorPayload(const SensorData& data, const char* timestamp, char* out, size_t capacity) {
+  JsonWriter json(out, capacity);
+  json.literal(SENSOR_PAYLOAD_HEADER);
+  json.raw(timestamp, strnlen(timestamp, TIMESTAMP_MAX_LEN));
+  json.literal(SENSOR_PAYLOAD_LOCATION).number(data.altitudeMeters, PAYLOAD_DECIMALS_ALTITUDE);
+  json.literal(SENSOR_PAYLOAD_PLACE);
+  writeDataFields(json, data, PAYLOAD_FIELDS_SENSOR);
+  json.literal("}");
+  if (PAYLOAD_STATS && data.stats.windowMs > 0) writeStatsBlock(json, data.stats);
+  json.literal("}");
+  return json.overflow() ? 0 : json.length();
+}
+
+// =============================================================
+// === Payload json/json-general con identidad en tiempo de ejecución ===
+// =============================================================
+// Misma salida que writeSensorPayload(), para el lado receptor que expande
+// mensajes de muchas estaciones (ver BatchPayload.hpp) y para los esquemas
+// por sensor de PayloadSchema.hpp.
+struct StationInfo {
+  char sensorId[24] = STATION_SENSOR_ID;
+  char sensorType[24] = STATION_SENSOR_TYPE;
+  char streetId[24] = STATION_STREET_ID;
+  char latitude[24] = STATION_LATITUDE;    // texto numérico, se emite tal cual
+  char longitude[24] = STATION_LONGITUDE;
+  char district[48] = STATION_DISTRICT;
+  char neighborhood[48] = STATION_NEIGHBORHOOD;
+};
+
+// Cadena de StationInfo entre comillas, con todos sus caracteres escapados
+constexpr size_t quotedMaxLen(size_t fieldSize) { return 2 + JsonWriter::MAX_ESCAPED_CHAR_LEN * (fieldSize - 1); }
+
+// Cota de todo lo anterior a los campos de "data", con "data":{ incluido
+constexpr size_t PAYLOAD_HEADER_MAX_LEN =
+    sizeof("{\"sensor_id\":") - 1 + quotedMaxLen(sizeof(StationInfo::sensorId)) +
+    sizeof(",\"sensor_type\":") - 1 + quotedMaxLen(sizeof(StationInfo::sensorType)) +
+    sizeof(",\"street_id\":") - 1 + quotedMaxLen(sizeof(StationInfo::streetId)) +
+    sizeof(",\"timestamp\":") - 1 + quotedMaxLen(TIMESTAMP_MAX_LEN) +
+    sizeof(",\"location\":{\"latitude\":") - 1 + sizeof(StationInfo::latitude) - 1 +
+    sizeof(",\"longitude\":") - 1 + sizeof(StationInfo::longitude) - 1 +
+    sizeof(",\"altitude_meters\":") - 1 + JsonWriter::MAX_NUMBER_LEN +
+    sizeof(",\"district\":") - 1 + quotedMaxLen(sizeof(StationInfo::district)) +
+    sizeof(",\"neighborhood\":") - 1 + quotedMaxLen(sizeof(StationInfo::neighborhood)) +
+    sizeof("},\"data\":{") - 1;
+
+// Cabecera hasta "data":{ con `sensorType` en lugar del de la estación.
+// Deja en typeStart/typeEnd dónde ha quedado el tipo (comillas incluidas).
+void writePayloadHeader(JsonWriter& json, const StationInfo& station, const char* sensorType, float altitudeMeters,
+                        const char* timestamp, size_t* typeStart = nullptr, size_t* typeEnd = nullptr) {
+  json.literal("{\"sensor_id\":").string(station.sensorId);
+  json.literal(",\"sensor_type\":");
+  if (typeStart) *typeStart = json.length();
+  json.string(sensorType);
+  if (typeEnd) *typeEnd = json.length();
+  json.literal(",\"street_id\":").string(station.streetId);
+  json.literal(",\"timestamp\":").string(timestamp);
+  json.literal(",\"location\":{\"latitude\":").raw(station.latitude);
+  json.literal(",\"longitude\":").raw(station.longitude);
+  json.literal(",\"altitude_meters\":").number(altitudeMeters, PAYLOAD_DECIMALS_ALTITUDE);
+  json.literal(",\"district\":").string(station.district);
+  json.literal(",\"neighborhood\":").string(station.neighborhood);
+  json.literal("},\"data\":{");
+}
+
+size_t writeSensorPayload(const StationInfo& station, const SensorData& data, const char* timestamp, char* out,
+                          size_t capacity) {
+  JsonWriter json(out, capacity);
+  writePayloadHeader(json, station, station.sensorType, data.altitudeMeters, timestamp);
+  writeDataFields(json, data, PAYLOAD_FIELDS_SENSOR);
+  json.literal("}}");
+  return json.overflow() ? 0 : json.length();
+}
@@ -0,0 +1,346 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "SensorData.hpp"
+
+// =============================================================
+// === Registro persistente de una lectura ===
+// =============================================================
+// Tamaño fijo y sin punteros para poder escribirlo tal cual en flash.
+struct StoredReading {
+  int64_t timestampMs = 0;  // instante original del muestreo (epoch ms)
+  float temperatureC = NAN;
+  float humidityPercent = NAN;
+  float pressureHpa = NAN;
+  float altitudeMeters = NAN;
+  float lightLux = NAN;
+  float windSpeedKmh = 0.0f;
+  float windGustKmh = 0.0f;
+  int32_t gasRaw = 0;
+  // Concentración y nivel del MQ-2 tal como se calcularon al muestrear: al
+  // reenviar ya no se tiene el filtro ni la R0 de entonces
+  float gasPpm = NAN;
+  uint8_t gasQuality = (uint8_t)AirQuality::UNKNOWN;
+  uint8_t reserved[3] = {};  // relleno explícito: el CRC cubre la estructura entera
+  // Si timestampMs es 0 (muestreo antes del NTP), la lectura aún se puede
+  // fechar desde uptimeMs mientras no cambie el arranque que la tomó
+  uint32_t uptimeMs = 0;
+  uint32_t bootId = 0;
+
+  static StoredReading from(const SensorData& data, uint32_t bootId = 0) {
+    StoredReading r;
+    r.timestampMs = data.timestampMs;
+    r.uptimeMs = data.uptimeMs;
+    r.bootId = bootId;
+    r.temperatureC = data.temperatureC;
+    r.humidityPercent = data.humidityPercent;
+    r.pressureHpa = data.pressureHpa;
+    r.altitudeMeters = data.altitudeMeters;
+    r.lightLux = data.lightLux;
+    r.windSpeedKmh = data.windSpeedKmh;
+    r.windGustKmh = data.windGustKmh;
+    r.gasRaw = data.gasRaw;
+    r.gasPpm = data.gasPpm;
+    r.gasQuality = (uint8_t)data.gasQuality;
+    return r;
+  }
+
+  SensorData toSensorData() const {
+    SensorData data;
+    data.timestampMs = timestampMs;
+    data.uptimeMs = uptimeMs;
+    data.temperatureC = temperatureC;
+    data.humidityPercent = humidityPercent;
+    data.pressureHpa = pressureHpa;
+    data.altitudeMeters = altitudeMeters;
+    data.lightLux = lightLux;
+    data.windSpeedKmh = windSpeedKmh;
+    data.windSpeedMs = windSpeedKmh / 3.6f;
+    data.windGustKmh = windGustKmh;
+    data.gasRaw = gasRaw;
+    data.gasPpm = gasPpm;
+    data.gasQuality = (AirQuality)gasQuality;
+    return data;
+  }
+};
+static_assert(sizeof(StoredReading) == 56, "StoredReading se escribe tal cual en flash: sin relleno implícito");
+
+// =============================================================
+// === Almacenamiento de registros ===
+// =============================================================
+class RecordStorage {
+ public:
+  virtual ~RecordStorage() {}
+  virtual bool read(uint32_t offset, void* dst, size_t len) = 0;
+  virtual bool write(uint32_t offset, const void* src, size_t len) = 0;
+};
+
+// Fichero con stdio: en el host es un fichero normal y en el ESP32 sirve
+// igual sobre LittleFS montado en /littlefs (VFS de ESP-IDF).
+class FileRecordStorage : public RecordStorage {
+ public:
+  ~FileRecordStorage() { close(); }
+
+  bool open(const char* path) {
+    close();
+    file_ = fopen(path, "r+b");
+    if (!file_) file_ = fopen(path, "w+b");
+    return file_ != nullptr;
+  }
+
+  void close() {
+    if (file_) fclose(file_);
+    file_ = nullptr;
+  }
+
+  bool read(uint32_t offset, void* dst, size_t len) override {
+    if (!file_ || fseek(file_, (long)offset, SEEK_SET) != 0) return false;
+    return fread(dst, 1, len, file_) == len;
+  }
+
+  bool write(uint32_t offset, const void* src, size_t len) override {
+    if (!file_ || fseek(file_, (long)offset, SEEK_SET) != 0) return false;
+    if (fwrite(src, 1, len, file_) != len) return false;
+    // fflush vacía el buffer de stdio y fsync confirma el bloque en el FS
+    return fflush(file_) == 0 && fsync(fileno(file_)) == 0;
+  }
+
+ private:
+  FILE* file_ = nullptr;
+};
+
+// =============================================================
+// === Cola circular persistente (store-and-forward) ===
+// =============================================================
+// Cada hueco guarda {magic, seq, lectura, crc}. Un corte de corriente a mitad
+// de escritura deja un hueco con CRC inválido que se ignora al recuperar.
+// Las entradas se marcan como consumidas (magic = 0) solo tras el ACK QoS1.
+// Si la cola se llena se descarta la entrada más antigua.
+template <uint32_t Capacity>
+class ReadingQueue {
+ public:
+  // "WSQ3"; WSQ1 no llevaba uptimeMs/bootId y WSQ2 no llevaba gasPpm/gasQuality.
+  // Los huecos WSQ2 se convierten al arrancar (ver migrateWsq2()); los WSQ1
+  // no validan y se ignoran.
+  static constexpr uint32_t MAGIC_VALID = 0x57535133;
+  static constexpr uint32_t MAGIC_WSQ2 = 0x57535132;
+  static constexpr uint32_t MAGIC_CONSUMED = 0;
+
+  struct Slot {
+    uint32_t magic;
+    uint32_t seq;
+    StoredReading reading;
+    uint32_t crc;
+  };
+  static_assert(offsetof(Slot, crc) == 2 * sizeof(uint32_t) + sizeof(StoredReading),
+                "El CRC no debe cubrir bytes de relleno");
+
+  // Reconstruye cabeza y cola a partir de lo que haya en el almacenamiento
+  bool begin(RecordStorage* storage) {
+    storage_ = storage;
+    headSeq_ = 0;
+    tailSeq_ = 0;
+    if (!storage_) return false;
+
+    bool found = false;
+    uint32_t minSeq = 0;
+    uint32_t maxSeq = 0;
+    Slot slot;
+    for (uint32_t i = 0; i < Capacity; i++) {
+      if (!readSlot(i, slot) || !isValid(slot) || slot.seq % Capacity != i) continue;
+      if (!found || (int32_t)(slot.seq - minSeq) < 0) minSeq = slot.seq;
+      if (!found || (int32_t)(slot.seq - maxSeq) > 0) maxSeq = slot.seq;
+      found = true;
+    }
+    if (!found) found = migrateWsq2(minSeq, maxSeq);
+    if (found) {
+      headSeq_ = minSeq;
+      tailSeq_ = maxSeq + 1;
+    }
+    return true;
+  }
+
+  // Devuelve el número de secuencia asignado
+  uint32_t push(const StoredReading& reading) {
+    if (size() >= Capacity) {
+      headSeq_++;
+      dropped_++;
+    }
+    Slot slot{};
+    slot.magic = MAGIC_VALID;
+    slot.seq = tailSeq_;
+    slot.reading = reading;
+    slot.crc = crc32(&slot, offsetof(Slot, crc));
+    if (!storage_ || !storage_->write(offsetOf(slot.seq), &slot, sizeof(slot))) writeErrors_++;
+    return tailSeq_++;
+  }
+
+  // Entrada más antigua pendiente; salta huecos corruptos
+  bool peek(StoredReading& reading, uint32_t& seq) {
+    Slot slot;
+    while (headSeq_ != tailSeq_) {
+      if (readSlot(headSeq_ % Capacity, slot) && isValid(slot) && slot.seq == headSeq_) {
+        reading = slot.reading;
+        seq = slot.seq;
+        return true;
+      }
+      headSeq_++;
+      corrupted_++;
+    }
+    return false;
+  }
+
+  // Entrada `offset` posiciones detrás de la cabeza (para armar lotes).
+  // Devuelve false si no existe o está corrupta.
+  bool peekAt(uint32_t offset, StoredReading& reading, uint32_t& seq) {
+    if (offset >= size()) return false;
+    Slot slot;
+    const uint32_t wanted = headSeq_ + offset;
+    if (!readSlot(wanted % Capacity, slot) || !isValid(slot) || slot.seq != wanted) return false;
+    reading = slot.reading;
+    seq = slot.seq;
+    return true;
+  }
+
+  // Marca como consumida la cabeza si coincide con `seq` (tras el ACK)
+  bool pop(uint32_t seq) {
+    if (headSeq_ == tailSeq_ || seq != headSeq_) return false;
+    const uint32_t consumed = MAGIC_CONSUMED;
+    if (!storage_ || !storage_->write(offsetOf(seq), &consumed, sizeof(consumed))) writeErrors_++;
+    headSeq_++;
+    return true;
+  }
+
+  uint32_t size() const { return tailSeq_ - headSeq_; }
+  bool empty() const { return headSeq_ == tailSeq_; }
+  uint32_t dropped() const { return dropped_; }
+  uint32_t corrupted() const { return corrupted_; }
+  uint32_t migrated() const { return migrated_; }
+  uint32_t writeErrors() const { return writeErrors_; }
+
+ private:
+  static uint32_t offsetOf(uint32_t seq) { return (seq % Capacity) * (uint32_t)sizeof(Slot); }
+
+  bool readSlot(uint32_t index, Slot& slot) {
+    return storage_ && storage_->read(index * (uint32_t)sizeof(Slot), &slot, sizeof(slot));
+  }
+
+  // Hueco del formato WSQ2: 64 B, la lectura sin gasPpm/gasQuality/reserved
+  struct SlotWsq2 {
+    uint32_t magic;
+    uint32_t seq;
+    int64_t timestampMs;
+    float temperatureC, humidityPercent, pressureHpa, altitudeMeters, lightLux, windSpeedKmh, windGustKmh;
+    int32_t gasRaw;
+    uint32_t uptimeMs;
+    uint32_t bootId;
+    uint32_t crc;
+  };
+  static_assert(sizeof(SlotWsq2) == 64 && offsetof(SlotWsq2, crc) == 56, "Hueco WSQ2 de 64 B, CRC sobre 56");
+
+  // Convierte en el sitio un fichero WSQ2 sin huecos WSQ3 válidos. Se recorre
+  // de atrás adelante: el hueco nuevo j (72 B en 72·j) solo pisa huecos viejos
+  // de índice >= j, que ya se han leído. Cada lectura conserva su seq y queda
+  // con gasPpm NaN y nivel desconocido. Un corte a mitad pierde los huecos
+  // viejos aún sin convertir: al siguiente arranque ya hay WSQ3 válidos.
+  bool migrateWsq2(uint32_t& minSeq, uint32_t& maxSeq) {
+    bool found = false;
+    SlotWsq2 old;
+    for (uint32_t j = Capacity; j-- > 0;) {
+      const uint32_t oldOffset = j * (uint32_t)sizeof(SlotWsq2);
+      if (!storage_->read(oldOffset, &old, sizeof(old))) continue;
+      if (old.magic != MAGIC_WSQ2 || old.crc != crc32(&old, offsetof(SlotWsq2, crc)) || old.seq % Capacity != j) {
+        continue;
+      }
+      Slot slot{};
+      slot.magic = MAGIC_VALID;
+      slot.seq = old.seq;
+      StoredReading& r = slot.reading;
+      r.timestampMs = old.timestampMs;
+      r.temperatureC = old.temperatureC;
+      r.humidityPercent = old.humidityPercent;
+      r.pressureHpa = old.pressureHpa;
+      r.altitudeMeters = old.altitudeMeters;
+      r.lightLux = old.lightLux;
+      r.windSpeedKmh = old.windSpeedKmh;
+      r.windGustKmh = old.windGustKmh;
+      r.gasRaw = old.gasRaw;
+      r.uptimeMs = old.uptimeMs;
+      r.bootId = old.bootId;
+      slot.crc = crc32(&slot, offsetof(Slot, crc));
+      if (!storage_->write(j * (uint32_t)sizeof(Slot), &slot, sizeof(slot))) {
+        writeErrors_++;
+        continue;
+      }
+      // El magic viejo queda dentro de un hueco nuevo anterior (aún sin
+      // escribir) o libre: se borra para no convertirlo dos veces
+      const uint32_t consumed = MAGIC_CONSUMED;
+      if (j > 0 && !storage_->write(oldOffset, &consumed, sizeof(consumed))) writeErrors_++;
+      if (!found || (int32_t)(slot.seq - minSeq) < 0) minSeq = slot.seq;
+      if (!found || (int32_t)(slot.seq - maxSeq) > 0) maxSeq = slot.seq;
+      found = true;
+      migrated_++;
+    }
+    return found;
+  }
+
+  static bool isValid(const Slot& slot) {
+    return slot.magic == MAGIC_VALID && slot.crc == crc32(&slot, offsetof(Slot, crc));
+  }
+
+  static uint32_t crc32(const void* data, size_t len) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; i++) {
+      crc ^= bytes[i];
+      for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+    return ~crc;
+  }
+
+  RecordStorage* storage_ = nullptr;
+  uint32_t headSeq_ = 0;
+  uint32_t tailSeq_ = 0;
+  uint32_t dropped_ = 0;
+  uint32_t corrupted_ = 0;
+  uint32_t migrated_ = 0;
+  uint32_t writeErrors_ = 0;
+};
+
+// =============================================================
+// === ACKs QoS1 recibidos ===
+// =============================================================
+// OnMqttPublish() entrega el id de cualquier publicación QoS1 (lecturas,
+// /diag, respuestas a comandos, informe de arranque) desde la tarea de
+// AsyncMqttClient. Se guardan los últimos N y la tarea de red busca el de
+// su lectura en vuelo con take(): un ACK ajeno que llegue entre medias no
+// lo pisa, y uno que llegue antes de que la tarea de red anote el id
+// tampoco se pierde. Cada id se consume una sola vez.
+template <size_t N>
+class PacketAckRing {
+ public:
+  // Un solo productor (la tarea del cliente MQTT)
+  void record(uint16_t packetId) {
+    if (packetId == 0) return;
+    ids_[next_ % N].store(packetId, std::memory_order_release);
+    next_++;
+  }
+
+  bool take(uint16_t packetId) {
+    if (packetId == 0) return false;
+    for (size_t i = 0; i < N; i++) {
+      uint16_t expected = packetId;
+      if (ids_[i].compare_exchange_strong(expected, 0, std::memory_order_acq_rel)) return true;
+    }
+    return false;
+  }
+
+ private:
+  std::atomic<uint16_t> ids_[N] = {};
+  uint32_t next_ = 0;
+};
@@ -0,0 +1,213 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// =============================================================
+// === Espera exponencial con jitter por dispositivo ===
+// =============================================================
+// Tras el fallo n la espera es d = min(maxMs, initialMs * 2^n) repartida en
+// [d/2, d): nunca menos de la mitad (la espera sigue creciendo) y con la
+// otra mitad aleatoria, para que estaciones que cayeron a la vez no vuelvan
+// a la vez. La semilla sale del client id o de la MAC.
+struct BackoffConfig {
+  uint32_t initialMs = 1000;
+  uint32_t maxMs = 120000;
+};
+
+class ReconnectBackoff {
+ public:
+  void configure(const BackoffConfig& config) { config_ = config; }
+  void seed(uint32_t value) { state_ = value ? value : 0x9E3779B9u; }
+
+  uint32_t nextDelayMs() {
+    uint32_t ceiling = config_.initialMs;
+    for (uint32_t i = 0; i < failures_ && ceiling < config_.maxMs; i++) ceiling *= 2;
+    if (ceiling > config_.maxMs) ceiling = config_.maxMs;
+    if (failures_ < UINT32_MAX) failures_++;
+    const uint32_t half = ceiling / 2;
+    return half + (half ? random() % (ceiling - half) : 0);
+  }
+
+  // Reparto uniforme en [0, limitMs): la primera conexión tras subir el WiFi
+  uint32_t jitterMs(uint32_t limitMs) { return limitMs ? random() % limitMs : 0; }
+
+  void reset() { failures_ = 0; }
+  uint32_t failures() const { return failures_; }
+
+  // FNV-1a: misma semilla para el mismo dispositivo, distinta entre dispositivos
+  static uint32_t hashSeed(const uint8_t* data, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+      hash ^= data[i];
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+
+ private:
+  // xorshift32: suficiente para repartir esperas, sin tocar el RNG del sistema
+  uint32_t random() {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 17;
+    state_ ^= state_ << 5;
+    return state_;
+  }
+
+  BackoffConfig config_;
+  uint32_t state_ = 0x9E3779B9u;
+  uint32_t failures_ = 0;
+};
+
+// =============================================================
+// === Caché de la resolución del broker ===
+// =============================================================
+// Dirección IPv4 como uint32_t (mismo orden que IPAddress). Se invalida al
+// vencer el TTL o cuando una conexión a esa dirección falla.
+class DnsCache {
+ public:
+  explicit DnsCache(uint32_t ttlMs = 3600000) : ttlMs_(ttlMs) {}
+
+  void setTtl(uint32_t ttlMs) { ttlMs_ = ttlMs; }
+
+  void store(uint32_t address, uint32_t nowMs) {
+    address_ = address;
+    storedAtMs_ = nowMs;
+    valid_ = address != 0;
+  }
+
+  bool lookup(uint32_t nowMs, uint32_t& address) const {
+    if (!valid_ || nowMs - storedAtMs_ >= ttlMs_) return false;
+    address = address_;
+    return true;
+  }
+
+  void invalidate() { valid_ = false; }
+
+ private:
+  uint32_t ttlMs_;
+  uint32_t address_ = 0;
+  uint32_t storedAtMs_ = 0;
+  bool valid_ = false;
+};
+
+// =============================================================
+// === Controlador de reconexión MQTT ===
+// =============================================================
+// Máquina de estados pura: no resuelve ni conecta, solo dice cuándo hacerlo
+// (poll() devuelve la acción) y recibe el resultado. Desde una sola tarea.
+struct ReconnectConfig {
+  BackoffConfig backoff;
+  uint32_t linkUpJitterMs = 2000;    // reparto de la primera conexión tras subir el WiFi
+  uint32_t connectTimeoutMs = 15000; // sin respuesta del broker => fallo
+  uint32_t resolveTimeoutMs = 10000;
+};
+
+struct ReconnectMetrics {
+  uint32_t attempts = 0;
+  uint32_t failures = 0;
+  uint32_t timeouts = 0;
+  uint32_t resolutions = 0;       // consultas DNS reales (no servidas por la caché)
+  uint32_t resolveFailures = 0;
+  uint32_t lastDelayMs = 0;       // última espera programada
+  uint32_t lastConnectMs = 0;     // duración del último intento con éxito
+};
+
+class ReconnectController {
+ public:
+  enum class State : uint8_t { OFFLINE = 0, WAITING, RESOLVING, CONNECTING, CONNECTED };
+  enum class Action : uint8_t { NONE = 0, RESOLVE, CONNECT, ABORT };
+
+  void configure(const ReconnectConfig& config) {
+    config_ = config;
+    backoff_.configure(config.backoff);
+  }
+  void seed(uint32_t value) { backoff_.seed(value); }
+
+  void onLinkUp(uint32_t nowMs) {
+    if (state_ != State::OFFLINE) return;
+    backoff_.reset();
+    schedule(nowMs, backoff_.jitterMs(config_.linkUpJitterMs));
+  }
+  void onLinkDown() { state_ = State::OFFLINE; }
+
+  // haveAddress: la caché DNS tiene una dirección válida
+  Action poll(uint32_t nowMs, bool haveAddress) {
+    switch (state_) {
+      case State::WAITING:
+        if ((int32_t)(nowMs - retryAtMs_) < 0) return Action::NONE;
+        startedAtMs_ = nowMs;
+        if (!haveAddress) {
+          state_ = State::RESOLVING;
+          metrics_.resolutions++;
+          return Action::RESOLVE;
+        }
+        return beginConnect(nowMs);
+      case State::RESOLVING:
+        if (nowMs - startedAtMs_ < config_.resolveTimeoutMs) return Action::NONE;
+        metrics_.resolveFailures++;
+        fail(nowMs);
+        return Action::NONE;
+      case State::CONNECTING:
+        if (nowMs - startedAtMs_ < config_.connectTimeoutMs) return Action::NONE;
+        metrics_.timeouts++;
+        fail(nowMs);
+        return Action::ABORT;
+      default:
+        return Action::NONE;
+    }
+  }
+
+  void onResolved(bool ok, uint32_t nowMs) {
+    if (state_ != State::RESOLVING) return;
+    if (!ok) {
+      metrics_.resolveFailures++;
+      fail(nowMs);
+      return;
+    }
+    // Conecta en el siguiente poll()
+    state_ = State::WAITING;
+    retryAtMs_ = nowMs;
+  }
+
+  void onConnected(uint32_t nowMs) {
+    if (state_ == State::CONNECTING) metrics_.lastConnectMs = nowMs - startedAtMs_;
+    state_ = State::CONNECTED;
+    backoff_.reset();
+  }
+
+  // Fallo del intento en curso o caída de una sesión establecida
+  void onDisconnected(uint32_t nowMs) {
+    if (state_ == State::OFFLINE || state_ == State::WAITING) return;
+    fail(nowMs);
+  }
+
+  State state() const { return state_; }
+  uint32_t retryAtMs() const { return retryAtMs_; }
+  const ReconnectMetrics& metrics() const { return metrics_; }
+
+ private:
+  Action beginConnect(uint32_t nowMs) {
+    state_ = State::CONNECTING;
+    startedAtMs_ = nowMs;
+    metrics_.attempts++;
+    return Action::CONNECT;
+  }
+
+  void fail(uint32_t nowMs) {
+    if (state_ == State::CONNECTING) metrics_.failures++;
+    schedule(nowMs, backoff_.nextDelayMs());
+  }
+
+  void schedule(uint32_t nowMs, uint32_t delayMs) {
+    metrics_.lastDelayMs = delayMs;
+    retryAtMs_ = nowMs + delayMs;
+    state_ = State::WAITING;
+  }
+
+  ReconnectConfig config_;
+  ReconnectBackoff backoff_;
+  ReconnectMetrics metrics_;
+  State state_ = State::OFFLINE;
+  uint32_t retryAtMs_ = 0;
+  uint32_t startedAtMs_ = 0;
+};
@@ -0,0 +1,153 @@
+#pragma once
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SensorData.hpp"
+
+// =============================================================
+// === Publicación por cambio (deadband) con latido ===
+// =============================================================
+// Un canal "ha cambiado" si se aleja del último valor publicado más que
+// max(absolute, relative * |último|). Se publica cuando algún canal cambia
+// (como mucho una vez cada minIntervalMs), cuando gas o viento cruzan un
+// umbral de nivel (siempre y al momento) o cuando vence el latido.
+struct Deadband {
+  float absolute = 0.0f;
+  float relative = 0.0f;  // fracción del último valor publicado (0.1 = 10 %)
+};
+
+struct ReportPolicyConfig {
+  static constexpr size_t MAX_LEVELS = 4;
+
+  // Por defecto, del orden de la resolución útil de cada sensor
+  Deadband temperatureC{1.0f, 0.0f};     // DHT11: pasos de 1 °C, un solo paso suele ser parpadeo
+  Deadband humidityPercent{2.0f, 0.0f};
+  Deadband pressureHpa{0.3f, 0.0f};
+  Deadband lightLux{5.0f, 0.10f};        // rango de 0 a decenas de miles de lx
+  Deadband windSpeedKmh{1.0f, 0.10f};
+  Deadband gasRaw{60.0f, 0.0f};
+
+  uint32_t minIntervalMs = 30000;        // separación mínima entre envíos por deadband
+  uint32_t heartbeatMs = 10UL * 60000UL; // silencio máximo
+
+  // Umbrales de nivel (ascendentes); cruzar uno publica sin esperar. La
+  // histéresis evita una ráfaga de envíos con el valor oscilando en el borde.
+  // Sin umbrales de gas, el nivel es SensorData::gasQuality, que ya llega
+  // con su propia histéresis (GasSensor.hpp).
+  float gasLevels[MAX_LEVELS] = {};
+  uint8_t gasLevelCount = 0;
+  float gasHysteresis = 30.0f;
+  float windGustLevels[MAX_LEVELS] = {};
+  uint8_t windGustLevelCount = 0;
+  float windGustHysteresis = 3.0f;
+};
+
+enum class ReportReason : uint8_t {
+  SUPPRESSED = 0,
+  FIRST,
+  HEARTBEAT,
+  THRESHOLD,
+  DEADBAND,  // no CHANGE: es una macro de Arduino
+  REQUESTED, // pedido por comando remoto
+};
+constexpr size_t REPORT_REASON_COUNT = 6;
+
+class ReportFilter {
+ public:
+  void configure(const ReportPolicyConfig& config) { config_ = config; }
+  const ReportPolicyConfig& config() const { return config_; }
+
+  // Decide si `data` se publica (siempre si `requested`). Si la respuesta
+  // no es SUPPRESSED, la lectura pasa a ser la referencia de los deadbands.
+  ReportReason check(const SensorData& data, uint32_t nowMs, bool requested = false) {
+    ReportReason reason = requested ? ReportReason::REQUESTED : decide(data, nowMs);
+    counts_[(size_t)reason]++;
+    if (reason != ReportReason::SUPPRESSED) {
+      last_ = data;
+      lastSentMs_ = nowMs;
+      hasLast_ = true;
+      gasLevel_ = gasLevel(data);
+      windLevel_ = windLevel(data);
+    }
+    return reason;
+  }
+
+  uint32_t sent() const { return total() - counts_[(size_t)ReportReason::SUPPRESSED]; }
+  uint32_t suppressed() const { return counts_[(size_t)ReportReason::SUPPRESSED]; }
+  uint32_t count(ReportReason reason) const { return counts_[(size_t)reason]; }
+  uint32_t total() const {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < REPORT_REASON_COUNT; i++) sum += counts_[i];
+    return sum;
+  }
+  void resetCounters() {
+    for (size_t i = 0; i < REPORT_REASON_COUNT; i++) counts_[i] = 0;
+  }
+
+  static const char* reasonName(ReportReason reason) {
+    switch (reason) {
+      case ReportReason::FIRST: return "first";
+      case ReportReason::HEARTBEAT: return "heartbeat";
+      case ReportReason::THRESHOLD: return "threshold";
+      case ReportReason::DEADBAND: return "deadband";
+      case ReportReason::REQUESTED: return "requested";
+      default: return "suppressed";
+    }
+  }
+
+  // Nivel de `value`; solo se abandona `current` si el valor rebasa el
+  // umbral correspondiente en más de `hysteresis`
+  static uint8_t levelOf(float value, const float* levels, uint8_t count, uint8_t current, float hysteresis) {
+    uint8_t level = 0;
+    while (level < count && value > levels[level]) level++;
+    if (level > current && value <= levels[level - 1] + hysteresis) return current;
+    if (level < current && value > levels[level] - hysteresis) return current;
+    return level;
+  }
+
+  // NaN <-> valor también es un cambio (sensor que falla o se recupera)
+  static bool exceeds(float value, float reference, const Deadband& band) {
+    if (isnan(value) || isnan(reference)) return isnan(value) != isnan(reference);
+    float limit = band.relative * fabsf(reference);
+    if (limit < band.absolute) limit = band.absolute;
+    return fabsf(value - reference) > limit;
+  }
+
+ private:
+  ReportReason decide(const SensorData& data, uint32_t nowMs) const {
+    if (!hasLast_) return ReportReason::FIRST;
+    const uint32_t silentMs = nowMs - lastSentMs_;
+
+    if (gasLevel(data) != gasLevel_ || windLevel(data) != windLevel_) return ReportReason::THRESHOLD;
+    if (silentMs >= config_.heartbeatMs) return ReportReason::HEARTBEAT;
+    if (silentMs < config_.minIntervalMs) return ReportReason::SUPPRESSED;
+
+    if (exceeds(data.temperatureC, last_.temperatureC, config_.temperatureC) ||
+        exceeds(data.humidityPercent, last_.humidityPercent, config_.humidityPercent) ||
+        exceeds(data.pressureHpa, last_.pressureHpa, config_.pressureHpa) ||
+        exceeds(data.lightLux, last_.lightLux, config_.lightLux) ||
+        exceeds(data.windSpeedKmh, last_.windSpeedKmh, config_.windSpeedKmh) ||
+        exceeds((float)data.gasRaw, (float)last_.gasRaw, config_.gasRaw)) {
+      return ReportReason::DEADBAND;
+    }
+    return ReportReason::SUPPRESSED;
+  }
+
+  uint8_t gasLevel(const SensorData& data) const {
+    if (config_.gasLevelCount == 0) return (uint8_t)data.gasQuality;
+    return levelOf((float)data.gasRaw, config_.gasLevels, config_.gasLevelCount, gasLevel_, config_.gasHysteresis);
+  }
+  uint8_t windLevel(const SensorData& data) const {
+    return levelOf(data.windGustKmh, config_.windGustLevels, config_.windGustLevelCount, windLevel_,
+                   config_.windGustHysteresis);
+  }
+
+  ReportPolicyConfig config_;
+  SensorData last_;
+  uint8_t gasLevel_ = 0;
+  uint8_t windLevel_ = 0;
+  uint32_t lastSentMs_ = 0;
+  bool hasLast_ = false;
+  uint32_t counts_[REPORT_REASON_COUNT] = {};
+};
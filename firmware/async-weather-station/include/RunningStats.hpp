@@ -0,0 +1,112 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+
+#include "SensorData.hpp"
+
+// =============================================================
+// === Estadística en línea de un canal ===
+// =============================================================
+// Algoritmo de Welford para media y varianza (estable aunque la media sea
+// grande frente a la dispersión, como la presión en hPa), más mínimo,
+// máximo y una media exponencial. Memoria O(1); las muestras NaN se ignoran.
+class RunningStats {
+ public:
+  explicit RunningStats(float ewmaAlpha = 0.2f) : alpha_(ewmaAlpha) {}
+
+  void setEwmaAlpha(float alpha) { alpha_ = alpha; }
+
+  void add(float value) {
+    if (isnan(value) || isinf(value)) return;
+    count_++;
+    const double delta = value - mean_;
+    mean_ += delta / count_;
+    m2_ += delta * (value - mean_);
+    if (count_ == 1 || value < min_) min_ = value;
+    if (count_ == 1 || value > max_) max_ = value;
+    ewma_ = isnan(ewma_) ? value : ewma_ + alpha_ * (value - ewma_);
+  }
+
+  // Empieza una ventana nueva; la media exponencial se conserva
+  void reset() {
+    count_ = 0;
+    mean_ = 0.0;
+    m2_ = 0.0;
+    min_ = NAN;
+    max_ = NAN;
+  }
+
+  uint32_t count() const { return count_; }
+  float min() const { return min_; }
+  float max() const { return max_; }
+  float mean() const { return count_ > 0 ? (float)mean_ : NAN; }
+  // Varianza muestral (n - 1); 0 con una sola muestra
+  float variance() const {
+    if (count_ == 0) return NAN;
+    return count_ > 1 ? (float)(m2_ / (count_ - 1)) : 0.0f;
+  }
+  float stddev() const { return count_ > 0 ? sqrtf(variance()) : NAN; }
+  float ewma() const { return ewma_; }
+
+  ChannelSummary summary() const {
+    ChannelSummary s;
+    s.count = count_;
+    s.min = min_;
+    s.max = max_;
+    s.mean = mean();
+    s.stddev = stddev();
+    s.ewma = ewma_;
+    return s;
+  }
+
+ private:
+  float alpha_;
+  uint32_t count_ = 0;
+  double mean_ = 0.0;
+  double m2_ = 0.0;
+  float min_ = NAN;
+  float max_ = NAN;
+  float ewma_ = NAN;
+};
+
+// =============================================================
+// === Agregados de todos los canales entre dos publicaciones ===
+// =============================================================
+// Las tareas de muestreo añaden cada muestra y la publicación toma el
+// resumen con close(), que abre la ventana siguiente.
+struct StatsWindow {
+  RunningStats temperatureC;
+  RunningStats humidityPercent;
+  RunningStats pressureHpa;
+  RunningStats lightLux;
+  RunningStats windSpeedKmh;
+  RunningStats gasRaw;
+
+  void setEwmaAlpha(float alpha) {
+    RunningStats* all[] = {&temperatureC, &humidityPercent, &pressureHpa, &lightLux, &windSpeedKmh, &gasRaw};
+    for (RunningStats* s : all) s->setEwmaAlpha(alpha);
+  }
+
+  void open(uint32_t nowMs) {
+    RunningStats* all[] = {&temperatureC, &humidityPercent, &pressureHpa, &lightLux, &windSpeedKmh, &gasRaw};
+    for (RunningStats* s : all) s->reset();
+    openedMs_ = nowMs;
+  }
+
+  SensorStats close(uint32_t nowMs) {
+    SensorStats stats;
+    stats.windowMs = nowMs - openedMs_;
+    if (stats.windowMs == 0) stats.windowMs = 1;
+    stats.temperatureC = temperatureC.summary();
+    stats.humidityPercent = humidityPercent.summary();
+    stats.pressureHpa = pressureHpa.summary();
+    stats.lightLux = lightLux.summary();
+    stats.windSpeedKmh = windSpeedKmh.summary();
+    stats.gasRaw = gasRaw.summary();
+    open(nowMs);
+    return stats;
+  }
+
+ private:
+  uint32_t openedMs_ = 0;
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+
+// =============================================================
+// === Resumen estadístico de un canal en la ventana de publicación ===
+// =============================================================
+struct ChannelSummary {
+  uint32_t count = 0;  // muestras válidas en la ventana (0 = canal sin datos)
+  float min = NAN;
+  float max = NAN;
+  float mean = NAN;
+  float stddev = NAN;
+  float ewma = NAN;    // media exponencial, continua entre ventanas
+};
+
+struct SensorStats {
+  uint32_t windowMs = 0;  // duración de la ventana (0 = sin bloque stats)
+  ChannelSummary temperatureC;
+  ChannelSummary humidityPercent;
+  ChannelSummary pressureHpa;
+  ChannelSummary lightLux;
+  ChannelSummary windSpeedKmh;  // velocidad instantánea, no la media de 30 s
+  ChannelSummary gasRaw;
+};
+
+// =============================================================
+// === Calidad del aire (MQ-2, ver GasSensor.hpp) ===
+// =============================================================
+// Niveles ascendentes; UNKNOWN mientras el sensor se calienta o calibra R0.
+enum class AirQuality : uint8_t { GOOD = 0, NORMAL, POOR, DANGEROUS, UNKNOWN };
+
+inline const char* airQualityLabel(AirQuality quality) {
+  switch (quality) {
+    case AirQuality::GOOD: return "BUENA";
+    case AirQuality::NORMAL: return "NORMAL";
+    case AirQuality::POOR: return "MALA";
+    case AirQuality::DANGEROUS: return "PELIGROSA";
+    default: return "--";
+  }
+}
+
+// =============================================================
+// === Lectura completa de la estación ===
+// =============================================================
+// Estructura plana (sin String) para poder copiarla, serializarla y
+// guardarla sin reservar memoria dinámica.
+struct SensorData {
+  int64_t timestampMs = 0;  // epoch en ms del muestreo (0 = hora aún no sincronizada)
+  uint32_t uptimeMs = 0;    // millis() del muestreo: fecha la lectura cuando llegue el NTP
+  float temperatureC = NAN;
+  float humidityPercent = NAN;
+  float pressureHpa = NAN;
+  float altitudeMeters = NAN;
+  float lightLux = NAN;
+  float windSpeedKmh = 0.0f;
+  float windSpeedMs = 0.0f;
+  float windGustKmh = 0.0f;
+  int gasRaw = 0;                                 // MQ-2 filtrado, cuentas del ADC
+  float gasPpm = NAN;                             // equivalente en C3H8 (NAN sin R0)
+  AirQuality gasQuality = AirQuality::UNKNOWN;
+  SensorStats stats;            // no se guarda en la cola persistente
+};
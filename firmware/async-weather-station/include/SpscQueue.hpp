@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Separación entre los índices del productor y del consumidor para que no
+// compartan línea de caché (en el ESP32 no hay caché de datos, pero no estorba)
+#ifndef SPSC_CACHE_LINE
+#define SPSC_CACHE_LINE 64
+#endif
+
+// =============================================================
+// === Cola lock-free genérica (1 productor / 1 consumidor) ===
+// =============================================================
+// C++ portable: solo std::atomic, sin FreeRTOS. Une la tarea de sensores
+// (productor) con la de red (consumidor) en núcleos distintos. Cada lado
+// guarda una copia del índice del otro y solo la recarga cuando la cola
+// parece llena o vacía, así que en régimen normal no hay tráfico entre
+// núcleos salvo la publicación del propio índice.
+template <typename T, size_t N>
+class SpscQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N debe ser potencia de 2");
+
+ public:
+  // Solo desde el productor. Si la cola está llena no sobrescribe nada:
+  // el consumidor es el dueño de las posiciones ocupadas.
+  bool push(const T& item) {
+    const uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head - tailCache_ >= N) {
+      tailCache_ = tail_.load(std::memory_order_acquire);
+      if (head - tailCache_ >= N) {
+        dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+      }
+    }
+    slots_[head & (N - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Solo desde el consumidor
+  bool pop(T& item) {
+    const uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == headCache_) {
+      headCache_ = head_.load(std::memory_order_acquire);
+      if (tail == headCache_) return false;
+    }
+    item = slots_[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Aproximados si se consultan desde el otro lado mientras se opera
+  size_t size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+  bool empty() const { return size() == 0; }
+  static constexpr size_t capacity() { return N; }
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  // Lado del productor
+  alignas(SPSC_CACHE_LINE) std::atomic<uint32_t> head_{0};
+  uint32_t tailCache_ = 0;
+  std::atomic<uint32_t> dropped_{0};
+  // Lado del consumidor
+  alignas(SPSC_CACHE_LINE) std::atomic<uint32_t> tail_{0};
+  uint32_t headCache_ = 0;
+  alignas(SPSC_CACHE_LINE) T slots_[N];
+};
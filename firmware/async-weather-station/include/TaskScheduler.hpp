@@ -0,0 +1,156 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// =============================================================
+// === Planificador cooperativo por plazos ===
+// =============================================================
+// Cada sensor registra su periodo, su latencia de conversión y dos pasos no
+// bloqueantes: start() lanza la medida y collect() la recoge cuando ha
+// pasado la latencia. collect() puede pedir otro paso más tarde (máquinas de
+// estados con varias conversiones) devolviendo los ms que faltan. loop() solo
+// llama a runDue(), que ejecuta lo que toca y vuelve enseguida. El reloj se
+// inyecta, así que en el host puede ser virtual.
+
+typedef uint32_t (*ClockFn)();
+typedef bool (*TaskStartFn)();  // false => no hay conversión pendiente que recoger
+typedef uint32_t (*TaskCollectFn)();  // ms hasta el siguiente paso (0 = terminado)
+
+struct SchedulerMetrics {
+  uint32_t maxLatenessMs = 0;  // retraso máximo de una tarea respecto a su plazo
+  uint32_t maxStepUs = 0;      // paso más largo (tiempo máximo bloqueando loop)
+  const char* maxStepTask = "";
+  uint32_t maxLoopGapUs = 0;   // mayor separación entre dos llamadas a runDue()
+  uint32_t meanLoopGapUs = 0;  // media móvil exponencial de esa separación
+  uint32_t steps = 0;
+};
+
+template <size_t MaxTasks>
+class TaskScheduler {
+ public:
+  TaskScheduler(ClockFn clockMs, ClockFn clockUs) : clockMs_(clockMs), clockUs_(clockUs) {}
+
+  // phaseMs desplaza la primera ejecución para no apilar tareas en el mismo instante
+  int add(const char* name, uint32_t periodMs, uint32_t latencyMs, TaskStartFn start, TaskCollectFn collect = nullptr,
+          uint32_t phaseMs = 0) {
+    if (count_ >= MaxTasks || start == nullptr) return -1;
+    Task& t = tasks_[count_];
+    t.name = name;
+    t.periodMs = periodMs;
+    t.latencyMs = latencyMs;
+    t.start = start;
+    t.collect = collect;
+    t.nextDueMs = clockMs_() + phaseMs;
+    t.converting = false;
+    return (int)count_++;
+  }
+
+  // Adelanta una tarea para que se ejecute en la próxima llamada
+  void runNow(int id) {
+    if (id >= 0 && (size_t)id < count_) tasks_[id].nextDueMs = clockMs_();
+  }
+
+  void setPeriod(int id, uint32_t periodMs) {
+    if (id >= 0 && (size_t)id < count_) tasks_[id].periodMs = periodMs;
+  }
+
+  // Ejecuta los pasos vencidos; nunca espera
+  void runDue() {
+    const uint32_t enterUs = clockUs_();
+    if (haveLastEnter_) {
+      const uint32_t gap = enterUs - lastEnterUs_;
+      if (gap > metrics_.maxLoopGapUs) metrics_.maxLoopGapUs = gap;
+      metrics_.meanLoopGapUs = metrics_.meanLoopGapUs == 0 ? gap : (metrics_.meanLoopGapUs * 7 + gap) / 8;
+    }
+    lastEnterUs_ = enterUs;
+    haveLastEnter_ = true;
+
+    for (size_t i = 0; i < count_; i++) {
+      Task& t = tasks_[i];
+      const uint32_t nowMs = clockMs_();
+      if (t.converting) {
+        if ((int32_t)(nowMs - t.collectAtMs) < 0) continue;
+        uint32_t again = 0;
+        timeStep(t, [&t, &again]() { again = t.collect(); });
+        t.converting = again > 0;
+        if (t.converting) t.collectAtMs = nowMs + again;
+        continue;
+      }
+      if ((int32_t)(nowMs - t.nextDueMs) < 0) continue;
+
+      const uint32_t lateness = nowMs - t.nextDueMs;
+      if (lateness > metrics_.maxLatenessMs) metrics_.maxLatenessMs = lateness;
+      // Plazo fijo: si vamos muy retrasados se salta al siguiente periodo futuro
+      t.nextDueMs += t.periodMs;
+      if ((int32_t)(nowMs - t.nextDueMs) >= 0) t.nextDueMs = nowMs + t.periodMs;
+
+      bool pending = false;
+      timeStep(t, [&t, &pending]() { pending = t.start(); });
+      if (pending && t.collect) {
+        t.converting = true;
+        t.collectAtMs = nowMs + t.latencyMs;
+      }
+    }
+  }
+
+  // Milisegundos hasta el siguiente plazo (útil para dormir en el host o con light-sleep)
+  uint32_t msUntilNextDue() const {
+    const uint32_t nowMs = clockMs_();
+    uint32_t best = UINT32_MAX;
+    for (size_t i = 0; i < count_; i++) {
+      const Task& t = tasks_[i];
+      const uint32_t due = t.converting ? t.collectAtMs : t.nextDueMs;
+      const int32_t wait = (int32_t)(due - nowMs);
+      const uint32_t w = wait < 0 ? 0 : (uint32_t)wait;
+      if (w < best) best = w;
+    }
+    return best;
+  }
+
+  const SchedulerMetrics& metrics() const { return metrics_; }
+  void resetMetrics() {
+    metrics_ = SchedulerMetrics();
+    haveLastEnter_ = false;
+  }
+
+  size_t size() const { return count_; }
+  const char* name(size_t i) const { return i < count_ ? tasks_[i].name : ""; }
+  uint32_t runs(size_t i) const { return i < count_ ? tasks_[i].runs : 0; }
+  uint32_t maxStepUs(size_t i) const { return i < count_ ? tasks_[i].maxStepUs : 0; }
+
+ private:
+  struct Task {
+    const char* name = "";
+    uint32_t periodMs = 0;
+    uint32_t latencyMs = 0;
+    TaskStartFn start = nullptr;
+    TaskCollectFn collect = nullptr;
+    uint32_t nextDueMs = 0;
+    uint32_t collectAtMs = 0;
+    bool converting = false;
+    uint32_t runs = 0;
+    uint32_t maxStepUs = 0;
+  };
+
+  template <typename Step>
+  void timeStep(Task& t, Step step) {
+    const uint32_t beginUs = clockUs_();
+    step();
+    const uint32_t elapsed = clockUs_() - beginUs;
+    t.runs++;
+    if (elapsed > t.maxStepUs) t.maxStepUs = elapsed;
+    if (elapsed > metrics_.maxStepUs) {
+      metrics_.maxStepUs = elapsed;
+      metrics_.maxStepTask = t.name;
+    }
+    metrics_.steps++;
+  }
+
+  ClockFn clockMs_;
+  ClockFn clockUs_;
+  Task tasks_[MaxTasks];
+  size_t count_ = 0;
+  SchedulerMetrics metrics_;
+  uint32_t lastEnterUs_ = 0;
+  bool haveLastEnter_ = false;
+};
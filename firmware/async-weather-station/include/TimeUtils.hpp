@@ -1,38 +1,79 @@
 #pragma once
 #include <WiFi.h>
+#include <sys/time.h>
 #include <time.h>
+#include "FixedString.hpp"
+#include "IsoTimestamp.hpp"
+#include "Log.hpp"
 
 // === CONFIGURACIÓN NTP PARA ZONA HORARIA DE MADRID ===
 #define NTP_SERVER "pool.ntp.org"
 #define TZ_INFO "CET-1CEST,M3.5.0/2,M10.5.0/3" // España/Madrid
 
-// === Inicializa la sincronización NTP ===
-void initTime() {
+// Formato del timestamp de los payloads (config.h)
+#ifndef TIMESTAMP_UTC
+#define TIMESTAMP_UTC 0
+#endif
+#ifndef TIMESTAMP_MILLIS
+#define TIMESTAMP_MILLIS 0
+#endif
+
+// === Formateadores ISO8601 (hora de Madrid y UTC) ===
+// Guardan el prefijo de fecha y el desfase del día en curso; solo se usan
+// desde la tarea de red.
+IsoTimestampFormatter localTimestamps(false);
+IsoTimestampFormatter utcTimestamps(true);
+
+// === Arranca la sincronización NTP sin esperar la respuesta ===
+// El cliente SNTP del sistema sigue reintentando en segundo plano; timeSynced()
+// dice cuándo ha llegado la hora.
+void startTimeSync() {
   configTime(0, 0, NTP_SERVER);
   setenv("TZ", TZ_INFO, 1);
   tzset();
+  localTimestamps.invalidate();
+  LOG_INFO("⏰ Sincronizando hora NTP en segundo plano...");
+}
+
+// === Epoch actual en milisegundos (0 si el NTP aún no ha sincronizado) ===
+int64_t currentEpochMs() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  if (tv.tv_sec < 1577836800) return 0;  // antes de 2020: hora no válida
+  return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+bool timeSynced() {
+  return currentEpochMs() != 0;
+}
 
-  Serial.println("⏰ Sincronizando hora NTP...");
-  struct tm timeinfo;
-  while (!getLocalTime(&timeinfo)) {
-    Serial.print(".");
-    delay(500);
-  }
-  Serial.println("\n✅ Hora sincronizada correctamente (zona Madrid).");
+// === Epoch de un instante de millis() de este mismo arranque ===
+// Fecha a posteriori las lecturas tomadas antes de sincronizar el NTP.
+// Devuelve 0 si la hora sigue sin sincronizar.
+int64_t epochFromUptime(uint32_t uptimeMs) {
+  const int64_t now = currentEpochMs();
+  if (now == 0) return 0;
+  return now - (int64_t)(uint32_t)(millis() - uptimeMs);
 }
 
-// === Devuelve timestamp en formato ISO8601 ===
-String getTimestampISO8601() {
-  struct tm timeinfo;
-  if (!getLocalTime(&timeinfo)) {
-    return "1970-01-01T00:00:00Z";
-  }
-
-  char buffer[30];
-  // Formato: 2025-01-01T00:00:00+01:00 (Ajuste manual del formato %z)
-  strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S%z", &timeinfo);
-  String ts(buffer);
-  // Añade el ':' separador en la zona horaria si falta
-  if (ts.length() > 22) ts = ts.substring(0, 22) + ":" + ts.substring(22);
-  return ts;
-}
\ No newline at end of file
+// === Escribe el timestamp ISO8601 de `epochMs` en un buffer del llamante ===
+// Formato: 2025-01-01T00:00:00+01:00, o 2025-01-01T00:00:00.123Z con `utc`
+// y `withMillis`. Devuelve la longitud escrita (0 si no cabe).
+size_t formatTimestampISO8601(int64_t epochMs, char* out, size_t capacity, bool utc = false, bool withMillis = false) {
+  return (utc ? utcTimestamps : localTimestamps).format(epochMs, out, capacity, withMillis);
+}
+
+size_t formatTimestampISO8601(char* out, size_t capacity) {
+  return formatTimestampISO8601(currentEpochMs(), out, capacity);
+}
+
+// === Devuelve timestamp en formato ISO8601 (sin heap) ===
+typedef FixedString<IsoTimestampFormatter::MAX_LEN> TimestampText;
+
+TimestampText getTimestampISO8601() {
+  char buffer[IsoTimestampFormatter::MAX_LEN + 1];
+  const size_t len = formatTimestampISO8601(buffer, sizeof(buffer));
+  TimestampText text;
+  text.append(buffer, len);
+  return text;
+}
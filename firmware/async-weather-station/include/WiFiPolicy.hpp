@@ -0,0 +1,260 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// =============================================================
+// === Último enlace WiFi bueno (se guarda en NVS) ===
+// =============================================================
+// Direcciones IPv4 como uint32_t, en el mismo orden que IPAddress
+struct WiFiLease {
+  uint32_t ip = 0;
+  uint32_t gateway = 0;
+  uint32_t subnet = 0;
+  uint32_t dns = 0;
+
+  bool valid() const { return ip != 0 && subnet != 0; }
+};
+
+struct WiFiLinkCache {
+  static constexpr uint32_t MAGIC = 0x57464331;  // "WFC1"
+
+  uint32_t magic = 0;
+  uint8_t bssid[6] = {};
+  uint8_t channel = 0;
+  uint8_t reserved = 0;
+  WiFiLease lease;
+
+  bool valid() const { return magic == MAGIC && channel >= 1 && channel <= 14; }
+  bool sameAs(const WiFiLinkCache& other) const { return memcmp(this, &other, sizeof(*this)) == 0; }
+};
+static_assert(sizeof(WiFiLinkCache) == 28, "WiFiLinkCache se compara y guarda byte a byte: sin relleno");
+
+// =============================================================
+// === Radio ===
+// =============================================================
+// DIRECT va al BSSID y canal guardados sin escanear; SCAN es la conexión
+// normal por SSID. El direccionamiento es independiente del tipo de intento.
+enum class WiFiAttemptKind : uint8_t { DIRECT = 0, SCAN };
+enum class WiFiAddressing : uint8_t { DHCP = 0, STATIC_CONFIG, CACHED_LEASE };
+
+struct WiFiAttemptPlan {
+  WiFiAttemptKind kind = WiFiAttemptKind::SCAN;
+  WiFiAddressing addressing = WiFiAddressing::DHCP;
+  uint8_t bssid[6] = {};
+  uint8_t channel = 0;
+  WiFiLease lease;  // solo con CACHED_LEASE
+};
+
+// En el ESP32 envuelve a WiFi; en el host, una radio simulada
+class WiFiRadio {
+ public:
+  virtual ~WiFiRadio() {}
+  virtual void connect(const WiFiAttemptPlan& plan) = 0;
+  virtual void disconnect() = 0;
+};
+
+// =============================================================
+// === Política de conexión ===
+// =============================================================
+struct WiFiPolicyConfig {
+  bool fastReconnect = true;      // intentar primero el BSSID/canal guardados
+  bool reuseLease = false;        // con DIRECT, reutilizar la última concesión DHCP (sin caducidad)
+  bool staticConfig = false;      // usar la IP fija de config.h en todos los intentos
+  uint32_t directTimeoutMs = 4000;
+  uint32_t scanTimeoutMs = 15000;
+  uint8_t directAttempts = 1;     // intentos dirigidos fallidos antes de escanear
+  uint32_t backoffMinMs = 1000;   // espera tras un escaneo fallido, se duplica
+  uint32_t backoffMaxMs = 60000;
+};
+
+struct WiFiConnectMetrics {
+  uint32_t attempts = 0;
+  uint32_t successes = 0;
+  uint32_t failures = 0;          // incluye los timeouts
+  uint32_t timeouts = 0;
+  uint32_t directSuccesses = 0;
+  uint32_t scanSuccesses = 0;
+  uint32_t lastLatencyMs = 0;     // del inicio del intento a tener IP
+  uint32_t bestLatencyMs = 0;
+  uint32_t worstLatencyMs = 0;
+  uint64_t totalLatencyMs = 0;
+  WiFiAttemptKind lastKind = WiFiAttemptKind::SCAN;
+  WiFiAddressing lastAddressing = WiFiAddressing::DHCP;
+
+  uint32_t meanLatencyMs() const { return successes ? (uint32_t)(totalLatencyMs / successes) : 0; }
+};
+
+enum class WiFiPolicyState : uint8_t { IDLE = 0, CONNECTING, CONNECTED, BACKOFF };
+
+// Máquina de estados pura: recibe los eventos de la radio y el reloj, y
+// decide qué intento lanzar. No toca WiFi ni NVS, así que se prueba en el
+// host con una radio falsa. Desde una sola tarea.
+class WiFiPolicy {
+ public:
+  // Desconexión pedida por nosotros (WIFI_REASON_ASSOC_LEAVE): no es un fallo
+  static constexpr uint8_t REASON_ASSOC_LEAVE = 8;
+
+  explicit WiFiPolicy(WiFiRadio* radio) : radio_(radio) {}
+
+  void configure(const WiFiPolicyConfig& config) { config_ = config; }
+  const WiFiPolicyConfig& config() const { return config_; }
+
+  void loadCache(const WiFiLinkCache& cache) {
+    if (cache.valid()) cache_ = cache;
+  }
+  const WiFiLinkCache& cache() const { return cache_; }
+
+  void start(uint32_t nowMs) {
+    directFailures_ = 0;
+    scanFailures_ = 0;
+    attempt(nowMs);
+  }
+
+  // Asociado al AP, aún sin IP: BSSID y canal reales del enlace
+  void onAssociated(const uint8_t bssid[6], uint8_t channel) {
+    memcpy(linkBssid_, bssid, sizeof(linkBssid_));
+    linkChannel_ = channel;
+  }
+
+  void onGotIp(const WiFiLease& lease, uint32_t nowMs) {
+    if (state_ != WiFiPolicyState::CONNECTING && state_ != WiFiPolicyState::BACKOFF) return;
+    const uint32_t latency = nowMs - attemptStartMs_;
+    metrics_.successes++;
+    metrics_.lastLatencyMs = latency;
+    metrics_.totalLatencyMs += latency;
+    if (metrics_.successes == 1 || latency < metrics_.bestLatencyMs) metrics_.bestLatencyMs = latency;
+    if (latency > metrics_.worstLatencyMs) metrics_.worstLatencyMs = latency;
+    if (plan_.kind == WiFiAttemptKind::DIRECT) {
+      metrics_.directSuccesses++;
+    } else {
+      metrics_.scanSuccesses++;
+    }
+
+    WiFiLinkCache next = cache_;
+    next.magic = WiFiLinkCache::MAGIC;
+    if (linkChannel_ != 0) {
+      memcpy(next.bssid, linkBssid_, sizeof(next.bssid));
+      next.channel = linkChannel_;
+    }
+    // Solo una concesión obtenida por DHCP merece guardarse
+    if (plan_.addressing == WiFiAddressing::DHCP && lease.valid()) next.lease = lease;
+    if (next.valid() && !next.sameAs(cache_)) {
+      cache_ = next;
+      cacheDirty_ = true;
+    }
+
+    state_ = WiFiPolicyState::CONNECTED;
+    directFailures_ = 0;
+    scanFailures_ = 0;
+  }
+
+  void onDisconnected(uint8_t reason, uint32_t nowMs) {
+    if (reason == REASON_ASSOC_LEAVE) return;
+    if (state_ == WiFiPolicyState::CONNECTED) {
+      // Enlace perdido: reconexión inmediata, empezando por la vía rápida
+      directFailures_ = 0;
+      scanFailures_ = 0;
+      attempt(nowMs);
+    } else if (state_ == WiFiPolicyState::CONNECTING) {
+      attemptFailed(nowMs);
+    }
+  }
+
+  // Llamada periódica: timeouts de intento y fin de la espera
+  void poll(uint32_t nowMs) {
+    if (state_ == WiFiPolicyState::CONNECTING) {
+      const uint32_t timeout =
+          plan_.kind == WiFiAttemptKind::DIRECT ? config_.directTimeoutMs : config_.scanTimeoutMs;
+      if (nowMs - attemptStartMs_ >= timeout) {
+        metrics_.timeouts++;
+        attemptFailed(nowMs);
+      }
+    } else if (state_ == WiFiPolicyState::BACKOFF && (int32_t)(nowMs - retryAtMs_) >= 0) {
+      attempt(nowMs);
+    }
+  }
+
+  // true (una vez) si hay un enlace nuevo que guardar en NVS
+  bool takeCacheUpdate(WiFiLinkCache& out) {
+    if (!cacheDirty_) return false;
+    cacheDirty_ = false;
+    out = cache_;
+    return true;
+  }
+
+  WiFiPolicyState state() const { return state_; }
+  const WiFiAttemptPlan& plan() const { return plan_; }
+  const WiFiConnectMetrics& metrics() const { return metrics_; }
+
+  static const char* kindName(WiFiAttemptKind kind) { return kind == WiFiAttemptKind::DIRECT ? "direct" : "scan"; }
+  static const char* addressingName(WiFiAddressing addressing) {
+    switch (addressing) {
+      case WiFiAddressing::STATIC_CONFIG: return "static";
+      case WiFiAddressing::CACHED_LEASE: return "lease";
+      default: return "dhcp";
+    }
+  }
+
+ private:
+  WiFiAttemptPlan nextPlan() const {
+    WiFiAttemptPlan plan;
+    if (config_.fastReconnect && cache_.valid() && directFailures_ < config_.directAttempts) {
+      plan.kind = WiFiAttemptKind::DIRECT;
+      memcpy(plan.bssid, cache_.bssid, sizeof(plan.bssid));
+      plan.channel = cache_.channel;
+    }
+    if (config_.staticConfig) {
+      plan.addressing = WiFiAddressing::STATIC_CONFIG;
+    } else if (plan.kind == WiFiAttemptKind::DIRECT && config_.reuseLease && cache_.lease.valid()) {
+      plan.addressing = WiFiAddressing::CACHED_LEASE;
+      plan.lease = cache_.lease;
+    }
+    return plan;
+  }
+
+  void attempt(uint32_t nowMs) {
+    plan_ = nextPlan();
+    linkChannel_ = 0;
+    attemptStartMs_ = nowMs;
+    state_ = WiFiPolicyState::CONNECTING;
+    metrics_.attempts++;
+    metrics_.lastKind = plan_.kind;
+    metrics_.lastAddressing = plan_.addressing;
+    if (radio_) radio_->connect(plan_);
+  }
+
+  // Un intento dirigido fallido pasa enseguida al escaneo; un escaneo
+  // fallido espera (1 s, 2 s, 4 s... hasta backoffMaxMs) y vuelve a empezar
+  // por la vía rápida, por si el AP solo se había reiniciado.
+  void attemptFailed(uint32_t nowMs) {
+    metrics_.failures++;
+    if (radio_) radio_->disconnect();
+    if (plan_.kind == WiFiAttemptKind::DIRECT) {
+      directFailures_++;
+      attempt(nowMs);
+      return;
+    }
+    uint32_t backoff = config_.backoffMinMs;
+    for (uint8_t i = 1; i < scanFailures_ + 1 && backoff < config_.backoffMaxMs; i++) backoff *= 2;
+    if (backoff > config_.backoffMaxMs) backoff = config_.backoffMaxMs;
+    if (scanFailures_ < 255) scanFailures_++;
+    directFailures_ = 0;
+    retryAtMs_ = nowMs + backoff;
+    state_ = WiFiPolicyState::BACKOFF;
+  }
+
+  WiFiRadio* radio_;
+  WiFiPolicyConfig config_;
+  WiFiLinkCache cache_;
+  WiFiAttemptPlan plan_;
+  WiFiConnectMetrics metrics_;
+  WiFiPolicyState state_ = WiFiPolicyState::IDLE;
+  uint8_t linkBssid_[6] = {};
+  uint8_t linkChannel_ = 0;
+  uint8_t directFailures_ = 0;
+  uint8_t scanFailures_ = 0;
+  uint32_t attemptStartMs_ = 0;
+  uint32_t retryAtMs_ = 0;
+  bool cacheDirty_ = false;
+};
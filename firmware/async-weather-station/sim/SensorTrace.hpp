@@ -0,0 +1,176 @@
+#pragma once
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// =============================================================
+// === Traza de sensores para la simulación ===
+// =============================================================
+// CSV con cabecera; solo "t_s" es obligatoria y el resto de columnas, en
+// cualquier orden, son opcionales (sin columna, valor por defecto del HAL):
+//
+//   t_s,temperature_c,humidity_pct,pressure_hpa,light_lux,wind_kmh,gas_raw,rssi_dbm,wifi,broker
+//   0,14.2,71,1016.3,0,3.5,410,-61,1,1
+//   3600,13.8,,1016.1,0,4.0,415,-63,1,0
+//
+// Las magnitudes se interpolan linealmente entre filas. Una celda vacía es
+// un fallo del sensor desde esa fila hasta la siguiente con dato. "wifi" y
+// "broker" (0/1) son escalones: valen lo de la última fila. Las líneas que
+// empiezan por '#' son comentarios.
+class SensorTrace {
+ public:
+  enum Column { TEMPERATURE = 0, HUMIDITY, PRESSURE, LIGHT, WIND, GAS, RSSI, WIFI, BROKER, COLUMN_COUNT };
+
+  static const char* columnName(Column c) {
+    static const char* const NAMES[COLUMN_COUNT] = {"temperature_c", "humidity_pct", "pressure_hpa",
+                                                    "light_lux",     "wind_kmh",     "gas_raw",
+                                                    "rssi_dbm",      "wifi",         "broker"};
+    return NAMES[c];
+  }
+
+  // Devuelve false y deja el motivo en `error`
+  bool load(const char* path, std::string& error) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+      error = std::string("no se puede abrir ") + path;
+      return false;
+    }
+    rows_.clear();
+    std::vector<int> map;  // columna del CSV -> Column (-1 = t_s, -2 = ignorada)
+    char line[1024];
+    size_t lineNo = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file)) {
+      lineNo++;
+      line[strcspn(line, "\r\n")] = '\0';
+      if (line[0] == '\0' || line[0] == '#') continue;
+      std::vector<std::string> cells = split(line);
+      if (map.empty()) {
+        ok = parseHeader(cells, map, error);
+        continue;
+      }
+      Row row;
+      for (size_t i = 0; i < cells.size() && i < map.size(); i++) {
+        const float value = cells[i].empty() ? NAN : strtof(cells[i].c_str(), nullptr);
+        if (map[i] == -1) row.t = value;
+        else if (map[i] >= 0) row.values[map[i]] = value;
+      }
+      if (isnan(row.t) || (!rows_.empty() && row.t < rows_.back().t)) {
+        error = "línea " + std::to_string(lineNo) + ": t_s vacío o no creciente";
+        ok = false;
+      }
+      rows_.push_back(row);
+    }
+    fclose(file);
+    if (ok && rows_.empty()) {
+      error = "la traza no tiene filas";
+      ok = false;
+    }
+    return ok;
+  }
+
+  bool empty() const { return rows_.empty(); }
+  bool has(Column c) const { return present_[c]; }
+  double durationS() const { return rows_.empty() ? 0.0 : rows_.back().t; }
+
+  // Con repeat, la traza se repite con periodo durationS()
+  void setRepeat(bool repeat) { repeat_ = repeat && durationS() > 0.0; }
+
+  float value(Column c, double t) const {
+    if (rows_.empty()) return NAN;
+    t = wrap(t);
+    const size_t i = rowAt(t);
+    const Row& a = rows_[i];
+    if (isnan(a.values[c]) || i + 1 >= rows_.size() || c == WIFI || c == BROKER) return a.values[c];
+    const Row& b = rows_[i + 1];
+    if (isnan(b.values[c]) || b.t <= a.t) return a.values[c];
+    const double k = (t - a.t) / (b.t - a.t);
+    return (float)(a.values[c] + (b.values[c] - a.values[c]) * k);
+  }
+
+  bool flag(Column c, double t) const {
+    const float v = value(c, t);
+    return isnan(v) || v != 0.0f;
+  }
+
+  // Primer instante > t en que cambia un escalón (INFINITY si no cambia más)
+  double nextChange(Column c, double t) const {
+    if (rows_.empty() || !has(c)) return INFINITY;
+    const double base = repeat_ ? floor(t / durationS()) * durationS() : 0.0;
+    const bool current = flag(c, t);
+    for (int lap = 0; lap < (repeat_ ? 2 : 1); lap++) {
+      const double offset = base + lap * durationS();
+      for (const Row& row : rows_) {
+        const double at = offset + row.t;
+        if (at <= t) continue;
+        if (repeat_ && row.t >= durationS()) continue;  // la última fila es la primera de la vuelta siguiente
+        if ((isnan(row.values[c]) || row.values[c] != 0.0f) != current) return at;
+      }
+    }
+    return INFINITY;
+  }
+
+ private:
+  struct Row {
+    double t = NAN;
+    float values[COLUMN_COUNT] = {NAN, NAN, NAN, NAN, NAN, NAN, NAN, NAN, NAN};
+  };
+
+  static std::vector<std::string> split(const char* line) {
+    std::vector<std::string> cells;
+    const char* start = line;
+    for (const char* p = line;; p++) {
+      if (*p == ',' || *p == '\0') {
+        std::string cell(start, (size_t)(p - start));
+        const size_t first = cell.find_first_not_of(" \t");
+        const size_t last = cell.find_last_not_of(" \t");
+        cells.push_back(first == std::string::npos ? std::string() : cell.substr(first, last - first + 1));
+        if (*p == '\0') break;
+        start = p + 1;
+      }
+    }
+    return cells;
+  }
+
+  bool parseHeader(const std::vector<std::string>& cells, std::vector<int>& map, std::string& error) {
+    bool haveTime = false;
+    for (const std::string& cell : cells) {
+      int column = -2;
+      if (cell == "t_s") {
+        column = -1;
+        haveTime = true;
+      }
+      for (int c = 0; c < COLUMN_COUNT; c++) {
+        if (cell == columnName((Column)c)) {
+          column = c;
+          present_[c] = true;
+        }
+      }
+      if (column == -2) fprintf(stderr, "traza: columna desconocida '%s' (se ignora)\n", cell.c_str());
+      map.push_back(column);
+    }
+    if (!haveTime) error = "la cabecera no tiene t_s";
+    return haveTime;
+  }
+
+  double wrap(double t) const {
+    if (!repeat_) return t;
+    const double d = durationS();
+    return t - floor(t / d) * d;
+  }
+
+  // Última fila con t <= `t` (la primera si `t` es anterior)
+  size_t rowAt(double t) const {
+    auto it = std::upper_bound(rows_.begin(), rows_.end(), t, [](double v, const Row& r) { return v < r.t; });
+    return it == rows_.begin() ? 0 : (size_t)(it - rows_.begin()) - 1;
+  }
+
+  std::vector<Row> rows_;
+  bool present_[COLUMN_COUNT] = {};
+  bool repeat_ = false;
+};
@@ -0,0 +1,209 @@
+// =============================================================
+// === Motor del anemómetro (Anemometer.hpp) ===
+// =============================================================
+// Trenes de pulsos sintéticos con sus instantes en µs, como los daría la
+// ISR, y update() cada 250 ms como la tarea de sensores:
+// 1) Viento constante: media, racha y velocidad por intervalo coinciden con
+//    la frecuencia generada; igual cruzando el desborde de micros().
+// 2) Rebotes a 1 ms de cada pulso: el antirrebote los descarta.
+// 3) Ráfaga de 3 s dentro de una ventana en calma: la racha es la de la
+//    ráfaga y la media la de toda la ventana.
+// 4) Tras dejar de girar, la velocidad por intervalo baja y a los
+//    staleTimeoutMs pasa a 0; la media se vacía al salir de la ventana.
+// 5) Cola de la ISR: llena sin consumidor cuenta los descartados, y con un
+//    productor y un consumidor en hilos distintos no se pierde ni se
+//    desordena nada.
+//
+//   g++ -std=c++17 -O2 -pthread -I.. anemometer_check.cpp -o anemometer_check
+//   ./anemometer_check   (termina con código 1 si algo falla)
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "include/Anemometer.hpp"
+
+namespace {
+
+uint32_t failures = 0;
+
+#define EXPECT(cond, ...)                             \
+  do {                                                \
+    if (!(cond)) {                                    \
+      if (failures++ < 20) {                          \
+        printf("  FALLO %s:%d ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__);                          \
+        printf("\n");                                 \
+      }                                               \
+    }                                                 \
+  } while (0)
+
+bool near(float a, float b, float tolerance) { return fabsf(a - b) <= tolerance; }
+
+constexpr uint32_t UPDATE_US = 250000;
+
+// Entrega los pulsos en orden a onPulse() con update() cada UPDATE_US hasta
+// untilUs (relativo a startUs; la aritmética es módulo 2^32 como micros())
+void feed(AnemometerEngine& engine, uint32_t startUs, const std::vector<uint32_t>& pulses, uint32_t untilUs) {
+  size_t next = 0;
+  for (uint32_t t = UPDATE_US; t <= untilUs; t += UPDATE_US) {
+    while (next < pulses.size() && pulses[next] <= t) engine.onPulse(startUs + pulses[next++]);
+    engine.update(startUs + t);
+  }
+}
+
+// Pulsos cada periodUs en [fromUs, toUs)
+void train(std::vector<uint32_t>& pulses, uint32_t fromUs, uint32_t toUs, uint32_t periodUs) {
+  for (uint32_t t = fromUs; t < toUs; t += periodUs) pulses.push_back(t);
+}
+
+// === 1) Viento constante ===
+void checkSteady(uint32_t startUs) {
+  AnemometerEngine engine;
+  engine.reset(startUs);
+  const AnemometerConfig& c = engine.config();
+  std::vector<uint32_t> pulses;
+  train(pulses, 50000, 40000000, 100000);  // 10 Hz durante 40 s
+  feed(engine, startUs, pulses, 40000000);
+  const WindReading r = engine.read();
+  const float expected = 10.0f * c.kmhPerHz;
+  EXPECT(r.pulses == 300, "pulsos en la ventana %u (inicio %u)", (unsigned)r.pulses, (unsigned)startUs);
+  EXPECT(near(r.meanKmh, expected, 0.01f), "media %.3f, esperada %.3f", r.meanKmh, expected);
+  EXPECT(near(r.gustKmh, expected, 0.01f), "racha %.3f, esperada %.3f", r.gustKmh, expected);
+  EXPECT(near(r.intervalKmh, expected, 0.01f), "intervalo %.3f, esperado %.3f", r.intervalKmh, expected);
+  EXPECT(engine.droppedPulses() == 0, "descartados %u", (unsigned)engine.droppedPulses());
+}
+
+// === 2) Rebotes ===
+void checkDebounce() {
+  AnemometerEngine clean;
+  AnemometerEngine bouncy;
+  std::vector<uint32_t> pulses;
+  std::vector<uint32_t> bounced;
+  train(pulses, 50000, 40000000, 200000);  // 5 Hz
+  for (uint32_t t : pulses) {
+    bounced.push_back(t);
+    bounced.push_back(t + 1000);  // dentro de debounceUs
+    bounced.push_back(t + 3000);
+  }
+  feed(clean, 0, pulses, 40000000);
+  feed(bouncy, 0, bounced, 40000000);
+  const WindReading a = clean.read();
+  const WindReading b = bouncy.read();
+  EXPECT(a.pulses == b.pulses && a.meanKmh == b.meanKmh && a.intervalKmh == b.intervalKmh,
+         "con rebotes: %u pulsos %.3f km/h, sin ellos %u %.3f", (unsigned)b.pulses, b.meanKmh, (unsigned)a.pulses,
+         a.meanKmh);
+
+  // Un pulso real justo por encima del antirrebote sí cuenta
+  AnemometerEngine fast;
+  std::vector<uint32_t> limit;
+  train(limit, 50000, 20050000, fast.config().debounceUs + 1);
+  feed(fast, 0, limit, 20000000);
+  EXPECT(fast.droppedPulses() == 0 && fast.read().pulses > 3000, "pulsos al límite del antirrebote: %u",
+         (unsigned)fast.read().pulses);
+}
+
+// === 3) Racha ===
+void checkGust() {
+  AnemometerEngine engine;
+  const AnemometerConfig& c = engine.config();
+  std::vector<uint32_t> pulses;
+  // 2 Hz de fondo, 20 Hz entre 20 s y 23 s (alineado con los intervalos)
+  train(pulses, 10000, 20000000, 500000);
+  train(pulses, 20025000, 23000000, 50000);
+  train(pulses, 23010000, 40000000, 500000);
+  feed(engine, 0, pulses, 40000000);
+  const WindReading r = engine.read();
+  const float gust = 20.0f * c.kmhPerHz;
+  EXPECT(near(r.gustKmh, gust, 0.01f), "racha %.3f, esperada %.3f", r.gustKmh, gust);
+  const float mean = (float)r.pulses / 30.0f * c.kmhPerHz;
+  EXPECT(r.pulses == 60 + 54 && near(r.meanKmh, mean, 0.01f), "media %.3f con %u pulsos", r.meanKmh,
+         (unsigned)r.pulses);
+  EXPECT(r.meanKmh < r.gustKmh / 3.0f, "la ráfaga no domina la media (%.3f)", r.meanKmh);
+
+  // Con la ráfaga fuera de la ventana la racha vuelve al fondo
+  std::vector<uint32_t> tail;
+  train(tail, 40010000, 80000000, 500000);
+  std::vector<uint32_t> all = pulses;
+  all.insert(all.end(), tail.begin(), tail.end());
+  AnemometerEngine later;
+  feed(later, 0, all, 80000000);
+  EXPECT(near(later.read().gustKmh, 2.0f * c.kmhPerHz, 0.01f), "racha pasada la ventana %.3f",
+         later.read().gustKmh);
+}
+
+// === 4) Parada ===
+void checkStop() {
+  AnemometerEngine engine;
+  const AnemometerConfig& c = engine.config();
+  std::vector<uint32_t> pulses;
+  train(pulses, 50000, 30000000, 100000);  // 10 Hz hasta 30 s; último pulso en 29,95 s
+  feed(engine, 0, pulses, 30000000);
+  EXPECT(near(engine.read().intervalKmh, 10.0f * c.kmhPerHz, 0.01f), "intervalo girando %.3f",
+         engine.read().intervalKmh);
+
+  engine.update(30950000);  // 1 s sin pulsos: no puede ir a más de 1 Hz
+  EXPECT(near(engine.read().intervalKmh, c.kmhPerHz, 0.01f), "intervalo a 1 s del último pulso %.3f",
+         engine.read().intervalKmh);
+
+  engine.update(29950000 + c.staleTimeoutMs * 1000 + 1000);
+  EXPECT(engine.read().intervalKmh == 0.0f, "intervalo tras staleTimeoutMs %.3f", engine.read().intervalKmh);
+
+  for (uint32_t t = 35000000; t <= 61000000; t += UPDATE_US) engine.update(t);
+  const WindReading r = engine.read();
+  EXPECT(r.pulses == 0 && r.meanKmh == 0.0f && r.gustKmh == 0.0f, "ventana vacía: %u pulsos %.3f km/h",
+         (unsigned)r.pulses, r.meanKmh);
+}
+
+// === 5) Cola de la ISR ===
+void checkRing() {
+  AnemometerEngine engine;
+  for (uint32_t i = 0; i < 100; i++) engine.onPulse(10000 * (i + 1));  // sin update(): 64 caben
+  EXPECT(engine.droppedPulses() == 36, "descartados con la cola llena %u", (unsigned)engine.droppedPulses());
+  engine.update(1250000);
+  engine.update(1500000);
+  EXPECT(engine.read().pulses == 64, "pulsos tras vaciar %u", (unsigned)engine.read().pulses);
+
+  PulseRing<64> ring;
+  constexpr uint32_t COUNT = 2000000;
+  std::atomic<bool> ordered{true};
+  std::thread consumer([&]() {
+    uint32_t expected = 0;
+    uint32_t value;
+    while (expected < COUNT) {
+      if (!ring.pop(value)) {
+        std::this_thread::yield();  // con un solo núcleo el productor necesita correr
+        continue;
+      }
+      if (value != expected) ordered = false;
+      expected++;
+    }
+  });
+  for (uint32_t i = 0; i < COUNT;) {
+    if (ring.push(i)) {
+      i++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  consumer.join();
+  uint32_t extra;
+  EXPECT(ordered && !ring.pop(extra), "orden entre hilos");
+  printf("cola: %u valores entre dos hilos, %u rechazados por llena\n", (unsigned)COUNT, (unsigned)ring.dropped());
+}
+
+}  // namespace
+
+int main() {
+  checkSteady(0);
+  checkSteady(0xFFFFFFFFu - 15000000u);  // micros() se desborda a mitad de la ventana
+  checkDebounce();
+  checkGust();
+  checkStop();
+  checkRing();
+  printf("%s (%u fallos)\n", failures ? "FALLOS" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,234 @@
+// =============================================================
+// === Ida y vuelta de los lotes (BatchPayload.hpp) ===
+// =============================================================
+// writeBatchPayload() -> expandBatchPayload() -> un json/json-general por
+// fila, comparado byte a byte con el que saldría de writeSensorPayload()
+// para la misma lectura publicada sola:
+// 1) Lotes de 1 a rowLimit() filas con valores aleatorios, canales sin dato
+//    (null), temperaturas negativas y filas que cruzan la medianoche UTC.
+// 2) Valores en el límite de cada campo: el lote cabe en
+//    batchPayloadMaxLen(), y con un byte menos del necesario devuelve 0.
+// 3) Columnas en otro orden y una desconocida: la expansión no cambia.
+// 4) Mensajes truncados en cada byte: -1, nunca un registro de más.
+// 5) JsonCursor::string() deshace todos los escapes de JsonWriter::string()
+//    (controles, comillas, barras) y los \uXXXX del plano básico.
+// batch_gas_check es este mismo programa con PAYLOAD_GAS_PPM: la columna
+// gas_ppm hace la ida y vuelta igual que el resto.
+//
+//   g++ -std=c++17 -O2 -I.. batch_check.cpp -o batch_check
+//   ./batch_check   (termina con código 1 si algo falla)
+//   ./build/batch_gas_check   (el mismo con -DPAYLOAD_GAS_PPM=1)
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "include/BatchPayload.hpp"
+#include "include/IsoTimestamp.hpp"
+
+namespace {
+
+uint32_t failures = 0;
+
+#define EXPECT(cond, ...)                             \
+  do {                                                \
+    if (!(cond)) {                                    \
+      if (failures++ < 20) {                          \
+        printf("  FALLO %s:%d ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__);                          \
+        printf("\n");                                 \
+      }                                               \
+    }                                                 \
+  } while (0)
+
+constexpr size_t MAX_ROWS = 64;
+
+// El registro que publicaría la estación para esta lectura sola (mismo
+// formato de hora que la expansión: UTC con milisegundos)
+std::string singlePayload(const StoredReading& r) {
+  IsoTimestampFormatter utc(true);
+  char timestamp[TIMESTAMP_MAX_LEN];
+  utc.format(r.timestampMs, timestamp, sizeof(timestamp), true);
+  char out[SENSOR_PAYLOAD_MAX_LEN + 1];
+  const size_t len = writeSensorPayload(r.toSensorData(), timestamp, out, sizeof(out));
+  return std::string(out, len);
+}
+
+std::vector<std::string> expand(const char* json, size_t len, int* result = nullptr) {
+  std::vector<std::string> records;
+  char scratch[SENSOR_PAYLOAD_MAX_LEN + 1];
+  const int n = expandBatchPayload(json, len, scratch, sizeof(scratch),
+                                   [&](const char* record, size_t recordLen) { records.emplace_back(record, recordLen); });
+  if (result) *result = n;
+  return records;
+}
+
+// Compara la expansión de `rows` con sus publicaciones individuales
+bool roundTrip(const std::vector<StoredReading>& rows, size_t* batchLen = nullptr) {
+  static char batch[batchPayloadMaxLen(MAX_ROWS) + 1];
+  const size_t len = writeBatchPayload(rows.data(), rows.size(), batch, sizeof(batch));
+  if (batchLen) *batchLen = len;
+  if (len == 0) return false;
+  int n = 0;
+  const std::vector<std::string> records = expand(batch, len, &n);
+  if (n != (int)rows.size() || records.size() != rows.size()) {
+    printf("    %d registros de %zu filas\n", n, rows.size());
+    return false;
+  }
+  for (size_t i = 0; i < rows.size(); i++) {
+    const std::string expected = singlePayload(rows[i]);
+    if (records[i] != expected) {
+      printf("    fila %zu:\n      lote  %s\n      suelta %s\n", i, records[i].c_str(), expected.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+StoredReading randomReading(std::mt19937& rng, int64_t timestampMs) {
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  auto maybe = [&](float v) { return unit(rng) < 0.1f ? NAN : v; };  // canal sin dato
+  StoredReading r;
+  r.timestampMs = timestampMs;
+  r.temperatureC = maybe(-15.0f + 60.0f * unit(rng));
+  r.humidityPercent = maybe(100.0f * unit(rng));
+  r.pressureHpa = maybe(950.0f + 100.0f * unit(rng));
+  r.altitudeMeters = maybe(-50.0f + 900.0f * unit(rng));
+  r.lightLux = maybe(65000.0f * unit(rng) * unit(rng));
+  r.windSpeedKmh = 80.0f * unit(rng) * unit(rng);
+  r.gasRaw = (int32_t)(4095.0f * unit(rng));
+  r.gasPpm = unit(rng) < 0.2f ? NAN : 10000.0f * unit(rng) * unit(rng);  // NaN: MQ-2 calibrando
+  return r;
+}
+
+// === 1) Lotes aleatorios ===
+void checkRandom() {
+  std::mt19937 rng(20250101);
+  const size_t limit = BatchPolicy().rowLimit();
+  size_t checked = 0;
+  size_t bytes = 0;
+  size_t singleBytes = 0;
+  // 23:58 UTC: las filas de 30 s cruzan la medianoche a mitad del lote
+  int64_t t = 1735775880000LL;
+  for (int round = 0; round < 400; round++) {
+    const size_t rows = 1 + round % limit;
+    std::vector<StoredReading> batch;
+    for (size_t i = 0; i < rows; i++) {
+      batch.push_back(randomReading(rng, t));
+      singleBytes += singlePayload(batch.back()).size();
+      t += 30000 + (int64_t)(rng() % 1000);
+    }
+    size_t len = 0;
+    EXPECT(roundTrip(batch, &len), "lote %d de %zu filas", round, rows);
+    bytes += len;
+    checked += rows;
+  }
+  printf("ida y vuelta: %zu lecturas en lotes de 1 a %zu, %zu B frente a %zu B sueltas (%.0f %%)\n", checked, limit,
+         bytes, singleBytes, 100.0 * (double)bytes / (double)singleBytes);
+}
+
+// === 2) Valores extremos y cota del buffer ===
+void checkBounds() {
+  std::vector<StoredReading> rows;
+  const float extremes[] = {-1.0e9f, 1.0e9f, -0.0f, 0.0049f, -273.15f, NAN};
+  for (float v : extremes) {
+    StoredReading r;
+    r.timestampMs = v > 0 ? 4102444799999LL : 0;  // 2099-12-31T23:59:59.999 o sin hora
+    r.temperatureC = r.humidityPercent = r.pressureHpa = r.altitudeMeters = r.lightLux = v;
+    r.windSpeedKmh = isnan(v) ? 0.0f : v;
+    r.gasRaw = v < 0 ? INT32_MIN : INT32_MAX;
+    r.gasPpm = v;
+    rows.push_back(r);
+  }
+  size_t len = 0;
+  EXPECT(roundTrip(rows, &len), "valores extremos");
+  EXPECT(len <= batchPayloadMaxLen(rows.size()), "lote de %zu B, cota %zu", len, batchPayloadMaxLen(rows.size()));
+
+  char exact[batchPayloadMaxLen(8)];
+  EXPECT(writeBatchPayload(rows.data(), rows.size(), exact, len + 1) == len, "cabe justo en %zu + 1", len);
+  EXPECT(writeBatchPayload(rows.data(), rows.size(), exact, len) == 0, "con un byte menos debe devolver 0");
+}
+
+// === 3) Orden de columnas ===
+void checkColumnOrder() {
+  const char reordered[] =
+      "{\"sensor_id\":\"" STATION_SENSOR_ID "\",\"sensor_type\":\"" STATION_SENSOR_TYPE
+      "\",\"street_id\":\"" STATION_STREET_ID "\",\"location\":{\"latitude\":" STATION_LATITUDE
+      ",\"longitude\":" STATION_LONGITUDE ",\"district\":\"" STATION_DISTRICT "\",\"neighborhood\":\"" STATION_NEIGHBORHOOD
+      "\"},\"fields\":[\"air_quality_index\",\"futuro\",\"temperature_celsius\",\"timestamp_ms\","
+      "\"humidity_percentage\",\"wind_speed\",\"luz\",\"atmospheric_pressure_hpa\",\"altitude_meters\"],"
+      "\"readings\":[[1450,7,21.5,1735689600000,40,3.2,812.5,1013.25,650.2]]}";
+  StoredReading r;
+  r.timestampMs = 1735689600000LL;
+  r.altitudeMeters = 650.2f;
+  r.temperatureC = 21.5f;
+  r.humidityPercent = 40.0f;
+  r.windSpeedKmh = 3.2f;
+  r.lightLux = 812.5f;
+  r.pressureHpa = 1013.25f;
+  r.gasRaw = 1450;
+  const std::vector<std::string> records = expand(reordered, sizeof(reordered) - 1);
+  EXPECT(records.size() == 1 && records[0] == singlePayload(r), "columnas reordenadas: %s",
+         records.empty() ? "(nada)" : records[0].c_str());
+}
+
+// === 4) Mensajes truncados ===
+void checkTruncated() {
+  std::mt19937 rng(7);
+  std::vector<StoredReading> rows;
+  for (int i = 0; i < 4; i++) rows.push_back(randomReading(rng, 1735689600000LL + i * 30000));
+  char batch[batchPayloadMaxLen(4) + 1];
+  const size_t len = writeBatchPayload(rows.data(), rows.size(), batch, sizeof(batch));
+  for (size_t cut = 0; cut < len; cut++) {
+    char prefix[sizeof(batch)];
+    memcpy(prefix, batch, cut);  // copia exacta: nada que leer más allá de `cut`
+    int n = 0;
+    const std::vector<std::string> records = expand(prefix, cut, &n);
+    EXPECT(n == -1 && records.size() <= rows.size(), "truncado en %zu: %d", cut, n);
+  }
+}
+
+// === 5) Escapes de cadenas ===
+std::string unescape(const char* json, size_t len) {
+  char out[128];
+  JsonCursor cursor(json, len);
+  return cursor.string(out, sizeof(out)) ? std::string(out) : std::string("<inválida>");
+}
+
+void checkEscapes() {
+  char text[2] = {0, 0};
+  char json[16];
+  for (int c = 1; c < 0x80; c++) {
+    text[0] = (char)c;
+    JsonWriter writer(json, sizeof(json));
+    writer.string(text);
+    EXPECT(unescape(json, writer.length()) == text, "0x%02x no vuelve igual", c);
+  }
+  const char* const samples[] = {"Barrio \"Las Letras\"", "l\u00ednea 1\nl\u00ednea 2\ttab\r", "C:\\ruta\\",
+                                 "Ch\u00e1mber\u00ed \u2014 \u20ac"};
+  for (const char* sample : samples) {
+    char quoted[128];
+    JsonWriter writer(quoted, sizeof(quoted));
+    writer.string(sample);
+    EXPECT(unescape(quoted, writer.length()) == sample, "\"%s\" no vuelve igual", sample);
+  }
+  const char escaped[] = "\"\\u00e1\\u20ac\\/\"";  // "\u00e1\u20ac\/"
+  EXPECT(unescape(escaped, sizeof(escaped) - 1) == "\u00e1\u20ac/", "\\uXXXX: %s",
+         unescape(escaped, sizeof(escaped) - 1).c_str());
+}
+
+}  // namespace
+
+int main() {
+  checkRandom();
+  checkBounds();
+  checkColumnOrder();
+  checkTruncated();
+  checkEscapes();
+  printf("%s (%u fallos)\n", failures ? "FALLOS" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,202 @@
+// =============================================================
+// === Banco de pruebas del formato binario (BinaryPayload.hpp) ===
+// =============================================================
+// Un día de lecturas cada 30 s sacado de una traza (con el ruido de los
+// sensores) publicado como json/json-general y como CBOR:
+// 1) Tamaño por mensaje: JSON, CBOR solo con tramas clave y CBOR con
+//    deltas (una clave cada CBOR_KEYFRAME_INTERVAL, como en config.h).
+// 2) Coste de codificar (writeSensorPayload() con su timestamp frente a
+//    BinaryEncoder) y de decodificar en la ingesta (recorrer el documento
+//    con el JsonCursor de BatchPayload.hpp sacando los siete valores y el
+//    timestamp, frente a BinaryDecoder).
+//
+//   g++ -std=c++17 -O2 -I.. binary_bench.cpp -o binary_bench
+//   ./binary_bench --trace traces/dia_con_cortes.csv
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "include/BatchPayload.hpp"
+#include "include/BinaryPayload.hpp"
+#include "include/IsoTimestamp.hpp"
+#include "include/PayloadWriter.hpp"
+#include "sim/SensorTrace.hpp"
+
+#ifndef SIM_TRACES_DIR
+#define SIM_TRACES_DIR "sim/traces"
+#endif
+
+namespace {
+
+constexpr uint16_t KEYFRAME_INTERVAL = 20;  // CBOR_KEYFRAME_INTERVAL de config.h
+constexpr double SAMPLE_S = 30.0;
+
+std::vector<StoredReading> dayOfReadings(const SensorTrace& trace) {
+  std::mt19937 rng(1);
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  std::vector<StoredReading> readings;
+  const int64_t start = 1735689600000LL;
+  for (double t = 0.0; t < 86400.0; t += SAMPLE_S) {
+    StoredReading r;
+    r.timestampMs = start + (int64_t)(t * 1000.0) + (int64_t)(rng() % 50);
+    r.altitudeMeters = 650.2f + 0.3f * noise(rng);
+    r.temperatureC = trace.value(SensorTrace::TEMPERATURE, t) + 0.05f * noise(rng);
+    r.humidityPercent = trace.value(SensorTrace::HUMIDITY, t) + 0.5f * noise(rng);
+    r.pressureHpa = trace.value(SensorTrace::PRESSURE, t) + 0.03f * noise(rng);
+    r.lightLux = fmaxf(0.0f, trace.value(SensorTrace::LIGHT, t) * (1.0f + 0.02f * noise(rng)));
+    r.windSpeedKmh = fmaxf(0.0f, trace.value(SensorTrace::WIND, t) + 0.8f * noise(rng));
+    const float gas = trace.value(SensorTrace::GAS, t);
+    r.gasRaw = isnan(gas) ? 0 : (int32_t)lroundf(gas + 2.0f * noise(rng));
+    readings.push_back(r);
+  }
+  return readings;
+}
+
+struct Encoded {
+  std::vector<std::string> messages;
+  size_t bytes = 0;
+};
+
+Encoded encodeJson(const std::vector<StoredReading>& readings) {
+  Encoded out;
+  IsoTimestampFormatter utc(true);
+  char timestamp[TIMESTAMP_MAX_LEN];
+  char buffer[SENSOR_PAYLOAD_MAX_LEN + 1];
+  for (const StoredReading& r : readings) {
+    utc.format(r.timestampMs, timestamp, sizeof(timestamp), true);
+    const size_t len = writeSensorPayload(r.toSensorData(), timestamp, buffer, sizeof(buffer));
+    out.messages.emplace_back(buffer, len);
+    out.bytes += len;
+  }
+  return out;
+}
+
+Encoded encodeBinary(const std::vector<StoredReading>& readings, uint16_t keyframeInterval) {
+  Encoded out;
+  BinaryEncoder encoder(keyframeInterval);
+  uint8_t buffer[BINARY_PAYLOAD_MAX_LEN];
+  for (const StoredReading& r : readings) {
+    const size_t len = encoder.encode(r, "WS_001", buffer, sizeof(buffer));
+    out.messages.emplace_back((const char*)buffer, len);
+    out.bytes += len;
+  }
+  return out;
+}
+
+// Lo que hace la ingesta con un json/json-general: recorrerlo y sacar los
+// valores numéricos (los de "location" y "data") y el timestamp
+bool walkObject(JsonCursor& json, double& sum, char* timestamp) {
+  if (!json.consume('{')) return false;
+  if (json.consume('}')) return true;
+  do {
+    char key[32];
+    json.skipSpace();
+    if (!json.string(key, sizeof(key)) || !json.consume(':')) return false;
+    if (json.peek('{')) {
+      if (!walkObject(json, sum, timestamp)) return false;
+    } else if (json.peek('"')) {
+      char text[TIMESTAMP_MAX_LEN];
+      if (!json.string(text, sizeof(text))) return false;
+      if (strcmp(key, "timestamp") == 0) memcpy(timestamp, text, sizeof(text));
+    } else {
+      double v = 0.0;
+      if (!json.number(v)) return false;
+      if (!isnan(v)) sum += v;
+    }
+  } while (json.consume(','));
+  return json.consume('}');
+}
+
+double decodeJson(const std::string& message) {
+  JsonCursor json(message.data(), message.size());
+  double sum = 0.0;
+  char timestamp[TIMESTAMP_MAX_LEN] = "";
+  if (!walkObject(json, sum, timestamp)) return NAN;
+  return sum + timestamp[0];
+}
+
+template <typename Fn>
+double nsPerMessage(size_t messages, int rounds, Fn fn) {
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int round = 0; round < rounds; round++) fn();
+  const auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / ((double)rounds * (double)messages);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string tracePath = SIM_TRACES_DIR "/dia_con_cortes.csv";
+  for (int i = 1; i + 1 < argc; i++) {
+    if (strcmp(argv[i], "--trace") == 0) tracePath = argv[++i];
+  }
+  SensorTrace trace;
+  std::string error;
+  if (!trace.load(tracePath.c_str(), error)) {
+    fprintf(stderr, "traza %s: %s\n", tracePath.c_str(), error.c_str());
+    return 2;
+  }
+  trace.setRepeat(true);
+
+  const std::vector<StoredReading> readings = dayOfReadings(trace);
+  const size_t n = readings.size();
+  const Encoded json = encodeJson(readings);
+  const Encoded keyframes = encodeBinary(readings, 0);
+  const Encoded deltas = encodeBinary(readings, KEYFRAME_INTERVAL);
+
+  printf("Traza %s: %zu lecturas (un día cada %.0f s)\n\n", tracePath.c_str(), n, SAMPLE_S);
+  printf("formato                       B/mensaje   B/día    frente a JSON\n");
+  printf("json/json-general             %9.1f %7zu\n", (double)json.bytes / n, json.bytes);
+  printf("CBOR solo tramas clave        %9.1f %7zu   %5.1f %%\n", (double)keyframes.bytes / n, keyframes.bytes,
+         100.0 * (double)keyframes.bytes / (double)json.bytes);
+  printf("CBOR con deltas (1 de %2u)     %9.1f %7zu   %5.1f %%\n", (unsigned)KEYFRAME_INTERVAL,
+         (double)deltas.bytes / n, deltas.bytes, 100.0 * (double)deltas.bytes / (double)json.bytes);
+
+  // Coste por mensaje
+  const int rounds = 20;
+  volatile double sink = 0.0;
+  const double encodeJsonNs = nsPerMessage(n, rounds, [&]() {
+    IsoTimestampFormatter utc(true);
+    char timestamp[TIMESTAMP_MAX_LEN];
+    char buffer[SENSOR_PAYLOAD_MAX_LEN + 1];
+    for (const StoredReading& r : readings) {
+      utc.format(r.timestampMs, timestamp, sizeof(timestamp), true);
+      sink = sink + (double)writeSensorPayload(r.toSensorData(), timestamp, buffer, sizeof(buffer));
+    }
+  });
+  const double encodeBinaryNs = nsPerMessage(n, rounds, [&]() {
+    BinaryEncoder encoder(KEYFRAME_INTERVAL);
+    uint8_t buffer[BINARY_PAYLOAD_MAX_LEN];
+    for (const StoredReading& r : readings) sink = sink + (double)encoder.encode(r, "WS_001", buffer, sizeof(buffer));
+  });
+
+  const double decodeJsonNs = nsPerMessage(n, rounds, [&]() {
+    for (const std::string& m : json.messages) sink = sink + decodeJson(m);
+  });
+  uint32_t failed = 0;
+  const double decodeBinaryNs = nsPerMessage(n, rounds, [&]() {
+    BinaryDecoder decoder;
+    BinaryReading out;
+    for (const std::string& m : deltas.messages) {
+      if (decoder.decode((const uint8_t*)m.data(), m.size(), out) != BinaryDecodeStatus::OK) failed++;
+      sink = sink + out.reading.temperatureC;
+    }
+  });
+
+  printf("\ncoste por mensaje (ns)        codificar  decodificar\n");
+  printf("json/json-general             %9.0f  %11.0f\n", encodeJsonNs, decodeJsonNs);
+  printf("CBOR con deltas               %9.0f  %11.0f\n", encodeBinaryNs, decodeBinaryNs);
+  printf("decodificación %.1f veces más rápida, %.1f M mensajes/s por núcleo\n", decodeJsonNs / decodeBinaryNs,
+         1e3 / decodeBinaryNs);
+  if (failed) {
+    printf("%u mensajes CBOR sin decodificar\n", (unsigned)failed);
+    return 1;
+  }
+  return 0;
+}
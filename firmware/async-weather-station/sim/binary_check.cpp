@@ -0,0 +1,317 @@
+// =============================================================
+// === Formato binario CBOR (BinaryPayload.hpp) ===
+// =============================================================
+// BinaryEncoder -> BinaryDecoder con secuencias de lecturas aleatorias:
+// 1) Ida y vuelta: cada canal vuelve cuantizado igual (error <= media
+//    unidad de la escala), NaN como NaN (gas_ppm mientras el MQ-2 calibra),
+//    timestamp y gas exactos; trama clave cada keyframeInterval mensajes y
+//    sensor_id solo en ellas.
+// 2) Mensajes perdidos al azar: el decodificador nunca da un valor
+//    equivocado; tras un hueco descarta deltas hasta la siguiente clave.
+// 3) Publicación fallida (PublishMqttTo() devuelve 0): con forceKeyframe(),
+//    como hace publishStoredReading(), solo se pierde ese mensaje; sin él
+//    se pierden los deltas hasta la siguiente trama clave.
+// 4) Entradas rotas: truncadas en cada byte, con bytes cambiados o de otra
+//    versión se rechazan sin leer fuera del buffer.
+// 5) Cota: con valores extremos el mensaje cabe en BINARY_PAYLOAD_MAX_LEN, y
+//    si el buffer no alcanza encode() devuelve 0 sin avanzar el estado.
+//
+//   g++ -std=c++17 -O2 -I.. binary_check.cpp -o binary_check
+//   ./binary_check   (termina con código 1 si algo falla)
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+#include "include/BinaryPayload.hpp"
+
+namespace {
+
+uint32_t failures = 0;
+
+#define EXPECT(cond, ...)                             \
+  do {                                                \
+    if (!(cond)) {                                    \
+      if (failures++ < 20) {                          \
+        printf("  FALLO %s:%d ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__);                          \
+        printf("\n");                                 \
+      }                                               \
+    }                                                 \
+  } while (0)
+
+const char* const SENSOR_ID = "WS_001";
+constexpr uint16_t KEYFRAME_INTERVAL = 20;
+
+struct Frame {
+  uint8_t bytes[BINARY_PAYLOAD_MAX_LEN];
+  size_t len = 0;
+};
+
+// Lecturas cada 30 s que derivan despacio, con canales que a veces fallan
+class ReadingSource {
+ public:
+  explicit ReadingSource(uint32_t seed) : rng_(seed) {}
+
+  StoredReading next() {
+    std::normal_distribution<float> step(0.0f, 1.0f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    t_ += 30000 + (int64_t)(rng_() % 200);
+    temperature_ += 0.05f * step(rng_);
+    humidity_ = fminf(100.0f, fmaxf(0.0f, humidity_ + 0.3f * step(rng_)));
+    pressure_ += 0.02f * step(rng_);
+    light_ = fmaxf(0.0f, light_ + 40.0f * step(rng_));
+    wind_ = fmaxf(0.0f, wind_ + 0.8f * step(rng_));
+    gas_ += (int32_t)(3.0f * step(rng_));
+    ppm_ = fmaxf(0.0f, ppm_ + 4.0f * step(rng_));
+    count_++;
+
+    StoredReading r;
+    r.timestampMs = t_;
+    r.altitudeMeters = 650.2f + 0.3f * step(rng_);
+    r.temperatureC = unit(rng_) < 0.05f ? NAN : temperature_;
+    r.humidityPercent = unit(rng_) < 0.05f ? NAN : humidity_;
+    r.pressureHpa = unit(rng_) < 0.02f ? NAN : pressure_;
+    r.lightLux = light_;
+    r.windSpeedKmh = wind_;
+    r.gasRaw = gas_;
+    r.gasPpm = count_ <= 10 ? NAN : ppm_;  // las primeras, aún sin R0
+    return r;
+  }
+
+ private:
+  std::mt19937 rng_;
+  int64_t t_ = 1735689600000LL;
+  float temperature_ = 12.0f;
+  float humidity_ = 70.0f;
+  float pressure_ = 1013.0f;
+  float light_ = 300.0f;
+  float wind_ = 5.0f;
+  int32_t gas_ = 900;
+  float ppm_ = 300.0f;
+  uint32_t count_ = 0;
+};
+
+// Misma lectura tras cuantizar (lo que debe devolver el decodificador)
+bool sameQuantized(const StoredReading& original, const StoredReading& decoded) {
+  float a[CH_COUNT];
+  float b[CH_COUNT];
+  readingToChannels(original, a);
+  readingToChannels(decoded, b);
+  for (uint8_t ch = 0; ch < CH_COUNT; ch++) {
+    int64_t qa = 0;
+    int64_t qb = 0;
+    const bool va = quantize(a[ch], BINARY_SCALE[ch], qa);
+    const bool vb = quantize(b[ch], BINARY_SCALE[ch], qb);
+    // El viento sin dato se decodifica como 0, igual que en SensorData
+    if (ch == CH_WIND && !va) {
+      if (b[ch] != 0.0f) return false;
+      continue;
+    }
+    if (va != vb || qa != qb) return false;
+    if (va && fabs((double)a[ch] - (double)b[ch]) > 0.5 / BINARY_SCALE[ch] + 1e-4) return false;
+  }
+  return original.timestampMs == decoded.timestampMs && original.gasRaw == decoded.gasRaw;
+}
+
+// === 1) Ida y vuelta ===
+void checkRoundTrip() {
+  for (uint32_t seed = 1; seed <= 20; seed++) {
+    ReadingSource source(seed);
+    BinaryEncoder encoder(KEYFRAME_INTERVAL);
+    BinaryDecoder decoder;
+    for (uint32_t i = 0; i < 500; i++) {
+      const StoredReading r = source.next();
+      Frame f;
+      f.len = encoder.encode(r, SENSOR_ID, f.bytes, sizeof(f.bytes));
+      BinaryReading out;
+      const BinaryDecodeStatus status = decoder.decode(f.bytes, f.len, out);
+      const bool keyframe = i % KEYFRAME_INTERVAL == 0;
+      EXPECT(f.len > 0 && status == BinaryDecodeStatus::OK, "semilla %u, mensaje %u: estado %d", (unsigned)seed,
+             (unsigned)i, (int)status);
+      EXPECT(out.seq == i && out.keyframe == keyframe, "semilla %u, mensaje %u: seq %u clave %d", (unsigned)seed,
+             (unsigned)i, (unsigned)out.seq, (int)out.keyframe);
+      EXPECT(strcmp(out.sensorId, keyframe ? SENSOR_ID : "") == 0, "sensor_id '%s' en el mensaje %u", out.sensorId,
+             (unsigned)i);
+      EXPECT(sameQuantized(r, out.reading), "semilla %u, mensaje %u: valores distintos", (unsigned)seed, (unsigned)i);
+    }
+  }
+}
+
+// === 2) Mensajes perdidos ===
+void checkLoss() {
+  uint32_t decoded = 0;
+  uint32_t discarded = 0;
+  uint32_t lost = 0;
+  for (uint32_t seed = 1; seed <= 20; seed++) {
+    ReadingSource source(seed);
+    std::mt19937 rng(seed * 7919);
+    BinaryEncoder encoder(KEYFRAME_INTERVAL);
+    BinaryDecoder decoder;
+    bool waitingKeyframe = false;
+    for (uint32_t i = 0; i < 2000; i++) {
+      const StoredReading r = source.next();
+      Frame f;
+      f.len = encoder.encode(r, SENSOR_ID, f.bytes, sizeof(f.bytes));
+      if (rng() % 100 < 5) {  // se pierde por el camino
+        lost++;
+        waitingKeyframe = true;
+        continue;
+      }
+      BinaryReading out;
+      const BinaryDecodeStatus status = decoder.decode(f.bytes, f.len, out);
+      const bool keyframe = i % KEYFRAME_INTERVAL == 0;
+      if (keyframe) waitingKeyframe = false;
+      if (waitingKeyframe) {
+        EXPECT(status == BinaryDecodeStatus::NEED_KEYFRAME, "semilla %u, delta %u tras un hueco: estado %d",
+               (unsigned)seed, (unsigned)i, (int)status);
+        discarded++;
+        continue;
+      }
+      EXPECT(status == BinaryDecodeStatus::OK && sameQuantized(r, out.reading),
+             "semilla %u, mensaje %u: estado %d o valores distintos", (unsigned)seed, (unsigned)i, (int)status);
+      decoded++;
+    }
+  }
+  printf("pérdidas del 5 %%: %u decodificados, %u perdidos, %u deltas descartados hasta la trama clave\n",
+         (unsigned)decoded, (unsigned)lost, (unsigned)discarded);
+}
+
+// === 3) Publicación fallida ===
+// Devuelve cuántas lecturas publicadas con éxito no se pudieron decodificar
+uint32_t failedPublish(bool forceKeyframe, uint32_t& failedCount) {
+  uint32_t undecodable = 0;
+  failedCount = 0;
+  ReadingSource source(99);
+  BinaryEncoder encoder(KEYFRAME_INTERVAL);
+  BinaryDecoder decoder;
+  for (uint32_t i = 0; i < 2000; i++) {
+    const StoredReading r = source.next();
+    Frame f;
+    f.len = encoder.encode(r, SENSOR_ID, f.bytes, sizeof(f.bytes));
+    // Sin sesión o con la cola de salida llena: PublishMqttTo() devuelve 0
+    if (i % 37 == 5) {
+      failedCount++;
+      if (forceKeyframe) encoder.forceKeyframe();
+      continue;
+    }
+    BinaryReading out;
+    const BinaryDecodeStatus status = decoder.decode(f.bytes, f.len, out);
+    if (status != BinaryDecodeStatus::OK) {
+      undecodable++;
+      continue;
+    }
+    EXPECT(sameQuantized(r, out.reading), "mensaje %u decodificado con valores distintos", (unsigned)i);
+  }
+  return undecodable;
+}
+
+void checkFailedPublish() {
+  uint32_t failed = 0;
+  const uint32_t withKeyframe = failedPublish(true, failed);
+  const uint32_t without = failedPublish(false, failed);
+  EXPECT(withKeyframe == 0, "con forceKeyframe(): %u lecturas publicadas sin decodificar", (unsigned)withKeyframe);
+  EXPECT(without > 0, "sin forceKeyframe() debería perder deltas");
+  printf("%u publicaciones fallidas: %u lecturas perdidas de más sin forceKeyframe(), %u con él\n", (unsigned)failed,
+         (unsigned)without, (unsigned)withKeyframe);
+}
+
+// === 4) Entradas rotas ===
+void checkMalformed() {
+  ReadingSource source(5);
+  BinaryEncoder encoder(4);
+  std::mt19937 rng(11);
+  uint32_t flipped = 0;
+  for (uint32_t i = 0; i < 8; i++) {
+    const StoredReading r = source.next();
+    Frame f;
+    f.len = encoder.encode(r, SENSOR_ID, f.bytes, sizeof(f.bytes));
+
+    for (size_t cut = 0; cut < f.len; cut++) {
+      // Copia exacta: un acceso más allá de `cut` saldría en ASan/valgrind
+      std::vector<uint8_t> prefix(f.bytes, f.bytes + cut);
+      BinaryDecoder decoder;
+      BinaryReading out;
+      EXPECT(decoder.decode(prefix.data(), prefix.size(), out) == BinaryDecodeStatus::MALFORMED,
+             "mensaje %u truncado en %zu aceptado", (unsigned)i, cut);
+    }
+    for (int k = 0; k < 200; k++) {
+      std::vector<uint8_t> noisy(f.bytes, f.bytes + f.len);
+      noisy[rng() % noisy.size()] ^= (uint8_t)(1u << (rng() % 8));
+      BinaryDecoder decoder;
+      BinaryReading out;
+      decoder.decode(noisy.data(), noisy.size(), out);
+      flipped++;
+    }
+  }
+
+  // Versión 2 del esquema: {0: 2, 1: 0, 2: 0, 4: 0}
+  const uint8_t future[] = {0xA4, 0x00, 0x02, 0x01, 0x00, 0x02, 0x00, 0x04, 0x00};
+  BinaryDecoder decoder;
+  BinaryReading out;
+  EXPECT(decoder.decode(future, sizeof(future), out) == BinaryDecodeStatus::UNSUPPORTED_VERSION, "versión 2");
+  const uint8_t array[] = {0x82, 0x00, 0x01};
+  EXPECT(decoder.decode(array, sizeof(array), out) == BinaryDecodeStatus::MALFORMED, "array en vez de mapa");
+  printf("entradas rotas: truncadas en cada byte y %u con un bit cambiado\n", (unsigned)flipped);
+}
+
+// === 5) Cota y buffer insuficiente ===
+void checkBounds() {
+  StoredReading extreme;
+  extreme.timestampMs = INT64_MIN + 1;
+  extreme.altitudeMeters = extreme.temperatureC = extreme.humidityPercent = -1.0e9f;
+  extreme.windSpeedKmh = extreme.lightLux = extreme.pressureHpa = 1.0e9f;
+  extreme.gasRaw = INT32_MIN;
+  extreme.gasPpm = -1.0e9f;
+  const char longId[] = "ESTACION_CON_UN_NOMBRE_DEMASIADO_LARGO";
+
+  BinaryEncoder encoder(1);
+  Frame f;
+  f.len = encoder.encode(extreme, longId, f.bytes, sizeof(f.bytes));
+  EXPECT(f.len > 0 && f.len <= BINARY_PAYLOAD_MAX_LEN, "trama clave extrema de %zu B, cota %zu", f.len,
+         BINARY_PAYLOAD_MAX_LEN);
+
+  BinaryEncoder deltas(100);
+  StoredReading low = extreme;
+  low.timestampMs = -(INT64_MAX / 2);  // el delta entre las dos aún cabe en int64
+  StoredReading high = extreme;
+  high.timestampMs = INT64_MAX / 2;
+  high.altitudeMeters = high.temperatureC = high.humidityPercent = 1.0e9f;
+  high.windSpeedKmh = high.lightLux = high.pressureHpa = -1.0e9f;
+  high.gasRaw = INT32_MAX;
+  high.gasPpm = 1.0e9f;
+  for (int i = 0; i < 4; i++) {
+    f.len = deltas.encode(i % 2 ? high : low, SENSOR_ID, f.bytes, sizeof(f.bytes));
+    EXPECT(f.len > 0 && f.len <= BINARY_PAYLOAD_MAX_LEN, "delta extremo de %zu B", f.len);
+  }
+
+  // Sin sitio: 0 y el siguiente sigue siendo el mismo mensaje
+  ReadingSource source(3);
+  BinaryEncoder small(KEYFRAME_INTERVAL);
+  BinaryDecoder decoder;
+  BinaryReading out;
+  const StoredReading first = source.next();
+  f.len = small.encode(first, SENSOR_ID, f.bytes, sizeof(f.bytes));
+  decoder.decode(f.bytes, f.len, out);
+  const StoredReading second = source.next();
+  EXPECT(small.encode(second, SENSOR_ID, f.bytes, 8) == 0, "buffer de 8 B");
+  f.len = small.encode(second, SENSOR_ID, f.bytes, sizeof(f.bytes));
+  EXPECT(decoder.decode(f.bytes, f.len, out) == BinaryDecodeStatus::OK && out.seq == 1 && !out.keyframe &&
+             sameQuantized(second, out.reading),
+         "tras un buffer insuficiente: seq %u", (unsigned)out.seq);
+}
+
+}  // namespace
+
+int main() {
+  checkRoundTrip();
+  checkLoss();
+  checkFailedPublish();
+  checkMalformed();
+  checkBounds();
+  printf("%s (%u fallos)\n", failures ? "FALLOS" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,273 @@
+// =============================================================
+// === BMP085/BMP180 no bloqueante (Bmp085Async.hpp) ===
+// =============================================================
+// Sobre un mapa de registros simulado (I2cBus) con los tiempos de
+// conversión de la hoja de datos y un reloj virtual:
+// 1) Ejemplo de la hoja de datos de Bosch: calibración de ejemplo,
+//    UT = 27898, UP = 23843, oss = 0 -> 15,0 °C y 69964 Pa; leída por
+//    begin() desde los registros 0xAA..0xBF igual que con setCalibration().
+// 2) Misma presión física con oss 0..3: el resultado no cambia más que el
+//    redondeo de la compensación.
+// 3) Tiempos: esperando lo que devuelven start()/poll() nunca se lee el
+//    resultado antes de que acabe la conversión, el total coincide con
+//    measurementMs() y el promedio de N conversiones es la media.
+// 4) Fallos: chip ausente o con otro id, bus que falla a mitad de la medida
+//    (queda FAILED y start() vuelve a empezar) y start() con una medida en
+//    curso.
+// 5) Altitud: fórmula barométrica frente a la referencia en double.
+//
+//   g++ -std=c++17 -O2 -I.. bmp085_check.cpp -o bmp085_check
+//   ./bmp085_check   (termina con código 1 si algo falla)
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "include/Bmp085Async.hpp"
+
+namespace {
+
+uint32_t failures = 0;
+
+#define EXPECT(cond, ...)                             \
+  do {                                                \
+    if (!(cond)) {                                    \
+      if (failures++ < 20) {                          \
+        printf("  FALLO %s:%d ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__);                          \
+        printf("\n");                                 \
+      }                                               \
+    }                                                 \
+  } while (0)
+
+// Calibración del ejemplo de la hoja de datos (BMP085, rev. 1.2, apdo. 3.5)
+const Bmp085Async::Calibration DATASHEET = {408, -72, -14383, 32741, 32757, 23153, 6190, 4, -32768, -8711, 2868};
+constexpr int32_t DATASHEET_UT = 27898;
+constexpr int32_t DATASHEET_UP = 23843;
+
+// === Sensor simulado ===
+// Registros 0xAA..0xBF (calibración), 0xD0 (id), 0xF4 (control) y
+// 0xF6..0xF8 (resultado). El resultado solo es válido pasado el tiempo
+// máximo de conversión; antes se lee lo de la conversión anterior.
+class FakeBmp085 : public I2cBus {
+ public:
+  uint64_t nowUs = 0;
+  uint8_t chipId = Bmp085Async::CHIP_ID;
+  int32_t ut = DATASHEET_UT;
+  int32_t up0 = DATASHEET_UP;  // UP con oss = 0; con oss > 0 se desplaza
+  int failAfter = -1;          // número de operaciones antes de que falle el bus
+  uint32_t earlyReads = 0;
+  uint32_t conversions = 0;
+
+  explicit FakeBmp085(const Bmp085Async::Calibration& cal) {
+    const int16_t words[11] = {cal.ac1, cal.ac2, cal.ac3, (int16_t)cal.ac4, (int16_t)cal.ac5, (int16_t)cal.ac6,
+                               cal.b1,  cal.b2,  cal.mb,  cal.mc,           cal.md};
+    for (int i = 0; i < 11; i++) {
+      regs_[0xAA + 2 * i] = (uint8_t)((uint16_t)words[i] >> 8);
+      regs_[0xAB + 2 * i] = (uint8_t)words[i];
+    }
+  }
+
+  bool writeRegister(uint8_t address, uint8_t reg, uint8_t value) override {
+    if (!busUp(address)) return false;
+    if (reg != Bmp085Async::REG_CONTROL) return true;
+    conversions++;
+    if (value == Bmp085Async::CMD_TEMPERATURE) {
+      readyAtUs_ = nowUs + 4500;
+      pending_ = ((uint32_t)ut & 0xFFFF) << 8;
+    } else if ((value & 0x3F) == Bmp085Async::CMD_PRESSURE) {
+      const uint8_t oss = value >> 6;
+      static const uint32_t CONVERSION_US[4] = {4500, 7500, 13500, 25500};
+      readyAtUs_ = nowUs + CONVERSION_US[oss];
+      pending_ = ((uint32_t)up0 << oss) << (8 - oss);  // 19 bits alineados a la izquierda en 0xF6..0xF8
+    }
+    return true;
+  }
+
+  bool readRegisters(uint8_t address, uint8_t reg, uint8_t* out, size_t len) override {
+    if (!busUp(address)) return false;
+    if (reg == Bmp085Async::REG_RESULT) {
+      if (nowUs < readyAtUs_) {
+        earlyReads++;
+      } else {
+        result_ = pending_;
+      }
+      const uint8_t bytes[3] = {(uint8_t)(result_ >> 16), (uint8_t)(result_ >> 8), (uint8_t)result_};
+      for (size_t i = 0; i < len; i++) out[i] = i < 3 ? bytes[i] : 0;
+      return true;
+    }
+    regs_[Bmp085Async::REG_CHIP_ID] = chipId;
+    for (size_t i = 0; i < len; i++) out[i] = regs_[(reg + i) & 0xFF];
+    return true;
+  }
+
+ private:
+  bool busUp(uint8_t address) {
+    if (address != Bmp085Async::ADDRESS) return false;
+    if (failAfter == 0) return false;
+    if (failAfter > 0) failAfter--;
+    return true;
+  }
+
+  uint8_t regs_[256] = {};
+  uint64_t readyAtUs_ = 0;
+  uint32_t pending_ = 0;
+  uint32_t result_ = 0;
+};
+
+// Una medida completa esperando lo que pide el driver; devuelve los ms
+uint32_t measure(Bmp085Async& bmp, FakeBmp085& chip) {
+  uint32_t total = 0;
+  uint32_t wait = bmp.start();
+  while (wait > 0) {
+    chip.nowUs += (uint64_t)wait * 1000;
+    total += wait;
+    wait = bmp.poll();
+  }
+  return total;
+}
+
+// === 1) Ejemplo de la hoja de datos ===
+void checkDatasheet() {
+  Bmp085Async direct;
+  direct.setCalibration(DATASHEET);
+  direct.setOversampling(0);
+  int32_t deci = 0;
+  const int32_t pa = direct.compensate(DATASHEET_UT, DATASHEET_UP, deci);
+  EXPECT(deci == 150 && pa == 69964, "compensate(): %d décimas de °C, %d Pa (esperado 150, 69964)", (int)deci,
+         (int)pa);
+
+  FakeBmp085 chip(DATASHEET);
+  Bmp085Async bmp;
+  EXPECT(bmp.begin(&chip), "begin() con el chip simulado");
+  bmp.setOversampling(0);
+  measure(bmp, chip);
+  EXPECT(bmp.hasResult() && bmp.temperatureC() == 15.0f && bmp.pressurePa() == 69964.0f,
+         "medida por registros: %.1f °C, %.0f Pa", bmp.temperatureC(), bmp.pressurePa());
+}
+
+// === 2) Misma presión con cada oss ===
+void checkOversampling() {
+  FakeBmp085 chip(DATASHEET);
+  Bmp085Async bmp;
+  bmp.begin(&chip);
+  for (int32_t up0 = 20000; up0 <= 32000; up0 += 1500) {
+    chip.up0 = up0;
+    float reference = NAN;
+    for (uint8_t oss = 0; oss <= 3; oss++) {
+      bmp.setOversampling(oss);
+      measure(bmp, chip);
+      if (oss == 0) reference = bmp.pressurePa();
+      EXPECT(fabsf(bmp.pressurePa() - reference) <= 2.0f, "UP %d, oss %u: %.0f Pa frente a %.0f con oss 0",
+             (int)up0, (unsigned)oss, bmp.pressurePa(), reference);
+    }
+  }
+}
+
+// === 3) Tiempos de conversión ===
+void checkTiming() {
+  for (uint8_t oss = 0; oss <= 3; oss++) {
+    for (uint8_t averaging = 1; averaging <= 4; averaging++) {
+      FakeBmp085 chip(DATASHEET);
+      Bmp085Async bmp;
+      bmp.begin(&chip);
+      bmp.setOversampling(oss);
+      bmp.setAveraging(averaging);
+      const uint32_t ms = measure(bmp, chip);
+      EXPECT(chip.earlyReads == 0, "oss %u x%u: %u lecturas antes de acabar la conversión", (unsigned)oss,
+             (unsigned)averaging, (unsigned)chip.earlyReads);
+      EXPECT(ms == bmp.measurementMs() && chip.conversions == 1u + averaging,
+             "oss %u x%u: %u ms y %u conversiones (measurementMs %u)", (unsigned)oss, (unsigned)averaging,
+             (unsigned)ms, (unsigned)chip.conversions, (unsigned)bmp.measurementMs());
+      EXPECT(bmp.state() == Bmp085Async::State::IDLE && (oss != 0 || bmp.pressurePa() == 69964.0f),
+             "oss %u x%u: %.0f Pa", (unsigned)oss, (unsigned)averaging, bmp.pressurePa());
+    }
+  }
+
+  // Promedio: la presión cambia entre conversiones de la misma medida
+  FakeBmp085 chip(DATASHEET);
+  Bmp085Async bmp;
+  bmp.begin(&chip);
+  bmp.setOversampling(0);
+  bmp.setAveraging(2);
+  int32_t deci = 0;
+  const int32_t low = bmp.compensate(DATASHEET_UT, 23000, deci);
+  const int32_t high = bmp.compensate(DATASHEET_UT, 24000, deci);
+  uint32_t wait = bmp.start();
+  chip.nowUs += wait * 1000;
+  chip.up0 = 23000;
+  wait = bmp.poll();  // recoge la temperatura y lanza la primera presión (23000)
+  chip.nowUs += wait * 1000;
+  chip.up0 = 24000;
+  wait = bmp.poll();  // recoge la primera y lanza la segunda (24000)
+  chip.nowUs += wait * 1000;
+  bmp.poll();
+  EXPECT(bmp.pressurePa() == (float)(low + high) / 2.0f, "media de dos conversiones %.1f, esperada %.1f",
+         bmp.pressurePa(), (float)(low + high) / 2.0f);
+
+  // Un poll adelantado (sin respetar el tiempo) se detecta en el simulado
+  FakeBmp085 hasty(DATASHEET);
+  Bmp085Async early;
+  early.begin(&hasty);
+  early.start();
+  early.poll();
+  EXPECT(hasty.earlyReads == 1, "el simulado debe notar la lectura adelantada");
+}
+
+// === 4) Fallos ===
+void checkFailures() {
+  FakeBmp085 other(DATASHEET);
+  other.chipId = 0x58;  // un BMP280 en la misma dirección
+  Bmp085Async bmp;
+  EXPECT(!bmp.begin(&other), "begin() con otro chip id");
+  EXPECT(bmp.start() == 0, "start() sin calibración");
+  EXPECT(!bmp.begin(nullptr), "begin() sin bus");
+
+  for (int failAt = 0; failAt < 5; failAt++) {
+    FakeBmp085 chip(DATASHEET);
+    Bmp085Async flaky;
+    flaky.begin(&chip);
+    flaky.setOversampling(0);
+    chip.failAfter = failAt;  // 0: el comando de temperatura; 4: ya terminada
+    const uint32_t ms = measure(flaky, chip);
+    const bool completed = failAt >= 4;
+    EXPECT(flaky.hasResult() == completed && flaky.failed() == (!completed && failAt > 0),
+           "bus caído tras %d operaciones: resultado %d, FAILED %d (%u ms)", failAt, (int)flaky.hasResult(),
+           (int)flaky.failed(), (unsigned)ms);
+    chip.failAfter = -1;
+    measure(flaky, chip);
+    EXPECT(flaky.hasResult() && flaky.pressurePa() == 69964.0f, "tras el fallo en %d la siguiente medida vale",
+           failAt);
+  }
+
+  FakeBmp085 chip(DATASHEET);
+  Bmp085Async busy;
+  busy.begin(&chip);
+  EXPECT(busy.start() > 0 && busy.busy() && busy.start() == 0, "start() con una medida en curso");
+}
+
+// === 5) Altitud ===
+void checkAltitude() {
+  Bmp085Async bmp;
+  bmp.setSeaLevelPressure(1013.25f);
+  for (float pa = 30000.0f; pa <= 110000.0f; pa += 2500.0f) {
+    const double reference = 44330.0 * (1.0 - pow((double)pa / 101325.0, 1.0 / 5.255));
+    EXPECT(fabs(bmp.altitudeFor(pa) - reference) < 0.05, "%.0f Pa: %.2f m, referencia %.2f", pa,
+           bmp.altitudeFor(pa), reference);
+  }
+  EXPECT(bmp.altitudeFor(101325.0f) == 0.0f, "a nivel del mar");
+  EXPECT(isnan(bmp.altitudeFor(NAN)) && isnan(bmp.altitudeFor(0.0f)), "sin presión");
+  printf("ejemplo de la hoja de datos: 15,0 °C y 69964 Pa -> %.1f m\n", bmp.altitudeFor(69964.0f));
+}
+
+}  // namespace
+
+int main() {
+  checkDatasheet();
+  checkOversampling();
+  checkTiming();
+  checkFailures();
+  checkAltitude();
+  printf("%s (%u fallos)\n", failures ? "FALLOS" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,157 @@
+// =============================================================
+// === Arranque no bloqueante (BootSequence.hpp) ===
+// =============================================================
+// 1) Hitos: cada uno se registra solo la primera vez, en ms desde begin()
+//    (también el hito en el ms 0 y con millis() dando la vuelta);
+//    complete() solo con los cinco.
+// 2) Degradados: bits independientes que se ponen y se quitan.
+// 3) writeReport(): JSON exacto, null para lo no alcanzado, el peor caso
+//    cabe en BOOT_REPORT_MAX_LEN y con menos sitio devuelve 0 sin pasarse.
+// 4) Cuatro tareas marcando el mismo hito a la vez: gana una sola.
+//
+//   g++ -std=c++17 -O2 -pthread -I.. boot_check.cpp -o boot_check
+//   ./boot_check   (termina con código 1 si algo falla)
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "include/BootSequence.hpp"
+
+namespace {
+
+uint32_t failures = 0;
+
+#define EXPECT(cond, ...)                             \
+  do {                                                \
+    if (!(cond)) {                                    \
+      if (failures++ < 20) {                          \
+        printf("  FALLO %s:%d ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__);                          \
+        printf("\n");                                 \
+      }                                               \
+    }                                                 \
+  } while (0)
+
+// === 1) Hitos ===
+void checkMilestones() {
+  BootSequence boot;
+  boot.begin(1000);
+  EXPECT(!boot.reached(BOOT_WIFI) && boot.elapsedMs(BOOT_WIFI) == 0 && !boot.complete(), "recién empezado");
+
+  EXPECT(boot.mark(BOOT_FIRST_SAMPLE, 1000), "hito en el ms 0");
+  EXPECT(boot.reached(BOOT_FIRST_SAMPLE) && boot.elapsedMs(BOOT_FIRST_SAMPLE) == 0, "ms 0 cuenta como alcanzado");
+  EXPECT(boot.mark(BOOT_WIFI, 4140) && !boot.mark(BOOT_WIFI, 9000) && boot.elapsedMs(BOOT_WIFI) == 3140,
+         "solo la primera vez: %u", (unsigned)boot.elapsedMs(BOOT_WIFI));
+  boot.mark(BOOT_MQTT, 5160);
+  boot.mark(BOOT_TIME_SYNC, 4260);
+  EXPECT(!boot.complete(), "falta first_publish");
+  boot.mark(BOOT_FIRST_PUBLISH, 5180);
+  EXPECT(boot.complete() && boot.elapsedMs(BOOT_FIRST_PUBLISH) == 4180, "completo");
+
+  // begin() de nuevo lo borra todo
+  boot.begin(0);
+  EXPECT(!boot.reached(BOOT_FIRST_SAMPLE) && boot.degradedMask() == 0, "begin() reinicia");
+
+  // millis() da la vuelta durante el arranque
+  boot.begin(0xFFFFFF00u);
+  boot.mark(BOOT_WIFI, 0x00000100u);
+  EXPECT(boot.elapsedMs(BOOT_WIFI) == 0x200, "vuelta de millis(): %u", (unsigned)boot.elapsedMs(BOOT_WIFI));
+}
+
+// === 2) Degradados ===
+void checkDegraded() {
+  BootSequence boot;
+  boot.begin(0);
+  boot.setDegraded(DEVICE_BMP, true);
+  boot.setDegraded(DEVICE_DISPLAY, true);
+  EXPECT(boot.degraded(DEVICE_BMP) && !boot.degraded(DEVICE_LIGHT) && boot.degradedMask() == 0x05, "bits: %02x",
+         (unsigned)boot.degradedMask());
+  boot.setDegraded(DEVICE_BMP, false);
+  boot.setDegraded(DEVICE_LIGHT, false);
+  EXPECT(boot.degradedMask() == 0x04, "quitar uno no toca los demás: %02x", (unsigned)boot.degradedMask());
+}
+
+// === 3) Informe ===
+void checkReport() {
+  BootSequence boot;
+  boot.begin(0);
+  char out[BOOT_REPORT_MAX_LEN];
+  size_t len = boot.writeReport(out, sizeof(out));
+  const char* empty =
+      "{\"boot_ms\":{\"first_sample\":null,\"wifi\":null,\"mqtt\":null,\"time_sync\":null,\"first_publish\":null},"
+      "\"degraded\":[]}";
+  EXPECT(len == strlen(empty) && strcmp(out, empty) == 0, "sin hitos: %s", out);
+
+  boot.mark(BOOT_FIRST_SAMPLE, 510);
+  boot.mark(BOOT_WIFI, 3140);
+  boot.setDegraded(DEVICE_BMP, true);
+  len = boot.writeReport(out, sizeof(out));
+  const char* partial =
+      "{\"boot_ms\":{\"first_sample\":510,\"wifi\":3140,\"mqtt\":null,\"time_sync\":null,\"first_publish\":null},"
+      "\"degraded\":[\"bmp\"]}";
+  EXPECT(len == strlen(partial) && strcmp(out, partial) == 0, "parcial: %s", out);
+
+  // Peor caso: todos los hitos con 10 cifras y los tres dispositivos
+  BootSequence worst;
+  worst.begin(0);
+  for (size_t i = 0; i < BOOT_MILESTONE_COUNT; i++) worst.mark((BootMilestone)i, 0xFFFFFFFEu);
+  for (size_t i = 0; i < BOOT_DEVICE_COUNT; i++) worst.setDegraded((BootDevice)i, true);
+  const size_t worstLen = worst.writeReport(out, sizeof(out));
+  EXPECT(worstLen > 0 && worstLen < BOOT_REPORT_MAX_LEN, "el peor caso cabe: %zu", worstLen);
+
+  // Sin sitio: 0 y nada escrito fuera de la capacidad
+  bool bounded = true;
+  for (size_t cap = 0; cap <= worstLen; cap++) {
+    char small[BOOT_REPORT_MAX_LEN + 8];
+    memset(small, 0x5A, sizeof(small));
+    if (worst.writeReport(small, cap) != 0) bounded = false;
+    for (size_t i = cap; i < sizeof(small); i++) {
+      if ((uint8_t)small[i] != 0x5A) bounded = false;
+    }
+  }
+  EXPECT(bounded, "con menos de %zu bytes devuelve 0 sin pasarse", worstLen + 1);
+}
+
+// === 4) Varias tareas a la vez ===
+void checkConcurrentMark() {
+  constexpr int TASKS = 4;
+  constexpr int ROUNDS = 2000;
+  uint32_t badRounds = 0;
+  BootSequence boot;
+  for (int round = 0; round < ROUNDS; round++) {
+    boot.begin(0);
+    std::atomic<int> winners{0};
+    std::atomic<int> winner{-1};
+    std::vector<std::thread> tasks;
+    for (int t = 0; t < TASKS; t++) {
+      tasks.emplace_back([&, t]() {
+        if (boot.mark(BOOT_FIRST_PUBLISH, 100 + (uint32_t)t)) {
+          winners++;
+          winner = t;
+        }
+        boot.setDegraded((BootDevice)(t % BOOT_DEVICE_COUNT), true);
+      });
+    }
+    for (std::thread& t : tasks) t.join();
+    if (winners != 1 || boot.elapsedMs(BOOT_FIRST_PUBLISH) != 100 + (uint32_t)winner.load() ||
+        boot.degradedMask() != 0x07) {
+      badRounds++;
+    }
+  }
+  EXPECT(badRounds == 0, "%u de %d rondas con más de un ganador o bits perdidos", (unsigned)badRounds, ROUNDS);
+}
+
+}  // namespace
+
+int main() {
+  checkMilestones();
+  checkDegraded();
+  checkReport();
+  checkConcurrentMark();
+  printf("%s (%u fallos)\n", failures ? "FALLOS" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+// =============================================================
+// === Rendimiento del canal de comandos ===
+// =============================================================
+// Mide, sobre mensajes representativos de /comandos:
+//   - tokenizado en sitio (MB/s y ns por mensaje),
+//   - búsquedas por JSON Pointer sobre los tokens,
+//   - reensamblado en trozos de 64 B + tokenizado + despacho + respuesta.
+// Cada iteración parte de una copia intacta del mensaje (el tokenizado lo
+// modifica); la copia se mide aparte y se descuenta.
+//
+//   g++ -std=c++17 -O2 -I.. command_bench.cpp -o command_bench
+//   ./command_bench [iteraciones]
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "include/CommandChannel.hpp"
+
+namespace {
+
+const char* const MESSAGES[] = {
+    "{\"cmd\":\"sample\"}",
+    "{\"cmd\":\"interval\",\"id\":\"42\",\"min_ms\":60000,\"heartbeat_ms\":600000}",
+    "{\"cmd\":\"deadband\",\"id\":\"a7\",\"temperature\":{\"abs\":0.5,\"rel\":0},\"humidity\":{\"abs\":2},"
+    "\"pressure\":{\"abs\":0.3},\"light\":{\"abs\":5,\"rel\":0.1},\"wind\":{\"abs\":1,\"rel\":0.1},"
+    "\"gas\":{\"abs\":60}}",
+    // Mensaje grande con texto escapado, cerca del máximo del firmware
+    "{\"cmd\":\"note\",\"id\":\"\\u00e9t\\u00e9-2025\",\"text\":\"Mantenimiento programado:\\n"
+    "revisar anem\\u00f3metro y limpiar el sensor MQ2. \\\"Urgente\\\" antes del viernes.\","
+    "\"tags\":[\"mantenimiento\",\"mq2\",\"anemometro\",\"calle\"],\"values\":[1,2,3,4,5,6,7,8,9,10,11,12,"
+    "13,14,15,16,17,18,19,20],\"meta\":{\"origin\":\"panel\",\"user\":\"operador\",\"retries\":0,"
+    "\"ts\":1735689600123,\"nested\":{\"a\":{\"b\":{\"c\":[true,false,null]}}}}}",
+};
+constexpr size_t MESSAGE_COUNT = sizeof(MESSAGES) / sizeof(MESSAGES[0]);
+
+volatile uint32_t sink = 0;
+
+CommandStatus benchHandler(CommandRequest& request, CommandResult& result) {
+  int32_t value = 0;
+  double number = 0;
+  if (request.integer("/min_ms", value)) result.integer("min_ms", value);
+  if (request.number("/temperature/abs", number)) result.number("temperature_abs", number, 3);
+  if (request.number("/gas/abs", number)) result.number("gas_abs", number, 3);
+  return CommandStatus::OK;
+}
+
+template <typename Fn>
+double nsPerCall(uint32_t calls, Fn fn) {
+  const auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < calls; i++) fn(i);
+  const auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / calls;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const uint32_t calls = argc > 1 ? (uint32_t)atoi(argv[1]) : 1000000;
+  static const CommandEntry TABLE[] = {
+      {"sample", benchHandler}, {"interval", benchHandler}, {"deadband", benchHandler}, {"note", benchHandler}};
+  CommandDispatcher<64> dispatcher(TABLE, 4);
+  CommandInbox<2, 513> inbox;
+  JsonToken tokens[64];
+  char work[600];
+  char reply[640];
+
+  printf("%-10s %5s %10s %9s %11s %12s\n", "mensaje", "bytes", "tokenizar", "MB/s", "3 punteros", "completo");
+  for (size_t m = 0; m < MESSAGE_COUNT; m++) {
+    const char* message = MESSAGES[m];
+    const size_t len = strlen(message);
+
+    const double copyNs = nsPerCall(calls, [&](uint32_t) {
+      memcpy(work, message, len);
+      sink += (uint8_t)work[len / 2];
+    });
+    const double parseNs = nsPerCall(calls, [&](uint32_t) {
+      memcpy(work, message, len);
+      JsonTokenizer json(tokens, 64);
+      sink += json.parse(work, len) ? (uint32_t)json.count() : 0;
+    }) - copyNs;
+
+    memcpy(work, message, len);
+    JsonTokenizer parsed(tokens, 64);
+    if (!parsed.parse(work, len)) {
+      printf("mensaje %zu no válido\n", m);
+      return 1;
+    }
+    const double lookupNs = nsPerCall(calls, [&](uint32_t) {
+      sink += (uint32_t)(parsed.find("/cmd") + parsed.find("/id") + parsed.find("/meta/nested/a/b/c/2"));
+    });
+
+    // Camino del firmware: trozos de 64 B al buzón, despacho y respuesta
+    const double fullNs = nsPerCall(calls, [&](uint32_t) {
+      for (size_t at = 0; at < len; at += 64) {
+        inbox.add(message + at, len - at < 64 ? len - at : 64, at, len);
+      }
+      size_t n = 0;
+      char* text = inbox.front(n);
+      size_t replyLen = 0;
+      dispatcher.handle(text, n, reply, sizeof(reply), replyLen);
+      inbox.pop();
+      sink += (uint32_t)replyLen;
+    });
+
+    char name[16];
+    snprintf(name, sizeof(name), "%s", parsed.string(parsed.find("/cmd")));
+    printf("%-10s %5zu %8.0f ns %9.1f %8.0f ns %9.0f ns\n", name, len, parseNs, len / parseNs * 1000.0, lookupNs,
+           fullNs);
+  }
+  printf("\nrespuestas ok: %u\n", dispatcher.count(CommandStatus::OK));
+  return 0;
+}
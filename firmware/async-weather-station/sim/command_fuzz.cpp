@@ -0,0 +1,466 @@
+// =============================================================
+// === Fuzz del canal de comandos (JsonTokenizer + CommandInbox) ===
+// =============================================================
+// 1) Documentos JSON aleatorios (claves con '/' y '~', escapes, \uXXXX,
+//    pares sustitutos, números en todas sus formas): cada hoja se busca con
+//    su JSON Pointer y debe dar el valor generado.
+// 2) Los mismos documentos mutados (bytes cambiados, insertados, borrados,
+//    truncados) y bytes al azar: nunca se lee fuera del buffer y, si se
+//    aceptan, los tokens son coherentes.
+// 3) Reensamblado: el documento troceado al azar llega íntegro; trozos
+//    desordenados, mensajes enormes y buzón lleno se descartan sin romper
+//    los mensajes siguientes.
+// 4) CommandDispatcher: toda respuesta es JSON válido.
+//
+// Cada entrada se copia a un buffer del heap de su tamaño exacto para que
+// ASan detecte cualquier lectura fuera de rango:
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined -I.. command_fuzz.cpp -o command_fuzz
+//   ./command_fuzz [iteraciones]      (termina con código 1 si algo falla)
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "include/CommandChannel.hpp"
+
+namespace {
+
+std::mt19937 rng(20240601);
+uint32_t failures = 0;
+
+#define EXPECT(cond, ...)                   \
+  do {                                      \
+    if (!(cond)) {                          \
+      if (failures++ < 20) {                \
+        printf("  FALLO %s:%d ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__);                \
+        printf("\n");                       \
+      }                                     \
+    }                                       \
+  } while (0)
+
+uint32_t pick(uint32_t n) { return std::uniform_int_distribution<uint32_t>(0, n - 1)(rng); }
+
+// === Generador ===
+struct Leaf {
+  std::string pointer;
+  JsonTokenType type;
+  std::string text;  // cadena decodificada o texto del número/literal
+};
+
+void appendUtf8(std::string& out, uint32_t code) {
+  char buffer[4];
+  size_t n;
+  if (code < 0x80) {
+    buffer[0] = (char)code;
+    n = 1;
+  } else if (code < 0x800) {
+    buffer[0] = (char)(0xC0 | code >> 6);
+    buffer[1] = (char)(0x80 | (code & 0x3F));
+    n = 2;
+  } else if (code < 0x10000) {
+    buffer[0] = (char)(0xE0 | code >> 12);
+    buffer[1] = (char)(0x80 | (code >> 6 & 0x3F));
+    buffer[2] = (char)(0x80 | (code & 0x3F));
+    n = 3;
+  } else {
+    buffer[0] = (char)(0xF0 | code >> 18);
+    buffer[1] = (char)(0x80 | (code >> 12 & 0x3F));
+    buffer[2] = (char)(0x80 | (code >> 6 & 0x3F));
+    buffer[3] = (char)(0x80 | (code & 0x3F));
+    n = 4;
+  }
+  out.append(buffer, n);
+}
+
+// Cadena aleatoria: `decoded` es lo que debe quedar tras des-escapar
+void randomString(std::string& json, std::string& decoded, bool pointerChars) {
+  json += '"';
+  const uint32_t len = pick(12);
+  for (uint32_t i = 0; i < len; i++) {
+    char hex[16];
+    switch (pick(pointerChars ? 10 : 8)) {
+      case 0: {
+        static const char ESCAPES[] = "\"\\/bfnrt";
+        static const char VALUES[] = "\"\\/\b\f\n\r\t";
+        const uint32_t k = pick(8);
+        json += '\\';
+        json += ESCAPES[k];
+        decoded += VALUES[k];
+        break;
+      }
+      case 1: {
+        uint32_t code = 1 + pick(0xD7FF);  // sin \u0000: cortaría la cadena C
+        snprintf(hex, sizeof(hex), "\\u%04X", (unsigned)code);
+        json += hex;
+        appendUtf8(decoded, code);
+        break;
+      }
+      case 2: {
+        const uint32_t code = 0x10000 + pick(0x100000);
+        snprintf(hex, sizeof(hex), "\\u%04x\\u%04x", (unsigned)(0xD800 + ((code - 0x10000) >> 10)),
+                 (unsigned)(0xDC00 + ((code - 0x10000) & 0x3FF)));
+        json += hex;
+        appendUtf8(decoded, code);
+        break;
+      }
+      case 3:
+        json += "ñ";
+        decoded += "ñ";
+        break;
+      case 8:
+        json += '/';
+        decoded += '/';
+        break;
+      case 9:
+        json += '~';
+        decoded += '~';
+        break;
+      default: {
+        const char c = (char)('a' + pick(26));
+        json += c;
+        decoded += c;
+      }
+    }
+  }
+  json += '"';
+}
+
+std::string randomNumber() {
+  std::string n;
+  if (pick(3) == 0) n += '-';
+  if (pick(4) == 0) {
+    n += '0';
+  } else {
+    n += (char)('1' + pick(9));
+    for (uint32_t i = pick(8); i > 0; i--) n += (char)('0' + pick(10));
+  }
+  if (pick(2)) {
+    n += '.';
+    for (uint32_t i = 1 + pick(5); i > 0; i--) n += (char)('0' + pick(10));
+  }
+  if (pick(3) == 0) {
+    n += pick(2) ? 'e' : 'E';
+    if (pick(2)) n += pick(2) ? '+' : '-';
+    for (uint32_t i = 1 + pick(2); i > 0; i--) n += (char)('0' + pick(10));
+  }
+  return n;
+}
+
+std::string escapePointer(const std::string& key) {
+  std::string out;
+  for (char c : key) {
+    if (c == '~') out += "~0";
+    else if (c == '/') out += "~1";
+    else out += c;
+  }
+  return out;
+}
+
+void space(std::string& json) {
+  static const char SPACES[] = " \t\r\n";
+  if (pick(4) == 0) json += SPACES[pick(4)];
+}
+
+void randomValue(std::string& json, const std::string& pointer, uint32_t depth, std::vector<Leaf>& leaves) {
+  space(json);
+  const uint32_t kind = depth >= 6 ? 2 + pick(3) : pick(5);
+  if (kind == 0) {
+    json += '{';
+    const uint32_t n = pick(5);
+    std::vector<std::string> keys;
+    for (uint32_t i = 0; i < n; i++) {
+      if (i > 0) json += ',';
+      space(json);
+      std::string key;
+      randomString(json, key, true);
+      space(json);
+      json += ':';
+      // Con claves repetidas, el puntero solo llega a la primera
+      bool duplicate = false;
+      for (const std::string& k : keys) duplicate |= k == key;
+      keys.push_back(key);
+      std::vector<Leaf> ignored;
+      randomValue(json, pointer + "/" + escapePointer(key), depth + 1, duplicate ? ignored : leaves);
+    }
+    space(json);
+    json += '}';
+  } else if (kind == 1) {
+    json += '[';
+    const uint32_t n = pick(5);
+    for (uint32_t i = 0; i < n; i++) {
+      if (i > 0) json += ',';
+      randomValue(json, pointer + "/" + std::to_string(i), depth + 1, leaves);
+    }
+    space(json);
+    json += ']';
+  } else if (kind == 2) {
+    std::string decoded;
+    randomString(json, decoded, false);
+    leaves.push_back({pointer, JsonTokenType::STRING, decoded});
+  } else if (kind == 3) {
+    const std::string n = randomNumber();
+    json += n;
+    leaves.push_back({pointer, JsonTokenType::NUMBER, n});
+  } else {
+    static const char* const WORDS[] = {"true", "false", "null"};
+    const char* word = WORDS[pick(3)];
+    json += word;
+    leaves.push_back({pointer, JsonTokenType::LITERAL, word});
+  }
+  space(json);
+}
+
+// === Comprobaciones ===
+constexpr size_t MAX_TOKENS = 512;
+JsonToken tokens[MAX_TOKENS];
+
+// Copia exacta en el heap: ASan ve cualquier acceso fuera de [0, len)
+struct ExactBuffer {
+  explicit ExactBuffer(const std::string& text) : len(text.size()), data(new char[len ? len : 1]) {
+    memcpy(data.get(), text.data(), len);
+  }
+  size_t len;
+  std::unique_ptr<char[]> data;
+};
+
+void checkTokens(const JsonTokenizer& json, size_t len) {
+  for (size_t i = 0; i < json.count(); i++) {
+    const JsonToken& t = json.token(i);
+    EXPECT(t.start <= t.end && t.end <= len, "token %zu fuera de rango", i);
+    EXPECT(t.next > i && t.next <= json.count(), "next incoherente en %zu", i);
+  }
+}
+
+void checkGenerated(uint32_t iterations) {
+  uint64_t lookups = 0;
+  for (uint32_t it = 0; it < iterations; it++) {
+    std::string text;
+    std::vector<Leaf> leaves;
+    randomValue(text, "", 0, leaves);
+    ExactBuffer buffer(text);
+    JsonTokenizer json(tokens, MAX_TOKENS);
+    if (!json.parse(buffer.data.get(), buffer.len)) {
+      EXPECT(false, "rechazado en %zu: %s", json.errorOffset(), text.c_str());
+      continue;
+    }
+    checkTokens(json, buffer.len);
+    for (const Leaf& leaf : leaves) {
+      lookups++;
+      const int i = json.find(leaf.pointer.c_str());
+      EXPECT(json.is(i, leaf.type), "puntero %s no encontrado", leaf.pointer.c_str());
+      if (!json.is(i, leaf.type)) continue;
+      if (leaf.type == JsonTokenType::STRING) {
+        EXPECT(leaf.text == json.string(i), "cadena distinta en %s", leaf.pointer.c_str());
+      } else if (leaf.type == JsonTokenType::NUMBER) {
+        double value = 0;
+        EXPECT(json.number(i, value) && value == strtod(leaf.text.c_str(), nullptr), "número distinto en %s",
+               leaf.pointer.c_str());
+      } else {
+        bool flag;
+        EXPECT(leaf.text == "null" ? json.isNull(i) : json.boolean(i, flag) && flag == (leaf.text == "true"),
+               "literal distinto en %s", leaf.pointer.c_str());
+      }
+    }
+  }
+  printf("generados: %u documentos, %llu punteros\n", iterations, (unsigned long long)lookups);
+}
+
+void checkMutated(uint32_t iterations) {
+  uint32_t accepted = 0;
+  for (uint32_t it = 0; it < iterations; it++) {
+    std::string text;
+    std::vector<Leaf> leaves;
+    if (pick(8) == 0) {
+      for (uint32_t n = pick(64); n > 0; n--) text += (char)pick(256);
+    } else {
+      randomValue(text, "", 0, leaves);
+      for (uint32_t m = 1 + pick(4); m > 0 && !text.empty(); m--) {
+        const size_t at = pick((uint32_t)text.size());
+        switch (pick(4)) {
+          case 0: text[at] = (char)pick(256); break;
+          case 1: text.insert(at, 1, "{}[]\",:\\0-eE.tfn "[pick(17)]); break;
+          case 2: text.erase(at, 1); break;
+          default: text.resize(at); break;
+        }
+      }
+    }
+    ExactBuffer buffer(text);
+    JsonTokenizer json(tokens, pick(4) == 0 ? 1 + pick(8) : MAX_TOKENS);  // también sin tokens suficientes
+    if (json.parse(buffer.data.get(), buffer.len)) {
+      accepted++;
+      checkTokens(json, buffer.len);
+      json.find("/a/0/~1/~0");
+    } else {
+      EXPECT(json.count() == 0, "tokens tras rechazo");
+    }
+  }
+  printf("mutados: %u entradas, %u aún válidas\n", iterations, accepted);
+}
+
+void checkInbox(uint32_t iterations) {
+  constexpr size_t CAPACITY = 257;  // hasta 256 B por mensaje
+  CommandInbox<2, CAPACITY> inbox;
+  uint32_t delivered = 0;
+  uint32_t expectedTooLarge = 0;
+  uint32_t scrambled = 0;
+  for (uint32_t it = 0; it < iterations; it++) {
+    std::string text;
+    std::vector<Leaf> leaves;
+    randomValue(text, "", 0, leaves);
+    const bool tooLarge = text.size() > CAPACITY - 1;
+    const bool scramble = !tooLarge && text.size() > 2 && pick(10) == 0;
+
+    // Trozos al azar; con `scramble` se intercambian dos
+    std::vector<std::pair<size_t, size_t>> pieces;
+    for (size_t at = 0; at < text.size();) {
+      const size_t n = std::min(text.size() - at, (size_t)1 + pick(64));
+      pieces.push_back({at, n});
+      at += n;
+    }
+    if (pieces.empty()) pieces.push_back({0, 0});
+    if (scramble && pieces.size() > 1) std::swap(pieces[0], pieces[1 + pick((uint32_t)pieces.size() - 1)]);
+
+    const uint32_t busyBefore = inbox.metrics().busy;
+    bool completed = false;
+    for (const auto& piece : pieces) {
+      ExactBuffer fragment(text.substr(piece.first, piece.second));
+      completed |= inbox.add(fragment.data.get(), fragment.len, piece.first, text.size()) == AssembleResult::COMPLETE;
+    }
+    const bool broken = scramble && pieces.size() > 1;
+    const bool busy = inbox.metrics().busy != busyBefore;
+    expectedTooLarge += tooLarge;
+    scrambled += broken;
+    if (tooLarge || broken || busy) {
+      EXPECT(!completed, "mensaje descartado que se completa");
+    } else {
+      EXPECT(completed, "mensaje válido sin completar (%zu B en %zu trozos)", text.size(), pieces.size());
+    }
+
+    // A veces se deja llenar el buzón antes de consumir
+    if (pick(3) != 0) {
+      size_t len = 0;
+      while (char* message = inbox.front(len)) {
+        delivered++;
+        EXPECT(message[len] == '\0', "mensaje sin terminar");
+        inbox.pop();
+      }
+      if (completed) {
+        // Vuelve a enviarlo entero y comprueba el contenido
+        ExactBuffer whole(text);
+        EXPECT(inbox.add(whole.data.get(), whole.len, 0, whole.len) == AssembleResult::COMPLETE, "reenvío");
+        char* message = inbox.front(len);
+        EXPECT(message && len == text.size() && memcmp(message, text.data(), len) == 0 && message[len] == '\0',
+               "contenido reensamblado distinto");
+        inbox.pop();
+      }
+    }
+  }
+  const CommandInboxMetrics& m = inbox.metrics();
+  printf("buzón: %u recibidos, %u entregados, %u grandes, %u desordenados, %u con buzón lleno\n", m.received,
+         delivered, m.tooLarge, m.broken, m.busy);
+  EXPECT(m.tooLarge == expectedTooLarge, "grandes %u != %u", m.tooLarge, expectedTooLarge);
+  EXPECT(m.broken >= scrambled, "desordenados %u < %u", m.broken, scrambled);
+}
+
+CommandStatus echoHandler(CommandRequest& request, CommandResult& result) {
+  double value;
+  int32_t integer;
+  bool flag;
+  if (request.number("/value", value)) result.number("value", value, 3);
+  if (request.integer("/n", integer)) result.integer("n", integer);
+  if (request.boolean("/flag", flag)) result.flag("flag", flag);
+  const char* text = request.string("/text");
+  if (text) result.text("text", text);
+  if (request.has("/fail")) {
+    request.setError("\"fail\" pedido");
+    return CommandStatus::FAILED;
+  }
+  return CommandStatus::OK;
+}
+
+void checkDispatcher(uint32_t iterations) {
+  static const CommandEntry TABLE[] = {{"echo", echoHandler}, {"ping", echoHandler}};
+  CommandDispatcher<64> dispatcher(TABLE, 2);
+  uint32_t replies = 0;
+  for (uint32_t it = 0; it < iterations; it++) {
+    std::string text;
+    switch (pick(4)) {
+      case 0: {
+        std::string ignored;
+        std::vector<Leaf> leaves;
+        text = "{\"cmd\":\"echo\",\"id\":";
+        randomString(text, ignored, true);
+        text += ",\"value\":" + randomNumber() + ",\"n\":" + std::to_string((int)pick(100000)) +
+                ",\"flag\":true,\"text\":";
+        randomString(text, ignored, false);
+        text += pick(4) == 0 ? ",\"fail\":1}" : "}";
+        break;
+      }
+      case 1:
+        text = pick(2) ? "{\"cmd\":\"nope\"}" : "texto libre";
+        break;
+      default: {
+        std::vector<Leaf> leaves;
+        randomValue(text, "", 0, leaves);
+        if (pick(2)) text.insert(0, "{\"cmd\":\"ping\",\"x\":");
+        if (pick(2)) text += "}";
+      }
+    }
+    ExactBuffer buffer(text);
+    char reply[256];
+    size_t replyLen = 0;
+    const size_t capacity = pick(8) == 0 ? 32 : sizeof(reply);  // respuestas que no caben
+    const CommandStatus status = dispatcher.handle(buffer.data.get(), buffer.len, reply, capacity, replyLen);
+    if (replyLen == 0) {
+      EXPECT(status == CommandStatus::NOT_COMMAND || capacity < sizeof(reply), "sin respuesta");
+      continue;
+    }
+    replies++;
+    EXPECT(reply[replyLen] == '\0', "respuesta sin terminar");
+    JsonTokenizer json(tokens, MAX_TOKENS);
+    EXPECT(json.parse(reply, replyLen), "respuesta no es JSON: %s", reply);
+    const char* name = json.string(json.find("/status"));
+    EXPECT(name && strcmp(name, CommandDispatcher<64>::statusName(status)) == 0, "status distinto");
+  }
+  printf("dispatcher: %u mensajes, %u respuestas | ok %u, malformados %u, desconocidos %u, fallidos %u, texto %u\n",
+         iterations, replies, dispatcher.count(CommandStatus::OK), dispatcher.count(CommandStatus::MALFORMED),
+         dispatcher.count(CommandStatus::UNKNOWN), dispatcher.count(CommandStatus::FAILED),
+         dispatcher.count(CommandStatus::NOT_COMMAND));
+}
+
+void checkPointerSyntax() {
+  std::string text = "{\"a/b\":1,\"m~n\":2,\"\":3,\"arr\":[10,20,30],\"o\":{\"\":{\"x\":true}}}";
+  ExactBuffer buffer(text);
+  JsonTokenizer json(tokens, MAX_TOKENS);
+  EXPECT(json.parse(buffer.data.get(), buffer.len), "ejemplo RFC 6901");
+  int32_t v = 0;
+  EXPECT(json.integer(json.find("/a~1b"), v) && v == 1, "~1");
+  EXPECT(json.integer(json.find("/m~0n"), v) && v == 2, "~0");
+  EXPECT(json.integer(json.find("/"), v) && v == 3, "clave vacía");
+  EXPECT(json.integer(json.find("/arr/2"), v) && v == 30, "índice");
+  EXPECT(json.find("/arr/3") < 0 && json.find("/arr/01") < 0 && json.find("/arr/-") < 0, "índices inválidos");
+  EXPECT(json.find("/m~2n") < 0 && json.find("/a~") < 0, "escapes inválidos");
+  EXPECT(json.find("") == 0 && json.find("x") < 0, "raíz");
+  bool flag = false;
+  EXPECT(json.boolean(json.find("/o//x"), flag) && flag, "segmento vacío");
+  EXPECT(!json.integer(json.find("/arr"), v), "tipo");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const uint32_t iterations = argc > 1 ? (uint32_t)atoi(argv[1]) : 200000;
+  checkPointerSyntax();
+  checkGenerated(iterations);
+  checkMutated(iterations);
+  checkInbox(iterations / 4);
+  checkDispatcher(iterations / 4);
+  printf("%s (%u fallos)\n", failures ? "FALLOS" : "OK", failures);
+  return failures ? 1 : 0;
+}
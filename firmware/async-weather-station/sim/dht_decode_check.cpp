@@ -0,0 +1,394 @@
+// =============================================================
+// === Decodificador y política del DHT11 (Dht11Async) ===
+// =============================================================
+// 1) Tramas sintéticas con ruido de ±6 µs en cada nivel para todas las
+//    humedades (0..100) y temperaturas (-20,0..60,0 en décimas): se decodifica
+//    exactamente lo generado.
+// 2) Bordes de tolerancia: justo dentro se acepta, justo fuera no.
+// 3) Tramas corruptas al azar: un bit cambiado (suma), cortes en cualquier
+//    punto, niveles estirados, pulsos espurios (se absorben), basura antes de la
+//    respuesta, sin respuesta y línea en corto. Nunca se acepta una trama
+//    con un solo bit cambiado.
+// 4) Política sobre una línea simulada: intervalo mínimo, reintento,
+//    invalidación tras maxFailures y captura que no termina.
+// 5) Coste de decodificar una trama.
+//
+//   ./dht_decode_check [tramas aleatorias]   (termina con código 1 si algo falla)
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "include/Dht11Async.hpp"
+
+namespace {
+
+std::mt19937 rng(20240611);
+uint32_t failures = 0;
+
+#define EXPECT(cond, ...)                             \
+  do {                                                \
+    if (!(cond)) {                                    \
+      if (failures++ < 20) {                          \
+        printf("  FALLO %s:%d ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__);                          \
+        printf("\n");                                 \
+      }                                               \
+    }                                                 \
+  } while (0)
+
+uint32_t pick(uint32_t n) { return std::uniform_int_distribution<uint32_t>(0, n - 1)(rng); }
+
+// === Generador ===
+// Tiempos nominales de la hoja de datos; spread = ruido máximo por nivel
+struct Timing {
+  uint16_t response = 80;
+  uint16_t bitLow = 50;
+  uint16_t zero = 27;
+  uint16_t one = 70;
+  uint16_t spread = 0;
+};
+
+uint16_t noisy(uint16_t us, uint16_t spread) {
+  return spread == 0 ? us : (uint16_t)(us - spread + pick(2u * spread + 1));
+}
+
+struct Frame {
+  uint8_t bytes[5];
+};
+
+Frame frameFor(uint8_t humidity, int tenthsC) {
+  const int magnitude = tenthsC < 0 ? -tenthsC : tenthsC;
+  Frame f = {{humidity, 0, (uint8_t)(magnitude / 10), (uint8_t)(magnitude % 10), 0}};
+  if (tenthsC < 0) f.bytes[3] |= 0x80;
+  f.bytes[4] = (uint8_t)(f.bytes[0] + f.bytes[1] + f.bytes[2] + f.bytes[3]);
+  return f;
+}
+
+// Lo que captura el RMT: cola del inicio, subida, respuesta, 40 bits y el
+// nivel bajo final
+std::vector<DhtRun> synth(const Frame& f, const Timing& t) {
+  std::vector<DhtRun> runs;
+  runs.push_back({0, (uint16_t)(2 + pick(4))});
+  runs.push_back({1, noisy(30, 10)});
+  runs.push_back({0, noisy(t.response, t.spread)});
+  runs.push_back({1, noisy(t.response, t.spread)});
+  for (size_t i = 0; i < 40; i++) {
+    const bool one = f.bytes[i / 8] & (0x80 >> (i % 8));
+    runs.push_back({0, noisy(t.bitLow, t.spread)});
+    runs.push_back({1, noisy(one ? t.one : t.zero, t.spread)});
+  }
+  runs.push_back({0, noisy(t.bitLow, t.spread)});
+  return runs;
+}
+
+DhtError decode(const std::vector<DhtRun>& runs, DhtFrame& out) { return decodeDht11(runs.data(), runs.size(), out); }
+
+DhtError decode(const std::vector<DhtRun>& runs) {
+  DhtFrame out;
+  return decode(runs, out);
+}
+
+// Índice del nivel alto del bit `bit` en synth()
+size_t highOf(size_t bit) { return 4 + 2 * bit + 1; }
+
+// === 1) Todas las lecturas ===
+void checkSweep() {
+  Timing t;
+  t.spread = 6;
+  uint32_t frames = 0;
+  for (int h = 0; h <= 100; h++) {
+    for (int tenths = -200; tenths <= 600; tenths++) {
+      if (h == 0 && tenths > -10 && tenths < 10) continue;  // todo ceros: se rechaza a propósito
+      DhtFrame out;
+      const DhtError e = decode(synth(frameFor((uint8_t)h, tenths), t), out);
+      frames++;
+      EXPECT(e == DhtError::NONE, "h=%d t=%d: %s", h, tenths, dhtErrorName(e));
+      if (e != DhtError::NONE) continue;
+      EXPECT(out.humidityPercent == (float)h, "humedad %d -> %.1f", h, out.humidityPercent);
+      EXPECT(lroundf(out.temperatureC * 10.0f) == tenths, "temperatura %d -> %.1f", tenths, out.temperatureC);
+    }
+  }
+  printf("barrido: %u tramas con ruido de ±%u µs\n", frames, (unsigned)t.spread);
+}
+
+// === 2) Bordes de tolerancia ===
+void checkTolerances() {
+  const Frame f = frameFor(55, 215);  // tiene unos y ceros en todos los bytes
+  struct Case {
+    const char* name;
+    Timing timing;
+    bool ok;
+  };
+  const Case cases[] = {
+      {"respuesta mínima", {DHT_RESPONSE_MIN_US, 50, 27, 70, 0}, true},
+      {"respuesta máxima", {DHT_RESPONSE_MAX_US, 50, 27, 70, 0}, true},
+      {"respuesta corta", {DHT_RESPONSE_MIN_US - 1, 50, 27, 70, 0}, false},
+      {"respuesta larga", {DHT_RESPONSE_MAX_US + 1, 50, 27, 70, 0}, false},
+      {"bajo mínimo", {80, DHT_BIT_LOW_MIN_US, 27, 70, 0}, true},
+      {"bajo máximo", {80, DHT_BIT_LOW_MAX_US, 27, 70, 0}, true},
+      {"bajo corto", {80, DHT_BIT_LOW_MIN_US - 1, 27, 70, 0}, false},
+      {"bajo largo", {80, DHT_BIT_LOW_MAX_US + 1, 27, 70, 0}, false},
+      {"cero máximo", {80, 50, DHT_ZERO_MAX_US, 70, 0}, true},
+      {"cero ambiguo", {80, 50, DHT_ZERO_MAX_US + 1, 70, 0}, false},
+      {"uno mínimo", {80, 50, 27, DHT_ONE_MIN_US, 0}, true},
+      {"uno máximo", {80, 50, 27, DHT_ONE_MAX_US, 0}, true},
+      {"uno ambiguo", {80, 50, 27, DHT_ONE_MIN_US - 1, 0}, false},
+      {"uno largo", {80, 50, 27, DHT_ONE_MAX_US + 1, 0}, false},
+  };
+  for (const Case& c : cases) {
+    DhtFrame out;
+    const DhtError e = decode(synth(f, c.timing), out);
+    EXPECT((e == DhtError::NONE) == c.ok, "%s: %s", c.name, dhtErrorName(e));
+    if (e == DhtError::NONE) EXPECT(out.humidityPercent == 55.0f && out.temperatureC == 21.5f, "%s: valor", c.name);
+  }
+  printf("tolerancias: %u casos\n", (unsigned)(sizeof(cases) / sizeof(cases[0])));
+}
+
+// === 3) Tramas corruptas ===
+void checkCorrupted(uint32_t iterations) {
+  Timing t;
+  t.spread = 4;
+  uint32_t counts[DHT_ERROR_COUNT] = {};
+  for (uint32_t it = 0; it < iterations; it++) {
+    const Frame f = frameFor((uint8_t)(1 + pick(100)), (int)pick(801) - 200);
+    const std::vector<DhtRun> clean = synth(f, t);
+
+    // Un bit cambiado: siempre lo detecta la suma (o el rango)
+    {
+      std::vector<DhtRun> runs = clean;
+      const size_t bit = pick(40);
+      const size_t i = highOf(bit);
+      runs[i].us = runs[i].us > DHT_ZERO_MAX_US ? noisy(t.zero, t.spread) : noisy(t.one, t.spread);
+      const DhtError e = decode(runs);
+      counts[(size_t)e]++;
+      EXPECT(e == DhtError::CHECKSUM || e == DhtError::OUT_OF_RANGE, "bit %u cambiado: %s", (unsigned)bit,
+             dhtErrorName(e));
+    }
+    // Cortada en cualquier punto
+    {
+      const size_t keep = pick((uint32_t)clean.size() - 1);
+      const std::vector<DhtRun> runs(clean.begin(), clean.begin() + keep);
+      const DhtError e = decode(runs);
+      counts[(size_t)e]++;
+      EXPECT(e == DhtError::TRUNCATED || e == DhtError::NO_RESPONSE, "cortada en %u: %s", (unsigned)keep,
+             dhtErrorName(e));
+    }
+    // Un nivel estirado (sensor colgado a mitad de trama)
+    {
+      std::vector<DhtRun> runs = clean;
+      const size_t i = 4 + pick(80);
+      runs[i].us = (uint16_t)(150 + pick(1000));
+      const DhtError e = decode(runs);
+      counts[(size_t)e]++;
+      EXPECT(e == DhtError::BAD_TIMING, "nivel %u estirado: %s", (unsigned)i, dhtErrorName(e));
+    }
+    // Pulsos espurios más cortos que DHT_GLITCH_US dentro de un nivel: se absorben
+    {
+      std::vector<DhtRun> runs = clean;
+      for (int g = 0; g < 3; g++) {
+        size_t i = 2 + pick((uint32_t)runs.size() - 3);
+        while (runs[i].us < 20) i--;  // no partir un pulso espurio ya insertado
+        const uint16_t us = runs[i].us;
+        const uint16_t glitch = (uint16_t)(1 + pick(DHT_GLITCH_US - 1));
+        const uint16_t first = (uint16_t)((us - glitch) / 2);
+        runs[i].us = first;
+        runs.insert(runs.begin() + i + 1, {DhtRun{(uint8_t)!runs[i].level, glitch},
+                                           DhtRun{runs[i].level, (uint16_t)(us - glitch - first)}});
+      }
+      DhtFrame out;
+      const DhtError e = decode(runs, out);
+      EXPECT(e == DhtError::NONE && out.bytes[4] == f.bytes[4], "con pulsos espurios: %s", dhtErrorName(e));
+    }
+    // Basura antes de la respuesta (otro flanco al soltar la línea)
+    {
+      std::vector<DhtRun> runs = clean;
+      runs.insert(runs.begin() + 2, {DhtRun{0, (uint16_t)(8 + pick(20))}, DhtRun{1, (uint16_t)(8 + pick(20))}});
+      const DhtError e = decode(runs);
+      EXPECT(e == DhtError::NONE, "basura antes de la respuesta: %s", dhtErrorName(e));
+    }
+  }
+  // Sin respuesta: solo el flanco de soltar; línea en corto a nivel bajo
+  {
+    const std::vector<DhtRun> released = {{0, 3}, {1, 0}};
+    EXPECT(decode(released) == DhtError::NO_RESPONSE, "sin respuesta");
+    const std::vector<DhtRun> stuck = {{0, 0xFFFF}};
+    EXPECT(decode(stuck) == DhtError::NO_RESPONSE, "línea en corto");
+    DhtFrame out;
+    EXPECT(decodeDht11(nullptr, 0, out) == DhtError::NO_RESPONSE, "captura vacía");
+  }
+  // Bits sin respuesta delante: no se confunden con ella
+  {
+    std::vector<DhtRun> runs = synth(frameFor(40, 200), Timing());
+    runs.erase(runs.begin() + 2, runs.begin() + 4);
+    EXPECT(decode(runs) != DhtError::NONE, "trama sin pulso de respuesta aceptada");
+  }
+  // Suma correcta pero todo ceros (línea con pull-down) o décimas imposibles
+  {
+    Frame zero = {{0, 0, 0, 0, 0}};
+    EXPECT(decode(synth(zero, Timing())) == DhtError::OUT_OF_RANGE, "todo ceros");
+    Frame tenths = {{40, 0, 20, 12, 72}};
+    EXPECT(decode(synth(tenths, Timing())) == DhtError::OUT_OF_RANGE, "décimas > 9");
+    Frame wet = {{120, 0, 20, 0, 140}};
+    EXPECT(decode(synth(wet, Timing())) == DhtError::OUT_OF_RANGE, "humedad > 100");
+  }
+  printf("corruptas: %u tramas | suma %u, rango %u, cortadas %u, sin respuesta %u, tiempos %u\n", iterations * 5,
+         counts[(size_t)DhtError::CHECKSUM], counts[(size_t)DhtError::OUT_OF_RANGE],
+         counts[(size_t)DhtError::TRUNCATED], counts[(size_t)DhtError::NO_RESPONSE],
+         counts[(size_t)DhtError::BAD_TIMING]);
+}
+
+// === 4) Política ===
+// Cada intento consume el siguiente resultado del guion: trama buena,
+// trama con la suma mal o captura que no termina
+enum class Outcome { GOOD, BAD_CHECKSUM, SILENT };
+
+class ScriptedLine : public DhtLine {
+ public:
+  std::vector<Outcome> script;
+  size_t next = 0;
+  uint32_t starts = 0;
+  uint32_t aborts = 0;
+  bool low = false;
+
+  void driveLow() override {
+    low = true;
+    starts++;
+  }
+  bool releaseAndCapture() override {
+    low = false;
+    const Outcome o = next < script.size() ? script[next++] : Outcome::GOOD;
+    runs_.clear();
+    if (o != Outcome::SILENT) {
+      Frame f = frameFor(61, 234);
+      if (o == Outcome::BAD_CHECKSUM) f.bytes[4] ^= 1;
+      runs_ = synth(f, Timing());
+    }
+    pending_ = o != Outcome::SILENT;
+    return true;
+  }
+  bool captured(const DhtRun*& runs, size_t& count) override {
+    if (!pending_) return false;
+    runs = runs_.data();
+    count = runs_.size();
+    return true;
+  }
+  void abortCapture() override { aborts++; }
+
+ private:
+  std::vector<DhtRun> runs_;
+  bool pending_ = false;
+};
+
+// Lo que hace el planificador: start() y poll() mientras pidan espera.
+// Devuelve el instante en que termina.
+uint32_t run(Dht11Async& dht, uint32_t nowMs) {
+  uint32_t wait = dht.start(nowMs);
+  while (wait > 0) {
+    nowMs += wait;
+    wait = dht.poll(nowMs);
+  }
+  return nowMs;
+}
+
+void checkPolicy() {
+  ScriptedLine line;
+  Dht11Async dht(&line);
+  Dht11Config config;
+  dht.configure(config);
+  EXPECT(!dht.valid() && !dht.takeUpdate(), "sin lectura al arrancar");
+
+  // Lectura buena: 20 ms de inicio + captura
+  uint32_t now = 1000;
+  uint32_t end = run(dht, now);
+  EXPECT(dht.takeUpdate() && dht.valid() && dht.temperatureC() == 23.4f && dht.humidityPercent() == 61.0f,
+         "primera lectura");
+  EXPECT(end - now <= config.startLowMs + config.capturePollMs, "lectura en %u ms", (unsigned)(end - now));
+
+  // Antes de minIntervalMs no se toca la línea
+  const uint32_t starts = line.starts;
+  EXPECT(dht.start(now + 500) == 0 && line.starts == starts && dht.cacheHits() == 1, "caché de intervalo mínimo");
+  EXPECT(dht.valid() && !dht.takeUpdate(), "la caché conserva el valor");
+
+  // Un fallo se reintenta al cumplirse el intervalo mínimo y no invalida
+  line.script = {Outcome::BAD_CHECKSUM, Outcome::GOOD};
+  now += 2000;
+  end = run(dht, now);
+  EXPECT(line.starts == starts + 2 && dht.lastError() == DhtError::NONE && dht.consecutiveFailures() == 0,
+         "reintento tras suma mal");
+  EXPECT(end - now >= config.minIntervalMs, "reintento antes del intervalo mínimo (%u ms)", (unsigned)(end - now));
+  EXPECT(dht.errors(DhtError::CHECKSUM) == 1 && dht.takeUpdate(), "contador de suma");
+
+  // Lecturas fallidas (con su reintento): el valor se mantiene hasta maxFailures
+  line.script.clear();
+  line.next = 0;
+  for (uint8_t i = 1; i <= config.maxFailures; i++) {
+    line.script.push_back(Outcome::BAD_CHECKSUM);
+    line.script.push_back(Outcome::SILENT);
+  }
+  for (uint8_t i = 1; i <= config.maxFailures; i++) {
+    now += 2000;
+    run(dht, now);
+    EXPECT(dht.takeUpdate() && dht.consecutiveFailures() == i, "fallo %u", (unsigned)i);
+    EXPECT(dht.valid() == (i < config.maxFailures), "validez tras %u fallos", (unsigned)i);
+  }
+  EXPECT(isnan(dht.temperatureC()) && isnan(dht.humidityPercent()), "NAN tras maxFailures");
+  EXPECT(line.aborts == config.maxFailures && dht.errors(DhtError::NO_RESPONSE) == config.maxFailures,
+         "captura sin final abortada (%u)", (unsigned)line.aborts);
+
+  // Se recupera con la primera lectura buena
+  now += 2000;
+  run(dht, now);
+  EXPECT(dht.valid() && dht.consecutiveFailures() == 0, "recuperado");
+
+  // Sin reintentos: un fallo por lectura
+  Dht11Config single = config;
+  single.maxRetries = 0;
+  dht.configure(single);
+  line.script = {Outcome::BAD_CHECKSUM};
+  line.next = 0;
+  const uint32_t before = line.starts;
+  now += 2000;
+  run(dht, now);
+  EXPECT(line.starts == before + 1 && dht.consecutiveFailures() == 1, "maxRetries = 0");
+
+  // start() durante una lectura no la reinicia
+  now += 2000;
+  EXPECT(dht.start(now) > 0 && dht.start(now + 5) == 0 && dht.phase() == Dht11Async::Phase::START_LOW,
+         "start() en curso");
+  printf("política: %u intentos, %u en caché\n", (unsigned)dht.attempts(), (unsigned)dht.cacheHits());
+}
+
+// === 5) Coste ===
+void benchDecode() {
+  Timing t;
+  t.spread = 4;
+  std::vector<std::vector<DhtRun>> frames;
+  for (int i = 0; i < 64; i++) frames.push_back(synth(frameFor((uint8_t)(20 + i), 100 + 3 * i), t));
+  const uint32_t calls = 200000;
+  uint32_t sink = 0;
+  const auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < calls; i++) {
+    DhtFrame out;
+    sink += (uint32_t)decode(frames[i % frames.size()], out) + out.bytes[0];
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  printf("coste: %.0f ns por trama en el host (%u)\n",
+         std::chrono::duration<double, std::nano>(t1 - t0).count() / calls, sink % 2);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const uint32_t iterations = argc > 1 ? (uint32_t)atoi(argv[1]) : 20000;
+  checkSweep();
+  checkTolerances();
+  checkCorrupted(iterations);
+  checkPolicy();
+  benchDecode();
+  printf("%s (%u fallos)\n", failures ? "FALLOS" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,363 @@
+// =============================================================
+// === Pantalla por regiones sucias (DisplayPages.hpp) ===
+// =============================================================
+// Con un framebuffer en memoria de 128x64 en páginas de 8 filas, como el
+// del SSD1306, y una copia del panel que solo recibe lo que flush() envía
+// (con el mismo troceo en transacciones que Ssd1306Device):
+// 1) El primer render() vuelca la pantalla entera; sin cambios, o con un
+//    setText() del mismo texto, no se dibuja ni se envía nada.
+// 2) Cambiar el reloj solo envía sus columnas de la página 0; dos widgets
+//    en esquinas opuestas no arrastran lo que hay entre ellos; un texto
+//    más corto borra los restos del anterior; un widget de tamaño 2 ocupa
+//    dos páginas.
+// 3) 20 000 pasos al azar (textos, cambios de página): tras cada render()
+//    el panel es idéntico a redibujar todo desde cero, y la región enviada
+//    es exactamente la unión de las cajas que cambiaron.
+// 4) Tiempo por refresco: una hora con el reloj cada segundo y los valores
+//    cada 30 s (lo que hace el sketch), en bytes I2C y µs de bus a
+//    400 kHz, frente a volcar la pantalla completa cada vez; más el coste
+//    de dibujo en el host.
+//
+//   g++ -std=c++17 -O2 -I.. display_check.cpp -o display_check
+//   ./display_check   (termina con código 1 si algo falla)
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <random>
+
+#include "include/DisplayPages.hpp"
+
+namespace {
+
+uint32_t failures = 0;
+
+#define EXPECT(cond, ...)                             \
+  do {                                                \
+    if (!(cond)) {                                    \
+      if (failures++ < 20) {                          \
+        printf("  FALLO %s:%d ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__);                          \
+        printf("\n");                                 \
+      }                                               \
+    }                                                 \
+  } while (0)
+
+constexpr int16_t WIDTH = DirtyRegion::WIDTH;
+constexpr int16_t PAGES = DirtyRegion::PAGES;
+constexpr size_t CHUNK = 31;             // I2C_BUFFER_LENGTH - 1 en el ESP32
+constexpr uint32_t I2C_CLOCK_HZ = 400000;
+
+// === Framebuffer en memoria ===
+class MemoryDisplay : public DisplayDevice {
+ public:
+  uint8_t frame[PAGES][WIDTH] = {};
+  uint8_t panel[PAGES][WIDTH] = {};  // lo que muestra el SSD1306
+  DirtyRegion lastRegion;
+  uint32_t flushes = 0;
+  uint32_t transactions = 0;  // de la última llamada a flush()
+  uint64_t totalTransactions = 0;
+
+  void clearRect(int16_t x, int16_t y, int16_t w, int16_t h) override {
+    for (int16_t yy = y; yy < y + h; yy++) {
+      for (int16_t xx = x; xx < x + w; xx++) setPixel(xx, yy, false);
+    }
+  }
+
+  // Glifos de 5x7 derivados del código (como el HAL simulado): textos
+  // distintos dan píxeles distintos
+  void drawText(int16_t x, int16_t y, uint8_t size, const char* text) override {
+    for (size_t i = 0; text[i]; i++) {
+      const uint8_t c = (uint8_t)text[i];
+      for (int16_t col = 0; col < 5; col++) {
+        const uint8_t bits = c == ' ' ? 0 : (uint8_t)(((c * 37u + col * 11u) & 0x7F) | 0x01);
+        for (int16_t row = 0; row < 7; row++) {
+          if (!(bits & (1u << row))) continue;
+          for (int16_t sy = 0; sy < size; sy++) {
+            for (int16_t sx = 0; sx < size; sx++) {
+              setPixel(x + (int16_t)(i * 6 + col) * size + sx, y + row * size + sy, true);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  size_t flush(const DirtyRegion& region) override {
+    lastRegion = region;
+    flushes++;
+    transactions = 0;
+    size_t bytes = 0;
+    for (int16_t page = 0; page < PAGES; page++) {
+      if (!region.pageDirty(page)) continue;
+      bytes += 1 + 6;  // COLUMNADDR/PAGEADDR
+      transactions++;
+      for (size_t col = region.col0[page]; col <= region.col1[page];) {
+        size_t n = region.col1[page] + 1 - col;
+        if (n > CHUNK) n = CHUNK;
+        memcpy(&panel[page][col], &frame[page][col], n);
+        bytes += 1 + n;
+        transactions++;
+        col += n;
+      }
+    }
+    totalTransactions += transactions;
+    return bytes;
+  }
+
+ private:
+  void setPixel(int16_t x, int16_t y, bool on) {
+    if (x < 0 || x >= WIDTH || y < 0 || y >= PAGES * 8) return;
+    const uint8_t bit = (uint8_t)(1u << (y & 7));
+    if (on) {
+      frame[y / 8][x] |= bit;
+    } else {
+      frame[y / 8][x] &= (uint8_t)~bit;
+    }
+  }
+};
+
+// Bus a 400 kHz: 9 bits por byte más arranque, dirección y parada por transacción
+double busUs(size_t bytes, uint64_t transactions) {
+  return (double)(bytes * 9 + transactions * (9 + 2)) * 1e6 / I2C_CLOCK_HZ;
+}
+
+uint32_t hostUs() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Distribución del sketch: título y reloj en la fila 0, campos debajo
+constexpr size_t PAGE_COUNT = 3;
+constexpr size_t WIDGETS = 16;
+using Display = PagedDisplay<PAGE_COUNT, WIDGETS>;
+
+struct Layout {
+  int clock[PAGE_COUNT];
+  int fields[PAGE_COUNT][6];
+  int big = -1;  // tamaño 2 en la página 2, en lugar de sus dos primeros campos
+};
+
+int addField(Display& d, int page, uint8_t row, const char* label) {
+  const uint8_t labelLen = (uint8_t)strlen(label);
+  if (labelLen > 0) d.setText(page, d.addText(page, 0, row, labelLen), label);
+  return d.addText(page, labelLen, row, DISPLAY_TEXT_COLUMNS - labelLen);
+}
+
+Layout build(Display& d) {
+  static const char* const TITLES[PAGE_COUNT] = {"Resumen", "Viento/Luz", "Grande"};
+  static const char* const LABELS[6] = {"T: ", "H: ", "Pres: ", "Viento: ", "Gas: ", ""};
+  Layout l;
+  for (int p = 0; p < (int)PAGE_COUNT; p++) {
+    d.addPage(TITLES[p]);
+    d.printf(p, d.addText(p, 0, 0, 13), "%s %d/%d", TITLES[p], p + 1, (int)PAGE_COUNT);
+    l.clock[p] = d.addText(p, 13, 0, 8);
+    for (int f = p == 2 ? 2 : 0; f < 5; f++) l.fields[p][f] = addField(d, p, (uint8_t)(2 + f), LABELS[f]);
+    l.fields[p][5] = addField(d, p, 7, LABELS[5]);
+  }
+  l.fields[2][0] = l.fields[2][1] = -1;
+  l.big = d.addText(2, 4, 2, 6, 2);  // filas de texto 2-3, columnas 24..95
+  return l;
+}
+
+bool panelEquals(const MemoryDisplay& a, const uint8_t (&frame)[PAGES][WIDTH]) {
+  return memcmp(a.panel, frame, sizeof(frame)) == 0;
+}
+
+bool regionIs(const DirtyRegion& r, int16_t page, int16_t col0, int16_t col1) {
+  for (int16_t p = 0; p < PAGES; p++) {
+    if (p == page) {
+      if (r.col0[p] != col0 || r.col1[p] != col1) return false;
+    } else if (r.pageDirty(p)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// === 1) y 2) Casos sueltos ===
+void checkBasics() {
+  Display display(nullptr);
+  const Layout l = build(display);
+  MemoryDisplay dev;
+
+  EXPECT(display.render(dev), "primer render()");
+  EXPECT(dev.lastRegion.bytes() == (size_t)WIDTH * PAGES && display.metrics().lastBytes == 1024 + 8 * 7 + 8 * 5,
+         "pantalla completa: %u bytes I2C", (unsigned)display.metrics().lastBytes);
+  EXPECT(panelEquals(dev, dev.frame), "el panel es el framebuffer");
+
+  EXPECT(!display.render(dev) && dev.flushes == 1, "sin cambios no se vuelca");
+  display.setText(0, l.fields[0][0], "");  // ya estaba vacío
+  display.printf(0, 0, "%s %d/%d", "Resumen", 1, (int)PAGE_COUNT);
+  EXPECT(!display.render(dev), "setText() con el mismo texto");
+
+  // El reloj: columnas 13..20 de texto = 78..125 px, solo la página 0
+  display.setText(0, l.clock[0], "12:00:01");
+  EXPECT(display.render(dev) && regionIs(dev.lastRegion, 0, 78, 125), "región del reloj: página 0, %u..%u",
+         dev.lastRegion.col0[0], dev.lastRegion.col1[0]);
+  EXPECT(display.metrics().lastBytes == 7 + 48 + 2 && dev.transactions == 3, "reloj: %u bytes en %u transacciones",
+         (unsigned)display.metrics().lastBytes, (unsigned)dev.transactions);
+  EXPECT(panelEquals(dev, dev.frame), "panel tras el reloj");
+
+  // Reloj (arriba a la derecha) y estado (abajo a la izquierda)
+  display.setText(0, l.clock[0], "12:00:02");
+  display.setText(0, l.fields[0][5], "MQTT ok");
+  display.render(dev);
+  const DirtyRegion& r = dev.lastRegion;
+  bool onlyCorners = r.col0[0] == 78 && r.col1[0] == 125 && r.col0[7] == 0 && r.col1[7] == 125;
+  for (int16_t p = 1; p < 7; p++) onlyCorners = onlyCorners && !r.pageDirty(p);
+  EXPECT(onlyCorners && r.bytes() == 48 + 126, "esquinas opuestas: %u bytes de imagen", (unsigned)r.bytes());
+
+  // Un texto más corto no deja restos del anterior
+  display.setText(0, l.fields[0][0], "-12.5 C");
+  display.render(dev);
+  display.setText(0, l.fields[0][0], "3 C");
+  display.render(dev);
+  Display fresh(nullptr);
+  const Layout lf = build(fresh);
+  MemoryDisplay freshDev;
+  fresh.setText(0, lf.clock[0], "12:00:02");
+  fresh.setText(0, lf.fields[0][5], "MQTT ok");
+  fresh.setText(0, lf.fields[0][0], "3 C");
+  fresh.render(freshDev);
+  EXPECT(panelEquals(dev, freshDev.frame), "texto más corto: quedan píxeles del anterior");
+
+  // Tamaño 2: filas 16..31, páginas 2 y 3
+  display.show(2);
+  display.render(dev);
+  display.setText(2, l.big, "21.5");
+  display.render(dev);
+  const DirtyRegion& big = dev.lastRegion;
+  EXPECT(big.pageDirty(2) && big.pageDirty(3) && big.col0[2] == 24 && big.col1[2] == 95 && big.col0[3] == 24 &&
+             big.col1[3] == 95 && big.bytes() == 2 * 72,
+         "widget de tamaño 2: %u bytes", (unsigned)big.bytes());
+
+  // Cambiar de página redibuja todo; lo de otra página no ensucia la actual
+  display.setText(0, l.clock[0], "12:00:03");
+  EXPECT(!display.render(dev), "cambio en una página no visible");
+  display.show(0);
+  EXPECT(display.render(dev) && dev.lastRegion.bytes() == (size_t)WIDTH * PAGES, "cambio de página");
+}
+
+// === 3) Al azar contra redibujar desde cero ===
+void checkRandom() {
+  Display display(nullptr);
+  Display reference(nullptr);
+  const Layout l = build(display);
+  build(reference);
+  MemoryDisplay dev;
+  MemoryDisplay refDev;
+  std::mt19937 rng(5);
+  uint32_t mismatched = 0;
+  uint32_t loose = 0;
+  uint32_t renders = 0;
+  display.render(dev);
+
+  for (int step = 0; step < 20000; step++) {
+    // Cajas que deberían enviarse en este paso
+    DirtyRegion expected;
+    const bool switchPage = rng() % 50 == 0;
+    const int changes = (int)(rng() % 4);
+    for (int c = 0; c < changes; c++) {
+      const int page = (int)(rng() % PAGE_COUNT);
+      const int which = (int)(rng() % 7);
+      char text[24];
+      snprintf(text, sizeof(text), "%u.%u", (unsigned)(rng() % 1000), (unsigned)(rng() % 10));
+      int widget;
+      int16_t x;
+      int16_t y;
+      int16_t w;
+      int16_t h = 8;
+      if (which == 6) {
+        widget = l.clock[page];
+        snprintf(text, sizeof(text), "%02u:%02u:%02u", (unsigned)(rng() % 24), (unsigned)(rng() % 60),
+                 (unsigned)(rng() % 60));
+        x = 78, y = 0, w = 48;
+      } else if (page == 2 && which < 2) {
+        widget = l.big;
+        x = 24, y = 16, w = 72, h = 16;
+      } else {
+        const int f = which;
+        static const uint8_t LABEL_LEN[6] = {3, 3, 6, 8, 5, 0};
+        widget = l.fields[page][f];
+        x = LABEL_LEN[f] * 6, y = (int16_t)((f == 5 ? 7 : 2 + f) * 8), w = (int16_t)((21 - LABEL_LEN[f]) * 6);
+      }
+      if (strncmp(display.text(page, widget), text, DISPLAY_TEXT_COLUMNS) != 0 && page == display.current()) {
+        expected.add(x, y, w, h);
+      }
+      display.setText(page, widget, text);
+      reference.setText(page, widget, text);
+    }
+    if (switchPage) {
+      const int page = (int)(rng() % PAGE_COUNT);
+      if (page != display.current()) expected.add(0, 0, WIDTH, PAGES * 8);
+      display.show(page);
+      reference.show(page);
+    }
+    if (display.render(dev)) {
+      renders++;
+      if (memcmp(dev.lastRegion.col0, expected.col0, PAGES) != 0 ||
+          memcmp(dev.lastRegion.col1, expected.col1, PAGES) != 0) {
+        loose++;
+      }
+    } else if (!expected.empty()) {
+      loose++;
+    }
+    reference.invalidate();
+    reference.render(refDev);
+    if (!panelEquals(dev, refDev.frame)) mismatched++;
+  }
+  EXPECT(mismatched == 0, "%u pasos con el panel distinto de redibujar desde cero", (unsigned)mismatched);
+  EXPECT(loose == 0, "%u refrescos con una región distinta de la unión de cajas cambiadas", (unsigned)loose);
+  printf("al azar: %u refrescos comparados con redibujar la página desde cero\n", (unsigned)renders);
+}
+
+// === 4) Tiempo por refresco ===
+void checkFrameTime() {
+  Display display(hostUs);
+  const Layout l = build(display);
+  MemoryDisplay dev;
+  display.render(dev);
+  display.resetMetrics();
+  dev.totalTransactions = 0;
+  std::mt19937 rng(9);
+
+  const uint32_t seconds = 3600;
+  for (uint32_t s = 1; s <= seconds; s++) {
+    char clock[9];
+    snprintf(clock, sizeof(clock), "%02u:%02u:%02u", (unsigned)(12 + s / 3600), (unsigned)(s / 60 % 60),
+             (unsigned)(s % 60));
+    for (int p = 0; p < (int)PAGE_COUNT; p++) display.setText(p, l.clock[p], clock);
+    if (s % 30 == 0) {
+      display.printf(0, l.fields[0][0], "%.1f C", 18.0f + (rng() % 20) / 10.0f);
+      display.printf(0, l.fields[0][1], "%.1f %%", 60.0f + (rng() % 10) / 10.0f);
+      display.printf(0, l.fields[0][2], "%.1f hPa", 1013.0f + (rng() % 5) / 10.0f);
+      display.printf(0, l.fields[0][3], "%.1f km/h", (rng() % 200) / 10.0f);
+    }
+    display.render(dev);
+  }
+  const DisplayMetrics& m = display.metrics();
+  const double avgBytes = (double)m.totalBytes / m.refreshes;
+  const double avgBus = busUs(m.totalBytes, dev.totalTransactions) / m.refreshes;
+  const size_t fullBytes = 1024 + 8 * 7 + 8 * 5;
+  const double fullBus = busUs(fullBytes, 8 * 6);
+  printf("una hora a 1 Hz: %u refrescos, %.1f B y %.0f us de bus por refresco (máx. %u B), "
+         "frente a %zu B y %.0f us volcando todo: %.1f %%; dibujo en el host %u us máx.\n",
+         (unsigned)m.refreshes, avgBytes, avgBus, (unsigned)m.maxBytes, fullBytes, fullBus, 100.0 * avgBus / fullBus,
+         (unsigned)m.maxUs);
+  EXPECT(m.refreshes == seconds, "un refresco por segundo: %u", (unsigned)m.refreshes);
+  EXPECT(avgBytes * 10 < fullBytes, "el volcado parcial debería ser menos del 10 %% del completo");
+  EXPECT(m.maxBytes <= 57 + 4 * (7 + 108 + 4), "el peor refresco (reloj + 4 valores): %u B", (unsigned)m.maxBytes);
+}
+
+}  // namespace
+
+int main() {
+  checkBasics();
+  checkRandom();
+  checkFrameTime();
+  printf("%s (%u fallos)\n", failures ? "FALLOS" : "OK", failures);
+  return failures ? 1 : 0;
+}
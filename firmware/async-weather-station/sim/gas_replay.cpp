@@ -0,0 +1,320 @@
+// =============================================================
+// === Reproducción de trazas del MQ-2 (GasSensor.hpp) ===
+// =============================================================
+// Pasa tramas del ADC continuo por Mq2Sensor tal como lo hace sampleGas():
+//  - sintéticas: la columna gas_raw de una traza (SensorTrace.hpp) en tramas
+//    de 50 ms con el ruido de una conversión promediado (σ/√N) y picos de la
+//    radio en tramas sueltas, el mismo modelo que el HAL de la simulación;
+//  - grabadas: CSV "t_ms,mv,raw" con las medias que da analogContinuousRead().
+// Informa de:
+//  1) calendario de calentamiento y calibración y R0 frente al real;
+//  2) ruido (diferencias entre tramas consecutivas) y error por el ruido y
+//     los picos, trama cruda frente a mediana + IIR (el retraso del filtro no
+//     cuenta: se compara con la misma traza sin ruido);
+//  3) cambios de calidad con y sin histéresis, en la traza y con el gas
+//     oscilando justo en un umbral;
+//  4) reinicio con el R0 guardado: listo al acabar el calentamiento y con
+//     las mismas ppm.
+// Con tramas grabadas no hay valor real: solo 2) sin error, 3) y 4).
+//
+//   ./build/gas_replay [--trace CSV | --frames CSV] [--duration-h H] [--seed N] [--write-frames CSV]
+//   (termina con código 1 si alguna comprobación falla)
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "include/GasSensor.hpp"
+#include "sim/SensorTrace.hpp"
+
+#ifndef SIM_TRACES_DIR
+#define SIM_TRACES_DIR "sim/traces"
+#endif
+
+namespace {
+
+// Lo mismo que config.h y el HAL (Arduino.h, arduino.cpp)
+constexpr uint32_t FRAME_MS = 50;             // MQ2_ADC_CONVERSIONS / MQ2_ADC_FREQ_HZ
+constexpr uint32_t CONVERSIONS = 1000;
+constexpr float NOISE_COUNTS = 25.0f;
+constexpr uint32_t SPIKE_ONE_IN = 200;
+constexpr float SPIKE_COUNTS = 350.0f;
+
+struct Frame {
+  uint32_t tMs;
+  float mv;
+  float raw;
+  float truthMv;  // NAN en tramas grabadas
+};
+
+float countsToMv(float raw) { return raw * 3300.0f / 4095.0f; }
+
+// Tramas de FRAME_MS con el valor de `rawAt(t_s)` más ruido y picos
+template <typename RawAt>
+std::vector<Frame> synthesize(RawAt rawAt, double durationS, uint64_t seed, bool noisy = true) {
+  std::mt19937_64 rng(seed);
+  std::normal_distribution<float> noise(0.0f, NOISE_COUNTS / sqrtf((float)CONVERSIONS));
+  std::uniform_int_distribution<uint32_t> spike(0, SPIKE_ONE_IN - 1);
+  std::vector<Frame> frames;
+  frames.reserve((size_t)(durationS * 1000.0 / FRAME_MS) + 1);
+  for (uint64_t t = FRAME_MS; t <= (uint64_t)(durationS * 1000.0); t += FRAME_MS) {
+    float truth = rawAt((double)t / 1000.0);
+    if (isnan(truth) || truth < 0.0f) truth = 0.0f;
+    float raw = truth;
+    if (noisy) {
+      raw += noise(rng);
+      if (spike(rng) == 0) raw += SPIKE_COUNTS;
+    }
+    raw = raw < 0.0f ? 0.0f : raw > 4095.0f ? 4095.0f : raw;
+    raw = roundf(raw);  // avg_read_raw y avg_read_mvolts son enteros
+    frames.push_back({(uint32_t)t, roundf(countsToMv(raw)), raw, countsToMv(truth)});
+  }
+  return frames;
+}
+
+bool loadFrames(const char* path, std::vector<Frame>& frames) {
+  FILE* file = fopen(path, "r");
+  if (!file) return false;
+  char line[128];
+  while (fgets(line, sizeof(line), file)) {
+    if (line[0] == '#' || line[0] == 't' || line[0] == '\n') continue;
+    Frame f;
+    f.truthMv = NAN;
+    unsigned long t;
+    if (sscanf(line, "%lu,%f,%f", &t, &f.mv, &f.raw) == 3) {
+      f.tMs = (uint32_t)t;
+      frames.push_back(f);
+    }
+  }
+  fclose(file);
+  return !frames.empty();
+}
+
+void writeFrames(const char* path, const std::vector<Frame>& frames) {
+  FILE* file = fopen(path, "w");
+  if (!file) return;
+  fprintf(file, "t_ms,mv,raw\n");
+  for (const Frame& f : frames) fprintf(file, "%lu,%.0f,%.0f\n", (unsigned long)f.tMs, f.mv, f.raw);
+  fclose(file);
+}
+
+struct Replay {
+  uint32_t calibrationStartMs = 0;
+  uint32_t readyMs = 0;
+  float r0Kohm = NAN;
+  float trueR0Kohm = NAN;  // media del Rs real durante la calibración
+  uint32_t transitions = 0;
+  float peakPpm = NAN;
+  AirQuality worst = AirQuality::UNKNOWN;
+  double frameDiffSq = 0.0;
+  double filteredDiffSq = 0.0;
+  uint32_t diffs = 0;
+  float frameMaxErrorMv = 0.0f;
+  uint32_t saves = 0;
+  std::vector<float> ppmAt;       // ppm tras cada trama
+  std::vector<float> filteredAt;  // mV filtrados tras cada trama
+};
+
+Replay replay(const std::vector<Frame>& frames, const Mq2Config& config, float storedR0 = NAN) {
+  Replay r;
+  Mq2Sensor sensor;
+  sensor.configure(config);
+  sensor.begin(0, storedR0);
+  r.ppmAt.reserve(frames.size());
+  r.filteredAt.reserve(frames.size());
+  double trueRsSum = 0.0;
+  uint32_t trueRsCount = 0;
+  float lastMv = NAN;
+  float lastFiltered = NAN;
+  AirQuality quality = AirQuality::UNKNOWN;
+  for (const Frame& f : frames) {
+    const Mq2Sensor::State before = sensor.state();
+    sensor.addFrame(f.tMs, f.mv, f.raw);
+    const Mq2Sensor::State after = sensor.state();
+    if (after == Mq2Sensor::State::CALIBRATING && before != after) r.calibrationStartMs = f.tMs;
+    if (after == Mq2Sensor::State::READY && before != after) r.readyMs = f.tMs;
+    if (after == Mq2Sensor::State::CALIBRATING && !isnan(f.truthMv)) {
+      trueRsSum += sensor.rsFromMv(f.truthMv);
+      trueRsCount++;
+    }
+    float saved;
+    if (sensor.takeR0ToSave(saved)) {
+      r.saves++;
+      if (isnan(r.r0Kohm)) r.r0Kohm = saved;
+    }
+    r.ppmAt.push_back(sensor.ppm());
+    r.filteredAt.push_back(sensor.filteredMv());
+    if (after != Mq2Sensor::State::READY) continue;
+
+    if (sensor.quality() != quality && quality != AirQuality::UNKNOWN) r.transitions++;
+    quality = sensor.quality();
+    if (quality != AirQuality::UNKNOWN && (r.worst == AirQuality::UNKNOWN || quality > r.worst)) r.worst = quality;
+    if (isnan(r.peakPpm) || sensor.ppm() > r.peakPpm) r.peakPpm = sensor.ppm();
+    if (!isnan(lastMv)) {
+      r.frameDiffSq += (double)(f.mv - lastMv) * (f.mv - lastMv);
+      r.filteredDiffSq += (double)(sensor.filteredMv() - lastFiltered) * (sensor.filteredMv() - lastFiltered);
+      r.diffs++;
+    }
+    lastMv = f.mv;
+    lastFiltered = sensor.filteredMv();
+    if (!isnan(f.truthMv)) r.frameMaxErrorMv = fmaxf(r.frameMaxErrorMv, fabsf(f.mv - f.truthMv));
+  }
+  if (trueRsCount > 0) r.trueR0Kohm = (float)(trueRsSum / trueRsCount);
+  return r;
+}
+
+float rmsDiff(double sumSq, uint32_t n) { return n ? sqrtf((float)(sumSq / n)) : NAN; }
+
+// ADC que da `ppm` con el R0 de `config` y Rs/R0 de la curva
+float rawForPpm(const Mq2Config& config, float r0Kohm, float ppm) {
+  const float ratio = powf(ppm / config.curveA, 1.0f / config.curveB);
+  const float rs = ratio * r0Kohm;
+  const float vrl = config.supplyMv * config.loadKohm / (rs + config.loadKohm);
+  return vrl / config.pinScale * 4095.0f / 3300.0f;
+}
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  printf("  %-58s %s\n", what, ok ? "ok" : "MAL");
+  if (!ok) failures++;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string tracePath = SIM_TRACES_DIR "/dia_con_cortes.csv";
+  const char* framesPath = nullptr;
+  const char* writePath = nullptr;
+  double durationH = 24.0;
+  uint64_t seed = 1;
+  for (int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if (!strcmp(argv[i], "--trace") && hasValue) {
+      tracePath = argv[++i];
+    } else if (!strcmp(argv[i], "--frames") && hasValue) {
+      framesPath = argv[++i];
+    } else if (!strcmp(argv[i], "--duration-h") && hasValue) {
+      durationH = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--seed") && hasValue) {
+      seed = strtoull(argv[++i], nullptr, 10);
+    } else if (!strcmp(argv[i], "--write-frames") && hasValue) {
+      writePath = argv[++i];
+    } else {
+      fprintf(stderr, "uso: %s [--trace CSV | --frames CSV] [--duration-h H] [--seed N] [--write-frames CSV]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  const Mq2Config config;
+  std::vector<Frame> frames;
+  std::vector<Frame> clean;  // la misma traza sin ruido ni picos
+  if (framesPath) {
+    if (!loadFrames(framesPath, frames)) {
+      fprintf(stderr, "no se pueden leer tramas de %s\n", framesPath);
+      return 2;
+    }
+    printf("Tramas grabadas: %s, %zu tramas (%.1f h)\n", framesPath, frames.size(), frames.back().tMs / 3.6e6);
+  } else {
+    SensorTrace trace;
+    std::string error;
+    if (!trace.load(tracePath.c_str(), error) || !trace.has(SensorTrace::GAS)) {
+      fprintf(stderr, "traza %s: %s\n", tracePath.c_str(), error.empty() ? "sin columna gas_raw" : error.c_str());
+      return 2;
+    }
+    trace.setRepeat(true);
+    auto gasAt = [&](double t) { return trace.value(SensorTrace::GAS, t); };
+    frames = synthesize(gasAt, durationH * 3600.0, seed);
+    clean = synthesize(gasAt, durationH * 3600.0, seed, false);
+    printf("Traza %s: %zu tramas de %u ms (%.1f h), ruido σ %.2f cuentas por trama, pico +%.0f 1 de cada %u\n",
+           tracePath.c_str(), frames.size(), (unsigned)FRAME_MS, durationH,
+           NOISE_COUNTS / sqrtf((float)CONVERSIONS), SPIKE_COUNTS, (unsigned)SPIKE_ONE_IN);
+  }
+  if (writePath) writeFrames(writePath, frames);
+  const bool synthetic = !isnan(frames.front().truthMv);
+
+  // --- 1) Calibración ---
+  const Replay main = replay(frames, config);
+  printf("\n1) Calibración\n");
+  printf("  calentamiento hasta %.1f s, calibración hasta %.1f s, R0 %.3f kΩ, %u guardados\n",
+         main.calibrationStartMs / 1000.0, main.readyMs / 1000.0, main.r0Kohm, (unsigned)main.saves);
+  check(main.readyMs >= config.warmupMs + config.calibrationMs &&
+            main.readyMs <= config.warmupMs + config.calibrationMs + 2 * FRAME_MS,
+        "listo al acabar calentamiento + calibración");
+  if (synthetic) {
+    printf("  R0 real (Rs sin ruido en la ventana) %.3f kΩ\n", main.trueR0Kohm);
+    check(fabsf(main.r0Kohm / main.trueR0Kohm - 1.0f) < 0.01f, "R0 a menos del 1 % del real");
+  }
+
+  // --- 2) Ruido y picos ---
+  const float frameNoise = rmsDiff(main.frameDiffSq, main.diffs);
+  const float filteredNoise = rmsDiff(main.filteredDiffSq, main.diffs);
+  printf("\n2) Ruido y picos (en READY)\n");
+  printf("  diferencia RMS entre tramas: cruda %.3f mV, filtrada %.4f mV (x%.0f)\n", frameNoise, filteredNoise,
+         frameNoise / filteredNoise);
+  check(filteredNoise * 10.0f < frameNoise, "el filtro reduce el ruido más de 10 veces");
+  if (synthetic) {
+    const Replay reference = replay(clean, config);
+    std::vector<float> errors;
+    for (size_t i = 0; i < frames.size(); i++) {
+      if (frames[i].tMs >= main.readyMs) errors.push_back(fabsf(main.filteredAt[i] - reference.filteredAt[i]));
+    }
+    std::sort(errors.begin(), errors.end());
+    const float p9999 = errors[(size_t)(errors.size() * 0.9999)];
+    // Tres picos en cinco tramas (unas dos veces al día con 1 de cada 200)
+    // pasan la mediana; el IIR los deja en una fracción
+    printf("  error por ruido y picos: cruda hasta %.1f mV, filtrada p99.99 %.2f mV y máx %.2f mV\n",
+           main.frameMaxErrorMv, p9999, errors.back());
+    check(p9999 < 0.01f * main.frameMaxErrorMv && errors.back() < 0.1f * main.frameMaxErrorMv,
+          "picos: p99.99 < 1 % y máx < 10 % de su error");
+  }
+
+  // --- 3) Histéresis ---
+  Mq2Config noHysteresis = config;
+  noHysteresis.hysteresis = 0.0f;
+  const Replay plain = replay(frames, noHysteresis);
+  printf("\n3) Calidad del aire\n");
+  printf("  traza: pico %.0f ppm (%s), %u cambios de nivel con histéresis, %u sin ella\n", main.peakPpm,
+         airQualityLabel(main.worst), (unsigned)main.transitions, (unsigned)plain.transitions);
+  check(main.transitions <= plain.transitions, "la histéresis no añade cambios");
+
+  // Gas justo en el umbral de MALA, oscilando ±3 % con periodo de 20 s, 1 h
+  // después de calibrar con el R0 de la traza
+  const float r0 = isnan(main.r0Kohm) ? 10.0f : main.r0Kohm;
+  const double readyS = (config.warmupMs + config.calibrationMs) / 1000.0;
+  const float cleanRaw = rawForPpm(config, r0, config.curveA);  // Rs = R0
+  const float edgeRaw = rawForPpm(config, r0, config.qualityPpm[1]);
+  const std::vector<Frame> edge = synthesize(
+      [&](double t) {
+        return t < readyS ? cleanRaw : edgeRaw * (1.0f + 0.03f * (float)sin(2.0 * M_PI * (t - readyS) / 20.0));
+      },
+      readyS + 3600.0, seed + 1);
+  const Replay edgeWith = replay(edge, config);
+  const Replay edgeWithout = replay(edge, noHysteresis);
+  printf("  en el umbral de %.0f ppm (ADC %.0f ± 3 %%): %u cambios con histéresis, %u sin ella\n",
+         config.qualityPpm[1], edgeRaw, (unsigned)edgeWith.transitions, (unsigned)edgeWithout.transitions);
+  // Con histéresis solo la subida desde BUENA: BUENA -> NORMAL -> MALA
+  check(edgeWith.transitions <= 2 && edgeWithout.transitions >= 100, "sin parpadeo de nivel en el umbral");
+
+  // --- 4) Reinicio con R0 de NVS ---
+  const Replay rebooted = replay(frames, config, main.r0Kohm);
+  float maxPpmError = 0.0f;
+  for (size_t i = 0; i < frames.size(); i++) {
+    if (frames[i].tMs < main.readyMs || isnan(rebooted.ppmAt[i]) || isnan(main.ppmAt[i])) continue;
+    maxPpmError = fmaxf(maxPpmError, fabsf(rebooted.ppmAt[i] / main.ppmAt[i] - 1.0f));
+  }
+  printf("\n4) Reinicio con R0 guardado\n");
+  printf("  listo a los %.1f s (sin R0: %.1f s), ppm a menos del %.2f %% de la primera pasada\n",
+         rebooted.readyMs / 1000.0, main.readyMs / 1000.0, 100.0f * maxPpmError);
+  check(rebooted.readyMs <= config.warmupMs + FRAME_MS && rebooted.saves == 0, "listo tras calentar, sin recalibrar");
+  check(maxPpmError < 0.02f, "mismas ppm que sin reiniciar");
+
+  printf("\n%s\n", failures ? "FALLOS" : "Todo ok");
+  return failures ? 1 : 0;
+}
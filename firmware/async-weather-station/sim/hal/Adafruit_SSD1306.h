@@ -0,0 +1,57 @@
+#pragma once
+// =============================================================
+// === Adafruit_SSD1306 simulado ===
+// =============================================================
+// Framebuffer real de 1 bit por píxel en páginas de 8 filas, como el de la
+// biblioteca. El texto usa glifos de 5x7 derivados del código del carácter
+// (no la fuente de Adafruit): textos distintos dan píxeles distintos, que es
+// lo que necesita el volcado por regiones sucias.
+#include "Arduino.h"
+#include "Wire.h"
+
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define SSD1306_INVERSE 2
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_COLUMNADDR 0x21
+#define SSD1306_PAGEADDR 0x22
+
+class Adafruit_SSD1306 : public Print {
+ public:
+  Adafruit_SSD1306(uint8_t width, uint8_t height, TwoWire* wire, int8_t resetPin);
+  ~Adafruit_SSD1306();
+
+  bool begin(uint8_t vcs, uint8_t address);
+  void display();
+  void clearDisplay();
+  uint8_t* getBuffer() { return buffer_; }
+  int16_t width() const { return width_; }
+  int16_t height() const { return height_; }
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color);
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void setTextSize(uint8_t size) { textSize_ = size ? size : 1; }
+  void setTextColor(uint16_t color) { textColor_ = color; }
+  void setTextColor(uint16_t color, uint16_t background) {
+    textColor_ = color;
+    (void)background;
+  }
+  void setCursor(int16_t x, int16_t y) {
+    cursorX_ = x;
+    cursorY_ = y;
+  }
+
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+ private:
+  TwoWire* wire_;
+  uint8_t address_ = 0x3C;
+  int16_t width_;
+  int16_t height_;
+  uint8_t* buffer_;
+  uint8_t textSize_ = 1;
+  uint16_t textColor_ = SSD1306_WHITE;
+  int16_t cursorX_ = 0;
+  int16_t cursorY_ = 0;
+};
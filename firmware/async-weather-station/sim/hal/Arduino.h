@@ -0,0 +1,260 @@
+#pragma once
+// =============================================================
+// === Arduino-ESP32 simulado (host) ===
+// =============================================================
+// Solo lo que usa el firmware, con la semántica del core de Arduino-ESP32.
+// El tiempo es el reloj virtual de SimHal.hpp.
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <functional>
+#include <string>
+
+#define ARDUINO_ARCH_ESP32 1
+#define IRAM_ATTR
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define INPUT_PULLDOWN 0x09
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+typedef uint8_t byte;
+
+// === Rutas del VFS y hora del sistema ===
+// El firmware abre /littlefs/... con stdio y lee la hora con gettimeofday();
+// en el host se redirigen al directorio de la simulación y al reloj virtual.
+// Las cabeceras del sistema ya están incluidas arriba.
+FILE* sim_fopen(const char* path, const char* mode);
+int sim_fsync(int fd);
+int sim_gettimeofday(struct timeval* tv, void* tz);
+#define fopen sim_fopen
+#define fsync sim_fsync
+#define gettimeofday sim_gettimeofday
+
+// === Tiempo ===
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+// === GPIO ===
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void detachInterrupt(uint8_t pin);
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration = 0);
+void noTone(uint8_t pin);
+
+// === ADC en modo continuo (esp32-hal-adc.h, core 3.x) ===
+// Cada trama promedia conversions_per_pin conversiones por pin; el
+// callback se llama al completar una (en el ESP32, desde la ISR del DMA).
+typedef enum { ADC_0db, ADC_2_5db, ADC_6db, ADC_11db, ADC_ATTENDB_MAX } adc_attenuation_t;
+typedef struct {
+  uint8_t pin;
+  uint8_t channel;
+  int avg_read_raw;
+  int avg_read_mvolts;
+} adc_continuous_data_t;
+bool analogContinuous(const uint8_t pins[], size_t pins_count, uint32_t conversions_per_pin, uint32_t sampling_freq_hz,
+                      void (*userFunc)(void));
+bool analogContinuousRead(adc_continuous_data_t** buffer, uint32_t timeout_ms);
+bool analogContinuousStart();
+bool analogContinuousStop();
+bool analogContinuousDeinit();
+void analogContinuousSetAtten(adc_attenuation_t attenuation);
+void analogContinuousSetWidth(uint8_t bits);
+
+// === Varios ===
+uint32_t esp_random();
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+inline size_t strlcpy(char* dst, const char* src, size_t size) {
+  const size_t len = strlen(src);
+  if (size) {
+    const size_t n = len < size - 1 ? len : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return len;
+}
+
+inline size_t strlcat(char* dst, const char* src, size_t size) {
+  const size_t used = strnlen(dst, size);
+  if (used == size) return size + strlen(src);
+  return used + strlcpy(dst + used, src, size - used);
+}
+
+// === Hora (esp32-hal-time.c) ===
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1, const char* server2 = nullptr,
+                const char* server3 = nullptr);
+void configTzTime(const char* tz, const char* server1, const char* server2 = nullptr, const char* server3 = nullptr);
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
+
+// =============================================================
+// === String (subconjunto de WString) ===
+// =============================================================
+class String {
+ public:
+  String(const char* s = "") : s_(s ? s : "") {}
+  String(const std::string& s) : s_(s) {}
+  explicit String(char c) : s_(1, c) {}
+  String(int v, unsigned char base = 10) : s_(formatInteger(v, base)) {}
+  String(unsigned v, unsigned char base = 10) : s_(formatInteger((long long)v, base)) {}
+  String(long v, unsigned char base = 10) : s_(formatInteger(v, base)) {}
+  String(unsigned long v, unsigned char base = 10) : s_(formatInteger((long long)v, base)) {}
+  String(float v, unsigned int decimals = 2) : s_(formatDecimal((double)v, decimals)) {}
+  String(double v, unsigned int decimals = 2) : s_(formatDecimal(v, decimals)) {}
+
+  const char* c_str() const { return s_.c_str(); }
+  unsigned int length() const { return (unsigned int)s_.size(); }
+  bool reserve(unsigned int size) {
+    s_.reserve(size);
+    return true;
+  }
+  bool concat(char c) {
+    s_ += c;
+    return true;
+  }
+  bool concat(const char* s) {
+    s_ += s;
+    return true;
+  }
+  bool concat(const String& s) {
+    s_ += s.s_;
+    return true;
+  }
+  String& operator+=(const String& s) {
+    s_ += s.s_;
+    return *this;
+  }
+  String& operator+=(const char* s) {
+    s_ += s;
+    return *this;
+  }
+  String& operator+=(char c) {
+    s_ += c;
+    return *this;
+  }
+  friend String operator+(const String& a, const String& b) { return String(a.s_ + b.s_); }
+  friend String operator+(const String& a, const char* b) { return String(a.s_ + b); }
+  friend String operator+(const char* a, const String& b) { return String(a + b.s_); }
+  bool operator==(const String& o) const { return s_ == o.s_; }
+  bool operator==(const char* o) const { return s_ == o; }
+  bool operator!=(const char* o) const { return s_ != o; }
+  bool equals(const char* o) const { return s_ == o; }
+  char operator[](unsigned int i) const { return i < s_.size() ? s_[i] : '\0'; }
+  String substring(unsigned int from) const { return from < s_.size() ? String(s_.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    return from < to && from < s_.size() ? String(s_.substr(from, to - from)) : String();
+  }
+  int indexOf(char c) const {
+    const size_t at = s_.find(c);
+    return at == std::string::npos ? -1 : (int)at;
+  }
+  bool startsWith(const char* prefix) const { return s_.rfind(prefix, 0) == 0; }
+  long toInt() const { return atol(s_.c_str()); }
+  float toFloat() const { return (float)atof(s_.c_str()); }
+  void trim() {
+    const size_t first = s_.find_first_not_of(" \t\r\n");
+    const size_t last = s_.find_last_not_of(" \t\r\n");
+    s_ = first == std::string::npos ? std::string() : s_.substr(first, last - first + 1);
+  }
+
+ private:
+  static std::string formatInteger(long long v, unsigned char base) {
+    char buf[72];
+    if (base == 16) snprintf(buf, sizeof(buf), "%llx", v);
+    else snprintf(buf, sizeof(buf), "%lld", v);
+    return buf;
+  }
+  static std::string formatDecimal(double v, unsigned int decimals) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+    return buf;
+  }
+
+  std::string s_;
+};
+
+// =============================================================
+// === Print / Serial ===
+// =============================================================
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* data, size_t len) {
+    size_t n = 0;
+    while (len--) n += write(*data++);
+    return n;
+  }
+  size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+
+  size_t print(const char* s) { return write(s); }
+  size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v, int base = 10) { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned v, int base = 10) { return print(String(v, (unsigned char)base)); }
+  size_t print(long v, int base = 10) { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned long v, int base = 10) { return print(String(v, (unsigned char)base)); }
+  size_t print(double v, int decimals = 2) { return print(String(v, (unsigned)decimals)); }
+  size_t println() { return write((const uint8_t*)"\r\n", 2); }
+  template <typename T>
+  size_t println(const T& v) {
+    const size_t n = print(v);
+    return n + println();
+  }
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  void flush() {}
+};
+
+class HardwareSerial : public Print {
+ public:
+  void begin(unsigned long baud) { (void)baud; }
+  operator bool() const { return true; }
+  int available() { return 0; }
+  int read() { return -1; }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* data, size_t len) override;
+  using Print::write;
+};
+extern HardwareSerial Serial;
+
+// === Heap (valores de un ESP32 típico con el firmware cargado) ===
+class EspClass {
+ public:
+  uint32_t getFreeHeap() { return 182000; }
+  uint32_t getMinFreeHeap() { return 168000; }
+  uint32_t getMaxAllocHeap() { return 110580; }
+  uint32_t getHeapSize() { return 327680; }
+  // CCOUNT a 240 MHz sobre el reloj virtual: sin --cpu-scale, el código no
+  // consume tiempo y solo cuentan las esperas (delay, delayMicroseconds)
+  uint32_t getCpuFreqMHz() { return 240; }
+  uint32_t getCycleCount() { return (uint32_t)(micros() * 240UL); }
+};
+extern EspClass ESP;
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
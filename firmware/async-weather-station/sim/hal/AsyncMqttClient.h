@@ -0,0 +1,89 @@
+#pragma once
+// =============================================================
+// === AsyncMqttClient simulado ===
+// =============================================================
+// Misma interfaz que marvinroger/async-mqtt-client, conectado al broker en
+// proceso de SimHal.hpp. Los callbacks llegan como desde la tarea async_tcp:
+// fuera de las tareas del firmware y con la latencia de sim::NetworkConfig.
+#include "Arduino.h"
+#include "IPAddress.h"
+
+#include <vector>
+
+enum class AsyncMqttClientDisconnectReason : uint8_t {
+  TCP_DISCONNECTED = 0,
+  MQTT_UNACCEPTABLE_PROTOCOL_VERSION = 1,
+  MQTT_IDENTIFIER_REJECTED = 2,
+  MQTT_SERVER_UNAVAILABLE = 3,
+  MQTT_MALFORMED_CREDENTIALS = 4,
+  MQTT_NOT_AUTHORIZED = 5,
+  ESP8266_NOT_ENOUGH_SPACE = 6,
+  TLS_BAD_FINGERPRINT = 7,
+};
+
+struct AsyncMqttClientMessageProperties {
+  uint8_t qos;
+  bool dup;
+  bool retain;
+};
+
+class AsyncMqttClient {
+ public:
+  typedef std::function<void(bool sessionPresent)> OnConnectUserCallback;
+  typedef std::function<void(AsyncMqttClientDisconnectReason reason)> OnDisconnectUserCallback;
+  typedef std::function<void(uint16_t packetId, uint8_t qos)> OnSubscribeUserCallback;
+  typedef std::function<void(uint16_t packetId)> OnUnsubscribeUserCallback;
+  typedef std::function<void(char* topic, char* payload, AsyncMqttClientMessageProperties properties, size_t len,
+                             size_t index, size_t total)>
+      OnMessageUserCallback;
+  typedef std::function<void(uint16_t packetId)> OnPublishUserCallback;
+
+  AsyncMqttClient();
+  ~AsyncMqttClient();
+
+  AsyncMqttClient& setKeepAlive(uint16_t keepAlive);
+  AsyncMqttClient& setClientId(const char* clientId);
+  AsyncMqttClient& setCleanSession(bool cleanSession);
+  AsyncMqttClient& setCredentials(const char* username, const char* password = nullptr);
+  AsyncMqttClient& setWill(const char* topic, uint8_t qos, bool retain, const char* payload = nullptr,
+                           size_t length = 0);
+  AsyncMqttClient& setServer(IPAddress ip, uint16_t port);
+  AsyncMqttClient& setServer(const char* host, uint16_t port);
+
+  AsyncMqttClient& onConnect(OnConnectUserCallback callback);
+  AsyncMqttClient& onDisconnect(OnDisconnectUserCallback callback);
+  AsyncMqttClient& onSubscribe(OnSubscribeUserCallback callback);
+  AsyncMqttClient& onUnsubscribe(OnUnsubscribeUserCallback callback);
+  AsyncMqttClient& onMessage(OnMessageUserCallback callback);
+  AsyncMqttClient& onPublish(OnPublishUserCallback callback);
+
+  bool connected() const;
+  void connect();
+  void disconnect(bool force = false);
+  uint16_t subscribe(const char* topic, uint8_t qos);
+  uint16_t unsubscribe(const char* topic);
+  uint16_t publish(const char* topic, uint8_t qos, bool retain, const char* payload = nullptr, size_t length = 0,
+                   bool dup = false, uint16_t messageId = 0);
+
+ private:
+  friend struct SimMqttLink;  // la red simulada corta la conexión
+
+  enum class State : uint8_t { DISCONNECTED, CONNECTING, CONNECTED };
+
+  uint16_t nextPacketId();
+  void drop(AsyncMqttClientDisconnectReason reason);
+  void deliver(const std::string& topic, const std::string& payload, bool retained);
+
+  State state_ = State::DISCONNECTED;
+  uint32_t session_ = 0;  // cambia en cada conexión: invalida eventos pendientes
+  uint16_t packetId_ = 0;
+  std::vector<int> subscriptions_;
+  std::vector<uint16_t> pendingAcks_;
+
+  std::vector<OnConnectUserCallback> onConnect_;
+  std::vector<OnDisconnectUserCallback> onDisconnect_;
+  std::vector<OnSubscribeUserCallback> onSubscribe_;
+  std::vector<OnUnsubscribeUserCallback> onUnsubscribe_;
+  std::vector<OnMessageUserCallback> onMessage_;
+  std::vector<OnPublishUserCallback> onPublish_;
+};
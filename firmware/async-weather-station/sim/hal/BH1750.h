@@ -0,0 +1,27 @@
+#pragma once
+// BH1750 simulado: lux de sim::environment(). Sin dato en la traza el sensor
+// no responde: begin() falla y readLightLevel() devuelve -2 (error de I2C),
+// como la biblioteca de claws
+#include "Arduino.h"
+
+class BH1750 {
+ public:
+  enum Mode {
+    UNCONFIGURED = 0,
+    CONTINUOUS_HIGH_RES_MODE = 0x10,
+    CONTINUOUS_HIGH_RES_MODE_2 = 0x11,
+    CONTINUOUS_LOW_RES_MODE = 0x13,
+    ONE_TIME_HIGH_RES_MODE = 0x20,
+    ONE_TIME_HIGH_RES_MODE_2 = 0x21,
+    ONE_TIME_LOW_RES_MODE = 0x23,
+  };
+
+  explicit BH1750(uint8_t address = 0x23) : address_(address) {}
+  bool begin(Mode mode = CONTINUOUS_HIGH_RES_MODE, uint8_t address = 0x23, void* wire = nullptr);
+  bool configure(Mode mode);
+  float readLightLevel();
+
+ private:
+  uint8_t address_;
+  Mode mode_ = UNCONFIGURED;
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include "Arduino.h"
+
+// IPv4 en orden de red, como en Arduino-ESP32 (uint32_t con el primer octeto
+// en el byte bajo)
+class IPAddress {
+ public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    octets_[0] = a;
+    octets_[1] = b;
+    octets_[2] = c;
+    octets_[3] = d;
+  }
+  IPAddress(uint32_t address) { memcpy(octets_, &address, 4); }
+
+  bool fromString(const char* text) {
+    unsigned parts[4];
+    char tail;
+    if (!text || sscanf(text, "%u.%u.%u.%u%c", &parts[0], &parts[1], &parts[2], &parts[3], &tail) != 4) return false;
+    for (int i = 0; i < 4; i++) {
+      if (parts[i] > 255) return false;
+      octets_[i] = (uint8_t)parts[i];
+    }
+    return true;
+  }
+  String toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", octets_[0], octets_[1], octets_[2], octets_[3]);
+    return String(buf);
+  }
+
+  operator uint32_t() const {
+    uint32_t address;
+    memcpy(&address, octets_, 4);
+    return address;
+  }
+  bool operator==(const IPAddress& o) const { return (uint32_t)*this == (uint32_t)o; }
+  bool operator!=(const IPAddress& o) const { return !(*this == o); }
+  uint8_t operator[](int i) const { return octets_[i]; }
+
+ private:
+  uint8_t octets_[4] = {0, 0, 0, 0};
+};
+
+extern const IPAddress INADDR_NONE;
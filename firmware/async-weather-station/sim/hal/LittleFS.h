@@ -0,0 +1,12 @@
+#pragma once
+// LittleFS simulado: un directorio del host (sim::setFilesystemRoot) montado
+// en /littlefs; los fopen() del firmware se redirigen allí (Arduino.h)
+#include "Arduino.h"
+
+class LittleFSFS {
+ public:
+  bool begin(bool formatOnFail = false, const char* basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+             const char* partitionLabel = "spiffs");
+  void end() {}
+};
+extern LittleFSFS LittleFS;
@@ -0,0 +1,19 @@
+#pragma once
+// NVS simulada en memoria: sobrevive a los objetos Preferences, no al proceso
+#include "Arduino.h"
+
+class Preferences {
+ public:
+  bool begin(const char* name, bool readOnly = false, const char* partitionLabel = nullptr);
+  void end();
+  size_t putBytes(const char* key, const void* value, size_t len);
+  size_t getBytes(const char* key, void* buf, size_t maxLen);
+  size_t getBytesLength(const char* key);
+  bool remove(const char* key);
+  bool clear();
+
+ private:
+  std::string namespace_;
+  bool open_ = false;
+  bool readOnly_ = false;
+};
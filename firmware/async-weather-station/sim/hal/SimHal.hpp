@@ -0,0 +1,239 @@
+#pragma once
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// =============================================================
+// === HAL de simulación: control desde el host ===
+// =============================================================
+// El firmware se compila tal cual contra las cabeceras falsas de sim/hal
+// (Arduino.h, WiFi.h, AsyncMqttClient.h...). Este archivo es la otra cara:
+// lo que usa el programa de simulación para mover el reloj, programar
+// eventos y decidir qué ven los sensores, la WiFi y el broker.
+//
+// Todo corre en un solo hilo. Las tareas de FreeRTOS son corrutinas que
+// solo ceden en las llamadas bloqueantes (vTaskDelay, ulTaskNotifyTake,
+// xSemaphoreTake ocupado, delay); los eventos (ISR, callbacks de WiFi,
+// MQTT, DNS y SNTP) se ejecutan entre dos pasos de tarea. Con la misma
+// semilla y cpuScale = 0 dos ejecuciones son idénticas.
+namespace sim {
+
+// =============================================================
+// === Reloj virtual y eventos ===
+// =============================================================
+// Microsegundos desde el arranque simulado (no desborda: millis() y
+// micros() del firmware son los 32 bits bajos, como en el ESP32).
+uint64_t nowUs();
+
+typedef std::function<void()> Event;
+void schedule(uint64_t atUs, Event event);
+inline void after(uint64_t delayUs, Event event) { schedule(nowUs() + delayUs, std::move(event)); }
+
+// Error del modelo (no del firmware): se informa y se aborta
+[[noreturn]] void fatal(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+// =============================================================
+// === Núcleo: tareas y ejecución ===
+// =============================================================
+struct KernelConfig {
+  // 0 = determinista: el código no consume tiempo virtual. > 0: cada paso
+  // de tarea avanza el reloj su tiempo de CPU en el host por este factor
+  // (p. ej. 8 para aproximar un núcleo a 240 MHz); no es reproducible.
+  double cpuScale = 0.0;
+  uint64_t initialUptimeUs = 0;  // arranque con millis() cerca del desborde
+  size_t stackBytes = 256 * 1024;
+};
+void configure(const KernelConfig& config);
+
+// Crea loopTask (setup() y luego loop() en bucle), como el core de Arduino
+void startArduino(void (*setup)(), void (*loop)());
+
+// Ejecuta hasta `untilUs` de tiempo virtual (o hasta que no quede nada)
+void run(uint64_t untilUs);
+
+// Histograma logarítmico (8 subdivisiones por potencia de 2, error < 12,5 %)
+class LatencyHistogram {
+ public:
+  void add(uint64_t value) {
+    count_++;
+    if (value > max_) max_ = value;
+    buckets_[bucket(value)]++;
+  }
+  uint64_t count() const { return count_; }
+  uint64_t max() const { return max_; }
+  // Límite superior del cubo donde cae el percentil q (0..1)
+  uint64_t percentile(double q) const {
+    if (count_ == 0) return 0;
+    uint64_t rank = (uint64_t)ceil(q * (double)count_);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+      seen += buckets_[i];
+      if (seen >= rank) {
+        const uint64_t upper = upperBound(i);
+        return upper < max_ ? upper : max_;
+      }
+    }
+    return max_;
+  }
+
+ private:
+  static constexpr size_t SUB = 8;
+  static constexpr size_t BUCKETS = 64 * SUB;
+
+  static size_t bucket(uint64_t v) {
+    if (v < SUB) return (size_t)v;
+    const unsigned bits = 63 - __builtin_clzll(v);  // >= 3
+    return (bits - 2) * SUB + (size_t)((v >> (bits - 3)) & (SUB - 1));
+  }
+  static uint64_t upperBound(size_t i) {
+    if (i < SUB) return i;
+    const unsigned bits = (unsigned)(i / SUB) + 2;
+    return ((uint64_t)(SUB + i % SUB + 1) << (bits - 3)) - 1;
+  }
+
+  uint64_t count_ = 0;
+  uint64_t max_ = 0;
+  uint64_t buckets_[BUCKETS] = {};
+};
+
+struct TaskReport {
+  const char* name;
+  unsigned priority;
+  int core;
+  uint64_t steps;                // veces que ha pasado a ejecutarse
+  LatencyHistogram cpuNs;        // CPU del host por paso
+  LatencyHistogram wakeDelayUs;  // de lista para ejecutar a ejecutándose (virtual)
+};
+std::vector<TaskReport> taskReports();
+
+// =============================================================
+// === Entorno físico ===
+// =============================================================
+// Lo que miden los sensores en el instante actual. NAN = el sensor no
+// responde (DHT sin dato, BH1750 y BMP180 sin ACK en el bus).
+struct Environment {
+  float temperatureC = 20.0f;
+  float humidityPercent = 50.0f;
+  float pressureHpa = 1013.25f;
+  float lightLux = 200.0f;
+  int8_t rssi = -60;
+  uint16_t analog[40] = {};  // lectura de analogRead() por GPIO
+};
+// Se consulta en cada lectura de sensor; sin fuente, valores por defecto
+void setEnvironmentSource(std::function<void(uint64_t nowUs, Environment& env)> source);
+Environment environment();
+
+// Flanco en un GPIO: llama a la ISR registrada con attachInterrupt() si el
+// modo coincide (FALLING, RISING o CHANGE)
+void pulse(uint8_t pin, bool rising = false);
+
+// =============================================================
+// === Red ===
+// =============================================================
+struct NetworkConfig {
+  uint32_t scanMs = 2200;        // escaneo completo + asociación
+  uint32_t directMs = 180;       // asociación directa a BSSID/canal conocidos
+  uint32_t noApMs = 2500;        // escaneo sin encontrar el AP
+  uint32_t dhcpMs = 900;         // DISCOVER..ACK
+  uint32_t staticIpMs = 15;      // IP fija o concesión reutilizada
+  uint32_t dnsMs = 30;
+  uint32_t sntpMs = 120;
+  uint32_t rttMs = 12;           // ida y vuelta con el broker
+  uint32_t tcpTimeoutMs = 5000;  // CONNECT sin respuesta (sin red)
+  size_t mqttChunk = 1436;       // trozos de onMessage (MSS de lwIP)
+  int64_t startEpochMs = 1735689600000LL;  // hora real al arrancar
+};
+void configureNetwork(const NetworkConfig& config);
+
+// Disponibilidad del punto de acceso y del broker (p. ej. desde una traza)
+void setAccessPoint(bool up);
+bool accessPointUp();
+void setBrokerUp(bool up);
+
+struct TopicStats {
+  uint64_t messages = 0;
+  uint64_t bytes = 0;
+  uint64_t retained = 0;
+};
+
+// Broker MQTT en el propio proceso: comodines + y #, mensajes retenidos
+class Broker {
+ public:
+  typedef std::function<void(const std::string& topic, const std::string& payload, bool retained)> Sink;
+
+  int subscribe(const std::string& filter, Sink sink);
+  void unsubscribe(int id);
+  void publish(const std::string& topic, const std::string& payload, bool retain, const char* origin);
+
+  bool up() const { return up_; }
+  void setLog(FILE* log) { log_ = log; }
+  const std::map<std::string, TopicStats>& stats() const { return stats_; }
+  uint64_t connects = 0;  // CONNACK enviados
+
+  static bool matches(const std::string& filter, const std::string& topic);
+
+ private:
+  friend void setBrokerUp(bool up);
+  struct Subscription {
+    int id;
+    std::string filter;
+    Sink sink;
+  };
+  bool up_ = true;
+  int nextId_ = 1;
+  FILE* log_ = nullptr;
+  std::vector<Subscription> subscriptions_;
+  std::map<std::string, std::string> retained_;
+  std::map<std::string, TopicStats> stats_;
+};
+Broker& broker();
+
+struct NetworkReport {
+  uint64_t wifiConnects = 0;
+  uint64_t wifiFailures = 0;
+  uint64_t mqttConnects = 0;
+  uint64_t mqttFailures = 0;
+  uint64_t published = 0;   // PUBLISH aceptados por el cliente
+  uint64_t acked = 0;       // PUBACK entregados
+  uint64_t lostAcks = 0;    // QoS1 sin PUBACK por caída de la conexión
+  uint64_t dnsQueries = 0;
+  bool clockSynced = false;
+};
+NetworkReport networkReport();
+
+// =============================================================
+// === Resto del hardware ===
+// =============================================================
+void setSeed(uint64_t seed);             // esp_random() y random()
+void setSerialSink(FILE* sink);          // nullptr = se descarta
+uint64_t serialBytes();
+void setFilesystemRoot(const char* dir);  // /littlefs/... -> dir/...
+uint64_t fsyncCount();
+uint64_t displayBytes();                 // bytes I2C hacia el SSD1306
+
+// =============================================================
+// === Memoria dinámica ===
+// =============================================================
+// operator new/delete del host llaman a los ganchos de ESP-IDF
+// (esp_heap_caps.h), como las reservas del heap en el ESP32. Lo que reserva
+// el propio HAL se marca con HalScope y no pasa por ellos: en el ESP32 lo
+// reservarían la biblioteca o el sistema (AsyncMqttClient, WiFi, VFS), y
+// el firmware no puede evitarlo.
+class HalScope {
+ public:
+  HalScope();
+  ~HalScope();
+  HalScope(const HalScope&) = delete;
+  HalScope& operator=(const HalScope&) = delete;
+};
+// Además de los ganchos, para el programa de simulación (nullptr = ninguno)
+void setAllocationObserver(std::function<void(size_t bytes)> observer);
+
+}  // namespace sim
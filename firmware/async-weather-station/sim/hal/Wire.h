@@ -0,0 +1,37 @@
+#pragma once
+// =============================================================
+// === Bus I2C simulado ===
+// =============================================================
+// Las transacciones van a los dispositivos del bus simulado (BMP180 y
+// SSD1306); una dirección sin dispositivo, o con el sensor desconectado en
+// la traza, no da ACK.
+#include "Arduino.h"
+
+#define I2C_BUFFER_LENGTH 128
+
+class TwoWire {
+ public:
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+  bool setClock(uint32_t frequency);
+  uint32_t getClock() const { return clock_; }
+
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t value);
+  size_t write(const uint8_t* data, size_t len);
+  // 0 = ACK, 2 = NACK de dirección, 1 = datos más largos que el buffer
+  uint8_t endTransmission(bool sendStop = true);
+  uint8_t requestFrom(uint8_t address, uint8_t len, bool sendStop = true);
+  int available() const { return (int)(rxLen_ - rxPos_); }
+  int read() { return rxPos_ < rxLen_ ? rx_[rxPos_++] : -1; }
+
+ private:
+  uint32_t clock_ = 100000;
+  uint8_t address_ = 0;
+  uint8_t tx_[I2C_BUFFER_LENGTH];
+  size_t txLen_ = 0;
+  bool txOverflow_ = false;
+  uint8_t rx_[I2C_BUFFER_LENGTH];
+  size_t rxLen_ = 0;
+  size_t rxPos_ = 0;
+};
+extern TwoWire Wire;
@@ -0,0 +1,299 @@
+// =============================================================
+// === Core de Arduino simulado: GPIO, Serial, aleatorios y VFS ===
+// =============================================================
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "Arduino.h"
+#include "LittleFS.h"
+#include "SimHal.hpp"
+
+// Aquí se necesitan las funciones reales que Arduino.h redirige
+#undef fopen
+#undef fsync
+
+namespace sim {
+namespace {
+
+constexpr size_t PIN_COUNT = 40;
+
+struct Pin {
+  uint8_t mode = INPUT;
+  uint8_t level = LOW;
+  void (*isr)() = nullptr;
+  int edge = 0;
+};
+Pin pins[PIN_COUNT];
+
+std::function<void(uint64_t, Environment&)> environmentSource;
+
+// xorshift64*: misma semilla, misma secuencia
+uint64_t rngState = 0x9E3779B97F4A7C15ull;
+uint32_t nextRandom() {
+  rngState ^= rngState >> 12;
+  rngState ^= rngState << 25;
+  rngState ^= rngState >> 27;
+  return (uint32_t)((rngState * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+FILE* serialSink = nullptr;
+uint64_t serialCount = 0;
+
+std::string filesystemRoot = "/tmp";
+uint64_t fsyncs = 0;
+
+}  // namespace
+
+void setEnvironmentSource(std::function<void(uint64_t, Environment&)> source) {
+  environmentSource = std::move(source);
+}
+
+Environment environment() {
+  Environment env;
+  if (environmentSource) environmentSource(nowUs(), env);
+  return env;
+}
+
+void pulse(uint8_t pin, bool rising) {
+  if (pin >= PIN_COUNT) return;
+  Pin& p = pins[pin];
+  p.level = rising ? HIGH : LOW;
+  const bool fire = p.edge == CHANGE || (rising ? p.edge == RISING : p.edge == FALLING);
+  if (p.isr && fire) p.isr();
+}
+
+void setSeed(uint64_t seed) { rngState = seed ? seed : 0x9E3779B97F4A7C15ull; }
+
+void setSerialSink(FILE* sink) { serialSink = sink; }
+uint64_t serialBytes() { return serialCount; }
+
+void setFilesystemRoot(const char* dir) { filesystemRoot = dir; }
+uint64_t fsyncCount() { return fsyncs; }
+
+const std::string& filesystemRootPath() { return filesystemRoot; }
+
+}  // namespace sim
+
+HardwareSerial Serial;
+EspClass ESP;
+LittleFSFS LittleFS;
+
+size_t HardwareSerial::write(const uint8_t* data, size_t len) {
+  sim::serialCount += len;
+  if (sim::serialSink) fwrite(data, 1, len, sim::serialSink);
+  return len;
+}
+
+size_t Print::printf(const char* format, ...) {
+  char stackBuffer[128];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(stackBuffer, sizeof(stackBuffer), format, args);
+  va_end(args);
+  if (len < 0) return 0;
+  if ((size_t)len < sizeof(stackBuffer)) return write((const uint8_t*)stackBuffer, (size_t)len);
+  std::string text((size_t)len + 1, '\0');
+  va_start(args, format);
+  vsnprintf(&text[0], text.size(), format, args);
+  va_end(args);
+  return write((const uint8_t*)text.data(), (size_t)len);
+}
+
+// =============================================================
+// === GPIO ===
+// =============================================================
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin >= sim::PIN_COUNT) return;
+  sim::pins[pin].mode = mode;
+  if (mode == INPUT_PULLUP) sim::pins[pin].level = HIGH;
+  if (mode == INPUT_PULLDOWN) sim::pins[pin].level = LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin < sim::PIN_COUNT) sim::pins[pin].level = value ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) { return pin < sim::PIN_COUNT ? sim::pins[pin].level : LOW; }
+
+// ADC de 12 bits
+uint16_t analogRead(uint8_t pin) {
+  if (pin >= sim::PIN_COUNT) return 0;
+  const uint16_t value = sim::environment().analog[pin];
+  return value > 4095 ? 4095 : value;
+}
+
+// =============================================================
+// === ADC continuo ===
+// =============================================================
+// Las tramas se generan en tiempo virtual a partir de Environment::analog.
+// Cada conversión lleva ruido gaussiano; la media de una trama conserva
+// σ/√N y, de vez en cuando, un pico de la radio que afecta a toda la trama
+// (lo que tiene que quitar la mediana del firmware). Como el driver, solo
+// guarda las ADC_POOL_FRAMES últimas: si no se leen, se pierde la más vieja.
+namespace sim {
+namespace {
+
+constexpr size_t ADC_MAX_PINS = 8;
+constexpr size_t ADC_POOL_FRAMES = 2;
+constexpr float ADC_NOISE_COUNTS = 25.0f;      // σ de una conversión suelta
+constexpr uint32_t ADC_SPIKE_ONE_IN = 200;     // tramas
+constexpr float ADC_SPIKE_COUNTS = 350.0f;
+
+struct ContinuousAdc {
+  uint8_t pins[ADC_MAX_PINS] = {};
+  size_t pinCount = 0;
+  uint32_t conversions = 0;
+  uint64_t frameUs = 0;
+  void (*callback)() = nullptr;
+  bool running = false;
+  uint32_t generation = 0;  // invalida las tramas programadas al parar
+  adc_continuous_data_t pool[ADC_POOL_FRAMES][ADC_MAX_PINS] = {};
+  size_t head = 0;
+  size_t ready = 0;
+  adc_continuous_data_t out[ADC_MAX_PINS] = {};
+};
+ContinuousAdc adc;
+
+// Aproximación de N(0, 1): suma de 12 uniformes
+float gaussian() {
+  float sum = 0.0f;
+  for (int i = 0; i < 12; i++) sum += (float)nextRandom() / 4294967296.0f;
+  return sum - 6.0f;
+}
+
+void adcFrame(uint32_t generation) {
+  if (!adc.running || generation != adc.generation) return;
+  const Environment env = environment();
+  const bool spike = nextRandom() % ADC_SPIKE_ONE_IN == 0;
+  const size_t slot = (adc.head + adc.ready) % ADC_POOL_FRAMES;
+  for (size_t i = 0; i < adc.pinCount; i++) {
+    float raw = (float)env.analog[adc.pins[i]] + gaussian() * ADC_NOISE_COUNTS / sqrtf((float)adc.conversions);
+    if (spike) raw += ADC_SPIKE_COUNTS;
+    raw = raw < 0.0f ? 0.0f : raw > 4095.0f ? 4095.0f : raw;
+    adc_continuous_data_t& d = adc.pool[slot][i];
+    d.pin = adc.pins[i];
+    d.channel = (uint8_t)i;
+    d.avg_read_raw = (int)lroundf(raw);
+    d.avg_read_mvolts = (int)lroundf(raw * 3300.0f / 4095.0f);
+  }
+  if (adc.ready < ADC_POOL_FRAMES) {
+    adc.ready++;
+  } else {
+    adc.head = (adc.head + 1) % ADC_POOL_FRAMES;
+  }
+  if (adc.callback) adc.callback();
+  after(adc.frameUs, [generation]() { adcFrame(generation); });
+}
+
+}  // namespace
+}  // namespace sim
+
+bool analogContinuous(const uint8_t pins[], size_t pins_count, uint32_t conversions_per_pin, uint32_t sampling_freq_hz,
+                      void (*userFunc)(void)) {
+  if (pins_count == 0 || pins_count > sim::ADC_MAX_PINS || conversions_per_pin == 0 || sampling_freq_hz == 0) {
+    return false;
+  }
+  analogContinuousDeinit();
+  memcpy(sim::adc.pins, pins, pins_count);
+  sim::adc.pinCount = pins_count;
+  sim::adc.conversions = conversions_per_pin;
+  sim::adc.frameUs = (uint64_t)conversions_per_pin * pins_count * 1000000ull / sampling_freq_hz;
+  sim::adc.callback = userFunc;
+  return true;
+}
+
+// Sin esperas: timeout_ms solo se admite como 0
+bool analogContinuousRead(adc_continuous_data_t** buffer, uint32_t timeout_ms) {
+  (void)timeout_ms;
+  if (sim::adc.ready == 0) return false;
+  memcpy(sim::adc.out, sim::adc.pool[sim::adc.head], sizeof(sim::adc.out));
+  sim::adc.head = (sim::adc.head + 1) % sim::ADC_POOL_FRAMES;
+  sim::adc.ready--;
+  *buffer = sim::adc.out;
+  return true;
+}
+
+bool analogContinuousStart() {
+  if (sim::adc.pinCount == 0 || sim::adc.running) return false;
+  sim::adc.running = true;
+  const uint32_t generation = ++sim::adc.generation;
+  sim::after(sim::adc.frameUs, [generation]() { sim::adcFrame(generation); });
+  return true;
+}
+
+bool analogContinuousStop() {
+  if (!sim::adc.running) return false;
+  sim::adc.running = false;
+  sim::adc.generation++;
+  return true;
+}
+
+bool analogContinuousDeinit() {
+  analogContinuousStop();
+  sim::adc.pinCount = 0;
+  sim::adc.ready = 0;
+  sim::adc.head = 0;
+  return true;
+}
+
+void analogContinuousSetAtten(adc_attenuation_t attenuation) { (void)attenuation; }
+void analogContinuousSetWidth(uint8_t bits) { (void)bits; }
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode) {
+  if (pin >= sim::PIN_COUNT) return;
+  sim::pins[pin].isr = isr;
+  sim::pins[pin].edge = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+  if (pin < sim::PIN_COUNT) sim::pins[pin].isr = nullptr;
+}
+
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration) {
+  (void)pin;
+  (void)frequency;
+  (void)duration;
+}
+
+void noTone(uint8_t pin) { (void)pin; }
+
+// =============================================================
+// === Aleatorios ===
+// =============================================================
+uint32_t esp_random() { return sim::nextRandom(); }
+
+long random(long max) { return max <= 0 ? 0 : (long)(sim::nextRandom() % (uint32_t)max); }
+
+long random(long min, long max) { return min >= max ? min : min + random(max - min); }
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0) sim::setSeed(seed);
+}
+
+// =============================================================
+// === Sistema de archivos ===
+// =============================================================
+bool LittleFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles, const char* partitionLabel) {
+  (void)formatOnFail;
+  (void)basePath;
+  (void)maxOpenFiles;
+  (void)partitionLabel;
+  const std::string& root = sim::filesystemRootPath();
+  return mkdir(root.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+// /littlefs/x -> <raíz>/x; el resto de rutas no se toca
+FILE* sim_fopen(const char* path, const char* mode) {
+  static const char PREFIX[] = "/littlefs/";
+  if (strncmp(path, PREFIX, sizeof(PREFIX) - 1) != 0) return ::fopen(path, mode);
+  const std::string mapped = sim::filesystemRootPath() + "/" + (path + sizeof(PREFIX) - 1);
+  return ::fopen(mapped.c_str(), mode);
+}
+
+// fsync() real costaría milisegundos de disco por lectura guardada; basta
+// con contarlo (el fflush previo ya deja el archivo consistente)
+int sim_fsync(int fd) {
+  (void)fd;
+  sim::fsyncs++;
+  return 0;
+}
@@ -0,0 +1,544 @@
+// =============================================================
+// === Dispositivos simulados: bus I2C, BMP180, SSD1306, DHT11, BH1750, NVS ===
+// =============================================================
+#include <map>
+#include <vector>
+
+#include "Adafruit_SSD1306.h"
+#include "Arduino.h"
+#include "BH1750.h"
+#include "driver/rmt_rx.h"
+#include "Preferences.h"
+#include "SimHal.hpp"
+#include "Wire.h"
+#include "include/Bmp085Async.hpp"
+#include "include/Dht11Async.hpp"
+
+TwoWire Wire;
+
+namespace sim {
+namespace {
+
+// Un esclavo del bus: write() recibe una transacción de escritura completa
+// (false = NACK) y read() rellena una lectura
+class I2cDevice {
+ public:
+  virtual ~I2cDevice() {}
+  virtual bool present() const { return true; }
+  virtual bool write(const uint8_t* data, size_t len) = 0;
+  virtual size_t read(uint8_t* out, size_t len) = 0;
+};
+
+// BMP180 a nivel de registros. Usa la calibración de ejemplo de la hoja de
+// datos y, en cada conversión, busca el valor crudo que la compensación
+// entera de Bmp085Async convierte en la temperatura y presión de la traza.
+class Bmp180Model : public I2cDevice {
+ public:
+  Bmp180Model() {
+    const Bmp085Async::Calibration cal = {408, -72, -14383, 32741, 32757, 23153, 6190, 4, -32768, -8711, 2868};
+    calibration_ = cal;
+    const uint16_t words[11] = {(uint16_t)cal.ac1, (uint16_t)cal.ac2, (uint16_t)cal.ac3, cal.ac4, cal.ac5, cal.ac6,
+                                (uint16_t)cal.b1,  (uint16_t)cal.b2,  (uint16_t)cal.mb,  (uint16_t)cal.mc,
+                                (uint16_t)cal.md};
+    for (size_t i = 0; i < 11; i++) {
+      registers_[Bmp085Async::REG_CALIBRATION + 2 * i] = (uint8_t)(words[i] >> 8);
+      registers_[Bmp085Async::REG_CALIBRATION + 2 * i + 1] = (uint8_t)words[i];
+    }
+    registers_[Bmp085Async::REG_CHIP_ID] = Bmp085Async::CHIP_ID;
+  }
+
+  bool present() const override { return !isnan(environment().pressureHpa); }
+
+  bool write(const uint8_t* data, size_t len) override {
+    if (len == 0) return true;
+    pointer_ = data[0];
+    if (len >= 2 && data[0] == Bmp085Async::REG_CONTROL) convert(data[1]);
+    return true;
+  }
+
+  size_t read(uint8_t* out, size_t len) override {
+    for (size_t i = 0; i < len; i++) out[i] = registers_[(uint8_t)(pointer_ + i)];
+    return len;
+  }
+
+ private:
+  void convert(uint8_t command) {
+    const Environment env = environment();
+    // Rango del sensor: -40..85 °C y 300..1100 hPa
+    const float temperature = isnan(env.temperatureC) ? 20.0f : fminf(fmaxf(env.temperatureC, -40.0f), 85.0f);
+    const float pressureHpa = fminf(fmaxf(env.pressureHpa, 300.0f), 1100.0f);
+    Bmp085Async solver;
+    solver.setCalibration(calibration_);
+    if (command == Bmp085Async::CMD_TEMPERATURE) {
+      ut_ = search(UT_MIN, UT_MAX, [&](int32_t ut) {
+        int32_t deci;
+        solver.compensate(ut, 0, deci);
+        return deci;
+      }, (int32_t)lroundf(temperature * 10.0f));
+      setResult((uint32_t)ut_ << 8);
+      return;
+    }
+    const uint8_t oss = (command >> 6) & 3;
+    solver.setOversampling(oss);
+    const int32_t up = search(UP_MIN << oss, UP_MAX << oss, [&](int32_t candidate) {
+      int32_t deci;
+      return solver.compensate(ut_, candidate, deci);
+    }, (int32_t)lroundf(pressureHpa * 100.0f));
+    setResult((uint32_t)up << (8 - oss));
+  }
+
+  // Con esta calibración la compensación solo es creciente en estas ventanas:
+  // por debajo de UT ~20284 se divide por cero y con UP < B3 el resultado se
+  // da la vuelta. Cubren -40..85 °C y 300..1100 hPa con cualquier oss.
+  static constexpr int32_t UT_MIN = 22000;
+  static constexpr int32_t UT_MAX = 41000;
+  static constexpr int32_t UP_MIN = 8000;
+  static constexpr int32_t UP_MAX = 50000;
+
+  // Primer valor crudo cuya salida alcanza `target` (la compensación es creciente)
+  template <typename Fn>
+  static int32_t search(int32_t low, int32_t high, Fn output, int32_t target) {
+    while (low < high) {
+      const int32_t mid = low + (high - low) / 2;
+      if (output(mid) < target) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    return low;
+  }
+
+  void setResult(uint32_t raw24) {
+    registers_[Bmp085Async::REG_RESULT] = (uint8_t)(raw24 >> 16);
+    registers_[Bmp085Async::REG_RESULT + 1] = (uint8_t)(raw24 >> 8);
+    registers_[Bmp085Async::REG_RESULT + 2] = (uint8_t)raw24;
+  }
+
+  Bmp085Async::Calibration calibration_;
+  uint8_t registers_[256] = {};
+  uint8_t pointer_ = 0;
+  int32_t ut_ = 27898;
+};
+
+// SSD1306: acepta comandos y datos, solo cuenta bytes
+class Ssd1306Sink : public I2cDevice {
+ public:
+  bool write(const uint8_t* data, size_t len) override {
+    (void)data;
+    bytes += len;
+    return true;
+  }
+  size_t read(uint8_t* out, size_t len) override {
+    memset(out, 0, len);
+    return len;
+  }
+  uint64_t bytes = 0;
+};
+
+Bmp180Model bmp180;
+Ssd1306Sink ssd1306;
+
+I2cDevice* deviceAt(uint8_t address) {
+  I2cDevice* device = nullptr;
+  if (address == Bmp085Async::ADDRESS) device = &bmp180;
+  if (address == 0x3C) device = &ssd1306;
+  return device && device->present() ? device : nullptr;
+}
+
+std::map<std::string, std::map<std::string, std::string>> nvs;
+
+}  // namespace
+
+uint64_t displayBytes() { return ssd1306.bytes; }
+
+}  // namespace sim
+
+// =============================================================
+// === TwoWire ===
+// =============================================================
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+  (void)sda;
+  (void)scl;
+  if (frequency) clock_ = frequency;
+  return true;
+}
+
+bool TwoWire::setClock(uint32_t frequency) {
+  clock_ = frequency;
+  return true;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  address_ = address;
+  txLen_ = 0;
+  txOverflow_ = false;
+}
+
+size_t TwoWire::write(uint8_t value) {
+  if (txLen_ >= sizeof(tx_)) {
+    txOverflow_ = true;
+    return 0;
+  }
+  tx_[txLen_++] = value;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t len) {
+  size_t n = 0;
+  while (n < len && write(data[n])) n++;
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+  (void)sendStop;
+  if (txOverflow_) return 1;
+  sim::I2cDevice* device = sim::deviceAt(address_);
+  if (!device || !device->write(tx_, txLen_)) return 2;
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t len, bool sendStop) {
+  (void)sendStop;
+  rxLen_ = rxPos_ = 0;
+  sim::I2cDevice* device = sim::deviceAt(address);
+  if (!device) return 0;
+  if (len > sizeof(rx_)) len = sizeof(rx_);
+  rxLen_ = device->read(rx_, len);
+  return (uint8_t)rxLen_;
+}
+
+// =============================================================
+// === Adafruit_SSD1306 ===
+// =============================================================
+Adafruit_SSD1306::Adafruit_SSD1306(uint8_t width, uint8_t height, TwoWire* wire, int8_t resetPin)
+    : wire_(wire), width_(width), height_(height) {
+  (void)resetPin;
+  buffer_ = new uint8_t[(size_t)width * ((height + 7) / 8)]();
+}
+
+Adafruit_SSD1306::~Adafruit_SSD1306() { delete[] buffer_; }
+
+bool Adafruit_SSD1306::begin(uint8_t vcs, uint8_t address) {
+  (void)vcs;
+  address_ = address;
+  wire_->beginTransmission(address_);
+  wire_->write((uint8_t)0x00);
+  wire_->write((uint8_t)0xAE);  // DISPLAYOFF: basta para saber si responde
+  return wire_->endTransmission() == 0;
+}
+
+// Volcado completo: ventana + 1 KB en bloques, y deja el bus a 100 kHz
+// como la biblioteca
+void Adafruit_SSD1306::display() {
+  const uint8_t window[] = {0x00, SSD1306_PAGEADDR, 0, 0xFF, SSD1306_COLUMNADDR, 0, (uint8_t)(width_ - 1)};
+  wire_->beginTransmission(address_);
+  wire_->write(window, sizeof(window));
+  wire_->endTransmission();
+  const size_t total = (size_t)width_ * ((height_ + 7) / 8);
+  for (size_t at = 0; at < total; at += I2C_BUFFER_LENGTH - 1) {
+    const size_t n = total - at < I2C_BUFFER_LENGTH - 1 ? total - at : I2C_BUFFER_LENGTH - 1;
+    wire_->beginTransmission(address_);
+    wire_->write((uint8_t)0x40);
+    wire_->write(buffer_ + at, n);
+    wire_->endTransmission();
+  }
+  wire_->setClock(100000);
+}
+
+void Adafruit_SSD1306::clearDisplay() { memset(buffer_, 0, (size_t)width_ * ((height_ + 7) / 8)); }
+
+void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  if (x < 0 || y < 0 || x >= width_ || y >= height_) return;
+  uint8_t& cell = buffer_[x + (y / 8) * width_];
+  const uint8_t bit = (uint8_t)(1 << (y & 7));
+  if (color == SSD1306_WHITE) cell |= bit;
+  else if (color == SSD1306_BLACK) cell &= (uint8_t)~bit;
+  else cell ^= bit;
+}
+
+void Adafruit_SSD1306::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  for (int16_t i = 0; i < w; i++) {
+    for (int16_t j = 0; j < h; j++) drawPixel(x + i, y + j, color);
+  }
+}
+
+// Celda de 6x8 por carácter (5x7 + separación), escalada por textSize
+size_t Adafruit_SSD1306::write(uint8_t c) {
+  if (c == '\n') {
+    cursorX_ = 0;
+    cursorY_ += 8 * textSize_;
+    return 1;
+  }
+  if (c == '\r') return 1;
+  for (int16_t col = 0; col < 5; col++) {
+    const uint8_t bits = (uint8_t)((c * 0x9Du + col * 0x3Bu + (c >> 3)) & 0x7F);
+    for (int16_t row = 0; row < 7; row++) {
+      if (!(bits & (1 << row))) continue;
+      fillRect(cursorX_ + col * textSize_, cursorY_ + row * textSize_, textSize_, textSize_, textColor_);
+    }
+  }
+  cursorX_ += 6 * textSize_;
+  return 1;
+}
+
+// =============================================================
+// === DHT11 sobre el RMT ===
+// =============================================================
+// Un DHT11 en cada pin con canal RX. Al soltar la línea tras >= 18 ms a
+// nivel bajo contesta con la trama de sim::environment() (humedad entera,
+// temperatura con décimas) y tiempos con ±4 µs de ruido; el canal la
+// entrega en símbolos al cabo de lo que dura. Sin dato en la traza no hay
+// respuesta: solo se captura el flanco de soltar la línea. Una de cada
+// DHT_CORRUPT_ONE_IN tramas llega con un bit cambiado o cortada.
+struct sim_rmt_channel {
+  gpio_num_t pin = GPIO_NUM_NC;
+  rmt_rx_event_callbacks_t callbacks = {};
+  void* context = nullptr;
+  bool enabled = false;
+  uint32_t generation = 0;  // cancela la recepción pendiente
+  rmt_symbol_word_t* buffer = nullptr;
+  size_t capacity = 0;
+};
+
+namespace sim {
+namespace {
+
+constexpr uint32_t DHT_MIN_START_US = 18000;
+constexpr uint32_t DHT_CORRUPT_ONE_IN = 200;
+constexpr uint32_t DHT_IDLE_US = 200;
+
+struct GpioLine {
+  uint32_t level = 1;
+  uint64_t lowSinceUs = 0;
+};
+GpioLine gpioLines[GPIO_NUM_MAX];
+sim_rmt_channel* rmtChannels[GPIO_NUM_MAX] = {};
+
+uint16_t jitter(uint16_t us, uint16_t spread) {
+  return (uint16_t)(us - spread + esp_random() % (2u * spread + 1));
+}
+
+// Niveles que ve el canal desde que se suelta la línea
+std::vector<DhtRun> dhtResponse() {
+  std::vector<DhtRun> runs;
+  runs.push_back({0, (uint16_t)(2 + esp_random() % 4)});  // lo que tarda el firmware en soltar
+  const Environment env = environment();
+  if (isnan(env.temperatureC) || isnan(env.humidityPercent)) return runs;
+
+  const float humidity = env.humidityPercent < 0.0f ? 0.0f : env.humidityPercent > 100.0f ? 100.0f : env.humidityPercent;
+  const int tenths = (int)lroundf(fabsf(env.temperatureC) * 10.0f);
+  uint8_t bytes[5] = {(uint8_t)lroundf(humidity), 0, (uint8_t)(tenths / 10), (uint8_t)(tenths % 10), 0};
+  if (env.temperatureC < 0.0f) bytes[3] |= 0x80;
+  bytes[4] = (uint8_t)(bytes[0] + bytes[1] + bytes[2] + bytes[3]);
+
+  size_t bits = 40;
+  if (esp_random() % DHT_CORRUPT_ONE_IN == 0) {
+    if (esp_random() % 2) {
+      const uint32_t bit = esp_random() % 40;
+      bytes[bit / 8] ^= (uint8_t)(0x80 >> (bit % 8));
+    } else {
+      bits = esp_random() % 40;
+    }
+  }
+
+  runs.push_back({1, jitter(30, 10)});
+  runs.push_back({0, jitter(80, 4)});
+  runs.push_back({1, jitter(80, 4)});
+  for (size_t i = 0; i < bits; i++) {
+    const bool one = bytes[i / 8] & (0x80 >> (i % 8));
+    runs.push_back({0, jitter(50, 4)});
+    runs.push_back({1, jitter(one ? 70 : 27, 4)});
+  }
+  runs.push_back({0, jitter(50, 4)});
+  return runs;
+}
+
+// Por parejas en símbolos; el nivel de reposo final lleva duración 0 (la
+// trama siempre tiene un número impar de niveles)
+void deliverDht(sim_rmt_channel* channel, const std::vector<DhtRun>& runs) {
+  rmt_symbol_word_t* buffer = channel->buffer;
+  channel->buffer = nullptr;
+  size_t count = 0;
+  for (size_t i = 0; i < runs.size() && count < channel->capacity; i += 2, count++) {
+    rmt_symbol_word_t& symbol = buffer[count];
+    symbol.val = 0;
+    symbol.level0 = runs[i].level;
+    symbol.duration0 = runs[i].us;
+    symbol.level1 = 1;
+    if (i + 1 < runs.size()) {
+      symbol.level1 = runs[i + 1].level;
+      symbol.duration1 = runs[i + 1].us;
+    }
+  }
+  if (!channel->callbacks.on_recv_done) return;
+  const rmt_rx_done_event_data_t data = {buffer, count};
+  channel->callbacks.on_recv_done(channel, &data, channel->context);
+}
+
+// El sensor ve soltar la línea
+void releaseDhtLine(gpio_num_t pin, uint64_t lowUs) {
+  sim_rmt_channel* channel = rmtChannels[pin];
+  if (!channel || !channel->buffer || lowUs < DHT_MIN_START_US) return;
+  const std::vector<DhtRun> runs = dhtResponse();
+  uint64_t durationUs = DHT_IDLE_US;
+  for (const DhtRun& run : runs) durationUs += run.us;
+  const uint32_t generation = channel->generation;
+  after(durationUs, [channel, generation, runs]() {
+    if (channel->generation == generation && channel->buffer) deliverDht(channel, runs);
+  });
+}
+
+}  // namespace
+}  // namespace sim
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode) {
+  (void)mode;
+  return gpio_num >= 0 && gpio_num < GPIO_NUM_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t pull) {
+  (void)pull;
+  return gpio_num >= 0 && gpio_num < GPIO_NUM_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+  sim::HalScope hal;
+  if (gpio_num < 0 || gpio_num >= GPIO_NUM_MAX) return ESP_ERR_INVALID_ARG;
+  sim::GpioLine& line = sim::gpioLines[gpio_num];
+  level = level ? 1 : 0;
+  if (line.level == level) return ESP_OK;
+  line.level = level;
+  if (level == 0) {
+    line.lowSinceUs = sim::nowUs();
+  } else {
+    sim::releaseDhtLine(gpio_num, sim::nowUs() - line.lowSinceUs);
+  }
+  return ESP_OK;
+}
+
+esp_err_t rmt_new_rx_channel(const rmt_rx_channel_config_t* config, rmt_channel_handle_t* ret_chan) {
+  if (!config || !ret_chan || config->gpio_num < 0 || config->gpio_num >= GPIO_NUM_MAX) return ESP_ERR_INVALID_ARG;
+  if (sim::rmtChannels[config->gpio_num]) return ESP_ERR_INVALID_STATE;
+  sim_rmt_channel* channel = new sim_rmt_channel();
+  channel->pin = config->gpio_num;
+  sim::rmtChannels[config->gpio_num] = channel;
+  *ret_chan = channel;
+  return ESP_OK;
+}
+
+esp_err_t rmt_rx_register_event_callbacks(rmt_channel_handle_t rx_channel, const rmt_rx_event_callbacks_t* cbs,
+                                          void* user_data) {
+  if (!rx_channel || !cbs) return ESP_ERR_INVALID_ARG;
+  rx_channel->callbacks = *cbs;
+  rx_channel->context = user_data;
+  return ESP_OK;
+}
+
+esp_err_t rmt_enable(rmt_channel_handle_t channel) {
+  if (!channel || channel->enabled) return ESP_ERR_INVALID_STATE;
+  channel->enabled = true;
+  return ESP_OK;
+}
+
+esp_err_t rmt_disable(rmt_channel_handle_t channel) {
+  if (!channel || !channel->enabled) return ESP_ERR_INVALID_STATE;
+  channel->enabled = false;
+  channel->buffer = nullptr;
+  channel->generation++;
+  return ESP_OK;
+}
+
+esp_err_t rmt_del_channel(rmt_channel_handle_t channel) {
+  if (!channel || channel->enabled) return ESP_ERR_INVALID_STATE;
+  sim::rmtChannels[channel->pin] = nullptr;
+  delete channel;
+  return ESP_OK;
+}
+
+esp_err_t rmt_receive(rmt_channel_handle_t rx_channel, void* buffer, size_t buffer_size,
+                      const rmt_receive_config_t* config) {
+  sim::HalScope hal;
+  if (!rx_channel || !buffer || !config) return ESP_ERR_INVALID_ARG;
+  if (!rx_channel->enabled || rx_channel->buffer) return ESP_ERR_INVALID_STATE;
+  rx_channel->buffer = static_cast<rmt_symbol_word_t*>(buffer);
+  rx_channel->capacity = buffer_size / sizeof(rmt_symbol_word_t);
+  return ESP_OK;
+}
+
+// =============================================================
+// === BH1750 ===
+// =============================================================
+bool BH1750::begin(Mode mode, uint8_t address, void* wire) {
+  (void)wire;
+  address_ = address;
+  return configure(mode);
+}
+
+bool BH1750::configure(Mode mode) {
+  if (isnan(sim::environment().lightLux)) return false;
+  mode_ = mode;
+  return true;
+}
+
+// Resolución del modo H: 1 lx en cuentas de 1/1,2 lx
+float BH1750::readLightLevel() {
+  if (mode_ == UNCONFIGURED) return -1.0f;
+  const float lux = sim::environment().lightLux;
+  if (isnan(lux)) return -2.0f;
+  const float counts = roundf(lux * 1.2f);
+  return (counts > 65535.0f ? 65535.0f : counts) / 1.2f;
+}
+
+// =============================================================
+// === Preferences (NVS) ===
+// =============================================================
+// Las reservas del mapa hacen las veces de las de la librería NVS
+bool Preferences::begin(const char* name, bool readOnly, const char* partitionLabel) {
+  sim::HalScope hal;
+  (void)partitionLabel;
+  if (!name || strlen(name) > 15) return false;
+  namespace_ = name;
+  readOnly_ = readOnly;
+  open_ = true;
+  return true;
+}
+
+void Preferences::end() { open_ = false; }
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+  if (!open_ || readOnly_ || !key || (!value && len)) return 0;
+  sim::HalScope hal;
+  sim::nvs[namespace_][key] = std::string((const char*)value, len);
+  return len;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+  sim::HalScope hal;
+  const size_t len = getBytesLength(key);
+  if (len == 0 || !buf || len > maxLen) return 0;
+  memcpy(buf, sim::nvs[namespace_][key].data(), len);
+  return len;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  sim::HalScope hal;
+  if (!open_ || !key) return 0;
+  auto ns = sim::nvs.find(namespace_);
+  if (ns == sim::nvs.end()) return 0;
+  auto entry = ns->second.find(key);
+  return entry == ns->second.end() ? 0 : entry->second.size();
+}
+
+bool Preferences::remove(const char* key) {
+  if (!open_ || readOnly_ || !key) return false;
+  sim::HalScope hal;
+  return sim::nvs[namespace_].erase(key) > 0;
+}
+
+bool Preferences::clear() {
+  if (!open_ || readOnly_) return false;
+  sim::HalScope hal;
+  sim::nvs[namespace_].clear();
+  return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+// =============================================================
+// === driver/rmt_rx.h de ESP-IDF 5 simulado ===
+// =============================================================
+// Un canal RX sobre un GPIO. Si en ese pin hay un sensor modelado (el DHT11
+// de devices.cpp), rmt_receive() recibe su trama en símbolos y llama a
+// on_recv_done desde el planificador, como lo haría la ISR del RMT.
+#include <stddef.h>
+
+#include "driver/gpio.h"
+
+typedef struct sim_rmt_channel* rmt_channel_handle_t;
+
+typedef enum { RMT_CLK_SRC_DEFAULT = 0, RMT_CLK_SRC_APB = 0, RMT_CLK_SRC_REF_TICK } rmt_clock_source_t;
+
+typedef union {
+  struct {
+    uint32_t duration0 : 15;
+    uint32_t level0 : 1;
+    uint32_t duration1 : 15;
+    uint32_t level1 : 1;
+  };
+  uint32_t val;
+} rmt_symbol_word_t;
+
+typedef struct {
+  rmt_symbol_word_t* received_symbols;
+  size_t num_symbols;
+} rmt_rx_done_event_data_t;
+
+typedef bool (*rmt_rx_done_callback_t)(rmt_channel_handle_t rx_chan, const rmt_rx_done_event_data_t* edata,
+                                       void* user_ctx);
+
+typedef struct {
+  rmt_rx_done_callback_t on_recv_done;
+} rmt_rx_event_callbacks_t;
+
+typedef struct {
+  gpio_num_t gpio_num;
+  rmt_clock_source_t clk_src;
+  uint32_t resolution_hz;
+  size_t mem_block_symbols;
+  int intr_priority;
+  struct {
+    uint32_t invert_in : 1;
+    uint32_t with_dma : 1;
+  } flags;
+} rmt_rx_channel_config_t;
+
+typedef struct {
+  uint32_t signal_range_min_ns;
+  uint32_t signal_range_max_ns;
+} rmt_receive_config_t;
+
+esp_err_t rmt_new_rx_channel(const rmt_rx_channel_config_t* config, rmt_channel_handle_t* ret_chan);
+esp_err_t rmt_rx_register_event_callbacks(rmt_channel_handle_t rx_channel, const rmt_rx_event_callbacks_t* cbs,
+                                          void* user_data);
+esp_err_t rmt_enable(rmt_channel_handle_t channel);
+esp_err_t rmt_disable(rmt_channel_handle_t channel);
+esp_err_t rmt_del_channel(rmt_channel_handle_t channel);
+esp_err_t rmt_receive(rmt_channel_handle_t rx_channel, void* buffer, size_t buffer_size,
+                      const rmt_receive_config_t* config);
@@ -0,0 +1,11 @@
+#pragma once
+// esp_heap_caps.h simulado: los ganchos de reserva del heap siempre están
+// activos. operator new/delete del host (heap.cpp) los llaman; el firmware
+// puede definirlos, y si no lo hace quedan los vacíos.
+#include <stddef.h>
+#include <stdint.h>
+
+#define CONFIG_HEAP_USE_HOOKS 1
+
+extern "C" void esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps);
+extern "C" void esp_heap_trace_free_hook(void* ptr);
@@ -0,0 +1,4 @@
+#pragma once
+#include "FreeRTOS.h"
+// El firmware no usa colas de FreeRTOS (SpscQueue.hpp); solo el tipo
+typedef void* QueueHandle_t;
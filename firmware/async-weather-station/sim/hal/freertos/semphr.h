@@ -0,0 +1,9 @@
+#pragma once
+#include "FreeRTOS.h"
+
+struct SimMutex;
+typedef SimMutex* SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticksToWait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex);
@@ -0,0 +1,88 @@
+// =============================================================
+// === Heap del host con los ganchos de ESP-IDF ===
+// =============================================================
+// Sustituye operator new/delete de todo el programa. Las reservas que no
+// vienen del HAL (HalScope) llaman a esp_heap_trace_alloc_hook() y al
+// observador de la simulación; todo corre en un solo hilo.
+#include <stdlib.h>
+
+#include <cstddef>
+#include <new>
+
+#include "SimHal.hpp"
+#include "esp_heap_caps.h"
+
+extern "C" __attribute__((weak)) void esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps) {
+  (void)ptr;
+  (void)size;
+  (void)caps;
+}
+
+extern "C" __attribute__((weak)) void esp_heap_trace_free_hook(void* ptr) { (void)ptr; }
+
+namespace sim {
+namespace {
+
+unsigned halDepth = 0;
+bool inObserver = false;
+std::function<void(size_t)>* observer = nullptr;
+
+void* allocate(size_t size, size_t alignment) {
+  if (size == 0) size = 1;
+  void* ptr = alignment > alignof(std::max_align_t) ? aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+                                                    : malloc(size);
+  if (!ptr) return nullptr;
+  if (halDepth == 0 && !inObserver) {
+    esp_heap_trace_alloc_hook(ptr, size, 0);
+    if (observer) {
+      // El observador puede reservar (backtrace); eso no cuenta
+      inObserver = true;
+      (*observer)(size);
+      inObserver = false;
+    }
+  }
+  return ptr;
+}
+
+void release(void* ptr) {
+  if (!ptr) return;
+  if (halDepth == 0 && !inObserver) esp_heap_trace_free_hook(ptr);
+  free(ptr);
+}
+
+}  // namespace
+
+HalScope::HalScope() { halDepth++; }
+HalScope::~HalScope() { halDepth--; }
+
+void setAllocationObserver(std::function<void(size_t bytes)> fn) {
+  HalScope scope;
+  delete observer;
+  observer = fn ? new std::function<void(size_t)>(std::move(fn)) : nullptr;
+}
+
+}  // namespace sim
+
+void* operator new(size_t size) {
+  void* ptr = sim::allocate(size, 0);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return sim::allocate(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return sim::allocate(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment) {
+  void* ptr = sim::allocate(size, (size_t)alignment);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+void* operator new[](size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+
+void operator delete(void* ptr) noexcept { sim::release(ptr); }
+void operator delete[](void* ptr) noexcept { sim::release(ptr); }
+void operator delete(void* ptr, size_t) noexcept { sim::release(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { sim::release(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { sim::release(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { sim::release(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { sim::release(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { sim::release(ptr); }
@@ -0,0 +1,365 @@
+// =============================================================
+// === Núcleo de la simulación: reloj virtual, eventos y tareas ===
+// =============================================================
+// Planificador cooperativo y determinista sobre ucontext. Las tareas de
+// FreeRTOS son corrutinas con su propia pila; siempre se ejecuta la tarea
+// lista de mayor prioridad (a igual prioridad, la que lleva más tiempo sin
+// ejecutarse) y solo cede en una llamada bloqueante. Cuando no hay ninguna
+// lista, el reloj salta al siguiente evento o despertar: un día sin tráfico
+// cuesta lo mismo que los pasos que dan las tareas en ese día.
+//
+// Los dos núcleos del ESP32 se serializan: las carreras entre tareas no se
+// reproducen aquí (para eso están los atómicos y SpscQueue), el orden de
+// los eventos sí.
+#include <stdarg.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <ucontext.h>
+
+#include <memory>
+#include <queue>
+
+#include "Arduino.h"
+#include "SimHal.hpp"
+
+struct SimTask {
+  enum class State : uint8_t { READY, BLOCKED, DELETED };
+
+  std::string name;
+  TaskFunction_t code = nullptr;
+  void* parameter = nullptr;
+  unsigned priority = 0;
+  int core = -1;
+  State state = State::READY;
+
+  ucontext_t context;
+  uint8_t* stack = nullptr;  // con una página de guarda debajo
+  size_t stackBytes = 0;
+
+  uint64_t wakeUs = 0;        // fin de la espera (UINT64_MAX = sin límite)
+  uint64_t readyUs = 0;       // desde cuándo está lista
+  uint64_t lastRun = 0;       // orden de la última ejecución (round robin)
+  bool waitingNotify = false;
+  SimMutex* waitingMutex = nullptr;
+  uint32_t notifyValue = 0;
+
+  uint64_t steps = 0;
+  sim::LatencyHistogram cpuNs;
+  sim::LatencyHistogram wakeDelayUs;
+};
+
+struct SimMutex {
+  SimTask* owner = nullptr;
+  bool taken = false;
+};
+
+namespace sim {
+namespace {
+
+struct PendingEvent {
+  uint64_t atUs;
+  uint64_t order;
+  Event event;
+};
+struct LaterFirst {
+  bool operator()(const PendingEvent& a, const PendingEvent& b) const {
+    return a.atUs != b.atUs ? a.atUs > b.atUs : a.order > b.order;
+  }
+};
+
+KernelConfig config;
+uint64_t virtualUs = 0;
+uint64_t eventOrder = 0;
+uint64_t runOrder = 0;
+std::priority_queue<PendingEvent, std::vector<PendingEvent>, LaterFirst> events;
+std::vector<std::unique_ptr<SimTask>> tasks;
+SimTask* current = nullptr;
+ucontext_t kernelContext;
+uint64_t stepStartNs = 0;  // CPU del host al empezar el paso en curso
+
+void (*arduinoSetup)() = nullptr;
+void (*arduinoLoop)() = nullptr;
+
+uint64_t hostNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Tiempo del paso en curso convertido a tiempo virtual (modelo de coste)
+uint64_t stepCostUs() {
+  if (!current || config.cpuScale <= 0.0) return 0;
+  return (uint64_t)((double)(hostNs() - stepStartNs) * config.cpuScale / 1000.0);
+}
+
+void taskEntry() {
+  SimTask* task = current;
+  task->code(task->parameter);
+  fatal("la tarea '%s' ha retornado (en FreeRTOS debe llamar a vTaskDelete)", task->name.c_str());
+}
+
+void makeReady(SimTask* task) {
+  task->state = SimTask::State::READY;
+  task->readyUs = virtualUs;
+  task->waitingNotify = false;
+  task->waitingMutex = nullptr;
+}
+
+// Cede hasta `wakeUs` o hasta que otro la despierte
+void block(uint64_t wakeUs) {
+  if (!current) fatal("llamada bloqueante fuera de una tarea (ISR o callback)");
+  SimTask* self = current;
+  self->state = SimTask::State::BLOCKED;
+  self->wakeUs = wakeUs;
+  swapcontext(&self->context, &kernelContext);
+}
+
+SimTask* pickTask() {
+  SimTask* best = nullptr;
+  for (auto& owned : tasks) {
+    SimTask* task = owned.get();
+    if (task->state == SimTask::State::BLOCKED && task->wakeUs <= virtualUs) {
+      task->state = SimTask::State::READY;
+      task->readyUs = task->wakeUs;
+      task->waitingNotify = false;
+      task->waitingMutex = nullptr;
+    }
+    if (task->state != SimTask::State::READY) continue;
+    if (!best || task->priority > best->priority ||
+        (task->priority == best->priority && task->lastRun < best->lastRun)) {
+      best = task;
+    }
+  }
+  return best;
+}
+
+void resume(SimTask* task) {
+  task->steps++;
+  task->lastRun = ++runOrder;
+  task->wakeDelayUs.add(virtualUs - task->readyUs);
+  current = task;
+  stepStartNs = hostNs();
+  swapcontext(&kernelContext, &task->context);
+  const uint64_t cost = stepCostUs();
+  task->cpuNs.add(hostNs() - stepStartNs);
+  current = nullptr;
+  virtualUs += cost;
+  if (task->state == SimTask::State::READY) task->readyUs = virtualUs;
+}
+
+void loopTask(void*) {
+  arduinoSetup();
+  for (;;) {
+    arduinoLoop();
+    yield();
+  }
+}
+
+}  // namespace
+
+uint64_t nowUs() { return virtualUs + stepCostUs(); }
+
+void schedule(uint64_t atUs, Event event) { events.push({atUs, eventOrder++, std::move(event)}); }
+
+void fatal(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  fprintf(stderr, "[sim %.3f s] ", virtualUs / 1e6);
+  vfprintf(stderr, format, args);
+  fputc('\n', stderr);
+  va_end(args);
+  abort();
+}
+
+void configure(const KernelConfig& c) {
+  config = c;
+  virtualUs = c.initialUptimeUs;
+}
+
+void startArduino(void (*setup)(), void (*loop)()) {
+  arduinoSetup = setup;
+  arduinoLoop = loop;
+  xTaskCreatePinnedToCore(loopTask, "loopTask", 8192, nullptr, 1, nullptr, 1);
+}
+
+void run(uint64_t untilUs) {
+  for (;;) {
+    // Los eventos vencidos van antes que las tareas, como una ISR
+    while (!events.empty() && events.top().atUs <= virtualUs) {
+      Event event = std::move(const_cast<PendingEvent&>(events.top()).event);
+      events.pop();
+      event();
+    }
+    if (SimTask* task = pickTask()) {
+      resume(task);
+      continue;
+    }
+    uint64_t next = events.empty() ? UINT64_MAX : events.top().atUs;
+    for (auto& task : tasks) {
+      if (task->state == SimTask::State::BLOCKED && task->wakeUs < next) next = task->wakeUs;
+    }
+    if (next > untilUs) {
+      if (untilUs > virtualUs) virtualUs = untilUs;
+      return;
+    }
+    virtualUs = next;
+  }
+}
+
+std::vector<TaskReport> taskReports() {
+  std::vector<TaskReport> reports;
+  for (auto& task : tasks) {
+    reports.push_back({task->name.c_str(), task->priority, task->core, task->steps, task->cpuNs, task->wakeDelayUs});
+  }
+  return reports;
+}
+
+}  // namespace sim
+
+using sim::block;
+using sim::current;
+using sim::virtualUs;
+
+// =============================================================
+// === API de FreeRTOS ===
+// =============================================================
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char* name, uint32_t stackDepth, void* parameter,
+                                   UBaseType_t priority, TaskHandle_t* created, BaseType_t core) {
+  (void)stackDepth;  // la pila del host es mayor: otra ABI y sin optimizar para tamaño
+  std::unique_ptr<SimTask> task(new SimTask());
+  task->name = name ? name : "";
+  task->code = code;
+  task->parameter = parameter;
+  task->priority = priority;
+  task->core = core;
+
+  const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  task->stackBytes = (sim::config.stackBytes + page - 1) / page * page;
+  void* memory = mmap(nullptr, task->stackBytes + page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) sim::fatal("sin memoria para la pila de '%s'", task->name.c_str());
+  mprotect(memory, page, PROT_NONE);  // desbordar la pila da SIGSEGV, no corrompe otra
+  task->stack = (uint8_t*)memory + page;
+
+  getcontext(&task->context);
+  task->context.uc_stack.ss_sp = task->stack;
+  task->context.uc_stack.ss_size = task->stackBytes;
+  task->context.uc_link = nullptr;
+  makecontext(&task->context, sim::taskEntry, 0);
+  task->readyUs = virtualUs;
+
+  if (created) *created = task.get();
+  sim::tasks.push_back(std::move(task));
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  SimTask* target = task ? task : current;
+  if (!target) return;
+  target->state = SimTask::State::DELETED;
+  // La pila de la tarea en curso se sigue usando hasta el cambio de contexto
+  if (target == current) swapcontext(&target->context, &sim::kernelContext);
+}
+
+// Despierta en el borde del tick, como FreeRTOS (1 tick = 1 ms)
+void vTaskDelay(TickType_t ticks) {
+  const uint64_t now = sim::nowUs();
+  block(ticks == 0 ? now : (now / 1000 + ticks) * 1000);
+}
+
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t increment) {
+  *previousWake += increment;
+  const uint64_t now = sim::nowUs();
+  const uint64_t tick = now / 1000;
+  const int32_t ahead = (int32_t)(*previousWake - (TickType_t)tick);
+  block(ahead > 0 ? (tick + (uint64_t)ahead) * 1000 : now);
+}
+
+TickType_t xTaskGetTickCount() { return (TickType_t)(sim::nowUs() / 1000); }
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return current; }
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+  if (!current) sim::fatal("ulTaskNotifyTake fuera de una tarea");
+  SimTask* self = current;
+  if (self->notifyValue == 0 && ticksToWait > 0) {
+    self->waitingNotify = true;
+    block(ticksToWait == portMAX_DELAY ? UINT64_MAX : (sim::nowUs() / 1000 + ticksToWait) * 1000);
+  }
+  const uint32_t value = self->notifyValue;
+  if (clearOnExit) self->notifyValue = 0;
+  else if (value > 0) self->notifyValue--;
+  return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  if (!task) return pdFAIL;
+  task->notifyValue++;
+  if (task->state == SimTask::State::BLOCKED && task->waitingNotify) sim::makeReady(task);
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+  xTaskNotifyGive(task);
+  if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdTRUE;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  SimTask* target = task ? task : current;
+  return target ? (UBaseType_t)target->stackBytes : 0;
+}
+
+char* pcTaskGetName(TaskHandle_t task) {
+  SimTask* target = task ? task : current;
+  return target ? &target->name[0] : nullptr;
+}
+
+BaseType_t xPortGetCoreID() { return current && current->core >= 0 ? current->core : 0; }
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return new SimMutex(); }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticksToWait) {
+  if (!mutex) return pdFAIL;
+  if (mutex->taken) {
+    if (!current) sim::fatal("mutex ocupado tomado desde un callback o ISR");
+    if (mutex->owner == current) sim::fatal("'%s' toma dos veces el mismo mutex", current->name.c_str());
+    if (ticksToWait == 0) return pdFAIL;
+    const uint64_t deadline =
+        ticksToWait == portMAX_DELAY ? UINT64_MAX : (sim::nowUs() / 1000 + ticksToWait) * 1000;
+    while (mutex->taken) {
+      if (sim::nowUs() >= deadline) return pdFAIL;
+      current->waitingMutex = mutex;
+      block(deadline);
+    }
+  }
+  mutex->taken = true;
+  mutex->owner = current;
+  return pdPASS;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) {
+  if (!mutex || !mutex->taken) return pdFAIL;
+  mutex->taken = false;
+  mutex->owner = nullptr;
+  for (auto& task : sim::tasks) {
+    if (task->state == SimTask::State::BLOCKED && task->waitingMutex == mutex) sim::makeReady(task.get());
+  }
+  return pdPASS;
+}
+
+// =============================================================
+// === Tiempo de Arduino ===
+// =============================================================
+unsigned long millis() { return (uint32_t)(sim::nowUs() / 1000); }
+unsigned long micros() { return (uint32_t)sim::nowUs(); }
+
+void delay(uint32_t ms) {
+  if (!current) sim::fatal("delay() fuera de una tarea");
+  vTaskDelay(ms);
+}
+
+// Espera activa: no cede, solo avanza el reloj
+void delayMicroseconds(uint32_t us) { sim::virtualUs += us; }
+
+void yield() {
+  if (current) vTaskDelay(0);
+}
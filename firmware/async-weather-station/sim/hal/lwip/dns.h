@@ -0,0 +1,22 @@
+#pragma once
+// lwIP simulado: resolución asíncrona contra el servidor DNS de la red simulada
+#include <stdint.h>
+
+typedef int8_t err_t;
+#define ERR_OK 0
+#define ERR_INPROGRESS -5
+#define ERR_VAL -6
+#define ERR_ARG -16
+
+typedef struct {
+  uint32_t addr;
+} ip4_addr_t;
+typedef struct {
+  ip4_addr_t u_addr;
+  uint8_t type;
+} ip_addr_t;
+#define ip_2_ip4(ipaddr) (&((ipaddr)->u_addr))
+#define ip4_addr_get_u32(src) ((src)->addr)
+
+typedef void (*dns_found_callback)(const char* name, const ip_addr_t* ipaddr, void* callbackArg);
+err_t dns_gethostbyname(const char* hostname, ip_addr_t* addr, dns_found_callback found, void* callbackArg);
@@ -0,0 +1,616 @@
+// =============================================================
+// === Red simulada: WiFi, DNS, SNTP y broker MQTT ===
+// =============================================================
+// Un punto de acceso que está o no está (sim::setAccessPoint), un broker en
+// proceso que también puede caer (sim::setBrokerUp) y la hora real que
+// llega por SNTP cuando hay IP. Todo lo asíncrono se entrega con
+// sim::after(), con las latencias de NetworkConfig.
+#include <algorithm>
+
+#include "Arduino.h"
+#include "AsyncMqttClient.h"
+#include "IPAddress.h"
+#include "SimHal.hpp"
+#include "WiFi.h"
+#include "lwip/dns.h"
+
+#undef gettimeofday
+
+const IPAddress INADDR_NONE(0, 0, 0, 0);
+WiFiClass WiFi;
+
+namespace sim {
+namespace {
+
+NetworkConfig net;
+NetworkReport report;
+uint64_t originUs = 0;  // instante de la simulación que corresponde a startEpochMs
+
+// Motivos de desconexión de esp_wifi (wifi_err_reason_t)
+constexpr uint8_t REASON_ASSOC_LEAVE = 8;
+constexpr uint8_t REASON_BEACON_TIMEOUT = 200;
+constexpr uint8_t REASON_NO_AP_FOUND = 201;
+
+const uint8_t AP_BSSID[6] = {0x24, 0xA4, 0x3C, 0x5E, 0x71, 0x02};
+constexpr uint8_t AP_CHANNEL = 6;
+const IPAddress DHCP_ADDRESS(192, 168, 1, 57);
+const IPAddress DHCP_GATEWAY(192, 168, 1, 1);
+const IPAddress DHCP_SUBNET(255, 255, 255, 0);
+const IPAddress DNS_ANSWER(192, 168, 1, 132);  // cualquier nombre resuelve al broker
+
+enum class Radio : uint8_t { IDLE, CONNECTING, ASSOCIATED, CONNECTED };
+
+struct WiFiModel {
+  bool apUp = true;
+  Radio radio = Radio::IDLE;
+  uint32_t attempt = 0;  // cambia con cada begin()/disconnect(): invalida eventos pendientes
+  bool autoReconnect = true;
+  bool fixedAddress = false;
+  IPAddress configIp, configGateway, configSubnet, configDns;
+  IPAddress ip, gateway, subnet, dns;
+  struct Handler {
+    WiFiEventCb simple;
+    WiFiEventFuncCb full;
+    arduino_event_id_t filter;
+  };
+  std::vector<Handler> handlers;
+};
+WiFiModel wifi;
+
+struct TimeModel {
+  bool wanted = false;
+  bool pending = false;
+  bool synced = false;
+};
+TimeModel timeSync;
+
+std::vector<AsyncMqttClient*>& clients() {
+  static std::vector<AsyncMqttClient*> list;
+  return list;
+}
+
+void dispatch(arduino_event_id_t id, const arduino_event_info_t& info) {
+  const std::vector<WiFiModel::Handler> handlers = wifi.handlers;
+  for (const WiFiModel::Handler& h : handlers) {
+    if (h.filter != ARDUINO_EVENT_WIFI_READY && h.filter != id) continue;
+    if (h.simple) h.simple(id);
+    if (h.full) h.full(id, info);
+  }
+}
+
+void dispatchDisconnected(uint8_t reason) {
+  arduino_event_info_t info = {};
+  info.wifi_sta_disconnected.reason = reason;
+  memcpy(info.wifi_sta_disconnected.bssid, AP_BSSID, 6);
+  dispatch(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, info);
+}
+
+int64_t epochUs() {
+  const int64_t uptime = (int64_t)nowUs();
+  if (!timeSync.synced) return uptime;  // como el ESP32: segundos desde el arranque
+  return net.startEpochMs * 1000 + (uptime - (int64_t)originUs);
+}
+
+void startSntp() {
+  if (!timeSync.wanted || timeSync.synced || timeSync.pending || wifi.radio != Radio::CONNECTED) return;
+  timeSync.pending = true;
+  after((uint64_t)net.sntpMs * 1000, [] {
+    timeSync.pending = false;
+    if (wifi.radio == Radio::CONNECTED) {
+      timeSync.synced = true;
+    } else {
+      startSntp();
+    }
+  });
+}
+
+}  // namespace
+}  // namespace sim
+
+// La red corta las conexiones TCP de los clientes MQTT
+struct SimMqttLink {
+  static void drop() {
+    const std::vector<AsyncMqttClient*> list = sim::clients();
+    for (AsyncMqttClient* client : list) client->drop(AsyncMqttClientDisconnectReason::TCP_DISCONNECTED);
+  }
+};
+
+namespace sim {
+namespace {
+
+void linkDown(uint8_t reason) {
+  if (wifi.radio == Radio::IDLE) return;
+  const bool hadIp = wifi.radio == Radio::CONNECTED;
+  if (!hadIp) report.wifiFailures++;
+  wifi.radio = Radio::IDLE;
+  wifi.attempt++;
+  wifi.ip = wifi.gateway = wifi.subnet = wifi.dns = IPAddress();
+  dispatchDisconnected(reason);
+  if (hadIp) SimMqttLink::drop();
+}
+
+}  // namespace
+
+void configureNetwork(const NetworkConfig& config) {
+  net = config;
+  originUs = nowUs();
+}
+
+void setAccessPoint(bool up) {
+  if (wifi.apUp == up) return;
+  wifi.apUp = up;
+  if (!up) linkDown(wifi.radio == Radio::CONNECTED ? REASON_BEACON_TIMEOUT : REASON_NO_AP_FOUND);
+}
+
+bool accessPointUp() { return wifi.apUp; }
+
+void setBrokerUp(bool up) {
+  Broker& b = broker();
+  if (b.up_ == up) return;
+  b.up_ = up;
+  if (!up) SimMqttLink::drop();
+}
+
+NetworkReport networkReport() {
+  NetworkReport r = report;
+  r.clockSynced = timeSync.synced;
+  return r;
+}
+
+// =============================================================
+// === Broker ===
+// =============================================================
+Broker& broker() {
+  static Broker instance;
+  return instance;
+}
+
+bool Broker::matches(const std::string& filter, const std::string& topic) {
+  size_t f = 0;
+  size_t t = 0;
+  while (f < filter.size()) {
+    if (filter[f] == '#') return true;
+    if (filter[f] == '+') {
+      while (t < topic.size() && topic[t] != '/') t++;
+      f++;
+      continue;
+    }
+    if (t >= topic.size() || filter[f] != topic[t]) {
+      // "a/#" también casa con "a"
+      return t == topic.size() && filter.compare(f, std::string::npos, "/#") == 0;
+    }
+    f++;
+    t++;
+  }
+  return t == topic.size();
+}
+
+int Broker::subscribe(const std::string& filter, Sink sink) {
+  const int id = nextId_++;
+  subscriptions_.push_back({id, filter, sink});
+  for (const auto& retained : retained_) {
+    if (matches(filter, retained.first)) sink(retained.first, retained.second, true);
+  }
+  return id;
+}
+
+void Broker::unsubscribe(int id) {
+  subscriptions_.erase(std::remove_if(subscriptions_.begin(), subscriptions_.end(),
+                                      [id](const Subscription& s) { return s.id == id; }),
+                       subscriptions_.end());
+}
+
+void Broker::publish(const std::string& topic, const std::string& payload, bool retain, const char* origin) {
+  TopicStats& stats = stats_[topic];
+  stats.messages++;
+  stats.bytes += payload.size();
+  if (retain) {
+    stats.retained++;
+    if (payload.empty()) {
+      retained_.erase(topic);
+    } else {
+      retained_[topic] = payload;
+    }
+  }
+  if (log_) {
+    // Una línea por mensaje; lo no imprimible (CBOR) va como \xHH
+    fprintf(log_, "%.3f %s %s%s %zu ", nowUs() / 1e6, origin, topic.c_str(), retain ? " (r)" : "", payload.size());
+    for (unsigned char c : payload) {
+      if (c >= 0x20 && c < 0x7F && c != '\\') {
+        fputc(c, log_);
+      } else {
+        fprintf(log_, "\\x%02X", c);
+      }
+    }
+    fputc('\n', log_);
+  }
+  const std::vector<Subscription> subscriptions = subscriptions_;
+  for (const Subscription& s : subscriptions) {
+    if (matches(s.filter, topic)) s.sink(topic, payload, false);
+  }
+}
+
+}  // namespace sim
+
+using sim::net;
+using sim::Radio;
+using sim::wifi;
+
+// =============================================================
+// === WiFiClass ===
+// =============================================================
+bool WiFiClass::mode(wifi_mode_t mode) {
+  if (mode == WIFI_OFF) disconnect();
+  return true;
+}
+
+bool WiFiClass::setHostname(const char* hostname) {
+  (void)hostname;
+  return true;
+}
+
+bool WiFiClass::setAutoReconnect(bool autoReconnect) {
+  wifi.autoReconnect = autoReconnect;
+  return true;
+}
+
+bool WiFiClass::config(IPAddress localIp, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2) {
+  (void)dns2;
+  wifi.fixedAddress = (uint32_t)localIp != 0;
+  wifi.configIp = localIp;
+  wifi.configGateway = gateway;
+  wifi.configSubnet = subnet;
+  wifi.configDns = (uint32_t)dns1 != 0 ? dns1 : gateway;
+  return true;
+}
+
+// Escaneo (o asociación directa) -> CONNECTED -> DHCP (o IP fija) -> GOT_IP
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase, int32_t channel, const uint8_t* bssid,
+                             bool connect) {
+  sim::HalScope hal;
+  (void)ssid;
+  (void)passphrase;
+  if (!connect) return WL_DISCONNECTED;
+  wifi.radio = Radio::CONNECTING;
+  const uint32_t attempt = ++wifi.attempt;
+  const bool direct = channel > 0 && bssid;
+  const bool reachable = wifi.apUp && (!direct || (channel == sim::AP_CHANNEL && memcmp(bssid, sim::AP_BSSID, 6) == 0));
+
+  if (!reachable) {
+    sim::after((uint64_t)(direct ? net.directMs * 3 : net.noApMs) * 1000, [attempt] {
+      if (wifi.attempt == attempt) sim::linkDown(sim::REASON_NO_AP_FOUND);
+    });
+    return WL_DISCONNECTED;
+  }
+  sim::after((uint64_t)(direct ? net.directMs : net.scanMs) * 1000, [attempt] {
+    if (wifi.attempt != attempt) return;
+    wifi.radio = Radio::ASSOCIATED;
+    arduino_event_info_t info = {};
+    memcpy(info.wifi_sta_connected.bssid, sim::AP_BSSID, 6);
+    info.wifi_sta_connected.channel = sim::AP_CHANNEL;
+    sim::dispatch(ARDUINO_EVENT_WIFI_STA_CONNECTED, info);
+
+    sim::after((uint64_t)(wifi.fixedAddress ? net.staticIpMs : net.dhcpMs) * 1000, [attempt] {
+      if (wifi.attempt != attempt) return;
+      wifi.radio = Radio::CONNECTED;
+      if (wifi.fixedAddress) {
+        wifi.ip = wifi.configIp;
+        wifi.gateway = wifi.configGateway;
+        wifi.subnet = wifi.configSubnet;
+        wifi.dns = wifi.configDns;
+      } else {
+        wifi.ip = sim::DHCP_ADDRESS;
+        wifi.gateway = wifi.dns = sim::DHCP_GATEWAY;
+        wifi.subnet = sim::DHCP_SUBNET;
+      }
+      sim::report.wifiConnects++;
+      sim::dispatch(ARDUINO_EVENT_WIFI_STA_GOT_IP, arduino_event_info_t{});
+      sim::startSntp();
+    });
+  });
+  return WL_DISCONNECTED;
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAp) {
+  sim::HalScope hal;
+  (void)wifiOff;
+  (void)eraseAp;
+  if (wifi.radio == Radio::IDLE) return true;
+  const bool hadIp = wifi.radio == Radio::CONNECTED;
+  wifi.radio = Radio::IDLE;
+  const uint32_t attempt = ++wifi.attempt;
+  wifi.ip = wifi.gateway = wifi.subnet = wifi.dns = IPAddress();
+  sim::after(5000, [attempt] {
+    if (wifi.attempt == attempt) sim::dispatchDisconnected(sim::REASON_ASSOC_LEAVE);
+  });
+  if (hadIp) SimMqttLink::drop();
+  return true;
+}
+
+wl_status_t WiFiClass::status() { return wifi.radio == Radio::CONNECTED ? WL_CONNECTED : WL_DISCONNECTED; }
+
+IPAddress WiFiClass::localIP() { return wifi.ip; }
+IPAddress WiFiClass::gatewayIP() { return wifi.gateway; }
+IPAddress WiFiClass::subnetMask() { return wifi.subnet; }
+IPAddress WiFiClass::dnsIP(uint8_t index) { return index == 0 ? wifi.dns : IPAddress(); }
+int8_t WiFiClass::RSSI() { return wifi.radio == Radio::CONNECTED ? sim::environment().rssi : 0; }
+String WiFiClass::SSID() { return wifi.radio == Radio::CONNECTED ? String("sim-ap") : String(); }
+String WiFiClass::macAddress() { return String("24:0A:C4:00:53:11"); }
+
+bool WiFiClass::softAP(const char* ssid, const char* passphrase) {
+  (void)ssid;
+  (void)passphrase;
+  return true;
+}
+IPAddress WiFiClass::softAPIP() { return IPAddress(192, 168, 4, 1); }
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventCb callback, arduino_event_id_t event) {
+  wifi.handlers.push_back({callback, nullptr, event});
+  return (wifi_event_id_t)wifi.handlers.size();
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventFuncCb callback, arduino_event_id_t event) {
+  wifi.handlers.push_back({nullptr, callback, event});
+  return (wifi_event_id_t)wifi.handlers.size();
+}
+
+// =============================================================
+// === DNS (lwIP) ===
+// =============================================================
+err_t dns_gethostbyname(const char* hostname, ip_addr_t* addr, dns_found_callback found, void* callbackArg) {
+  sim::HalScope hal;
+  (void)addr;
+  if (!hostname || !found) return ERR_ARG;
+  sim::report.dnsQueries++;
+  const std::string name = hostname;
+  const bool online = wifi.radio == Radio::CONNECTED;
+  // Sin red, lwIP agota los reintentos y responde con NULL
+  sim::after((uint64_t)(online ? net.dnsMs : 5000) * 1000, [name, found, callbackArg, online] {
+    if (!online || wifi.radio != Radio::CONNECTED) {
+      found(name.c_str(), nullptr, callbackArg);
+      return;
+    }
+    ip_addr_t answer = {};
+    answer.u_addr.addr = (uint32_t)sim::DNS_ANSWER;
+    found(name.c_str(), &answer, callbackArg);
+  });
+  return ERR_INPROGRESS;
+}
+
+// =============================================================
+// === Hora (SNTP y esp32-hal-time.c) ===
+// =============================================================
+int sim_gettimeofday(struct timeval* tv, void* tz) {
+  (void)tz;
+  const int64_t us = sim::epochUs();
+  tv->tv_sec = (time_t)(us / 1000000);
+  tv->tv_usec = (suseconds_t)(us % 1000000);
+  return 0;
+}
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1, const char* server2,
+                const char* server3) {
+  sim::HalScope hal;
+  (void)gmtOffsetSec;
+  (void)daylightOffsetSec;
+  (void)server1;
+  (void)server2;
+  (void)server3;
+  sim::timeSync.wanted = true;
+  sim::startSntp();
+}
+
+void configTzTime(const char* tz, const char* server1, const char* server2, const char* server3) {
+  setenv("TZ", tz, 1);
+  tzset();
+  configTime(0, 0, server1, server2, server3);
+}
+
+// Igual que el core: reintenta cada 10 ms hasta `ms` mientras la hora no sea válida
+bool getLocalTime(struct tm* info, uint32_t ms) {
+  const uint32_t start = millis();
+  while ((uint32_t)(millis() - start) <= ms) {
+    const time_t now = (time_t)(sim::epochUs() / 1000000);
+    localtime_r(&now, info);
+    if (info->tm_year > (2016 - 1900)) return true;
+    delay(10);
+  }
+  return false;
+}
+
+// =============================================================
+// === AsyncMqttClient ===
+// =============================================================
+AsyncMqttClient::AsyncMqttClient() { sim::clients().push_back(this); }
+
+AsyncMqttClient::~AsyncMqttClient() {
+  auto& list = sim::clients();
+  list.erase(std::remove(list.begin(), list.end(), this), list.end());
+}
+
+AsyncMqttClient& AsyncMqttClient::setKeepAlive(uint16_t keepAlive) {
+  (void)keepAlive;
+  return *this;
+}
+AsyncMqttClient& AsyncMqttClient::setClientId(const char* clientId) {
+  (void)clientId;
+  return *this;
+}
+AsyncMqttClient& AsyncMqttClient::setCleanSession(bool cleanSession) {
+  (void)cleanSession;
+  return *this;
+}
+AsyncMqttClient& AsyncMqttClient::setCredentials(const char* username, const char* password) {
+  (void)username;
+  (void)password;
+  return *this;
+}
+AsyncMqttClient& AsyncMqttClient::setWill(const char* topic, uint8_t qos, bool retain, const char* payload,
+                                          size_t length) {
+  (void)topic;
+  (void)qos;
+  (void)retain;
+  (void)payload;
+  (void)length;
+  return *this;
+}
+AsyncMqttClient& AsyncMqttClient::setServer(IPAddress ip, uint16_t port) {
+  (void)ip;
+  (void)port;
+  return *this;
+}
+AsyncMqttClient& AsyncMqttClient::setServer(const char* host, uint16_t port) {
+  (void)host;
+  (void)port;
+  return *this;
+}
+
+AsyncMqttClient& AsyncMqttClient::onConnect(OnConnectUserCallback callback) {
+  onConnect_.push_back(callback);
+  return *this;
+}
+AsyncMqttClient& AsyncMqttClient::onDisconnect(OnDisconnectUserCallback callback) {
+  onDisconnect_.push_back(callback);
+  return *this;
+}
+AsyncMqttClient& AsyncMqttClient::onSubscribe(OnSubscribeUserCallback callback) {
+  onSubscribe_.push_back(callback);
+  return *this;
+}
+AsyncMqttClient& AsyncMqttClient::onUnsubscribe(OnUnsubscribeUserCallback callback) {
+  onUnsubscribe_.push_back(callback);
+  return *this;
+}
+AsyncMqttClient& AsyncMqttClient::onMessage(OnMessageUserCallback callback) {
+  onMessage_.push_back(callback);
+  return *this;
+}
+AsyncMqttClient& AsyncMqttClient::onPublish(OnPublishUserCallback callback) {
+  onPublish_.push_back(callback);
+  return *this;
+}
+
+bool AsyncMqttClient::connected() const { return state_ == State::CONNECTED; }
+
+// TCP + CONNECT/CONNACK en dos RTT; sin red falla enseguida y con el broker
+// caído llega un RST en un RTT
+void AsyncMqttClient::connect() {
+  sim::HalScope hal;
+  if (state_ != State::DISCONNECTED) return;
+  state_ = State::CONNECTING;
+  const uint32_t session = ++session_;
+  const bool online = wifi.radio == Radio::CONNECTED;
+  const uint64_t delayUs =
+      !online ? 1000 : (uint64_t)(sim::broker().up() ? 2 * net.rttMs : net.rttMs) * 1000;
+  sim::after(delayUs, [this, session] {
+    if (session_ != session || state_ != State::CONNECTING) return;
+    if (wifi.radio != Radio::CONNECTED || !sim::broker().up()) {
+      drop(AsyncMqttClientDisconnectReason::TCP_DISCONNECTED);
+      return;
+    }
+    state_ = State::CONNECTED;
+    sim::report.mqttConnects++;
+    sim::broker().connects++;
+    const auto callbacks = onConnect_;
+    for (const auto& cb : callbacks) cb(false);
+  });
+}
+
+// El cierre se confirma de forma asíncrona, como en la biblioteca
+void AsyncMqttClient::disconnect(bool force) {
+  sim::HalScope hal;
+  (void)force;
+  if (state_ == State::DISCONNECTED) return;
+  const uint32_t session = session_;
+  sim::after(1000, [this, session] {
+    if (session_ == session) drop(AsyncMqttClientDisconnectReason::TCP_DISCONNECTED);
+  });
+}
+
+void AsyncMqttClient::drop(AsyncMqttClientDisconnectReason reason) {
+  if (state_ == State::DISCONNECTED) return;
+  if (state_ == State::CONNECTING) sim::report.mqttFailures++;
+  state_ = State::DISCONNECTED;
+  session_++;
+  for (int id : subscriptions_) sim::broker().unsubscribe(id);
+  subscriptions_.clear();
+  sim::report.lostAcks += pendingAcks_.size();
+  pendingAcks_.clear();
+  const auto callbacks = onDisconnect_;
+  for (const auto& cb : callbacks) cb(reason);
+}
+
+uint16_t AsyncMqttClient::nextPacketId() {
+  if (++packetId_ == 0) packetId_ = 1;
+  return packetId_;
+}
+
+uint16_t AsyncMqttClient::subscribe(const char* topic, uint8_t qos) {
+  sim::HalScope hal;
+  if (state_ != State::CONNECTED) return 0;
+  const uint16_t packetId = nextPacketId();
+  const uint32_t session = session_;
+  const std::string filter = topic;
+  sim::after((uint64_t)net.rttMs * 1000, [this, session, filter, packetId, qos] {
+    if (session_ != session) return;
+    subscriptions_.push_back(sim::broker().subscribe(
+        filter, [this, session](const std::string& t, const std::string& payload, bool retained) {
+          sim::after((uint64_t)net.rttMs * 500, [this, session, t, payload, retained] {
+            if (session_ == session) deliver(t, payload, retained);
+          });
+        }));
+    const auto callbacks = onSubscribe_;
+    for (const auto& cb : callbacks) cb(packetId, qos);
+  });
+  return packetId;
+}
+
+uint16_t AsyncMqttClient::unsubscribe(const char* topic) {
+  (void)topic;
+  if (state_ != State::CONNECTED) return 0;
+  return nextPacketId();
+}
+
+uint16_t AsyncMqttClient::publish(const char* topic, uint8_t qos, bool retain, const char* payload, size_t length,
+                                  bool dup, uint16_t messageId) {
+  sim::HalScope hal;
+  (void)dup;
+  if (state_ != State::CONNECTED) return 0;
+  if (payload && length == 0) length = strlen(payload);
+  const uint16_t packetId = qos == 0 ? 1 : (messageId ? messageId : nextPacketId());
+  sim::report.published++;
+
+  const uint32_t session = session_;
+  const std::string t = topic;
+  const std::string body = payload ? std::string(payload, length) : std::string();
+  sim::after((uint64_t)net.rttMs * 500, [session, t, body, retain, this] {
+    if (session_ == session) sim::broker().publish(t, body, retain, "station");
+  });
+  if (qos > 0) {
+    pendingAcks_.push_back(packetId);
+    sim::after((uint64_t)net.rttMs * 1000, [this, session, packetId] {
+      if (session_ != session) return;
+      pendingAcks_.erase(std::find(pendingAcks_.begin(), pendingAcks_.end(), packetId));
+      sim::report.acked++;
+      const auto callbacks = onPublish_;
+      for (const auto& cb : callbacks) cb(packetId);
+    });
+  }
+  return packetId;
+}
+
+// Entrega en trozos del tamaño de un segmento TCP, sin '\0' final
+void AsyncMqttClient::deliver(const std::string& topic, const std::string& payload, bool retained) {
+  std::vector<char> name(topic.begin(), topic.end());
+  name.push_back('\0');
+  const AsyncMqttClientMessageProperties properties = {0, false, retained};
+  const size_t total = payload.size();
+  size_t index = 0;
+  do {
+    const size_t len = std::min(net.mqttChunk, total - index);
+    std::vector<char> chunk(payload.begin() + index, payload.begin() + index + len);
+    const auto callbacks = onMessage_;
+    for (const auto& cb : callbacks) cb(name.data(), chunk.data(), properties, len, index, total);
+    index += len;
+  } while (index < total);
+}
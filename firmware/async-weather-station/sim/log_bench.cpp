@@ -0,0 +1,105 @@
+// =============================================================
+// === Banco de pruebas del log asíncrono (Log.hpp) ===
+// =============================================================
+// Coste de una llamada en el hilo que escribe, con LOG_LEVEL = INFO (el del
+// sketch) y una línea típica del sketch:
+// 1) LOG_ERROR / LOG_WARN / LOG_INFO con sitio en el anillo: reservar el
+//    hueco y formatear en él.
+// 2) LOG_DEBUG, por encima de LOG_LEVEL: compilado como `if (0)`.
+// 3) Anillo lleno: el descarte y su cuenta.
+// 4) drain(): dar formato a la línea final y pasarla a la salida (una
+//    función vacía aquí; en el ESP32, Serial desde la tarea de log).
+// Como referencia, lo que tardaría en salir la misma línea por la UART a
+// 115200 baudios si se escribiera de forma síncrona.
+//
+//   g++ -std=c++17 -O2 -pthread -I.. log_bench.cpp -o log_bench
+//   ./log_bench [millones de llamadas, por defecto 1]
+#define LOG_ANSI 0
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+
+#include "include/Log.hpp"
+
+namespace {
+
+size_t outputBytes = 0;
+void nullOutput(const char*, size_t len) { outputBytes += len; }
+uint32_t clockMs() { return 123456; }
+
+constexpr size_t BATCH = LOG_RING_SLOTS - 1;
+
+// ns por llamada de `call`, vaciando el anillo fuera de la medida
+template <typename Fn>
+double nsPerCall(uint32_t calls, bool drainBetween, Fn call) {
+  std::chrono::steady_clock::duration total{};
+  for (uint32_t done = 0; done < calls; done += BATCH) {
+    const auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < BATCH; i++) call((unsigned long)(done + i));
+    total += std::chrono::steady_clock::now() - t0;
+    if (drainBetween) logger.drain();
+  }
+  const uint32_t rounded = (calls + BATCH - 1) / BATCH * BATCH;
+  return std::chrono::duration<double, std::nano>(total).count() / rounded;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const double millions = argc > 1 ? atof(argv[1]) : 1.0;
+  const uint32_t calls = (uint32_t)(millions * 1e6);
+  logger.begin(nullOutput, clockMs);
+  volatile unsigned long sink = 0;
+
+  const double errorNs = nsPerCall(calls, true, [](unsigned long i) {
+    LOG_ERROR("❌ Cola de lecturas entre núcleos llena (%u descartadas)", (unsigned)i);
+  });
+  const double warnNs = nsPerCall(calls, true, [](unsigned long i) {
+    LOG_WARN("⚠️ MQTT desconectado (motivo %d), reintento en %lu ms", (int)(i % 8), i);
+  });
+  const double infoNs = nsPerCall(calls, true, [](unsigned long i) {
+    LOG_INFO("📨 Envío por %s | enviados %lu, suprimidos %lu", "deadband", i, i * 3);
+  });
+  const double debugNs = nsPerCall(calls, true, [&sink](unsigned long i) {
+    LOG_DEBUG("T=%.1f H=%.1f P=%.2f", i * 0.1, i * 0.2, i * 0.3);
+    sink = sink + i;
+  });
+
+  // Anillo lleno: todas las llamadas van por el descarte
+  for (size_t i = 0; i < LOG_RING_SLOTS; i++) LOG_INFO("relleno %u", (unsigned)i);
+  const uint32_t droppedBefore = logger.dropped();
+  const double fullNs = nsPerCall(calls, false, [](unsigned long i) {
+    LOG_INFO("📨 Envío por %s | enviados %lu, suprimidos %lu", "deadband", i, i * 3);
+  });
+  const uint32_t dropped = logger.dropped() - droppedBefore;
+  logger.drain();
+
+  // drain(): línea a línea con el anillo lleno cada vez
+  std::chrono::steady_clock::duration drainTotal{};
+  size_t drained = 0;
+  outputBytes = 0;
+  for (uint32_t done = 0; done < calls; done += LOG_RING_SLOTS) {
+    for (size_t i = 0; i < LOG_RING_SLOTS; i++) {
+      LOG_INFO("📨 Envío por %s | enviados %lu, suprimidos %lu", "deadband", (unsigned long)i, (unsigned long)done);
+    }
+    const auto t0 = std::chrono::steady_clock::now();
+    drained += logger.drain();
+    drainTotal += std::chrono::steady_clock::now() - t0;
+  }
+  const double drainNs = std::chrono::duration<double, std::nano>(drainTotal).count() / drained;
+  const double lineBytes = (double)outputBytes / drained;
+  const double uartUs = lineBytes * 10.0 * 1e6 / 115200.0;  // 8N1: 10 bits por byte
+
+  printf("LOG_LEVEL = %d, anillo de %d líneas de %d bytes\n\n", LOG_LEVEL, LOG_RING_SLOTS, LOG_LINE_LEN);
+  printf("llamada                          ns\n");
+  printf("LOG_ERROR                   %7.1f\n", errorNs);
+  printf("LOG_WARN                    %7.1f\n", warnNs);
+  printf("LOG_INFO                    %7.1f\n", infoNs);
+  printf("LOG_DEBUG (fuera de nivel)  %7.1f\n", debugNs);
+  printf("LOG_INFO con anillo lleno   %7.1f   (%u descartadas)\n", fullNs, (unsigned)dropped);
+  printf("drain() por línea           %7.1f   (%.0f bytes por línea)\n", drainNs, lineBytes);
+  printf("\nla misma línea por la UART a 115200 baudios: %.0f us que el hilo que escribe ya no espera\n", uartUs);
+  return 0;
+}
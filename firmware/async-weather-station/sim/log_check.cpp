@@ -0,0 +1,212 @@
+// =============================================================
+// === Log asíncrono (Log.hpp) ===
+// =============================================================
+// 1) Desborde: con el anillo lleno cada línea de más se descarta y se
+//    cuenta; el siguiente drain() avisa una sola vez con el número exacto
+//    y luego entrega las líneas guardadas en orden. drain(max) respeta el
+//    máximo y las líneas largas se recortan a LOG_LINE_LEN - 1.
+// 2) Niveles: LOG_DEBUG con LOG_LEVEL = INFO no evalúa sus argumentos.
+// 3) Cuatro productores y un consumidor a la vez sobre un anillo de 8:
+//    de cada productor llegan sus líneas en el orden en que las escribió,
+//    sin duplicados ni líneas a medias, y aceptadas + descartadas =
+//    escritas. Con productores que reintentan llega todo.
+// Con -fsanitize=thread no debe informar de carreras.
+//
+//   g++ -std=c++17 -O2 -pthread -I.. log_check.cpp -o log_check
+//   ./log_check   (termina con código 1 si algo falla)
+#define LOG_ANSI 0
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/Log.hpp"
+
+namespace {
+
+uint32_t failures = 0;
+
+#define EXPECT(cond, ...)                             \
+  do {                                                \
+    if (!(cond)) {                                    \
+      if (failures++ < 20) {                          \
+        printf("  FALLO %s:%d ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__);                          \
+        printf("\n");                                 \
+      }                                               \
+    }                                                 \
+  } while (0)
+
+std::vector<std::string> output;
+
+void capture(const char* text, size_t len) { output.emplace_back(text, len); }
+uint32_t fixedClock() { return 12345; }
+
+// === 1) Desborde ===
+void checkOverflow() {
+  output.clear();
+  logger.begin(capture, fixedClock);
+  for (int i = 0; i < 100; i++) LOG_INFO("linea %d", i);
+  EXPECT(logger.dropped() == 100 - LOG_RING_SLOTS, "descartadas %u", (unsigned)logger.dropped());
+
+  EXPECT(logger.drain(10) == 10, "drain(10)");
+  EXPECT(output.size() == 11 && output[0] == "[log] 68 mensajes descartados\n" &&
+             output[1] == "[    12.345] I linea 0\n" && output[10] == "[    12.345] I linea 9\n",
+         "aviso y primeras líneas: %zu, '%s'", output.size(), output.empty() ? "" : output[0].c_str());
+  EXPECT(logger.drain() == LOG_RING_SLOTS - 10 && output.back() == "[    12.345] I linea 31\n",
+         "resto en orden: '%s'", output.back().c_str());
+  EXPECT(logger.drain() == 0 && output.size() == 1 + LOG_RING_SLOTS, "anillo vacío sin repetir el aviso");
+
+  // Nuevo desborde: el aviso cuenta solo lo de esta vez
+  output.clear();
+  for (int i = 0; i < LOG_RING_SLOTS + 3; i++) LOG_WARN("otra %d", i);
+  logger.drain();
+  EXPECT(output.size() == 1 + LOG_RING_SLOTS && output[0] == "[log] 3 mensajes descartados\n" &&
+             output[1] == "[    12.345] W otra 0\n",
+         "segundo aviso: '%s'", output.empty() ? "" : output[0].c_str());
+
+  // Muchas vueltas al anillo sin perder el orden
+  bool ordered = true;
+  for (int round = 0; round < 20000; round++) {
+    output.clear();
+    const int n = 1 + round % LOG_RING_SLOTS;
+    for (int i = 0; i < n; i++) LOG_ERROR("v%d %d", round, i);
+    logger.drain();
+    if ((int)output.size() != n) ordered = false;
+    for (int i = 0; i < n && ordered; i++) {
+      char expected[64];
+      snprintf(expected, sizeof(expected), "[    12.345] E v%d %d\n", round, i);
+      if (output[i] != expected) ordered = false;
+    }
+  }
+  EXPECT(ordered && logger.dropped() == 71, "orden tras muchas vueltas (%u descartadas)",
+         (unsigned)logger.dropped());
+
+  // Recorte de líneas largas
+  output.clear();
+  std::string longText(300, 'x');
+  LOG_INFO("%s", longText.c_str());
+  logger.drain();
+  const std::string expectedLong = "[    12.345] I " + std::string(LOG_LINE_LEN - 1, 'x') + "\n";
+  EXPECT(output.size() == 1 && output[0] == expectedLong, "línea larga de %zu bytes",
+         output.empty() ? (size_t)0 : output[0].size());
+}
+
+// === 2) Niveles fuera de LOG_LEVEL ===
+int evaluated = 0;
+int sideEffect() { return ++evaluated; }
+
+void checkLevels() {
+  output.clear();
+  LOG_DEBUG("no debe salir %d", sideEffect());
+  LOG_INFO("sí %d", 1);
+  logger.drain();
+  EXPECT(evaluated == 0 && output.size() == 1 && output[0] == "[    12.345] I sí 1\n",
+         "LOG_DEBUG con LOG_LEVEL = INFO: %d evaluaciones, %zu líneas", evaluated, output.size());
+  EXPECT(Logger::levelTag(LOG_LEVEL_ERROR) == 'E' && Logger::levelTag(LOG_LEVEL_DEBUG) == 'D' &&
+             Logger::levelTag(9) == '?',
+         "etiquetas de nivel");
+}
+
+// === 3) Varios productores a la vez ===
+constexpr int PRODUCERS = 4;
+using Ring = LogRing<8, 48>;
+
+bool put(Ring& ring, const char* format, ...) __attribute__((format(printf, 2, 3)));
+bool put(Ring& ring, const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  const bool ok = ring.vwrite(LOG_LEVEL_INFO, 0, format, args);
+  va_end(args);
+  return ok;
+}
+
+// La línea lleva productor, secuencia y una suma que delata una copia a medias
+bool parse(const char* text, unsigned& producer, unsigned& seq) {
+  unsigned check = 0;
+  char tail[32];
+  if (sscanf(text, "p%u s%u c%u %31s", &producer, &seq, &check, tail) != 4) return false;
+  char expected[32];
+  snprintf(expected, sizeof(expected), "%08x", producer * 2654435761u ^ seq);
+  return producer < PRODUCERS && check == (producer * 7 + seq) % 1000 && strcmp(tail, expected) == 0;
+}
+
+void runProducers(bool retry, uint32_t perProducer) {
+  static Ring ring;
+  std::atomic<int> running{PRODUCERS};
+  std::atomic<uint32_t> accepted{0};
+  uint32_t received = 0;
+  uint32_t torn = 0;
+  uint32_t outOfOrder = 0;
+  int64_t last[PRODUCERS];
+  for (int64_t& l : last) l = -1;
+  const uint32_t droppedBefore = ring.dropped();
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < PRODUCERS; p++) {
+    producers.emplace_back([&, p]() {
+      for (uint32_t seq = 0; seq < perProducer;) {
+        char tail[16];
+        snprintf(tail, sizeof(tail), "%08x", (unsigned)p * 2654435761u ^ seq);
+        if (put(ring, "p%u s%u c%u %s", (unsigned)p, (unsigned)seq, ((unsigned)p * 7 + seq) % 1000, tail)) {
+          accepted++;
+          seq++;
+        } else if (retry) {
+          std::this_thread::yield();
+        } else {
+          seq++;
+        }
+        if (seq % 16 == 0) std::this_thread::yield();
+      }
+      running--;
+    });
+  }
+  auto consume = [&](uint8_t, uint32_t, const char* text) {
+    unsigned producer = 0;
+    unsigned seq = 0;
+    if (!parse(text, producer, seq)) {
+      torn++;
+      return;
+    }
+    if ((int64_t)seq <= last[producer]) outOfOrder++;
+    last[producer] = seq;
+    received++;
+  };
+  for (;;) {
+    const bool done = running.load() == 0;
+    if (ring.drain(consume) == 0) {
+      if (done) break;
+      std::this_thread::yield();
+    }
+  }
+  for (std::thread& t : producers) t.join();
+
+  const uint32_t dropped = ring.dropped() - droppedBefore;
+  const uint32_t written = PRODUCERS * perProducer;
+  EXPECT(torn == 0 && outOfOrder == 0, "%s: %u líneas a medias, %u fuera de orden",
+         retry ? "reintentando" : "descartando", (unsigned)torn, (unsigned)outOfOrder);
+  EXPECT(received == accepted.load(), "recibidas %u de %u aceptadas", (unsigned)received, (unsigned)accepted.load());
+  if (retry) {
+    EXPECT(received == written, "reintentando: %u de %u", (unsigned)received, (unsigned)written);
+  } else {
+    EXPECT(accepted.load() + dropped == written, "aceptadas %u + descartadas %u de %u", (unsigned)accepted.load(),
+           (unsigned)dropped, (unsigned)written);
+  }
+  printf("%d productores %s: %u escritas, %u entregadas, %u intentos con el anillo lleno\n", PRODUCERS,
+         retry ? "reintentando" : "descartando", (unsigned)written, (unsigned)received, (unsigned)dropped);
+}
+
+}  // namespace
+
+int main() {
+  checkOverflow();
+  checkLevels();
+  runProducers(false, 200000);
+  runProducers(true, 200000);
+  printf("%s (%u fallos)\n", failures ? "FALLOS" : "OK", failures);
+  return failures ? 1 : 0;
+}
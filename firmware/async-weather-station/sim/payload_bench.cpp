@@ -0,0 +1,343 @@
+// =============================================================
+// === Coste del payload: JsonWriter frente al camino anterior ===
+// =============================================================
+// Antes, buildSensorPayload() llenaba un StaticJsonDocument<512> y lo
+// serializaba en un String que crecía en el heap; ahora writeSensorPayload()
+// escribe en un buffer fijo. Se mide, por payload de json/json-general:
+//   - tiempo en el host (ns),
+//   - reservas del heap y bytes reservados (operator new de este programa),
+//   - bytes generados.
+// Si ArduinoJson está en la ruta de cabeceras se usa la librería real; si
+// no, un modelo del mismo camino: árbol de nodos en un pool fijo, números
+// como los imprime ArduinoJson (9 decimales sin ceros finales) y un String
+// que se amplía al tamaño justo en cada volcado de 32 B, como
+// String::concat(). La igualdad byte a byte con json/json-general la comprueba payload_check.
+//
+//   g++ -std=c++17 -O2 -I.. payload_bench.cpp -o payload_bench
+//   (añadiendo -I.../ArduinoJson/src se mide la librería real)
+//   ./payload_bench [iteraciones]
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <new>
+#include <string>
+
+#include "include/PayloadWriter.hpp"
+
+#if __has_include(<ArduinoJson.h>)
+#define ARDUINOJSON_ENABLE_STD_STRING 1
+#include <ArduinoJson.h>
+#define WITH_ARDUINOJSON 1
+#else
+#define WITH_ARDUINOJSON 0
+#endif
+
+// === Reservas del heap de todo el programa ===
+static uint64_t heapAllocations = 0;
+static uint64_t heapBytes = 0;
+
+void* operator new(size_t size) {
+  heapAllocations++;
+  heapBytes += size;
+  if (void* p = malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+namespace {
+
+const char* const TIMESTAMP = "2025-06-01T12:00:00.000+02:00";
+
+SensorData reading(uint32_t i) {
+  SensorData data;
+  data.altitudeMeters = 650.2f + (float)(i & 7) * 0.1f;
+  data.temperatureC = 21.5f + (float)(i & 15) * 0.1f;
+  data.humidityPercent = 40.0f + (float)(i & 3);
+  data.windSpeedKmh = 3.25f;
+  data.lightLux = 812.5f + (float)(i & 31);
+  data.pressureHpa = 1013.25f;
+  data.gasRaw = 1450 + (int)(i & 63);
+  return data;
+}
+
+#if WITH_ARDUINOJSON
+// buildSensorPayload() tal como era, con std::string en lugar de String
+size_t previousPayload(const SensorData& data, const char* timestamp, std::string& json) {
+  StaticJsonDocument<512> doc;
+  doc["sensor_id"] = "WS_001";
+  doc["sensor_type"] = "weather";
+  doc["street_id"] = "ST_1253";
+  doc["timestamp"] = std::string(timestamp);
+
+  JsonObject location = doc.createNestedObject("location");
+  location["latitude"] = 40.4094736;
+  location["longitude"] = -3.6920903;
+  location["altitude_meters"] = data.altitudeMeters;
+  location["district"] = "Centro";
+  location["neighborhood"] = "Universidad";
+
+  JsonObject readings = doc.createNestedObject("data");
+  readings["temperature_celsius"] = data.temperatureC;
+  readings["humidity_percentage"] = data.humidityPercent;
+  readings["wind_speed"] = data.windSpeedKmh;
+  readings["luz"] = data.lightLux;
+  readings["atmospheric_pressure_hpa"] = data.pressureHpa;
+  readings["air_quality_index"] = data.gasRaw;
+
+  serializeJson(doc, json);
+  return json.size();
+}
+#else
+// === Modelo del camino anterior ===
+// String de Arduino: cada concat() reserva el tamaño justo y copia
+class ArduinoString {
+ public:
+  ~ArduinoString() { delete[] buffer_; }
+  void concat(const char* text, size_t n) {
+    char* grown = new char[len_ + n + 1];
+    if (buffer_) memcpy(grown, buffer_, len_);
+    memcpy(grown + len_, text, n);
+    grown[len_ + n] = '\0';
+    delete[] buffer_;
+    buffer_ = grown;
+    len_ += n;
+  }
+  size_t length() const { return len_; }
+  const char* c_str() const { return buffer_ ? buffer_ : ""; }
+
+ private:
+  char* buffer_ = nullptr;
+  size_t len_ = 0;
+};
+
+// Escritor de serializeJson() sobre String: vuelca cada 31 bytes
+class BufferedWriter {
+ public:
+  explicit BufferedWriter(ArduinoString& out) : out_(out) {}
+  ~BufferedWriter() { flush(); }
+  void write(const char* text, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      buffer_[size_++] = text[i];
+      if (size_ == sizeof(buffer_) - 1) flush();
+    }
+  }
+  void write(const char* text) { write(text, strlen(text)); }
+  void flush() {
+    if (size_) out_.concat(buffer_, size_);
+    size_ = 0;
+  }
+
+ private:
+  ArduinoString& out_;
+  char buffer_[32];
+  size_t size_ = 0;
+};
+
+// Ranura de StaticJsonDocument: clave por puntero, valor en la variante y
+// los miembros de un objeto en lista enlazada (head/tail), como en la librería
+struct Slot {
+  enum Type : uint8_t { STRING, DOUBLE, INTEGER, OBJECT } type;
+  const char* key;
+  const char* text;
+  double number;
+  int64_t integer;
+  int8_t head;
+  int8_t tail;
+  int8_t next;
+};
+
+class Document {
+ public:
+  Document() { slots_[0] = {Slot::OBJECT, nullptr, nullptr, 0, 0, -1, -1, -1}; }
+
+  int8_t object(int8_t parent, const char* key) { return add(parent, {Slot::OBJECT, key, nullptr, 0, 0, -1, -1, -1}); }
+  void set(int8_t parent, const char* key, const char* text, bool copy) {
+    // Las cadenas que no son literales se copian al pool del documento
+    if (copy) {
+      const size_t n = strlen(text) + 1;
+      memcpy(pool_ + poolUsed_, text, n);
+      text = pool_ + poolUsed_;
+      poolUsed_ += n;
+    }
+    add(parent, {Slot::STRING, key, text, 0, 0, -1, -1, -1});
+  }
+  void set(int8_t parent, const char* key, double value) {
+    add(parent, {Slot::DOUBLE, key, nullptr, value, 0, -1, -1, -1});
+  }
+  void set(int8_t parent, const char* key, int value) {
+    add(parent, {Slot::INTEGER, key, nullptr, 0, value, -1, -1, -1});
+  }
+
+  void serialize(ArduinoString& out) const {
+    BufferedWriter writer(out);
+    write(writer, 0);
+  }
+
+ private:
+  int8_t add(int8_t parent, const Slot& slot) {
+    const int8_t index = count_++;
+    slots_[index] = slot;
+    Slot& owner = slots_[parent];
+    if (owner.tail < 0) {
+      owner.head = index;
+    } else {
+      slots_[owner.tail].next = index;
+    }
+    owner.tail = index;
+    return index;
+  }
+
+  void write(BufferedWriter& w, int8_t index) const {
+    const Slot& slot = slots_[index];
+    switch (slot.type) {
+      case Slot::STRING:
+        w.write("\"");
+        w.write(slot.text);
+        w.write("\"");
+        break;
+      case Slot::INTEGER: {
+        char digits[24];
+        w.write(digits, (size_t)snprintf(digits, sizeof(digits), "%lld", (long long)slot.integer));
+        break;
+      }
+      case Slot::DOUBLE:
+        writeDouble(w, slot.number);
+        break;
+      case Slot::OBJECT:
+        w.write("{");
+        for (int8_t child = slot.head; child >= 0; child = slots_[child].next) {
+          if (child != slot.head) w.write(",");
+          w.write("\"");
+          w.write(slots_[child].key);
+          w.write("\":");
+          write(w, child);
+        }
+        w.write("}");
+        break;
+    }
+  }
+
+  // Como FloatParts de ArduinoJson: parte entera y 9 decimales, sin ceros finales
+  static void writeDouble(BufferedWriter& w, double value) {
+    if (isnan(value)) {
+      w.write("NaN");
+      return;
+    }
+    char text[40];
+    size_t n = 0;
+    if (value < 0) {
+      text[n++] = '-';
+      value = -value;
+    }
+    uint64_t integral = (uint64_t)value;
+    uint32_t decimal = (uint32_t)((value - (double)integral) * 1e9 + 0.5);
+    if (decimal >= 1000000000u) {
+      integral++;
+      decimal -= 1000000000u;
+    }
+    n += (size_t)snprintf(text + n, sizeof(text) - n, "%llu", (unsigned long long)integral);
+    if (decimal) {
+      int places = 9;
+      while (decimal % 10 == 0) {
+        decimal /= 10;
+        places--;
+      }
+      n += (size_t)snprintf(text + n, sizeof(text) - n, ".%0*u", places, decimal);
+    }
+    w.write(text, n);
+  }
+
+  Slot slots_[24];
+  int8_t count_ = 1;
+  char pool_[64];
+  size_t poolUsed_ = 0;
+};
+
+size_t previousPayload(const SensorData& data, const char* timestamp, std::string& json) {
+  Document doc;
+  doc.set(0, "sensor_id", "WS_001", false);
+  doc.set(0, "sensor_type", "weather", false);
+  doc.set(0, "street_id", "ST_1253", false);
+  doc.set(0, "timestamp", timestamp, true);  // venía en un String
+
+  const int8_t location = doc.object(0, "location");
+  doc.set(location, "latitude", 40.4094736);
+  doc.set(location, "longitude", -3.6920903);
+  doc.set(location, "altitude_meters", (double)data.altitudeMeters);
+  doc.set(location, "district", "Centro", false);
+  doc.set(location, "neighborhood", "Universidad", false);
+
+  const int8_t readings = doc.object(0, "data");
+  doc.set(readings, "temperature_celsius", (double)data.temperatureC);
+  doc.set(readings, "humidity_percentage", (double)data.humidityPercent);
+  doc.set(readings, "wind_speed", (double)data.windSpeedKmh);
+  doc.set(readings, "luz", (double)data.lightLux);
+  doc.set(readings, "atmospheric_pressure_hpa", (double)data.pressureHpa);
+  doc.set(readings, "air_quality_index", data.gasRaw);
+
+  ArduinoString out;
+  doc.serialize(out);
+  json.assign(out.c_str(), out.length());
+  return out.length();
+}
+#endif
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const uint32_t rounds = argc > 1 ? (uint32_t)atoi(argv[1]) : 200000;
+  printf("Camino anterior: %s\n", WITH_ARDUINOJSON ? "ArduinoJson" : "modelo de ArduinoJson + String");
+
+  // Un ejemplo de cada uno
+  const SensorData sample = reading(0);
+  char buffer[SENSOR_PAYLOAD_MAX_LEN + 1];
+  const size_t ours = writeSensorPayload(sample, TIMESTAMP, buffer, sizeof(buffer));
+  std::string previous;
+  previousPayload(sample, TIMESTAMP, previous);
+  printf("  anterior  %3zu B  %s\n  JsonWriter %3zu B  %s\n", previous.size(), previous.c_str(), ours, buffer);
+
+  // Tiempo y reservas; en el anterior cuenta solo lo que reserva el camino
+  // (la copia a std::string para compararlo no)
+  size_t sink = 0;
+  uint64_t before = heapAllocations;
+  uint64_t beforeBytes = heapBytes;
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < rounds; i++) {
+    const SensorData data = reading(i);
+    sink += writeSensorPayload(data, TIMESTAMP, buffer, sizeof(buffer));
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  const double writerAllocs = (double)(heapAllocations - before) / rounds;
+  const double writerBytes = (double)(heapBytes - beforeBytes) / rounds;
+
+  std::string json;
+  json.reserve(1024);
+  before = heapAllocations;
+  beforeBytes = heapBytes;
+  const auto t2 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < rounds; i++) {
+    const SensorData data = reading(i);
+    json.clear();
+    sink += previousPayload(data, TIMESTAMP, json);
+  }
+  const auto t3 = std::chrono::steady_clock::now();
+  const double previousAllocs = (double)(heapAllocations - before) / rounds;
+  const double previousBytes = (double)(heapBytes - beforeBytes) / rounds;
+
+  const double writerNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / rounds;
+  const double previousNs = std::chrono::duration<double, std::nano>(t3 - t2).count() / rounds;
+  printf("%u payloads:\n", (unsigned)rounds);
+  printf("  anterior   %7.0f ns  %5.1f reservas  %6.0f B reservados por payload\n", previousNs, previousAllocs,
+         previousBytes);
+  printf("  JsonWriter %7.0f ns  %5.1f reservas  %6.0f B reservados por payload (x%.1f)  [%zu]\n", writerNs,
+         writerAllocs, writerBytes, previousNs / writerNs, sink % 10);
+  return writerAllocs == 0.0 ? 0 : 1;
+}
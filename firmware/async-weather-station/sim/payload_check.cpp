@@ -0,0 +1,177 @@
+// =============================================================
+// === Comprobación del payload (PayloadWriter.hpp) ===
+// =============================================================
+// 1) writeSensorPayload() con una lectura conocida coincide byte a byte con
+//    json/json-general, quitando los espacios y sustituyendo los marcadores
+//    ([timestamp], [altitud], ...) por sus valores.
+// 2) JsonWriter::string() escapa comillas, barras y todos los caracteres de
+//    control (\b \f \n \r \t y \u00XX), sin dejar ninguno en crudo.
+// 3) Un buffer un byte más corto que el payload da 0.
+//
+//   g++ -std=c++17 -O2 -I.. payload_check.cpp -o payload_check
+//   ./payload_check [--json DIR]   (termina con código 1 si algo falla)
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "include/PayloadWriter.hpp"
+
+#ifndef JSON_SAMPLES_DIR
+#define JSON_SAMPLES_DIR "../../../json"  // desde sim/
+#endif
+
+namespace {
+
+uint32_t failures = 0;
+
+#define EXPECT(cond, ...)                             \
+  do {                                                \
+    if (!(cond)) {                                    \
+      if (failures++ < 20) {                          \
+        printf("  FALLO %s:%d ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__);                          \
+        printf("\n");                                 \
+      }                                               \
+    }                                                 \
+  } while (0)
+
+struct Placeholder {
+  const char* name;
+  const char* text;
+};
+
+const char* const TIMESTAMP = "2025-06-01T12:00:00+02:00";  // la cabecera pone las comillas
+
+const Placeholder PLACEHOLDERS[] = {
+    {"timestamp", "\"2025-06-01T12:00:00+02:00\""},
+    {"altitud", "650.2"},
+    {"temperatura", "21.5"},
+    {"humedad", "40"},
+    {"viento", "3.25"},
+    {"lx", "812.5"},
+    {"presion", "1013.25"},
+    {"calidad_aire", "1450"},
+};
+
+SensorData referenceReading() {
+  SensorData data;
+  data.altitudeMeters = 650.2f;
+  data.temperatureC = 21.5f;
+  data.humidityPercent = 40.0f;
+  data.windSpeedKmh = 3.25f;
+  data.lightLux = 812.5f;
+  data.pressureHpa = 1013.25f;
+  data.gasRaw = 1450;
+  return data;
+}
+
+bool readFile(const std::string& path, std::string& out) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  char chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) out.append(chunk, n);
+  fclose(f);
+  return true;
+}
+
+// Quita los espacios fuera de las cadenas y sustituye los [marcadores]
+bool normalizeSample(const std::string& in, std::string& out) {
+  size_t i = 0;
+  while (i < in.size()) {
+    const char c = in[i];
+    if (c == '"') {
+      const size_t end = in.find('"', i + 1);
+      if (end == std::string::npos) return false;
+      out.append(in, i, end + 1 - i);
+      i = end + 1;
+    } else if (isspace((unsigned char)c)) {
+      i++;
+    } else if (c == '[') {
+      const size_t end = in.find(']', i);
+      if (end == std::string::npos) return false;
+      const std::string name = in.substr(i + 1, end - i - 1);
+      const Placeholder* found = nullptr;
+      for (const Placeholder& p : PLACEHOLDERS) {
+        if (name == p.name) found = &p;
+      }
+      if (!found) return false;
+      out += found->text;
+      i = end + 1;
+    } else {
+      out += c;
+      i++;
+    }
+  }
+  return true;
+}
+
+void checkSample(const std::string& dir) {
+  std::string raw, want;
+  if (!readFile(dir + "/json-general", raw)) {
+    printf("  no se puede leer %s/json-general\n", dir.c_str());
+    failures++;
+    return;
+  }
+  EXPECT(normalizeSample(raw, want), "json-general con un marcador desconocido");
+
+  char out[SENSOR_PAYLOAD_MAX_LEN + 1];
+  const size_t n = writeSensorPayload(referenceReading(), TIMESTAMP, out, sizeof(out));
+  const bool same = n == want.size() && memcmp(out, want.data(), n) == 0;
+  if (!same) printf("  esperado: %s\n  generado: %.*s\n", want.c_str(), (int)n, out);
+  EXPECT(same, "writeSensorPayload() no coincide con json-general");
+  EXPECT(n <= SENSOR_PAYLOAD_MAX_LEN, "%u B pasa de la cota", (unsigned)n);
+  EXPECT(writeSensorPayload(referenceReading(), TIMESTAMP, out, n) == 0, "sin sitio para el '\\0'");
+  printf("json-general: %s (%u B, cota %u B)\n", same ? "ok" : "MAL", (unsigned)n,
+         (unsigned)SENSOR_PAYLOAD_MAX_LEN);
+}
+
+std::string quoted(const char* text) {
+  char out[256];
+  JsonWriter json(out, sizeof(out));
+  json.string(text);
+  return json.overflow() ? std::string("<desborde>") : std::string(out, json.length());
+}
+
+void expectQuoted(const char* text, const char* want) {
+  const std::string got = quoted(text);
+  EXPECT(got == want, "%s en lugar de %s", got.c_str(), want);
+}
+
+void checkEscapes() {
+  const uint32_t before = failures;
+  expectQuoted("Centro", "\"Centro\"");
+  expectQuoted("Barrio \"Las Letras\"", "\"Barrio \\\"Las Letras\\\"\"");
+  expectQuoted("C:\\ruta", "\"C:\\\\ruta\"");
+  expectQuoted("a\nb\tc\r", "\"a\\nb\\tc\\r\"");
+  expectQuoted("\b\f", "\"\\b\\f\"");
+  expectQuoted("\x01\x1f", "\"\\u0001\\u001f\"");
+  expectQuoted("Ch\u00e1mber\u00ed", "\"Ch\u00e1mber\u00ed\"");  // UTF-8 tal cual
+
+  // Ningún control en crudo y nunca más de MAX_ESCAPED_CHAR_LEN por carácter
+  for (int c = 1; c < 0x80; c++) {
+    const char text[2] = {(char)c, '\0'};
+    const std::string q = quoted(text);
+    bool clean = true;
+    for (char o : q) clean = clean && (unsigned char)o >= 0x20;
+    EXPECT(clean, "0x%02x sale sin escapar", c);
+    EXPECT(q.size() - 2 <= JsonWriter::MAX_ESCAPED_CHAR_LEN, "0x%02x ocupa %u B", c, (unsigned)q.size() - 2);
+  }
+  printf("Escapes de cadenas: %s\n", failures > before ? "MAL" : "ok");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string dir = JSON_SAMPLES_DIR;
+  for (int i = 1; i + 1 < argc; i++) {
+    if (strcmp(argv[i], "--json") == 0) dir = argv[++i];
+  }
+  checkSample(dir);
+  checkEscapes();
+  printf("%s (%u fallos)\n", failures ? "FALLOS" : "OK", failures);
+  return failures ? 1 : 0;
+}
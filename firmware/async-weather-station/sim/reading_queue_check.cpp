@@ -0,0 +1,522 @@
+// =============================================================
+// === Cola persistente de lecturas (ReadingQueue.hpp) ===
+// =============================================================
+// Sobre FileRecordStorage en un fichero temporal, como en el ESP32 sobre
+// LittleFS:
+// 1) Corte de corriente a mitad de escritura en cada byte de un hueco: al
+//    volver, begin() reconstruye cabeza y cola, el hueco roto se rechaza por
+//    CRC y lo confirmado antes sigue ahí, en orden.
+// 2) Corte al marcar una entrada como consumida: o sigue pendiente o ya no
+//    está, nunca aparece corrupta ni se pierde otra.
+// 3) Cola llena: se descarta la más antigua y se cuenta; tras varias vueltas
+//    al anillo begin() encuentra las mismas cabeza y cola.
+// 4) Caída del broker con el bucle de la tarea de red (serviceReadingQueue):
+//    las lecturas se guardan, se reenvían en orden y solo se borran con su
+//    PUBACK, aunque entre la publicación y el servicio lleguen ACK de otras
+//    publicaciones QoS1. El registro de un único "último ACK" que había antes
+//    pierde el de la lectura en ese caso y la reenvía: aquí se comprueba que
+//    PacketAckRing no duplica nada y que el modelo antiguo sí lo hacía.
+// 5) Formato WSQ3: gasPpm y gasQuality del muestreo sobreviven a la cola y
+//    a un reinicio (también NaN / UNKNOWN mientras el MQ-2 calibra). Un
+//    fichero con huecos WSQ2 de 64 B se convierte en el sitio al arrancar:
+//    las lecturas válidas siguen en cola, en orden y sin gas_ppm, y los
+//    huecos consumidos o rotos no reaparecen.
+//
+//   g++ -std=c++17 -O2 -I.. reading_queue_check.cpp -o reading_queue_check
+//   ./reading_queue_check   (termina con código 1 si algo falla)
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "include/ReadingQueue.hpp"
+
+namespace {
+
+uint32_t failures = 0;
+
+#define EXPECT(cond, ...)                             \
+  do {                                                \
+    if (!(cond)) {                                    \
+      if (failures++ < 20) {                          \
+        printf("  FALLO %s:%d ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__);                          \
+        printf("\n");                                 \
+      }                                               \
+    }                                                 \
+  } while (0)
+
+constexpr uint32_t CAPACITY = 16;
+typedef ReadingQueue<CAPACITY> Queue;
+
+// Fichero temporal que se borra al salir
+class TempFile {
+ public:
+  TempFile() {
+    char pattern[] = "/tmp/reading_queue_check.XXXXXX";
+    const int fd = mkstemp(pattern);
+    if (fd >= 0) close(fd);
+    path_ = pattern;
+  }
+  ~TempFile() { unlink(path_.c_str()); }
+  const char* path() const { return path_.c_str(); }
+  void truncate() {
+    FILE* f = fopen(path_.c_str(), "wb");
+    if (f) fclose(f);
+  }
+
+ private:
+  std::string path_;
+};
+
+// Deja pasar `writesLeft` escrituras; la siguiente solo escribe `tornBytes`
+// bytes y a partir de ahí no se escribe nada (sin corriente)
+class CutStorage : public RecordStorage {
+ public:
+  CutStorage(RecordStorage& inner, int writesLeft, size_t tornBytes)
+      : inner_(inner), writesLeft_(writesLeft), tornBytes_(tornBytes) {}
+
+  bool read(uint32_t offset, void* dst, size_t len) override { return inner_.read(offset, dst, len); }
+
+  bool write(uint32_t offset, const void* src, size_t len) override {
+    if (dead_) return false;
+    if (writesLeft_-- > 0) return inner_.write(offset, src, len);
+    dead_ = true;
+    if (tornBytes_ > 0) inner_.write(offset, src, tornBytes_ < len ? tornBytes_ : len);
+    return false;
+  }
+
+  bool dead() const { return dead_; }
+
+ private:
+  RecordStorage& inner_;
+  int writesLeft_;
+  size_t tornBytes_;
+  bool dead_ = false;
+};
+
+StoredReading readingFor(uint32_t n) {
+  StoredReading r;
+  r.timestampMs = 1735689600000LL + (int64_t)n * 30000;
+  r.temperatureC = 20.0f + (float)(n % 50) * 0.1f;
+  r.gasRaw = (int32_t)n;
+  return r;
+}
+
+// Saca todo lo pendiente (con ACK inmediato) y devuelve los n de cada lectura
+std::vector<int32_t> drain(Queue& queue) {
+  std::vector<int32_t> out;
+  StoredReading r;
+  uint32_t seq;
+  while (queue.peek(r, seq)) {
+    out.push_back(r.gasRaw);
+    queue.pop(seq);
+  }
+  return out;
+}
+
+bool isSequence(const std::vector<int32_t>& got, int32_t first, int32_t count) {
+  if (got.size() != (size_t)count) return false;
+  for (int32_t i = 0; i < count; i++) {
+    if (got[(size_t)i] != first + i) return false;
+  }
+  return true;
+}
+
+// === 1) Corte a mitad de escritura de un hueco ===
+// `pushes` lecturas y `pops` confirmadas antes del corte; la siguiente se
+// corta en cada byte posible. Tras reabrir deben quedar `first`.. en orden.
+void checkTornPush(uint32_t pushes, uint32_t pops, int32_t first) {
+  TempFile file;
+  const size_t slotSize = sizeof(Queue::Slot);
+  uint32_t rejected = 0;
+  for (size_t torn = 0; torn <= slotSize; torn++) {
+    file.truncate();
+    FileRecordStorage disk;
+    disk.open(file.path());
+    {
+      CutStorage power(disk, (int)(pushes + pops), torn);
+      Queue queue;
+      queue.begin(&power);
+      for (uint32_t n = 0; n < pushes; n++) queue.push(readingFor(n));
+      StoredReading r;
+      uint32_t seq;
+      for (uint32_t i = 0; i < pops; i++) {
+        if (queue.peek(r, seq)) queue.pop(seq);
+      }
+      queue.push(readingFor(pushes));
+      EXPECT(power.dead() && queue.writeErrors() == 1, "corte no simulado en %zu", torn);
+    }
+    disk.close();
+
+    // Al volver la corriente
+    FileRecordStorage reopened;
+    reopened.open(file.path());
+    Queue queue;
+    queue.begin(&reopened);
+    const std::vector<int32_t> got = drain(queue);
+    // Lo recuperado es siempre un tramo seguido y en orden: el hueco viejo si
+    // el corte no llegó a cambiarlo (magic idéntico), el nuevo si quedó
+    // entero, o ninguno de los dos
+    const bool contiguous = !got.empty() && isSequence(got, got[0], (int32_t)got.size());
+    const int32_t from = contiguous ? got[0] : -1;
+    const int32_t last = contiguous ? got.back() : -1;
+    EXPECT(contiguous && (from == first || from == first - 1) && (last == (int32_t)pushes - 1 || last == (int32_t)pushes),
+           "%u lecturas, corte en el byte %zu: %zu recuperadas desde %d", (unsigned)pushes, torn, got.size(), from);
+    // Cortado dentro de la lectura: ni viejo ni nuevo, el CRC lo rechaza
+    const bool body = torn > offsetof(Queue::Slot, reading) && torn < offsetof(Queue::Slot, crc);
+    const bool keptNew = last == (int32_t)pushes;
+    const bool keptOld = from == first - 1;
+    EXPECT(!body || (!keptNew && !keptOld && isSequence(got, first, (int32_t)pushes - first)),
+           "corte en el byte %zu de la lectura no rechazado", torn);
+    if (!keptNew && !keptOld) rejected++;
+  }
+  printf("corte escribiendo un hueco (%u lecturas): %u de %zu posiciones rechazadas por CRC\n",
+         (unsigned)pushes, (unsigned)rejected, slotSize + 1);
+}
+
+// === 2) Corte al marcar una entrada como consumida ===
+void checkTornPop() {
+  TempFile file;
+  for (size_t torn = 0; torn <= sizeof(uint32_t); torn++) {
+    file.truncate();
+    FileRecordStorage disk;
+    disk.open(file.path());
+    {
+      CutStorage power(disk, 4, torn);
+      Queue queue;
+      queue.begin(&power);
+      for (uint32_t n = 0; n < 4; n++) queue.push(readingFor(n));
+      StoredReading r;
+      uint32_t seq;
+      if (queue.peek(r, seq)) queue.pop(seq);
+    }
+    disk.close();
+
+    FileRecordStorage reopened;
+    reopened.open(file.path());
+    Queue queue;
+    queue.begin(&reopened);
+    const std::vector<int32_t> got = drain(queue);
+    // Magic sin tocar: sigue pendiente (se reenvía, duplicado QoS1 legítimo);
+    // tocado en parte o entero: consumida
+    EXPECT(isSequence(got, 0, 4) || isSequence(got, 1, 3), "pop cortado en el byte %zu: %zu lecturas", torn,
+           got.size());
+    EXPECT(torn != 0 || got.size() == 4, "pop sin escribir nada debe dejarla pendiente");
+    EXPECT(torn == 0 || got.size() == 3, "pop cortado en el byte %zu la deja a medias", torn);
+  }
+}
+
+// === 3) Cola llena y reconstrucción tras varias vueltas ===
+void checkFullAndRebuild() {
+  TempFile file;
+  FileRecordStorage disk;
+  disk.open(file.path());
+  Queue queue;
+  queue.begin(&disk);
+  for (uint32_t n = 0; n < CAPACITY + 5; n++) queue.push(readingFor(n));
+  EXPECT(queue.size() == CAPACITY && queue.dropped() == 5, "llena: %u pendientes, %u descartadas",
+         (unsigned)queue.size(), (unsigned)queue.dropped());
+  StoredReading r;
+  uint32_t seq;
+  EXPECT(queue.peek(r, seq) && r.gasRaw == 5 && seq == 5, "la más antigua tras descartar es la %d", (int)r.gasRaw);
+
+  // Varias vueltas al anillo con ACK parciales
+  uint32_t next = CAPACITY + 5;
+  for (int round = 0; round < 7; round++) {
+    for (int i = 0; i < 9; i++) {
+      if (queue.peek(r, seq)) queue.pop(seq);
+    }
+    for (int i = 0; i < 6; i++) queue.push(readingFor(next++));
+  }
+  const uint32_t size = queue.size();
+  queue.peek(r, seq);
+  const int32_t head = r.gasRaw;
+  disk.close();
+
+  FileRecordStorage reopened;
+  reopened.open(file.path());
+  Queue again;
+  again.begin(&reopened);
+  EXPECT(again.size() == size, "tras reabrir %u pendientes, antes %u", (unsigned)again.size(), (unsigned)size);
+  EXPECT(isSequence(drain(again), head, (int32_t)size), "orden tras reabrir");
+}
+
+// === 4) Caída del broker y ACK ajenos ===
+// Lo que hace serviceReadingQueue() con una publicación en vuelo
+struct RingAcks {
+  PacketAckRing<16> ring;
+  void beforePublish() {}
+  void record(uint16_t id) { ring.record(id); }
+  bool take(uint16_t id) { return ring.take(id); }
+};
+
+// El registro anterior: un único id, puesto a 0 antes de publicar una lectura
+struct SingleSlotAcks {
+  uint16_t last = 0;
+  void beforePublish() { last = 0; }
+  void record(uint16_t id) { last = id; }
+  bool take(uint16_t id) { return last == id; }
+};
+
+struct Delivery {
+  uint32_t tick;
+  uint16_t packetId;
+};
+
+struct Outcome {
+  std::vector<int32_t> received;  // lecturas que llegan al broker, en orden
+  uint32_t duplicates = 0;        // reenvíos de lecturas cuyo PUBACK sí llegó
+  uint32_t backlog = 0;           // máximo de lecturas guardadas durante una caída
+};
+
+template <typename Acks>
+Outcome runNetwork(uint32_t seed) {
+  std::mt19937 rng(seed);
+  auto chance = [&](uint32_t percent) { return std::uniform_int_distribution<uint32_t>(0, 99)(rng) < percent; };
+
+  TempFile file;
+  FileRecordStorage disk;
+  disk.open(file.path());
+  ReadingQueue<256> queue;
+  queue.begin(&disk);
+  Acks acks;
+  Outcome outcome;
+  std::vector<Delivery> pendingAcks;   // en orden, como los entrega el broker
+  std::vector<bool> acked(65536, false);  // PUBACK entregado al cliente, por id
+
+  uint16_t nextPacketId = 1;
+  auto publish = [&](uint32_t tick) {
+    const uint16_t id = nextPacketId++;
+    if (nextPacketId == 0) nextPacketId = 1;
+    acked[id] = false;
+    pendingAcks.push_back({tick + 1 + std::uniform_int_distribution<uint32_t>(0, 3)(rng), id});
+    return id;
+  };
+
+  bool inflight = false;
+  uint16_t inflightId = 0;
+  uint32_t inflightSeq = 0;
+  uint32_t sentTick = 0;
+  constexpr uint32_t ACK_TIMEOUT_TICKS = 50;
+  uint32_t sampled = 0;
+
+  for (uint32_t tick = 0; tick < 20000; tick++) {
+    // Broker caído en [4000, 6000) y [12000, 12500): ni mensajes ni ACK
+    const bool up = !(tick >= 4000 && tick < 6000) && !(tick >= 12000 && tick < 12500);
+    if (!up) pendingAcks.clear();
+
+    // Tarea de sensores: una lectura cada 10 ticks
+    if (tick % 10 == 0) queue.push(readingFor(sampled++));
+    if (queue.size() > outcome.backlog) outcome.backlog = queue.size();
+
+    // Tarea del cliente MQTT: ACK que tocan en este tick, en orden
+    size_t delivered = 0;
+    while (delivered < pendingAcks.size() && pendingAcks[delivered].tick <= tick) {
+      acked[pendingAcks[delivered].packetId] = true;
+      acks.record(pendingAcks[delivered].packetId);
+      delivered++;
+    }
+    pendingAcks.erase(pendingAcks.begin(), pendingAcks.begin() + (long)delivered);
+
+    // Tarea de red: otras publicaciones QoS1 de vez en cuando
+    if (up && chance(3)) publish(tick);
+
+    // serviceReadingQueue()
+    if (inflight) {
+      if (acks.take(inflightId)) {
+        queue.pop(inflightSeq);
+        inflight = false;
+      } else if (!up || tick - sentTick > ACK_TIMEOUT_TICKS) {
+        inflight = false;
+        if (acked[inflightId]) outcome.duplicates++;
+      }
+    }
+    StoredReading r;
+    uint32_t seq;
+    if (!inflight && up && queue.peek(r, seq)) {
+      acks.beforePublish();
+      inflightId = publish(tick);
+      inflightSeq = seq;
+      sentTick = tick;
+      inflight = true;
+      outcome.received.push_back(r.gasRaw);
+      // Mismo tick que la lectura, a veces: otra publicación justo detrás
+      if (chance(20)) publish(tick);
+    }
+  }
+  return outcome;
+}
+
+void checkOutage() {
+  uint32_t oldDuplicates = 0;
+  for (uint32_t seed = 1; seed <= 5; seed++) {
+    const Outcome ring = runNetwork<RingAcks>(seed);
+    // Lo reenviado tras una caída se repite en `received`; sin repeticiones
+    // tiene que quedar la secuencia completa, sin huecos ni desorden
+    std::vector<int32_t> unique;
+    bool ordered = true;
+    for (int32_t n : ring.received) {
+      if (!unique.empty() && n < unique.back()) ordered = false;
+      if (unique.empty() || n > unique.back()) unique.push_back(n);
+    }
+    EXPECT(ring.duplicates == 0, "semilla %u: %u lecturas reenviadas con su PUBACK recibido", (unsigned)seed,
+           (unsigned)ring.duplicates);
+    EXPECT(ordered && isSequence(unique, 0, (int32_t)unique.size()) && unique.size() >= 1990,
+           "semilla %u: %zu lecturas entregadas", (unsigned)seed, unique.size());
+    EXPECT(ring.backlog >= 195, "semilla %u: %u lecturas guardadas durante la caída",
+           (unsigned)seed, (unsigned)ring.backlog);
+
+    const Outcome old = runNetwork<SingleSlotAcks>(seed);
+    oldDuplicates += old.duplicates;
+  }
+  EXPECT(oldDuplicates > 0, "el registro de un solo ACK debería duplicar lecturas en este escenario");
+  printf("caídas del broker con ACK ajenos: 0 duplicados (con un único \"último ACK\": %u)\n",
+         (unsigned)oldDuplicates);
+}
+
+// PacketAckRing por sí solo
+void checkAckRing() {
+  PacketAckRing<4> ring;
+  EXPECT(!ring.take(7), "vacío");
+  ring.record(7);
+  ring.record(8);  // ACK de otra publicación detrás del de la lectura
+  EXPECT(ring.take(7) && !ring.take(7), "un id se consume una vez");
+  EXPECT(ring.take(8), "el otro sigue");
+  ring.record(0);
+  EXPECT(!ring.take(0), "el id 0 no existe en MQTT");
+  for (uint16_t id = 100; id < 110; id++) ring.record(id);
+  EXPECT(ring.take(109) && !ring.take(100), "se guardan los últimos N");
+}
+
+// Hueco de 64 B del formato WSQ2, escrito como lo hacía la versión anterior
+struct SlotWsq2 {
+  uint32_t magic;
+  uint32_t seq;
+  int64_t timestampMs;
+  float temperatureC, humidityPercent, pressureHpa, altitudeMeters, lightLux, windSpeedKmh, windGustKmh;
+  int32_t gasRaw;
+  uint32_t uptimeMs;
+  uint32_t bootId;
+  uint32_t crc;
+};
+
+uint32_t crc32(const void* data, size_t len) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= bytes[i];
+    for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+  }
+  return ~crc;
+}
+
+}  // namespace
+
+// === 5) Formato WSQ3 ===
+void checkFormat() {
+  TempFile file;
+  {
+    FileRecordStorage disk;
+    disk.open(file.path());
+    Queue queue;
+    queue.begin(&disk);
+    SensorData calibrating;
+    calibrating.gasRaw = 1450;
+    queue.push(StoredReading::from(calibrating));
+    SensorData measured;
+    measured.gasRaw = 1730;
+    measured.gasPpm = 412.5f;
+    measured.gasQuality = AirQuality::POOR;
+    queue.push(StoredReading::from(measured, 7));
+  }
+
+  FileRecordStorage reopened;
+  reopened.open(file.path());
+  Queue queue;
+  queue.begin(&reopened);
+  StoredReading r;
+  uint32_t seq = 0;
+  EXPECT(queue.peek(r, seq), "lectura en cola tras reabrir");
+  SensorData first = r.toSensorData();
+  EXPECT(isnan(first.gasPpm) && first.gasQuality == AirQuality::UNKNOWN && first.gasRaw == 1450,
+         "calibrando: ppm %.1f, nivel %d", first.gasPpm, (int)first.gasQuality);
+  queue.pop(seq);
+  EXPECT(queue.peek(r, seq), "segunda lectura");
+  SensorData second = r.toSensorData();
+  EXPECT(second.gasPpm == 412.5f && second.gasQuality == AirQuality::POOR && r.bootId == 7,
+         "medida: ppm %.1f, nivel %d", second.gasPpm, (int)second.gasQuality);
+
+  // Fichero de la versión anterior: huecos de 64 B con magic "WSQ2". La cola
+  // ya dio la vuelta (seq 7..CAPACITY+6), la 9 estaba consumida y la 11 se
+  // quedó a medias.
+  TempFile old;
+  {
+    FileRecordStorage disk;
+    disk.open(old.path());
+    for (uint32_t seq = 7; seq < CAPACITY + 7; seq++) {
+      SlotWsq2 slot;
+      memset(&slot, 0, sizeof(slot));
+      slot.magic = seq == 9 ? 0 : 0x57535132;
+      slot.seq = seq;
+      slot.timestampMs = 1735689600000LL + seq;
+      slot.temperatureC = (float)seq;
+      slot.gasRaw = (int32_t)(1000 + seq);
+      slot.bootId = 3;
+      slot.crc = crc32(&slot, offsetof(SlotWsq2, crc));
+      if (seq == 11) slot.temperatureC = -1.0f;
+      disk.write((seq % CAPACITY) * (uint32_t)sizeof(slot), &slot, sizeof(slot));
+    }
+  }
+  {
+    FileRecordStorage oldDisk;
+    oldDisk.open(old.path());
+    Queue fresh;
+    fresh.begin(&oldDisk);
+    EXPECT(fresh.migrated() == CAPACITY - 2, "convertidas %u de %u", (unsigned)fresh.migrated(),
+           (unsigned)(CAPACITY - 2));
+    std::vector<uint32_t> seqs;
+    bool intact = true;
+    StoredReading r;
+    uint32_t seq = 0;
+    while (fresh.peek(r, seq)) {
+      const SensorData d = r.toSensorData();
+      if (r.timestampMs != 1735689600000LL + seq || d.temperatureC != (float)seq || d.gasRaw != (int)(1000 + seq) ||
+          r.bootId != 3 || !isnan(d.gasPpm) || d.gasQuality != AirQuality::UNKNOWN) {
+        intact = false;
+      }
+      seqs.push_back(seq);
+      fresh.pop(seq);
+    }
+    std::vector<uint32_t> expected;
+    for (uint32_t s = 7; s < CAPACITY + 7; s++) {
+      if (s != 9 && s != 11) expected.push_back(s);
+    }
+    EXPECT(seqs == expected && intact, "%u lecturas WSQ2 en cola tras convertir, esperadas %u en orden",
+           (unsigned)seqs.size(), (unsigned)expected.size());
+  }
+  // Ya convertido y consumido: el siguiente arranque no migra nada otra vez
+  FileRecordStorage again;
+  again.open(old.path());
+  Queue reread;
+  reread.begin(&again);
+  EXPECT(reread.migrated() == 0 && reread.size() == 0, "segunda conversión: %u, en cola %u",
+         (unsigned)reread.migrated(), (unsigned)reread.size());
+}
+
+int main() {
+  checkTornPush(5, 2, 2);
+  checkTornPush(CAPACITY + 3, 0, 4);  // la cola ya dio la vuelta: pisa la seq 3, que iba a descartarse
+  checkTornPop();
+  checkFullAndRebuild();
+  checkAckRing();
+  checkOutage();
+  checkFormat();
+  printf("%s (%u fallos)\n", failures ? "FALLOS" : "OK", failures);
+  return failures ? 1 : 0;
+}
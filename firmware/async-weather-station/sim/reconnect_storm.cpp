@@ -0,0 +1,198 @@
+// =============================================================
+// === Simulación: tormenta de reconexiones tras caer el broker ===
+// =============================================================
+// N estaciones conectadas al mismo broker; el broker cae y vuelve. Compara
+// el reintento fijo de antes (cada 5 s, todas a la vez) con
+// ReconnectController (espera exponencial con jitter por estación).
+//
+// El broker acepta como mucho --capacity CONNECT por segundo; los que
+// sobran se rechazan y cuentan como fallo, igual que un broker saturado.
+//
+//   g++ -std=c++17 -O2 -I.. reconnect_storm.cpp -o reconnect_storm
+//   ./reconnect_storm [--stations N] [--outage-s S] [--capacity C] [--series]
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "include/ReconnectPolicy.hpp"
+
+namespace {
+
+constexpr uint32_t STEP_MS = 10;
+constexpr uint32_t RTT_MS = 20;            // un rechazo o un RST llega en un RTT
+constexpr uint32_t HANDSHAKE_MS = 50;      // TCP + CONNECT/CONNACK
+constexpr uint32_t LEGACY_RETRY_MS = 5000; // HandleMqttTasks() original
+
+struct Options {
+  uint32_t stations = 1000;
+  uint32_t outageStartMs = 60000;
+  uint32_t outageMs = 120000;
+  uint32_t capacityPerS = 100;
+  uint32_t durationMs = 900000;
+  bool series = false;
+};
+
+// Broker con admisión limitada por ventanas de 100 ms
+class FakeBroker {
+ public:
+  explicit FakeBroker(const Options& o) : options_(o) {}
+
+  bool up(uint32_t nowMs) const {
+    return nowMs < options_.outageStartMs || nowMs >= options_.outageStartMs + options_.outageMs;
+  }
+
+  // true si el CONNECT se acepta
+  bool admit(uint32_t nowMs) {
+    if (!up(nowMs)) return false;
+    const uint32_t slot = nowMs / 100;
+    if (slot != slot_) {
+      slot_ = slot;
+      admitted_ = 0;
+    }
+    if (admitted_ >= std::max<uint32_t>(1, options_.capacityPerS / 10)) return false;
+    admitted_++;
+    return true;
+  }
+
+ private:
+  const Options& options_;
+  uint32_t slot_ = UINT32_MAX;
+  uint32_t admitted_ = 0;
+};
+
+struct Station {
+  ReconnectController controller;
+  bool connected = false;
+  bool pending = false;      // intento en vuelo
+  bool willSucceed = false;
+  uint32_t resultAtMs = 0;
+  // Política antigua
+  uint32_t lastRetryMs = 0;
+};
+
+struct Result {
+  uint32_t attempts = 0;
+  uint32_t failures = 0;
+  uint32_t peakPerS = 0;
+  uint32_t peakAtS = 0;
+  uint32_t recoveryPeakPerS = 0;  // pico una vez que el broker ha vuelto
+  uint32_t allBackMs = 0;    // desde que vuelve el broker hasta tener a todas
+  std::vector<uint32_t> perSecond;
+};
+
+Result run(const Options& o, bool legacy) {
+  FakeBroker broker(o);
+  std::vector<Station> stations(o.stations);
+  ReconnectConfig config;
+  for (uint32_t i = 0; i < o.stations; i++) {
+    char clientId[16];
+    snprintf(clientId, sizeof(clientId), "WS_%04u", (unsigned)i);
+    stations[i].controller.configure(config);
+    stations[i].controller.seed(ReconnectBackoff::hashSeed((const uint8_t*)clientId, strlen(clientId)));
+    stations[i].controller.onLinkUp(0);
+  }
+
+  Result r;
+  r.perSecond.assign(o.durationMs / 1000 + 1, 0);
+  bool wasUp = true;
+  const uint32_t brokerBackMs = o.outageStartMs + o.outageMs;
+
+  for (uint32_t now = 0; now <= o.durationMs; now += STEP_MS) {
+    const bool up = broker.up(now);
+    uint32_t connectedCount = 0;
+    for (Station& s : stations) {
+      // El broker cae: todas las sesiones se cortan en el mismo instante
+      if (wasUp && !up && s.connected) {
+        s.connected = false;
+        s.lastRetryMs = now;
+        s.controller.onDisconnected(now);
+      }
+      if (s.pending && now >= s.resultAtMs) {
+        s.pending = false;
+        if (s.willSucceed) {
+          s.connected = true;
+          s.controller.onConnected(now);
+        } else {
+          r.failures++;
+          s.controller.onDisconnected(now);
+        }
+      }
+
+      bool connect = false;
+      if (legacy) {
+        // 5 s fijos desde el último intento, sin reparto entre estaciones
+        connect = !s.connected && !s.pending && now - s.lastRetryMs > LEGACY_RETRY_MS;
+        if (connect) s.lastRetryMs = now;
+      } else {
+        connect = s.controller.poll(now, true) == ReconnectController::Action::CONNECT;
+      }
+      if (connect) {
+        r.attempts++;
+        r.perSecond[now / 1000]++;
+        s.pending = true;
+        s.willSucceed = broker.admit(now);
+        s.resultAtMs = now + (s.willSucceed ? HANDSHAKE_MS : RTT_MS);
+      }
+      if (s.connected) connectedCount++;
+    }
+    wasUp = up;
+    if (now >= brokerBackMs && r.allBackMs == 0 && connectedCount == o.stations) r.allBackMs = now - brokerBackMs;
+  }
+
+  for (size_t s = o.outageStartMs / 1000; s < r.perSecond.size(); s++) {
+    if (r.perSecond[s] > r.peakPerS) {
+      r.peakPerS = r.perSecond[s];
+      r.peakAtS = (uint32_t)s;
+    }
+    if (s >= brokerBackMs / 1000) r.recoveryPeakPerS = std::max(r.recoveryPeakPerS, r.perSecond[s]);
+  }
+  return r;
+}
+
+void printResult(const char* name, const Result& r) {
+  printf("%-8s intentos %7u  fallidos %7u  pico %5u/s (t=%us)  pico al volver %5u/s  todas en %6.1f s\n", name,
+         (unsigned)r.attempts, (unsigned)r.failures, (unsigned)r.peakPerS, (unsigned)r.peakAtS,
+         (unsigned)r.recoveryPeakPerS, r.allBackMs / 1000.0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options o;
+  for (int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if (!strcmp(argv[i], "--stations") && hasValue) {
+      o.stations = (uint32_t)atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--outage-s") && hasValue) {
+      o.outageMs = (uint32_t)atoi(argv[++i]) * 1000;
+    } else if (!strcmp(argv[i], "--capacity") && hasValue) {
+      o.capacityPerS = (uint32_t)atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--series")) {
+      o.series = true;
+    } else {
+      fprintf(stderr, "uso: %s [--stations N] [--outage-s S] [--capacity C] [--series]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  printf("%u estaciones, broker caído %u s desde t=%u s, admite %u CONNECT/s\n", (unsigned)o.stations,
+         (unsigned)(o.outageMs / 1000), (unsigned)(o.outageStartMs / 1000), (unsigned)o.capacityPerS);
+  const Result legacy = run(o, true);
+  const Result backoff = run(o, false);
+  printResult("fijo 5s", legacy);
+  printResult("backoff", backoff);
+
+  if (o.series) {
+    printf("\n  t(s)  fijo  backoff\n");
+    const size_t from = o.outageStartMs / 1000;
+    const size_t to = std::min(legacy.perSecond.size(), (size_t)((o.outageStartMs + o.outageMs) / 1000 + 120));
+    for (size_t s = from; s < to; s++) {
+      printf("%6zu %5u %8u\n", s, (unsigned)legacy.perSecond[s], (unsigned)backoff.perSecond[s]);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,326 @@
+// =============================================================
+// === Publicación por cambio (ReportFilter.hpp) ===
+// =============================================================
+// 1) Deadband: dentro de la banda (absoluta o relativa) no se publica,
+//    fuera sí pero no antes de minIntervalMs; la referencia es lo último
+//    publicado, así que una deriva lenta acaba saliendo; NaN <-> valor
+//    cuenta como cambio.
+// 2) Umbrales de nivel con histéresis: subir o bajar dentro de la banda no
+//    publica, rebasarla publica al momento (aunque no haya pasado
+//    minIntervalMs), y oscilar en el borde no da una ráfaga.
+// 3) Latido: con los valores quietos sale exactamente cada heartbeatMs,
+//    también cruzando el desborde de millis(); un envío pedido reinicia
+//    la cuenta.
+// 4) Un día de dia_con_cortes.csv con ruido de sensor, evaluado cada
+//    REPORT_CHECK_MS con la política del sketch, frente a publicar cada
+//    PUBLISH_INTERVAL_MS: cuántos mensajes se ahorran, sin silencios más
+//    largos que el latido y con el episodio de gas de las 19:00 publicado
+//    en el segundo en que cruza el umbral.
+//
+//   g++ -std=c++17 -O2 -I.. report_filter_check.cpp -o report_filter_check
+//   ./report_filter_check --trace traces/dia_con_cortes.csv   (termina con código 1 si algo falla)
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <random>
+#include <string>
+
+#include "include/ReportFilter.hpp"
+#include "sim/SensorTrace.hpp"
+
+#ifndef SIM_TRACES_DIR
+#define SIM_TRACES_DIR "sim/traces"
+#endif
+
+namespace {
+
+uint32_t failures = 0;
+
+#define EXPECT(cond, ...)                             \
+  do {                                                \
+    if (!(cond)) {                                    \
+      if (failures++ < 20) {                          \
+        printf("  FALLO %s:%d ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__);                          \
+        printf("\n");                                 \
+      }                                               \
+    }                                                 \
+  } while (0)
+
+// Los valores de async-weather-station.ino
+constexpr uint32_t REPORT_CHECK_MS = 1000;
+constexpr uint32_t PUBLISH_INTERVAL_MS = 30000;
+constexpr uint32_t HEARTBEAT_MS = 10UL * 60UL * 1000UL;
+
+ReportPolicyConfig sketchPolicy() {
+  ReportPolicyConfig policy;
+  policy.minIntervalMs = PUBLISH_INTERVAL_MS;
+  policy.heartbeatMs = HEARTBEAT_MS;
+  policy.windGustLevels[0] = 39.0f;
+  policy.windGustLevels[1] = 62.0f;
+  policy.windGustLevels[2] = 89.0f;
+  policy.windGustLevelCount = 3;
+  return policy;
+}
+
+SensorData quiet() {
+  SensorData d;
+  d.temperatureC = 18.0f;
+  d.humidityPercent = 60.0f;
+  d.pressureHpa = 1013.0f;
+  d.lightLux = 1000.0f;
+  d.windSpeedKmh = 5.0f;
+  d.windGustKmh = 8.0f;
+  d.gasRaw = 400;
+  d.gasQuality = AirQuality::GOOD;
+  return d;
+}
+
+// Vuelve a empezar con `d` como referencia (la primera lectura sale siempre)
+void restart(ReportFilter& filter, const SensorData& d, uint32_t nowMs) {
+  const ReportPolicyConfig policy = filter.config();
+  filter = ReportFilter();
+  filter.configure(policy);
+  filter.check(d, nowMs);
+}
+
+const char* name(ReportReason r) { return ReportFilter::reasonName(r); }
+
+// === 1) Deadband ===
+void checkDeadband() {
+  ReportFilter filter;
+  filter.configure(sketchPolicy());
+  SensorData d = quiet();
+  EXPECT(filter.check(d, 0) == ReportReason::FIRST, "la primera lectura sale siempre");
+
+  d.temperatureC = 25.0f;
+  EXPECT(filter.check(d, PUBLISH_INTERVAL_MS - 1) == ReportReason::SUPPRESSED, "cambio antes de minIntervalMs");
+  d.temperatureC = 18.9f;
+  EXPECT(filter.check(d, PUBLISH_INTERVAL_MS) == ReportReason::SUPPRESSED, "0,9 °C dentro de la banda de 1 °C");
+  d.temperatureC = 19.1f;
+  EXPECT(filter.check(d, PUBLISH_INTERVAL_MS) == ReportReason::DEADBAND, "1,1 °C fuera de la banda");
+
+  // Banda relativa de la luz: 10 % de 1000 lx (mayor que los 5 lx absolutos)
+  d = quiet();
+  restart(filter, d, 100000);
+  d.lightLux = 1095.0f;
+  EXPECT(filter.check(d, 200000) == ReportReason::SUPPRESSED, "luz +9,5 %%");
+  d.lightLux = 1105.0f;
+  EXPECT(filter.check(d, 200000) == ReportReason::DEADBAND, "luz +10,5 %%");
+  // De noche manda la absoluta: 0 -> 4 lx no, 0 -> 6 lx sí
+  d.lightLux = 0.0f;
+  restart(filter, d, 300000);
+  d.lightLux = 4.0f;
+  EXPECT(filter.check(d, 400000) == ReportReason::SUPPRESSED, "0 -> 4 lx");
+  d.lightLux = 6.0f;
+  EXPECT(filter.check(d, 400000) == ReportReason::DEADBAND, "0 -> 6 lx");
+
+  // Deriva de 0,25 hPa por paso con banda de 0,3: la referencia es lo
+  // publicado, no lo último visto, así que sale cada dos pasos
+  d = quiet();
+  restart(filter, d, 500000);
+  uint32_t sent = 0;
+  for (int step = 1; step <= 8; step++) {
+    d.pressureHpa = 1013.0f + 0.25f * step;
+    if (filter.check(d, 500000 + step * PUBLISH_INTERVAL_MS) == ReportReason::DEADBAND) sent++;
+  }
+  EXPECT(sent == 4, "deriva lenta de presión: %u envíos de 8 pasos", (unsigned)sent);
+
+  // Sensor que falla y se recupera
+  d = quiet();
+  restart(filter, d, 1000000);
+  d.humidityPercent = NAN;
+  EXPECT(filter.check(d, 1030000) == ReportReason::DEADBAND, "valor -> NaN");
+  EXPECT(filter.check(d, 1060000) == ReportReason::SUPPRESSED, "NaN -> NaN");
+  d.humidityPercent = 60.0f;
+  EXPECT(filter.check(d, 1090000) == ReportReason::DEADBAND, "NaN -> valor");
+}
+
+// === 2) Umbrales con histéresis ===
+void checkThresholds() {
+  ReportFilter filter;
+  filter.configure(sketchPolicy());  // racha: 39 / 62 / 89 km/h, histéresis 3
+  SensorData d = quiet();
+  d.windGustKmh = 30.0f;
+  filter.check(d, 0);
+
+  uint32_t now = 1;
+  const float rising[] = {38.0f, 40.0f, 41.9f, 42.0f};  // el nivel 1 empieza pasado 39 + 3
+  for (float gust : rising) {
+    d.windGustKmh = gust;
+    EXPECT(filter.check(d, now++) == ReportReason::SUPPRESSED, "racha %.1f dentro de la histéresis de subida",
+           gust);
+  }
+  d.windGustKmh = 42.1f;
+  const ReportReason up = filter.check(d, now++);
+  EXPECT(up == ReportReason::THRESHOLD, "racha 42,1 a 1 ms del anterior: %s", name(up));
+
+  // Oscilando en el borde, sin llegar a 39 - 3, no hay más envíos
+  uint32_t burst = 0;
+  for (int i = 0; i < 200; i++) {
+    d.windGustKmh = (i % 2) ? 43.0f : 36.5f;
+    if (filter.check(d, now++) != ReportReason::SUPPRESSED) burst++;
+  }
+  EXPECT(burst == 0, "oscilación en 36,5-43 km/h: %u envíos", (unsigned)burst);
+  d.windGustKmh = 35.9f;
+  EXPECT(filter.check(d, now++) == ReportReason::THRESHOLD, "bajada por debajo de 39 - 3");
+
+  // Un salto de varios niveles es un solo envío
+  d.windGustKmh = 95.0f;
+  EXPECT(filter.check(d, now++) == ReportReason::THRESHOLD, "salto al nivel 3");
+  d.windGustKmh = 90.0f;
+  EXPECT(filter.check(d, now++) == ReportReason::SUPPRESSED, "sigue en el nivel 3");
+  d.windGustKmh = 70.0f;
+  EXPECT(filter.check(d, now++) == ReportReason::THRESHOLD, "baja al nivel 2");
+
+  // Gas por umbrales propios sobre el valor crudo
+  ReportPolicyConfig policy = sketchPolicy();
+  policy.gasLevels[0] = 700.0f;
+  policy.gasLevelCount = 1;
+  policy.gasHysteresis = 30.0f;
+  filter.configure(policy);
+  d = quiet();
+  restart(filter, d, now++);
+  d.gasRaw = 725;
+  EXPECT(filter.check(d, now++) == ReportReason::SUPPRESSED, "gas 725 con umbral 700 + 30");
+  d.gasRaw = 731;
+  EXPECT(filter.check(d, now++) == ReportReason::THRESHOLD, "gas 731");
+  d.gasRaw = 671;
+  EXPECT(filter.check(d, now++) == ReportReason::SUPPRESSED, "gas 671: aún dentro de 700 - 30");
+  d.gasRaw = 669;
+  EXPECT(filter.check(d, now++) == ReportReason::THRESHOLD, "gas 669");
+
+  // Sin umbrales de gas, el nivel es la calidad del MQ-2
+  filter.configure(sketchPolicy());
+  d = quiet();
+  restart(filter, d, now++);
+  d.gasQuality = AirQuality::POOR;
+  EXPECT(filter.check(d, now++) == ReportReason::THRESHOLD, "cambio de calidad del aire");
+
+  // levelOf() directamente en los bordes
+  const float levels[] = {10.0f, 20.0f};
+  const uint8_t at = ReportFilter::levelOf(10.0f, levels, 2, 0, 0.0f);
+  const uint8_t above = ReportFilter::levelOf(10.01f, levels, 2, 0, 0.0f);
+  const uint8_t jump = ReportFilter::levelOf(25.0f, levels, 2, 0, 2.0f);
+  const uint8_t kept = ReportFilter::levelOf(8.5f, levels, 2, 1, 2.0f);
+  EXPECT(at == 0 && above == 1 && jump == 2 && kept == 1, "levelOf() en los bordes: %u %u %u %u", at, above, jump,
+         kept);
+}
+
+// === 3) Latido ===
+void checkHeartbeat(uint32_t startMs) {
+  ReportFilter filter;
+  filter.configure(sketchPolicy());
+  const SensorData d = quiet();
+  filter.check(d, startMs);
+  uint32_t beats = 0;
+  uint32_t wrongGap = 0;
+  uint32_t lastMs = startMs;
+  for (uint32_t s = 1; s <= 3600; s++) {
+    const uint32_t now = startMs + s * REPORT_CHECK_MS;
+    const ReportReason r = filter.check(d, now);
+    if (r == ReportReason::SUPPRESSED) continue;
+    if (r != ReportReason::HEARTBEAT || now - lastMs != HEARTBEAT_MS) wrongGap++;
+    beats++;
+    lastMs = now;
+  }
+  EXPECT(beats == 6 && wrongGap == 0, "una hora quieta desde %u: %u latidos, %u fuera de plazo",
+         (unsigned)startMs, (unsigned)beats, (unsigned)wrongGap);
+
+  // Un envío pedido cuenta como publicación: el latido se aplaza
+  ReportFilter requested;
+  requested.configure(sketchPolicy());
+  requested.check(d, startMs);
+  EXPECT(requested.check(d, startMs + 400000, true) == ReportReason::REQUESTED, "envío pedido");
+  EXPECT(requested.check(d, startMs + HEARTBEAT_MS) == ReportReason::SUPPRESSED &&
+             requested.check(d, startMs + 400000 + HEARTBEAT_MS) == ReportReason::HEARTBEAT,
+         "el latido cuenta desde el envío pedido");
+  EXPECT(requested.sent() + requested.suppressed() == requested.total() && requested.count(ReportReason::FIRST) == 1,
+         "contadores por motivo");
+}
+
+// === 4) Un día de la traza ===
+void checkDay(const SensorTrace& trace) {
+  ReportPolicyConfig policy = sketchPolicy();
+  // El MQ-2 no se simula: su calidad se sustituye por un umbral sobre el crudo
+  policy.gasLevels[0] = 800.0f;
+  policy.gasLevelCount = 1;
+  ReportFilter filter;
+  filter.configure(policy);
+
+  std::mt19937 rng(1);
+  std::normal_distribution<float> unit(0.0f, 1.0f);
+  uint32_t lastSentMs = 0;
+  uint32_t longestSilenceMs = 0;
+  uint32_t gasAboveMs = 0;
+  uint32_t gasSentMs = 0;
+  float instant[30];
+  for (float& v : instant) v = trace.value(SensorTrace::WIND, 0.0);
+  for (uint32_t ms = 0; ms < 86400000u; ms += REPORT_CHECK_MS) {
+    const double t = ms / 1000.0;
+    SensorData d;
+    d.temperatureC = roundf(trace.value(SensorTrace::TEMPERATURE, t) + 0.3f * unit(rng));  // DHT11: °C enteros
+    d.humidityPercent = roundf(trace.value(SensorTrace::HUMIDITY, t) + 0.4f * unit(rng));  // repetibilidad ±1 %
+    d.pressureHpa = trace.value(SensorTrace::PRESSURE, t) + 0.05f * unit(rng);
+    d.lightLux = fmaxf(0.0f, trace.value(SensorTrace::LIGHT, t) * (1.0f + 0.03f * unit(rng)));
+    // Viento como lo da el anemómetro: media de 30 s y racha como máximo de
+    // 3 s, sobre una velocidad instantánea con un 25 % de turbulencia
+    const float wind = trace.value(SensorTrace::WIND, t);
+    instant[ms / REPORT_CHECK_MS % 30] = fmaxf(0.0f, wind * (1.0f + 0.25f * unit(rng)));
+    float sum = 0.0f;
+    float gust = 0.0f;
+    for (uint32_t i = 0; i < 30; i++) {
+      sum += instant[i];
+      if ((ms / REPORT_CHECK_MS + 30 - i) % 30 < 3) gust = fmaxf(gust, instant[i]);
+    }
+    d.windSpeedKmh = sum / 30.0f;
+    d.windGustKmh = gust;
+    d.gasRaw = (int)lroundf(trace.value(SensorTrace::GAS, t) + 8.0f * unit(rng));
+    if (gasAboveMs == 0 && d.gasRaw > 800 + 30) gasAboveMs = ms;
+
+    const ReportReason r = filter.check(d, ms);
+    if (r == ReportReason::SUPPRESSED) continue;
+    if (ms - lastSentMs > longestSilenceMs) longestSilenceMs = ms - lastSentMs;
+    if (r == ReportReason::THRESHOLD && gasSentMs == 0 && d.gasRaw > 800) gasSentMs = ms;
+    lastSentMs = ms;
+  }
+  const uint32_t fixed = 86400000u / PUBLISH_INTERVAL_MS;
+  const uint32_t sent = filter.sent();
+  printf("un día evaluando cada %u ms: %u envíos (primero %u, cambio %u, umbral %u, latido %u) "
+         "frente a %u cada %u s, %.1f %% de los mensajes\n",
+         (unsigned)REPORT_CHECK_MS, (unsigned)sent, (unsigned)filter.count(ReportReason::FIRST),
+         (unsigned)filter.count(ReportReason::DEADBAND), (unsigned)filter.count(ReportReason::THRESHOLD),
+         (unsigned)filter.count(ReportReason::HEARTBEAT), (unsigned)fixed, (unsigned)(PUBLISH_INTERVAL_MS / 1000),
+         100.0 * sent / fixed);
+  EXPECT(sent * 2 < fixed, "el filtro debería ahorrar más de la mitad: %u de %u", (unsigned)sent, (unsigned)fixed);
+  EXPECT(longestSilenceMs <= HEARTBEAT_MS, "silencio máximo %u ms", (unsigned)longestSilenceMs);
+  EXPECT(filter.count(ReportReason::HEARTBEAT) > 0, "de madrugada debería salir algún latido");
+  EXPECT(gasAboveMs > 0 && gasSentMs == gasAboveMs, "gas por encima de 830 a los %u ms, publicado a los %u ms",
+         (unsigned)gasAboveMs, (unsigned)gasSentMs);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string tracePath = SIM_TRACES_DIR "/dia_con_cortes.csv";
+  for (int i = 1; i + 1 < argc; i++) {
+    if (strcmp(argv[i], "--trace") == 0) tracePath = argv[++i];
+  }
+  SensorTrace trace;
+  std::string error;
+  if (!trace.load(tracePath.c_str(), error)) {
+    fprintf(stderr, "traza %s: %s\n", tracePath.c_str(), error.c_str());
+    return 2;
+  }
+  trace.setRepeat(true);
+
+  checkDeadband();
+  checkThresholds();
+  checkHeartbeat(0);
+  checkHeartbeat(0xFFFFFFFFu - 1000000u);  // millis() se desborda a los ~17 min
+  checkDay(trace);
+  printf("%s (%u fallos)\n", failures ? "FALLOS" : "OK", failures);
+  return failures ? 1 : 0;
+}
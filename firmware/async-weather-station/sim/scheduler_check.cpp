@@ -0,0 +1,255 @@
+// =============================================================
+// === Planificador por plazos (TaskScheduler.hpp) ===
+// =============================================================
+// Con un reloj virtual inyectado (ms y µs avanzan solo cuando lo dice la
+// prueba, y un paso puede "tardar" lo que se le indique):
+// 1) Periodos y fases: cada tarea corre en su plazo exacto y las veces
+//    que tocan, también cruzando el desborde de millis().
+// 2) start()/collect(): la recogida llega a los latencyMs, y una máquina de
+//    estados que pide más pasos los recibe a los ms que devuelve.
+// 3) Un paso que bloquea 1,5 s: se registra el retraso, la tarea rápida no
+//    recupera en ráfaga los plazos perdidos y el bloqueo queda en
+//    maxStepUs/maxStepTask y en la separación entre vueltas.
+// 4) Durmiendo exactamente msUntilNextDue() no se pierde ni se adelanta
+//    ningún plazo.
+// 5) runNow() y setPeriod().
+//
+//   g++ -std=c++17 -O2 -I.. scheduler_check.cpp -o scheduler_check
+//   ./scheduler_check   (termina con código 1 si algo falla)
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "include/TaskScheduler.hpp"
+
+namespace {
+
+uint32_t failures = 0;
+
+#define EXPECT(cond, ...)                             \
+  do {                                                \
+    if (!(cond)) {                                    \
+      if (failures++ < 20) {                          \
+        printf("  FALLO %s:%d ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__);                          \
+        printf("\n");                                 \
+      }                                               \
+    }                                                 \
+  } while (0)
+
+// === Reloj virtual ===
+uint64_t virtualUs = 0;
+uint32_t msOffset = 0;  // desplaza millis() para probar su desborde
+
+uint32_t clockMs() { return (uint32_t)(virtualUs / 1000) + msOffset; }
+uint32_t clockUs() { return (uint32_t)virtualUs; }
+void advanceMs(uint32_t ms) { virtualUs += (uint64_t)ms * 1000; }
+
+void resetClock(uint32_t startMs) {
+  virtualUs = 0;
+  msOffset = startMs;
+}
+
+// Ejecuciones de cada tarea: instante (ms virtuales) y tipo de paso
+struct Event {
+  int task;
+  bool collect;
+  uint32_t atMs;
+};
+std::vector<Event> events;
+
+// Coste de cada paso en µs virtuales y pasos extra que pide collect()
+uint32_t stepCostUs[4] = {};
+uint32_t collectAgainMs[4] = {};
+uint32_t collectStepsLeft[4] = {};
+bool startPending[4] = {};
+
+template <int Id>
+bool startTask() {
+  events.push_back({Id, false, clockMs()});
+  virtualUs += stepCostUs[Id];
+  return startPending[Id];
+}
+
+template <int Id>
+uint32_t collectTask() {
+  events.push_back({Id, true, clockMs()});
+  virtualUs += stepCostUs[Id];
+  if (collectStepsLeft[Id] == 0) return 0;
+  collectStepsLeft[Id]--;
+  return collectAgainMs[Id];
+}
+
+void resetTasks() {
+  events.clear();
+  for (int i = 0; i < 4; i++) {
+    stepCostUs[i] = 0;
+    collectAgainMs[i] = 0;
+    collectStepsLeft[i] = 0;
+    startPending[i] = false;
+  }
+}
+
+std::vector<uint32_t> runsOf(int task, bool collect, uint32_t startMs) {
+  std::vector<uint32_t> at;
+  for (const Event& e : events) {
+    if (e.task == task && e.collect == collect) at.push_back(e.atMs - startMs);
+  }
+  return at;
+}
+
+// Una vuelta de loop() cada ms durante `ms`
+template <typename Scheduler>
+void runFor(Scheduler& scheduler, uint32_t ms) {
+  for (uint32_t i = 0; i < ms; i++) {
+    scheduler.runDue();
+    advanceMs(1);
+  }
+}
+
+bool periodic(const std::vector<uint32_t>& at, uint32_t phase, uint32_t period, size_t count) {
+  if (at.size() != count) return false;
+  for (size_t i = 0; i < at.size(); i++) {
+    if (at[i] != phase + period * (uint32_t)i) return false;
+  }
+  return true;
+}
+
+// === 1) Periodos y fases ===
+void checkPeriods(uint32_t startMs) {
+  resetClock(startMs);
+  resetTasks();
+  TaskScheduler<4> scheduler(clockMs, clockUs);
+  scheduler.add("rápida", 250, 0, startTask<0>);
+  scheduler.add("media", 1000, 0, startTask<1>, nullptr, 100);
+  scheduler.add("lenta", 10000, 0, startTask<2>, nullptr, 200);
+  runFor(scheduler, 60000);
+
+  EXPECT(periodic(runsOf(0, false, startMs), 0, 250, 240), "tarea de 250 ms: %zu ejecuciones (inicio %u)",
+         runsOf(0, false, startMs).size(), (unsigned)startMs);
+  EXPECT(periodic(runsOf(1, false, startMs), 100, 1000, 60), "tarea de 1 s con fase 100");
+  EXPECT(periodic(runsOf(2, false, startMs), 200, 10000, 6), "tarea de 10 s con fase 200");
+  EXPECT(scheduler.metrics().maxLatenessMs == 0, "retraso %u ms sin bloqueos",
+         (unsigned)scheduler.metrics().maxLatenessMs);
+}
+
+// === 2) Conversión y recogida ===
+void checkCollect() {
+  resetClock(0);
+  resetTasks();
+  TaskScheduler<4> scheduler(clockMs, clockUs);
+  startPending[0] = true;  // un DHT: start, collect a los 18 ms
+  startPending[1] = true;  // un BMP: start, collect a los 5 ms y otra conversión de 26 ms
+  collectStepsLeft[1] = 1;
+  collectAgainMs[1] = 26;
+  startPending[2] = false;  // sin conversión pendiente: no hay collect
+  scheduler.add("dht", 2000, 18, startTask<0>, collectTask<0>, 150);
+  scheduler.add("bmp", 10000, 5, startTask<1>, collectTask<1>, 200);
+  scheduler.add("luz", 1000, 0, startTask<2>, collectTask<2>);
+  runFor(scheduler, 20000);
+
+  EXPECT(periodic(runsOf(0, true, 0), 168, 2000, 10), "recogida del DHT a los 18 ms de cada start");
+  const std::vector<uint32_t> bmp = runsOf(1, true, 0);
+  EXPECT(bmp.size() == 3 && bmp[0] == 205 && bmp[1] == 231 && bmp[2] == 10205,
+         "recogidas del BMP: %zu (%u, %u)", bmp.size(), bmp.empty() ? 0u : (unsigned)bmp[0],
+         bmp.size() > 1 ? (unsigned)bmp[1] : 0u);
+  EXPECT(runsOf(2, true, 0).empty(), "collect sin conversión pendiente");
+}
+
+// === 3) Un paso que bloquea ===
+void checkOverrun() {
+  resetClock(0);
+  resetTasks();
+  TaskScheduler<4> scheduler(clockMs, clockUs);
+  scheduler.add("rápida", 100, 0, startTask<0>);
+  scheduler.add("bloquea", 5000, 0, startTask<1>, nullptr, 2000);
+  stepCostUs[0] = 40;
+  runFor(scheduler, 1999);
+  stepCostUs[1] = 1500000;  // p. ej. una lectura I2C que se queda colgada
+  runFor(scheduler, 3000);
+
+  const std::vector<uint32_t> fast = runsOf(0, false, 0);
+  // Tras el bloqueo la rápida corre una vez al reanudar y sigue cada 100 ms
+  size_t afterStall = 0;
+  for (uint32_t t : fast) {
+    if (t >= 2000 && t < 3600) afterStall++;
+  }
+  EXPECT(afterStall == 2, "la tarea rápida recupera %zu plazos en ráfaga", afterStall);
+
+  const SchedulerMetrics& m = scheduler.metrics();
+  EXPECT(m.maxStepUs == 1500000 && std::string(m.maxStepTask) == "bloquea", "bloqueo máximo %u us en '%s'",
+         (unsigned)m.maxStepUs, m.maxStepTask);
+  EXPECT(m.maxLatenessMs >= 1400 && m.maxLatenessMs <= 1500, "retraso máximo %u ms", (unsigned)m.maxLatenessMs);
+  EXPECT(m.maxLoopGapUs >= 1500000, "separación máxima entre vueltas %u us", (unsigned)m.maxLoopGapUs);
+  EXPECT(scheduler.maxStepUs(0) == 40 && scheduler.runs(1) == 1, "por tarea: %u us, %u ejecuciones",
+         (unsigned)scheduler.maxStepUs(0), (unsigned)scheduler.runs(1));
+
+  stepCostUs[1] = 0;
+  scheduler.resetMetrics();
+  runFor(scheduler, 1000);
+  EXPECT(scheduler.metrics().maxLatenessMs == 0 && scheduler.metrics().maxStepUs == 40 &&
+             scheduler.metrics().maxLoopGapUs <= 1040,
+         "tras resetMetrics() la ventana empieza limpia (%u us)", (unsigned)scheduler.metrics().maxLoopGapUs);
+}
+
+// === 4) Dormir hasta el siguiente plazo ===
+void checkSleep() {
+  resetClock(0xFFFFFFFFu - 30000u);
+  resetTasks();
+  TaskScheduler<4> scheduler(clockMs, clockUs);
+  startPending[1] = true;
+  scheduler.add("a", 250, 0, startTask<0>);
+  scheduler.add("b", 2000, 18, startTask<1>, collectTask<1>, 150);
+  scheduler.add("c", 1000, 0, startTask<2>, nullptr, 100);
+  uint32_t wakeups = 0;
+  uint32_t idle = 0;
+  while (virtualUs < 60000000ull) {
+    const size_t before = events.size();
+    scheduler.runDue();
+    if (events.size() == before) idle++;
+    wakeups++;
+    const uint32_t sleep = scheduler.msUntilNextDue();
+    EXPECT(sleep > 0 && sleep <= 250, "msUntilNextDue %u tras ejecutar lo vencido", (unsigned)sleep);
+    advanceMs(sleep);
+  }
+  const uint32_t start = 0xFFFFFFFFu - 30000u;
+  EXPECT(periodic(runsOf(0, false, start), 0, 250, 240) && periodic(runsOf(1, true, start), 168, 2000, 30) &&
+             periodic(runsOf(2, false, start), 100, 1000, 60),
+         "durmiendo hasta el plazo se pierde o se adelanta alguno");
+  EXPECT(idle == 0, "%u despertares sin nada que hacer", (unsigned)idle);
+  printf("durmiendo con msUntilNextDue(): %u despertares en 60 s, todos con trabajo\n", (unsigned)wakeups);
+}
+
+// === 5) runNow() y setPeriod() ===
+void checkControl() {
+  resetClock(0);
+  resetTasks();
+  TaskScheduler<2> scheduler(clockMs, clockUs);
+  const int id = scheduler.add("publicar", 1000, 0, startTask<0>, nullptr, 500);
+  EXPECT(scheduler.add("b", 1, 0, startTask<1>) == 1 && scheduler.add("c", 1, 0, startTask<2>) == -1,
+         "capacidad de 2 tareas");
+  scheduler.setPeriod(1, 1000000);
+  runFor(scheduler, 300);
+  scheduler.runNow(id);  // p. ej. el comando "sample"
+  runFor(scheduler, 2000);
+  scheduler.setPeriod(id, 400);
+  runFor(scheduler, 1000);
+  const std::vector<uint32_t> at = runsOf(0, false, 0);
+  const std::vector<uint32_t> expected = {300, 1300, 2300, 2700, 3100};
+  EXPECT(at == expected, "ejecuciones con runNow()/setPeriod(): %zu", at.size());
+}
+
+}  // namespace
+
+int main() {
+  checkPeriods(0);
+  checkPeriods(0xFFFFFFFFu - 20000u);  // millis() se desborda a los 20 s
+  checkCollect();
+  checkOverrun();
+  checkSleep();
+  checkControl();
+  printf("%s (%u fallos)\n", failures ? "FALLOS" : "OK", failures);
+  return failures ? 1 : 0;
+}
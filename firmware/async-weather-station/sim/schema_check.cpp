@@ -0,0 +1,456 @@
+// =============================================================
+// === Comprobación de los esquemas de payload (PayloadSchema.hpp) ===
+// =============================================================
+// 1) Cada ejemplo de json/ con sus marcadores (timestamp, altitud, ...)
+//    sustituidos por valores conocidos y sin espacios debe coincidir byte a
+//    byte con lo que generan SchemaPayload<> y el modo dividido.
+// 2) writeSensorPayload() (cabecera en compilación), la versión con
+//    StationInfo y SchemaPayload<SCHEMA_GENERAL> dan lo mismo con lecturas
+//    aleatorias, NaN incluidos; el modo dividido da lo mismo que cada
+//    SchemaPayload<> por separado, con el bloque stats.
+//    El json-general de writeSensorPayload() (identidad de config.h, el que
+//    publica el firmware) también se compara directamente.
+// 3) Ningún payload pasa de su cota de compilación, ni con la identidad más
+//    larga posible llena de caracteres que hay que escapar.
+// 4) Escapes: todos los caracteres ASCII (controles incluidos) y UTF-8 en la
+//    identidad dan JSON válido para el analizador de comandos y vuelven
+//    intactos por él y por el decodificador de lotes.
+// 5) Coste del modo dividido frente a serializar cada métrica entera.
+//
+//   ./build/schema_check [--json DIR]   (termina con código 1 si hay diferencias)
+#define PAYLOAD_STATS 1  // se comprueba con el bloque stats aunque config.h lo apague
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+
+#include "include/BatchPayload.hpp"
+#include "include/JsonPointer.hpp"
+#include "include/PayloadSchema.hpp"
+
+#ifndef JSON_SAMPLES_DIR
+#define JSON_SAMPLES_DIR "../../json"
+#endif
+
+namespace {
+
+typedef size_t (*SchemaWriteFn)(const StationInfo&, const SensorData&, const char*, char*, size_t);
+
+template <const PayloadSchema& Schema>
+SchemaWriteFn schemaWriter() {
+  return static_cast<SchemaWriteFn>(&SchemaPayload<Schema>::write);
+}
+
+struct Sample {
+  const char* file;
+  const PayloadSchema* schema;
+  SchemaWriteFn write;
+  size_t maxLen;
+};
+
+#define SAMPLE(file, schema) {file, &schema, schemaWriter<schema>(), SchemaPayload<schema>::MAX_LEN}
+
+const Sample SAMPLES[] = {
+    SAMPLE("json-general", SCHEMA_GENERAL),   SAMPLE("json-temperatura", SCHEMA_TEMPERATURA),
+    SAMPLE("json-humedad", SCHEMA_HUMEDAD),   SAMPLE("json-viento", SCHEMA_VIENTO),
+    SAMPLE("json-lx", SCHEMA_LUZ),            SAMPLE("json-altitud", SCHEMA_PRESION),
+    SAMPLE("json-aire", SCHEMA_AIRE),
+};
+
+// Los de SPLIT_SCHEMAS, en el mismo orden
+const SchemaWriteFn SPLIT_WRITERS[SPLIT_SCHEMA_COUNT] = {
+    schemaWriter<SCHEMA_TEMPERATURA>(), schemaWriter<SCHEMA_HUMEDAD>(), schemaWriter<SCHEMA_VIENTO>(),
+    schemaWriter<SCHEMA_LUZ>(),         schemaWriter<SCHEMA_PRESION>(), schemaWriter<SCHEMA_AIRE>(),
+};
+
+const char* const TIMESTAMP = "2025-06-01T12:00:00+02:00";
+
+// Lectura de referencia y el texto que le corresponde a cada marcador
+SensorData referenceReading() {
+  SensorData data;
+  data.altitudeMeters = 650.2f;
+  data.temperatureC = 21.5f;
+  data.humidityPercent = 40.0f;
+  data.windSpeedKmh = 3.25f;
+  data.lightLux = 812.5f;
+  data.pressureHpa = 1013.25f;
+  data.gasRaw = 1450;
+  return data;
+}
+
+struct Placeholder {
+  const char* name;
+  const char* text;
+};
+
+const Placeholder PLACEHOLDERS[] = {
+    {"timestamp", "\"2025-06-01T12:00:00+02:00\""},
+    {"altitud", "650.2"},
+    {"temperatura", "21.5"},
+    {"humedad", "40"},
+    {"viento", "3.25"},
+    {"lx", "812.5"},
+    {"presion", "1013.25"},
+    {"calidad_aire", "1450"},
+};
+
+bool readFile(const std::string& path, std::string& out) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  char chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) out.append(chunk, n);
+  fclose(f);
+  return true;
+}
+
+// Quita los espacios fuera de las cadenas y sustituye los marcadores, sueltos
+// o entre corchetes. false si aparece un marcador desconocido.
+bool normalizeSample(const std::string& in, std::string& out, std::string& error) {
+  out.clear();
+  size_t i = 0;
+  while (i < in.size()) {
+    const char c = in[i];
+    if (c == '"') {
+      const size_t end = in.find('"', i + 1);
+      if (end == std::string::npos) {
+        error = "cadena sin cerrar";
+        return false;
+      }
+      out.append(in, i, end + 1 - i);
+      i = end + 1;
+    } else if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+      i++;
+    } else if (c == '[' || isalpha((unsigned char)c) || c == '_') {
+      const bool bracketed = c == '[';
+      size_t start = bracketed ? i + 1 : i;
+      size_t end = start;
+      while (end < in.size() && (isalnum((unsigned char)in[end]) || in[end] == '_')) end++;
+      if (end == start || (bracketed && (end >= in.size() || in[end] != ']'))) {
+        error = "marcador mal formado en la posición " + std::to_string(i);
+        return false;
+      }
+      const std::string name = in.substr(start, end - start);
+      const Placeholder* found = nullptr;
+      for (const Placeholder& p : PLACEHOLDERS) {
+        if (name == p.name) found = &p;
+      }
+      if (!found) {
+        error = "marcador desconocido: " + name;
+        return false;
+      }
+      out += found->text;
+      i = bracketed ? end + 1 : end;
+    } else {
+      out += c;
+      i++;
+    }
+  }
+  return true;
+}
+
+// Valor de "sensor_id" del ejemplo ya normalizado
+std::string sampleSensorId(const std::string& json) {
+  const std::string key = "\"sensor_id\":\"";
+  const size_t at = json.find(key);
+  if (at == std::string::npos) return "";
+  const size_t start = at + key.size();
+  return json.substr(start, json.find('"', start) - start);
+}
+
+void reportDiff(const char* label, const std::string& want, const char* got) {
+  size_t at = 0;
+  while (at < want.size() && got[at] == want[at]) at++;
+  printf("  %s: difiere en el byte %zu\n    esperado %s\n    generado %s\n", label, at, want.c_str(), got);
+}
+
+int checkSamples(const std::string& dir) {
+  int failures = 0;
+  char out[SPLIT_PAYLOAD_BUFFER_LEN + SchemaPayload<SCHEMA_GENERAL>::BUFFER_LEN];
+  char split[SPLIT_PAYLOAD_BUFFER_LEN];
+  const SensorData data = referenceReading();
+
+  printf("Ejemplos de %s\n", dir.c_str());
+  for (const Sample& sample : SAMPLES) {
+    std::string text;
+    std::string want;
+    std::string error;
+    if (!readFile(dir + "/" + sample.file, text)) {
+      printf("  %-17s no se puede leer\n", sample.file);
+      failures++;
+      continue;
+    }
+    if (!normalizeSample(text, want, error)) {
+      printf("  %-17s %s\n", sample.file, error.c_str());
+      failures++;
+      continue;
+    }
+
+    StationInfo station;
+    snprintf(station.sensorId, sizeof(station.sensorId), "%s", sampleSensorId(want).c_str());
+    const size_t n = sample.write(station, data, TIMESTAMP, out, sizeof(out));
+    bool ok = n == want.size() && memcmp(out, want.data(), n) == 0;
+    if (!ok) reportDiff(sample.file, want, out);
+
+    // El payload del firmware, con la cabecera fijada en compilación
+    if (sample.schema == &SCHEMA_GENERAL) {
+      char direct[SENSOR_PAYLOAD_BUFFER_LEN];
+      const size_t d = writeSensorPayload(data, TIMESTAMP, direct, sizeof(direct));
+      if (d != want.size() || memcmp(direct, want.data(), d) != 0) {
+        reportDiff("writeSensorPayload", want, direct);
+        ok = false;
+      }
+    }
+
+    // El mismo mensaje saliendo del modo dividido
+    if (sample.schema != &SCHEMA_GENERAL) {
+      SplitPayloadWriter writer(split, sizeof(split));
+      const size_t m = writer.begin(station, data, TIMESTAMP) ? writer.write(*sample.schema, data) : 0;
+      split[m] = '\0';
+      if (m != want.size() || memcmp(split, want.data(), m) != 0) {
+        reportDiff("modo dividido", want, split);
+        ok = false;
+      }
+    }
+    printf("  %-17s %-3s %3zu B (cota %zu)\n", sample.file, ok ? "ok" : "MAL", n, sample.maxLen);
+    if (!ok) failures++;
+  }
+  return failures;
+}
+
+std::mt19937_64 rng(20250601);
+
+float randomValue(float lo, float hi, uint8_t decimals) {
+  if (std::uniform_int_distribution<int>(0, 19)(rng) == 0) return NAN;
+  const float scale = powf(10.0f, decimals);
+  return roundf(std::uniform_real_distribution<float>(lo, hi)(rng) * scale) / scale;
+}
+
+void randomSummary(ChannelSummary& c, float lo, float hi) {
+  c.count = std::uniform_int_distribution<uint32_t>(0, 3)(rng) == 0 ? 0 : 30;
+  c.min = randomValue(lo, hi, 3);
+  c.max = randomValue(lo, hi, 3);
+  c.mean = randomValue(lo, hi, 3);
+  c.stddev = randomValue(0, 10, 3);
+  c.ewma = randomValue(lo, hi, 3);
+}
+
+SensorData randomReading() {
+  SensorData data;
+  data.altitudeMeters = randomValue(-50, 3000, 2);
+  data.temperatureC = randomValue(-30, 50, 3);
+  data.humidityPercent = randomValue(0, 100, 2);
+  data.windSpeedKmh = randomValue(0, 150, 3);
+  data.lightLux = randomValue(0, 120000, 2);
+  data.pressureHpa = randomValue(850, 1100, 3);
+  data.gasRaw = std::uniform_int_distribution<int>(0, 4095)(rng);
+  if (std::uniform_int_distribution<int>(0, 1)(rng)) {
+    data.stats.windowMs = 300000;
+    randomSummary(data.stats.temperatureC, -30, 50);
+    randomSummary(data.stats.humidityPercent, 0, 100);
+    randomSummary(data.stats.windSpeedKmh, 0, 150);
+    randomSummary(data.stats.lightLux, 0, 120000);
+    randomSummary(data.stats.pressureHpa, 850, 1100);
+    randomSummary(data.stats.gasRaw, 0, 4095);
+  }
+  return data;
+}
+
+int checkEquivalence(int rounds) {
+  int failures = 0;
+  char a[SENSOR_PAYLOAD_BUFFER_LEN];
+  char b[SchemaPayload<SCHEMA_GENERAL>::BUFFER_LEN];
+  char c[SENSOR_PAYLOAD_BUFFER_LEN];
+  char split[SPLIT_PAYLOAD_BUFFER_LEN];
+  char single[SPLIT_PAYLOAD_BUFFER_LEN];
+  const StationInfo station;
+
+  for (int r = 0; r < rounds && failures < 5; r++) {
+    SensorData data = randomReading();
+    const size_t na = writeSensorPayload(data, TIMESTAMP, a, sizeof(a));
+    const size_t nb = SchemaPayload<SCHEMA_GENERAL>::write(station, data, TIMESTAMP, b);
+    if (na == 0 || na != nb || memcmp(a, b, na) != 0) {
+      reportDiff("writeSensorPayload / SCHEMA_GENERAL", std::string(a, na), b);
+      failures++;
+    }
+    // La versión con StationInfo no lleva stats
+    data.stats.windowMs = 0;
+    const size_t nc = writeSensorPayload(station, data, TIMESTAMP, c, sizeof(c));
+    const size_t nd = SchemaPayload<SCHEMA_GENERAL>::write(station, data, TIMESTAMP, b);
+    if (nc == 0 || nc != nd || memcmp(c, b, nc) != 0) {
+      reportDiff("StationInfo / SCHEMA_GENERAL", std::string(c, nc), b);
+      failures++;
+    }
+
+    data = randomReading();
+    SplitPayloadWriter writer(split, sizeof(split));
+    writer.begin(station, data, TIMESTAMP);
+    for (size_t i = 0; i < SPLIT_SCHEMA_COUNT; i++) {
+      const size_t ns = writer.write(*SPLIT_SCHEMAS[i], data);
+      const size_t n1 = SPLIT_WRITERS[i](station, data, TIMESTAMP, single, sizeof(single));
+      if (ns == 0 || ns != n1 || memcmp(split, single, ns) != 0) {
+        split[ns] = '\0';
+        reportDiff(SPLIT_SCHEMAS[i]->subtopic, std::string(single, n1), split);
+        failures++;
+      }
+    }
+  }
+  printf("Equivalencias con %d lecturas aleatorias: %s\n", rounds, failures ? "MAL" : "ok");
+  return failures;
+}
+
+// Identidad y valores que más ocupan: todo escapado y números al límite
+int checkBounds() {
+  StationInfo station;
+  char* targets[] = {station.sensorId, station.sensorType, station.streetId, station.district, station.neighborhood};
+  const size_t sizes[] = {sizeof(station.sensorId), sizeof(station.sensorType), sizeof(station.streetId),
+                          sizeof(station.district), sizeof(station.neighborhood)};
+  for (size_t i = 0; i < 5; i++) {
+    memset(targets[i], '\x01', sizes[i] - 1);  // \u0001: el escape más largo
+    targets[i][sizes[i] - 1] = '\0';
+  }
+  memset(station.latitude, '9', sizeof(station.latitude) - 1);
+  station.latitude[sizeof(station.latitude) - 1] = '\0';
+  memcpy(station.longitude, station.latitude, sizeof(station.longitude));
+
+  char timestamp[TIMESTAMP_MAX_LEN];
+  memset(timestamp, '\x1f', sizeof(timestamp) - 1);
+  timestamp[sizeof(timestamp) - 1] = '\0';
+
+  SensorData data;
+  data.altitudeMeters = data.temperatureC = data.humidityPercent = data.windSpeedKmh = data.lightLux =
+      data.pressureHpa = -999999936.0f;  // el float más grande que number() no convierte en null
+  data.gasRaw = -999999;
+  data.stats.windowMs = 4000000000u;
+  ChannelSummary worst;
+  worst.count = 4000000000u;
+  worst.min = worst.max = worst.mean = worst.stddev = worst.ewma = -999999936.0f;
+  data.stats.temperatureC = data.stats.humidityPercent = data.stats.windSpeedKmh = data.stats.lightLux =
+      data.stats.pressureHpa = data.stats.gasRaw = worst;
+
+  int failures = 0;
+  static char big[4096];
+  size_t worstSplit = 0;
+  for (const Sample& sample : SAMPLES) {
+    const size_t n = sample.write(station, data, timestamp, big, sizeof(big));
+    if (n == 0 || n > sample.maxLen) {
+      printf("  %-17s %zu B > cota %zu\n", sample.file, n, sample.maxLen);
+      failures++;
+    }
+  }
+  SplitPayloadWriter writer(big, sizeof(big));
+  writer.begin(station, data, timestamp);
+  for (size_t i = 0; i < SPLIT_SCHEMA_COUNT; i++) {
+    const size_t n = writer.write(*SPLIT_SCHEMAS[i], data);
+    if (n > worstSplit) worstSplit = n;
+  }
+  if (worstSplit == 0 || worstSplit > SPLIT_PAYLOAD_MAX_LEN) failures++;
+  printf("Cotas en el peor caso: %s (modo dividido %zu B de %zu)\n", failures ? "MAL" : "ok", worstSplit,
+         SPLIT_PAYLOAD_MAX_LEN);
+  return failures;
+}
+
+// `text` escrito como cadena JSON en district; vuelve por JsonTokenizer y
+// por JsonCursor
+bool roundTrip(const char* text) {
+  StationInfo station;
+  snprintf(station.district, sizeof(station.district), "%s", text);
+  char out[SENSOR_PAYLOAD_BUFFER_LEN + PAYLOAD_HEADER_MAX_LEN];
+  const size_t n = writeSensorPayload(station, referenceReading(), TIMESTAMP, out, sizeof(out));
+  if (n == 0) return false;
+  for (size_t i = 0; i < n; i++) {
+    if ((unsigned char)out[i] < 0x20) return false;  // ningún control sin escapar
+  }
+
+  char cursorOut[sizeof(station.district)];
+  const char* quoted = strstr(out, "\"district\":") + sizeof("\"district\":") - 1;
+  JsonCursor cursor(quoted, n - (size_t)(quoted - out));
+  if (!cursor.string(cursorOut, sizeof(cursorOut)) || strcmp(cursorOut, station.district) != 0) return false;
+
+  JsonToken tokens[64];
+  JsonTokenizer parser(tokens, 64);
+  if (!parser.parse(out, n)) return false;
+  const char* parsed = parser.string(parser.find("/location/district"));
+  return parsed && strcmp(parsed, station.district) == 0;
+}
+
+int checkEscapes() {
+  int failures = 0;
+  char text[48];
+  // Todo el ASCII en trozos que caben en district
+  for (int first = 1; first < 0x80; first += 40) {
+    size_t n = 0;
+    for (int c = first; c < 0x80 && n < 40; c++) text[n++] = (char)c;
+    text[n] = '\0';
+    if (!roundTrip(text)) {
+      printf("  escapes de 0x%02x a 0x%02x: MAL\n", first, first + (int)n - 1);
+      failures++;
+    }
+  }
+  const char* const samples[] = {"", "Centro", "Barrio \"Las Letras\"", "l\u00ednea 1\nl\u00ednea 2\ttab\r",
+                                 "C:\\ruta\\", "\b\f\x7f", "Ch\u00e1mber\u00ed \u2014 \u20ac"};
+  for (const char* sample : samples) {
+    if (!roundTrip(sample)) {
+      printf("  escapes de \"%s\": MAL\n", sample);
+      failures++;
+    }
+  }
+  printf("Escapes de cadenas: %s\n", failures ? "MAL" : "ok");
+  return failures;
+}
+
+void bench(int rounds) {
+  char split[SPLIT_PAYLOAD_BUFFER_LEN];
+  char single[SPLIT_PAYLOAD_BUFFER_LEN];
+  const StationInfo station;
+  SensorData data = referenceReading();
+  size_t sink = 0;
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    data.temperatureC = 20.0f + (float)(r & 15) * 0.1f;
+    for (size_t i = 0; i < SPLIT_SCHEMA_COUNT; i++) sink += SPLIT_WRITERS[i](station, data, TIMESTAMP, single, sizeof(single));
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    data.temperatureC = 20.0f + (float)(r & 15) * 0.1f;
+    SplitPayloadWriter writer(split, sizeof(split));
+    writer.begin(station, data, TIMESTAMP);
+    for (size_t i = 0; i < SPLIT_SCHEMA_COUNT; i++) sink += writer.write(*SPLIT_SCHEMAS[i], data);
+  }
+  auto t2 = std::chrono::steady_clock::now();
+
+  const double full = std::chrono::duration<double, std::nano>(t1 - t0).count() / rounds;
+  const double onePass = std::chrono::duration<double, std::nano>(t2 - t1).count() / rounds;
+  printf("Seis métricas por lectura: %.0f ns serializando cada una entera, %.0f ns en una pasada (x%.2f)  [%zu]\n",
+         full, onePass, full / onePass, sink % 10);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string dir = JSON_SAMPLES_DIR;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      dir = argv[++i];
+    } else {
+      fprintf(stderr, "uso: %s [--json DIR]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  printf("Cotas de compilación: general %zu B, modo dividido %zu B, cabecera %zu B\n",
+         SchemaPayload<SCHEMA_GENERAL>::MAX_LEN, SPLIT_PAYLOAD_MAX_LEN, PAYLOAD_HEADER_MAX_LEN);
+  int failures = checkSamples(dir);
+  failures += checkEquivalence(200000);
+  failures += checkBounds();
+  failures += checkEscapes();
+  bench(200000);
+  return failures ? 1 : 0;
+}
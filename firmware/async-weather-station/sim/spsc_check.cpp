@@ -0,0 +1,186 @@
+// =============================================================
+// === Cola lock-free 1 productor / 1 consumidor (SpscQueue.hpp) ===
+// =============================================================
+// 1) Un solo hilo: caben exactamente N, la N+1 se rechaza y se cuenta sin
+//    tocar lo guardado, vacía no devuelve nada y size() sigue a push/pop
+//    durante muchas vueltas al anillo.
+// 2) Dos hilos con SensorData (lo que cruza de la tarea de sensores a la de
+//    red) en una cola de 8: el productor insiste cuando está llena y el
+//    consumidor cuando está vacía, así que se pasa por llena y por vacía
+//    constantemente. Llegan todas, en orden y sin lecturas a medias (cada
+//    campo se deriva del número de secuencia).
+// 3) Dos hilos en los que el productor descarta cuando está llena (como
+//    runPublishTask()): recibidas + dropped() = enviadas, y lo recibido es
+//    una subsecuencia creciente.
+// Con -fsanitize=thread no debe informar de carreras.
+//
+//   g++ -std=c++17 -O2 -pthread -I.. spsc_check.cpp -o spsc_check
+//   ./spsc_check   (termina con código 1 si algo falla)
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <thread>
+
+#include "include/SensorData.hpp"
+#include "include/SpscQueue.hpp"
+
+namespace {
+
+uint32_t failures = 0;
+
+#define EXPECT(cond, ...)                             \
+  do {                                                \
+    if (!(cond)) {                                    \
+      if (failures++ < 20) {                          \
+        printf("  FALLO %s:%d ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__);                          \
+        printf("\n");                                 \
+      }                                               \
+    }                                                 \
+  } while (0)
+
+// Todos los campos a partir de la secuencia: una copia a medias se nota
+constexpr int64_t FIRST_TIMESTAMP_MS = 1735689600000LL;
+
+SensorData itemFor(uint32_t seq) {
+  SensorData d;
+  d.timestampMs = FIRST_TIMESTAMP_MS + seq;
+  d.temperatureC = (float)(seq % 1000);
+  d.humidityPercent = (float)(seq % 97);
+  d.pressureHpa = (float)(seq % 1013);
+  d.lightLux = (float)(seq % 65536);
+  d.windSpeedKmh = (float)(seq % 89);
+  d.gasRaw = (int)(seq ^ 0x5A5A5A5Au);
+  d.stats.windowMs = seq * 3u;
+  d.stats.pressureHpa.count = ~seq;
+  return d;
+}
+
+uint32_t sequenceOf(const SensorData& d) { return (uint32_t)(d.timestampMs - FIRST_TIMESTAMP_MS); }
+
+bool intact(const SensorData& d) {
+  const uint32_t seq = sequenceOf(d);
+  const SensorData e = itemFor(seq);
+  return d.timestampMs == e.timestampMs && d.temperatureC == e.temperatureC &&
+         d.humidityPercent == e.humidityPercent && d.pressureHpa == e.pressureHpa && d.lightLux == e.lightLux &&
+         d.windSpeedKmh == e.windSpeedKmh && d.gasRaw == e.gasRaw && d.stats.windowMs == e.stats.windowMs &&
+         d.stats.pressureHpa.count == e.stats.pressureHpa.count;
+}
+
+// === 1) Un solo hilo ===
+void checkSingleThread() {
+  SpscQueue<uint32_t, 8> q;
+  uint32_t out = 0;
+  EXPECT(q.empty() && !q.pop(out), "recién creada");
+  for (uint32_t i = 0; i < 8; i++) EXPECT(q.push(i), "push %u con sitio", (unsigned)i);
+  EXPECT(!q.push(99) && q.dropped() == 1 && q.size() == 8, "llena: rechaza y cuenta");
+  EXPECT(q.pop(out) && out == 0, "la primera sigue siendo la 0 (%u)", (unsigned)out);
+  EXPECT(q.push(8) && !q.push(100) && q.dropped() == 2, "un hueco, un push");
+
+  // Muchas vueltas con ocupación variable
+  uint32_t next = 1;
+  uint32_t sent = 9;
+  bool ordered = true;
+  for (uint32_t round = 0; round < 100000; round++) {
+    const uint32_t pushes = round % 5;
+    const uint32_t pops = (round * 7) % 5;
+    for (uint32_t i = 0; i < pushes; i++) {
+      if (q.push(sent)) sent++;
+    }
+    for (uint32_t i = 0; i < pops; i++) {
+      if (!q.pop(out)) break;
+      if (out != next) ordered = false;
+      next++;
+    }
+    if (q.size() != sent - next) ordered = false;
+  }
+  EXPECT(ordered, "orden y size() en un solo hilo");
+}
+
+// === 2) Dos hilos sin pérdidas ===
+void checkStress() {
+  static SpscQueue<SensorData, 8> q;
+  constexpr uint32_t COUNT = 1000000;
+  std::atomic<uint32_t> received{0};
+  std::atomic<uint32_t> broken{0};
+  std::atomic<uint32_t> emptySpins{0};
+  std::thread consumer([&]() {
+    uint32_t expected = 0;
+    SensorData d;
+    while (expected < COUNT) {
+      if (!q.pop(d)) {
+        emptySpins++;
+        std::this_thread::yield();  // con un solo núcleo el productor necesita correr
+        continue;
+      }
+      if (sequenceOf(d) != expected || !intact(d)) broken++;
+      expected++;
+    }
+    received = expected;
+  });
+  uint32_t fullSpins = 0;
+  for (uint32_t i = 0; i < COUNT;) {
+    if (q.push(itemFor(i))) {
+      i++;
+    } else {
+      fullSpins++;
+      std::this_thread::yield();
+    }
+  }
+  consumer.join();
+  SensorData extra;
+  EXPECT(received == COUNT && broken == 0 && !q.pop(extra), "%u recibidas, %u desordenadas o a medias",
+         (unsigned)received.load(), (unsigned)broken.load());
+  EXPECT(q.dropped() == fullSpins, "dropped() %u, rechazos %u", (unsigned)q.dropped(), (unsigned)fullSpins);
+  EXPECT(fullSpins > 0 && emptySpins > 0, "la prueba debe pasar por llena (%u) y por vacía (%u)",
+         (unsigned)fullSpins, (unsigned)emptySpins.load());
+  printf("dos hilos: %u lecturas por una cola de 8, llena %u veces y vacía %u\n", (unsigned)COUNT,
+         (unsigned)fullSpins, (unsigned)emptySpins.load());
+}
+
+// === 3) Dos hilos descartando cuando está llena ===
+void checkDropping() {
+  static SpscQueue<SensorData, 8> q;
+  constexpr uint32_t COUNT = 500000;
+  std::atomic<bool> done{false};
+  std::atomic<uint32_t> received{0};
+  std::atomic<bool> increasing{true};
+  std::thread consumer([&]() {
+    SensorData d;
+    int64_t last = -1;
+    uint32_t n = 0;
+    for (;;) {
+      const bool finished = done.load(std::memory_order_acquire);
+      if (q.pop(d)) {
+        if ((int64_t)sequenceOf(d) <= last || !intact(d)) increasing = false;
+        last = sequenceOf(d);
+        n++;
+      } else if (finished) {
+        break;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    received = n;
+  });
+  for (uint32_t i = 0; i < COUNT; i++) {
+    q.push(itemFor(i));
+    if (i % 64 == 0) std::this_thread::yield();
+  }
+  done.store(true, std::memory_order_release);
+  consumer.join();
+  EXPECT(received + q.dropped() == COUNT && increasing, "recibidas %u + descartadas %u de %u",
+         (unsigned)received.load(), (unsigned)q.dropped(), (unsigned)COUNT);
+}
+
+}  // namespace
+
+int main() {
+  checkSingleThread();
+  checkStress();
+  checkDropping();
+  printf("%s (%u fallos)\n", failures ? "FALLOS" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,431 @@
+// =============================================================
+// === Simulación de la estación en el host ===
+// =============================================================
+// Compila el sketch completo (async-weather-station.ino y todo include/)
+// contra el HAL de sim/hal y lo ejecuta con reloj virtual: setup(), las
+// tareas de sensores, red y log, la ISR del anemómetro, WiFi, MQTT, NTP y
+// la cola en LittleFS, tal cual. Días de funcionamiento en segundos y, con
+// la misma semilla y traza, siempre el mismo resultado.
+//
+//   cmake -S . -B build && cmake --build build --target station_sim
+//   ./build/station_sim --trace sim/traces/dia_con_cortes.csv --duration 3d --mqtt-log mqtt.log
+//
+// Opciones:
+//   --trace CSV         valores de los sensores y cortes de WiFi/broker (SensorTrace.hpp)
+//   --repeat            repite la traza durante toda la simulación
+//   --duration T        tiempo simulado: 90s, 15m, 12h, 3d (por defecto 1d)
+//   --seed N            semilla de esp_random(), random() y del jitter del viento
+//   --start ISO         hora real al arrancar, p. ej. 2025-03-30T00:30:00Z (cambio de hora)
+//   --uptime-ms N       millis() inicial (p. ej. 4294000000 para ver el desborde)
+//   --pulses CSV        pulsos extra del anemómetro: "t_s[,n[,separación_us]]" por línea
+//   --inject CSV        mensajes al broker: "t_s,topic,payload" (payload hasta fin de línea)
+//   --log FILE          salida Serial del firmware ("-" = stdout)
+//   --mqtt-log FILE     todo el tráfico del broker, una línea por mensaje
+//   --fs DIR            directorio de LittleFS (se conserva; por defecto uno temporal)
+//   --cpu-scale X       el código consume X veces su CPU del host en tiempo virtual
+//                       (mide latencias con carga; deja de ser determinista)
+//   --alloc-check       termina con código 1 si alguna tarea del firmware reserva
+//                       memoria tras el arranque (prueba de larga duración:
+//                       --trace ... --repeat --duration 7d --alloc-check)
+//   --alloc-trace N     backtrace de las N primeras reservas de ese tipo
+//   --max-first-publish-ms N
+//                       termina con código 1 si la primera lectura confirmada por
+//                       el broker (hito first_publish) no llega en N ms desde setup()
+#include <Arduino.h>
+
+#include "../async-weather-station.ino"
+
+#include <dirent.h>
+#include <execinfo.h>
+
+#include <chrono>
+#include <random>
+
+#include "SensorTrace.hpp"
+#include "SimHal.hpp"
+
+namespace {
+
+struct Options {
+  const char* trace = nullptr;
+  bool repeat = false;
+  uint64_t durationUs = 86400ull * 1000000ull;
+  uint64_t seed = 1;
+  int64_t startEpochMs = 1735689600000LL;  // 2025-01-01T00:00:00Z
+  uint64_t uptimeMs = 0;
+  const char* pulses = nullptr;
+  const char* inject = nullptr;
+  const char* log = nullptr;
+  const char* mqttLog = nullptr;
+  const char* fs = nullptr;
+  double cpuScale = 0.0;
+  bool allocCheck = false;
+  unsigned allocTrace = 0;
+  uint32_t maxFirstPublishMs = 0;  // 0 = sin comprobar
+};
+
+SensorTrace trace;
+uint64_t startUs = 0;
+std::mt19937_64 windRng;
+
+double traceTime() { return (double)(sim::nowUs() - startUs) / 1e6; }
+
+[[noreturn]] void usage(const char* message) {
+  fprintf(stderr, "station_sim: %s\n(ver la cabecera de sim/station_sim.cpp)\n", message);
+  exit(2);
+}
+
+bool parseDuration(const char* text, uint64_t& us) {
+  char* end = nullptr;
+  const double value = strtod(text, &end);
+  if (end == text || value < 0) return false;
+  double scale = 1.0;
+  if (*end == 's' || *end == '\0') scale = 1.0;
+  else if (*end == 'm') scale = 60.0;
+  else if (*end == 'h') scale = 3600.0;
+  else if (*end == 'd') scale = 86400.0;
+  else return false;
+  us = (uint64_t)(value * scale * 1e6);
+  return true;
+}
+
+bool parseIsoUtc(const char* text, int64_t& epochMs) {
+  struct tm tm = {};
+  if (sscanf(text, "%d-%d-%dT%d:%d:%dZ", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min,
+             &tm.tm_sec) != 6) {
+    return false;
+  }
+  tm.tm_year -= 1900;
+  tm.tm_mon -= 1;
+  epochMs = (int64_t)timegm(&tm) * 1000;
+  return true;
+}
+
+Options parseOptions(int argc, char** argv) {
+  Options o;
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    auto next = [&]() -> const char* {
+      if (i + 1 >= argc) usage((std::string("falta el valor de ") + arg).c_str());
+      return argv[++i];
+    };
+    if (!strcmp(arg, "--trace")) o.trace = next();
+    else if (!strcmp(arg, "--repeat")) o.repeat = true;
+    else if (!strcmp(arg, "--duration")) {
+      if (!parseDuration(next(), o.durationUs)) usage("duración no válida");
+    } else if (!strcmp(arg, "--seed")) o.seed = strtoull(next(), nullptr, 10);
+    else if (!strcmp(arg, "--start")) {
+      if (!parseIsoUtc(next(), o.startEpochMs)) usage("--start espera AAAA-MM-DDTHH:MM:SSZ");
+    } else if (!strcmp(arg, "--uptime-ms")) o.uptimeMs = strtoull(next(), nullptr, 10);
+    else if (!strcmp(arg, "--pulses")) o.pulses = next();
+    else if (!strcmp(arg, "--inject")) o.inject = next();
+    else if (!strcmp(arg, "--log")) o.log = next();
+    else if (!strcmp(arg, "--mqtt-log")) o.mqttLog = next();
+    else if (!strcmp(arg, "--fs")) o.fs = next();
+    else if (!strcmp(arg, "--cpu-scale")) o.cpuScale = atof(next());
+    else if (!strcmp(arg, "--alloc-check")) o.allocCheck = true;
+    else if (!strcmp(arg, "--alloc-trace")) o.allocTrace = (unsigned)strtoul(next(), nullptr, 10);
+    else if (!strcmp(arg, "--max-first-publish-ms")) o.maxFirstPublishMs = (uint32_t)strtoul(next(), nullptr, 10);
+    else usage((std::string("opción desconocida ") + arg).c_str());
+  }
+  return o;
+}
+
+FILE* openOutput(const char* path) {
+  if (!path) return nullptr;
+  if (!strcmp(path, "-")) return stdout;
+  FILE* file = fopen(path, "w");
+  if (!file) usage((std::string("no se puede crear ") + path).c_str());
+  return file;
+}
+
+// =============================================================
+// === Entorno desde la traza ===
+// =============================================================
+void readEnvironment(uint64_t nowUs, sim::Environment& env) {
+  (void)nowUs;
+  if (trace.empty()) return;
+  const double t = traceTime();
+  if (trace.has(SensorTrace::TEMPERATURE)) env.temperatureC = trace.value(SensorTrace::TEMPERATURE, t);
+  if (trace.has(SensorTrace::HUMIDITY)) env.humidityPercent = trace.value(SensorTrace::HUMIDITY, t);
+  if (trace.has(SensorTrace::PRESSURE)) env.pressureHpa = trace.value(SensorTrace::PRESSURE, t);
+  if (trace.has(SensorTrace::LIGHT)) env.lightLux = trace.value(SensorTrace::LIGHT, t);
+  if (trace.has(SensorTrace::RSSI)) {
+    const float rssi = trace.value(SensorTrace::RSSI, t);
+    if (!isnan(rssi)) env.rssi = (int8_t)lroundf(rssi);
+  }
+  env.analog[MQ2_AO] = 400;
+  if (trace.has(SensorTrace::GAS)) {
+    const float gas = trace.value(SensorTrace::GAS, t);
+    env.analog[MQ2_AO] = isnan(gas) ? 0 : (uint16_t)lroundf(gas < 0 ? 0 : gas);
+  }
+}
+
+// Escalones de disponibilidad: un evento por cambio, encadenados
+void followStep(SensorTrace::Column column, void (*apply)(bool)) {
+  const double at = trace.nextChange(column, traceTime());
+  if (isinf(at)) return;
+  sim::schedule(startUs + (uint64_t)(at * 1e6), [column, apply] {
+    apply(trace.flag(column, traceTime()));
+    followStep(column, apply);
+  });
+}
+
+// Un flanco de bajada por vuelta de cazoletas a la frecuencia de la traza,
+// con un 3 % de variación entre pulsos
+void scheduleWindPulse(uint64_t atUs) {
+  sim::schedule(atUs, [] {
+    const float kmh = trace.value(SensorTrace::WIND, traceTime());
+    const double hz = isnan(kmh) ? 0.0 : kmh / ANEMO_FACTOR;
+    if (hz < 0.05) {
+      scheduleWindPulse(sim::nowUs() + 1000000);
+      return;
+    }
+    sim::pulse(ANEMO_PIN);
+    std::uniform_real_distribution<double> jitter(0.97, 1.03);
+    scheduleWindPulse(sim::nowUs() + (uint64_t)(1e6 / hz * jitter(windRng)));
+  });
+}
+
+size_t loadPulses(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (!file) usage((std::string("no se puede abrir ") + path).c_str());
+  char line[256];
+  size_t count = 0;
+  while (fgets(line, sizeof(line), file)) {
+    if (line[0] == '#' || line[0] == '\n') continue;
+    double t = 0;
+    unsigned n = 1;
+    unsigned gapUs = 1000;
+    if (sscanf(line, "%lf,%u,%u", &t, &n, &gapUs) < 1) continue;
+    for (unsigned k = 0; k < n; k++) {
+      sim::schedule(startUs + (uint64_t)(t * 1e6) + (uint64_t)k * gapUs, [] { sim::pulse(ANEMO_PIN); });
+      count++;
+    }
+  }
+  fclose(file);
+  return count;
+}
+
+size_t loadInjections(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (!file) usage((std::string("no se puede abrir ") + path).c_str());
+  char line[4096];
+  size_t count = 0;
+  while (fgets(line, sizeof(line), file)) {
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '#' || line[0] == '\0') continue;
+    char* topic = strchr(line, ',');
+    char* payload = topic ? strchr(topic + 1, ',') : nullptr;
+    if (!payload) continue;
+    *topic++ = '\0';
+    *payload++ = '\0';
+    const std::string t = topic;
+    const std::string body = payload;
+    sim::schedule(startUs + (uint64_t)(atof(line) * 1e6), [t, body] { sim::broker().publish(t, body, false, "inject"); });
+    count++;
+  }
+  fclose(file);
+  return count;
+}
+
+// =============================================================
+// === Informe final ===
+// =============================================================
+void printDuration(uint64_t us) {
+  uint64_t s = us / 1000000;
+  printf("%llu d %02llu:%02llu:%02llu", (unsigned long long)(s / 86400), (unsigned long long)(s / 3600 % 24),
+         (unsigned long long)(s / 60 % 60), (unsigned long long)(s % 60));
+}
+
+void printReport(const Options& o, double wallS) {
+  const uint64_t simulatedUs = sim::nowUs() - startUs;
+  printf("\n=== Simulación ===\n");
+  printf("simulado ");
+  printDuration(simulatedUs);
+  printf(" en %.2f s: %.0fx tiempo real | semilla %llu | cpu-scale %g\n", wallS, simulatedUs / 1e6 / wallS,
+         (unsigned long long)o.seed, o.cpuScale);
+
+  const sim::NetworkReport net = sim::networkReport();
+  printf("\n=== Red ===\n");
+  printf("WiFi: %llu conexiones, %llu intentos fallidos | MQTT: %llu conexiones, %llu fallidas | DNS: %llu\n",
+         (unsigned long long)net.wifiConnects, (unsigned long long)net.wifiFailures,
+         (unsigned long long)net.mqttConnects, (unsigned long long)net.mqttFailures,
+         (unsigned long long)net.dnsQueries);
+  printf("PUBLISH %llu, PUBACK %llu, perdidos por cortes %llu | hora NTP %s\n", (unsigned long long)net.published,
+         (unsigned long long)net.acked, (unsigned long long)net.lostAcks, net.clockSynced ? "sincronizada" : "sin sincronizar");
+
+  printf("\n=== Broker ===\n%-48s %9s %11s %9s\n", "topic", "mensajes", "bytes", "retenidos");
+  for (const auto& entry : sim::broker().stats()) {
+    printf("%-48s %9llu %11llu %9llu\n", entry.first.c_str(), (unsigned long long)entry.second.messages,
+           (unsigned long long)entry.second.bytes, (unsigned long long)entry.second.retained);
+  }
+
+  printf("\n=== Firmware ===\n");
+  printf("lecturas enviadas %lu, suprimidas %lu | cola persistente %lu pendientes, %llu fsync\n",
+         (unsigned long)reportFilter.sent(), (unsigned long)reportFilter.suppressed(),
+         (unsigned long)readingQueue.size(), (unsigned long long)sim::fsyncCount());
+  printf("comandos ok %lu, erróneos %lu | OLED %llu B por I2C | Serial %llu B\n",
+         (unsigned long)commands.count(CommandStatus::OK),
+         (unsigned long)(commands.count(CommandStatus::MALFORMED) + commands.count(CommandStatus::UNKNOWN) +
+                         commands.count(CommandStatus::BAD_ARGS) + commands.count(CommandStatus::FAILED)),
+         (unsigned long long)sim::displayBytes(), (unsigned long long)sim::serialBytes());
+
+  printf("\n=== Arranque ===\n");
+  printf("hitos (ms desde setup()):");
+  for (size_t i = 0; i < BOOT_MILESTONE_COUNT; i++) {
+    const BootMilestone m = (BootMilestone)i;
+    if (boot.reached(m)) {
+      printf("%s %s %lu", i ? " |" : "", BootSequence::milestoneName(m), (unsigned long)boot.elapsedMs(m));
+    } else {
+      printf("%s %s sin alcanzar", i ? " |" : "", BootSequence::milestoneName(m));
+    }
+  }
+  printf("\ndegradados:");
+  if (boot.degradedMask() == 0) printf(" ninguno");
+  for (size_t i = 0; i < BOOT_DEVICE_COUNT; i++) {
+    if (boot.degraded((BootDevice)i)) printf(" %s", BootSequence::deviceName((BootDevice)i));
+  }
+  const WiFiConnectMetrics& wifiMetrics = wifiPolicy.metrics();
+  printf("\nWiFi: %lu intentos, %lu directos y %lu con escaneo con éxito, %lu fallidos (%lu por timeout) | "
+         "latencia mejor %lu, media %lu, peor %lu ms\n",
+         (unsigned long)wifiMetrics.attempts, (unsigned long)wifiMetrics.directSuccesses,
+         (unsigned long)wifiMetrics.scanSuccesses, (unsigned long)wifiMetrics.failures,
+         (unsigned long)wifiMetrics.timeouts, (unsigned long)wifiMetrics.bestLatencyMs,
+         (unsigned long)wifiMetrics.meanLatencyMs(), (unsigned long)wifiMetrics.worstLatencyMs);
+
+  printf("\n=== Tareas ===\n");
+  printf("CPU del host por paso (us) y espera de lista a en ejecución (ms de tiempo virtual)\n");
+  printf("%-10s %4s %4s %10s %8s %8s %8s %8s %8s %8s\n", "tarea", "prio", "core", "pasos", "cpu p50", "p99", "máx",
+         "espera50", "p99", "máx");
+  for (const sim::TaskReport& t : sim::taskReports()) {
+    printf("%-10s %4u %4d %10llu %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f\n", t.name, t.priority, t.core,
+           (unsigned long long)t.steps, t.cpuNs.percentile(0.5) / 1e3, t.cpuNs.percentile(0.99) / 1e3,
+           t.cpuNs.max() / 1e3, t.wakeDelayUs.percentile(0.5) / 1e3, t.wakeDelayUs.percentile(0.99) / 1e3,
+           t.wakeDelayUs.max() / 1e3);
+  }
+}
+
+// Devuelve false si la primera publicación confirmada no llega a tiempo
+bool checkFirstPublish(const Options& o) {
+  if (o.maxFirstPublishMs == 0) return true;
+  if (!boot.reached(BOOT_FIRST_PUBLISH)) {
+    printf("\nFALLO: sin primera publicación confirmada (límite %lu ms)\n", (unsigned long)o.maxFirstPublishMs);
+    return false;
+  }
+  const uint32_t ms = boot.elapsedMs(BOOT_FIRST_PUBLISH);
+  if (ms > o.maxFirstPublishMs) {
+    printf("\nFALLO: primera publicación a los %lu ms (límite %lu ms)\n", (unsigned long)ms,
+           (unsigned long)o.maxFirstPublishMs);
+    return false;
+  }
+  return true;
+}
+
+// Reservas de las tareas del firmware una vez completado el arranque
+void traceAllocations(unsigned limit) {
+  sim::setAllocationObserver([limit](size_t bytes) {
+    static unsigned traced = 0;
+    const void* task = xTaskGetCurrentTaskHandle();
+    if (traced >= limit || !heapAllocations.steady() || !task) return;
+    if (task != sensorTaskHandle && task != networkTaskHandle && task != logTaskHandle) return;
+    traced++;
+    fprintf(stderr, "\n--- reserva de %zu B en '%s' a los %.3f s ---\n", bytes, pcTaskGetName((TaskHandle_t)task),
+            traceTime());
+    void* frames[32];
+    const int n = backtrace(frames, 32);
+    backtrace_symbols_fd(frames, n, 2);
+  });
+}
+
+// Devuelve false si alguna tarea del firmware ha reservado tras el arranque
+bool printAllocations() {
+  printf("\n=== Memoria ===\n");
+  if (!heapAllocations.steady()) {
+    printf("el arranque no se ha completado: sin referencia de funcionamiento estable\n");
+    return false;
+  }
+  uint64_t cycles = 0;
+  for (const sim::TaskReport& t : sim::taskReports()) {
+    if (strcmp(t.name, "sensors") == 0 || strcmp(t.name, "network") == 0 || strcmp(t.name, "log") == 0) cycles += t.steps;
+  }
+  printf("%-10s %12s %12s %14s %12s\n", "tarea", "reservas", "liberadas", "bytes", "tras arranque");
+  for (size_t i = 0; i < heapAllocations.slots(); i++) {
+    if (!heapAllocations.used(i)) continue;
+    printf("%-10s %12lu %12lu %14lu %12lu\n", heapAllocations.name(i), (unsigned long)heapAllocations.allocations(i),
+           (unsigned long)heapAllocations.frees(i), (unsigned long)heapAllocations.bytes(i),
+           (unsigned long)heapAllocations.steadyAllocations(i));
+  }
+  const uint32_t steady = heapAllocations.steadyFirmwareAllocations();
+  printf("%llu pasos de las tareas del firmware, %lu reservas tras el arranque%s\n", (unsigned long long)cycles,
+         (unsigned long)steady, steady ? " (--alloc-trace N para ver dónde)" : "");
+  return steady == 0;
+}
+
+void removeTree(const std::string& dir) {
+  if (DIR* d = opendir(dir.c_str())) {
+    while (struct dirent* e = readdir(d)) {
+      if (strcmp(e->d_name, ".") && strcmp(e->d_name, "..")) unlink((dir + "/" + e->d_name).c_str());
+    }
+    closedir(d);
+  }
+  rmdir(dir.c_str());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const Options o = parseOptions(argc, argv);
+
+  sim::KernelConfig kernel;
+  kernel.cpuScale = o.cpuScale;
+  kernel.initialUptimeUs = o.uptimeMs * 1000;
+  sim::configure(kernel);
+  startUs = sim::nowUs();
+  sim::setSeed(o.seed);
+  windRng.seed(o.seed);
+
+  sim::NetworkConfig network;
+  network.startEpochMs = o.startEpochMs;
+  sim::configureNetwork(network);
+
+  std::string fsRoot = o.fs ? o.fs : "";
+  if (!o.fs) {
+    char pattern[] = "/tmp/station_sim.XXXXXX";
+    if (!mkdtemp(pattern)) usage("no se puede crear el directorio temporal");
+    fsRoot = pattern;
+  }
+  sim::setFilesystemRoot(fsRoot.c_str());
+  FILE* serialLog = openOutput(o.log);
+  FILE* mqttLog = openOutput(o.mqttLog);
+  sim::setSerialSink(serialLog);
+  sim::broker().setLog(mqttLog);
+
+  if (o.trace) {
+    std::string error;
+    if (!trace.load(o.trace, error)) usage(("traza: " + error).c_str());
+    trace.setRepeat(o.repeat);
+    sim::setAccessPoint(trace.flag(SensorTrace::WIFI, 0.0));
+    sim::setBrokerUp(trace.flag(SensorTrace::BROKER, 0.0));
+    followStep(SensorTrace::WIFI, sim::setAccessPoint);
+    followStep(SensorTrace::BROKER, sim::setBrokerUp);
+    if (trace.has(SensorTrace::WIND)) scheduleWindPulse(startUs);
+  }
+  sim::setEnvironmentSource(readEnvironment);
+  if (o.pulses) loadPulses(o.pulses);
+  if (o.inject) loadInjections(o.inject);
+  if (o.allocTrace > 0) traceAllocations(o.allocTrace);
+
+  sim::startArduino(setup, loop);
+  const auto wall0 = std::chrono::steady_clock::now();
+  sim::run(startUs + o.durationUs);
+  const double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+
+  if (serialLog && serialLog != stdout) fclose(serialLog);
+  if (mqttLog && mqttLog != stdout) fclose(mqttLog);
+  printReport(o, wallS);
+  const bool heapStable = printAllocations();
+  const bool bootInTime = checkFirstPublish(o);
+  if (!o.fs) removeTree(fsRoot);
+  return (o.allocCheck && !heapStable) || !bootInTime ? 1 : 0;
+}
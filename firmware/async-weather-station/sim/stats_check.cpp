@@ -0,0 +1,259 @@
+// =============================================================
+// === Estadística en línea (RunningStats.hpp) ===
+// =============================================================
+// Se compara con una referencia de dos pasadas en long double (media, y
+// luego la suma de cuadrados respecto a esa media) y con la recursión de
+// la media exponencial en double:
+// 1) Sin muestras todo es NaN; con una, media = mín = máx = ewma y sd = 0.
+// 2) NaN e infinitos se ignoran: intercalarlos no cambia nada, y un NaN
+//    inicial no arranca la media exponencial.
+// 3) Presión con media 1013 hPa y dispersión de centésimas (100 000
+//    muestras): Welford coincide con la referencia, donde la fórmula de
+//    una pasada con sumas en float no se acerca.
+// 4) Un día de la traza dia_con_cortes.csv con ruido, muestreado cada 2 s
+//    y cerrado en ventanas de 30 s como en el sketch (con el hueco del DHT
+//    de 02:00 a 02:30): cada resumen contra la referencia, y la media
+//    exponencial continua entre ventanas.
+//
+//   g++ -std=c++17 -O2 -I.. stats_check.cpp -o stats_check
+//   ./stats_check --trace traces/dia_con_cortes.csv   (termina con código 1 si algo falla)
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "include/RunningStats.hpp"
+#include "sim/SensorTrace.hpp"
+
+#ifndef SIM_TRACES_DIR
+#define SIM_TRACES_DIR "sim/traces"
+#endif
+
+namespace {
+
+uint32_t failures = 0;
+
+#define EXPECT(cond, ...)                             \
+  do {                                                \
+    if (!(cond)) {                                    \
+      if (failures++ < 20) {                          \
+        printf("  FALLO %s:%d ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__);                          \
+        printf("\n");                                 \
+      }                                               \
+    }                                                 \
+  } while (0)
+
+constexpr float ALPHA = 0.1f;  // STATS_EWMA_ALPHA del sketch
+
+// === Referencia de dos pasadas ===
+struct Reference {
+  uint32_t count = 0;
+  double mean = NAN;
+  double stddev = NAN;
+  float min = NAN;
+  float max = NAN;
+};
+
+Reference twoPass(const std::vector<float>& samples) {
+  Reference r;
+  long double sum = 0.0L;
+  for (float v : samples) {
+    if (!isfinite(v)) continue;
+    sum += v;
+    if (r.count == 0 || v < r.min) r.min = v;
+    if (r.count == 0 || v > r.max) r.max = v;
+    r.count++;
+  }
+  if (r.count == 0) return r;
+  const long double mean = sum / r.count;
+  long double squares = 0.0L;
+  for (float v : samples) {
+    if (isfinite(v)) squares += (v - mean) * (v - mean);
+  }
+  r.mean = (double)mean;
+  r.stddev = r.count > 1 ? (double)sqrtl(squares / (r.count - 1)) : 0.0;
+  return r;
+}
+
+// Error admitido: el redondeo a float del resultado, más el de la media
+// sobre la dispersión (la diferencia valor - media pierde esos bits)
+bool matches(const ChannelSummary& s, const Reference& r) {
+  if (s.count != r.count) return false;
+  if (r.count == 0) return isnan(s.mean) && isnan(s.stddev) && isnan(s.min) && isnan(s.max);
+  const double meanTol = 2e-7 * fabs(r.mean) + 1e-12;
+  const double sdTol = 1e-6 * r.stddev + 2e-7 * fabs(r.mean) + 1e-12;
+  return fabs(s.mean - r.mean) <= meanTol && fabs(s.stddev - r.stddev) <= sdTol && s.min == r.min &&
+         s.max == r.max;
+}
+
+// === 1) Cero y una muestra ===
+void checkEdgeCounts() {
+  RunningStats empty(ALPHA);
+  const ChannelSummary none = empty.summary();
+  EXPECT(none.count == 0 && isnan(none.mean) && isnan(none.stddev) && isnan(none.min) && isnan(none.max) &&
+             isnan(none.ewma) && isnan(empty.variance()),
+         "sin muestras todo es NaN");
+
+  RunningStats one(ALPHA);
+  one.add(-3.25f);
+  const ChannelSummary s = one.summary();
+  EXPECT(s.count == 1 && s.mean == -3.25f && s.min == -3.25f && s.max == -3.25f && s.ewma == -3.25f &&
+             s.stddev == 0.0f && one.variance() == 0.0f,
+         "una muestra: media %g sd %g ewma %g", s.mean, s.stddev, s.ewma);
+
+  // Tras reset() vuelve a cero muestras, pero la media exponencial sigue
+  one.reset();
+  EXPECT(one.count() == 0 && isnan(one.mean()) && isnan(one.stddev()) && one.ewma() == -3.25f,
+         "reset() conserva solo la media exponencial");
+  one.add(6.75f);
+  EXPECT(one.mean() == 6.75f && one.stddev() == 0.0f && fabsf(one.ewma() - (-3.25f + ALPHA * 10.0f)) < 1e-6f,
+         "primera muestra tras reset(): ewma %g", one.ewma());
+}
+
+// === 2) NaN e infinitos ===
+void checkNonFinite() {
+  std::mt19937 rng(7);
+  std::normal_distribution<float> dist(21.0f, 3.0f);
+  RunningStats clean(ALPHA);
+  RunningStats dirty(ALPHA);
+  dirty.add(NAN);
+  dirty.add(INFINITY);
+  EXPECT(dirty.count() == 0 && isnan(dirty.ewma()), "un NaN inicial no cuenta ni arranca la ewma");
+  std::vector<float> samples;
+  for (int i = 0; i < 1000; i++) {
+    const float v = dist(rng);
+    clean.add(v);
+    dirty.add(v);
+    samples.push_back(v);
+    if (i % 7 == 0) {
+      dirty.add(NAN);
+      samples.push_back(NAN);
+    }
+    if (i % 11 == 0) {
+      dirty.add(i % 2 ? INFINITY : -INFINITY);
+      samples.push_back(-INFINITY);
+    }
+  }
+  const ChannelSummary a = clean.summary();
+  const ChannelSummary b = dirty.summary();
+  EXPECT(a.count == b.count && a.mean == b.mean && a.stddev == b.stddev && a.min == b.min && a.max == b.max &&
+             a.ewma == b.ewma,
+         "con NaN e infinitos intercalados: %u frente a %u muestras", (unsigned)b.count, (unsigned)a.count);
+  EXPECT(matches(b, twoPass(samples)), "contra la referencia ignorando lo no finito");
+}
+
+// === 3) Media grande frente a la dispersión ===
+void checkCancellation() {
+  std::mt19937 rng(3);
+  std::normal_distribution<float> dist(1013.25f, 0.02f);
+  RunningStats stats(ALPHA);
+  std::vector<float> samples;
+  float sum = 0.0f;
+  float sumSquares = 0.0f;
+  for (int i = 0; i < 100000; i++) {
+    const float v = dist(rng);
+    stats.add(v);
+    samples.push_back(v);
+    sum += v;
+    sumSquares += v * v;
+  }
+  const Reference ref = twoPass(samples);
+  const float n = (float)samples.size();
+  const float naiveVariance = (sumSquares - sum * sum / n) / (n - 1.0f);
+  const float naive = naiveVariance > 0.0f ? sqrtf(naiveVariance) : 0.0f;
+  EXPECT(matches(stats.summary(), ref), "Welford sd %.6f, referencia %.6f", stats.stddev(), ref.stddev);
+  printf("presión 1013,25 ± 0,02 hPa, 100 000 muestras: sd de referencia %.6f, Welford %.6f, "
+         "sumas en float %.6f\n",
+         ref.stddev, stats.stddev(), naive);
+}
+
+// === 4) Un día de la traza en ventanas de 30 s ===
+void checkTraceDay(const SensorTrace& trace) {
+  const SensorTrace::Column columns[] = {SensorTrace::TEMPERATURE, SensorTrace::HUMIDITY, SensorTrace::PRESSURE,
+                                         SensorTrace::LIGHT, SensorTrace::WIND, SensorTrace::GAS};
+  const float noise[] = {0.05f, 0.5f, 0.03f, 20.0f, 0.8f, 2.0f};
+  std::mt19937 rng(1);
+  std::normal_distribution<float> unit(0.0f, 1.0f);
+
+  StatsWindow window;
+  window.setEwmaAlpha(ALPHA);
+  window.open(0);
+  std::vector<float> pending[6];
+  double ewmaRef[6] = {NAN, NAN, NAN, NAN, NAN, NAN};
+  uint32_t windows = 0;
+  uint32_t mismatched = 0;
+  uint32_t emptyWindows = 0;
+  float worstEwma = 0.0f;
+
+  for (uint32_t ms = 2000; ms <= 86400000u; ms += 2000) {
+    const double t = ms / 1000.0;
+    for (int c = 0; c < 6; c++) {
+      const float v = trace.value(columns[c], t) + noise[c] * unit(rng);
+      pending[c].push_back(v);
+      if (isfinite(v)) ewmaRef[c] = isnan(ewmaRef[c]) ? v : ewmaRef[c] + ALPHA * (v - ewmaRef[c]);
+    }
+    window.temperatureC.add(pending[0].back());
+    window.humidityPercent.add(pending[1].back());
+    window.pressureHpa.add(pending[2].back());
+    window.lightLux.add(pending[3].back());
+    window.windSpeedKmh.add(pending[4].back());
+    window.gasRaw.add(pending[5].back());
+    if (ms % 30000 != 0) continue;
+
+    const SensorStats stats = window.close(ms);
+    const ChannelSummary* summaries[] = {&stats.temperatureC, &stats.humidityPercent, &stats.pressureHpa,
+                                         &stats.lightLux,     &stats.windSpeedKmh,    &stats.gasRaw};
+    windows++;
+    if (stats.windowMs != 30000) mismatched++;
+    for (int c = 0; c < 6; c++) {
+      const ChannelSummary& s = *summaries[c];
+      if (!matches(s, twoPass(pending[c]))) mismatched++;
+      if (s.count == 0) emptyWindows++;
+      if (!isnan(ewmaRef[c])) {
+        const float err = fabsf(s.ewma - (float)ewmaRef[c]) / fmaxf(1.0f, fabsf((float)ewmaRef[c]));
+        worstEwma = fmaxf(worstEwma, err);
+      }
+      pending[c].clear();
+    }
+  }
+  EXPECT(windows == 2880 && mismatched == 0, "%u ventanas, %u resúmenes distintos de la referencia",
+         (unsigned)windows, (unsigned)mismatched);
+  // 02:00-02:30 son 60 ventanas, pero la que cierra a las 02:30 ya lleva la primera muestra
+  EXPECT(emptyWindows == 59, "ventanas sin humedad durante el corte del DHT: %u", (unsigned)emptyWindows);
+  EXPECT(worstEwma < 1e-5f, "ewma continua entre ventanas: error relativo %g", worstEwma);
+  printf("un día en %u ventanas de 30 s y 6 canales: todas iguales a dos pasadas, ewma a %.1e\n",
+         (unsigned)windows, worstEwma);
+
+  // Una ventana cerrada en el mismo ms no divide por cero
+  StatsWindow instant;
+  instant.open(500);
+  EXPECT(instant.close(500).windowMs == 1, "ventana de 0 ms");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string tracePath = SIM_TRACES_DIR "/dia_con_cortes.csv";
+  for (int i = 1; i + 1 < argc; i++) {
+    if (strcmp(argv[i], "--trace") == 0) tracePath = argv[++i];
+  }
+  SensorTrace trace;
+  std::string error;
+  if (!trace.load(tracePath.c_str(), error)) {
+    fprintf(stderr, "traza %s: %s\n", tracePath.c_str(), error.c_str());
+    return 2;
+  }
+  trace.setRepeat(true);
+
+  checkEdgeCounts();
+  checkNonFinite();
+  checkCancellation();
+  checkTraceDay(trace);
+  printf("%s (%u fallos)\n", failures ? "FALLOS" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,138 @@
+// =============================================================
+// === Banco de pruebas de IsoTimestampFormatter ===
+// =============================================================
+// 1) Contraste con libc (localtime_r/gmtime_r + strftime): cada segundo de
+//    las dos horas alrededor de todos los cambios de horario entre 1971 y
+//    2100, y muestras aleatorias (también hacia atrás) en todo el rango.
+// 2) Rendimiento frente al método anterior (getLocalTime + strftime +
+//    inserción del ':').
+//
+//   g++ -std=c++17 -O2 -I.. timestamp_bench.cpp -o timestamp_bench
+//   ./timestamp_bench            (termina con código 1 si hay diferencias)
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <random>
+
+#include "include/IsoTimestamp.hpp"
+
+namespace {
+
+// Referencia: lo que hacía getTimestampISO8601(), con milisegundos opcionales
+size_t reference(int64_t epochMs, bool utc, bool withMillis, char* out, size_t capacity) {
+  const time_t t = (time_t)(epochMs / 1000);
+  struct tm tm;
+  if (utc) {
+    gmtime_r(&t, &tm);
+  } else {
+    localtime_r(&t, &tm);
+  }
+  char date[32];
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", &tm);
+  char millis[8] = "";
+  if (withMillis) snprintf(millis, sizeof(millis), ".%03d", (int)(epochMs % 1000));
+  char zone[8] = "Z";
+  if (!utc) {
+    char z[8];
+    strftime(z, sizeof(z), "%z", &tm);  // +0100
+    snprintf(zone, sizeof(zone), "%.3s:%.2s", z, z + 3);
+  }
+  return (size_t)snprintf(out, capacity, "%s%s%s", date, millis, zone);
+}
+
+struct Checker {
+  IsoTimestampFormatter local{false};
+  IsoTimestampFormatter utc{true};
+  uint64_t checked = 0;
+  uint64_t mismatches = 0;
+
+  void check(int64_t epochMs) {
+    for (int variant = 0; variant < 4; variant++) {
+      const bool isUtc = variant & 1;
+      const bool withMillis = variant & 2;
+      char got[40];
+      char want[40];
+      const size_t n = (isUtc ? utc : local).format(epochMs, got, sizeof(got), withMillis);
+      reference(epochMs, isUtc, withMillis, want, sizeof(want));
+      checked++;
+      if (n != strlen(want) || strcmp(got, want) != 0) {
+        if (mismatches++ < 10) printf("  DIFERENCIA %lld: %s != %s\n", (long long)epochMs, got, want);
+      }
+    }
+  }
+};
+
+int32_t offsetOf(int64_t seconds) {
+  const time_t t = (time_t)seconds;
+  struct tm tm;
+  localtime_r(&t, &tm);
+  return (int32_t)tm.tm_gmtoff;
+}
+
+bool verifyZone(const char* tz) {
+  setenv("TZ", tz, 1);
+  tzset();
+  Checker c;
+  const int64_t from = 31536000;    // 1971
+  const int64_t to = 4102444800LL;  // 2100
+  uint32_t transitions = 0;
+
+  // Cambios de horario: barrido por horas y, en cada uno, cada segundo ±1 h
+  int32_t previous = offsetOf(from);
+  for (int64_t s = from + 3600; s < to; s += 3600) {
+    const int32_t offset = offsetOf(s);
+    if (offset == previous) continue;
+    previous = offset;
+    transitions++;
+    for (int64_t x = s - 2 * 3600; x < s + 3600; x++) c.check(x * 1000 + (x % 1000));
+  }
+
+  // Aleatorio en todo el rango: obliga a recalcular hacia delante y hacia atrás
+  std::mt19937_64 rng(12345);
+  std::uniform_int_distribution<int64_t> any(from * 1000, to * 1000 - 1);
+  for (int i = 0; i < 2000000; i++) c.check(any(rng));
+
+  printf("%-32s %4u cambios, %10llu comprobaciones, %llu diferencias\n", tz, transitions,
+         (unsigned long long)c.checked, (unsigned long long)c.mismatches);
+  return c.mismatches == 0;
+}
+
+template <typename Fn>
+double nsPerCall(Fn fn, int calls) {
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < calls; i++) fn(i);
+  const auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / calls;
+}
+
+}  // namespace
+
+int main() {
+  bool ok = true;
+  ok &= verifyZone("CET-1CEST,M3.5.0/2,M10.5.0/3");  // TZ_INFO de TimeUtils.hpp
+  ok &= verifyZone("Europe/Madrid");
+  ok &= verifyZone("America/Santiago");             // cambios a medianoche
+  ok &= verifyZone("Australia/Lord_Howe");          // horario de verano de 30 min
+  ok &= verifyZone("Asia/Kathmandu");               // +05:45
+
+  setenv("TZ", "CET-1CEST,M3.5.0/2,M10.5.0/3", 1);
+  tzset();
+  const int calls = 5000000;
+  const int64_t base = 1735689600000LL;  // 2025-01-01
+  char buffer[40];
+  volatile size_t sink = 0;
+  IsoTimestampFormatter local(false);
+  IsoTimestampFormatter utc(true);
+  // Una lectura cada 30 s, como en la estación
+  const double cached = nsPerCall([&](int i) { sink += local.format(base + i * 30000LL, buffer, sizeof(buffer)); }, calls);
+  const double cachedMs = nsPerCall([&](int i) { sink += utc.format(base + i * 30000LL, buffer, sizeof(buffer), true); }, calls);
+  const double libc = nsPerCall([&](int i) { sink += reference(base + i * 30000LL, false, false, buffer, sizeof(buffer)); }, calls);
+  printf("\nlocal cacheado %.1f ns | UTC con ms %.1f ns | localtime_r+strftime %.1f ns  (x%.1f)\n", cached, cachedMs,
+         libc, libc / cached);
+  printf("recálculos: %u en %d llamadas (~%.1f años)\n", local.refreshes(), calls, calls * 30.0 / 86400 / 365);
+  return ok ? 0 : 1;
+}
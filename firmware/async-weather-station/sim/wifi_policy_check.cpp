@@ -0,0 +1,405 @@
+// =============================================================
+// === Política de conexión WiFi (WiFiPolicy.hpp) con radio falsa ===
+// =============================================================
+// La radio falsa responde a cada intento con tiempos típicos del ESP32
+// (escaneo 2200 ms, asociación directa 180 ms, DHCP 900 ms, IP fija o
+// concesión reutilizada 15 ms) según dónde esté el AP:
+// 1) Arranque en frío: escaneo con DHCP; el enlace y la concesión se
+//    guardan una sola vez. Al perder el enlace, reconexión inmediata
+//    directa al BSSID/canal: con DHCP por defecto y, con reuseLease, con
+//    la concesión guardada.
+// 2) El AP cambia de canal: el intento directo falla, se pasa al escaneo
+//    sin esperar y la caché se actualiza con el enlace nuevo.
+// 3) Sin AP: directo, escaneo y espera de 1, 2, 4... s hasta 60 s, y cada
+//    ciclo vuelve a empezar por la vía rápida; timeouts de 4 s y 15 s.
+// 4) Opciones: IP fija en todos los intentos (y su dirección no se guarda
+//    como concesión), sin vía rápida, sin reutilizar la concesión, caché
+//    inválida ignorada y desconexiones propias (ASSOC_LEAVE) ignoradas.
+// 5) 1000 caídas del enlace con el AP en su sitio (y un 10 % de cambios
+//    de canal): latencia de reconexión con la vía rápida, con y sin
+//    reutilizar la concesión, frente a escanear siempre.
+//
+//   g++ -std=c++17 -O2 -I.. wifi_policy_check.cpp -o wifi_policy_check
+//   ./wifi_policy_check   (termina con código 1 si algo falla)
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+#include "include/WiFiPolicy.hpp"
+
+namespace {
+
+uint32_t failures = 0;
+
+#define EXPECT(cond, ...)                             \
+  do {                                                \
+    if (!(cond)) {                                    \
+      if (failures++ < 20) {                          \
+        printf("  FALLO %s:%d ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__);                          \
+        printf("\n");                                 \
+      }                                               \
+    }                                                 \
+  } while (0)
+
+// Tiempos de sim::NetworkConfig
+constexpr uint32_t SCAN_MS = 2200;
+constexpr uint32_t DIRECT_MS = 180;
+constexpr uint32_t NO_AP_MS = 2500;
+constexpr uint32_t DHCP_MS = 900;
+constexpr uint32_t STATIC_IP_MS = 15;
+constexpr uint8_t REASON_NO_AP_FOUND = 201;
+
+const uint8_t BSSID_A[6] = {0x24, 0xA4, 0x3C, 0x5E, 0x71, 0x02};
+const uint8_t BSSID_B[6] = {0x24, 0xA4, 0x3C, 0x5E, 0x71, 0x03};
+
+WiFiLease dhcpLease() {
+  WiFiLease lease;
+  lease.ip = 0x3901A8C0;       // 192.168.1.57
+  lease.gateway = 0x0101A8C0;  // 192.168.1.1
+  lease.subnet = 0x00FFFFFF;
+  lease.dns = lease.gateway;
+  return lease;
+}
+
+// === Radio falsa con reloj virtual ===
+class FakeRadio : public WiFiRadio {
+ public:
+  bool apUp = true;
+  uint8_t apBssid[6];
+  uint8_t apChannel = 6;
+  uint32_t nowMs = 0;
+  std::vector<WiFiAttemptPlan> plans;
+  uint32_t disconnects = 0;
+  bool hang = false;  // el intento no responde nunca (para los timeouts)
+
+  FakeRadio() { memcpy(apBssid, BSSID_A, 6); }
+
+  void connect(const WiFiAttemptPlan& plan) override {
+    plans.push_back(plan);
+    attempt_++;
+    if (hang) return;
+    const bool direct = plan.kind == WiFiAttemptKind::DIRECT;
+    const bool found = apUp && (!direct || (plan.channel == apChannel && memcmp(plan.bssid, apBssid, 6) == 0));
+    if (!found) {
+      events_.push_back({nowMs + (direct ? DIRECT_MS * 3 : NO_AP_MS), Event::DISCONNECTED, REASON_NO_AP_FOUND,
+                         attempt_});
+      return;
+    }
+    const uint32_t associated = nowMs + (direct ? DIRECT_MS : SCAN_MS);
+    events_.push_back({associated, Event::ASSOCIATED, 0, attempt_});
+    const bool fixed = plan.addressing != WiFiAddressing::DHCP;
+    events_.push_back({associated + (fixed ? STATIC_IP_MS : DHCP_MS), Event::GOT_IP, 0, attempt_});
+  }
+
+  // Como el SDK: cancela lo pendiente y avisa con ASSOC_LEAVE
+  void disconnect() override {
+    disconnects++;
+    attempt_++;
+    events_.clear();
+    events_.push_back({nowMs, Event::DISCONNECTED, WiFiPolicy::REASON_ASSOC_LEAVE, attempt_});
+  }
+
+  // Se pierde el enlace establecido (BEACON_TIMEOUT)
+  void dropLink(WiFiPolicy& policy) { policy.onDisconnected(200, nowMs); }
+
+  // Avanza el reloj entregando los eventos y llamando a poll() cada 10 ms
+  void run(WiFiPolicy& policy, uint32_t ms) {
+    const uint32_t end = nowMs + ms;
+    while (nowMs < end) {
+      for (size_t i = 0; i < events_.size();) {
+        if (events_[i].atMs > nowMs) {
+          i++;
+          continue;
+        }
+        const Event e = events_[i];
+        events_.erase(events_.begin() + (long)i);
+        deliver(policy, e);
+        i = 0;  // deliver() puede haber lanzado otro intento
+      }
+      policy.poll(nowMs);
+      nowMs += 10;
+    }
+  }
+
+  // Hasta tener IP, con un máximo de `limitMs`; devuelve los ms que ha tardado
+  uint32_t runUntilConnected(WiFiPolicy& policy, uint32_t limitMs) {
+    const uint32_t start = nowMs;
+    while (policy.state() != WiFiPolicyState::CONNECTED && nowMs - start < limitMs) run(policy, 10);
+    return nowMs - start;
+  }
+
+ private:
+  struct Event {
+    enum Type { ASSOCIATED, GOT_IP, DISCONNECTED };
+    uint32_t atMs;
+    Type type;
+    uint8_t reason;
+    uint32_t attempt;
+  };
+
+  void deliver(WiFiPolicy& policy, const Event& e) {
+    if (e.type == Event::ASSOCIATED) {
+      policy.onAssociated(apBssid, apChannel);
+    } else if (e.type == Event::GOT_IP) {
+      const WiFiAttemptPlan& plan = plans.back();
+      policy.onGotIp(plan.addressing == WiFiAddressing::CACHED_LEASE ? plan.lease : dhcpLease(), e.atMs);
+    } else {
+      policy.onDisconnected(e.reason, e.atMs);
+    }
+  }
+
+  std::vector<Event> events_;
+  uint32_t attempt_ = 0;
+};
+
+bool isPlan(const WiFiAttemptPlan& p, WiFiAttemptKind kind, WiFiAddressing addressing) {
+  return p.kind == kind && p.addressing == addressing;
+}
+
+// === 1) Arranque en frío y reconexión ===
+void checkColdStartAndReconnect(bool reuseLease) {
+  FakeRadio radio;
+  WiFiPolicy policy(&radio);
+  WiFiPolicyConfig config;
+  config.reuseLease = reuseLease;
+  policy.configure(config);
+  policy.start(0);
+  EXPECT(radio.plans.size() == 1 && isPlan(radio.plans[0], WiFiAttemptKind::SCAN, WiFiAddressing::DHCP),
+         "sin caché el primer intento escanea con DHCP");
+  const uint32_t cold = radio.runUntilConnected(policy, 60000);
+  EXPECT(policy.metrics().lastLatencyMs == SCAN_MS + DHCP_MS && policy.metrics().scanSuccesses == 1,
+         "arranque en frío: %u ms (%u de reloj)", (unsigned)policy.metrics().lastLatencyMs, (unsigned)cold);
+
+  WiFiLinkCache saved;
+  EXPECT(policy.takeCacheUpdate(saved) && saved.valid() && saved.channel == 6 &&
+             memcmp(saved.bssid, BSSID_A, 6) == 0 && saved.lease.ip == dhcpLease().ip,
+         "enlace y concesión guardados");
+  EXPECT(!policy.takeCacheUpdate(saved), "la actualización se entrega una sola vez");
+
+  radio.dropLink(policy);
+  radio.run(policy, 10);
+  const WiFiAddressing addressing = reuseLease ? WiFiAddressing::CACHED_LEASE : WiFiAddressing::DHCP;
+  EXPECT(radio.plans.size() == 2 && isPlan(radio.plans[1], WiFiAttemptKind::DIRECT, addressing) &&
+             radio.plans[1].channel == 6 && memcmp(radio.plans[1].bssid, BSSID_A, 6) == 0,
+         "tras perder el enlace: directo (%s)", reuseLease ? "concesión guardada" : "DHCP");
+  EXPECT(!reuseLease || radio.plans[1].lease.ip == dhcpLease().ip, "la concesión reutilizada es la guardada");
+  radio.runUntilConnected(policy, 60000);
+  const uint32_t direct = DIRECT_MS + (reuseLease ? STATIC_IP_MS : DHCP_MS);
+  EXPECT(policy.metrics().lastLatencyMs == direct && policy.metrics().directSuccesses == 1,
+         "reconexión directa en %u ms", (unsigned)policy.metrics().lastLatencyMs);
+  EXPECT(!policy.takeCacheUpdate(saved), "mismo enlace: nada que escribir en NVS");
+  EXPECT(policy.metrics().bestLatencyMs == direct && policy.metrics().worstLatencyMs == SCAN_MS + DHCP_MS &&
+             policy.metrics().meanLatencyMs() == (direct + SCAN_MS + DHCP_MS) / 2,
+         "mejor/peor/media");
+}
+
+// === 2) El AP cambia de canal ===
+void checkApMoved() {
+  FakeRadio radio;
+  WiFiPolicy policy(&radio);
+  policy.start(0);
+  radio.runUntilConnected(policy, 60000);
+  WiFiLinkCache saved;
+  policy.takeCacheUpdate(saved);
+
+  radio.apChannel = 11;
+  memcpy(radio.apBssid, BSSID_B, 6);
+  radio.dropLink(policy);
+  const uint32_t took = radio.runUntilConnected(policy, 60000);
+  EXPECT(radio.plans.size() == 3 && radio.plans[1].kind == WiFiAttemptKind::DIRECT &&
+             isPlan(radio.plans[2], WiFiAttemptKind::SCAN, WiFiAddressing::DHCP),
+         "directo fallido y escaneo con DHCP (no la concesión): %zu intentos", radio.plans.size());
+  EXPECT(took <= DIRECT_MS * 3 + SCAN_MS + DHCP_MS + 20, "sin espera entre directo y escaneo: %u ms", (unsigned)took);
+  EXPECT(policy.takeCacheUpdate(saved) && saved.channel == 11 && memcmp(saved.bssid, BSSID_B, 6) == 0,
+         "caché con el enlace nuevo");
+
+  radio.dropLink(policy);
+  radio.run(policy, 10);
+  EXPECT(radio.plans.back().kind == WiFiAttemptKind::DIRECT && radio.plans.back().channel == 11,
+         "el siguiente directo va al canal nuevo");
+}
+
+// === 3) Sin AP: espera creciente ===
+void checkBackoff() {
+  FakeRadio radio;
+  WiFiPolicy policy(&radio);
+  policy.start(0);
+  radio.runUntilConnected(policy, 60000);
+  radio.apUp = false;
+  const size_t before = radio.plans.size();
+  radio.dropLink(policy);
+  radio.run(policy, 10UL * 60UL * 1000UL);
+
+  // Cada ciclo: directo, escaneo y espera
+  bool alternates = true;
+  for (size_t i = before; i < radio.plans.size(); i++) {
+    const WiFiAttemptKind expected = (i - before) % 2 == 0 ? WiFiAttemptKind::DIRECT : WiFiAttemptKind::SCAN;
+    if (radio.plans[i].kind != expected) alternates = false;
+  }
+  EXPECT(alternates, "sin AP se alternan directo y escaneo");
+  const WiFiConnectMetrics& m = policy.metrics();
+  const uint32_t cycles = (uint32_t)(radio.plans.size() - before + 1) / 2;
+  // Ciclos empezados en 10 min: 540 + 2500 ms de intentos más 1, 2, 4... 60 s de espera
+  uint32_t expectedCycles = 0;
+  uint32_t backoff = 1000;
+  for (uint32_t t = 0; t < 600000; expectedCycles++) {
+    t += DIRECT_MS * 3 + NO_AP_MS + backoff;
+    backoff = backoff * 2 > 60000 ? 60000 : backoff * 2;
+  }
+  EXPECT(cycles == expectedCycles, "%u ciclos en 10 min (esperados ~%u)",
+         (unsigned)cycles, (unsigned)expectedCycles);
+  EXPECT(m.failures == radio.plans.size() - before - (policy.state() == WiFiPolicyState::CONNECTING ? 1 : 0),
+         "cada intento fallido contado: %u", (unsigned)m.failures);
+
+  // El AP vuelve: conecta el primer intento lanzado después (directo si
+  // estaba esperando, el escaneo que sigue si había un directo en curso)
+  radio.apUp = true;
+  const size_t atReturn = radio.plans.size();
+  radio.runUntilConnected(policy, 120000);
+  EXPECT(policy.state() == WiFiPolicyState::CONNECTED && radio.plans.size() - atReturn <= 2,
+         "reconexión al volver el AP: %zu intentos más", radio.plans.size() - atReturn);
+
+  // Timeouts: una radio que no contesta
+  FakeRadio mute;
+  WiFiPolicyConfig config;
+  WiFiPolicy silent(&mute);
+  silent.configure(config);
+  WiFiLinkCache cache;
+  cache.magic = WiFiLinkCache::MAGIC;
+  memcpy(cache.bssid, BSSID_A, 6);
+  cache.channel = 6;
+  silent.loadCache(cache);
+  mute.hang = true;
+  silent.start(0);
+  mute.run(silent, config.directTimeoutMs - 10);
+  EXPECT(mute.plans.size() == 1, "directo antes de su timeout");
+  mute.run(silent, 20);
+  EXPECT(mute.plans.size() == 2 && mute.plans[1].kind == WiFiAttemptKind::SCAN && silent.metrics().timeouts == 1,
+         "timeout del directo a los %u ms", (unsigned)config.directTimeoutMs);
+  mute.run(silent, config.scanTimeoutMs);
+  EXPECT(silent.metrics().timeouts == 2 && silent.state() == WiFiPolicyState::BACKOFF, "timeout del escaneo");
+}
+
+// === 4) Opciones ===
+void checkOptions() {
+  WiFiLinkCache cache;
+  cache.magic = WiFiLinkCache::MAGIC;
+  memcpy(cache.bssid, BSSID_A, 6);
+  cache.channel = 6;
+  cache.lease = dhcpLease();
+
+  {
+    FakeRadio radio;
+    WiFiPolicy policy(&radio);
+    WiFiPolicyConfig config;
+    config.staticConfig = true;
+    policy.configure(config);
+    policy.loadCache(cache);
+    policy.start(0);
+    radio.runUntilConnected(policy, 60000);
+    EXPECT(isPlan(radio.plans[0], WiFiAttemptKind::DIRECT, WiFiAddressing::STATIC_CONFIG) &&
+               policy.metrics().lastLatencyMs == DIRECT_MS + STATIC_IP_MS,
+           "IP fija con la vía rápida");
+    radio.apChannel = 1;
+    radio.dropLink(policy);
+    radio.runUntilConnected(policy, 60000);
+    EXPECT(isPlan(radio.plans.back(), WiFiAttemptKind::SCAN, WiFiAddressing::STATIC_CONFIG),
+           "IP fija también al escanear");
+    WiFiLinkCache saved;
+    EXPECT(policy.takeCacheUpdate(saved) && saved.channel == 1 && saved.lease.ip == cache.lease.ip,
+           "con IP fija se guarda el enlace pero no se toca la concesión");
+  }
+  {
+    FakeRadio radio;
+    WiFiPolicy policy(&radio);
+    WiFiPolicyConfig config;
+    config.fastReconnect = false;
+    policy.configure(config);
+    policy.loadCache(cache);
+    policy.start(0);
+    EXPECT(isPlan(radio.plans[0], WiFiAttemptKind::SCAN, WiFiAddressing::DHCP), "sin vía rápida: escaneo");
+  }
+  {
+    FakeRadio radio;
+    WiFiPolicy policy(&radio);
+    WiFiPolicyConfig config;
+    policy.configure(config);
+    policy.loadCache(cache);
+    policy.start(0);
+    EXPECT(isPlan(radio.plans[0], WiFiAttemptKind::DIRECT, WiFiAddressing::DHCP),
+           "por defecto, directo sin reutilizar la concesión");
+  }
+  {
+    FakeRadio radio;
+    WiFiPolicy policy(&radio);
+    WiFiLinkCache bad = cache;
+    bad.channel = 0;
+    policy.loadCache(bad);
+    bad = cache;
+    bad.magic = 0x57464330;
+    policy.loadCache(bad);
+    policy.start(0);
+    EXPECT(!policy.cache().valid() && radio.plans[0].kind == WiFiAttemptKind::SCAN, "caché inválida ignorada");
+
+    radio.runUntilConnected(policy, 60000);
+    const size_t attempts = radio.plans.size();
+    policy.onDisconnected(WiFiPolicy::REASON_ASSOC_LEAVE, radio.nowMs);
+    EXPECT(radio.plans.size() == attempts && policy.state() == WiFiPolicyState::CONNECTED,
+           "ASSOC_LEAVE no es una caída");
+  }
+}
+
+// === 5) Latencia de reconexión ===
+void checkReconnectLatency() {
+  // 2: vía rápida con la concesión guardada, 1: vía rápida con DHCP, 0: escaneo
+  for (int fast = 2; fast >= 0; fast--) {
+    FakeRadio radio;
+    WiFiPolicy policy(&radio);
+    WiFiPolicyConfig config;
+    config.fastReconnect = fast != 0;
+    config.reuseLease = fast == 2;
+    policy.configure(config);
+    policy.start(0);
+    radio.runUntilConnected(policy, 60000);
+    std::mt19937 rng(4);
+    uint64_t total = 0;
+    uint32_t worst = 0;
+    for (int i = 0; i < 1000; i++) {
+      radio.run(policy, 1000 + rng() % 5000);
+      if (rng() % 10 == 0) radio.apChannel = radio.apChannel == 6 ? 11 : 6;
+      radio.dropLink(policy);
+      const uint32_t took = radio.runUntilConnected(policy, 120000);
+      total += took;
+      if (took > worst) worst = took;
+    }
+    const double mean = (double)total / 1000.0;
+    const char* const modes[] = {"escaneando siempre", "con vía rápida y DHCP", "con vía rápida y concesión"};
+    printf("1000 caídas %s: reconexión media %.0f ms, peor %u ms (%u directas, %u con escaneo)\n", modes[fast],
+           mean, (unsigned)worst, (unsigned)policy.metrics().directSuccesses,
+           (unsigned)policy.metrics().scanSuccesses);
+    if (fast) {
+      const double bound = fast == 2 ? 700.0 : 1500.0;
+      EXPECT(mean < bound && worst <= DIRECT_MS * 3 + SCAN_MS + DHCP_MS + 20, "vía rápida: media %.0f, peor %u",
+             mean, (unsigned)worst);
+    } else {
+      EXPECT(mean >= SCAN_MS + DHCP_MS, "escaneando: media %.0f", mean);
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  checkColdStartAndReconnect(false);
+  checkColdStartAndReconnect(true);
+  checkApMoved();
+  checkBackoff();
+  checkOptions();
+  checkReconnectLatency();
+  printf("%s (%u fallos)\n", failures ? "FALLOS" : "OK", failures);
+  return failures ? 1 : 0;
+}